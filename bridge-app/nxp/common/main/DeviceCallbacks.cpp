@@ -32,6 +32,9 @@
 #include <app/util/attribute-table.h>
 
 #include <lib/support/CodeUtils.h>
+#include <platform/DiagnosticDataProvider.h>
+
+#include "ZcbChannelPlanner.h"
 
 using namespace chip::app;
 void OnTriggerEffect(::Identify * identify)
@@ -94,6 +97,45 @@ void AllClustersApp::DeviceCallbacks::PostAttributeChangeCallback(EndpointId end
     }
 }
 
+void AllClustersApp::DeviceCallbacks::DeviceEventCallback(const ChipDeviceEvent * event, intptr_t arg)
+{
+    chip::NXP::App::CommonDeviceCallbacks::DeviceEventCallback(event, arg);
+
+    if (event->Type == DeviceEventType::kWiFiConnectivityChange)
+    {
+        OnWiFiChannelChange(event);
+    }
+}
+
+// The Zigbee channel planner keeps clear of the Wi-Fi channel. An access point
+// moving to another channel drops the station, which connects again on the new
+// one, so connect and disconnect are the only changes to follow.
+void AllClustersApp::DeviceCallbacks::OnWiFiChannelChange(const ChipDeviceEvent * event)
+{
+    uint16_t channel = 0;
+
+    if (event->WiFiConnectivityChange.Result == kConnectivity_Established)
+    {
+        if (GetDiagnosticDataProvider().GetWiFiChannelNumber(channel) != CHIP_NO_ERROR)
+        {
+            ChipLogError(DeviceLayer, "Wi-Fi channel not known, the Zigbee channel planner ignores Wi-Fi");
+            channel = 0;
+        }
+        // A 5 GHz channel leaves all of 2.4 GHz to Zigbee
+        if (channel > 14)
+        {
+            channel = 0;
+        }
+    }
+    else if (event->WiFiConnectivityChange.Result != kConnectivity_Lost)
+    {
+        return;
+    }
+
+    ChipLogProgress(DeviceLayer, "Wi-Fi channel %u for the Zigbee channel planner", channel);
+    vZCB_ChannelPlannerSetWifiChannel(static_cast<uint8_t>(channel));
+}
+
 void AllClustersApp::DeviceCallbacks::OnOnOffPostAttributeChangeCallback(chip::EndpointId endpointId, chip::AttributeId attributeId,
                                                                          uint8_t * value)
 {
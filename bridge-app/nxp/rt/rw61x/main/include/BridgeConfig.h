@@ -58,6 +58,8 @@ namespace {
 #define  DIMMABLE_CLUSTER_LIST      bridgedDimmableClusters
 #define  COLORCONTROL_CLUSTER_LIST  bridgedColorControlClusters  
 #define  TEMPSENSOR_CLUSTER_LIST    bridgedTempSensorClusters
+#define  CONTACTSENSOR_CLUSTER_LIST bridgedContactSensorClusters
+#define  OCCUPANCY_CLUSTER_LIST     bridgedOccupancySensorClusters
 
 const int16_t minMeasuredValue     = -27315;
 const int16_t maxMeasuredValue     = 32766;
@@ -79,6 +81,7 @@ const int16_t initialMeasuredValue = 100;
 #define DEVICE_TYPE_EXTENDED_COLOR_LIGHT 0x010D
 
 #define DEVICE_TYPE_OCCUPANCY_SENSOR 0x0107
+#define DEVICE_TYPE_CONTACT_SENSOR 0x0015
 
 // Device Version for dynamic endpoints:
 #define DEVICE_VERSION_DEFAULT 1
@@ -93,6 +96,15 @@ const int16_t initialMeasuredValue = 100;
 #define ZCL_TEMPERATURE_SENSOR_CLUSTER_REVISION (1u)
 #define ZCL_TEMPERATURE_SENSOR_FEATURE_MAP (0u)
 #define ZCL_POWER_SOURCE_CLUSTER_REVISION (1u)
+#define ZCL_SCENES_MANAGEMENT_CLUSTER_REVISION (1u)
+#define ZCL_SCENES_MANAGEMENT_FEATURE_MAP (0u)
+#define ZCL_GROUPS_CLUSTER_REVISION (4u)
+#define ZCL_GROUPS_FEATURE_MAP (1u)      /* group names */
+#define ZCL_GROUPS_NAME_SUPPORT (0x80u)
+#define ZCL_BOOLEAN_STATE_CLUSTER_REVISION (1u)
+#define ZCL_BOOLEAN_STATE_FEATURE_MAP (0u)
+#define ZCL_OCCUPANCY_SENSING_CLUSTER_REVISION (5u)
+#define ZCL_OCCUPANCY_SENSING_FEATURE_MAP (2u)   /* passive infrared */
 
 // ---------------------------------------------------------------------------
 //
@@ -104,6 +116,8 @@ const int kDescriptorAttributeArraySize = 254;
 //
 // LIGHT ENDPOINT: contains the following clusters:
 //   - On/Off
+//   - Groups
+//   - Scenes Management
 //   - Descriptor
 //   - Bridged Device Basic
 
@@ -140,8 +154,63 @@ constexpr CommandId onOffIncomingCommands[] = {
     kInvalidCommandId,
 };
 
+// Declare Groups cluster attributes, a Matter group of the endpoint is the Zigbee group
+// of the same ID on its node
+DECLARE_DYNAMIC_ATTRIBUTE_LIST_BEGIN(groupsAttrs)
+DECLARE_DYNAMIC_ATTRIBUTE(Groups::Attributes::NameSupport::Id, BITMAP8, 1, 0), /* name support */
+    DECLARE_DYNAMIC_ATTRIBUTE(Groups::Attributes::FeatureMap::Id, BITMAP32, 4, 0), /* feature map */
+    DECLARE_DYNAMIC_ATTRIBUTE_LIST_END();
+
+constexpr CommandId groupsIncomingCommands[] = {
+    app::Clusters::Groups::Commands::AddGroup::Id,
+    app::Clusters::Groups::Commands::ViewGroup::Id,
+    app::Clusters::Groups::Commands::GetGroupMembership::Id,
+    app::Clusters::Groups::Commands::RemoveGroup::Id,
+    app::Clusters::Groups::Commands::RemoveAllGroups::Id,
+    app::Clusters::Groups::Commands::AddGroupIfIdentifying::Id,
+    kInvalidCommandId,
+};
+
+constexpr CommandId groupsOutgoingCommands[] = {
+    app::Clusters::Groups::Commands::AddGroupResponse::Id,
+    app::Clusters::Groups::Commands::ViewGroupResponse::Id,
+    app::Clusters::Groups::Commands::GetGroupMembershipResponse::Id,
+    app::Clusters::Groups::Commands::RemoveGroupResponse::Id,
+    kInvalidCommandId,
+};
+
+// Declare Scenes Management cluster attributes, the scenes themselves are stored on the Zigbee node.
+// A scene is captured from the node's own On/Off, level and colour state by StoreScene; the bridge
+// does not hold scene field sets, so AddScene, ViewScene and CopyScene are not supported and
+// answer UnsupportedCommand. FabricSceneInfo reports the bridge's table for the accessing fabric;
+// the current scene is not tracked since the node's state changes without the bridge.
+DECLARE_DYNAMIC_ATTRIBUTE_LIST_BEGIN(scenesAttrs)
+DECLARE_DYNAMIC_ATTRIBUTE(ScenesManagement::Attributes::SceneTableSize::Id, INT16U, 2, 0), /* scene table size */
+    DECLARE_DYNAMIC_ATTRIBUTE(ScenesManagement::Attributes::FabricSceneInfo::Id, ARRAY, kDescriptorAttributeArraySize, 0), /* fabric scene info */
+    DECLARE_DYNAMIC_ATTRIBUTE(ScenesManagement::Attributes::FeatureMap::Id, BITMAP32, 4, 0), /* feature map */
+    DECLARE_DYNAMIC_ATTRIBUTE_LIST_END();
+
+constexpr CommandId scenesIncomingCommands[] = {
+    app::Clusters::ScenesManagement::Commands::StoreScene::Id,
+    app::Clusters::ScenesManagement::Commands::RecallScene::Id,
+    app::Clusters::ScenesManagement::Commands::RemoveScene::Id,
+    app::Clusters::ScenesManagement::Commands::RemoveAllScenes::Id,
+    app::Clusters::ScenesManagement::Commands::GetSceneMembership::Id,
+    kInvalidCommandId,
+};
+
+constexpr CommandId scenesOutgoingCommands[] = {
+    app::Clusters::ScenesManagement::Commands::StoreSceneResponse::Id,
+    app::Clusters::ScenesManagement::Commands::RemoveSceneResponse::Id,
+    app::Clusters::ScenesManagement::Commands::RemoveAllScenesResponse::Id,
+    app::Clusters::ScenesManagement::Commands::GetSceneMembershipResponse::Id,
+    kInvalidCommandId,
+};
+
 DECLARE_DYNAMIC_CLUSTER_LIST_BEGIN(LIGHT_CLUSTER_LIST)
 DECLARE_DYNAMIC_CLUSTER(OnOff::Id, onOffAttrs,ZAP_CLUSTER_MASK(SERVER),onOffIncomingCommands, nullptr),
+    DECLARE_DYNAMIC_CLUSTER(Groups::Id, groupsAttrs,ZAP_CLUSTER_MASK(SERVER),groupsIncomingCommands, groupsOutgoingCommands),
+    DECLARE_DYNAMIC_CLUSTER(ScenesManagement::Id, scenesAttrs,ZAP_CLUSTER_MASK(SERVER),scenesIncomingCommands, scenesOutgoingCommands),
     DECLARE_DYNAMIC_CLUSTER(Descriptor::Id, descriptorAttrs,ZAP_CLUSTER_MASK(SERVER), nullptr, nullptr),
     DECLARE_DYNAMIC_CLUSTER(BridgedDeviceBasicInformation::Id, bridgedDeviceBasicAttrs,ZAP_CLUSTER_MASK(SERVER), nullptr,nullptr),
     DECLARE_DYNAMIC_CLUSTER_LIST_END;
@@ -170,6 +239,8 @@ constexpr CommandId LevelControlIncomingCommands[] = {
 DECLARE_DYNAMIC_CLUSTER_LIST_BEGIN(DIMMABLE_CLUSTER_LIST)
 DECLARE_DYNAMIC_CLUSTER(LevelControl::Id, DimmableAttrs,ZAP_CLUSTER_MASK(SERVER),LevelControlIncomingCommands, nullptr),
 DECLARE_DYNAMIC_CLUSTER(OnOff::Id, onOffAttrs, ZAP_CLUSTER_MASK(SERVER),onOffIncomingCommands, nullptr),
+    DECLARE_DYNAMIC_CLUSTER(Groups::Id, groupsAttrs,ZAP_CLUSTER_MASK(SERVER),groupsIncomingCommands, groupsOutgoingCommands),
+    DECLARE_DYNAMIC_CLUSTER(ScenesManagement::Id, scenesAttrs,ZAP_CLUSTER_MASK(SERVER),scenesIncomingCommands, scenesOutgoingCommands),
     DECLARE_DYNAMIC_CLUSTER(Descriptor::Id, descriptorAttrs,ZAP_CLUSTER_MASK(SERVER), nullptr, nullptr),
     DECLARE_DYNAMIC_CLUSTER(BridgedDeviceBasicInformation::Id, bridgedDeviceBasicAttrs,ZAP_CLUSTER_MASK(SERVER), nullptr,nullptr),
     DECLARE_DYNAMIC_CLUSTER_LIST_END;
@@ -213,6 +284,8 @@ DECLARE_DYNAMIC_CLUSTER_LIST_BEGIN(COLORCONTROL_CLUSTER_LIST)
 DECLARE_DYNAMIC_CLUSTER(ColorControl::Id, ColorControlAttrs,ZAP_CLUSTER_MASK(SERVER),ColorControlIncomingCommands, nullptr),
 	DECLARE_DYNAMIC_CLUSTER(LevelControl::Id, DimmableAttrs,ZAP_CLUSTER_MASK(SERVER),LevelControlIncomingCommands, nullptr),
 	DECLARE_DYNAMIC_CLUSTER(OnOff::Id, onOffAttrs, ZAP_CLUSTER_MASK(SERVER),onOffIncomingCommands, nullptr), 
+	DECLARE_DYNAMIC_CLUSTER(Groups::Id, groupsAttrs,ZAP_CLUSTER_MASK(SERVER),groupsIncomingCommands, groupsOutgoingCommands),
+	DECLARE_DYNAMIC_CLUSTER(ScenesManagement::Id, scenesAttrs,ZAP_CLUSTER_MASK(SERVER),scenesIncomingCommands, scenesOutgoingCommands),
     DECLARE_DYNAMIC_CLUSTER(Descriptor::Id, descriptorAttrs, ZAP_CLUSTER_MASK(SERVER),nullptr, nullptr),
     DECLARE_DYNAMIC_CLUSTER(BridgedDeviceBasicInformation::Id, bridgedDeviceBasicAttrs,ZAP_CLUSTER_MASK(SERVER), nullptr,nullptr),
     DECLARE_DYNAMIC_CLUSTER_LIST_END;
@@ -243,4 +316,46 @@ DECLARE_DYNAMIC_CLUSTER(TemperatureMeasurement::Id, tempSensorAttrs,ZAP_CLUSTER_
 const EmberAfDeviceType gBridgedTempSensorDeviceTypes[] = { { DEVICE_TYPE_TEMP_SENSOR, DEVICE_VERSION_DEFAULT },
                                                             { DEVICE_TYPE_BRIDGED_NODE, DEVICE_VERSION_DEFAULT } };
 
+// ---------------------------------------------------------------------------
+//
+// CONTACT SENSOR ENDPOINT: an IAS zone other than motion, contains the following clusters:
+//   - Boolean State
+//   - Descriptor
+//   - Bridged Device Basic
+DECLARE_DYNAMIC_ATTRIBUTE_LIST_BEGIN(booleanStateAttrs)
+DECLARE_DYNAMIC_ATTRIBUTE(BooleanState::Attributes::StateValue::Id, BOOLEAN, 1, 0),         /* State Value */
+    DECLARE_DYNAMIC_ATTRIBUTE(BooleanState::Attributes::FeatureMap::Id, BITMAP32, 4, 0),   /* FeatureMap */
+    DECLARE_DYNAMIC_ATTRIBUTE_LIST_END();
+
+DECLARE_DYNAMIC_CLUSTER_LIST_BEGIN(CONTACTSENSOR_CLUSTER_LIST)
+DECLARE_DYNAMIC_CLUSTER(BooleanState::Id, booleanStateAttrs,ZAP_CLUSTER_MASK(SERVER), nullptr, nullptr),
+    DECLARE_DYNAMIC_CLUSTER(Descriptor::Id, descriptorAttrs,ZAP_CLUSTER_MASK(SERVER), nullptr, nullptr),
+    DECLARE_DYNAMIC_CLUSTER(BridgedDeviceBasicInformation::Id, bridgedDeviceBasicAttrs,ZAP_CLUSTER_MASK(SERVER),nullptr, nullptr),
+    DECLARE_DYNAMIC_CLUSTER_LIST_END;
+
+const EmberAfDeviceType gBridgedContactSensorDeviceTypes[] = { { DEVICE_TYPE_CONTACT_SENSOR, DEVICE_VERSION_DEFAULT },
+                                                               { DEVICE_TYPE_BRIDGED_NODE, DEVICE_VERSION_DEFAULT } };
+
+// ---------------------------------------------------------------------------
+//
+// OCCUPANCY SENSOR ENDPOINT: an IAS motion zone, contains the following clusters:
+//   - Occupancy Sensing
+//   - Descriptor
+//   - Bridged Device Basic
+DECLARE_DYNAMIC_ATTRIBUTE_LIST_BEGIN(occupancyAttrs)
+DECLARE_DYNAMIC_ATTRIBUTE(OccupancySensing::Attributes::Occupancy::Id, BITMAP8, 1, 0),                       /* Occupancy */
+    DECLARE_DYNAMIC_ATTRIBUTE(OccupancySensing::Attributes::OccupancySensorType::Id, ENUM8, 1, 0),         /* Sensor Type */
+    DECLARE_DYNAMIC_ATTRIBUTE(OccupancySensing::Attributes::OccupancySensorTypeBitmap::Id, BITMAP8, 1, 0), /* Sensor Type Bitmap */
+    DECLARE_DYNAMIC_ATTRIBUTE(OccupancySensing::Attributes::FeatureMap::Id, BITMAP32, 4, 0),               /* FeatureMap */
+    DECLARE_DYNAMIC_ATTRIBUTE_LIST_END();
+
+DECLARE_DYNAMIC_CLUSTER_LIST_BEGIN(OCCUPANCY_CLUSTER_LIST)
+DECLARE_DYNAMIC_CLUSTER(OccupancySensing::Id, occupancyAttrs,ZAP_CLUSTER_MASK(SERVER), nullptr, nullptr),
+    DECLARE_DYNAMIC_CLUSTER(Descriptor::Id, descriptorAttrs,ZAP_CLUSTER_MASK(SERVER), nullptr, nullptr),
+    DECLARE_DYNAMIC_CLUSTER(BridgedDeviceBasicInformation::Id, bridgedDeviceBasicAttrs,ZAP_CLUSTER_MASK(SERVER),nullptr, nullptr),
+    DECLARE_DYNAMIC_CLUSTER_LIST_END;
+
+const EmberAfDeviceType gBridgedOccupancySensorDeviceTypes[] = { { DEVICE_TYPE_OCCUPANCY_SENSOR, DEVICE_VERSION_DEFAULT },
+                                                                 { DEVICE_TYPE_BRIDGED_NODE, DEVICE_VERSION_DEFAULT } };
+
 } // namespace
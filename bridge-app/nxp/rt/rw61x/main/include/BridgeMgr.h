@@ -22,9 +22,48 @@
 
 #include <app/app-platform/ContentApp.h>
 #include <app/app-platform/ContentAppPlatform.h>
+#include <app-common/zap-generated/ids/Clusters.h>
+#include <app/AttributeAccessInterface.h>
+#include <app/CommandHandlerInterface.h>
 #include <protocols/interaction_model/StatusCode.h>
 using chip::Protocols::InteractionModel::Status;
 
+struct _ZcbAttributeWave;
+
+// Scenes Management commands of all bridged endpoints, forwarded to the Zigbee nodes
+class BridgedScenesHandler : public chip::app::CommandHandlerInterface
+{
+public:
+    BridgedScenesHandler() :
+        chip::app::CommandHandlerInterface(chip::Optional<chip::EndpointId>::Missing(), chip::app::Clusters::ScenesManagement::Id)
+    {}
+
+    void InvokeCommand(HandlerContext & ctx) override;
+};
+
+// FabricSceneInfo of all bridged endpoints, from the bridge's scene table
+class BridgedScenesAttrAccess : public chip::app::AttributeAccessInterface
+{
+public:
+    BridgedScenesAttrAccess() :
+        chip::app::AttributeAccessInterface(chip::Optional<chip::EndpointId>::Missing(), chip::app::Clusters::ScenesManagement::Id)
+    {}
+
+    CHIP_ERROR Read(const chip::app::ConcreteReadAttributePath & aPath, chip::app::AttributeValueEncoder & aEncoder) override;
+};
+
+// Groups commands of all bridged endpoints, the membership is kept by the group data provider
+// and mirrored in the Zigbee group of the same ID on the node
+class BridgedGroupsHandler : public chip::app::CommandHandlerInterface
+{
+public:
+    BridgedGroupsHandler() :
+        chip::app::CommandHandlerInterface(chip::Optional<chip::EndpointId>::Missing(), chip::app::Clusters::Groups::Id)
+    {}
+
+    void InvokeCommand(HandlerContext & ctx) override;
+};
+
 class BridgeDevMgr
 {
 public:
@@ -38,6 +77,13 @@ public:
     static void HandleDeviceDimmableStatusChanged(DeviceDimmable * dev, DeviceDimmable::Changed_t itemChangedMask);
     static void HandleDeviceColorStatusChanged(DeviceColor * dev, DeviceColor::Changed_t itemChangedMask); 
     static void HandleDeviceTempSensorStatusChanged(DeviceTempSensor * dev, DeviceTempSensor::Changed_t itemChangedMask);
+    static void HandleDeviceIasZoneStatusChanged(DeviceIasZone * dev, DeviceIasZone::Changed_t itemChangedMask);
+    static void ZcbIasLane(void *context);
+    static void DeliverIasZoneEvent(intptr_t closure);
+    static void RequestSubscribedEndpoints();
+    static void SnapshotSubscribedEndpoints(intptr_t closure);
+    static void SetEndpointReachable(uint16_t u16DynamicEp, bool bReachable);
+    static void ApplyEndpointReachable(intptr_t closure);
 
     friend Status emberAfExternalAttributeReadCallback(EndpointId endpoint, ClusterId clusterId,
                                                    const EmberAfAttributeMetadata * attributeMetadata, uint8_t * buffer,
@@ -49,11 +95,13 @@ private:
     void AddDimmableNode(ZigbeeDev_t *ZigbeeDev);
     void AddColorNode(ZigbeeDev_t *ZigbeeDev);
     void AddTempSensorNode(ZigbeeDev_t *ZigbeeDev);
+    void AddIasZoneNode(ZigbeeDev_t *ZigbeeDev);
 
     void RemoveOnOffNode(DeviceOnOff* dev);
 	void RemoveDimmableNode(DeviceDimmable* dev);
 	void RemoveColorNode(DeviceColor* dev);
     void RemoveTempMeasurementNode(DeviceTempSensor* dev);
+    void RemoveIasZoneNode(DeviceIasZone* dev);
 
     void AddNewZcbNode(newdb_zcb_t zcb);
     int  AddZcbNode(ZigbeeDev_t* ZigbeeDev);
@@ -64,7 +112,9 @@ private:
                       const Span<DataVersion> & dataVersionStorage, chip::EndpointId parentEndpointId);
     int RemoveDeviceEndpoint(Device * dev);
 
-    bool WriteAttributeToDynamicEndpoint(newdb_zcb_t zcb,uint16_t u16ClusterID,uint16_t u16AttributeID, uint64_t u64Data, uint8_t u8DataType);
+    bool WriteAttributeToDynamicEndpoint(newdb_zcb_t zcb, uint8_t u8Write, uint64_t u64Data);
+    bool WriteAttributeToDevice(Device *dev, uint8_t u8Write, uint64_t u64Data);
+    void WriteAttributeWave(const struct _ZcbAttributeWave *psWave);
 
 	void RetrieveJoinedNode(ZigbeeDev_t *ZigbeeDev,uint8_t type,uint16_t ep);
 	void RetrieveJoinedNodes(newdb_zcb_t zcb);	
@@ -78,4 +128,7 @@ protected:
     static Device* gDevices[CHIP_DEVICE_CONFIG_DYNAMIC_ENDPOINT_COUNT];
     EndpointId mCurrentEndpointId;
     EndpointId mFirstDynamicEndpointId;
+    BridgedScenesHandler mScenesHandler;
+    BridgedScenesAttrAccess mScenesAttrAccess;
+    BridgedGroupsHandler mGroupsHandler;
 };
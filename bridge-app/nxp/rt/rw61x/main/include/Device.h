@@ -211,6 +211,38 @@ private:
     DeviceCallback_fn mChanged_CB;
 };
 
+// IAS zone, bridged as a contact sensor or, for a motion zone, an occupancy sensor
+class DeviceIasZone : public Device
+{
+public:
+    enum Changed_t
+    {
+        kChanged_ZoneStatus = kChanged_Last << 1,
+    } Changed;
+
+    DeviceIasZone(const char * szDeviceName, std::string szLocation, bool isOccupancy);
+
+    inline bool IsOccupancy() { return mIsOccupancy; };
+    inline uint16_t GetZoneStatus() { return mZoneStatus; };
+    // Boolean State value, or occupied for an occupancy sensor
+    bool GetState();
+    void SetZoneStatus(uint16_t zoneStatus);
+
+    using DeviceCallback_fn = std::function<void(DeviceIasZone *, DeviceIasZone::Changed_t)>;
+    void SetChangeCallback(DeviceCallback_fn aChanged_CB);
+
+    // both endpoint types have the same number of clusters
+    DataVersion DataVersions[ArraySize(CONTACTSENSOR_CLUSTER_LIST)];
+
+private:
+    void HandleDeviceChange(Device * device, Device::Changed_t changeMask);
+
+private:
+    bool mIsOccupancy;
+    uint16_t mZoneStatus;
+    DeviceCallback_fn mChanged_CB;
+};
+
 class ComposedDevice : public Device
 {
 public:
@@ -16,9 +16,22 @@
  */
 
 #include <app-common/zap-generated/attribute-type.h>
+#include <app/AttributeAccessInterfaceRegistry.h>
+#include <app/CommandHandlerInterface.h>
+#include <app/CommandHandlerInterfaceRegistry.h>
+#include <app/InteractionModelEngine.h>
+#include <app/server/Server.h>
+#include <credentials/GroupDataProvider.h>
+#include <lib/core/GroupId.h>
 
 #include "BridgeMgr.h"
 #include "ZcbMessage.h"
+#include "ZcbAttributeMap.h"
+#include "ZcbIasZone.h"
+#include "ZcbResync.h"
+#include "ZcbLiveness.h"
+#include "ZcbSnapshot.h"
+#include "ZcbScenes.h"
 #include "newDb.h"
 #include "zcb.h"
 #include "ZigbeeConstant.h"
@@ -26,8 +39,6 @@
 
 #include "CHIPProjectAppConfig.h"
 
-#include "ram_storage.h"
-
 using chip::Protocols::InteractionModel::Status;
 
 // define global variable
@@ -42,6 +53,11 @@ DECLARE_DYNAMIC_ENDPOINT(bridgedLightEndpoint, LIGHT_CLUSTER_LIST);
 DECLARE_DYNAMIC_ENDPOINT(bridgedDimmableEndpoint, DIMMABLE_CLUSTER_LIST);
 DECLARE_DYNAMIC_ENDPOINT(bridgedColorEndpoint, COLORCONTROL_CLUSTER_LIST); 
 DECLARE_DYNAMIC_ENDPOINT(bridgedTempSensorEndpoint, TEMPSENSOR_CLUSTER_LIST);
+DECLARE_DYNAMIC_ENDPOINT(bridgedContactSensorEndpoint, CONTACTSENSOR_CLUSTER_LIST);
+DECLARE_DYNAMIC_ENDPOINT(bridgedOccupancySensorEndpoint, OCCUPANCY_CLUSTER_LIST);
+
+static_assert(ArraySize(CONTACTSENSOR_CLUSTER_LIST) == ArraySize(OCCUPANCY_CLUSTER_LIST),
+              "DeviceIasZone keeps one DataVersion per cluster of either endpoint type");
 
 Device* BridgeDevMgr::gDevices[CHIP_DEVICE_CONFIG_DYNAMIC_ENDPOINT_COUNT];
 
@@ -108,6 +124,26 @@ void BridgeDevMgr::AddTempSensorNode(ZigbeeDev_t *ZigbeeDev)
                 Span<DataVersion>(TempSensor->DataVersions), 1);
 }
 
+void BridgeDevMgr::AddIasZoneNode(ZigbeeDev_t *ZigbeeDev)
+{
+    bool isOccupancy = ZigbeeDev->zcb.uSupportedClusters.sClusterBitmap.hasIasOccupancy;
+    std::string zone_label = isOccupancy ? "Zigbee Occupancy " : "Zigbee Contact ";
+    DeviceIasZone *Zone = new DeviceIasZone((zone_label + std::to_string(ZigbeeDev->zcb.saddr)).c_str(), "Office", isOccupancy);
+
+    Zone->SetZigbee(*ZigbeeDev);
+    Zone->SetChangeCallback(&HandleDeviceIasZoneStatusChanged);
+
+    if (isOccupancy) {
+        AddDeviceEndpoint(Zone, &bridgedOccupancySensorEndpoint,
+                    Span<const EmberAfDeviceType>(gBridgedOccupancySensorDeviceTypes),
+                    Span<DataVersion>(Zone->DataVersions), 1);
+    } else {
+        AddDeviceEndpoint(Zone, &bridgedContactSensorEndpoint,
+                    Span<const EmberAfDeviceType>(gBridgedContactSensorDeviceTypes),
+                    Span<DataVersion>(Zone->DataVersions), 1);
+    }
+}
+
 void BridgeDevMgr::AddNewZcbNode(newdb_zcb_t zcb)
 {
     ZigbeeDev_t ZigbeeDevice;
@@ -118,6 +154,12 @@ void BridgeDevMgr::AddNewZcbNode(newdb_zcb_t zcb)
 
 int BridgeDevMgr::AddZcbNode(ZigbeeDev_t* ZigbeeDev)
 {
+	if (ZigbeeDev->zcb.uSupportedClusters.sClusterBitmap.hasIasZone) {
+		PRINTF("\n ### Add IAS Zone\n ");
+		AddIasZoneNode(ZigbeeDev);
+		return 1;
+	}
+
 	if (ZigbeeDev->zcb.uSupportedClusters.sClusterBitmap.hasColor) {
 		PRINTF("\n ### Add Color Light\n");
 		AddColorNode(ZigbeeDev);
@@ -159,6 +201,17 @@ void BridgeDevMgr::start()
 
 	ZcbMsg.bridge_mutex = xSemaphoreCreateMutex();
 
+    // nodes under a subscription are read back first after a coordinator restart
+    vZCB_ResyncSetSubscribedHook(&BridgeDevMgr::RequestSubscribedEndpoints);
+
+    // a node going silent or coming back shows in its Reachable attribute
+    vZCB_LivenessSetReachableHook(&BridgeDevMgr::SetEndpointReachable);
+
+    // scene and group commands of every bridged endpoint
+    CommandHandlerInterfaceRegistry::Instance().RegisterCommandHandler(&mScenesHandler);
+    AttributeAccessInterfaceRegistry::Instance().Register(&mScenesAttrAccess);
+    CommandHandlerInterfaceRegistry::Instance().RegisterCommandHandler(&mGroupsHandler);
+
     // start monitor
     start_threads();
 }
@@ -196,12 +249,31 @@ void BridgeDevMgr::ZcbMonitor(void *context)
                         }
                         break;
 
-                    case BRIDGE_WRITE_ATTRIBUTE: {
-                        ZcbAttribute_t *Data = (ZcbAttribute_t*)ZcbMsg.msg_data;
-                        ThisMgr->WriteAttributeToDynamicEndpoint(ZcbMsg.zcb, Data->u16ClusterID, Data->u16AttributeID, Data->u64Data, ZCL_INT16S_ATTRIBUTE_TYPE);
+                    case BRIDGE_WRITE_ATTRIBUTES: {
+                        // the batch names its node by dynamic endpoint
+                        uint16_t endpointIndex;
+                        {
+                            DeviceLayer::StackLock lock;
+                            endpointIndex = emberAfGetDynamicIndexFromEndpoint(ZcbMsg.zcb.DynamicEP);
+                        }
+                        if (endpointIndex < CHIP_DEVICE_CONFIG_DYNAMIC_ENDPOINT_COUNT) {
+                            ZcbMsg.zcb.matterIndex = endpointIndex;
+                            for (uint8_t i = 0; i < ZcbMsg.attr_batch.u8Count; i++) {
+                                ZcbAttribute_t *Data = &ZcbMsg.attr_batch.asAttributes[i];
+                                ThisMgr->WriteAttributeToDynamicEndpoint(ZcbMsg.zcb, Data->u8Write, Data->u64Data);
+                            }
+                        }
+                        ZcbMsg.attr_batch.u8Count = 0;
                         ZcbMsg.zcb = {0};
                         ZcbMsg.msg_type = BRIDGE_UNKNOW;
                         }
+                        break;
+
+                    case BRIDGE_WRITE_ATTRIBUTE_WAVE: {
+                        ThisMgr->WriteAttributeWave((ZcbAttributeWave_t*)ZcbMsg.msg_data);
+                        ZcbMsg.msg_data = NULL;
+                        ZcbMsg.msg_type = BRIDGE_UNKNOW;
+                        }
                         break;
 
 					case BRIDGE_RESTORE_JOINED_NODE:
@@ -238,9 +310,74 @@ if (rt != pdPASS) {
 	return -1;
 }
 
+// IAS zone alarms do not wait behind the monitor's 100 ms poll
+#define IAS_LANE_TASK_STACK_SIZE  512
+#define IAS_LANE_TASK_PRIORITY    (MONITOR_TASK_PRIORITY + 1)
+
+rt = xTaskCreate(&BridgeDevMgr::ZcbIasLane,
+				"ZcbIasLane",
+				IAS_LANE_TASK_STACK_SIZE,
+				NULL,
+				IAS_LANE_TASK_PRIORITY,
+				NULL);
+
+if (rt != pdPASS) {
+	ChipLogError(DeviceLayer, "### ZcbIasLane is Fail ### ");
+	return -1;
+}
+
     return 0;
 }
 
+void BridgeDevMgr::ZcbIasLane(void *context)
+{
+    tsZCB_IasZoneEvent sEvent;
+
+    while (1)
+    {
+        if (!bZCB_IasZoneEventWait(&sEvent, portMAX_DELAY))
+            continue;
+
+        auto * psEvent = Platform::New<tsZCB_IasZoneEvent>(sEvent);
+        if (psEvent == nullptr)
+            continue;
+
+        PlatformMgr().ScheduleWork(DeliverIasZoneEvent, reinterpret_cast<intptr_t>(psEvent));
+    }
+}
+
+void BridgeDevMgr::DeliverIasZoneEvent(intptr_t closure)
+{
+    auto * psEvent = reinterpret_cast<tsZCB_IasZoneEvent *>(closure);
+    tsZCB_SnapshotNode sNode;
+
+    // the ZCB tables belong to the serial callback task, the node comes from the snapshot
+    if (!bZCB_SnapshotNodeByShort(psEvent->u16ShortAddress, &sNode) || (sNode.u16DynamicEp == 0))
+    {
+        // not published yet or not bridged yet, the zone reports its status again on its next change
+        ChipLogError(DeviceLayer, "IAS zone 0x%04x ep %d: no bridged node, status 0x%04x not reported",
+                     psEvent->u16ShortAddress, psEvent->u8Endpoint, psEvent->u16ZoneStatus);
+        Platform::Delete(psEvent);
+        return;
+    }
+
+    uint16_t endpointIndex = emberAfGetDynamicIndexFromEndpoint(sNode.u16DynamicEp);
+
+    if ((endpointIndex < CHIP_DEVICE_CONFIG_DYNAMIC_ENDPOINT_COUNT) && (gDevices[endpointIndex] != nullptr) &&
+        gDevices[endpointIndex]->GetZigbee()->zcb.uSupportedClusters.sClusterBitmap.hasIasZone)
+    {
+        static_cast<DeviceIasZone *>(gDevices[endpointIndex])->SetZoneStatus(psEvent->u16ZoneStatus);
+        vZCB_IasZoneDelivered(psEvent);
+    }
+    else
+    {
+        ChipLogError(DeviceLayer, "IAS zone 0x%04x: endpoint %d is not a zone, status 0x%04x not reported",
+                     psEvent->u16ShortAddress, sNode.u16DynamicEp, psEvent->u16ZoneStatus);
+    }
+
+    Platform::Delete(psEvent);
+}
+
 void BridgeDevMgr::RemoveAllDevice()
 {
     for (uint16_t i = 0; i < CHIP_DEVICE_CONFIG_DYNAMIC_ENDPOINT_COUNT; i++ ) 
@@ -256,6 +393,11 @@ void BridgeDevMgr::RemoveAllDevice()
 void BridgeDevMgr::RemoveDevice(Device *dev)
 {
     RemoveDeviceEndpoint(dev);
+    if ( dev->GetZigbee()->zcb.uSupportedClusters.sClusterBitmap.hasIasZone ) {
+        RemoveIasZoneNode(static_cast<DeviceIasZone *>(dev));
+        return;
+    }
+
     if ( dev->GetZigbee()->zcb.uSupportedClusters.sClusterBitmap.hasOnOff ) {
         RemoveOnOffNode(static_cast<DeviceOnOff *>(dev));
     }
@@ -298,21 +440,23 @@ void BridgeDevMgr::RemoveTempMeasurementNode(DeviceTempSensor* dev)
     dev = nullptr;
 }
 
+void BridgeDevMgr::RemoveIasZoneNode(DeviceIasZone* dev)
+{
+    delete dev;
+    dev = nullptr;
+}
+
 // -----------------------------------------------------------------------------------------
 // Device Management
 // -----------------------------------------------------------------------------------------
 extern NodeDB JoinedNodes[DEV_NUM];
-extern void UpdateJoinedNodes(uint16_t EP);
-
-extern char * myDB_filename;
+extern void UpdateJoinedNodes(uint16_t u16ShortAddress, uint16_t EP);
 
 int BridgeDevMgr::AddDeviceEndpoint(Device * dev, EmberAfEndpointType * ep, const Span<const EmberAfDeviceType> & deviceTypeList,
                       const Span<DataVersion> & dataVersionStorage, chip::EndpointId parentEndpointId = chip::kInvalidEndpointId)
 {
-	JoinedNodesSaved savedNodes;
-
     uint8_t index = 0;
-	int ret=0;
+	uint16_t MaxEp;
 
     if (dev->IsReachable() == true)
     {
@@ -320,19 +464,12 @@ int BridgeDevMgr::AddDeviceEndpoint(Device * dev, EmberAfEndpointType * ep, cons
         return -1;
     }
 
-	ret=ramStorageReadFromFlash(myDB_filename,(uint8_t *)&savedNodes,sizeof(savedNodes));
-	if (ret)
+	/* Past the endpoints of the joined nodes, those not yet written to
+	 * flash included */
+	MaxEp=u16ZCB_JoinedNodeMaxEp();
+	if (MaxEp)
 	{
-		uint8_t j;
-		uint16_t tmp=0;
-	//		PRINTF("\n ### ramStorageReadFromFlash=%d,Joined Nodes=%d",ret,savedNodes.totalNodes);
-			for (j=0;j<savedNodes.totalNodes;j++)
-			{
-				if (savedNodes.joinedNodes[j].ep>tmp)
-					tmp=savedNodes.joinedNodes[j].ep;
-			}		
-	//			PRINTF("\n ### Idx=%d,Type=%d,short=0x%x,mac=0x%llx,ep=%d",j,savedNodes.joinedNodes[j].type,savedNodes.joinedNodes[j].shortaddr,savedNodes.joinedNodes[j].mac,savedNodes.joinedNodes[j].ep);
-		mCurrentEndpointId=tmp+1;
+		mCurrentEndpointId=MaxEp+1;
 	//	PRINTF("\n @@@ mCurrentEndpointId=%d",mCurrentEndpointId);
 	}
 
@@ -357,7 +494,7 @@ int BridgeDevMgr::AddDeviceEndpoint(Device * dev, EmberAfEndpointType * ep, cons
                     ChipLogProgress(DeviceLayer, "Added device %s SAddr 0x%x to dynamic endpoint %d (index=%d)", 
 												dev->GetName(),dev->GetZigbeeSaddr(), mCurrentEndpointId, index);
 				
-  				    UpdateJoinedNodes(mCurrentEndpointId);
+  				    UpdateJoinedNodes(dev->GetZigbeeSaddr(), mCurrentEndpointId);
                     return index;
                 }
 			//	else
@@ -469,6 +606,32 @@ void BridgeDevMgr::RetrieveJoinedNode(ZigbeeDev_t *ZigbeeDev,uint8_t DevType,uin
 		gIndex+=1;
 	}
 	break;
+
+	case ZCB_IAS_NODE_TYPE_BOOLEAN:
+	case ZCB_IAS_NODE_TYPE_OCCUPANCY:
+	{
+		bool isOccupancy = (DevType == ZCB_IAS_NODE_TYPE_OCCUPANCY);
+		std::string zone_label = isOccupancy ? "Zigbee Occupancy " : "Zigbee Contact ";
+
+		ZigbeeDev->zcb.uSupportedClusters.sClusterBitmap.hasIasZone = 1;
+		ZigbeeDev->zcb.uSupportedClusters.sClusterBitmap.hasIasOccupancy = isOccupancy;
+
+		DeviceIasZone *Zone = new DeviceIasZone((zone_label + std::to_string(ZigbeeDev->zcb.saddr)).c_str(), "Office", isOccupancy);
+
+		Zone->SetZigbee(*ZigbeeDev);
+		Zone->SetChangeCallback(&HandleDeviceIasZoneStatusChanged);
+
+		if (isOccupancy)
+			RestoreNodeEndpoint(Zone,EP,&bridgedOccupancySensorEndpoint,
+					Span<const EmberAfDeviceType>(gBridgedOccupancySensorDeviceTypes),
+					Span<DataVersion>(Zone->DataVersions), 1);
+		else
+			RestoreNodeEndpoint(Zone,EP,&bridgedContactSensorEndpoint,
+					Span<const EmberAfDeviceType>(gBridgedContactSensorDeviceTypes),
+					Span<DataVersion>(Zone->DataVersions), 1);
+		gIndex+=1;
+	}
+	break;
 	default:
 		break;
 	}
@@ -566,6 +729,59 @@ Status HandleReadOnOffAttribute(DeviceOnOff * dev, chip::AttributeId attributeId
     return Status::Success;
 }
 
+Status HandleReadScenesManagementAttribute(chip::AttributeId attributeId, uint8_t * buffer, uint16_t maxReadLength)
+{
+    using namespace ScenesManagement::Attributes;
+
+    if ((attributeId == SceneTableSize::Id) && (maxReadLength == 2))
+    {
+        uint16_t size = ZCB_SCENES_MAX;
+        memcpy(buffer, &size, sizeof(size));
+    }
+    else if ((attributeId == FeatureMap::Id) && (maxReadLength == 4))
+    {
+        uint32_t featureMap = ZCL_SCENES_MANAGEMENT_FEATURE_MAP;
+        memcpy(buffer, &featureMap, sizeof(featureMap));
+    }
+    else if ((attributeId == ClusterRevision::Id) && (maxReadLength == 2))
+    {
+        uint16_t rev = ZCL_SCENES_MANAGEMENT_CLUSTER_REVISION;
+        memcpy(buffer, &rev, sizeof(rev));
+    }
+    else
+    {
+        return Status::Failure;
+    }
+
+    return Status::Success;
+}
+
+Status HandleReadGroupsAttribute(chip::AttributeId attributeId, uint8_t * buffer, uint16_t maxReadLength)
+{
+    using namespace Groups::Attributes;
+
+    if ((attributeId == NameSupport::Id) && (maxReadLength == 1))
+    {
+        *buffer = ZCL_GROUPS_NAME_SUPPORT;
+    }
+    else if ((attributeId == FeatureMap::Id) && (maxReadLength == 4))
+    {
+        uint32_t featureMap = ZCL_GROUPS_FEATURE_MAP;
+        memcpy(buffer, &featureMap, sizeof(featureMap));
+    }
+    else if ((attributeId == ClusterRevision::Id) && (maxReadLength == 2))
+    {
+        uint16_t rev = ZCL_GROUPS_CLUSTER_REVISION;
+        memcpy(buffer, &rev, sizeof(rev));
+    }
+    else
+    {
+        return Status::Failure;
+    }
+
+    return Status::Success;
+}
+
 Status HandleReadTempMeasurementAttribute(DeviceTempSensor * dev, chip::AttributeId attributeId, uint8_t * buffer,
                                                  uint16_t maxReadLength)
 {
@@ -604,6 +820,68 @@ Status HandleReadTempMeasurementAttribute(DeviceTempSensor * dev, chip::Attribut
     return Status::Success;
 }
 
+Status HandleReadBooleanStateAttribute(DeviceIasZone * dev, chip::AttributeId attributeId, uint8_t * buffer,
+                                       uint16_t maxReadLength)
+{
+    using namespace BooleanState::Attributes;
+
+    if ((attributeId == StateValue::Id) && (maxReadLength == 1))
+    {
+        *buffer = dev->GetState() ? 1 : 0;
+    }
+    else if ((attributeId == FeatureMap::Id) && (maxReadLength == 4))
+    {
+        uint32_t featureMap = ZCL_BOOLEAN_STATE_FEATURE_MAP;
+        memcpy(buffer, &featureMap, sizeof(featureMap));
+    }
+    else if ((attributeId == ClusterRevision::Id) && (maxReadLength == 2))
+    {
+        uint16_t clusterRevision = ZCL_BOOLEAN_STATE_CLUSTER_REVISION;
+        memcpy(buffer, &clusterRevision, sizeof(clusterRevision));
+    }
+    else
+    {
+        return Status::Failure;
+    }
+
+    return Status::Success;
+}
+
+Status HandleReadOccupancySensingAttribute(DeviceIasZone * dev, chip::AttributeId attributeId, uint8_t * buffer,
+                                           uint16_t maxReadLength)
+{
+    using namespace OccupancySensing::Attributes;
+
+    if ((attributeId == Occupancy::Id) && (maxReadLength == 1))
+    {
+        *buffer = dev->GetState() ? 1 : 0;
+    }
+    else if ((attributeId == OccupancySensorType::Id) && (maxReadLength == 1))
+    {
+        *buffer = to_underlying(OccupancySensing::OccupancySensorTypeEnum::kPir);
+    }
+    else if ((attributeId == OccupancySensorTypeBitmap::Id) && (maxReadLength == 1))
+    {
+        *buffer = to_underlying(OccupancySensing::OccupancySensorTypeBitmap::kPir);
+    }
+    else if ((attributeId == FeatureMap::Id) && (maxReadLength == 4))
+    {
+        uint32_t featureMap = ZCL_OCCUPANCY_SENSING_FEATURE_MAP;
+        memcpy(buffer, &featureMap, sizeof(featureMap));
+    }
+    else if ((attributeId == ClusterRevision::Id) && (maxReadLength == 2))
+    {
+        uint16_t clusterRevision = ZCL_OCCUPANCY_SENSING_CLUSTER_REVISION;
+        memcpy(buffer, &clusterRevision, sizeof(clusterRevision));
+    }
+    else
+    {
+        return Status::Failure;
+    }
+
+    return Status::Success;
+}
+
 void BridgeDevMgr::HandleDeviceOnOffStatusChanged(DeviceOnOff * dev, DeviceOnOff::Changed_t itemChangedMask)
 {
     if (itemChangedMask & (DeviceOnOff::kChanged_Reachable | DeviceOnOff::kChanged_Name | DeviceOnOff::kChanged_Location))
@@ -655,6 +933,41 @@ void BridgeDevMgr::HandleDeviceTempSensorStatusChanged(DeviceTempSensor * dev, D
     }
 }
 
+// Runs on the Matter thread, from DeliverIasZoneEvent
+void BridgeDevMgr::HandleDeviceIasZoneStatusChanged(DeviceIasZone * dev, DeviceIasZone::Changed_t itemChangedMask)
+{
+    if (itemChangedMask & (DeviceIasZone::kChanged_Reachable | DeviceIasZone::kChanged_Name | DeviceIasZone::kChanged_Location))
+    {
+        HandleDeviceStatusChanged(static_cast<Device *>(dev), (Device::Changed_t) itemChangedMask);
+    }
+
+    if (itemChangedMask & DeviceIasZone::kChanged_ZoneStatus)
+    {
+        EventNumber eventNumber;
+        bool state = dev->GetState();
+
+        if (dev->IsOccupancy())
+        {
+            MatterReportingAttributeChangeCallback(dev->GetEndpointId(), OccupancySensing::Id,
+                                                   OccupancySensing::Attributes::Occupancy::Id);
+
+            OccupancySensing::Events::OccupancyChanged::Type event;
+            event.occupancy.Set(OccupancySensing::OccupancyBitmap::kOccupied, state);
+            if (app::LogEvent(event, dev->GetEndpointId(), eventNumber) != CHIP_NO_ERROR)
+                ChipLogError(DeviceLayer, "IasZoneDevice[%s]: OccupancyChanged not logged", dev->GetName());
+        }
+        else
+        {
+            MatterReportingAttributeChangeCallback(dev->GetEndpointId(), BooleanState::Id,
+                                                   BooleanState::Attributes::StateValue::Id);
+
+            BooleanState::Events::StateChange::Type event{ state };
+            if (app::LogEvent(event, dev->GetEndpointId(), eventNumber) != CHIP_NO_ERROR)
+                ChipLogError(DeviceLayer, "IasZoneDevice[%s]: StateChange not logged", dev->GetName());
+        }
+    }
+}
+
 
 Status emberAfExternalAttributeReadCallback(EndpointId endpoint, ClusterId clusterId,
                                                    const EmberAfAttributeMetadata * attributeMetadata, uint8_t * buffer,
@@ -675,10 +988,26 @@ Status emberAfExternalAttributeReadCallback(EndpointId endpoint, ClusterId clust
         {
             ret = HandleReadOnOffAttribute(static_cast<DeviceOnOff *>(dev), attributeMetadata->attributeId, buffer, maxReadLength);
         }
+        else if (clusterId == ScenesManagement::Id)
+        {
+            ret = HandleReadScenesManagementAttribute(attributeMetadata->attributeId, buffer, maxReadLength);
+        }
+        else if (clusterId == Groups::Id)
+        {
+            ret = HandleReadGroupsAttribute(attributeMetadata->attributeId, buffer, maxReadLength);
+        }
         else if (clusterId == TemperatureMeasurement::Id)
         {
             ret = HandleReadTempMeasurementAttribute(static_cast<DeviceTempSensor *>(dev), attributeMetadata->attributeId, buffer,maxReadLength);
         }
+        else if (clusterId == BooleanState::Id)
+        {
+            ret = HandleReadBooleanStateAttribute(static_cast<DeviceIasZone *>(dev), attributeMetadata->attributeId, buffer, maxReadLength);
+        }
+        else if (clusterId == OccupancySensing::Id)
+        {
+            ret = HandleReadOccupancySensingAttribute(static_cast<DeviceIasZone *>(dev), attributeMetadata->attributeId, buffer, maxReadLength);
+        }
     }
 
     return ret;
@@ -688,43 +1017,138 @@ Status emberAfExternalAttributeReadCallback(EndpointId endpoint, ClusterId clust
 // -----------------------------------------------------------------------------------------
 //  zcb node report attribute to Bridge
 // -----------------------------------------------------------------------------------------
-bool BridgeDevMgr::WriteAttributeToDynamicEndpoint(newdb_zcb_t zcb, uint16_t u16ClusterID,uint16_t u16AttributeID, uint64_t u64Data, uint8_t u8DataType)
+// Setters of the bridged values, in teZCB_MatterWrite order; the map row of
+// each attribute names its setter
+typedef void (*AttributeWriter_t)(Device *dev, uint64_t u64Data);
+
+static void WriteOnOff(Device *dev, uint64_t u64Data)
 {
-//	PRINTF("\n ^^^ WriteAttributeToDynamicEndpoint=%d,Dev=0x%p\n",zcb.matterIndex,gDevices[zcb.matterIndex]);
+    static_cast<DeviceOnOff *>(dev)->SetOnOffValue(static_cast<int8_t>(u64Data));
+}
+
+static void WriteLevel(Device *dev, uint64_t u64Data)
+{
+    static_cast<DeviceOnOff *>(dev)->SetLevelValue(static_cast<int8_t>(u64Data));
+}
 
+static void WriteMeasuredValue(Device *dev, uint64_t u64Data)
+{
+    static_cast<DeviceTempSensor *>(dev)->SetMeasuredValue(static_cast<int16_t>(u64Data));
+}
+
+static const AttributeWriter_t sAttributeWriters[] =
+{
+    WriteOnOff,             // E_ZCB_MATTER_WRITE_ONOFF
+    WriteLevel,             // E_ZCB_MATTER_WRITE_LEVEL
+    WriteMeasuredValue,     // E_ZCB_MATTER_WRITE_MEASURED_VALUE
+};
+
+static_assert(ArraySize(sAttributeWriters) == E_ZCB_MATTER_WRITES,
+              "a setter per teZCB_MatterWrite");
+
+bool BridgeDevMgr::WriteAttributeToDynamicEndpoint(newdb_zcb_t zcb, uint8_t u8Write, uint64_t u64Data)
+{
     if ( gDevices[zcb.matterIndex] == NULL) {
         return false;
     }
 
-	switch (u16ClusterID)
-	{
-		case E_ZB_CLUSTERID_ONOFF:
-		{
-			DeviceOnOff *OnOff = static_cast<DeviceOnOff *>(gDevices[zcb.matterIndex]);
-			OnOff->SetOnOffValue(static_cast<int8_t>(u64Data));
-		}
-		break;
-			
-		case E_ZB_CLUSTERID_LEVEL_CONTROL:
-		{
-			DeviceOnOff *OnOff = static_cast<DeviceOnOff *>(gDevices[zcb.matterIndex]);
-			OnOff->SetLevelValue(static_cast<int8_t>(u64Data));
-		}
-		break;
+    return WriteAttributeToDevice(gDevices[zcb.matterIndex], u8Write, u64Data);
+}
 
-		case E_ZB_CLUSTERID_MEASUREMENTSENSING_ILLUM:
-		case E_ZB_CLUSTERID_MEASUREMENTSENSING_TEMP:
-		case E_ZB_CLUSTERID_OCCUPANCYSENSING:	
-		{
-			DeviceTempSensor *TempSensor = static_cast<DeviceTempSensor *>(gDevices[zcb.matterIndex]);
-			TempSensor->SetMeasuredValue(static_cast<int16_t>(u64Data));
-		}
-		break;
+bool BridgeDevMgr::WriteAttributeToDevice(Device *dev, uint8_t u8Write, uint64_t u64Data)
+{
+    if (u8Write >= E_ZCB_MATTER_WRITES) {
+        return false;
+    }
+    sAttributeWriters[u8Write](dev, u64Data);
+    return true;
+}
 
-		default: break;
-	}
+// -----------------------------------------------------------------------------------------
+//  zcb resync after a coordinator restart
+// -----------------------------------------------------------------------------------------
+void BridgeDevMgr::WriteAttributeWave(const struct _ZcbAttributeWave *psWave)
+{
+    uint16_t endpointIndex;
 
-    return true;
+    if (psWave == NULL) {
+        return;
+    }
+
+    // the whole wave in one pass, the reports it triggers go out together
+    DeviceLayer::StackLock lock;
+    for (uint16_t i = 0; i < psWave->u16Count; i++)
+    {
+        const ZcbWaveAttribute_t *Entry = &psWave->asEntries[i];
+
+        endpointIndex = emberAfGetDynamicIndexFromEndpoint(Entry->u16DynamicEp);
+        if ((endpointIndex >= CHIP_DEVICE_CONFIG_DYNAMIC_ENDPOINT_COUNT) || (gDevices[endpointIndex] == nullptr)) {
+            continue;
+        }
+        WriteAttributeToDevice(gDevices[endpointIndex], Entry->sAttribute.u8Write, Entry->sAttribute.u64Data);
+    }
+    PRINTF("\n ### Resync wave: %d value(s) written\n", psWave->u16Count);
+}
+
+void BridgeDevMgr::RequestSubscribedEndpoints()
+{
+    // called from the ZCB service task: the read handlers belong to the Matter thread, the snapshot is taken there
+    PlatformMgr().ScheduleWork(SnapshotSubscribedEndpoints, 0);
+}
+
+void BridgeDevMgr::SnapshotSubscribedEndpoints(intptr_t)
+{
+    app::InteractionModelEngine * engine = app::InteractionModelEngine::GetInstance();
+    static uint16_t endpoints[ZCB_RESYNC_MAX_SUBSCRIBED]; // only used on the Matter thread
+    uint16_t count = 0;
+    bool all       = false;
+
+    for (uint32_t i = 0; (i < engine->GetNumActiveReadHandlers()) && !all; i++)
+    {
+        app::ReadHandler * handler = engine->ActiveHandlerAt(i);
+        if ((handler == nullptr) || !handler->IsType(app::ReadHandler::InteractionType::Subscribe)) {
+            continue;
+        }
+        for (auto * path = handler->GetAttributePathList(); (path != nullptr) && !all; path = path->mpNext)
+        {
+            if (path->mValue.HasWildcardEndpointId()) {
+                all = true;
+                break;
+            }
+            if (emberAfGetDynamicIndexFromEndpoint(path->mValue.mEndpointId) >= CHIP_DEVICE_CONFIG_DYNAMIC_ENDPOINT_COUNT) {
+                continue;
+            }
+            uint16_t j = 0;
+            while ((j < count) && (endpoints[j] != path->mValue.mEndpointId)) {
+                j++;
+            }
+            if ((j == count) && (count < ZCB_RESYNC_MAX_SUBSCRIBED)) {
+                endpoints[count++] = path->mValue.mEndpointId;
+            }
+        }
+    }
+
+    vZCB_ResyncSetSubscribed(endpoints, count, all);
+}
+
+void BridgeDevMgr::SetEndpointReachable(uint16_t u16DynamicEp, bool bReachable)
+{
+    // called from the ZCB service task: gDevices[] belongs to the Matter thread, the change is posted there
+    intptr_t closure = (static_cast<intptr_t>(u16DynamicEp) << 1) | (bReachable ? 1 : 0);
+
+    PlatformMgr().ScheduleWork(ApplyEndpointReachable, closure);
+}
+
+void BridgeDevMgr::ApplyEndpointReachable(intptr_t closure)
+{
+    uint16_t u16DynamicEp = static_cast<uint16_t>(closure >> 1);
+    bool bReachable = (closure & 1) != 0;
+    uint16_t endpointIndex = emberAfGetDynamicIndexFromEndpoint(u16DynamicEp);
+
+    if ((endpointIndex >= CHIP_DEVICE_CONFIG_DYNAMIC_ENDPOINT_COUNT) || (gDevices[endpointIndex] == nullptr)) {
+        return;
+    }
+    gDevices[endpointIndex]->SetReachable(bReachable);
 }
 
 
@@ -1011,6 +1435,328 @@ CHIP_ERROR ProcessColorControlClusterCommand(const chip::app::ConcreteCommandPat
 	return CHIP_NO_ERROR;
 }
 
+// -----------------------------------------------------------------------------------------
+//  Scenes Management on the bridged lights, the scenes are stored on the Zigbee nodes
+// -----------------------------------------------------------------------------------------
+static Status ZcbSceneStatus(teZcbStatus eStatus)
+{
+	switch (eStatus)
+	{
+		case E_ZCB_OK:                   return Status::Success;
+		case E_ZCB_NOT_FOUND:            return Status::NotFound;
+		case E_ZCB_INSUFFICIENT_SPACE:   return Status::ResourceExhausted;
+		case E_ZCB_UNKNOWN_CLUSTER:      return Status::UnsupportedCluster;
+		case E_ZCB_INVALID_FIELD:        return Status::ConstraintError;
+		case E_ZCB_REQUEST_NOT_ACTIONED: return Status::Busy;
+		default:                         return Status::Failure;
+	}
+}
+
+void BridgedScenesHandler::InvokeCommand(HandlerContext & ctx)
+{
+	using namespace ScenesManagement::Commands;
+
+	EndpointId ep = ctx.mRequestPath.mEndpointId;
+	// a Matter group command reaches every endpoint of the group, its recall goes out once
+	bool groupcast = (ctx.mCommandHandler.GetSubjectDescriptor().authMode == Access::AuthMode::kGroup);
+
+	switch (ctx.mRequestPath.mCommandId)
+	{
+	case StoreScene::Id:
+		HandleCommand<StoreScene::DecodableType>(ctx, [ep](HandlerContext & ctx, const StoreScene::DecodableType & req) {
+			StoreSceneResponse::Type rsp;
+			rsp.status  = to_underlying(ZcbSceneStatus(BridgedStoreScene(ep, req.groupID, req.sceneID)));
+			rsp.groupID = req.groupID;
+			rsp.sceneID = req.sceneID;
+			ctx.mCommandHandler.AddResponse(ctx.mRequestPath, rsp);
+		});
+		break;
+	case RecallScene::Id:
+		HandleCommand<RecallScene::DecodableType>(ctx, [ep, groupcast](HandlerContext & ctx, const RecallScene::DecodableType & req) {
+			// the transition time stored with the scene on the node is used
+			ctx.mCommandHandler.AddStatus(ctx.mRequestPath,
+			                              ZcbSceneStatus(BridgedRecallScene(ep, req.groupID, req.sceneID, groupcast)));
+		});
+		break;
+	case RemoveScene::Id:
+		HandleCommand<RemoveScene::DecodableType>(ctx, [ep](HandlerContext & ctx, const RemoveScene::DecodableType & req) {
+			RemoveSceneResponse::Type rsp;
+			rsp.status  = to_underlying(ZcbSceneStatus(BridgedRemoveScene(ep, req.groupID, req.sceneID)));
+			rsp.groupID = req.groupID;
+			rsp.sceneID = req.sceneID;
+			ctx.mCommandHandler.AddResponse(ctx.mRequestPath, rsp);
+		});
+		break;
+	case RemoveAllScenes::Id:
+		HandleCommand<RemoveAllScenes::DecodableType>(ctx, [ep](HandlerContext & ctx, const RemoveAllScenes::DecodableType & req) {
+			RemoveAllScenesResponse::Type rsp;
+			rsp.status  = to_underlying(ZcbSceneStatus(BridgedRemoveAllScenes(ep, req.groupID)));
+			rsp.groupID = req.groupID;
+			ctx.mCommandHandler.AddResponse(ctx.mRequestPath, rsp);
+		});
+		break;
+	case GetSceneMembership::Id:
+		HandleCommand<GetSceneMembership::DecodableType>(ctx, [ep](HandlerContext & ctx, const GetSceneMembership::DecodableType & req) {
+			uint8_t scenes[ZCB_SCENES_MAX];
+			uint8_t count = BridgedSceneMembership(ep, req.groupID, scenes, sizeof(scenes));
+			GetSceneMembershipResponse::Type rsp;
+			rsp.status = to_underlying(Status::Success);
+			rsp.capacity.SetNull(); // shared by all nodes, not known per endpoint
+			rsp.groupID = req.groupID;
+			rsp.sceneList.Emplace(DataModel::List<const uint8_t>(scenes, count));
+			ctx.mCommandHandler.AddResponse(ctx.mRequestPath, rsp);
+		});
+		break;
+	default:
+		break;
+	}
+}
+
+CHIP_ERROR BridgedScenesAttrAccess::Read(const ConcreteReadAttributePath & aPath, AttributeValueEncoder & aEncoder)
+{
+	// the other attributes, and the fixed endpoints, go through the attribute storage
+	if ((aPath.mAttributeId != ScenesManagement::Attributes::FabricSceneInfo::Id)
+	    || (emberAfGetDynamicIndexFromEndpoint(aPath.mEndpointId) >= CHIP_DEVICE_CONFIG_DYNAMIC_ENDPOINT_COUNT))
+	{
+		return CHIP_NO_ERROR;
+	}
+
+	// one table for all fabrics, it is reported to the fabric reading it
+	FabricIndex fabric = aEncoder.AccessingFabricIndex();
+	EndpointId ep      = aPath.mEndpointId;
+	return aEncoder.EncodeList([fabric, ep](const auto & encoder) -> CHIP_ERROR {
+		if (fabric == kUndefinedFabricIndex)
+		{
+			return CHIP_NO_ERROR;
+		}
+		ScenesManagement::Structs::SceneInfoStruct::Type info;
+		info.sceneCount        = BridgedSceneCount(ep);
+		info.currentScene      = 0;
+		info.currentGroup      = 0;
+		info.sceneValid        = false; // the node's state changes without the bridge
+		info.remainingCapacity = u8ZCB_ScenesFree();
+		info.fabricIndex       = fabric;
+		return encoder.Encode(info);
+	});
+}
+
+// -----------------------------------------------------------------------------------------
+//  Groups on the bridged lights, a Matter group is the Zigbee group of the same ID
+// -----------------------------------------------------------------------------------------
+// groups reported by one GetGroupMembership
+static constexpr size_t kGroupMembershipMax = 16;
+
+// a group can only be added once the fabric holds its key
+static bool GroupKeyExists(Credentials::GroupDataProvider * provider, FabricIndex fabric, GroupId group)
+{
+	Credentials::GroupDataProvider::GroupKey entry;
+	Credentials::GroupDataProvider::KeySet keys;
+	bool found = false;
+
+	auto * it = provider->IterateGroupKeys(fabric);
+	if (it == nullptr)
+	{
+		return false;
+	}
+	while (!found && it->Next(entry))
+	{
+		found = (entry.group_id == group) && (provider->GetKeySet(fabric, entry.keyset_id, keys) == CHIP_NO_ERROR);
+	}
+	it->Release();
+	return found;
+}
+
+// the Zigbee group has no fabric, the node stays in it while another fabric uses the same ID
+static bool GroupHeldByOtherFabric(Credentials::GroupDataProvider * provider, FabricIndex fabric, GroupId group, EndpointId ep)
+{
+	for (const FabricInfo & info : Server::GetInstance().GetFabricTable())
+	{
+		if ((info.GetFabricIndex() != fabric) && provider->HasEndpoint(info.GetFabricIndex(), group, ep))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+static Status GroupAddToEndpoint(FabricIndex fabric, EndpointId ep, GroupId group, const CharSpan & name)
+{
+	Credentials::GroupDataProvider * provider = Credentials::GetGroupDataProvider();
+
+	VerifyOrReturnValue(IsValidGroupId(group), Status::ConstraintError);
+	VerifyOrReturnValue(name.size() <= Credentials::GroupDataProvider::GroupInfo::kGroupNameMax, Status::ConstraintError);
+	VerifyOrReturnValue(provider != nullptr, Status::Failure);
+	VerifyOrReturnValue(GroupKeyExists(provider, fabric, group), Status::UnsupportedAccess);
+
+	// the node joins first, the group commands of Matter are sent to the Zigbee group
+	bool member   = provider->HasEndpoint(fabric, group, ep);
+	Status status = ZcbSceneStatus(BridgedAddGroup(ep, group));
+	VerifyOrReturnValue(status == Status::Success, status);
+
+	CHIP_ERROR err = provider->SetGroupInfo(fabric, Credentials::GroupDataProvider::GroupInfo(group, name));
+	if (err == CHIP_NO_ERROR)
+	{
+		err = provider->AddEndpoint(fabric, group, ep);
+	}
+	if (err != CHIP_NO_ERROR)
+	{
+		// leave the node as it was
+		if (!member && !GroupHeldByOtherFabric(provider, fabric, group, ep))
+		{
+			BridgedRemoveGroup(ep, group);
+		}
+		return (err == CHIP_ERROR_NO_MEMORY) ? Status::ResourceExhausted : Status::Failure;
+	}
+	MatterReportingAttributeChangeCallback(kRootEndpointId, GroupKeyManagement::Id, GroupKeyManagement::Attributes::GroupTable::Id);
+	return Status::Success;
+}
+
+static Status GroupRemoveFromEndpoint(FabricIndex fabric, EndpointId ep, GroupId group)
+{
+	Credentials::GroupDataProvider * provider = Credentials::GetGroupDataProvider();
+
+	VerifyOrReturnValue(IsValidGroupId(group), Status::ConstraintError);
+	VerifyOrReturnValue(provider != nullptr, Status::Failure);
+	VerifyOrReturnValue(provider->HasEndpoint(fabric, group, ep), Status::NotFound);
+
+	if (!GroupHeldByOtherFabric(provider, fabric, group, ep))
+	{
+		Status status = ZcbSceneStatus(BridgedRemoveGroup(ep, group));
+		VerifyOrReturnValue(status == Status::Success, status);
+	}
+	VerifyOrReturnValue(provider->RemoveEndpoint(fabric, group, ep) == CHIP_NO_ERROR, Status::Failure);
+	MatterReportingAttributeChangeCallback(kRootEndpointId, GroupKeyManagement::Id, GroupKeyManagement::Attributes::GroupTable::Id);
+	return Status::Success;
+}
+
+// groups of the fabric the endpoint is in, returns how many were written
+static size_t GroupListOfEndpoint(FabricIndex fabric, EndpointId ep, GroupId * groups, size_t max)
+{
+	Credentials::GroupDataProvider * provider = Credentials::GetGroupDataProvider();
+	Credentials::GroupDataProvider::GroupEndpoint mapping;
+	size_t count = 0;
+
+	auto * it = (provider != nullptr) ? provider->IterateEndpoints(fabric) : nullptr;
+	if (it == nullptr)
+	{
+		return 0;
+	}
+	while ((count < max) && it->Next(mapping))
+	{
+		if (mapping.endpoint_id == ep)
+		{
+			groups[count++] = mapping.group_id;
+		}
+	}
+	it->Release();
+	return count;
+}
+
+void BridgedGroupsHandler::InvokeCommand(HandlerContext & ctx)
+{
+	using namespace Groups::Commands;
+
+	EndpointId ep      = ctx.mRequestPath.mEndpointId;
+	FabricIndex fabric = ctx.mCommandHandler.GetAccessingFabricIndex();
+
+	switch (ctx.mRequestPath.mCommandId)
+	{
+	case AddGroup::Id:
+		HandleCommand<AddGroup::DecodableType>(ctx, [ep, fabric](HandlerContext & ctx, const AddGroup::DecodableType & req) {
+			AddGroupResponse::Type rsp;
+			rsp.status  = to_underlying(GroupAddToEndpoint(fabric, ep, req.groupID, req.groupName));
+			rsp.groupID = req.groupID;
+			ctx.mCommandHandler.AddResponse(ctx.mRequestPath, rsp);
+		});
+		break;
+	case ViewGroup::Id:
+		HandleCommand<ViewGroup::DecodableType>(ctx, [ep, fabric](HandlerContext & ctx, const ViewGroup::DecodableType & req) {
+			Credentials::GroupDataProvider * provider = Credentials::GetGroupDataProvider();
+			Credentials::GroupDataProvider::GroupInfo info;
+			ViewGroupResponse::Type rsp;
+			rsp.groupID = req.groupID;
+			rsp.status  = to_underlying(Status::NotFound);
+			if (!IsValidGroupId(req.groupID))
+			{
+				rsp.status = to_underlying(Status::ConstraintError);
+			}
+			else if ((provider != nullptr) && provider->HasEndpoint(fabric, req.groupID, ep)
+			         && (provider->GetGroupInfo(fabric, req.groupID, info) == CHIP_NO_ERROR))
+			{
+				rsp.status    = to_underlying(Status::Success);
+				rsp.groupName = CharSpan(info.name, strnlen(info.name, Credentials::GroupDataProvider::GroupInfo::kGroupNameMax));
+			}
+			ctx.mCommandHandler.AddResponse(ctx.mRequestPath, rsp);
+		});
+		break;
+	case GetGroupMembership::Id:
+		HandleCommand<GetGroupMembership::DecodableType>(ctx, [ep, fabric](HandlerContext & ctx, const GetGroupMembership::DecodableType & req) {
+			GroupId all[kGroupMembershipMax];
+			GroupId groups[kGroupMembershipMax];
+			size_t total = GroupListOfEndpoint(fabric, ep, all, kGroupMembershipMax);
+			size_t count = 0;
+			size_t asked = 0;
+			if (req.groupList.ComputeSize(&asked) != CHIP_NO_ERROR)
+			{
+				ctx.mCommandHandler.AddStatus(ctx.mRequestPath, Status::InvalidCommand);
+				return;
+			}
+			// an empty list asks for every group of the endpoint
+			for (size_t i = 0; i < total; i++)
+			{
+				bool wanted = (asked == 0);
+				auto it     = req.groupList.begin();
+				while (!wanted && it.Next())
+				{
+					wanted = (it.GetValue() == all[i]);
+				}
+				if (wanted)
+				{
+					groups[count++] = all[i];
+				}
+			}
+			GetGroupMembershipResponse::Type rsp;
+			rsp.capacity.SetNull(); // shared by all endpoints of the fabric
+			rsp.groupList = DataModel::List<const GroupId>(groups, count);
+			ctx.mCommandHandler.AddResponse(ctx.mRequestPath, rsp);
+		});
+		break;
+	case RemoveGroup::Id:
+		HandleCommand<RemoveGroup::DecodableType>(ctx, [ep, fabric](HandlerContext & ctx, const RemoveGroup::DecodableType & req) {
+			RemoveGroupResponse::Type rsp;
+			rsp.status  = to_underlying(GroupRemoveFromEndpoint(fabric, ep, req.groupID));
+			rsp.groupID = req.groupID;
+			ctx.mCommandHandler.AddResponse(ctx.mRequestPath, rsp);
+		});
+		break;
+	case RemoveAllGroups::Id:
+		HandleCommand<RemoveAllGroups::DecodableType>(ctx, [ep, fabric](HandlerContext & ctx, const RemoveAllGroups::DecodableType &) {
+			// one group at a time, a Zigbee Remove All would take the groups of the other fabrics too
+			GroupId groups[kGroupMembershipMax];
+			size_t count  = GroupListOfEndpoint(fabric, ep, groups, kGroupMembershipMax);
+			Status status = Status::Success;
+			for (size_t i = 0; i < count; i++)
+			{
+				Status one = GroupRemoveFromEndpoint(fabric, ep, groups[i]);
+				if (one != Status::Success)
+				{
+					status = one;
+				}
+			}
+			ctx.mCommandHandler.AddStatus(ctx.mRequestPath, status);
+		});
+		break;
+	case AddGroupIfIdentifying::Id:
+		HandleCommand<AddGroupIfIdentifying::DecodableType>(ctx, [](HandlerContext & ctx, const AddGroupIfIdentifying::DecodableType &) {
+			// the bridged endpoints have no Identify cluster, they are never identifying
+			ctx.mCommandHandler.AddStatus(ctx.mRequestPath, Status::Success);
+		});
+		break;
+	default:
+		break;
+	}
+}
+
 CHIP_ERROR MatterPreCommandReceivedCallback(const chip::app::ConcreteCommandPath & commandPath,const chip::Access::SubjectDescriptor & subjectDescriptor,const chip::TLV::TLVReader & commandDataReader)
 {
 	CHIP_ERROR err = CHIP_NO_ERROR;
@@ -23,6 +23,7 @@
 #include <platform/CHIPDeviceLayer.h>
 
 #include "zcb.h"
+#include "ZcbIasZone.h"
 
 using namespace chip::app::Clusters::Actions;
 
@@ -270,6 +271,45 @@ void DeviceTempSensor::HandleDeviceChange(Device * device, Device::Changed_t cha
     }
 }
 
+DeviceIasZone::DeviceIasZone(const char * szDeviceName, std::string szLocation, bool isOccupancy) :
+    Device(szDeviceName, szLocation), mIsOccupancy(isOccupancy), mZoneStatus(0)
+{}
+
+bool DeviceIasZone::GetState()
+{
+    bool alarm = (mZoneStatus & (ZCB_IAS_ZONE_STATUS_ALARM1 | ZCB_IAS_ZONE_STATUS_ALARM2)) != 0;
+
+    // A contact sensor reads TRUE while closed, the Zigbee zone alarms when opened
+    return mIsOccupancy ? alarm : !alarm;
+}
+
+void DeviceIasZone::SetZoneStatus(uint16_t zoneStatus)
+{
+    bool previous = GetState();
+
+    ChipLogProgress(DeviceLayer, "IasZoneDevice[%s]: New zone status=0x%04x", mName, zoneStatus);
+
+    mZoneStatus = zoneStatus;
+
+    if ((GetState() != previous) && mChanged_CB)
+    {
+        mChanged_CB(this, kChanged_ZoneStatus);
+    }
+}
+
+void DeviceIasZone::SetChangeCallback(DeviceCallback_fn aChanged_CB)
+{
+    mChanged_CB = aChanged_CB;
+}
+
+void DeviceIasZone::HandleDeviceChange(Device * device, Device::Changed_t changeMask)
+{
+    if (mChanged_CB)
+    {
+        mChanged_CB(this, (DeviceIasZone::Changed_t) changeMask);
+    }
+}
+
 void ComposedDevice::HandleDeviceChange(Device * device, Device::Changed_t changeMask)
 {
     if (mChanged_CB)
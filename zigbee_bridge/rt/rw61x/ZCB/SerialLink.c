@@ -20,6 +20,7 @@
 #include "fsl_debug_console.h"
 
 #include <stdbool.h>
+#include <string.h>
 
 #include "serial.h"
 #include "SerialLink.h"
@@ -66,10 +67,46 @@ typedef struct _tsSL_CallbackEntry
     uint16_t                u16Type;        /**< Message type for this callback */
     tprSL_MessageCallback   prCallback;     /**< User supplied callback function for this message type */
     void                    *pvUser;        /**< User supplied data for the callback function */
+    bool                    bPriority;      /**< Run on the read task, not queued */
     struct _tsSL_CallbackEntry *psNext;     /**< Pointer to next in linked list */
 } tsSL_CallbackEntry;
 
 
+struct _tsCallbackTaskData;
+
+/** States of a request sent with eSL_SendRequest */
+typedef enum
+{
+    E_SL_REQUEST_FREE,
+    E_SL_REQUEST_WAIT_STATUS,
+    E_SL_REQUEST_WAIT_RESPONSE,
+    E_SL_REQUEST_DONE,
+} teSL_RequestState;
+
+/* A request handle is the entry index in the low bits and the generation of
+ * the entry above them, so a stale handle cannot cancel a later request of
+ * the same entry. The last generation is left out, it would give 0xFF. */
+#define SL_REQUEST_INDEX_BITS               4
+#define SL_REQUEST_INDEX_MASK               ((1 << SL_REQUEST_INDEX_BITS) - 1)
+#define SL_REQUEST_GENERATIONS              ((0x100 >> SL_REQUEST_INDEX_BITS) - 1)
+
+typedef char acSL_RequestsFitHandle[(SL_MAX_PENDING_REQUESTS <= (1 << SL_REQUEST_INDEX_BITS)) ? 1 : -1];
+
+/** A request awaiting its status or response */
+typedef struct
+{
+    teSL_RequestState       eState;
+    teSL_Status             eStatus;        /**< Result once done */
+    uint32_t                u32Order;       /**< Send order, statuses come back in it */
+    uint8_t                 u8Generation;   /**< Upper bits of the handle */
+    uint8_t                 u8SequenceNo;   /**< Given by the status, carried by the response */
+    bool                    bCancelled;     /**< Kept only to take its status */
+    TickType_t              xDeadline;
+    tsSL_Request            sRequest;       /**< pvMessage is not kept */
+    struct _tsCallbackTaskData *psDone;     /**< Completion not yet queued to the callback task */
+} tsSL_PendingRequest;
+
+
 /** Structure used to contain a message */
 typedef struct
 {
@@ -91,6 +128,7 @@ typedef struct
     } sCallbacks;
     
     QueueHandle_t sCallbackQueue;	
+    tprSL_IdleCallback prIdle;
     
     // Array of listeners for messages
     // eSL_MessageWait uses this array to wait on incoming messages.
@@ -105,11 +143,23 @@ typedef struct
 
     } asReaderMessageQueue[SL_MAX_MESSAGE_QUEUES];
 
+    /* Requests completed on the callback task instead of a blocked caller */
+    struct
+    {
+        SemaphoreHandle_t       mutex;
+        uint32_t                u32NextOrder;
+        tsSL_PendingRequest     asEntries[SL_MAX_PENDING_REQUESTS];
+    } sRequests;
+
+    /* Link health, read by the coordinator watchdog */
+    volatile TickType_t      xLastRxTick;
+    volatile uint8_t         u8StatusTimeoutStreak;
+
 } tsSerialLink;
 
 
 /** Structure allocated and passed to callback handler thread */
-typedef struct
+typedef struct _tsCallbackTaskData
 {
     tsSL_Message            sMessage;       /** The received message */ 
     tprSL_MessageCallback   prCallback;     /**< User supplied callback function for this message type */
@@ -131,6 +181,9 @@ static teSL_Status eSL_ReadMessage(uint16_t *pu16Type, uint16_t *pu16Length, uin
 static void serialReadTask(void * pvParameters);
 static void serialCallbackTask(void * pvParameters);
 
+static bool bSL_RequestStatus(tsSerialLink *psSerialLink, uint16_t u16Length, uint8_t *pu8Message);
+static bool bSL_RequestResponse(tsSerialLink *psSerialLink, uint16_t u16Type, uint16_t u16Length, uint8_t *pu8Message);
+
 
 /*******************************************************************************
  * Variables
@@ -161,9 +214,17 @@ teSL_Status eSL_Init(void)
         sSerialLink.asReaderMessageQueue[i].eventGroup = xEventGroupCreate();
     }
         
+    /* Initialise pending requests */
+    sSerialLink.sRequests.mutex = xSemaphoreCreateMutex();
+    sSerialLink.sRequests.u32NextOrder = 0;
+    memset(sSerialLink.sRequests.asEntries, 0, sizeof(sSerialLink.sRequests.asEntries));
+
     /* Initialise callback queue */
     sSerialLink.sCallbackQueue = xQueueCreate(SL_MAX_CALLBACK_QUEUES, sizeof(tsCallbackTaskData *));
 
+    sSerialLink.xLastRxTick = xTaskGetTickCount();
+    sSerialLink.u8StatusTimeoutStreak = 0;
+
     /* Start the serial reader task */
     if(pdPASS != xTaskCreate((void *)serialReadTask,
                             "serialReadTask",
@@ -216,7 +277,11 @@ teSL_Status eSL_SendMessage(uint16_t u16Type, uint16_t u16Length, void *pvMessag
         eStatus = eSL_MessageWait(E_SL_MSG_STATUS, 500, &u16Length, (void**)&psStatus);
 		
 		if (eStatus)
+		{
 			PRINTF("\n !!! eSL_MessageWait = %d",eStatus);
+			if (sSerialLink.u8StatusTimeoutStreak < 0xFF)
+				sSerialLink.u8StatusTimeoutStreak++;
+		}
 		
         if (eStatus == E_SL_OK)
         {           
@@ -254,6 +319,296 @@ teSL_Status eSL_SendMessageNoWait(uint16_t u16Type, uint16_t u16Length, void *pv
 }
 
 
+uint32_t u32SL_GetLastRxTick(void)
+{
+    return (uint32_t)sSerialLink.xLastRxTick;
+}
+
+
+uint8_t u8SL_GetStatusTimeoutStreak(void)
+{
+    return sSerialLink.u8StatusTimeoutStreak;
+}
+
+
+
+/* Runs on the callback task: release the entry, then hand over the result */
+static void vSL_RequestDeliver(void *pvUser, uint16_t u16Length, void *pvMessage)
+{
+    tsSL_PendingRequest *psEntry = (tsSL_PendingRequest *)pvUser;
+    tprSL_RequestCallback prCallback;
+    void *pvCallbackUser;
+    teSL_Status eStatus;
+
+    xSemaphoreTake(sSerialLink.sRequests.mutex, portMAX_DELAY);
+    prCallback     = psEntry->sRequest.prCallback;
+    pvCallbackUser = psEntry->sRequest.pvUser;
+    eStatus        = psEntry->eStatus;
+    psEntry->eState = E_SL_REQUEST_FREE;
+    xSemaphoreGive(sSerialLink.sRequests.mutex);
+
+    if (prCallback != NULL)
+    {
+        prCallback(pvCallbackUser, eStatus, u16Length, pvMessage);
+    }
+}
+
+
+/* Called with the request mutex held */
+static void vSL_RequestComplete(tsSL_PendingRequest *psEntry, teSL_Status eStatus, uint16_t u16Length, const uint8_t *pu8Message)
+{
+    tsCallbackTaskData *psCallbackData;
+
+    psCallbackData = pvPortMalloc(sizeof(tsCallbackTaskData));
+    assert(psCallbackData != NULL);
+
+    if (u16Length > SL_MAX_MESSAGE_LENGTH)
+    {
+        u16Length = SL_MAX_MESSAGE_LENGTH;
+    }
+    psCallbackData->sMessage.u16Type   = psEntry->sRequest.u16ResponseType;
+    psCallbackData->sMessage.u16Length = u16Length;
+    if (u16Length)
+    {
+        memcpy(psCallbackData->sMessage.au8Message, pu8Message, u16Length);
+    }
+    psCallbackData->prCallback = vSL_RequestDeliver;
+    psCallbackData->pvUser     = psEntry;
+
+    psEntry->eState  = E_SL_REQUEST_DONE;
+    psEntry->eStatus = eStatus;
+    psEntry->psDone  = psCallbackData;
+
+    /* A full callback queue is retried from vSL_RequestPoll */
+    if (pdPASS == xQueueSend(sSerialLink.sCallbackQueue, &psCallbackData, 0))
+    {
+        psEntry->psDone = NULL;
+    }
+}
+
+
+/* A status nobody waits for synchronously goes to the oldest request of that
+ * type. The status carries no reference to the request, only the sequence
+ * number the coordinator gave it, which the response is then matched on. */
+static bool bSL_RequestStatus(tsSerialLink *psSerialLink, uint16_t u16Length, uint8_t *pu8Message)
+{
+    tsSL_Msg_Status *psRxStatus = (tsSL_Msg_Status *)pu8Message;
+    tsSL_PendingRequest *psOldest = NULL;
+    tsSL_PendingRequest *psEntry;
+
+    if (u16Length < sizeof(tsSL_Msg_Status))
+    {
+        return false;
+    }
+
+    xSemaphoreTake(psSerialLink->sRequests.mutex, portMAX_DELAY);
+    for (uint8_t i = 0; i < SL_MAX_PENDING_REQUESTS; i++)
+    {
+        psEntry = &psSerialLink->sRequests.asEntries[i];
+        if ((psEntry->eState == E_SL_REQUEST_WAIT_STATUS)
+            && (psEntry->sRequest.u16Type == pri_ntohs(psRxStatus->u16MessageType))
+            && ((psOldest == NULL) || ((int32_t)(psEntry->u32Order - psOldest->u32Order) < 0)))
+        {
+            psOldest = psEntry;
+        }
+    }
+
+    if (psOldest != NULL)
+    {
+        if (psOldest->bCancelled)
+        {
+            psOldest->eState = E_SL_REQUEST_FREE;
+        }
+        else if (psRxStatus->eStatus != E_SL_MSG_STATUS_SUCCESS)
+        {
+            vSL_RequestComplete(psOldest, (teSL_Status)psRxStatus->eStatus, u16Length, pu8Message);
+        }
+        else if (psOldest->sRequest.u16ResponseType == 0)
+        {
+            vSL_RequestComplete(psOldest, E_SL_OK, u16Length, pu8Message);
+        }
+        else
+        {
+            psOldest->u8SequenceNo = psRxStatus->u8SequenceNo;
+            psOldest->eState = E_SL_REQUEST_WAIT_RESPONSE;
+        }
+    }
+    xSemaphoreGive(psSerialLink->sRequests.mutex);
+
+    return (psOldest != NULL);
+}
+
+
+/* A response completes the oldest request it matches */
+static bool bSL_RequestResponse(tsSerialLink *psSerialLink, uint16_t u16Type, uint16_t u16Length, uint8_t *pu8Message)
+{
+    tsSL_PendingRequest *psOldest = NULL;
+    tsSL_PendingRequest *psEntry;
+
+    xSemaphoreTake(psSerialLink->sRequests.mutex, portMAX_DELAY);
+    for (uint8_t i = 0; i < SL_MAX_PENDING_REQUESTS; i++)
+    {
+        psEntry = &psSerialLink->sRequests.asEntries[i];
+        if ((psEntry->eState == E_SL_REQUEST_WAIT_RESPONSE)
+            && (psEntry->sRequest.u16ResponseType == u16Type)
+            && ((psOldest == NULL) || ((int32_t)(psEntry->u32Order - psOldest->u32Order) < 0))
+            && (!psEntry->sRequest.bMatchSequenceNo
+                || ((u16Length > 0) && (pu8Message[0] == psEntry->u8SequenceNo)))
+            && ((psEntry->sRequest.prMatch == NULL)
+                || psEntry->sRequest.prMatch(psEntry->sRequest.u32MatchKey, u16Length, pu8Message)))
+        {
+            psOldest = psEntry;
+        }
+    }
+
+    if (psOldest != NULL)
+    {
+        vSL_RequestComplete(psOldest, E_SL_OK, u16Length, pu8Message);
+    }
+    xSemaphoreGive(psSerialLink->sRequests.mutex);
+
+    return (psOldest != NULL);
+}
+
+
+teSL_Status eSL_SendRequest(const tsSL_Request *psRequest, uint8_t *pu8Handle)
+{
+    tsSL_PendingRequest *psEntry = NULL;
+    teSL_Status eStatus;
+    uint8_t u8Handle = SL_REQUEST_HANDLE_NONE;
+    uint8_t i;
+
+    if ((psRequest == NULL) || (sSerialLink.sRequests.mutex == NULL))
+    {
+        return E_SL_ERROR;
+    }
+
+    /* The entry exists before the message leaves, so no answer can be missed */
+    xSemaphoreTake(sSerialLink.sRequests.mutex, portMAX_DELAY);
+    for (i = 0; i < SL_MAX_PENDING_REQUESTS; i++)
+    {
+        if (sSerialLink.sRequests.asEntries[i].eState == E_SL_REQUEST_FREE)
+        {
+            psEntry = &sSerialLink.sRequests.asEntries[i];
+            psEntry->eState    = E_SL_REQUEST_WAIT_STATUS;
+            psEntry->u32Order  = sSerialLink.sRequests.u32NextOrder++;
+            psEntry->xDeadline = xTaskGetTickCount() + pdMS_TO_TICKS(psRequest->u32Timeout);
+            psEntry->sRequest  = *psRequest;
+            psEntry->sRequest.pvMessage = NULL;
+            psEntry->psDone    = NULL;
+            psEntry->bCancelled = false;
+            psEntry->u8Generation = (uint8_t)((psEntry->u8Generation + 1) % SL_REQUEST_GENERATIONS);
+            u8Handle = (uint8_t)((psEntry->u8Generation << SL_REQUEST_INDEX_BITS) | i);
+            break;
+        }
+    }
+    xSemaphoreGive(sSerialLink.sRequests.mutex);
+
+    if (psEntry == NULL)
+    {
+        return E_SL_ERROR_NOMEM;
+    }
+
+    xSemaphoreTake(sSerialLink.txMessageMutex, portMAX_DELAY);
+    eStatus = eSL_WriteMessage(psRequest->u16Type, psRequest->u16Length, (uint8_t *)psRequest->pvMessage);
+    xSemaphoreGive(sSerialLink.txMessageMutex);
+
+    if (eStatus != E_SL_OK)
+    {
+        xSemaphoreTake(sSerialLink.sRequests.mutex, portMAX_DELAY);
+        psEntry->eState = E_SL_REQUEST_FREE;
+        xSemaphoreGive(sSerialLink.sRequests.mutex);
+        return eStatus;
+    }
+
+    if (pu8Handle != NULL)
+    {
+        *pu8Handle = u8Handle;
+    }
+    return E_SL_OK;
+}
+
+
+void vSL_CancelRequest(uint8_t u8Handle)
+{
+    tsSL_PendingRequest *psEntry;
+    uint8_t u8Index = u8Handle & SL_REQUEST_INDEX_MASK;
+
+    if ((u8Handle == SL_REQUEST_HANDLE_NONE) || (u8Index >= SL_MAX_PENDING_REQUESTS)
+        || (sSerialLink.sRequests.mutex == NULL))
+    {
+        return;
+    }
+
+    xSemaphoreTake(sSerialLink.sRequests.mutex, portMAX_DELAY);
+    psEntry = &sSerialLink.sRequests.asEntries[u8Index];
+    if ((psEntry->eState == E_SL_REQUEST_FREE)
+        || (psEntry->u8Generation != (u8Handle >> SL_REQUEST_INDEX_BITS)))
+    {
+        /* Completed already, the entry may be another request by now */
+    }
+    else if (psEntry->eState == E_SL_REQUEST_DONE)
+    {
+        /* Already on its way to the callback task, which releases it */
+        psEntry->sRequest.prCallback = NULL;
+    }
+    else if (psEntry->eState == E_SL_REQUEST_WAIT_STATUS)
+    {
+        /* Its status is still to come, and would go to the next request of the type */
+        psEntry->sRequest.prCallback = NULL;
+        psEntry->bCancelled = true;
+    }
+    else
+    {
+        psEntry->eState = E_SL_REQUEST_FREE;
+    }
+    xSemaphoreGive(sSerialLink.sRequests.mutex);
+}
+
+
+void vSL_RequestPoll(void)
+{
+    tsSL_PendingRequest *psEntry;
+    TickType_t xNow = xTaskGetTickCount();
+
+    if (sSerialLink.sRequests.mutex == NULL)
+    {
+        return;
+    }
+
+    xSemaphoreTake(sSerialLink.sRequests.mutex, portMAX_DELAY);
+    for (uint8_t i = 0; i < SL_MAX_PENDING_REQUESTS; i++)
+    {
+        psEntry = &sSerialLink.sRequests.asEntries[i];
+        if (((psEntry->eState == E_SL_REQUEST_WAIT_STATUS) || (psEntry->eState == E_SL_REQUEST_WAIT_RESPONSE))
+            && ((int32_t)(xNow - psEntry->xDeadline) >= 0))
+        {
+            if (psEntry->eState == E_SL_REQUEST_WAIT_STATUS)
+            {
+                if (sSerialLink.u8StatusTimeoutStreak < 0xFF)
+                    sSerialLink.u8StatusTimeoutStreak++;
+            }
+            if (psEntry->bCancelled)
+            {
+                psEntry->eState = E_SL_REQUEST_FREE;
+            }
+            else
+            {
+                vSL_RequestComplete(psEntry, E_SL_NOMESSAGE, 0, NULL);
+            }
+        }
+        else if ((psEntry->eState == E_SL_REQUEST_DONE) && (psEntry->psDone != NULL))
+        {
+            if (pdPASS == xQueueSend(sSerialLink.sCallbackQueue, &psEntry->psDone, 0))
+            {
+                psEntry->psDone = NULL;
+            }
+        }
+    }
+    xSemaphoreGive(sSerialLink.sRequests.mutex);
+}
+
+
 
 teSL_Status eSL_MessageWait(uint16_t u16Type, uint32_t u32WaitTimeout, uint16_t *pu16Length, void **ppvMessage)
 {
@@ -425,7 +780,7 @@ static teSL_Status eSL_ReadMessage(uint16_t *pu16Type, uint16_t *pu16Length, uin
 
 
 
-teSL_Status eSL_AddListener(uint16_t u16Type, tprSL_MessageCallback prCallback, void *pvUser)
+static teSL_Status eSL_AddCallbackEntry(uint16_t u16Type, tprSL_MessageCallback prCallback, void *pvUser, bool bPriority)
 {
     tsSL_CallbackEntry *psCurrentEntry;
     tsSL_CallbackEntry *psNewEntry;
@@ -439,10 +794,17 @@ teSL_Status eSL_AddListener(uint16_t u16Type, tprSL_MessageCallback prCallback,
     psNewEntry->u16Type     = u16Type;
     psNewEntry->prCallback  = prCallback;
     psNewEntry->pvUser      = pvUser;
+    psNewEntry->bPriority   = bPriority;
     psNewEntry->psNext      = NULL;
     
     xSemaphoreTake(sSerialLink.sCallbacks.mutex, portMAX_DELAY);
-    if (sSerialLink.sCallbacks.psListHead == NULL)
+    if (bPriority)
+    {
+        /* Priority listeners first, ahead of the queued one of the same type */
+        psNewEntry->psNext = sSerialLink.sCallbacks.psListHead;
+        sSerialLink.sCallbacks.psListHead = psNewEntry;
+    }
+    else if (sSerialLink.sCallbacks.psListHead == NULL)
     {
         /* Insert at start of list */
         sSerialLink.sCallbacks.psListHead = psNewEntry;
@@ -464,6 +826,26 @@ teSL_Status eSL_AddListener(uint16_t u16Type, tprSL_MessageCallback prCallback,
 
 
 
+teSL_Status eSL_AddListener(uint16_t u16Type, tprSL_MessageCallback prCallback, void *pvUser)
+{
+    return eSL_AddCallbackEntry(u16Type, prCallback, pvUser, false);
+}
+
+
+
+teSL_Status eSL_AddPriorityListener(uint16_t u16Type, tprSL_MessageCallback prCallback, void *pvUser)
+{
+    return eSL_AddCallbackEntry(u16Type, prCallback, pvUser, true);
+}
+
+
+void vSL_SetIdleCallback(tprSL_IdleCallback prIdle)
+{
+    sSerialLink.prIdle = prIdle;
+}
+
+
+
 teSL_Status eSL_WriteMessage(uint16_t u16Type, uint16_t u16Length, uint8_t *pu8Data)
 {
     uint8_t n;
@@ -573,7 +955,6 @@ static teSL_Status eSL_MessageQueue(tsSerialLink *psSerialLink, uint16_t u16Type
                 //    LOG(ZBSERIAL, INFO, "Status listener for message type 0x%04X, rx 0x%04X\r\n", psWaitStatus->u16MessageType, pri_ntohs(psRxStatus->u16MessageType));                                        
                     if (psWaitStatus->u16MessageType != pri_ntohs(psRxStatus->u16MessageType))
                     {
-                        psSerialLink->asReaderMessageQueue[i].u16Type = 0;
                         taskEXIT_CRITICAL();
     //                    LOG(ZBSERIAL, ERR, "Not the status listener for this Msg\r\n");
 
@@ -622,6 +1003,10 @@ static void serialReadTask(void * pvParameters)
         
        	if (eSL_ReadMessage(&sMessage.u16Type, &sMessage.u16Length, SL_MAX_MESSAGE_LENGTH, sMessage.au8Message) == E_SL_OK)
     	{	
+            /* Any valid frame shows the coordinator is alive */
+            psSerialLink->xLastRxTick = xTaskGetTickCount();
+            psSerialLink->u8StatusTimeoutStreak = 0;
+
       //      LOG(ZBSERIAL, INFO, "Receive Msg = 0x%x, Len = %d\r\n", sMessage.u16Type, sMessage.u16Length);
     		if (sMessage.u16Type == E_SL_MSG_LOG)
         	{
@@ -634,6 +1019,11 @@ static void serialReadTask(void * pvParameters)
                 {
                     iHandled = 1;
                 }
+                else if ((sMessage.u16Type == E_SL_MSG_STATUS)
+                         && bSL_RequestStatus(psSerialLink, sMessage.u16Length, sMessage.au8Message))
+                {
+                    iHandled = 1;
+                }
                 else if (eStatus == E_SL_NOMESSAGE)
                 {
                   ;//  LOG(ZBSERIAL, INFO, "No listener waiting for message type 0x%04X\r\n", sMessage.u16Type);
@@ -644,6 +1034,12 @@ static void serialReadTask(void * pvParameters)
                 }				
 			}
 
+            if ((sMessage.u16Type != E_SL_MSG_STATUS)
+                && bSL_RequestResponse(psSerialLink, sMessage.u16Type, sMessage.u16Length, sMessage.au8Message))
+            {
+                iHandled = 1;
+            }
+
             if ((sMessage.u16Type != E_SL_MSG_NODE_CLUSTER_LIST) 
                 && (sMessage.u16Type != E_SL_MSG_NODE_ATTRIBUTE_LIST)
                 && (sMessage.u16Type != E_SL_MSG_NODE_COMMAND_ID_LIST))
@@ -655,7 +1051,14 @@ static void serialReadTask(void * pvParameters)
             
             	for (psCurrentEntry = psSerialLink->sCallbacks.psListHead; psCurrentEntry; psCurrentEntry = psCurrentEntry->psNext)
             	{
-                	if (psCurrentEntry->u16Type == sMessage.u16Type)
+                	if ((psCurrentEntry->u16Type == sMessage.u16Type) && psCurrentEntry->bPriority)
+                	{
+                    	/* Not queued behind reports and logs; a queued listener
+                    	 * of the same type still gets the frame afterwards */
+                    	psCurrentEntry->prCallback(psCurrentEntry->pvUser, sMessage.u16Length, sMessage.au8Message);
+                    	iHandled = 1;
+                	}
+                	else if (psCurrentEntry->u16Type == sMessage.u16Type)
                 	{
                    		tsCallbackTaskData *psCallbackData;
                     	
@@ -702,6 +1105,9 @@ static void serialCallbackTask(void * pvParameters)
         if (pdPASS == xQueueReceive(psSerialLink->sCallbackQueue, &psCallbackData, portMAX_DELAY)) {
             psCallbackData->prCallback(psCallbackData->pvUser, psCallbackData->sMessage.u16Length, psCallbackData->sMessage.au8Message);
             vPortFree(psCallbackData);
+            if ((psSerialLink->prIdle != NULL) && (uxQueueMessagesWaiting(psSerialLink->sCallbackQueue) == 0)) {
+                psSerialLink->prIdle();
+            }
         }
     }
 }
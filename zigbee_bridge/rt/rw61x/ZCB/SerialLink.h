@@ -229,6 +229,7 @@ typedef enum
 
     /* IAS Cluster */
     E_SL_MSG_SEND_IAS_ZONE_ENROLL_RSP			=	   0x0400,
+    E_SL_MSG_IAS_ZONE_ENROLL_REQUEST			=	   0x8400,
     E_SL_MSG_IAS_ZONE_STATUS_CHANGE_NOTIFY		=	   0x8401,
 
     /* OTA Cluster */
@@ -263,6 +264,36 @@ typedef struct
 
 typedef void (*tprSL_MessageCallback)(void *pvUser, uint16_t u16Length, void *pvMessage);
 
+/** Run on the callback task each time it has emptied its queue */
+typedef void (*tprSL_IdleCallback)(void);
+
+
+/* Requests awaiting their status or response at the same time */
+#define SL_MAX_PENDING_REQUESTS             16
+#define SL_REQUEST_HANDLE_NONE              0xFF
+
+/** True when a response, still in network byte order, answers the request */
+typedef bool (*tprSL_ResponseMatch)(uint32_t u32MatchKey, uint16_t u16Length, const void *pvMessage);
+
+/** Completion of a request, run on the callback task. The message is the
+ *  response, or the status when no response was asked for; it is only
+ *  valid during the call. eStatus is E_SL_NOMESSAGE on timeout. */
+typedef void (*tprSL_RequestCallback)(void *pvUser, teSL_Status eStatus, uint16_t u16Length, void *pvMessage);
+
+typedef struct
+{
+    uint16_t                u16Type;            /**< Message sent */
+    uint16_t                u16Length;
+    void                    *pvMessage;
+    uint16_t                u16ResponseType;    /**< Message completing the request, 0 for the status only */
+    tprSL_ResponseMatch     prMatch;            /**< NULL to take the first response of that type */
+    uint32_t                u32MatchKey;        /**< Passed to prMatch */
+    uint32_t                u32Timeout;         /**< ms from sending to the response */
+    bool                    bMatchSequenceNo;   /**< The response starts with the sequence number of the status */
+    tprSL_RequestCallback   prCallback;
+    void                    *pvUser;
+} tsSL_Request;
+
 
  /*******************************************************************************
  * Prototypes
@@ -270,9 +301,30 @@ typedef void (*tprSL_MessageCallback)(void *pvUser, uint16_t u16Length, void *pv
  
 teSL_Status eSL_Init(void);
 teSL_Status eSL_AddListener(uint16_t u16Type, tprSL_MessageCallback prCallback, void *pvUser);
+/** Listener run on the serial read task as soon as the frame is read, ahead
+ *  of the callback queue. It must return quickly and must not send on the
+ *  serial link, the read task is the one delivering the status. */
+teSL_Status eSL_AddPriorityListener(uint16_t u16Type, tprSL_MessageCallback prCallback, void *pvUser);
+/** Called once the messages queued for the callback task are all handled,
+ *  the end of a batch of changes; NULL for none */
+void vSL_SetIdleCallback(tprSL_IdleCallback prIdle);
 teSL_Status eSL_SendMessage(uint16_t u16Type, uint16_t u16Length, void *pvMessage, uint8_t *pu8SequenceNo);
 teSL_Status eSL_SendMessageNoWait(uint16_t u16Type, uint16_t u16Length, void *pvMessage, uint8_t *pu8SequenceNo);
 teSL_Status eSL_MessageWait(uint16_t u16Type, uint32_t u32WaitTimeout, uint16_t *pu16Length, void **ppvMessage);
+/** Send a request without waiting. prCallback is called exactly once from
+ *  the callback task, unless the request is cancelled first. The handle
+ *  names this request only, never a later one in the same entry. */
+teSL_Status eSL_SendRequest(const tsSL_Request *psRequest, uint8_t *pu8Handle);
+/** Drop a request whose callback has not run yet. A request still waiting
+ *  for its status keeps its entry until the status comes, so the status is
+ *  not taken for the next request of the same type. */
+void vSL_CancelRequest(uint8_t u8Handle);
+/** Complete the requests which timed out, called periodically */
+void vSL_RequestPoll(void);
+/** Tick count when the last valid frame was received from the coordinator */
+uint32_t u32SL_GetLastRxTick(void);
+/** Status responses missed since the last valid frame */
+uint8_t u8SL_GetStatusTimeoutStreak(void);
 
 
 #if defined __cplusplus
@@ -0,0 +1,317 @@
+/*
+ * Copyright 2021-2023 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+#include "fsl_debug_console.h"
+
+#include <string.h>
+#include <stdbool.h>
+
+#include "ZigbeeConstant.h"
+#include "ZigbeeDevices.h"
+#include "ZcbAckPolicy.h"
+#include "ZcbNodeFlow.h"
+
+/*
+ * Idempotent absolute-value commands (On, Off, Move to Level, ...) sent to a
+ * device which has been bound for reporting of the resulting attribute do not
+ * need an APS ack: the attribute report tells us the command got through.
+ * Such commands are sent SHORT_NO_ACK and remembered here until the report
+ * arrives. A device reports a change only, so a command which leaves the
+ * attribute at the value last heard from the node (On to a light already
+ * on) is sent acked. On a miss the command is re-sent with SHORT (acked)
+ * addressing and the node's miss streak is incremented; nodes that keep
+ * missing are sent acked. A re-send the node's in-flight window turns away
+ * stays pending and is tried again later. Acked commands are not tracked,
+ * so any report or read response of a bound attribute of the node clears
+ * the streak and lets it back on the no-ack path.
+ */
+
+typedef struct
+{
+    bool                    bInUse;
+    uint16_t                u16ShortAddress;
+    uint8_t                 u8Endpoint;
+    uint16_t                u16ClusterId;
+    uint16_t                u16AttributeId;
+    uint64_t                u64Expected;
+    TickType_t              xDeadline;
+    uint8_t                 u8ResendAttempts;   /* 0 until the report was missed */
+    tprZCB_AckPolicyResend  prResend;
+    uint16_t                au16Args[3];
+} tsZCB_AckPending;
+
+static tsZCB_AckPending asPending[ZCB_ACK_POLICY_MAX_PENDING];
+static tsZCB_AckPolicyStats sStats;
+static SemaphoreHandle_t xAckPolicyMutex = NULL;
+
+
+void vZCB_AckPolicyInit(void)
+{
+    memset(asPending, 0, sizeof(asPending));
+    memset(&sStats, 0, sizeof(sStats));
+
+    if (xAckPolicyMutex == NULL) {
+        xAckPolicyMutex = xSemaphoreCreateMutex();
+    }
+}
+
+/* Mutex held; the pending command of the attribute, if any */
+static tsZCB_AckPending *psAckPolicyFind(const tsZCB_AckPending *psKey)
+{
+    for (uint8_t i = 0; i < ZCB_ACK_POLICY_MAX_PENDING; i++)
+    {
+        if (asPending[i].bInUse
+            && (asPending[i].u16ShortAddress == psKey->u16ShortAddress)
+            && (asPending[i].u8Endpoint == psKey->u8Endpoint)
+            && (asPending[i].u16ClusterId == psKey->u16ClusterId)
+            && (asPending[i].u16AttributeId == psKey->u16AttributeId)) {
+            return &asPending[i];
+        }
+    }
+    return NULL;
+}
+
+/* Mutex held */
+static tsZCB_AckPending *psAckPolicyFreeSlot(void)
+{
+    for (uint8_t i = 0; i < ZCB_ACK_POLICY_MAX_PENDING; i++)
+    {
+        if (!asPending[i].bInUse) {
+            return &asPending[i];
+        }
+    }
+    return NULL;
+}
+
+uint8_t u8ZCB_AckPolicySelectAddrMode(uint16_t u16ShortAddress,
+                                      uint8_t u8Endpoint,
+                                      uint16_t u16ClusterId,
+                                      uint16_t u16AttributeId,
+                                      uint64_t u64Target)
+{
+    tsZbDeviceInfo *sDevice = tZDM_FindDeviceByNodeId(u16ShortAddress);
+    const tsZbDeviceAttribute *psAttribute;
+    uint8_t u8AddrMode = E_ZB_ADDRESS_MODE_SHORT_NO_ACK;
+
+    if (xAckPolicyMutex == NULL) {
+        return E_ZB_ADDRESS_MODE_SHORT;
+    }
+
+    /* The attribute only exists in the table once the cluster has been bound
+     * for reporting; its value is the one last heard from the node */
+    psAttribute = tZDM_FindAttributeEntryByElement(u16ShortAddress, u8Endpoint, u16ClusterId, u16AttributeId);
+
+    if ((sDevice == NULL) || (sDevice->eDeviceState != E_ZB_DEVICE_STATE_ACTIVE)
+        || (sDevice->u8AckMissStreak >= ZCB_ACK_POLICY_MAX_MISS_STREAK)
+        || (psAttribute == NULL)) {
+        u8AddrMode = E_ZB_ADDRESS_MODE_SHORT;
+    } else if ((psAttribute->u8DataType == E_ZCL_NULL) || (psAttribute->uData.u64Data == u64Target)) {
+        /* Unknown, or no change for the node to report */
+        u8AddrMode = E_ZB_ADDRESS_MODE_SHORT;
+    }
+
+    xSemaphoreTake(xAckPolicyMutex, portMAX_DELAY);
+    if ((u8AddrMode == E_ZB_ADDRESS_MODE_SHORT_NO_ACK) && (psAckPolicyFreeSlot() == NULL)) {
+        /* Nothing would watch for the report */
+        u8AddrMode = E_ZB_ADDRESS_MODE_SHORT;
+    }
+    if (u8AddrMode == E_ZB_ADDRESS_MODE_SHORT_NO_ACK) {
+        sStats.u32SentNoAck++;
+    } else {
+        sStats.u32SentAcked++;
+    }
+    xSemaphoreGive(xAckPolicyMutex);
+
+    return u8AddrMode;
+}
+
+void vZCB_AckPolicyTrack(uint16_t u16ShortAddress,
+                         uint8_t u8Endpoint,
+                         uint16_t u16ClusterId,
+                         uint16_t u16AttributeId,
+                         uint64_t u64Expected,
+                         uint16_t u16TransitionTime,
+                         tprZCB_AckPolicyResend prResend,
+                         const uint16_t au16Args[3])
+{
+    tsZCB_AckPending *psSlot = NULL;
+
+    xSemaphoreTake(xAckPolicyMutex, portMAX_DELAY);
+
+    for (uint8_t i = 0; i < ZCB_ACK_POLICY_MAX_PENDING; i++)
+    {
+        if (asPending[i].bInUse
+            && (asPending[i].u16ShortAddress == u16ShortAddress)
+            && (asPending[i].u8Endpoint == u8Endpoint)
+            && (asPending[i].u16ClusterId == u16ClusterId)
+            && (asPending[i].u16AttributeId == u16AttributeId)) {
+            /* A newer command supersedes the one still waiting */
+            psSlot = &asPending[i];
+            break;
+        }
+        if ((psSlot == NULL) && !asPending[i].bInUse) {
+            psSlot = &asPending[i];
+        }
+    }
+
+    if (psSlot == NULL) {
+        /* Filled up since the address mode was picked: nothing will watch
+         * for the report, so send it again with an ack */
+        sStats.u32Dropped++;
+        xSemaphoreGive(xAckPolicyMutex);
+        if (prResend(E_ZB_ADDRESS_MODE_SHORT, u16ShortAddress, au16Args) != E_ZCB_OK) {
+            PRINTF("\n ### Command to 0x%x for cluster 0x%04x not confirmed, re-send refused\n",
+                   u16ShortAddress, u16ClusterId);
+        }
+        return;
+    }
+
+    psSlot->bInUse          = true;
+    psSlot->u16ShortAddress = u16ShortAddress;
+    psSlot->u8Endpoint      = u8Endpoint;
+    psSlot->u16ClusterId    = u16ClusterId;
+    psSlot->u16AttributeId  = u16AttributeId;
+    psSlot->u64Expected     = u64Expected;
+    /* Transition time is in tenths of a second */
+    psSlot->xDeadline       = xTaskGetTickCount()
+                              + pdMS_TO_TICKS((uint32_t)u16TransitionTime * 100 + ZCB_ACK_POLICY_CONFIRM_TIMEOUT_MS);
+    psSlot->u8ResendAttempts = 0;
+    psSlot->prResend        = prResend;
+    memcpy(psSlot->au16Args, au16Args, sizeof(psSlot->au16Args));
+
+    xSemaphoreGive(xAckPolicyMutex);
+}
+
+void vZCB_AckPolicyAttributeUpdate(uint16_t u16ShortAddress,
+                                   uint8_t u8Endpoint,
+                                   uint16_t u16ClusterId,
+                                   uint16_t u16AttributeId,
+                                   uint64_t u64Value)
+{
+    tsZbDeviceInfo *sDevice;
+
+    if (xAckPolicyMutex == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(xAckPolicyMutex, portMAX_DELAY);
+    for (uint8_t i = 0; i < ZCB_ACK_POLICY_MAX_PENDING; i++)
+    {
+        if (asPending[i].bInUse
+            && (asPending[i].u16ShortAddress == u16ShortAddress)
+            && (asPending[i].u8Endpoint == u8Endpoint)
+            && (asPending[i].u16ClusterId == u16ClusterId)
+            && (asPending[i].u16AttributeId == u16AttributeId)
+            && (asPending[i].u64Expected == u64Value)) {
+            /* Intermediate values during a transition do not confirm */
+            asPending[i].bInUse = false;
+            sStats.u32Confirmed++;
+        }
+    }
+
+    /* The node reports this cluster again, whether or not a command waited for it */
+    sDevice = tZDM_FindDeviceByNodeId(u16ShortAddress);
+    if ((sDevice != NULL) && (sDevice->u8AckMissStreak != 0)) {
+        if (sDevice->u8AckMissStreak >= ZCB_ACK_POLICY_MAX_MISS_STREAK) {
+            sStats.u32Recovered++;
+        }
+        sDevice->u8AckMissStreak = 0;
+    }
+    xSemaphoreGive(xAckPolicyMutex);
+}
+
+void vZCB_AckPolicyPoll(void)
+{
+    tsZCB_AckPending asExpired[ZCB_ACK_POLICY_MAX_PENDING];
+    uint8_t u8ExpiredCount = 0;
+    TickType_t xNow = xTaskGetTickCount();
+
+    if (xAckPolicyMutex == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(xAckPolicyMutex, portMAX_DELAY);
+    for (uint8_t i = 0; i < ZCB_ACK_POLICY_MAX_PENDING; i++)
+    {
+        if (asPending[i].bInUse && ((int32_t)(xNow - asPending[i].xDeadline) >= 0)) {
+            asExpired[u8ExpiredCount++] = asPending[i];
+            asPending[i].bInUse = false;
+        }
+    }
+    xSemaphoreGive(xAckPolicyMutex);
+
+    /* Re-send outside the lock, eSL_SendMessage blocks for the status */
+    for (uint8_t i = 0; i < u8ExpiredCount; i++)
+    {
+        tsZCB_AckPending *psExpired = &asExpired[i];
+        tsZbDeviceInfo *sDevice = tZDM_FindDeviceByNodeId(psExpired->u16ShortAddress);
+        bool bMissed = (psExpired->u8ResendAttempts == 0);
+        tsZCB_AckPending *psSlot;
+        teZcbStatus eStatus;
+
+        if (sDevice == NULL) {
+            continue;
+        }
+        if (bMissed) {
+            xSemaphoreTake(xAckPolicyMutex, portMAX_DELAY);
+            if (sDevice->u8AckMissStreak < 0xFF) {
+                sDevice->u8AckMissStreak++;
+            }
+            sStats.u32Retried++;
+            xSemaphoreGive(xAckPolicyMutex);
+            PRINTF("\n ### No report from 0x%x for cluster 0x%04x, re-send acked\n",
+                   psExpired->u16ShortAddress, psExpired->u16ClusterId);
+        }
+        eStatus = psExpired->prResend(E_ZB_ADDRESS_MODE_SHORT, psExpired->u16ShortAddress, psExpired->au16Args);
+        psExpired->u8ResendAttempts++;
+
+        /* Turned away by the node's window: kept, and tried again later;
+         * not when a newer command for the attribute is watched for */
+        if (eStatus == E_ZCB_REQUEST_NOT_ACTIONED) {
+            xSemaphoreTake(xAckPolicyMutex, portMAX_DELAY);
+            psSlot = NULL;
+            if (psAckPolicyFind(psExpired) == NULL) {
+                psSlot = (psExpired->u8ResendAttempts < ZCB_ACK_POLICY_RESEND_ATTEMPTS) ? psAckPolicyFreeSlot() : NULL;
+                if (psSlot == NULL) {
+                    sStats.u32ResendFailed++;
+                    PRINTF("\n ### Re-send to 0x%x for cluster 0x%04x refused, given up\n",
+                           psExpired->u16ShortAddress, psExpired->u16ClusterId);
+                }
+            }
+            if (psSlot != NULL) {
+                *psSlot = *psExpired;
+                psSlot->xDeadline = xNow + pdMS_TO_TICKS(ZCB_ACK_POLICY_RESEND_RETRY_MS);
+                sStats.u32ResendHeld++;
+            }
+            xSemaphoreGive(xAckPolicyMutex);
+        }
+
+        /* Back the node off once, after the first re-send, which would
+         * otherwise be held back */
+        if (bMissed) {
+            vZCB_NodeFlowTimeout(psExpired->u16ShortAddress);
+        }
+    }
+}
+
+void vZCB_AckPolicyGetStats(tsZCB_AckPolicyStats *psStats)
+{
+    if ((psStats == NULL) || (xAckPolicyMutex == NULL)) {
+        return;
+    }
+    xSemaphoreTake(xAckPolicyMutex, portMAX_DELAY);
+    *psStats = sStats;
+    xSemaphoreGive(xAckPolicyMutex);
+}
+
+// ------------------------------------------------------------------
+// END OF FILE
+// ------------------------------------------------------------------
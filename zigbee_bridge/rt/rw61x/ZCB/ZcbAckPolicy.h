@@ -0,0 +1,108 @@
+/*
+ * Copyright 2021-2023 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef ZCBACKPOLICY_H
+#define ZCBACKPOLICY_H
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+/****************************************************************************/
+/***        Include files                                                 ***/
+/****************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "zcb.h"
+
+/****************************************************************************/
+/***        Macro Definitions                                             ***/
+/****************************************************************************/
+
+/* Number of unacknowledged commands waiting for their confirming report */
+#define ZCB_ACK_POLICY_MAX_PENDING              8
+/* Time allowed for the attribute report on top of the transition time */
+#define ZCB_ACK_POLICY_CONFIRM_TIMEOUT_MS       1500
+/* Consecutive missed confirmations before a node is sent acked only */
+#define ZCB_ACK_POLICY_MAX_MISS_STREAK          2
+/* An acked re-send the node's in-flight window turned away is tried again
+ * after this time, up to this many attempts in all */
+#define ZCB_ACK_POLICY_RESEND_RETRY_MS          500
+#define ZCB_ACK_POLICY_RESEND_ATTEMPTS          8
+
+
+/****************************************************************************/
+/***        Type Definitions                                              ***/
+/****************************************************************************/
+
+/** Re-send the command with the given APS address mode */
+typedef teZcbStatus (*tprZCB_AckPolicyResend)(uint8_t u8AddrMode,
+                                              uint16_t u16ShortAddress,
+                                              const uint16_t au16Args[3]);
+
+typedef struct
+{
+    uint32_t u32SentNoAck;        /**< Commands sent without APS ack */
+    uint32_t u32SentAcked;        /**< Commands sent with APS ack */
+    uint32_t u32Confirmed;        /**< No-ack commands confirmed by a report */
+    uint32_t u32Retried;          /**< No-ack commands re-sent acked on a miss */
+    uint32_t u32Dropped;          /**< No-ack commands not tracked, table full */
+    uint32_t u32Recovered;        /**< Nodes back on no-ack after a report */
+    uint32_t u32ResendHeld;       /**< Re-sends turned away by the node's window, tried again */
+    uint32_t u32ResendFailed;     /**< ... given up after ZCB_ACK_POLICY_RESEND_ATTEMPTS */
+} tsZCB_AckPolicyStats;
+
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+
+void vZCB_AckPolicyInit(void);
+
+/** Select the address mode for an idempotent command whose effect is
+ *  visible in (u16ClusterId, u16AttributeId) on the target endpoint, which
+ *  it sets to u64Target. Acked when the attribute already has that value:
+ *  the node would not report it. */
+uint8_t u8ZCB_AckPolicySelectAddrMode(uint16_t u16ShortAddress,
+                                      uint8_t u8Endpoint,
+                                      uint16_t u16ClusterId,
+                                      uint16_t u16AttributeId,
+                                      uint64_t u64Target);
+
+/** Watch for the report confirming an unacknowledged command */
+void vZCB_AckPolicyTrack(uint16_t u16ShortAddress,
+                         uint8_t u8Endpoint,
+                         uint16_t u16ClusterId,
+                         uint16_t u16AttributeId,
+                         uint64_t u64Expected,
+                         uint16_t u16TransitionTime,
+                         tprZCB_AckPolicyResend prResend,
+                         const uint16_t au16Args[3]);
+
+/** Feed a received attribute value, from a report or read response */
+void vZCB_AckPolicyAttributeUpdate(uint16_t u16ShortAddress,
+                                   uint8_t u8Endpoint,
+                                   uint16_t u16ClusterId,
+                                   uint16_t u16AttributeId,
+                                   uint64_t u64Value);
+
+/** Expire pending confirmations, called from the ZCB service task */
+void vZCB_AckPolicyPoll(void);
+
+void vZCB_AckPolicyGetStats(tsZCB_AckPolicyStats *psStats);
+
+#if defined __cplusplus
+}
+#endif
+
+#endif  /* ZCBACKPOLICY_H */
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
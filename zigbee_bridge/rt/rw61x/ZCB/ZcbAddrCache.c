@@ -0,0 +1,388 @@
+/*
+ * Copyright 2021-2023 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+#include "fsl_debug_console.h"
+
+#include <string.h>
+#include <stdbool.h>
+
+#include "ZigbeeConstant.h"
+#include "cmd.h"
+#include "ZcbAddrCache.h"
+
+/*
+ * Short address to IEEE address resolution.
+ *
+ * A report from a short address the device table does not know used to send
+ * an IEEE_addr_req every time, so a node whose short address had changed
+ * could start a request per report. Resolved pairs are kept here both ways,
+ * a request already pending for a short address is not repeated, a short
+ * address nobody answers for is remembered as unresolvable for a while and
+ * all requests go through a small token bucket. Requests do not block the
+ * caller, which is usually the callback task handling a report.
+ */
+
+typedef enum
+{
+    E_ADDR_CACHE_FREE,
+    E_ADDR_CACHE_RESOLVED,
+    E_ADDR_CACHE_PENDING,
+    E_ADDR_CACHE_UNRESOLVED,
+} teAddrCacheState;
+
+typedef struct
+{
+    uint8_t     eState;
+    uint8_t     u8Attempts;
+    uint16_t    u16ShortAddress;
+    uint64_t    u64IeeeAddress;
+    TickType_t  xStamp;
+} tsZCB_AddrCacheEntry;
+
+static tsZCB_AddrCacheEntry asAddrCache[ZCB_ADDR_CACHE_SIZE];
+static tsZCB_AddrCacheStats sStats;
+static SemaphoreHandle_t xAddrCacheMutex = NULL;
+static uint8_t u8Tokens;
+static TickType_t xTokenStamp;
+
+
+static tsZCB_AddrCacheEntry *psAddrCacheFindNwk(uint16_t u16ShortAddress)
+{
+    for (uint8_t i = 0; i < ZCB_ADDR_CACHE_SIZE; i++)
+    {
+        if ((asAddrCache[i].eState != E_ADDR_CACHE_FREE)
+            && (asAddrCache[i].u16ShortAddress == u16ShortAddress)) {
+            return &asAddrCache[i];
+        }
+    }
+    return NULL;
+}
+
+static tsZCB_AddrCacheEntry *psAddrCacheFindIeee(uint64_t u64IeeeAddress)
+{
+    for (uint8_t i = 0; i < ZCB_ADDR_CACHE_SIZE; i++)
+    {
+        if ((asAddrCache[i].eState == E_ADDR_CACHE_RESOLVED)
+            && (asAddrCache[i].u64IeeeAddress == u64IeeeAddress)) {
+            return &asAddrCache[i];
+        }
+    }
+    return NULL;
+}
+
+/* Free entry, else the one unused for the longest time */
+static tsZCB_AddrCacheEntry *psAddrCacheAlloc(TickType_t xNow)
+{
+    tsZCB_AddrCacheEntry *psOldest = NULL;
+
+    for (uint8_t i = 0; i < ZCB_ADDR_CACHE_SIZE; i++)
+    {
+        if (asAddrCache[i].eState == E_ADDR_CACHE_FREE) {
+            return &asAddrCache[i];
+        }
+        if ((psOldest == NULL)
+            || ((xNow - asAddrCache[i].xStamp) > (xNow - psOldest->xStamp))) {
+            psOldest = &asAddrCache[i];
+        }
+    }
+    memset(psOldest, 0, sizeof(*psOldest));
+    return psOldest;
+}
+
+static bool bAddrCacheTakeToken(TickType_t xNow)
+{
+    TickType_t xRefill = pdMS_TO_TICKS(ZCB_ADDR_CACHE_RATE_MS);
+
+    while ((u8Tokens < ZCB_ADDR_CACHE_BURST) && ((xNow - xTokenStamp) >= xRefill)) {
+        u8Tokens++;
+        xTokenStamp += xRefill;
+    }
+    if (u8Tokens == ZCB_ADDR_CACHE_BURST) {
+        xTokenStamp = xNow;
+    }
+    if (u8Tokens == 0) {
+        return false;
+    }
+    u8Tokens--;
+    return true;
+}
+
+void vZCB_AddrCacheInit(void)
+{
+    memset(asAddrCache, 0, sizeof(asAddrCache));
+    memset(&sStats, 0, sizeof(sStats));
+    u8Tokens = ZCB_ADDR_CACHE_BURST;
+    xTokenStamp = xTaskGetTickCount();
+
+    if (xAddrCacheMutex == NULL) {
+        xAddrCacheMutex = xSemaphoreCreateMutex();
+    }
+}
+
+bool bZCB_AddrCacheGetIeee(uint16_t u16ShortAddress, uint64_t *pu64IeeeAddress)
+{
+    tsZCB_AddrCacheEntry *psEntry;
+    bool bFound = false;
+
+    if (xAddrCacheMutex == NULL) {
+        return false;
+    }
+
+    xSemaphoreTake(xAddrCacheMutex, portMAX_DELAY);
+    psEntry = psAddrCacheFindNwk(u16ShortAddress);
+    if ((psEntry != NULL) && (psEntry->eState == E_ADDR_CACHE_RESOLVED)) {
+        *pu64IeeeAddress = psEntry->u64IeeeAddress;
+        psEntry->xStamp = xTaskGetTickCount();
+        bFound = true;
+    }
+    xSemaphoreGive(xAddrCacheMutex);
+
+    return bFound;
+}
+
+bool bZCB_AddrCacheGetNwk(uint64_t u64IeeeAddress, uint16_t *pu16ShortAddress)
+{
+    tsZCB_AddrCacheEntry *psEntry;
+    bool bFound = false;
+
+    if (xAddrCacheMutex == NULL) {
+        return false;
+    }
+
+    xSemaphoreTake(xAddrCacheMutex, portMAX_DELAY);
+    psEntry = psAddrCacheFindIeee(u64IeeeAddress);
+    if (psEntry != NULL) {
+        *pu16ShortAddress = psEntry->u16ShortAddress;
+        psEntry->xStamp = xTaskGetTickCount();
+        bFound = true;
+    }
+    xSemaphoreGive(xAddrCacheMutex);
+
+    return bFound;
+}
+
+/* Only failures matter here, a response is learnt by the IEEE_addr_rsp listener */
+static void vAddrCacheRequestDone(void *pvUser, teSL_Status eStatus, uint16_t u16Length, void *pvMessage)
+{
+    uint16_t u16ShortAddress = (uint16_t)(uintptr_t)pvUser;
+    tsZCB_AddrCacheEntry *psEntry;
+
+    if (eStatus == E_SL_OK) {
+        return;
+    }
+
+    xSemaphoreTake(xAddrCacheMutex, portMAX_DELAY);
+    psEntry = psAddrCacheFindNwk(u16ShortAddress);
+    if ((psEntry != NULL) && (psEntry->eState == E_ADDR_CACHE_PENDING)) {
+        if (psEntry->u8Attempts >= ZCB_ADDR_CACHE_MAX_ATTEMPTS) {
+            psEntry->eState = E_ADDR_CACHE_UNRESOLVED;
+            psEntry->xStamp = xTaskGetTickCount();
+            sStats.u32Unresolved++;
+        } else {
+            /* Next report may try again right away */
+            psEntry->xStamp = xTaskGetTickCount() - pdMS_TO_TICKS(ZCB_ADDR_CACHE_PENDING_MS);
+        }
+    }
+    xSemaphoreGive(xAddrCacheMutex);
+}
+
+teZcbStatus eZCB_AddrCacheResolve(uint16_t u16ShortAddress)
+{
+    tsZCB_AddrCacheEntry *psEntry;
+    TickType_t xNow;
+    bool bSend = false;
+
+    if (xAddrCacheMutex == NULL) {
+        return E_ZCB_ERROR;
+    }
+
+    xSemaphoreTake(xAddrCacheMutex, portMAX_DELAY);
+    xNow = xTaskGetTickCount();
+    psEntry = psAddrCacheFindNwk(u16ShortAddress);
+
+    if (psEntry == NULL) {
+        psEntry = psAddrCacheAlloc(xNow);
+        psEntry->eState = E_ADDR_CACHE_PENDING;
+        psEntry->u16ShortAddress = u16ShortAddress;
+        psEntry->xStamp = xNow - pdMS_TO_TICKS(ZCB_ADDR_CACHE_PENDING_MS);
+    }
+
+    switch (psEntry->eState)
+    {
+        case E_ADDR_CACHE_RESOLVED:
+            /* Known here, the caller only missed the device table */
+            sStats.u32Deduplicated++;
+            break;
+
+        case E_ADDR_CACHE_UNRESOLVED:
+            if ((xNow - psEntry->xStamp) < pdMS_TO_TICKS(ZCB_ADDR_CACHE_NEGATIVE_MS)) {
+                sStats.u32NegativeHits++;
+                break;
+            }
+            psEntry->eState = E_ADDR_CACHE_PENDING;
+            psEntry->u8Attempts = 0;
+            psEntry->xStamp = xNow - pdMS_TO_TICKS(ZCB_ADDR_CACHE_PENDING_MS);
+            /* Fall through */
+
+        case E_ADDR_CACHE_PENDING:
+            if ((xNow - psEntry->xStamp) < pdMS_TO_TICKS(ZCB_ADDR_CACHE_PENDING_MS)) {
+                sStats.u32Deduplicated++;
+                break;
+            }
+            if (psEntry->u8Attempts >= ZCB_ADDR_CACHE_MAX_ATTEMPTS) {
+                psEntry->eState = E_ADDR_CACHE_UNRESOLVED;
+                psEntry->xStamp = xNow;
+                sStats.u32Unresolved++;
+                sStats.u32NegativeHits++;
+                break;
+            }
+            if (!bAddrCacheTakeToken(xNow)) {
+                sStats.u32RateLimited++;
+                break;
+            }
+            psEntry->u8Attempts++;
+            psEntry->xStamp = xNow;
+            sStats.u32Requests++;
+            bSend = true;
+            break;
+
+        default:
+            break;
+    }
+    xSemaphoreGive(xAddrCacheMutex);
+
+    if (!bSend) {
+        return E_ZCB_DEFERRED;
+    }
+    return eIeeeAddressRequestAsync(u16ShortAddress, u16ShortAddress, 0, 0,
+                                    vAddrCacheRequestDone, (void *)(uintptr_t)u16ShortAddress);
+}
+
+bool bZCB_AddrCacheLearn(uint16_t u16ShortAddress,
+                         uint64_t u64IeeeAddress,
+                         uint16_t *pu16OldShortAddress)
+{
+    tsZCB_AddrCacheEntry *psEntry;
+    TickType_t xNow;
+    bool bChanged = false;
+
+    if (xAddrCacheMutex == NULL) {
+        return false;
+    }
+
+    xSemaphoreTake(xAddrCacheMutex, portMAX_DELAY);
+    xNow = xTaskGetTickCount();
+
+    /* The node moved away from its old short address ... */
+    psEntry = psAddrCacheFindIeee(u64IeeeAddress);
+    if ((psEntry != NULL) && (psEntry->u16ShortAddress != u16ShortAddress)) {
+        if (pu16OldShortAddress != NULL) {
+            *pu16OldShortAddress = psEntry->u16ShortAddress;
+        }
+        psEntry->eState = E_ADDR_CACHE_FREE;
+        sStats.u32AddressChanges++;
+        bChanged = true;
+    }
+
+    /* ... and its new one may have belonged to another node, or be pending */
+    psEntry = psAddrCacheFindNwk(u16ShortAddress);
+    if (psEntry == NULL) {
+        psEntry = psAddrCacheAlloc(xNow);
+    }
+    if ((psEntry->eState != E_ADDR_CACHE_RESOLVED) || (psEntry->u64IeeeAddress != u64IeeeAddress)) {
+        sStats.u32Resolved++;
+    }
+    psEntry->eState = E_ADDR_CACHE_RESOLVED;
+    psEntry->u8Attempts = 0;
+    psEntry->u16ShortAddress = u16ShortAddress;
+    psEntry->u64IeeeAddress = u64IeeeAddress;
+    psEntry->xStamp = xNow;
+    xSemaphoreGive(xAddrCacheMutex);
+
+    return bChanged;
+}
+
+void vZCB_AddrCacheUnresolved(uint16_t u16ShortAddress)
+{
+    tsZCB_AddrCacheEntry *psEntry;
+
+    if (xAddrCacheMutex == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(xAddrCacheMutex, portMAX_DELAY);
+    psEntry = psAddrCacheFindNwk(u16ShortAddress);
+    if ((psEntry != NULL) && (psEntry->eState == E_ADDR_CACHE_PENDING)) {
+        psEntry->eState = E_ADDR_CACHE_UNRESOLVED;
+        psEntry->xStamp = xTaskGetTickCount();
+        sStats.u32Unresolved++;
+    }
+    xSemaphoreGive(xAddrCacheMutex);
+}
+
+void vZCB_AddrCacheForget(uint64_t u64IeeeAddress)
+{
+    tsZCB_AddrCacheEntry *psEntry;
+
+    if (xAddrCacheMutex == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(xAddrCacheMutex, portMAX_DELAY);
+    psEntry = psAddrCacheFindIeee(u64IeeeAddress);
+    if (psEntry != NULL) {
+        psEntry->eState = E_ADDR_CACHE_FREE;
+    }
+    xSemaphoreGive(xAddrCacheMutex);
+}
+
+void vZCB_AddrCacheDump(void)
+{
+    static const char *apcState[] = { "free", "resolved", "pending", "unresolved" };
+    TickType_t xNow = xTaskGetTickCount();
+
+    if (xAddrCacheMutex == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(xAddrCacheMutex, portMAX_DELAY);
+    for (uint8_t i = 0; i < ZCB_ADDR_CACHE_SIZE; i++)
+    {
+        if (asAddrCache[i].eState == E_ADDR_CACHE_FREE) {
+            continue;
+        }
+        PRINTF("\n ### 0x%04x 0x%016llx %s attempts=%d age=%ds",
+               asAddrCache[i].u16ShortAddress,
+               asAddrCache[i].u64IeeeAddress,
+               apcState[asAddrCache[i].eState],
+               asAddrCache[i].u8Attempts,
+               (int)((xNow - asAddrCache[i].xStamp) * portTICK_PERIOD_MS / 1000));
+    }
+    PRINTF("\n ### requests=%d dedup=%d negative=%d ratelimited=%d resolved=%d unresolved=%d changes=%d\n",
+           sStats.u32Requests, sStats.u32Deduplicated, sStats.u32NegativeHits, sStats.u32RateLimited,
+           sStats.u32Resolved, sStats.u32Unresolved, sStats.u32AddressChanges);
+    xSemaphoreGive(xAddrCacheMutex);
+}
+
+void vZCB_AddrCacheGetStats(tsZCB_AddrCacheStats *psStats)
+{
+    if ((psStats == NULL) || (xAddrCacheMutex == NULL)) {
+        return;
+    }
+
+    xSemaphoreTake(xAddrCacheMutex, portMAX_DELAY);
+    *psStats = sStats;
+    xSemaphoreGive(xAddrCacheMutex);
+}
+
+// ------------------------------------------------------------------
+// END OF FILE
+// ------------------------------------------------------------------
@@ -0,0 +1,106 @@
+/*
+ * Copyright 2021-2023 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef ZCBADDRCACHE_H
+#define ZCBADDRCACHE_H
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+/****************************************************************************/
+/***        Include files                                                 ***/
+/****************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "zcb.h"
+
+/****************************************************************************/
+/***        Macro Definitions                                             ***/
+/****************************************************************************/
+
+/* Short/IEEE address pairs kept, resolved or not. Deliberately fewer than
+ * ZB_BRIDGE_MAX_NODES: the nodes the bridge knows are resolved from the
+ * device table, this only holds the addresses being learnt, moved or
+ * refused, and a pair pushed out costs one IEEE_addr_req at most */
+#define ZCB_ADDR_CACHE_SIZE                     32
+#if ZCB_ADDR_CACHE_SIZE > ZB_BRIDGE_MAX_NODES
+#error "ZCB_ADDR_CACHE_SIZE is meant to be smaller than ZB_BRIDGE_MAX_NODES"
+#endif
+/* A second request for the same short address is not sent within this time */
+#define ZCB_ADDR_CACHE_PENDING_MS               5000
+/* Requests sent for a short address before it is taken as unresolvable */
+#define ZCB_ADDR_CACHE_MAX_ATTEMPTS             3
+/* An unresolvable short address is not queried again within this time */
+#define ZCB_ADDR_CACHE_NEGATIVE_MS              (5 * 60 * 1000)
+/* IEEE_addr_req sent at most once per interval, with a small burst allowed */
+#define ZCB_ADDR_CACHE_RATE_MS                  1000
+#define ZCB_ADDR_CACHE_BURST                    3
+
+
+/****************************************************************************/
+/***        Type Definitions                                              ***/
+/****************************************************************************/
+
+typedef struct
+{
+    uint32_t u32Requests;         /**< IEEE_addr_req sent */
+    uint32_t u32Deduplicated;     /**< Requests not sent, one already pending */
+    uint32_t u32NegativeHits;     /**< Requests not sent, address unresolvable */
+    uint32_t u32RateLimited;      /**< Requests not sent, over the rate limit */
+    uint32_t u32Resolved;         /**< Address pairs learnt */
+    uint32_t u32Unresolved;       /**< Short addresses taken as unresolvable */
+    uint32_t u32AddressChanges;   /**< Nodes seen with a new short address */
+} tsZCB_AddrCacheStats;
+
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+
+void vZCB_AddrCacheInit(void);
+
+/** IEEE address of a short address, false when not known */
+bool bZCB_AddrCacheGetIeee(uint16_t u16ShortAddress, uint64_t *pu64IeeeAddress);
+
+/** Short address of an IEEE address, false when not known */
+bool bZCB_AddrCacheGetNwk(uint64_t u64IeeeAddress, uint16_t *pu16ShortAddress);
+
+/** Ask the network who an unknown short address is. The request is not sent
+ *  when one is pending, the address is known unresolvable or over the rate
+ *  limit; E_ZCB_DEFERRED is returned then. */
+teZcbStatus eZCB_AddrCacheResolve(uint16_t u16ShortAddress);
+
+/** Record an address pair from an announce or an address response.
+ *  Returns true when the node was known with another short address,
+ *  which is then given in pu16OldShortAddress. */
+bool bZCB_AddrCacheLearn(uint16_t u16ShortAddress,
+                         uint64_t u64IeeeAddress,
+                         uint16_t *pu16OldShortAddress);
+
+/** A short address could not be resolved, do not query it for a while */
+void vZCB_AddrCacheUnresolved(uint16_t u16ShortAddress);
+
+/** Drop a node which has left the network */
+void vZCB_AddrCacheForget(uint64_t u64IeeeAddress);
+
+/** Print the entries, one line each */
+void vZCB_AddrCacheDump(void);
+
+void vZCB_AddrCacheGetStats(tsZCB_AddrCacheStats *psStats);
+
+#if defined __cplusplus
+}
+#endif
+
+#endif  /* ZCBADDRCACHE_H */
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
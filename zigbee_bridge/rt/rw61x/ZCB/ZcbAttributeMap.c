@@ -0,0 +1,189 @@
+/*
+ * Copyright 2021-2023 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "ZigbeeConstant.h"
+#include "ZigbeeDevices.h"
+#include "ZcbAttributeMap.h"
+
+/*
+ * Zigbee to Matter attribute mapping.
+ *
+ * Each row bridges one Zigbee attribute: the ZCL type it is reported with,
+ * the Matter cluster and attribute it becomes, the unit conversion and the
+ * smallest change worth forwarding. Bridging a new attribute is one more row
+ * here plus its setter on the bridge side. The last forwarded value of each
+ * row is kept per device table entry; reports are handled by the SerialLink
+ * callback task only, so no locking is needed.
+ */
+
+static int64_t i64ConvertOnOff(int64_t i64Value)
+{
+    return (i64Value != 0) ? 1 : 0;
+}
+
+static int64_t i64ConvertLevel(int64_t i64Value)
+{
+    /* Zigbee 0..254, the Matter lighting level starts at 1 */
+    if (i64Value < 1) {
+        return 1;
+    }
+    if (i64Value > 254) {
+        return 254;
+    }
+    return i64Value;
+}
+
+static int64_t i64ConvertOccupancy(int64_t i64Value)
+{
+    return i64Value & 0x01;
+}
+
+static const tsZCB_AttributeMap asAttributeMap[] =
+{
+    /* Zigbee cluster, attribute, type,  Matter cluster, attribute, bridge setter, converter, threshold */
+    { E_ZB_CLUSTERID_ONOFF,                    E_ZB_ATTRIBUTEID_ONOFF_ONOFF,        E_ZCL_BOOL,
+      ZCB_MATTER_CLUSTER_ONOFF,                ZCB_MATTER_ATTR_ONOFF,               E_ZCB_MATTER_WRITE_ONOFF,
+      i64ConvertOnOff,     0 },
+    { E_ZB_CLUSTERID_LEVEL_CONTROL,            E_ZB_ATTRIBUTEID_LEVEL_CURRENTLEVEL, E_ZCL_UINT8,
+      ZCB_MATTER_CLUSTER_LEVEL_CONTROL,        ZCB_MATTER_ATTR_CURRENT_LEVEL,       E_ZCB_MATTER_WRITE_LEVEL,
+      i64ConvertLevel,     0 },
+    { E_ZB_CLUSTERID_MEASUREMENTSENSING_ILLUM, E_ZB_ATTRIBUTEID_MS_ILLUM_MEASURED,  E_ZCL_UINT16,
+      ZCB_MATTER_CLUSTER_ILLUMINANCE,          ZCB_MATTER_ATTR_MEASURED_VALUE,      E_ZCB_MATTER_WRITE_MEASURED_VALUE,
+      NULL,                50 },
+    { E_ZB_CLUSTERID_MEASUREMENTSENSING_TEMP,  E_ZB_ATTRIBUTEID_MS_TEMP_MEASURED,   E_ZCL_INT16,
+      ZCB_MATTER_CLUSTER_TEMPERATURE,          ZCB_MATTER_ATTR_MEASURED_VALUE,      E_ZCB_MATTER_WRITE_MEASURED_VALUE,
+      NULL,                10 },
+    { E_ZB_CLUSTERID_OCCUPANCYSENSING,         E_ZB_ATTRIBUTEID_MS_OCC_OCCUPANCY,   E_ZCL_BMAP8,
+      ZCB_MATTER_CLUSTER_OCCUPANCY,            ZCB_MATTER_ATTR_OCCUPANCY,           E_ZCB_MATTER_WRITE_MEASURED_VALUE,
+      i64ConvertOccupancy, 0 },
+};
+
+#define ZCB_ATTRIBUTE_MAP_ROWS      (sizeof(asAttributeMap) / sizeof(asAttributeMap[0]))
+
+typedef char acAttributeMapRowsFitMask[(ZCB_ATTRIBUTE_MAP_ROWS <= 32) ? 1 : -1];
+
+static int32_t  ai32LastValue[MAX_ZD_DEVICE_NUMBERS][ZCB_ATTRIBUTE_MAP_ROWS];
+static uint32_t au32LastValid[MAX_ZD_DEVICE_NUMBERS];
+
+
+/* Sign extend the signed ZCL integer types */
+static int64_t i64AttributeMapDecode(uint8_t u8ZclType, uint64_t u64Raw)
+{
+    uint8_t u8Bits;
+
+    if ((u8ZclType < E_ZCL_INT8) || (u8ZclType > E_ZCL_INT64)) {
+        return (int64_t)u64Raw;
+    }
+
+    u8Bits = (uint8_t)((u8ZclType - E_ZCL_INT8 + 1) * 8);
+    if ((u8Bits < 64) && (u64Raw & (1ULL << (u8Bits - 1)))) {
+        u64Raw |= ~((1ULL << u8Bits) - 1);
+    }
+    return (int64_t)u64Raw;
+}
+
+void vZCB_AttributeMapInit(void)
+{
+    memset(ai32LastValue, 0, sizeof(ai32LastValue));
+    memset(au32LastValid, 0, sizeof(au32LastValid));
+}
+
+const tsZCB_AttributeMap *psZCB_AttributeMapFind(uint16_t u16ZbClusterId, uint16_t u16ZbAttributeId)
+{
+    for (uint8_t i = 0; i < ZCB_ATTRIBUTE_MAP_ROWS; i++)
+    {
+        if ((asAttributeMap[i].u16ZbClusterId == u16ZbClusterId)
+            && (asAttributeMap[i].u16ZbAttributeId == u16ZbAttributeId)) {
+            return &asAttributeMap[i];
+        }
+    }
+    return NULL;
+}
+
+static bool bAttributeMapApply(const tsZCB_AttributeMap *psMap,
+                               uint8_t u8DevIndex,
+                               uint8_t u8ZclType,
+                               uint64_t u64Raw,
+                               uint32_t u32Threshold,
+                               int64_t *pi64Value)
+{
+    uint8_t u8Row;
+    int64_t i64Value;
+    int64_t i64Change;
+
+    if ((psMap == NULL) || (pi64Value == NULL) || (u8ZclType != psMap->u8ZclType)) {
+        return false;
+    }
+
+    i64Value = i64AttributeMapDecode(u8ZclType, u64Raw);
+    if (psMap->pfConvert != NULL) {
+        i64Value = psMap->pfConvert(i64Value);
+    }
+    *pi64Value = i64Value;
+
+    if (u8DevIndex >= MAX_ZD_DEVICE_NUMBERS) {
+        return true;
+    }
+
+    /* Small changes are dropped, measured against the last value forwarded */
+    u8Row = (uint8_t)(psMap - asAttributeMap);
+    if ((u32Threshold != 0) && (au32LastValid[u8DevIndex] & (1UL << u8Row))) {
+        i64Change = i64Value - ai32LastValue[u8DevIndex][u8Row];
+        if (i64Change < 0) {
+            i64Change = -i64Change;
+        }
+        if (i64Change < u32Threshold) {
+            return false;
+        }
+    }
+
+    ai32LastValue[u8DevIndex][u8Row] = (int32_t)i64Value;
+    au32LastValid[u8DevIndex] |= (1UL << u8Row);
+    return true;
+}
+
+bool bZCB_AttributeMapConvert(const tsZCB_AttributeMap *psMap,
+                              uint8_t u8DevIndex,
+                              uint8_t u8ZclType,
+                              uint64_t u64Raw,
+                              int64_t *pi64Value)
+{
+    return bAttributeMapApply(psMap, u8DevIndex, u8ZclType, u64Raw,
+                              (psMap != NULL) ? psMap->u32Threshold : 0, pi64Value);
+}
+
+bool bZCB_AttributeMapDelta(const tsZCB_AttributeMap *psMap,
+                            uint8_t u8DevIndex,
+                            uint8_t u8ZclType,
+                            uint64_t u64Raw,
+                            int64_t *pi64Value)
+{
+    /* An unchanged value is not a delta, whatever the row threshold */
+    return bAttributeMapApply(psMap, u8DevIndex, u8ZclType, u64Raw,
+                              ((psMap != NULL) && (psMap->u32Threshold > 1)) ? psMap->u32Threshold : 1,
+                              pi64Value);
+}
+
+void vZCB_AttributeMapForget(uint8_t u8DevIndex)
+{
+    if (u8DevIndex < MAX_ZD_DEVICE_NUMBERS) {
+        au32LastValid[u8DevIndex] = 0;
+    }
+}
+
+uint32_t u32ZCB_AttributeMapRam(void)
+{
+    return sizeof(ai32LastValue) + sizeof(au32LastValid);
+}
+
+// ------------------------------------------------------------------
+// END OF FILE
+// ------------------------------------------------------------------
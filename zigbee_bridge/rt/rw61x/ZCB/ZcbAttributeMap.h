@@ -0,0 +1,107 @@
+/*
+ * Copyright 2021-2023 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef ZCBATTRIBUTEMAP_H
+#define ZCBATTRIBUTEMAP_H
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+/****************************************************************************/
+/***        Include files                                                 ***/
+/****************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/****************************************************************************/
+/***        Macro Definitions                                             ***/
+/****************************************************************************/
+
+/* Matter cluster and attribute IDs of the bridged attributes */
+#define ZCB_MATTER_CLUSTER_ONOFF                0x0006
+#define ZCB_MATTER_CLUSTER_LEVEL_CONTROL        0x0008
+#define ZCB_MATTER_CLUSTER_ILLUMINANCE          0x0400
+#define ZCB_MATTER_CLUSTER_TEMPERATURE          0x0402
+#define ZCB_MATTER_CLUSTER_OCCUPANCY            0x0406
+
+#define ZCB_MATTER_ATTR_ONOFF                   0x0000
+#define ZCB_MATTER_ATTR_CURRENT_LEVEL           0x0000
+#define ZCB_MATTER_ATTR_MEASURED_VALUE          0x0000
+#define ZCB_MATTER_ATTR_OCCUPANCY               0x0000
+
+
+/****************************************************************************/
+/***        Type Definitions                                              ***/
+/****************************************************************************/
+
+/** Setter of the bridge which writes a value to its Matter device */
+typedef enum
+{
+    E_ZCB_MATTER_WRITE_ONOFF,
+    E_ZCB_MATTER_WRITE_LEVEL,
+    E_ZCB_MATTER_WRITE_MEASURED_VALUE,
+    E_ZCB_MATTER_WRITES,
+} teZCB_MatterWrite;
+
+/** Converts a decoded Zigbee value to the Matter unit */
+typedef int64_t (*tpfZCB_AttributeConvert)(int64_t i64Value);
+
+typedef struct
+{
+    uint16_t                u16ZbClusterId;
+    uint16_t                u16ZbAttributeId;
+    uint8_t                 u8ZclType;        /**< Type expected in reports */
+    uint32_t                u32MatterClusterId;
+    uint32_t                u32MatterAttributeId;
+    uint8_t                 u8MatterWrite;    /**< teZCB_MatterWrite */
+    tpfZCB_AttributeConvert pfConvert;        /**< NULL when units are the same */
+    uint32_t                u32Threshold;     /**< Smallest change forwarded, 0 for all */
+} tsZCB_AttributeMap;
+
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+
+void vZCB_AttributeMapInit(void);
+
+/** Row bridging a Zigbee attribute, NULL when it is not bridged */
+const tsZCB_AttributeMap *psZCB_AttributeMapFind(uint16_t u16ZbClusterId, uint16_t u16ZbAttributeId);
+
+/** Decode, convert and threshold a reported value.
+ *  Returns true with the Matter value when it is to be forwarded. */
+bool bZCB_AttributeMapConvert(const tsZCB_AttributeMap *psMap,
+                              uint8_t u8DevIndex,
+                              uint8_t u8ZclType,
+                              uint64_t u64Raw,
+                              int64_t *pi64Value);
+
+/** As bZCB_AttributeMapConvert, but a value equal to the last one forwarded
+ *  is dropped as well. Used when values are read back rather than reported. */
+bool bZCB_AttributeMapDelta(const tsZCB_AttributeMap *psMap,
+                            uint8_t u8DevIndex,
+                            uint8_t u8ZclType,
+                            uint64_t u64Raw,
+                            int64_t *pi64Value);
+
+/** Forget the last forwarded values of a device table entry */
+void vZCB_AttributeMapForget(uint8_t u8DevIndex);
+
+/** Static RAM of the last forwarded values, a row per device table entry */
+uint32_t u32ZCB_AttributeMapRam(void);
+
+#if defined __cplusplus
+}
+#endif
+
+#endif  /* ZCBATTRIBUTEMAP_H */
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
@@ -0,0 +1,399 @@
+/*
+ * Copyright 2021-2023 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+#include "fsl_debug_console.h"
+
+#include <string.h>
+#include <stdbool.h>
+
+#include "ZigbeeConstant.h"
+#include "SerialLink.h"
+#include "ZigbeeDevices.h"
+#include "cmd.h"
+#include "ZcbChannelPlanner.h"
+
+/*
+ * Zigbee channel planner.
+ *
+ * The RW612 runs Wi-Fi on the same 2.4 GHz radio front end, so the channel
+ * the PAN was formed on can end up right under the bridge's own Wi-Fi
+ * channel or under a busy neighbour. The coordinator is asked for an energy
+ * scan of all channels now and then. The energy is smoothed per channel,
+ * channels overlapping the Wi-Fi channel in use are penalised, and the PAN
+ * is moved with a broadcast Mgmt_NWK_Update_req when the current channel is
+ * degraded (coordinator transmit failures) or clearly worse than the best.
+ */
+
+extern tsZbNetworkInfo zbNetworkInfo;
+
+typedef struct
+{
+    uint32_t    u32ScannedChannels;
+    uint16_t    u16TotalTx;
+    uint16_t    u16TxFailures;
+    uint8_t     au8Energy[ZCB_CHANNEL_COUNT];
+} tsZCB_ChannelScan;
+
+static SemaphoreHandle_t xPlannerMutex = NULL;
+static tsZCB_ChannelScan sPendingScan;
+static volatile bool bScanReady;
+
+static uint8_t  au8Energy[ZCB_CHANNEL_COUNT];     /* smoothed */
+static uint32_t u32KnownChannels;
+static uint16_t u16LastTotalTx;
+static uint16_t u16LastTxFailures;
+static uint8_t  u8WifiChannel;
+static TickType_t xNextScan;
+static TickType_t xLastMove;
+static bool bMoved;
+static tsZCB_ChannelPlannerStats sStats;
+
+static void ZCB_HandleNetworkUpdateResponse(void *pvUser, uint16_t u16Length, void *pvMessage);
+
+
+// ------------------------------------------------------------------
+// Scoring
+// ------------------------------------------------------------------
+
+uint16_t u16ZCB_ChannelWifiPenalty(uint8_t u8Channel, uint8_t u8WifiChannel)
+{
+    int32_t i32ZigbeeMHz;
+    int32_t i32WifiMHz;
+    int32_t i32Distance;
+
+    if ((u8WifiChannel == 0) || (u8WifiChannel > 14)
+        || (u8Channel < ZCB_CHANNEL_FIRST) || (u8Channel > ZCB_CHANNEL_LAST)) {
+        return 0;
+    }
+
+    i32ZigbeeMHz = 2405 + 5 * (u8Channel - ZCB_CHANNEL_FIRST);
+    i32WifiMHz   = (u8WifiChannel == 14) ? 2484 : (2407 + 5 * u8WifiChannel);
+    i32Distance  = (i32ZigbeeMHz > i32WifiMHz) ? (i32ZigbeeMHz - i32WifiMHz) : (i32WifiMHz - i32ZigbeeMHz);
+
+    /* A 20 MHz Wi-Fi channel is flat over +-8 MHz and rolls off to +-12 MHz */
+    if (i32Distance <= 8) {
+        return ZCB_CHANNEL_WIFI_PENALTY_CORE;
+    }
+    if (i32Distance <= 12) {
+        return ZCB_CHANNEL_WIFI_PENALTY_EDGE;
+    }
+    return 0;
+}
+
+uint16_t u16ZCB_ChannelScore(uint8_t u8Channel, uint8_t u8Energy, uint8_t u8WifiChannel)
+{
+    uint16_t u16Score = u8Energy;
+
+    u16Score += u16ZCB_ChannelWifiPenalty(u8Channel, u8WifiChannel);
+
+    /* Many regions require reduced transmit power on channel 26 */
+    if (u8Channel == 26) {
+        u16Score += ZCB_CHANNEL_26_PENALTY;
+    }
+    return u16Score;
+}
+
+uint8_t u8ZCB_ChannelPick(const uint8_t au8ChannelEnergy[ZCB_CHANNEL_COUNT],
+                          uint32_t u32ScannedChannels,
+                          uint8_t u8Wifi,
+                          uint16_t *pu16Score)
+{
+    uint8_t u8Best = 0;
+    uint16_t u16BestScore = 0xFFFF;
+    uint16_t u16Score;
+
+    for (uint8_t u8Channel = ZCB_CHANNEL_FIRST; u8Channel <= ZCB_CHANNEL_LAST; u8Channel++)
+    {
+        if (!(u32ScannedChannels & (1UL << u8Channel))) {
+            continue;
+        }
+        u16Score = u16ZCB_ChannelScore(u8Channel, au8ChannelEnergy[u8Channel - ZCB_CHANNEL_FIRST], u8Wifi);
+        if (u16Score < u16BestScore) {
+            u16BestScore = u16Score;
+            u8Best = u8Channel;
+        }
+    }
+
+    if (pu16Score != NULL) {
+        *pu16Score = u16BestScore;
+    }
+    return u8Best;
+}
+
+bool bZCB_ChannelShouldMove(uint16_t u16CurrentScore,
+                            uint16_t u16BestScore,
+                            bool bDegraded)
+{
+    if (u16CurrentScore < u16BestScore + ZCB_CHANNEL_HYSTERESIS) {
+        return false;
+    }
+    return bDegraded || (u16CurrentScore >= ZCB_CHANNEL_BAD_SCORE);
+}
+
+
+// ------------------------------------------------------------------
+// Runtime
+// ------------------------------------------------------------------
+
+static bool bPlannerDegraded(const tsZCB_ChannelScan *psScan)
+{
+    uint16_t u16Total;
+    uint16_t u16Failures;
+
+    /* The counters restart from zero when the coordinator changes channel */
+    if ((psScan->u16TotalTx < u16LastTotalTx) || (psScan->u16TxFailures < u16LastTxFailures)) {
+        u16LastTotalTx    = 0;
+        u16LastTxFailures = 0;
+    }
+    u16Total    = psScan->u16TotalTx - u16LastTotalTx;
+    u16Failures = psScan->u16TxFailures - u16LastTxFailures;
+    u16LastTotalTx    = psScan->u16TotalTx;
+    u16LastTxFailures = psScan->u16TxFailures;
+
+    if (u16Total < ZCB_CHANNEL_FAILURE_MIN_TX) {
+        return false;
+    }
+    return ((uint32_t)u16Failures * 100) >= ((uint32_t)u16Total * ZCB_CHANNEL_FAILURE_PERCENT);
+}
+
+static void vPlannerEvaluate(const tsZCB_ChannelScan *psScan)
+{
+    uint8_t u8Current = zbNetworkInfo.u8Channel;
+    uint8_t u8Best;
+    uint16_t u16BestScore;
+    uint16_t u16CurrentScore;
+    bool bDegraded;
+
+    for (uint8_t u8Channel = ZCB_CHANNEL_FIRST; u8Channel <= ZCB_CHANNEL_LAST; u8Channel++)
+    {
+        uint8_t i = u8Channel - ZCB_CHANNEL_FIRST;
+
+        if (!(psScan->u32ScannedChannels & (1UL << u8Channel))) {
+            continue;
+        }
+        if (u32KnownChannels & (1UL << u8Channel)) {
+            /* 3/4 old, 1/4 new, so one busy burst does not move the PAN */
+            au8Energy[i] = (uint8_t)(((uint16_t)au8Energy[i] * 3 + psScan->au8Energy[i] + 2) / 4);
+        } else {
+            au8Energy[i] = psScan->au8Energy[i];
+        }
+    }
+    u32KnownChannels |= psScan->u32ScannedChannels;
+
+    bDegraded = bPlannerDegraded(psScan);
+    if (bDegraded) {
+        sStats.u32Degraded++;
+        PRINTF("\n ### Channel %d degraded, %d%% or more transmit failures\n", u8Current, ZCB_CHANNEL_FAILURE_PERCENT);
+    }
+
+    if ((u8Current < ZCB_CHANNEL_FIRST) || (u8Current > ZCB_CHANNEL_LAST)
+        || !(u32KnownChannels & (1UL << u8Current))) {
+        return;
+    }
+
+    u16CurrentScore = u16ZCB_ChannelScore(u8Current, au8Energy[u8Current - ZCB_CHANNEL_FIRST], u8WifiChannel);
+    u8Best = u8ZCB_ChannelPick(au8Energy, u32KnownChannels, u8WifiChannel, &u16BestScore);
+
+    sStats.u8LastBestChannel   = u8Best;
+    sStats.u16LastBestScore    = u16BestScore;
+    sStats.u16LastCurrentScore = u16CurrentScore;
+
+    if ((u8Best == 0) || (u8Best == u8Current)
+        || !bZCB_ChannelShouldMove(u16CurrentScore, u16BestScore, bDegraded)) {
+        return;
+    }
+
+    if (bMoved && ((xTaskGetTickCount() - xLastMove) < pdMS_TO_TICKS(ZCB_CHANNEL_MIN_MOVE_INTERVAL_MS))) {
+        PRINTF("\n ### Channel %d (score %d) should move to %d (score %d), too soon after last move\n",
+               u8Current, u16CurrentScore, u8Best, u16BestScore);
+        return;
+    }
+
+    PRINTF("\n ### Moving PAN from channel %d (score %d) to %d (score %d)\n",
+           u8Current, u16CurrentScore, u8Best, u16BestScore);
+    eZCB_ChannelPlannerMove(u8Best);
+}
+
+void vZCB_ChannelPlannerInit(void)
+{
+    memset(au8Energy, 0, sizeof(au8Energy));
+    memset(&sStats, 0, sizeof(sStats));
+    u32KnownChannels  = 0;
+    u16LastTotalTx    = 0;
+    u16LastTxFailures = 0;
+    u8WifiChannel     = 0;
+    bScanReady        = false;
+    bMoved            = false;
+    xNextScan         = xTaskGetTickCount() + pdMS_TO_TICKS(ZCB_CHANNEL_SCAN_INTERVAL_MS);
+
+    if (xPlannerMutex == NULL) {
+        xPlannerMutex = xSemaphoreCreateMutex();
+        eSL_AddListener(E_SL_MSG_MANAGEMENT_NETWORK_UPDATE_RESPONSE, ZCB_HandleNetworkUpdateResponse, NULL);
+    }
+}
+
+void vZCB_ChannelPlannerSetWifiChannel(uint8_t u8Wifi)
+{
+    if (u8Wifi > 14) {
+        return;
+    }
+    if (u8Wifi != u8WifiChannel) {
+        u8WifiChannel = u8Wifi;
+        /* Re-evaluate with fresh energy rather than waiting a full interval */
+        xNextScan = xTaskGetTickCount();
+    }
+}
+
+teZcbStatus eZCB_ChannelPlannerScan(void)
+{
+    teZcbStatus eStatus;
+
+    xNextScan = xTaskGetTickCount() + pdMS_TO_TICKS(ZCB_CHANNEL_SCAN_INTERVAL_MS);
+
+    eStatus = eMgmtNetworkUpdateRequest(0x0000, ZCB_CHANNEL_ALL_MASK, ZCB_CHANNEL_SCAN_DURATION, 1, 0x0000);
+    if (eStatus != E_ZCB_OK) {
+        sStats.u32ScanFailures++;
+    }
+    return eStatus;
+}
+
+teZcbStatus eZCB_ChannelPlannerMove(uint8_t u8Channel)
+{
+    teZcbStatus eStatus;
+
+    if (u8Channel == 0) {
+        u8Channel = u8ZCB_ChannelPick(au8Energy, u32KnownChannels, u8WifiChannel, NULL);
+    }
+    if ((u8Channel < ZCB_CHANNEL_FIRST) || (u8Channel > ZCB_CHANNEL_LAST)) {
+        return E_ZCB_INVALID_VALUE;
+    }
+
+    /* Scan duration 0xFE is a channel change, sent to all rx-on-when-idle nodes */
+    eStatus = eMgmtNetworkUpdateRequest(E_ZB_BROADCAST_ADDRESS_RXONWHENIDLE, 1UL << u8Channel, 0xFE, 0, 0x0000);
+    if (eStatus != E_ZCB_OK) {
+        PRINTF("\n ### Channel change to %d failed\n", u8Channel);
+        return eStatus;
+    }
+
+    /* Also the channel to form on after a factory reset */
+    eSetChannelMask(1UL << u8Channel);
+
+    zbNetworkInfo.u8Channel = u8Channel;
+    xLastMove = xTaskGetTickCount();
+    bMoved = true;
+    sStats.u32Moves++;
+    return E_ZCB_OK;
+}
+
+void vZCB_ChannelPlannerPoll(void)
+{
+    tsZCB_ChannelScan sScan;
+
+    if (xPlannerMutex == NULL) {
+        return;
+    }
+
+    if (bScanReady) {
+        xSemaphoreTake(xPlannerMutex, portMAX_DELAY);
+        sScan = sPendingScan;
+        bScanReady = false;
+        xSemaphoreGive(xPlannerMutex);
+
+        vPlannerEvaluate(&sScan);
+        return;
+    }
+
+    if (zbNetworkInfo.eNetworkState != E_ZB_NETWORK_STATE_NWK_FORMED) {
+        return;
+    }
+
+    if ((int32_t)(xTaskGetTickCount() - xNextScan) >= 0) {
+        eZCB_ChannelPlannerScan();
+    }
+}
+
+void vZCB_ChannelPlannerDump(void)
+{
+    uint8_t u8Current = zbNetworkInfo.u8Channel;
+
+    PRINTF("\n Channel  Energy  WiFi  Score\n");
+    for (uint8_t u8Channel = ZCB_CHANNEL_FIRST; u8Channel <= ZCB_CHANNEL_LAST; u8Channel++)
+    {
+        uint8_t u8Energy = au8Energy[u8Channel - ZCB_CHANNEL_FIRST];
+
+        if (!(u32KnownChannels & (1UL << u8Channel))) {
+            PRINTF(" %c%2d      -       -     -\n", (u8Channel == u8Current) ? '*' : ' ', u8Channel);
+            continue;
+        }
+        PRINTF(" %c%2d      %3d     %3d   %3d\n", (u8Channel == u8Current) ? '*' : ' ', u8Channel, u8Energy,
+               u16ZCB_ChannelWifiPenalty(u8Channel, u8WifiChannel),
+               u16ZCB_ChannelScore(u8Channel, u8Energy, u8WifiChannel));
+    }
+    PRINTF(" Wi-Fi channel %d, scans %d, degraded %d, moves %d\n",
+           u8WifiChannel, sStats.u32Scans, sStats.u32Degraded, sStats.u32Moves);
+}
+
+void vZCB_ChannelPlannerGetStats(tsZCB_ChannelPlannerStats *psStats)
+{
+    if (psStats != NULL) {
+        *psStats = sStats;
+    }
+}
+
+static void ZCB_HandleNetworkUpdateResponse(void *pvUser, uint16_t u16Length, void *pvMessage)
+{
+    struct _tsNetworkUpdateResponse {
+        uint8_t     u8SequenceNumber;
+        uint8_t     u8Status;
+        uint16_t    u16TotalTransmission;
+        uint16_t    u16TransmissionFailures;
+        uint32_t    u32ScannedChannels;
+        uint8_t     u8ScannedChannelListCount;
+        uint8_t     au8Channels[];
+    } PACKED *psMessage = (struct _tsNetworkUpdateResponse *)pvMessage;
+    uint32_t u32Scanned;
+    uint8_t u8Entry = 0;
+
+    if ((u16Length < sizeof(struct _tsNetworkUpdateResponse))
+        || (u16Length < sizeof(struct _tsNetworkUpdateResponse) + psMessage->u8ScannedChannelListCount)) {
+        return;
+    }
+    if (psMessage->u8Status != 0) {
+        sStats.u32ScanFailures++;
+        PRINTF("\n ### Energy scan failed, status 0x%x\n", psMessage->u8Status);
+        return;
+    }
+
+    u32Scanned = pri_ntohl(psMessage->u32ScannedChannels);
+
+    xSemaphoreTake(xPlannerMutex, portMAX_DELAY);
+    memset(&sPendingScan, 0, sizeof(sPendingScan));
+    sPendingScan.u16TotalTx    = pri_ntohs(psMessage->u16TotalTransmission);
+    sPendingScan.u16TxFailures = pri_ntohs(psMessage->u16TransmissionFailures);
+
+    /* One energy value per channel set in the mask, lowest channel first */
+    for (uint8_t u8Channel = ZCB_CHANNEL_FIRST;
+         (u8Channel <= ZCB_CHANNEL_LAST) && (u8Entry < psMessage->u8ScannedChannelListCount);
+         u8Channel++)
+    {
+        if (u32Scanned & (1UL << u8Channel)) {
+            sPendingScan.au8Energy[u8Channel - ZCB_CHANNEL_FIRST] = psMessage->au8Channels[u8Entry++];
+            sPendingScan.u32ScannedChannels |= (1UL << u8Channel);
+        }
+    }
+    bScanReady = true;
+    sStats.u32Scans++;
+    xSemaphoreGive(xPlannerMutex);
+}
+
+// ------------------------------------------------------------------
+// END OF FILE
+// ------------------------------------------------------------------
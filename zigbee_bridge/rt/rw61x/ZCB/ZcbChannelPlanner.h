@@ -0,0 +1,130 @@
+/*
+ * Copyright 2021-2023 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef ZCBCHANNELPLANNER_H
+#define ZCBCHANNELPLANNER_H
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+/****************************************************************************/
+/***        Include files                                                 ***/
+/****************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "zcb.h"
+
+/****************************************************************************/
+/***        Macro Definitions                                             ***/
+/****************************************************************************/
+
+#define ZCB_CHANNEL_FIRST                       11
+#define ZCB_CHANNEL_LAST                        26
+#define ZCB_CHANNEL_COUNT                       (ZCB_CHANNEL_LAST - ZCB_CHANNEL_FIRST + 1)
+#define ZCB_CHANNEL_ALL_MASK                    0x07FFF800
+
+/* Time between two background energy scans */
+#define ZCB_CHANNEL_SCAN_INTERVAL_MS            (15 * 60 * 1000)
+/* Energy scan duration exponent per channel, (2^n + 1) superframes */
+#define ZCB_CHANNEL_SCAN_DURATION               3
+/* Coordinator transmit failure ratio which marks the channel as degraded */
+#define ZCB_CHANNEL_FAILURE_PERCENT             20
+/* ... only taken into account over at least this many transmissions */
+#define ZCB_CHANNEL_FAILURE_MIN_TX              50
+/* Score from which the current channel is bad even without failures */
+#define ZCB_CHANNEL_BAD_SCORE                   160
+/* A channel must score this much better before the PAN moves to it */
+#define ZCB_CHANNEL_HYSTERESIS                  40
+/* Shortest time between two channel moves */
+#define ZCB_CHANNEL_MIN_MOVE_INTERVAL_MS        (60 * 60 * 1000)
+
+/* Score penalties, the energy itself scores 0..255 */
+#define ZCB_CHANNEL_WIFI_PENALTY_CORE           128
+#define ZCB_CHANNEL_WIFI_PENALTY_EDGE           48
+#define ZCB_CHANNEL_26_PENALTY                  24
+
+
+/****************************************************************************/
+/***        Type Definitions                                              ***/
+/****************************************************************************/
+
+typedef struct
+{
+    uint32_t u32Scans;            /**< Energy scan results received */
+    uint32_t u32ScanFailures;     /**< Scan requests not sent or failed */
+    uint32_t u32Degraded;         /**< Scans which found the channel degraded */
+    uint32_t u32Moves;            /**< Channel changes done by the planner */
+    uint8_t  u8LastBestChannel;   /**< Best channel of the last evaluation */
+    uint16_t u16LastBestScore;
+    uint16_t u16LastCurrentScore;
+} tsZCB_ChannelPlannerStats;
+
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+
+/*
+ * Scoring, no RTOS or coordinator dependency so it can be run against
+ * recorded or synthetic scan results. Lower scores are better.
+ */
+
+/** Penalty of a Zigbee channel for overlapping a Wi-Fi channel (0 = none) */
+uint16_t u16ZCB_ChannelWifiPenalty(uint8_t u8Channel, uint8_t u8WifiChannel);
+
+/** Score of one channel from its energy and the Wi-Fi channel in use */
+uint16_t u16ZCB_ChannelScore(uint8_t u8Channel, uint8_t u8Energy, uint8_t u8WifiChannel);
+
+/** Best scored channel among the scanned ones, 0 when none was scanned */
+uint8_t u8ZCB_ChannelPick(const uint8_t au8Energy[ZCB_CHANNEL_COUNT],
+                          uint32_t u32ScannedChannels,
+                          uint8_t u8WifiChannel,
+                          uint16_t *pu16Score);
+
+/** True when the PAN should move from the current channel to the best one */
+bool bZCB_ChannelShouldMove(uint16_t u16CurrentScore,
+                            uint16_t u16BestScore,
+                            bool bDegraded);
+
+
+/*
+ * Runtime
+ */
+
+void vZCB_ChannelPlannerInit(void);
+
+/** Wi-Fi channel (1..14) used by the bridge, 0 when not connected or on
+ *  5 GHz. Set from the Wi-Fi connectivity events of the Matter stack, and
+ *  by hand with zb-nwk-chplan wifi. */
+void vZCB_ChannelPlannerSetWifiChannel(uint8_t u8WifiChannel);
+
+/** Start an energy scan now instead of waiting for the next interval */
+teZcbStatus eZCB_ChannelPlannerScan(void);
+
+/** Move the PAN to a channel, 0 picks the best channel of the last scan */
+teZcbStatus eZCB_ChannelPlannerMove(uint8_t u8Channel);
+
+/** Scan and move when needed, called from the ZCB service task */
+void vZCB_ChannelPlannerPoll(void);
+
+/** Print the smoothed energy and score of every channel */
+void vZCB_ChannelPlannerDump(void);
+
+void vZCB_ChannelPlannerGetStats(tsZCB_ChannelPlannerStats *psStats);
+
+#if defined __cplusplus
+}
+#endif
+
+#endif  /* ZCBCHANNELPLANNER_H */
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
@@ -0,0 +1,458 @@
+/*
+ * Copyright 2021-2023 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+#include "fsl_debug_console.h"
+
+#include <string.h>
+#include <stdbool.h>
+
+#include "ZigbeeConstant.h"
+#include "ZigbeeDevices.h"
+#include "cmd.h"
+#include "ZcbAddrCache.h"
+#include "ZcbTopology.h"
+#include "ZcbDiscovery.h"
+
+/*
+ * Discovery of nodes already in the network.
+ *
+ * Nodes are normally learnt from their device announce, which is only sent
+ * when they join or rejoin. After a coordinator migration or with the joined
+ * node list lost, nodes keep working on the network but the bridge never
+ * hears about them. A sweep, run once the network is up and from the shell,
+ * finds them two ways: Match_Desc_req broadcasts for the clusters the bridge
+ * can map, answered by every node awake, and the neighbour tables read by
+ * the topology walk, which also name the sleepy children of each router.
+ *
+ * Every node found goes through a pipeline: its IEEE address is resolved
+ * when only the short address is known, nodes the bridge already has are
+ * skipped, the others are queued for an interview. Interviews run in
+ * parallel, a few at a time and started some time apart so that a large
+ * network does not flood the coordinator; each one is what a device announce
+ * would have started and the node is adopted once it reaches the active
+ * state. The sweep ends when nothing was found for a while and nothing is
+ * left in the pipeline; the time from its start to the last node adopted is
+ * kept.
+ */
+
+/* IEEE address requests sent per poll */
+#define DISC_RESOLVE_PER_POLL       2
+
+typedef enum
+{
+    E_DISC_FREE,
+    E_DISC_NEED_IEEE,           /* short address only, IEEE asked for */
+    E_DISC_QUEUED,              /* waiting for an interview slot */
+    E_DISC_INTERVIEWING,
+    E_DISC_ADOPTED,
+    E_DISC_KNOWN,               /* already known to the bridge */
+    E_DISC_FAILED,
+} teDiscState;
+
+typedef struct
+{
+    teDiscState     eState;
+    uint16_t        u16ShortAddress;
+    uint64_t        u64IeeeAddress;
+    bool            bSleepy;
+    uint8_t         u8Attempts;
+    TickType_t      xStamp;           /* found, or interview started */
+} tsDiscNode;
+
+extern tsZbNetworkInfo zbNetworkInfo;
+
+/* Clusters asked for by the match descriptor broadcasts */
+static const uint16_t au16MatchClusters[] =
+{
+    E_ZB_CLUSTERID_ONOFF,
+    E_ZB_CLUSTERID_MEASUREMENTSENSING_TEMP,
+    E_ZB_CLUSTERID_OCCUPANCYSENSING,
+    E_ZB_CLUSTERID_IAS_ZONE,
+};
+
+static tsDiscNode asNodes[ZCB_DISCOVERY_MAX_NODES];
+static SemaphoreHandle_t xDiscMutex = NULL;
+static tsZCB_DiscoveryStats sStats;
+
+static bool bSweeping;
+static bool bSweepRequested;
+static bool bFirstSweepSet;
+static bool bFirstSweepDone;
+static TickType_t xFirstSweep;
+static TickType_t xSweepStart;
+static TickType_t xLastFound;
+static TickType_t xLastAdopted;
+static TickType_t xNextMatch;
+static TickType_t xNextStart;
+static uint8_t u8MatchStep;
+
+static const char *pcDiscState(teDiscState eState)
+{
+    switch (eState)
+    {
+        case E_DISC_NEED_IEEE:      return "ieee?";
+        case E_DISC_QUEUED:         return "queued";
+        case E_DISC_INTERVIEWING:   return "interview";
+        case E_DISC_ADOPTED:        return "adopted";
+        case E_DISC_KNOWN:          return "known";
+        case E_DISC_FAILED:         return "failed";
+        default:                    return "-";
+    }
+}
+
+static tsDiscNode *psDiscFind(uint16_t u16ShortAddress)
+{
+    for (uint8_t i = 0; i < ZCB_DISCOVERY_MAX_NODES; i++)
+    {
+        if ((asNodes[i].eState != E_DISC_FREE) && (asNodes[i].u16ShortAddress == u16ShortAddress)) {
+            return &asNodes[i];
+        }
+    }
+    return NULL;
+}
+
+static tsDiscNode *psDiscAlloc(void)
+{
+    for (uint8_t i = 0; i < ZCB_DISCOVERY_MAX_NODES; i++)
+    {
+        if (asNodes[i].eState == E_DISC_FREE) {
+            return &asNodes[i];
+        }
+    }
+    return NULL;
+}
+
+/* Called with the mutex held */
+static void vDiscAddLocked(uint16_t u16ShortAddress, uint64_t u64IeeeAddress, bool bSleepy, TickType_t xNow)
+{
+    tsDiscNode *psNode = psDiscFind(u16ShortAddress);
+
+    if (psNode != NULL) {
+        /* A neighbour table may name a node a match response gave without IEEE */
+        if ((psNode->eState == E_DISC_NEED_IEEE) && (u64IeeeAddress != 0)) {
+            psNode->u64IeeeAddress = u64IeeeAddress;
+            psNode->eState = E_DISC_QUEUED;
+        }
+        return;
+    }
+
+    psNode = psDiscAlloc();
+    if (psNode == NULL) {
+        sStats.u32TableFull++;
+        return;
+    }
+
+    memset(psNode, 0, sizeof(tsDiscNode));
+    psNode->u16ShortAddress = u16ShortAddress;
+    psNode->u64IeeeAddress  = u64IeeeAddress;
+    psNode->bSleepy         = bSleepy;
+    psNode->eState          = (u64IeeeAddress != 0) ? E_DISC_QUEUED : E_DISC_NEED_IEEE;
+    psNode->xStamp          = xNow;
+    xLastFound = xNow;
+    sStats.u32Candidates++;
+}
+
+static void vDiscSweepStart(TickType_t xNow)
+{
+    xSemaphoreTake(xDiscMutex, portMAX_DELAY);
+    memset(asNodes, 0, sizeof(asNodes));
+    bSweeping    = true;
+    u8MatchStep  = 0;
+    xNextMatch   = xNow;
+    xNextStart   = xNow;
+    xSweepStart  = xNow;
+    xLastFound   = xNow;
+    xLastAdopted = xNow;
+    sStats.u32Sweeps++;
+    xSemaphoreGive(xDiscMutex);
+
+    /* Neighbour tables come in through the walk, sleepy children included */
+    vZCB_TopologyStartWalk();
+}
+
+/* True once the interview of the node is over */
+static bool bDiscInterviewDone(const tsDiscNode *psNode)
+{
+    tsZbDeviceInfo *psDevice = tZDM_FindDeviceByNodeId(psNode->u16ShortAddress);
+
+    return (psDevice != NULL) && (psDevice->eDeviceState == E_ZB_DEVICE_STATE_ACTIVE);
+}
+
+/* Called with the mutex held; returns the node to interview next, if any */
+static tsDiscNode *psDiscAdvanceLocked(TickType_t xNow, uint16_t *pu16Resolve, uint8_t *pu8Resolve, uint8_t *pu8Busy)
+{
+    tsDiscNode *psStart = NULL;
+    tsZbDeviceInfo *psDevice;
+    uint64_t u64IeeeAddress;
+    uint8_t u8Interviews = 0;
+
+    *pu8Resolve = 0;
+    *pu8Busy = 0;
+
+    for (uint8_t i = 0; i < ZCB_DISCOVERY_MAX_NODES; i++)
+    {
+        tsDiscNode *psNode = &asNodes[i];
+
+        switch (psNode->eState)
+        {
+            case E_DISC_NEED_IEEE:
+                if (bZCB_AddrCacheGetIeee(psNode->u16ShortAddress, &u64IeeeAddress)) {
+                    psNode->u64IeeeAddress = u64IeeeAddress;
+                    psNode->eState = E_DISC_QUEUED;
+                } else if ((xNow - psNode->xStamp) >= pdMS_TO_TICKS(ZCB_DISCOVERY_IEEE_TIMEOUT_MS)) {
+                    psNode->eState = E_DISC_FAILED;
+                    sStats.u32Failed++;
+                    break;
+                } else {
+                    if (*pu8Resolve < DISC_RESOLVE_PER_POLL) {
+                        pu16Resolve[(*pu8Resolve)++] = psNode->u16ShortAddress;
+                    }
+                    (*pu8Busy)++;
+                    break;
+                }
+                /* Fall through */
+
+            case E_DISC_QUEUED:
+                psDevice = tZDM_FindDeviceByIeeeAddress(psNode->u64IeeeAddress);
+                if ((psDevice != NULL)
+                    && ((psDevice->eDeviceState == E_ZB_DEVICE_STATE_ACTIVE)
+                        || (psDevice->eDeviceState == E_ZB_DEVICE_STATE_OFF_LINE))) {
+                    psNode->eState = E_DISC_KNOWN;
+                    sStats.u32AlreadyKnown++;
+                    break;
+                }
+                if (psStart == NULL) {
+                    psStart = psNode;
+                }
+                (*pu8Busy)++;
+                break;
+
+            case E_DISC_INTERVIEWING:
+                if (bDiscInterviewDone(psNode)) {
+                    psNode->eState = E_DISC_ADOPTED;
+                    xLastAdopted = xNow;
+                    sStats.u32Adopted++;
+                    break;
+                }
+                if ((xNow - psNode->xStamp) >= pdMS_TO_TICKS(ZCB_DISCOVERY_INTERVIEW_TIMEOUT_MS)) {
+                    if (psNode->u8Attempts >= ZCB_DISCOVERY_INTERVIEW_ATTEMPTS) {
+                        psNode->eState = E_DISC_FAILED;
+                        sStats.u32Failed++;
+                        break;
+                    }
+                    /* Queued again, it goes behind the nodes waiting */
+                    psNode->eState = E_DISC_QUEUED;
+                    (*pu8Busy)++;
+                    break;
+                }
+                u8Interviews++;
+                (*pu8Busy)++;
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    if (u8Interviews > sStats.u8PeakInterviews) {
+        sStats.u8PeakInterviews = u8Interviews;
+    }
+    if ((u8Interviews >= ZCB_DISCOVERY_MAX_INTERVIEWS) || ((int32_t)(xNow - xNextStart) < 0)) {
+        return NULL;
+    }
+    return psStart;
+}
+
+static void vDiscSweepEnd(void)
+{
+    uint8_t u8Adopted = 0;
+
+    for (uint8_t i = 0; i < ZCB_DISCOVERY_MAX_NODES; i++)
+    {
+        if (asNodes[i].eState == E_DISC_ADOPTED) {
+            u8Adopted++;
+        }
+    }
+
+    sStats.u8LastNodes = u8Adopted;
+    sStats.u32LastAdoptionMs = u8Adopted ? (uint32_t)((xLastAdopted - xSweepStart) * portTICK_PERIOD_MS) : 0;
+    bSweeping = false;
+
+    PRINTF("\n ### Discovery: %d node(s) adopted in %d ms, %d interview(s) at most at once\n",
+           sStats.u8LastNodes, (int)sStats.u32LastAdoptionMs, sStats.u8PeakInterviews);
+}
+
+void vZCB_DiscoveryInit(void)
+{
+    memset(&sStats, 0, sizeof(sStats));
+    memset(asNodes, 0, sizeof(asNodes));
+    bSweeping       = false;
+    bSweepRequested = false;
+    bFirstSweepSet  = false;
+    bFirstSweepDone = false;
+
+    if (xDiscMutex == NULL) {
+        xDiscMutex = xSemaphoreCreateMutex();
+    }
+}
+
+void vZCB_DiscoveryStart(void)
+{
+    bSweepRequested = true;
+}
+
+static void vDiscNodeSeen(uint16_t u16ShortAddress, uint64_t u64IeeeAddress, bool bSleepy, uint32_t *pu32Counter)
+{
+    if (xDiscMutex == NULL) {
+        return;
+    }
+    /* The coordinator itself and broadcast addresses are not nodes to adopt */
+    if ((u16ShortAddress == 0x0000) || (u16ShortAddress >= E_ZB_BROADCAST_ADDRESS_LOWPOWERROUTERS)) {
+        return;
+    }
+
+    xSemaphoreTake(xDiscMutex, portMAX_DELAY);
+    (*pu32Counter)++;
+    vDiscAddLocked(u16ShortAddress, u64IeeeAddress, bSleepy, xTaskGetTickCount());
+    xSemaphoreGive(xDiscMutex);
+}
+
+void vZCB_DiscoveryMatchResponse(uint16_t u16ShortAddress)
+{
+    /* It answered a broadcast to the nodes awake */
+    vDiscNodeSeen(u16ShortAddress, 0, false, &sStats.u32MatchResponses);
+}
+
+void vZCB_DiscoveryNeighbour(uint16_t u16ShortAddress, uint64_t u64IeeeAddress, bool bSleepy)
+{
+    vDiscNodeSeen(u16ShortAddress, u64IeeeAddress, bSleepy, &sStats.u32Neighbours);
+}
+
+void vZCB_DiscoveryPoll(void)
+{
+    uint16_t au16Resolve[DISC_RESOLVE_PER_POLL];
+    tsDiscNode *psStart;
+    tsDiscNode sStart;
+    TickType_t xNow;
+    uint8_t u8Resolve;
+    uint8_t u8Busy;
+    teZcbStatus eStatus;
+
+    if (xDiscMutex == NULL) {
+        return;
+    }
+
+    xNow = xTaskGetTickCount();
+    if (zbNetworkInfo.eNetworkState == E_ZB_NETWORK_STATE_NWK_FORMED) {
+        if (!bFirstSweepSet) {
+            xFirstSweep = xNow + pdMS_TO_TICKS(ZCB_DISCOVERY_FIRST_SWEEP_MS);
+            bFirstSweepSet = true;
+        } else if (!bFirstSweepDone && ((int32_t)(xNow - xFirstSweep) >= 0)) {
+            bFirstSweepDone = true;
+            bSweepRequested = true;
+        }
+    } else {
+        return;
+    }
+    if (bSweepRequested && !bSweeping) {
+        bSweepRequested = false;
+        vDiscSweepStart(xNow);
+    }
+    if (!bSweeping) {
+        return;
+    }
+
+    /* One broadcast per cluster, the network only takes a few at a time */
+    if ((u8MatchStep < sizeof(au16MatchClusters) / sizeof(au16MatchClusters[0]))
+        && ((int32_t)(xNow - xNextMatch) >= 0)) {
+        if (eMatchDescriptorRequest(E_ZB_BROADCAST_ADDRESS_RXONWHENIDLE, E_ZB_PROFILEID_HA,
+                                    1, au16MatchClusters[u8MatchStep], 0, 0) == E_ZCB_OK) {
+            sStats.u32MatchRequests++;
+        }
+        u8MatchStep++;
+        xNextMatch = xNow + pdMS_TO_TICKS(ZCB_DISCOVERY_MATCH_INTERVAL_MS);
+    }
+
+    xSemaphoreTake(xDiscMutex, portMAX_DELAY);
+    psStart = psDiscAdvanceLocked(xNow, au16Resolve, &u8Resolve, &u8Busy);
+    if (psStart != NULL) {
+        psStart->eState = E_DISC_INTERVIEWING;
+        psStart->xStamp = xNow;
+        psStart->u8Attempts++;
+        sStart = *psStart;
+        xNextStart = xNow + pdMS_TO_TICKS(ZCB_DISCOVERY_START_INTERVAL_MS);
+        sStats.u32Interviews++;
+    }
+    if ((u8Busy == 0) && (u8MatchStep >= sizeof(au16MatchClusters) / sizeof(au16MatchClusters[0]))
+        && ((xNow - xLastFound) >= pdMS_TO_TICKS(ZCB_DISCOVERY_QUIET_MS))) {
+        vDiscSweepEnd();
+    }
+    xSemaphoreGive(xDiscMutex);
+
+    for (uint8_t i = 0; i < u8Resolve; i++)
+    {
+        (void)eZCB_AddrCacheResolve(au16Resolve[i]);
+    }
+
+    if (psStart != NULL) {
+        eStatus = eZCB_NodeAdopt(sStart.u16ShortAddress, sStart.u64IeeeAddress, sStart.bSleepy);
+        if (eStatus == E_ZCB_INSUFFICIENT_SPACE) {
+            /* No room left on the bridge, the node stays unadopted */
+            xSemaphoreTake(xDiscMutex, portMAX_DELAY);
+            psStart->eState = E_DISC_FAILED;
+            sStats.u32Failed++;
+            sStats.u32TableFull++;
+            xSemaphoreGive(xDiscMutex);
+        }
+    }
+}
+
+void vZCB_DiscoveryDump(void)
+{
+    if (xDiscMutex == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(xDiscMutex, portMAX_DELAY);
+    PRINTF("\n Discovery: %d sweep(s)%s, last adopted %d node(s) in %d ms\n",
+           (int)sStats.u32Sweeps, bSweeping ? " (sweep running)" : "",
+           sStats.u8LastNodes, (int)sStats.u32LastAdoptionMs);
+    PRINTF(" Match %d/%d, neighbours %d, found %d, known %d, interviews %d (peak %d), adopted %d, failed %d, full %d\n",
+           (int)sStats.u32MatchResponses, (int)sStats.u32MatchRequests, (int)sStats.u32Neighbours,
+           (int)sStats.u32Candidates, (int)sStats.u32AlreadyKnown, (int)sStats.u32Interviews,
+           sStats.u8PeakInterviews, (int)sStats.u32Adopted, (int)sStats.u32Failed, (int)sStats.u32TableFull);
+    PRINTF(" Node   IEEE             S Try State\n");
+    for (uint8_t i = 0; i < ZCB_DISCOVERY_MAX_NODES; i++)
+    {
+        if (asNodes[i].eState == E_DISC_FREE) {
+            continue;
+        }
+        PRINTF(" 0x%04x %016llx %c %3d %s\n", asNodes[i].u16ShortAddress, asNodes[i].u64IeeeAddress,
+               asNodes[i].bSleepy ? 'Z' : '-', asNodes[i].u8Attempts, pcDiscState(asNodes[i].eState));
+    }
+    xSemaphoreGive(xDiscMutex);
+}
+
+void vZCB_DiscoveryGetStats(tsZCB_DiscoveryStats *psStats)
+{
+    if (psStats != NULL) {
+        *psStats = sStats;
+    }
+}
+
+uint32_t u32ZCB_DiscoveryRam(void)
+{
+    return sizeof(asNodes);
+}
+
+// ------------------------------------------------------------------
+// END OF FILE
+// ------------------------------------------------------------------
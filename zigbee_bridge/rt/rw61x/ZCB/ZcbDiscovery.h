@@ -0,0 +1,103 @@
+/*
+ * Copyright 2021-2023 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef ZCBDISCOVERY_H
+#define ZCBDISCOVERY_H
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+/****************************************************************************/
+/***        Include files                                                 ***/
+/****************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "zcb.h"
+
+/****************************************************************************/
+/***        Macro Definitions                                             ***/
+/****************************************************************************/
+
+/* Nodes found by one sweep, as many as the bridge keeps */
+#define ZCB_DISCOVERY_MAX_NODES                 ZB_BRIDGE_MAX_NODES
+/* First sweep after the network is up */
+#define ZCB_DISCOVERY_FIRST_SWEEP_MS            (10 * 1000)
+/* Gap between the match descriptor broadcasts of a sweep */
+#define ZCB_DISCOVERY_MATCH_INTERVAL_MS         1000
+/* Interviews running at the same time ... */
+#define ZCB_DISCOVERY_MAX_INTERVIEWS            4
+/* ... and started no closer together than this */
+#define ZCB_DISCOVERY_START_INTERVAL_MS         250
+/* An interview not finished within this time is started again */
+#define ZCB_DISCOVERY_INTERVIEW_TIMEOUT_MS      (15 * 1000)
+#define ZCB_DISCOVERY_INTERVIEW_ATTEMPTS        2
+/* A node whose IEEE address is still unknown after this time is dropped */
+#define ZCB_DISCOVERY_IEEE_TIMEOUT_MS           (20 * 1000)
+/* The sweep is over once no new node was found for this time */
+#define ZCB_DISCOVERY_QUIET_MS                  (15 * 1000)
+
+
+/****************************************************************************/
+/***        Type Definitions                                              ***/
+/****************************************************************************/
+
+typedef struct
+{
+    uint32_t u32Sweeps;           /**< Sweeps started */
+    uint32_t u32MatchRequests;    /**< Match_Desc_req broadcasts sent */
+    uint32_t u32MatchResponses;   /**< Match_Desc_rsp naming a node */
+    uint32_t u32Neighbours;       /**< Neighbour table entries seen */
+    uint32_t u32Candidates;       /**< Nodes new to the sweep */
+    uint32_t u32AlreadyKnown;     /**< Found nodes the bridge already had */
+    uint32_t u32Interviews;       /**< Interviews started, retries included */
+    uint32_t u32Adopted;          /**< Interviews finished */
+    uint32_t u32Failed;           /**< Nodes given up */
+    uint32_t u32TableFull;        /**< Nodes not kept, no room */
+    uint8_t  u8PeakInterviews;    /**< Most interviews running at once */
+    uint8_t  u8LastNodes;         /**< Nodes adopted by the last sweep */
+    uint32_t u32LastAdoptionMs;   /**< Sweep start to last node adopted */
+} tsZCB_DiscoveryStats;
+
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+
+void vZCB_DiscoveryInit(void);
+
+/** Start a sweep now instead of waiting for the first one */
+void vZCB_DiscoveryStart(void);
+
+/** A node answered a match descriptor broadcast; its IEEE address is asked for */
+void vZCB_DiscoveryMatchResponse(uint16_t u16ShortAddress);
+
+/** A node was named by the neighbour table of a router or the coordinator */
+void vZCB_DiscoveryNeighbour(uint16_t u16ShortAddress, uint64_t u64IeeeAddress, bool bSleepy);
+
+/** Called from the ZCB service task */
+void vZCB_DiscoveryPoll(void);
+
+/** Print the nodes of the last sweep and the adoption time */
+void vZCB_DiscoveryDump(void);
+
+void vZCB_DiscoveryGetStats(tsZCB_DiscoveryStats *psStats);
+
+/** Static RAM of the sweep table */
+uint32_t u32ZCB_DiscoveryRam(void);
+
+#if defined __cplusplus
+}
+#endif
+
+#endif  /* ZCBDISCOVERY_H */
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
@@ -0,0 +1,615 @@
+/*
+ * Copyright 2021-2023 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "semphr.h"
+
+#include "fsl_debug_console.h"
+
+#include <string.h>
+#include <stdbool.h>
+
+#include "SerialLink.h"
+#include "ZigbeeConstant.h"
+#include "ZigbeeDevices.h"
+#include "ZcbAddrCache.h"
+#include "ZcbIasZone.h"
+#include "ZcbMessage.h"
+#include "ZcbSnapshot.h"
+#include "cmd.h"
+
+/*
+ * IAS Zone sensors: door contacts, motion, water and smoke detectors.
+ *
+ * A zone is enrolled as soon as its node is interviewed: the bridge writes
+ * its own IEEE address as the IAS CIE address and reads the zone type, which
+ * picks the Matter device the node is bridged as. Once the node has answered
+ * the write with success it is sent an unsolicited Enroll Response with a
+ * zone ID of the bridge's choice; a node which asks with a Zone Enroll
+ * Request, after the write or after a restart of the bridge, is answered the
+ * same way. Enrolment is repeated from the service task until the zone is
+ * heard from.
+ *
+ * Zone status changes are alarms and take their own lane to the bridge. The
+ * notification is a priority listener run on the serial read task itself, so
+ * it is not queued behind logs and attribute reports; it only timestamps the
+ * frame and puts it on a queue of its own, and never waits for a lock there.
+ * The bridge task reading the queue finds the sender, by its IEEE address
+ * when the frame has one, updates the zone table and hands the change to the
+ * Matter thread. The time from the frame being read to the Matter report is
+ * kept for every change.
+ */
+
+typedef enum
+{
+    E_IAS_ZONE_FREE,
+    E_IAS_ZONE_NEW,             /* found, nothing sent yet */
+    E_IAS_ZONE_ENROLLING,       /* enroll response sent, not heard from yet */
+    E_IAS_ZONE_ENROLLED,
+    E_IAS_ZONE_FAILED,          /* never heard from, given up */
+} teIasZoneState;
+
+typedef struct
+{
+    teIasZoneState  eState;
+    uint16_t        u16ShortAddress;
+    uint8_t         u8Endpoint;
+    uint8_t         u8Attempts;
+    uint16_t        u16ZoneType;
+    uint16_t        u16ZoneStatus;
+    TickType_t      xEnrollDeadline;
+    TickType_t      xTypeDeadline;
+    bool            bAddPending;    /* bridge endpoint not added yet */
+    bool            bResponseDue;   /* CIE address written or enrolment asked for */
+    newdb_zcb_t     sZcb;           /* node record handed to the bridge when added */
+} tsIasZone;
+
+extern tsZbNetworkInfo zbNetworkInfo;
+
+static tsIasZone asZones[ZCB_IAS_ZONE_MAX];
+static tsZCB_IasZoneStats sStats;
+static SemaphoreHandle_t xIasZoneMutex;
+static QueueHandle_t xIasZoneQueue;
+/* Counted by the read task while the mutex was busy, added to sStats the
+ * next time it is free; written by the read task only */
+static uint32_t u32PendingNotifications;
+static uint32_t u32PendingDropped;
+
+
+static uint16_t u16IasRead16(const uint8_t *pu8Data)
+{
+    return (uint16_t)((pu8Data[0] << 8) | pu8Data[1]);
+}
+
+static uint64_t u64IasRead64(const uint8_t *pu8Data)
+{
+    uint64_t u64Value = 0;
+
+    for (uint8_t i = 0; i < 8; i++) {
+        u64Value = (u64Value << 8) | pu8Data[i];
+    }
+    return u64Value;
+}
+
+/* Mutex held */
+static tsIasZone *psIasZoneFind(uint16_t u16ShortAddress, uint8_t u8Endpoint)
+{
+    for (uint8_t i = 0; i < ZCB_IAS_ZONE_MAX; i++)
+    {
+        if ((asZones[i].eState != E_IAS_ZONE_FREE)
+            && (asZones[i].u16ShortAddress == u16ShortAddress)
+            && (asZones[i].u8Endpoint == u8Endpoint)) {
+            return &asZones[i];
+        }
+    }
+    return NULL;
+}
+
+/* Mutex held, the zone ID given to the node is the table index */
+static tsIasZone *psIasZoneAlloc(uint16_t u16ShortAddress, uint8_t u8Endpoint)
+{
+    tsIasZone *psZone = psIasZoneFind(u16ShortAddress, u8Endpoint);
+
+    if (psZone != NULL) {
+        return psZone;
+    }
+    for (uint8_t i = 0; i < ZCB_IAS_ZONE_MAX; i++)
+    {
+        if (asZones[i].eState == E_IAS_ZONE_FREE) {
+            memset(&asZones[i], 0, sizeof(asZones[i]));
+            asZones[i].u16ShortAddress = u16ShortAddress;
+            asZones[i].u8Endpoint      = u8Endpoint;
+            asZones[i].u16ZoneType     = ZCB_IAS_ZONE_TYPE_UNKNOWN;
+            return &asZones[i];
+        }
+    }
+    sStats.u32TableFull++;
+    return NULL;
+}
+
+/* Runs on the serial read task: no sending on the serial link from here, and
+ * no lock waited for */
+static void vIasZoneStatusChangeNotify(void *pvUser, uint16_t u16Length, void *pvMessage)
+{
+    const uint8_t *pu8Message = (const uint8_t *)pvMessage;
+    tsZCB_IasZoneEvent sEvent;
+    tsZCB_IasZoneEvent sOldest;
+    uint16_t u16Offset;
+    uint8_t u8AddrMode;
+
+    sEvent.u32ArrivalTick = xTaskGetTickCount();
+
+    /* Sequence number, endpoint, cluster, address mode, address,
+     * zone status, extended status, zone ID, delay */
+    if ((xIasZoneQueue == NULL) || (u16Length < 7)) {
+        return;
+    }
+    sEvent.u8Endpoint = pu8Message[1];
+    u8AddrMode        = pu8Message[4];
+    u16Offset         = 5;
+
+    /* The IEEE address is turned into the short one by the bridge task */
+    if ((u8AddrMode == E_ZD_ADDRESS_MODE_IEEE) || (u8AddrMode == E_ZD_ADDRESS_MODE_IEEE_NO_ACK)) {
+        if (u16Length < u16Offset + 8 + 4) {
+            return;
+        }
+        sEvent.u64IeeeAddress  = u64IasRead64(&pu8Message[u16Offset]);
+        sEvent.u16ShortAddress = 0;
+        u16Offset += 8;
+    } else {
+        if (u16Length < u16Offset + 2 + 4) {
+            return;
+        }
+        sEvent.u64IeeeAddress  = 0;
+        sEvent.u16ShortAddress = u16IasRead16(&pu8Message[u16Offset]);
+        u16Offset += 2;
+    }
+    sEvent.u16ZoneStatus = u16IasRead16(&pu8Message[u16Offset]);
+    sEvent.u8ZoneId      = pu8Message[u16Offset + 3];
+
+    /* The newest state of a zone matters most, the oldest change makes room;
+     * the read task is the only sender, so nothing gets in between */
+    u32PendingNotifications++;
+    if (xQueueSend(xIasZoneQueue, &sEvent, 0) != pdPASS) {
+        u32PendingDropped++;
+        xQueueReceive(xIasZoneQueue, &sOldest, 0);
+        xQueueSend(xIasZoneQueue, &sEvent, 0);
+    }
+
+    if (xSemaphoreTake(xIasZoneMutex, 0) == pdPASS) {
+        sStats.u32Notifications += u32PendingNotifications;
+        sStats.u32Dropped       += u32PendingDropped;
+        u32PendingNotifications = 0;
+        u32PendingDropped       = 0;
+        xSemaphoreGive(xIasZoneMutex);
+    }
+}
+
+/* Runs on the bridge task: the short address of the sender, from the
+ * snapshot for a node of the device table, else from the address cache */
+static bool bIasZoneResolve(tsZCB_IasZoneEvent *psEvent)
+{
+    tsZCB_SnapshotNode sNode;
+
+    if (psEvent->u64IeeeAddress == 0) {
+        return true;
+    }
+    if (bZCB_SnapshotNodeByIeee(psEvent->u64IeeeAddress, &sNode)) {
+        psEvent->u16ShortAddress = sNode.u16NodeId;
+        return true;
+    }
+    return bZCB_AddrCacheGetNwk(psEvent->u64IeeeAddress, &psEvent->u16ShortAddress);
+}
+
+/* True when the device table has the IAS Zone cluster on the endpoint */
+static bool bIasZoneCapable(uint16_t u16ShortAddress, uint8_t u8Endpoint)
+{
+    bool bCapable;
+
+    vZDM_ArenaLock();
+    bCapable = (tZDM_FindClusterEntryInDeviceTable(u16ShortAddress, u8Endpoint, E_ZB_CLUSTERID_IAS_ZONE) != NULL);
+    vZDM_ArenaUnlock();
+    return bCapable;
+}
+
+static void vIasZoneTypeResponse(void *pvUser, teSL_Status eStatus, uint16_t u16Length, void *pvMessage)
+{
+    const uint8_t *pu8Message = (const uint8_t *)pvMessage;
+    tsIasZone *psZone;
+
+    /* Sequence number, short address, endpoint, cluster, then one record:
+     * attribute, status, type, size, value */
+    if ((eStatus != E_SL_OK) || (u16Length < 14)
+        || (u16IasRead16(&pu8Message[6]) != E_ZB_ATTRIBUTEID_IAS_ZONE_TYPE)
+        || (pu8Message[8] != 0)) {
+        return;
+    }
+
+    xSemaphoreTake(xIasZoneMutex, portMAX_DELAY);
+    psZone = psIasZoneFind(u16IasRead16(&pu8Message[1]), pu8Message[3]);
+    if (psZone != NULL) {
+        psZone->u16ZoneType = u16IasRead16(&pu8Message[12]);
+    }
+    xSemaphoreGive(xIasZoneMutex);
+}
+
+/* Auto-Enroll-Response: the CIE address first, the unsolicited response
+ * goes once the node has answered the write, see vZCB_IasZoneCieWritten() */
+static teZcbStatus eIasZoneWriteCie(uint16_t u16ShortAddress, uint8_t u8Endpoint)
+{
+    return eWriteAttributeRequest(E_ZD_ADDRESS_MODE_SHORT, u16ShortAddress, ZB_ENDPOINT_SRC_DEFAULT, u8Endpoint,
+                                  E_ZB_CLUSTERID_IAS_ZONE, E_ZB_ATTRIBUTEID_IAS_CIE_ADDRESS, E_ZCL_IEEE_ADDR,
+                                  zbNetworkInfo.u64IeeeAddress, 8);
+}
+
+/* A Zone Enroll Request, on the callback task: the node has the CIE address
+ * and asks for a zone ID. Answered from the service task. */
+static void vIasZoneEnrollRequest(void *pvUser, uint16_t u16Length, void *pvMessage)
+{
+    const uint8_t *pu8Message = (const uint8_t *)pvMessage;
+    tsZCB_IasZoneEvent sSender;
+    tsIasZone *psZone;
+    uint16_t u16ZoneType;
+    uint16_t u16Offset = 5;
+    uint8_t u8AddrMode;
+    bool bCapable;
+
+    /* Sequence number, endpoint, cluster, address mode, address, zone type,
+     * manufacturer code */
+    if (u16Length < 7) {
+        return;
+    }
+    memset(&sSender, 0, sizeof(sSender));
+    sSender.u8Endpoint = pu8Message[1];
+    u8AddrMode         = pu8Message[4];
+    if ((u8AddrMode == E_ZD_ADDRESS_MODE_IEEE) || (u8AddrMode == E_ZD_ADDRESS_MODE_IEEE_NO_ACK)) {
+        if (u16Length < u16Offset + 8 + 2) {
+            return;
+        }
+        sSender.u64IeeeAddress = u64IasRead64(&pu8Message[u16Offset]);
+        u16Offset += 8;
+    } else {
+        if (u16Length < u16Offset + 2 + 2) {
+            return;
+        }
+        sSender.u16ShortAddress = u16IasRead16(&pu8Message[u16Offset]);
+        u16Offset += 2;
+    }
+    u16ZoneType = u16IasRead16(&pu8Message[u16Offset]);
+
+    if (!bIasZoneResolve(&sSender)) {
+        xSemaphoreTake(xIasZoneMutex, portMAX_DELAY);
+        sStats.u32Unresolved++;
+        xSemaphoreGive(xIasZoneMutex);
+        return;
+    }
+
+    xSemaphoreTake(xIasZoneMutex, portMAX_DELAY);
+    psZone = psIasZoneFind(sSender.u16ShortAddress, sSender.u8Endpoint);
+    xSemaphoreGive(xIasZoneMutex);
+    bCapable = (psZone != NULL) || bIasZoneCapable(sSender.u16ShortAddress, sSender.u8Endpoint);
+
+    xSemaphoreTake(xIasZoneMutex, portMAX_DELAY);
+    psZone = bCapable ? psIasZoneAlloc(sSender.u16ShortAddress, sSender.u8Endpoint) : NULL;
+    if (psZone != NULL) {
+        if (psZone->eState == E_IAS_ZONE_FREE) {
+            /* A zone enrolled before a restart of the bridge */
+            psZone->eState          = E_IAS_ZONE_ENROLLING;
+            psZone->u8Attempts      = 1;
+            psZone->xEnrollDeadline = xTaskGetTickCount() + pdMS_TO_TICKS(ZCB_IAS_ZONE_ENROLL_RETRY_MS);
+        }
+        if (psZone->u16ZoneType == ZCB_IAS_ZONE_TYPE_UNKNOWN) {
+            psZone->u16ZoneType = u16ZoneType;
+        }
+        psZone->bResponseDue = true;
+        sStats.u32EnrollRequests++;
+    } else if (!bCapable) {
+        sStats.u32NotZone++;
+    }
+    xSemaphoreGive(xIasZoneMutex);
+}
+
+void vZCB_IasZoneInit(void)
+{
+    memset(asZones, 0, sizeof(asZones));
+    memset(&sStats, 0, sizeof(sStats));
+
+    if (xIasZoneMutex == NULL) {
+        xIasZoneMutex = xSemaphoreCreateMutex();
+    }
+    if (xIasZoneQueue == NULL) {
+        xIasZoneQueue = xQueueCreate(ZCB_IAS_ZONE_QUEUE_LENGTH, sizeof(tsZCB_IasZoneEvent));
+        eSL_AddPriorityListener(E_SL_MSG_IAS_ZONE_STATUS_CHANGE_NOTIFY, vIasZoneStatusChangeNotify, NULL);
+        eSL_AddListener(E_SL_MSG_IAS_ZONE_ENROLL_REQUEST, vIasZoneEnrollRequest, NULL);
+    }
+}
+
+bool bZCB_IasZoneNodeFound(uint16_t u16ShortAddress, uint8_t u8Endpoint, const newdb_zcb_t *psZcb)
+{
+    tsIasZone *psZone;
+
+    if ((xIasZoneMutex == NULL) || (psZcb == NULL)) {
+        return false;
+    }
+
+    xSemaphoreTake(xIasZoneMutex, portMAX_DELAY);
+    psZone = psIasZoneAlloc(u16ShortAddress, u8Endpoint);
+    if (psZone != NULL) {
+        psZone->eState      = E_IAS_ZONE_NEW;
+        psZone->u8Attempts  = 0;
+        psZone->bAddPending = true;
+        psZone->sZcb        = *psZcb;
+    }
+    xSemaphoreGive(xIasZoneMutex);
+
+    return (psZone != NULL);
+}
+
+void vZCB_IasZoneCieWritten(uint16_t u16ShortAddress, uint8_t u8Endpoint, uint8_t u8Status)
+{
+    tsIasZone *psZone;
+
+    if (xIasZoneMutex == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(xIasZoneMutex, portMAX_DELAY);
+    psZone = psIasZoneFind(u16ShortAddress, u8Endpoint);
+    if ((psZone != NULL) && (psZone->eState == E_IAS_ZONE_ENROLLING)) {
+        if (u8Status == 0) {
+            psZone->bResponseDue = true;
+        } else {
+            /* Written again on the next attempt */
+            sStats.u32CieRejected++;
+            PRINTF("\n ### IAS zone 0x%04x ep=%d refused the CIE address (0x%02x)\n",
+                   u16ShortAddress, u8Endpoint, u8Status);
+        }
+    }
+    xSemaphoreGive(xIasZoneMutex);
+}
+
+void vZCB_IasZoneForget(uint16_t u16ShortAddress)
+{
+    if (xIasZoneMutex == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(xIasZoneMutex, portMAX_DELAY);
+    for (uint8_t i = 0; i < ZCB_IAS_ZONE_MAX; i++)
+    {
+        if ((asZones[i].eState != E_IAS_ZONE_FREE) && (asZones[i].u16ShortAddress == u16ShortAddress)) {
+            asZones[i].eState = E_IAS_ZONE_FREE;
+        }
+    }
+    xSemaphoreGive(xIasZoneMutex);
+}
+
+bool bZCB_IasZoneEventWait(tsZCB_IasZoneEvent *psEvent, uint32_t u32TimeoutMs)
+{
+    tsIasZone *psZone;
+    bool bCapable;
+
+    if ((psEvent == NULL) || (xIasZoneQueue == NULL)) {
+        return false;
+    }
+    if (xQueueReceive(xIasZoneQueue, psEvent, pdMS_TO_TICKS(u32TimeoutMs)) != pdPASS) {
+        return false;
+    }
+
+    if (!bIasZoneResolve(psEvent)) {
+        xSemaphoreTake(xIasZoneMutex, portMAX_DELAY);
+        sStats.u32Unresolved++;
+        xSemaphoreGive(xIasZoneMutex);
+        return false;
+    }
+
+    xSemaphoreTake(xIasZoneMutex, portMAX_DELAY);
+    psZone = psIasZoneFind(psEvent->u16ShortAddress, psEvent->u8Endpoint);
+    xSemaphoreGive(xIasZoneMutex);
+
+    /* Zones enrolled before a restart of the bridge are learnt here, for the
+     * endpoints the device table has as zones */
+    bCapable = (psZone != NULL) || bIasZoneCapable(psEvent->u16ShortAddress, psEvent->u8Endpoint);
+
+    xSemaphoreTake(xIasZoneMutex, portMAX_DELAY);
+    psZone = bCapable ? psIasZoneAlloc(psEvent->u16ShortAddress, psEvent->u8Endpoint) : NULL;
+    if (psZone != NULL) {
+        if ((psZone->eState == E_IAS_ZONE_ENROLLING) || (psZone->eState == E_IAS_ZONE_FAILED)) {
+            sStats.u32Enrolled++;
+        }
+        if (psZone->eState != E_IAS_ZONE_NEW) {
+            psZone->eState = E_IAS_ZONE_ENROLLED;
+        }
+        psZone->u16ZoneStatus = psEvent->u16ZoneStatus;
+    } else if (!bCapable) {
+        sStats.u32NotZone++;
+    }
+    xSemaphoreGive(xIasZoneMutex);
+
+    return bCapable;
+}
+
+void vZCB_IasZoneDelivered(const tsZCB_IasZoneEvent *psEvent)
+{
+    uint32_t u32LatencyMs;
+
+    if ((psEvent == NULL) || (xIasZoneMutex == NULL)) {
+        return;
+    }
+    u32LatencyMs = (uint32_t)((xTaskGetTickCount() - (TickType_t)psEvent->u32ArrivalTick) * portTICK_PERIOD_MS);
+
+    xSemaphoreTake(xIasZoneMutex, portMAX_DELAY);
+    if ((sStats.u32Delivered == 0) || (u32LatencyMs < sStats.u32LatencyMinMs)) {
+        sStats.u32LatencyMinMs = u32LatencyMs;
+    }
+    if (u32LatencyMs > sStats.u32LatencyMaxMs) {
+        sStats.u32LatencyMaxMs = u32LatencyMs;
+    }
+    sStats.u32LatencyLastMs = u32LatencyMs;
+    sStats.u32LatencySumMs += u32LatencyMs;
+    sStats.u32Delivered++;
+    xSemaphoreGive(xIasZoneMutex);
+}
+
+bool bZCB_IasZoneIsOccupancy(uint16_t u16ZoneType)
+{
+    return u16ZoneType == ZCB_IAS_ZONE_TYPE_MOTION;
+}
+
+void vZCB_IasZonePoll(void)
+{
+    TickType_t xNow = xTaskGetTickCount();
+    uint16_t u16AttributeId = E_ZB_ATTRIBUTEID_IAS_ZONE_TYPE;
+    uint16_t u16ShortAddress;
+    uint8_t u8Endpoint;
+    bool bEnroll;
+    bool bReadType;
+    bool bAdd;
+    bool bRespond;
+    teZcbStatus eStatus;
+    newdb_zcb_t sZcb;
+
+    if (xIasZoneMutex == NULL) {
+        return;
+    }
+
+    for (uint8_t i = 0; i < ZCB_IAS_ZONE_MAX; i++)
+    {
+        tsIasZone *psZone = &asZones[i];
+
+        bEnroll = bReadType = bAdd = bRespond = false;
+
+        xSemaphoreTake(xIasZoneMutex, portMAX_DELAY);
+        if (psZone->eState == E_IAS_ZONE_NEW) {
+            psZone->eState          = E_IAS_ZONE_ENROLLING;
+            psZone->xEnrollDeadline = xNow + pdMS_TO_TICKS(ZCB_IAS_ZONE_ENROLL_RETRY_MS);
+            psZone->xTypeDeadline   = xNow + pdMS_TO_TICKS(ZCB_IAS_ZONE_TYPE_WAIT_MS);
+            psZone->u8Attempts      = 1;
+            bEnroll = bReadType = true;
+        } else if ((psZone->eState == E_IAS_ZONE_ENROLLING)
+                   && ((int32_t)(xNow - psZone->xEnrollDeadline) >= 0)) {
+            if (psZone->u8Attempts < ZCB_IAS_ZONE_ENROLL_ATTEMPTS) {
+                psZone->xEnrollDeadline = xNow + pdMS_TO_TICKS(ZCB_IAS_ZONE_ENROLL_RETRY_MS);
+                psZone->u8Attempts++;
+                bEnroll = true;
+            } else {
+                psZone->eState = E_IAS_ZONE_FAILED;
+                sStats.u32EnrollFailures++;
+            }
+        }
+
+        /* Added once the zone type picks the Matter device, or without it */
+        if (psZone->bAddPending && (psZone->eState != E_IAS_ZONE_FREE)
+            && ((psZone->u16ZoneType != ZCB_IAS_ZONE_TYPE_UNKNOWN)
+                || ((int32_t)(xNow - psZone->xTypeDeadline) >= 0))) {
+            psZone->bAddPending = false;
+            psZone->sZcb.uSupportedClusters.sClusterBitmap.hasIasZone = 1;
+            psZone->sZcb.uSupportedClusters.sClusterBitmap.hasIasOccupancy =
+                bZCB_IasZoneIsOccupancy(psZone->u16ZoneType) ? 1 : 0;
+            sZcb = psZone->sZcb;
+            bAdd = true;
+        }
+        if (psZone->bResponseDue && (psZone->eState != E_IAS_ZONE_FREE)) {
+            psZone->bResponseDue = false;
+            bRespond = true;
+        }
+        u16ShortAddress = psZone->u16ShortAddress;
+        u8Endpoint      = psZone->u8Endpoint;
+        xSemaphoreGive(xIasZoneMutex);
+
+        if (bEnroll) {
+            /* Held for a sleepy node, the write goes and is answered when it wakes */
+            eStatus = eIasZoneWriteCie(u16ShortAddress, u8Endpoint);
+            if (eStatus == E_ZCB_REQUEST_NOT_ACTIONED) {
+                /* The node has a request in flight, not an attempt */
+                xSemaphoreTake(xIasZoneMutex, portMAX_DELAY);
+                if ((psZone->eState == E_IAS_ZONE_ENROLLING) && (psZone->u16ShortAddress == u16ShortAddress)) {
+                    psZone->u8Attempts--;
+                    psZone->xEnrollDeadline = xNow + pdMS_TO_TICKS(ZCB_IAS_ZONE_BUSY_RETRY_MS);
+                }
+                xSemaphoreGive(xIasZoneMutex);
+            } else if ((eStatus != E_ZCB_OK) && (eStatus != E_ZCB_DEFERRED)) {
+                PRINTF("\n ### IAS zone 0x%04x ep=%d: CIE address not sent (%d)\n", u16ShortAddress, u8Endpoint, eStatus);
+            }
+        }
+        if (bRespond) {
+            /* The zone ID given to the node is the table index */
+            eStatus = eIASZoneEnrollResponse(E_ZD_ADDRESS_MODE_SHORT, u16ShortAddress, ZB_ENDPOINT_SRC_DEFAULT,
+                                             u8Endpoint, 0x00, i);
+            if (eStatus == E_ZCB_OK) {
+                xSemaphoreTake(xIasZoneMutex, portMAX_DELAY);
+                sStats.u32Enrolments++;
+                xSemaphoreGive(xIasZoneMutex);
+            }
+        }
+        if (bReadType) {
+            eReadAttributeRequestAsync(u16ShortAddress, ZB_ENDPOINT_SRC_DEFAULT, u8Endpoint,
+                                       E_ZB_CLUSTERID_IAS_ZONE, 1, &u16AttributeId,
+                                       vIasZoneTypeResponse, NULL);
+        }
+        if (bAdd) {
+            vZCB_NodeSetBridgeType(u16ShortAddress, sZcb.uSupportedClusters.sClusterBitmap.hasIasOccupancy
+                                                    ? ZCB_IAS_NODE_TYPE_OCCUPANCY : ZCB_IAS_NODE_TYPE_BOOLEAN);
+            /* Not waited for on the service task, added on a later poll */
+            if (eZCB_PostMsg(BRIDGE_ADD_DEV, &sZcb, NULL) != E_ZCB_OK) {
+                xSemaphoreTake(xIasZoneMutex, portMAX_DELAY);
+                if ((psZone->eState != E_IAS_ZONE_FREE) && (psZone->u16ShortAddress == u16ShortAddress)) {
+                    psZone->bAddPending = true;
+                }
+                xSemaphoreGive(xIasZoneMutex);
+            }
+        }
+    }
+}
+
+void vZCB_IasZoneDump(void)
+{
+    static const char *apcState[] = { "free", "new", "enrolling", "enrolled", "failed" };
+
+    if (xIasZoneMutex == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(xIasZoneMutex, portMAX_DELAY);
+    for (uint8_t i = 0; i < ZCB_IAS_ZONE_MAX; i++)
+    {
+        const tsIasZone *psZone = &asZones[i];
+
+        if (psZone->eState == E_IAS_ZONE_FREE) {
+            continue;
+        }
+        PRINTF("\n ### zone %d: 0x%04x ep=%d %s type=0x%04x status=0x%04x attempts=%d",
+               i, psZone->u16ShortAddress, psZone->u8Endpoint, apcState[psZone->eState],
+               psZone->u16ZoneType, psZone->u16ZoneStatus, psZone->u8Attempts);
+    }
+    PRINTF("\n ### notifications=%d delivered=%d dropped=%d enrolments=%d enrollreq=%d cierejected=%d enrolled=%d enrollfail=%d full=%d",
+           sStats.u32Notifications, sStats.u32Delivered, sStats.u32Dropped, sStats.u32Enrolments,
+           sStats.u32EnrollRequests, sStats.u32CieRejected, sStats.u32Enrolled, sStats.u32EnrollFailures,
+           sStats.u32TableFull);
+    PRINTF("\n ### unresolved=%d notzone=%d", sStats.u32Unresolved, sStats.u32NotZone);
+    PRINTF("\n ### latency ms: last=%d min=%d max=%d avg=%d\n",
+           sStats.u32LatencyLastMs, sStats.u32LatencyMinMs, sStats.u32LatencyMaxMs,
+           (sStats.u32Delivered != 0) ? (sStats.u32LatencySumMs / sStats.u32Delivered) : 0);
+    xSemaphoreGive(xIasZoneMutex);
+}
+
+void vZCB_IasZoneGetStats(tsZCB_IasZoneStats *psStats)
+{
+    if ((psStats == NULL) || (xIasZoneMutex == NULL)) {
+        return;
+    }
+
+    xSemaphoreTake(xIasZoneMutex, portMAX_DELAY);
+    *psStats = sStats;
+    xSemaphoreGive(xIasZoneMutex);
+}
+
+// ------------------------------------------------------------------
+// END OF FILE
+// ------------------------------------------------------------------
@@ -0,0 +1,139 @@
+/*
+ * Copyright 2021-2023 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef ZCBIASZONE_H
+#define ZCBIASZONE_H
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+/****************************************************************************/
+/***        Include files                                                 ***/
+/****************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "zcb.h"
+#include "newDb.h"
+
+/****************************************************************************/
+/***        Macro Definitions                                             ***/
+/****************************************************************************/
+
+/* IAS zones known to the bridge */
+#define ZCB_IAS_ZONE_MAX                        8
+/* Zone status changes waiting for the bridge, the oldest is dropped when full */
+#define ZCB_IAS_ZONE_QUEUE_LENGTH               16
+/* Enrolment sent again until the zone is heard from */
+#define ZCB_IAS_ZONE_ENROLL_RETRY_MS            (30 * 1000)
+#define ZCB_IAS_ZONE_ENROLL_ATTEMPTS            3
+/* ... or this soon when the node had a request in flight */
+#define ZCB_IAS_ZONE_BUSY_RETRY_MS              100
+/* The bridge endpoint is added without the zone type after this time */
+#define ZCB_IAS_ZONE_TYPE_WAIT_MS               5000
+
+/* Zone types (ZCL 8.2.2.2.1.2) */
+#define ZCB_IAS_ZONE_TYPE_MOTION                0x000D
+#define ZCB_IAS_ZONE_TYPE_CONTACT               0x0015
+#define ZCB_IAS_ZONE_TYPE_UNKNOWN               0xFFFF
+
+/* Zone status bits (ZCL 8.2.2.2.1.3) */
+#define ZCB_IAS_ZONE_STATUS_ALARM1              0x0001
+#define ZCB_IAS_ZONE_STATUS_ALARM2              0x0002
+#define ZCB_IAS_ZONE_STATUS_TAMPER              0x0004
+#define ZCB_IAS_ZONE_STATUS_BATTERY             0x0008
+
+/* Bridge node types of an IAS zone in the joined node table */
+#define ZCB_IAS_NODE_TYPE_BOOLEAN               4
+#define ZCB_IAS_NODE_TYPE_OCCUPANCY             5
+
+
+/****************************************************************************/
+/***        Type Definitions                                              ***/
+/****************************************************************************/
+
+/** One zone status change on its way to the bridge */
+typedef struct
+{
+    uint64_t u64IeeeAddress;      /**< Sender as the frame has it, 0 when it came with a short address */
+    uint16_t u16ShortAddress;
+    uint8_t  u8Endpoint;
+    uint8_t  u8ZoneId;
+    uint16_t u16ZoneStatus;
+    uint32_t u32ArrivalTick;      /**< Tick count when the frame was read from the coordinator */
+} tsZCB_IasZoneEvent;
+
+typedef struct
+{
+    uint32_t u32Notifications;    /**< Zone status change frames received */
+    uint32_t u32Dropped;          /**< Changes dropped, the bridge did not keep up */
+    uint32_t u32Delivered;        /**< Changes reported on the Matter side */
+    uint32_t u32Enrolments;       /**< Enroll responses sent */
+    uint32_t u32EnrollRequests;   /**< Zone Enroll Requests from the nodes */
+    uint32_t u32CieRejected;      /**< CIE address writes the node refused */
+    uint32_t u32Enrolled;         /**< Zones heard from after being enrolled */
+    uint32_t u32EnrollFailures;   /**< Zones never heard from, given up */
+    uint32_t u32TableFull;        /**< Zones not tracked, no room in the table */
+    uint32_t u32Unresolved;       /**< Changes from an IEEE address the bridge has no node for */
+    uint32_t u32NotZone;          /**< Changes from an endpoint with no IAS Zone cluster */
+    uint32_t u32LatencyLastMs;    /**< Frame read to Matter report */
+    uint32_t u32LatencyMinMs;
+    uint32_t u32LatencyMaxMs;
+    uint32_t u32LatencySumMs;     /**< Over u32Delivered, for the average */
+} tsZCB_IasZoneStats;
+
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+
+void vZCB_IasZoneInit(void);
+
+/** A node endpoint with the IAS Zone cluster was found. Enrolment and the
+ *  zone type read are started from the service task; the bridge endpoint of
+ *  the node is added from there too, once its type is known. False when the
+ *  zone table is full, the caller adds the node as a plain sensor. */
+bool bZCB_IasZoneNodeFound(uint16_t u16ShortAddress, uint8_t u8Endpoint, const newdb_zcb_t *psZcb);
+
+/** Write attribute response to the CIE address of a zone, u8Status that of
+ *  the attribute; on success the zone gets its enroll response */
+void vZCB_IasZoneCieWritten(uint16_t u16ShortAddress, uint8_t u8Endpoint, uint8_t u8Status);
+
+/** Drop the zones of a node which has left the network */
+void vZCB_IasZoneForget(uint16_t u16ShortAddress);
+
+/** Next zone status change for the bridge, false on timeout. Called from
+ *  the bridge task only: the sender is resolved to its short address and
+ *  the zone table updated here; false too for a change from a sender which
+ *  is not a known zone, it is counted and dropped. */
+bool bZCB_IasZoneEventWait(tsZCB_IasZoneEvent *psEvent, uint32_t u32TimeoutMs);
+
+/** The change has been reported to Matter, closes its latency measurement */
+void vZCB_IasZoneDelivered(const tsZCB_IasZoneEvent *psEvent);
+
+/** True when a zone of this type is bridged as an occupancy sensor */
+bool bZCB_IasZoneIsOccupancy(uint16_t u16ZoneType);
+
+/** Called from the ZCB service task */
+void vZCB_IasZonePoll(void);
+
+/** Print the zone table and the delivery latency */
+void vZCB_IasZoneDump(void);
+
+void vZCB_IasZoneGetStats(tsZCB_IasZoneStats *psStats);
+
+#if defined __cplusplus
+}
+#endif
+
+#endif  /* ZCBIASZONE_H */
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
@@ -0,0 +1,152 @@
+/*
+ * Copyright 2021-2023 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "fsl_debug_console.h"
+
+#include <string.h>
+#include <stdbool.h>
+
+#include "ZcbIndex.h"
+
+/*
+ * Hash index over a table kept elsewhere.
+ *
+ * First written for the device and attribute tables, where every report,
+ * announce and leave used to scan for its node; the joined node table now
+ * needs the same lookups, so the index lives here for both. The index holds
+ * no keys of its own, only the table position of each entry: a slot costs
+ * two bytes and the table stays the one copy of the data. Entries are never
+ * moved within the index, a removed one leaves a deleted mark, so a reader
+ * walking a probe sequence while the owner updates the table still finds
+ * every entry which stays.
+ */
+
+uint64_t u64ZCB_IndexKey(const tsZCB_Index *psIndex, uint16_t u16Entry)
+{
+    const uint8_t *pu8Key = psIndex->pu8Keys + (uint32_t)u16Entry * psIndex->u16Stride;
+    uint16_t u16Key;
+    uint64_t u64Key;
+
+    /* The tables are packed, the keys are not aligned */
+    if (psIndex->u8KeySize == sizeof(uint16_t)) {
+        memcpy(&u16Key, pu8Key, sizeof(u16Key));
+        return u16Key;
+    }
+    u64Key = 0;
+    memcpy(&u64Key, pu8Key, psIndex->u8KeySize);
+    return u64Key;
+}
+
+static uint16_t u16IndexHash(const tsZCB_Index *psIndex, uint64_t u64Key)
+{
+    uint32_t u32Key = (uint32_t)(u64Key ^ (u64Key >> 32));
+
+    /* Fibonacci hashing, short addresses handed out in sequence spread too */
+    return (uint16_t)((u32Key * 2654435761u) >> 16) & psIndex->u16Mask;
+}
+
+uint16_t u16ZCB_IndexFind(const tsZCB_Index *psIndex, uint64_t u64Key)
+{
+    uint16_t u16Slot = u16IndexHash(psIndex, u64Key);
+
+    for (uint16_t i = 0; i <= psIndex->u16Mask; i++)
+    {
+        uint16_t u16Value = psIndex->pu16Slots[u16Slot];
+
+        if (u16Value == ZCB_INDEX_EMPTY) {
+            break;
+        }
+        if ((u16Value != ZCB_INDEX_DELETED) && (u64ZCB_IndexKey(psIndex, u16Value - 1) == u64Key)) {
+            return u16Value - 1;
+        }
+        u16Slot = (u16Slot + 1) & psIndex->u16Mask;
+    }
+    return ZCB_INDEX_NONE;
+}
+
+void vZCB_IndexInsert(tsZCB_Index *psIndex, uint16_t u16Entry)
+{
+    uint16_t u16Slot = u16IndexHash(psIndex, u64ZCB_IndexKey(psIndex, u16Entry));
+
+    /* Never full, there are twice as many slots as entries */
+    while ((psIndex->pu16Slots[u16Slot] != ZCB_INDEX_EMPTY)
+           && (psIndex->pu16Slots[u16Slot] != ZCB_INDEX_DELETED))
+    {
+        u16Slot = (u16Slot + 1) & psIndex->u16Mask;
+    }
+    if (psIndex->pu16Slots[u16Slot] == ZCB_INDEX_DELETED) {
+        psIndex->u16Deleted--;
+    }
+    psIndex->pu16Slots[u16Slot] = u16Entry + 1;
+}
+
+void vZCB_IndexRemove(tsZCB_Index *psIndex, uint16_t u16Entry)
+{
+    uint16_t u16Slot = u16IndexHash(psIndex, u64ZCB_IndexKey(psIndex, u16Entry));
+
+    for (uint16_t i = 0; i <= psIndex->u16Mask; i++)
+    {
+        if (psIndex->pu16Slots[u16Slot] == ZCB_INDEX_EMPTY) {
+            return;
+        }
+        if (psIndex->pu16Slots[u16Slot] == u16Entry + 1) {
+            psIndex->pu16Slots[u16Slot] = ZCB_INDEX_DELETED;
+            psIndex->u16Deleted++;
+            return;
+        }
+        u16Slot = (u16Slot + 1) & psIndex->u16Mask;
+    }
+}
+
+void vZCB_IndexClear(tsZCB_Index *psIndex)
+{
+    memset(psIndex->pu16Slots, 0, sizeof(uint16_t) * ((uint32_t)psIndex->u16Mask + 1));
+    psIndex->u16Deleted = 0;
+}
+
+bool bZCB_IndexNeedsRebuild(const tsZCB_Index *psIndex)
+{
+    return psIndex->u16Deleted > (((uint32_t)psIndex->u16Mask + 1) / 4);
+}
+
+static uint16_t u16IndexProbeLength(const tsZCB_Index *psIndex, uint16_t u16Slot)
+{
+    uint16_t u16Home = u16IndexHash(psIndex, u64ZCB_IndexKey(psIndex, psIndex->pu16Slots[u16Slot] - 1));
+
+    return ((u16Slot - u16Home) & psIndex->u16Mask) + 1;
+}
+
+void vZCB_IndexPrint(const char *pcName, const tsZCB_Index *psIndex)
+{
+    uint16_t u16Entries = 0;
+    uint16_t u16MaxProbe = 0;
+    uint32_t u32Probes = 0;
+
+    for (uint16_t i = 0; i <= psIndex->u16Mask; i++)
+    {
+        uint16_t u16Value = psIndex->pu16Slots[i];
+        uint16_t u16Probe;
+
+        if ((u16Value == ZCB_INDEX_EMPTY) || (u16Value == ZCB_INDEX_DELETED)) {
+            continue;
+        }
+        u16Probe = u16IndexProbeLength(psIndex, i);
+        u32Probes += u16Probe;
+        if (u16Probe > u16MaxProbe) {
+            u16MaxProbe = u16Probe;
+        }
+        u16Entries++;
+    }
+    PRINTF("\n ### %s index: %d entries in %d slots, %d deleted, probes average %d.%02d max %d\n",
+           pcName, u16Entries, psIndex->u16Mask + 1, psIndex->u16Deleted,
+           (u16Entries == 0) ? 0 : (int)(u32Probes / u16Entries),
+           (u16Entries == 0) ? 0 : (int)((u32Probes * 100 / u16Entries) % 100), u16MaxProbe);
+}
+
+// ------------------------------------------------------------------
+// END OF FILE
+// ------------------------------------------------------------------
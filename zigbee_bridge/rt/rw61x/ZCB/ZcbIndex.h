@@ -0,0 +1,95 @@
+/*
+ * Copyright 2021-2023 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef ZCBINDEX_H
+#define ZCBINDEX_H
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+/****************************************************************************/
+/***        Include files                                                 ***/
+/****************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/****************************************************************************/
+/***        Macro Definitions                                             ***/
+/****************************************************************************/
+
+/* Slot values: a slot holds the table index of its entry plus one */
+#define ZCB_INDEX_EMPTY                         0
+#define ZCB_INDEX_DELETED                       0xFFFF
+/* What a lookup returns for a key not in the table */
+#define ZCB_INDEX_NONE                          0xFFFF
+
+/* Slots for a table of n entries: a power of two, twice n at least so that
+ * the probes stay short. A constant expression, for array sizes */
+#define ZCB_INDEX_SLOTS(n)      (((n) <=   32) ?    64 : ((n) <=   64) ?   128 : \
+                                 ((n) <=  128) ?   256 : ((n) <=  256) ?   512 : \
+                                 ((n) <=  512) ?  1024 : ((n) <= 1024) ?  2048 : \
+                                 ((n) <= 2048) ?  4096 : ((n) <= 4096) ?  8192 : 16384)
+
+
+/****************************************************************************/
+/***        Type Definitions                                              ***/
+/****************************************************************************/
+
+/** Open addressing hash index, linear probing, over a table the owner keeps.
+ *  The key of each entry is read from the table itself: u8KeySize bytes,
+ *  8 at most, found u16Stride bytes after those of the entry before. */
+typedef struct
+{
+    uint16_t        *pu16Slots;
+    uint16_t        u16Mask;        /**< slots - 1 */
+    uint16_t        u16Deleted;     /**< Deleted marks, see bZCB_IndexNeedsRebuild() */
+    const uint8_t   *pu8Keys;       /**< Key of entry 0 */
+    uint16_t        u16Stride;      /**< From the key of one entry to the next */
+    uint8_t         u8KeySize;
+} tsZCB_Index;
+
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+
+/** Key of entry u16Entry, as the index reads it from the table */
+uint64_t u64ZCB_IndexKey(const tsZCB_Index *psIndex, uint16_t u16Entry);
+
+/** Table index of the key, ZCB_INDEX_NONE when it is not there */
+uint16_t u16ZCB_IndexFind(const tsZCB_Index *psIndex, uint64_t u64Key);
+
+/** Index entry u16Entry, its key already in the table. The owner keeps the
+ *  entries below half the slots, the index is then never full. */
+void vZCB_IndexInsert(tsZCB_Index *psIndex, uint16_t u16Entry);
+
+/** Take entry u16Entry out, its key still in the table. The slot keeps a
+ *  deleted mark so that a lookup on another task never misses an entry
+ *  which stays. */
+void vZCB_IndexRemove(tsZCB_Index *psIndex, uint16_t u16Entry);
+
+/** Empty the index, before the owner inserts its entries again */
+void vZCB_IndexClear(tsZCB_Index *psIndex);
+
+/** Deleted marks lengthen the probes: true once a quarter of the slots
+ *  has one, the owner then rebuilds the index */
+bool bZCB_IndexNeedsRebuild(const tsZCB_Index *psIndex);
+
+/** Print the entries, slots and probe lengths of the index */
+void vZCB_IndexPrint(const char *pcName, const tsZCB_Index *psIndex);
+
+#if defined __cplusplus
+}
+#endif
+
+#endif  /* ZCBINDEX_H */
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
@@ -0,0 +1,1179 @@
+/*
+ * Copyright 2021-2023 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+#include "fsl_debug_console.h"
+
+#include <string.h>
+#include <stdbool.h>
+
+#include "ZigbeeConstant.h"
+#include "ZigbeeDevices.h"
+#include "SerialLink.h"
+#include "newDb.h"
+#include "cmd.h"
+#include "ZcbMessage.h"
+#include "ZcbNodeFlow.h"
+#include "ZcbIasZone.h"
+#include "ZcbProfileCache.h"
+#include "ZcbInterview.h"
+
+/*
+ * Interview of the nodes joining the network.
+ *
+ * A new node is asked for its active endpoints, the simple descriptor of
+ * each of them, its model identifier, and its clusters are bound to the
+ * bridge. This used to run in one go from the device announce on the
+ * callback task, each step blocking on its response: while one node was
+ * interviewed every other frame waited behind it, reports included, and a
+ * few nodes joining together overflowed the callback queue.
+ *
+ * Each node now has its own state machine. The service task sends the
+ * request of the current step and returns; the response handlers only
+ * record the answer and move the interview to its next step, which the
+ * service task sends on its next run. Several interviews run at the same
+ * time, the others wait for a slot; a request not answered is sent again,
+ * then the step is skipped as the blocking version did. Every endpoint of
+ * the node is described and bound, the Green Power endpoint excepted, and
+ * the node is added on the Matter side as soon as its clusters are known,
+ * from the clusters of all its endpoints.
+ *
+ * A node first has its Basic cluster read for its manufacturer, model and
+ * version. When a node of the same model was interviewed before, its tables
+ * are filled from the profile kept then and only the binds are left to do;
+ * otherwise the full interview runs and its model is kept at the end.
+ *
+ * The node is handed to the bridge without waiting for it: while the bridge
+ * has not taken the previous message, the add is tried again on the next
+ * poll. The time from the join to the Matter endpoint, and to the end of the
+ * interview, is kept.
+ */
+
+/* Requests sent per poll, over all interviews */
+#define IV_REQUESTS_PER_POLL        4
+/* Retry gap after a failure to send, or a node with a request in flight */
+#define IV_RETRY_MS                 50
+/* Endpoint of the Green Power proxy, nothing to bridge there */
+#define IV_GREEN_POWER_ENDPOINT     0xF2
+
+/* Joined node types reported to the bridge */
+#define IV_NODE_TYPE_ONOFF          1
+#define IV_NODE_TYPE_DIMMABLE       2
+#define IV_NODE_TYPE_COLOR          3
+
+typedef enum
+{
+    E_IV_FREE,
+    E_IV_WAITING,               /* for an interview slot */
+    E_IV_PROFILE,               /* Basic cluster read, the model of the node */
+    E_IV_ACTIVE_EP,
+    E_IV_SIMPLE_DESC,
+    E_IV_MODEL_ID,
+    E_IV_BIND,
+    E_IV_DONE,                  /* the bridge add still to send */
+} teIvStep;
+
+typedef struct
+{
+    teIvStep        eStep;
+    uint16_t        u16ShortAddress;
+    uint64_t        u64IeeeAddress;
+    bool            bWaiting;         /* request sent, response awaited */
+    bool            bAddDue;          /* clusters known, bridge add to send */
+    bool            bKeyValid;        /* the model was read */
+    bool            bFromProfile;     /* tables filled from a profile */
+    bool            bStoreDue;        /* full interview done, profile to keep */
+    uint8_t         u8Seq;            /* of the request in flight */
+    uint8_t         u8Attempts;       /* of the request in flight */
+    uint8_t         u8Endpoint;       /* index of the endpoint described or bound */
+    uint8_t         u8Cluster;        /* index of the cluster bound */
+    uint8_t         u8IasEndpoint;
+    uint8_t         u8NodeType;
+    uint64_t        u64Clusters;      /* newdb_zcb_t cluster bitmap over all endpoints */
+    uint32_t        u32ProfileMs;     /* full interview time, of the model on a hit */
+    tsZCB_ProfileKey sKey;
+    TickType_t      xJoined;
+    TickType_t      xStarted;
+    TickType_t      xDue;             /* next request not before */
+    TickType_t      xDeadline;        /* response awaited until */
+} tsInterview;
+
+/* A request to send, taken from an interview with the mutex held */
+typedef struct
+{
+    uint8_t         u8Slot;
+    uint8_t         u8Seq;
+    teIvStep        eStep;
+    uint16_t        u16ShortAddress;
+    uint64_t        u64IeeeAddress;
+    uint8_t         u8Endpoint;       /* endpoint id */
+    uint16_t        u16ClusterId;
+} tsIvRequest;
+
+static tsInterview asInterviews[ZCB_INTERVIEW_MAX_NODES];
+static SemaphoreHandle_t xIvMutex = NULL;
+static tsZCB_InterviewStats sStats;
+static uint8_t u8Concurrency = ZCB_INTERVIEW_CONCURRENCY;
+
+#if ZB_BRIDGE_TEST_COMMANDS
+/* Join storm measure. Its nodes have a locally administered IEEE address,
+ * which no radio is given, one endpoint and the clusters of a colour bulb. */
+#define IV_STORM_IEEE_BASE          0x02FFFFFFFFFF0000ULL
+#define IV_STORM_FIRST_ADDRESS      0x7100
+#define IV_STORM_ENDPOINT           1
+
+static const uint16_t au16StormClusters[] =
+{
+    E_ZB_CLUSTERID_BASIC, E_ZB_CLUSTERID_ONOFF, E_ZB_CLUSTERID_LEVEL_CONTROL, E_ZB_CLUSTERID_COLOR_CONTROL
+};
+
+static bool bStormRunning;
+static uint8_t u8StormJoins;
+static uint8_t u8StormBridged;
+static uint8_t u8StormPeak;
+static TickType_t xStormStart;
+static uint32_t u32StormBridgedSumMs;
+static uint32_t u32StormBridgedMaxMs;
+static uint32_t u32StormInterviewSumMs;
+/* The answer due to the request in flight of each slot; written and read
+ * on the service task only */
+static bool abStormAnswer[ZCB_INTERVIEW_MAX_NODES];
+static uint8_t au8StormSeq[ZCB_INTERVIEW_MAX_NODES];
+static TickType_t axStormAnswer[ZCB_INTERVIEW_MAX_NODES];
+
+static bool bIvStormNode(uint64_t u64IeeeAddress)
+{
+    return bStormRunning && ((u64IeeeAddress & ~0xFFFFULL) == IV_STORM_IEEE_BASE);
+}
+#endif
+
+static const char *pcIvStep(teIvStep eStep)
+{
+    switch (eStep)
+    {
+        case E_IV_WAITING:      return "waiting";
+        case E_IV_PROFILE:      return "profile";
+        case E_IV_ACTIVE_EP:    return "endpoints";
+        case E_IV_SIMPLE_DESC:  return "descriptor";
+        case E_IV_MODEL_ID:     return "model";
+        case E_IV_BIND:         return "bind";
+        case E_IV_DONE:         return "done";
+        default:                return "-";
+    }
+}
+
+static uint32_t u32IvElapsedMs(TickType_t xFrom, TickType_t xNow)
+{
+    return (uint32_t)((xNow - xFrom) * portTICK_PERIOD_MS);
+}
+
+static tsInterview *psIvFind(uint16_t u16ShortAddress)
+{
+    for (uint8_t i = 0; i < ZCB_INTERVIEW_MAX_NODES; i++)
+    {
+        if ((asInterviews[i].eStep != E_IV_FREE) && (asInterviews[i].u16ShortAddress == u16ShortAddress)) {
+            return &asInterviews[i];
+        }
+    }
+    return NULL;
+}
+
+static tsInterview *psIvAlloc(void)
+{
+    for (uint8_t i = 0; i < ZCB_INTERVIEW_MAX_NODES; i++)
+    {
+        if (asInterviews[i].eStep == E_IV_FREE) {
+            return &asInterviews[i];
+        }
+    }
+    return NULL;
+}
+
+static bool bIvSkipEndpoint(uint8_t u8EndpointId)
+{
+    return (u8EndpointId == 0) || (u8EndpointId == IV_GREEN_POWER_ENDPOINT);
+}
+
+/* Called with the mutex held; from u8Endpoint on, false when none is left */
+static bool bIvFindEndpointLocked(tsInterview *psIv, const tsZbDeviceInfo *psDevice)
+{
+    vZDM_ArenaLock();
+    for (; psIv->u8Endpoint < psDevice->u8EndpointCount; psIv->u8Endpoint++)
+    {
+        if (!bIvSkipEndpoint(tZDM_FindEndpointByIndex(psDevice, psIv->u8Endpoint)->u8EndpointId)) {
+            vZDM_ArenaUnlock();
+            return true;
+        }
+    }
+    vZDM_ArenaUnlock();
+    return false;
+}
+
+/* Called with the mutex held; the endpoint with the Basic cluster */
+static bool bIvFindModelIdLocked(tsInterview *psIv, const tsZbDeviceInfo *psDevice)
+{
+    vZDM_ArenaLock();
+    for (uint8_t i = 0; i < psDevice->u8EndpointCount; i++)
+    {
+        const tsZbDeviceEndPoint *psEndpoint = tZDM_FindEndpointByIndex(psDevice, i);
+
+        if (bIvSkipEndpoint(psEndpoint->u8EndpointId)) {
+            continue;
+        }
+        for (uint8_t j = 0; j < psEndpoint->u8ClusterCount; j++)
+        {
+            if (tZDM_FindClusterByIndex(psEndpoint, j)->u16ClusterId == E_ZB_CLUSTERID_BASIC) {
+                psIv->u8Endpoint = i;
+                vZDM_ArenaUnlock();
+                return true;
+            }
+        }
+    }
+    vZDM_ArenaUnlock();
+    return false;
+}
+
+/* Called with the mutex held; from (u8Endpoint, u8Cluster) on, the next
+ * cluster to bind. Its attributes go to the attribute table once, here;
+ * a profile has added them already, its clusters with one are bound. */
+static bool bIvFindBindLocked(tsInterview *psIv, tsZbDeviceInfo *psDevice)
+{
+    vZDM_ArenaLock();
+    for (; psIv->u8Endpoint < psDevice->u8EndpointCount; psIv->u8Endpoint++, psIv->u8Cluster = 0)
+    {
+        const tsZbDeviceEndPoint *psEndpoint = tZDM_FindEndpointByIndex(psDevice, psIv->u8Endpoint);
+
+        if (bIvSkipEndpoint(psEndpoint->u8EndpointId)) {
+            continue;
+        }
+        for (; psIv->u8Cluster < psEndpoint->u8ClusterCount; psIv->u8Cluster++)
+        {
+            const tsZbDeviceCluster *psCluster = tZDM_FindClusterByIndex(psEndpoint, psIv->u8Cluster);
+
+            if (psIv->bFromProfile) {
+                if ((psCluster->u16ClusterId != E_ZB_CLUSTERID_BASIC) && (psCluster->u8AttributeCount > 0)) {
+                    vZDM_ArenaUnlock();
+                    return true;
+                }
+            } else if (bZDM_AddBindingAttributes(psDevice, psIv->u8Endpoint, psIv->u8Cluster)) {
+                vZDM_ArenaUnlock();
+                return true;
+            }
+        }
+    }
+    vZDM_ArenaUnlock();
+    return false;
+}
+
+/* Called with the mutex held; what the bridge is told about the node */
+static void vIvClustersKnownLocked(tsInterview *psIv, const tsZbDeviceInfo *psDevice)
+{
+    newdb_zcb_t sZcb;
+
+    psIv->bAddDue = true;
+    memset(&sZcb, 0, sizeof(sZcb));
+    psIv->u8NodeType = IV_NODE_TYPE_ONOFF;
+    vZDM_ArenaLock();
+    for (uint8_t i = 0; i < psDevice->u8EndpointCount; i++)
+    {
+        const tsZbDeviceEndPoint *psEndpoint = tZDM_FindEndpointByIndex(psDevice, i);
+
+        if (bIvSkipEndpoint(psEndpoint->u8EndpointId)) {
+            continue;
+        }
+        for (uint8_t j = 0; j < psEndpoint->u8ClusterCount; j++)
+        {
+            switch (tZDM_FindClusterByIndex(psEndpoint, j)->u16ClusterId)
+            {
+                case E_ZB_CLUSTERID_ONOFF:
+                    sZcb.uSupportedClusters.sClusterBitmap.hasOnOff = 1;
+                    break;
+                case E_ZB_CLUSTERID_LEVEL_CONTROL:
+                    sZcb.uSupportedClusters.sClusterBitmap.hasDimmable = 1;
+                    break;
+                case E_ZB_CLUSTERID_COLOR_CONTROL:
+                    sZcb.uSupportedClusters.sClusterBitmap.hasColor = 1;
+                    break;
+                case E_ZB_CLUSTERID_MEASUREMENTSENSING_ILLUM:
+                    sZcb.uSupportedClusters.sClusterBitmap.hasIlluminanceSensing = 1;
+                    break;
+                case E_ZB_CLUSTERID_MEASUREMENTSENSING_TEMP:
+                    sZcb.uSupportedClusters.sClusterBitmap.hasTemperatureSensing = 1;
+                    break;
+                case E_ZB_CLUSTERID_OCCUPANCYSENSING:
+                    sZcb.uSupportedClusters.sClusterBitmap.hasOccupancySensing = 1;
+                    break;
+                case E_ZB_CLUSTERID_IAS_ZONE:
+                    if (!sZcb.uSupportedClusters.sClusterBitmap.hasIasZone) {
+                        psIv->u8IasEndpoint = psEndpoint->u8EndpointId;
+                    }
+                    sZcb.uSupportedClusters.sClusterBitmap.hasIasZone = 1;
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+    vZDM_ArenaUnlock();
+
+    /* The same order as the bridge picks the device type */
+    if (sZcb.uSupportedClusters.sClusterBitmap.hasIasZone) {
+        psIv->u8NodeType = ZCB_IAS_NODE_TYPE_BOOLEAN;
+    } else if (sZcb.uSupportedClusters.sClusterBitmap.hasColor) {
+        psIv->u8NodeType = IV_NODE_TYPE_COLOR;
+    } else if (sZcb.uSupportedClusters.sClusterBitmap.hasDimmable) {
+        psIv->u8NodeType = IV_NODE_TYPE_DIMMABLE;
+    }
+    psIv->u64Clusters = sZcb.uSupportedClusters.u64;
+}
+
+/* Called with the mutex held */
+static void vIvFinishLocked(tsInterview *psIv, tsZbDeviceInfo *psDevice, TickType_t xNow)
+{
+    psDevice->eDeviceState = E_ZB_DEVICE_STATE_ACTIVE;
+    sStats.u32DoneLastMs = u32IvElapsedMs(psIv->xJoined, xNow);
+#if ZB_BRIDGE_TEST_COMMANDS
+    if (bIvStormNode(psIv->u64IeeeAddress)) {
+        u32StormInterviewSumMs += u32IvElapsedMs(psIv->xStarted, xNow);
+    }
+#endif
+    if (psIv->bFromProfile) {
+        vZCB_ProfileHitDone(psIv->u32ProfileMs, u32IvElapsedMs(psIv->xStarted, xNow));
+    } else if (psIv->bKeyValid) {
+        /* Kept from the poll, the profiles are written to flash then */
+        psIv->bStoreDue = true;
+        psIv->u32ProfileMs = u32IvElapsedMs(psIv->xStarted, xNow);
+    }
+    sStats.u32Completed++;
+    psIv->eStep = E_IV_DONE;
+    if (!psIv->bAddDue && !psIv->bStoreDue) {
+        psIv->eStep = E_IV_FREE;
+    }
+}
+
+/* Called with the mutex held: the current step is answered or given up,
+ * on to the next request */
+static void vIvAdvanceLocked(tsInterview *psIv, TickType_t xNow)
+{
+    tsZbDeviceInfo *psDevice = tZDM_FindDeviceByNodeId(psIv->u16ShortAddress);
+
+    if (psDevice == NULL) {
+        /* Left while interviewed */
+        psIv->eStep = E_IV_FREE;
+        sStats.u32Dropped++;
+        return;
+    }
+
+    psIv->bWaiting   = false;
+    psIv->u8Attempts = 0;
+    psIv->xDue       = xNow;
+
+    switch (psIv->eStep)
+    {
+        case E_IV_PROFILE:
+            psIv->eStep = E_IV_ACTIVE_EP;
+            if (!psIv->bKeyValid || !bZCB_ProfileApply(&psIv->sKey, psDevice, &psIv->u32ProfileMs)) {
+                break;
+            }
+            /* A known model, on to the binds */
+            psIv->bFromProfile = true;
+            vIvClustersKnownLocked(psIv, psDevice);
+            psIv->eStep = E_IV_BIND;
+            psIv->u8Endpoint = 0;
+            psIv->u8Cluster = 0;
+            break;
+
+        case E_IV_ACTIVE_EP:
+            psIv->eStep = E_IV_SIMPLE_DESC;
+            psIv->u8Endpoint = 0;
+            if (bIvFindEndpointLocked(psIv, psDevice)) {
+                break;
+            }
+            /* No endpoint to describe */
+            vIvClustersKnownLocked(psIv, psDevice);
+            psIv->eStep = E_IV_MODEL_ID;
+            break;
+
+        case E_IV_SIMPLE_DESC:
+            psIv->u8Endpoint++;
+            if (bIvFindEndpointLocked(psIv, psDevice)) {
+                break;
+            }
+            vIvClustersKnownLocked(psIv, psDevice);
+            psIv->eStep = E_IV_MODEL_ID;
+            break;
+
+        case E_IV_MODEL_ID:
+            psIv->eStep = E_IV_BIND;
+            psIv->u8Endpoint = 0;
+            psIv->u8Cluster = 0;
+            break;
+
+        case E_IV_BIND:
+            psIv->u8Cluster++;
+            break;
+
+        default:
+            return;
+    }
+
+    if (psIv->eStep == E_IV_MODEL_ID) {
+        if (bIvFindModelIdLocked(psIv, psDevice)) {
+            psDevice->eDeviceState = E_ZB_DEVICE_STATE_READ_ATTRIBUTE;
+            vZDM_ArenaLock();
+            tZDM_AddNewAttributeToAttributeTable(psDevice->u16NodeId,
+                                                 tZDM_FindEndpointByIndex(psDevice, psIv->u8Endpoint)->u8EndpointId,
+                                                 E_ZB_CLUSTERID_BASIC,
+                                                 E_ZB_ATTRIBUTEID_BASIC_MODEL_ID,
+                                                 E_ZB_ATTRIBUTE_STRING_TYPE);
+            vZDM_ArenaUnlock();
+            return;
+        }
+        /* No Basic cluster, straight to the binds */
+        psIv->eStep = E_IV_BIND;
+        psIv->u8Endpoint = 0;
+        psIv->u8Cluster = 0;
+    }
+
+    if (psIv->eStep == E_IV_BIND) {
+        psDevice->eDeviceState = E_ZB_DEVICE_STATE_BIND_CLUSTER;
+        if (!bIvFindBindLocked(psIv, psDevice)) {
+            vIvFinishLocked(psIv, psDevice, xNow);
+        }
+    } else if (psIv->eStep == E_IV_SIMPLE_DESC) {
+        psDevice->eDeviceState = E_ZB_DEVICE_STATE_GET_CLUSTER;
+    }
+}
+
+/* Called with the mutex held: the request was not answered or not sent */
+static void vIvFailLocked(tsInterview *psIv, TickType_t xNow)
+{
+    tsZbDeviceInfo *psDevice;
+
+    psIv->bWaiting = false;
+    if (++psIv->u8Attempts < ZCB_INTERVIEW_ATTEMPTS) {
+        psIv->xDue = xNow + pdMS_TO_TICKS(IV_RETRY_MS);
+        return;
+    }
+
+    PRINTF("\n ### Interview of 0x%04x: no answer to %s\n", psIv->u16ShortAddress, pcIvStep(psIv->eStep));
+    if (psIv->eStep == E_IV_ACTIVE_EP) {
+        /* Endpoint 1 is assumed, as most single endpoint devices have */
+        static const uint8_t au8Endpoints[] = { 1 };
+
+        psDevice = tZDM_FindDeviceByNodeId(psIv->u16ShortAddress);
+        if (psDevice != NULL) {
+            bZDM_SetDeviceEndpoints(psDevice, 1, au8Endpoints);
+        }
+    }
+    vIvAdvanceLocked(psIv, xNow);
+}
+
+/* Called with the mutex held; true when the interview has a request due */
+static bool bIvTakeRequestLocked(tsInterview *psIv, uint8_t u8Slot, TickType_t xNow, tsIvRequest *psRequest)
+{
+    tsZbDeviceInfo *psDevice;
+    const tsZbDeviceEndPoint *psEndpoint;
+    const tsZbDeviceCluster *psCluster;
+
+    if ((psIv->eStep < E_IV_PROFILE) || (psIv->eStep > E_IV_BIND)
+        || psIv->bWaiting || ((int32_t)(xNow - psIv->xDue) < 0)) {
+        return false;
+    }
+
+    /* Marked before it is sent, the response may come before the send returns */
+    psIv->bWaiting  = true;
+    psIv->u8Seq++;
+    psIv->xDeadline = xNow + pdMS_TO_TICKS((psIv->eStep == E_IV_BIND) ? ZCB_INTERVIEW_BIND_TIMEOUT_MS
+                                           : ZCB_INTERVIEW_RESPONSE_TIMEOUT_MS);
+
+    psDevice = tZDM_FindDeviceByNodeId(psIv->u16ShortAddress);
+    if (psDevice == NULL) {
+        psIv->eStep = E_IV_FREE;
+        sStats.u32Dropped++;
+        return false;
+    }
+
+    psRequest->u8Slot          = u8Slot;
+    psRequest->u8Seq           = psIv->u8Seq;
+    psRequest->eStep           = psIv->eStep;
+    psRequest->u16ShortAddress = psIv->u16ShortAddress;
+    psRequest->u64IeeeAddress  = psIv->u64IeeeAddress;
+    psRequest->u8Endpoint      = 0;
+    psRequest->u16ClusterId    = 0;
+    if (psIv->eStep == E_IV_PROFILE) {
+        psRequest->u8Endpoint = ZCB_PROFILE_READ_ENDPOINT;
+    } else if (psIv->eStep != E_IV_ACTIVE_EP) {
+        /* Gone when the node has sent its endpoints again since */
+        vZDM_ArenaLock();
+        psEndpoint = tZDM_FindEndpointByIndex(psDevice, psIv->u8Endpoint);
+        if (psEndpoint == NULL) {
+            vZDM_ArenaUnlock();
+            psIv->eStep = E_IV_FREE;
+            sStats.u32Dropped++;
+            return false;
+        }
+        psRequest->u8Endpoint = psEndpoint->u8EndpointId;
+        if (psIv->eStep == E_IV_BIND) {
+            psCluster = tZDM_FindClusterByIndex(psEndpoint, psIv->u8Cluster);
+            if (psCluster == NULL) {
+                /* The endpoint came back with fewer clusters, on to the next */
+                vZDM_ArenaUnlock();
+                psIv->bWaiting   = false;
+                psIv->u8Endpoint++;
+                psIv->u8Cluster  = 0;
+                if (!bIvFindBindLocked(psIv, psDevice)) {
+                    vIvFinishLocked(psIv, psDevice, xNow);
+                }
+                return false;
+            }
+            psRequest->u16ClusterId = psCluster->u16ClusterId;
+        }
+        vZDM_ArenaUnlock();
+    }
+    return true;
+}
+
+/* A bind response, or its timeout, on the callback task */
+static void vIvBindResponse(void *pvUser, teSL_Status eStatus, uint16_t u16Length, void *pvMessage)
+{
+    uint16_t u16ShortAddress = (uint16_t)(uintptr_t)pvUser;
+    tsInterview *psIv;
+
+    if (xIvMutex == NULL) {
+        return;
+    }
+
+    /* The in-flight slot of the bind: a missed answer counts against the
+     * node, an error status is the coordinator's */
+    if (eStatus == E_SL_OK) {
+        vZCB_NodeFlowComplete(u16ShortAddress, true);
+    } else if (eStatus == E_SL_NOMESSAGE) {
+        vZCB_NodeFlowTimeout(u16ShortAddress);
+    } else {
+        vZCB_NodeFlowRelease(u16ShortAddress);
+    }
+
+    xSemaphoreTake(xIvMutex, portMAX_DELAY);
+    psIv = psIvFind(u16ShortAddress);
+    if ((psIv != NULL) && (psIv->eStep == E_IV_BIND) && psIv->bWaiting) {
+        if (eStatus != E_SL_OK) {
+            /* A failed bind leaves the node bridged, its reports just do not come */
+            PRINTF("\n ### Interview of 0x%04x: bind failed (%d)\n", u16ShortAddress, eStatus);
+        }
+        vIvAdvanceLocked(psIv, xTaskGetTickCount());
+    }
+    xSemaphoreGive(xIvMutex);
+}
+
+static teZcbStatus eIvSend(const tsIvRequest *psRequest)
+{
+    uint16_t au16AttrList[1] = {E_ZB_ATTRIBUTEID_BASIC_MODEL_ID};
+    uint16_t au16KeyList[3] = {E_ZB_ATTRIBUTEID_BASIC_MAN_NAME,
+                               E_ZB_ATTRIBUTEID_BASIC_MODEL_ID,
+                               E_ZB_ATTRIBUTEID_BASIC_APP_VERSION};
+
+#if ZB_BRIDGE_TEST_COMMANDS
+    if (bIvStormNode(psRequest->u64IeeeAddress)) {
+        /* Answered from the poll */
+        abStormAnswer[psRequest->u8Slot] = true;
+        au8StormSeq[psRequest->u8Slot]   = psRequest->u8Seq;
+        axStormAnswer[psRequest->u8Slot] = xTaskGetTickCount() + pdMS_TO_TICKS(ZCB_INTERVIEW_STORM_RESPONSE_MS);
+        return E_ZCB_OK;
+    }
+#endif
+
+    switch (psRequest->eStep)
+    {
+        case E_IV_PROFILE:
+            return eReadAttributeRequest(E_ZD_ADDRESS_MODE_SHORT,
+                                         psRequest->u16ShortAddress,
+                                         ZB_ENDPOINT_SRC_DEFAULT,
+                                         psRequest->u8Endpoint,
+                                         E_ZB_CLUSTERID_BASIC,
+                                         ZB_MANU_CODE_DEFAULT,
+                                         3,
+                                         au16KeyList);
+
+        case E_IV_ACTIVE_EP:
+            return eActiveEndpointRequest(psRequest->u16ShortAddress);
+
+        case E_IV_SIMPLE_DESC:
+            return eSimpleDescriptorRequest(psRequest->u16ShortAddress, psRequest->u8Endpoint);
+
+        case E_IV_MODEL_ID:
+            return eReadAttributeRequest(E_ZD_ADDRESS_MODE_SHORT,
+                                         psRequest->u16ShortAddress,
+                                         ZB_ENDPOINT_SRC_DEFAULT,
+                                         psRequest->u8Endpoint,
+                                         E_ZB_CLUSTERID_BASIC,
+                                         ZB_MANU_CODE_DEFAULT,
+                                         1,
+                                         au16AttrList);
+
+        case E_IV_BIND:
+            return eSendBindRequestAsync(psRequest->u64IeeeAddress,
+                                         psRequest->u8Endpoint,
+                                         psRequest->u16ClusterId,
+                                         vIvBindResponse,
+                                         (void *)(uintptr_t)psRequest->u16ShortAddress);
+
+        default:
+            return E_ZCB_ERROR;
+    }
+}
+
+/* Called with the mutex held, what came of sending the request */
+static void vIvSentLocked(const tsIvRequest *psRequest, teZcbStatus eStatus, TickType_t xNow)
+{
+    tsInterview *psIv = &asInterviews[psRequest->u8Slot];
+
+    /* Answered already, or the interview is gone */
+    if ((psIv->eStep != psRequest->eStep) || !psIv->bWaiting || (psIv->u8Seq != psRequest->u8Seq)
+        || (psIv->u16ShortAddress != psRequest->u16ShortAddress)) {
+        return;
+    }
+
+    if (eStatus != E_ZCB_REQUEST_NOT_ACTIONED) {
+        sStats.u32Requests++;
+    }
+
+    switch (eStatus)
+    {
+        case E_ZCB_OK:
+            break;
+
+        case E_ZCB_DEFERRED:
+            if (psRequest->eStep == E_IV_BIND) {
+                /* Nothing answers a held bind, it goes out when the node wakes */
+                vIvAdvanceLocked(psIv, xNow);
+            } else {
+                psIv->xDeadline = xNow + pdMS_TO_TICKS(ZCB_INTERVIEW_SLEEPY_TIMEOUT_MS);
+            }
+            break;
+
+        case E_ZCB_REQUEST_NOT_ACTIONED:
+            /* The node has a request in flight already, not a failure */
+            psIv->bWaiting = false;
+            psIv->xDue = xNow + pdMS_TO_TICKS(IV_RETRY_MS);
+            break;
+
+        default:
+            vIvFailLocked(psIv, xNow);
+            break;
+    }
+}
+
+/* The node handed to the bridge, E_ZCB_DEFERRED while the bridge has not
+ * taken the previous message: the service task does not wait for it */
+static teZcbStatus eIvAddNode(newdb_zcb_t *psZcb, uint8_t u8IasEndpoint, uint8_t u8NodeType, uint64_t u64IeeeAddress)
+{
+#if ZB_BRIDGE_TEST_COMMANDS
+    if (bIvStormNode(u64IeeeAddress)) {
+        /* Only timed, nothing is bridged */
+        return E_ZCB_OK;
+    }
+#else
+    (void)u64IeeeAddress;
+#endif
+
+    vZCB_NodeSetBridgeType(psZcb->saddr, u8NodeType);
+    /* An IAS zone is added once enrolment has read its zone type */
+    if (psZcb->uSupportedClusters.sClusterBitmap.hasIasZone
+        && bZCB_IasZoneNodeFound(psZcb->saddr, u8IasEndpoint, psZcb)) {
+        return E_ZCB_OK;
+    }
+    return eZCB_PostMsg(BRIDGE_ADD_DEV, psZcb, NULL);
+}
+
+/* Called with the mutex held, what came of handing the node to the bridge */
+static void vIvAddedLocked(uint8_t u8Slot, uint16_t u16ShortAddress, teZcbStatus eStatus, TickType_t xNow)
+{
+    tsInterview *psIv = &asInterviews[u8Slot];
+    uint32_t u32BridgedMs;
+
+    /* Gone meanwhile, or the node has moved to another slot */
+    if ((psIv->eStep == E_IV_FREE) || !psIv->bAddDue || (psIv->u16ShortAddress != u16ShortAddress)) {
+        return;
+    }
+    if (eStatus != E_ZCB_OK) {
+        sStats.u32AddDeferred++;
+        return;
+    }
+
+    psIv->bAddDue = false;
+    u32BridgedMs = u32IvElapsedMs(psIv->xJoined, xNow);
+    sStats.u32BridgedLastMs = u32BridgedMs;
+    if (u32BridgedMs > sStats.u32BridgedMaxMs) {
+        sStats.u32BridgedMaxMs = u32BridgedMs;
+    }
+#if ZB_BRIDGE_TEST_COMMANDS
+    if (bIvStormNode(psIv->u64IeeeAddress)) {
+        u8StormBridged++;
+        u32StormBridgedSumMs += u32BridgedMs;
+        if (u32BridgedMs > u32StormBridgedMaxMs) {
+            u32StormBridgedMaxMs = u32BridgedMs;
+        }
+    }
+#endif
+    if ((psIv->eStep == E_IV_DONE) && !psIv->bStoreDue) {
+        psIv->eStep = E_IV_FREE;
+    }
+}
+
+#if ZB_BRIDGE_TEST_COMMANDS
+/* The measure fills the device table with its own nodes and clears it
+ * after, so it is only built into test builds. */
+
+/* Called with the mutex held, the storm requests whose answer is due */
+static void vIvStormAnswerLocked(TickType_t xNow)
+{
+    for (uint8_t i = 0; i < ZCB_INTERVIEW_MAX_NODES; i++)
+    {
+        tsInterview *psIv = &asInterviews[i];
+
+        if (!abStormAnswer[i] || ((int32_t)(xNow - axStormAnswer[i]) < 0)) {
+            continue;
+        }
+        abStormAnswer[i] = false;
+        if ((psIv->eStep != E_IV_FREE) && bIvStormNode(psIv->u64IeeeAddress)
+            && psIv->bWaiting && (psIv->u8Seq == au8StormSeq[i])) {
+            vIvAdvanceLocked(psIv, xNow);
+        }
+    }
+}
+
+/* Called with the mutex held; true once the last storm node is done */
+static bool bIvStormDoneLocked(uint8_t u8Running)
+{
+    uint8_t u8Left = 0;
+
+    if (!bStormRunning) {
+        return false;
+    }
+    if (u8Running > u8StormPeak) {
+        u8StormPeak = u8Running;
+    }
+    for (uint8_t i = 0; i < ZCB_INTERVIEW_MAX_NODES; i++)
+    {
+        if ((asInterviews[i].eStep != E_IV_FREE) && bIvStormNode(asInterviews[i].u64IeeeAddress)) {
+            u8Left++;
+        }
+    }
+    return (u8Left == 0);
+}
+
+static void vIvStormReport(TickType_t xNow)
+{
+    uint32_t u32InterviewMs = u32StormInterviewSumMs / u8StormJoins;
+
+    PRINTF("\n ### Join storm: %d simultaneous join(s), %d interviewed at once at most\n", u8StormJoins, u8StormPeak);
+    if (u8StormBridged > 0) {
+        PRINTF(" ### Time to bridged: average %d ms, last %d ms; %d of %d bridged\n",
+               (int)(u32StormBridgedSumMs / u8StormBridged), (int)u32StormBridgedMaxMs, u8StormBridged, u8StormJoins);
+    }
+    PRINTF(" ### All interviews done in %d ms; one at a time, %d ms each, the last would be bridged after %d ms\n",
+           (int)u32IvElapsedMs(xStormStart, xNow), (int)u32InterviewMs, (int)(u32InterviewMs * u8StormJoins));
+
+    vZDM_ClearAllDeviceTables();
+    bStormRunning = false;
+}
+
+void vZCB_InterviewStorm(uint8_t u8Joins)
+{
+    uint8_t u8Endpoint = IV_STORM_ENDPOINT;
+    tsZbDeviceInfo *psDevice;
+    tsInterview *psIv;
+    TickType_t xNow;
+    uint8_t u8Queued = 0;
+
+    if ((xIvMutex == NULL) || bStormRunning || (u8Joins == 0)) {
+        PRINTF("\n ### Join storm: one is running already\n");
+        return;
+    }
+    for (uint8_t i = 0; i < MAX_ZD_DEVICE_NUMBERS; i++)
+    {
+        if (tZDM_FindDeviceByIndex(i)->u16NodeId != 0) {
+            PRINTF("\n ### Join storm: the bridge has nodes, it only runs on an empty network\n");
+            return;
+        }
+    }
+
+    xNow = xTaskGetTickCount();
+    xSemaphoreTake(xIvMutex, portMAX_DELAY);
+    for (uint8_t i = 0; i < u8Joins; i++)
+    {
+        psIv = psIvAlloc();
+        psDevice = (psIv != NULL) ? tZDM_AddNewDeviceToDeviceTable(IV_STORM_FIRST_ADDRESS + i, IV_STORM_IEEE_BASE | i)
+                                  : NULL;
+        if ((psDevice == NULL)
+            || !bZDM_SetDeviceEndpoints(psDevice, 1, &u8Endpoint)
+            || (tZDM_SetEndpointClusters(psDevice, u8Endpoint, E_ZB_DEVICEID_LIGHT_COLOR_EXT,
+                                         sizeof(au16StormClusters) / sizeof(au16StormClusters[0]),
+                                         au16StormClusters) == NULL)) {
+            break;
+        }
+        /* As eZCB_InterviewStart() queues a node announced */
+        memset(psIv, 0, sizeof(tsInterview));
+        psIv->eStep           = E_IV_WAITING;
+        psIv->u16ShortAddress = IV_STORM_FIRST_ADDRESS + i;
+        psIv->u64IeeeAddress  = IV_STORM_IEEE_BASE | i;
+        psIv->xJoined         = xNow;
+        psIv->xDue            = xNow + pdMS_TO_TICKS(ZCB_INTERVIEW_ANNOUNCE_DELAY_MS);
+        u8Queued++;
+    }
+    if (u8Queued > 0) {
+        bStormRunning          = true;
+        u8StormJoins           = u8Queued;
+        u8StormBridged         = 0;
+        u8StormPeak            = 0;
+        xStormStart            = xNow;
+        u32StormBridgedSumMs   = 0;
+        u32StormBridgedMaxMs   = 0;
+        u32StormInterviewSumMs = 0;
+        memset(abStormAnswer, 0, sizeof(abStormAnswer));
+    } else {
+        vZDM_ClearAllDeviceTables();
+    }
+    xSemaphoreGive(xIvMutex);
+
+    if (u8Queued < u8Joins) {
+        PRINTF("\n ### Join storm: room for %d of %d join(s)\n", u8Queued, u8Joins);
+    }
+}
+#endif
+
+void vZCB_InterviewInit(void)
+{
+    memset(&sStats, 0, sizeof(sStats));
+    memset(asInterviews, 0, sizeof(asInterviews));
+#if ZB_BRIDGE_TEST_COMMANDS
+    bStormRunning = false;
+#endif
+
+    if (xIvMutex == NULL) {
+        xIvMutex = xSemaphoreCreateMutex();
+    }
+}
+
+teZcbStatus eZCB_InterviewStart(uint16_t u16ShortAddress, uint64_t u64IeeeAddress, uint32_t u32DelayMs)
+{
+    tsInterview *psIv;
+    TickType_t xNow;
+    uint8_t u8Waiting = 0;
+
+    if (xIvMutex == NULL) {
+        return E_ZCB_ERROR;
+    }
+
+    xNow = xTaskGetTickCount();
+    xSemaphoreTake(xIvMutex, portMAX_DELAY);
+    for (uint8_t i = 0; i < ZCB_INTERVIEW_MAX_NODES; i++)
+    {
+        if ((asInterviews[i].eStep != E_IV_FREE) && (asInterviews[i].u64IeeeAddress == u64IeeeAddress)) {
+            /* Announced again, or found by a sweep, while already queued */
+            asInterviews[i].u16ShortAddress = u16ShortAddress;
+            xSemaphoreGive(xIvMutex);
+            return E_ZCB_OK;
+        }
+        if (asInterviews[i].eStep == E_IV_WAITING) {
+            u8Waiting++;
+        }
+    }
+
+    psIv = psIvAlloc();
+    if (psIv == NULL) {
+        sStats.u32QueueFull++;
+        xSemaphoreGive(xIvMutex);
+        PRINTF("\n ### Interview queue full, 0x%04x not interviewed\n", u16ShortAddress);
+        return E_ZCB_INSUFFICIENT_SPACE;
+    }
+
+    memset(psIv, 0, sizeof(tsInterview));
+    psIv->eStep           = E_IV_WAITING;
+    psIv->u16ShortAddress = u16ShortAddress;
+    psIv->u64IeeeAddress  = u64IeeeAddress;
+    psIv->xJoined         = xNow;
+    psIv->xDue            = xNow + pdMS_TO_TICKS(u32DelayMs);
+    sStats.u32Queued++;
+    if (++u8Waiting > sStats.u8PeakWaiting) {
+        sStats.u8PeakWaiting = u8Waiting;
+    }
+    xSemaphoreGive(xIvMutex);
+
+    return E_ZCB_OK;
+}
+
+/* Called by the response handlers on the callback task */
+static void vIvAnswered(uint16_t u16ShortAddress, teIvStep eStep, uint8_t u8Endpoint)
+{
+    tsInterview *psIv;
+    tsZbDeviceInfo *psDevice;
+
+    if (xIvMutex == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(xIvMutex, portMAX_DELAY);
+    psIv = psIvFind(u16ShortAddress);
+    if ((psIv != NULL) && (psIv->eStep == eStep)) {
+        if (eStep == E_IV_SIMPLE_DESC) {
+            /* Only the descriptor of the endpoint asked for moves it on */
+            const tsZbDeviceEndPoint *psEndpoint;
+            bool bOther;
+
+            psDevice   = tZDM_FindDeviceByNodeId(u16ShortAddress);
+            vZDM_ArenaLock();
+            psEndpoint = tZDM_FindEndpointByIndex(psDevice, psIv->u8Endpoint);
+            bOther     = (psEndpoint == NULL) || (psEndpoint->u8EndpointId != u8Endpoint);
+            vZDM_ArenaUnlock();
+            if (bOther) {
+                xSemaphoreGive(xIvMutex);
+                return;
+            }
+        }
+        vIvAdvanceLocked(psIv, xTaskGetTickCount());
+    }
+    xSemaphoreGive(xIvMutex);
+}
+
+void vZCB_InterviewActiveEndpoints(uint16_t u16ShortAddress)
+{
+    vIvAnswered(u16ShortAddress, E_IV_ACTIVE_EP, 0);
+}
+
+void vZCB_InterviewSimpleDescriptor(uint16_t u16ShortAddress, uint8_t u8Endpoint)
+{
+    vIvAnswered(u16ShortAddress, E_IV_SIMPLE_DESC, u8Endpoint);
+}
+
+void vZCB_InterviewModelId(uint16_t u16ShortAddress)
+{
+    vIvAnswered(u16ShortAddress, E_IV_MODEL_ID, 0);
+}
+
+void vZCB_InterviewProfileRead(uint16_t u16ShortAddress, const tsZCB_ProfileKey *psKey)
+{
+    tsInterview *psIv;
+
+    if (xIvMutex == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(xIvMutex, portMAX_DELAY);
+    psIv = psIvFind(u16ShortAddress);
+    if ((psIv != NULL) && (psIv->eStep == E_IV_PROFILE)) {
+        psIv->sKey = *psKey;
+        psIv->bKeyValid = (psKey->acModel[0] != '\0');
+        vIvAdvanceLocked(psIv, xTaskGetTickCount());
+    }
+    xSemaphoreGive(xIvMutex);
+}
+
+void vZCB_InterviewSetConcurrency(uint8_t u8Value)
+{
+    if ((u8Value >= 1) && (u8Value <= ZCB_INTERVIEW_MAX_NODES)) {
+        u8Concurrency = u8Value;
+    }
+}
+
+void vZCB_InterviewPoll(void)
+{
+    tsIvRequest asRequests[IV_REQUESTS_PER_POLL];
+    uint16_t au16FlowTimeout[IV_REQUESTS_PER_POLL];
+    newdb_zcb_t sZcb;
+    tsZCB_ProfileKey sStoreKey;
+    tsInterview *psIv;
+    TickType_t xNow;
+    uint16_t u16StoreAddress = 0;
+    uint32_t u32StoreMs = 0;
+    uint8_t u8Requests = 0;
+    uint8_t u8FlowTimeouts = 0;
+    uint8_t u8Running = 0;
+    uint64_t u64AddIeeeAddress = 0;
+    uint8_t u8AddSlot = 0;
+    uint8_t u8AddNodeType = 0;
+    uint8_t u8IasEndpoint = 0;
+    bool bAdd = false;
+    bool bStore = false;
+#if ZB_BRIDGE_TEST_COMMANDS
+    bool bStormDone;
+#endif
+
+    if (xIvMutex == NULL) {
+        return;
+    }
+
+    xNow = xTaskGetTickCount();
+    xSemaphoreTake(xIvMutex, portMAX_DELAY);
+#if ZB_BRIDGE_TEST_COMMANDS
+    vIvStormAnswerLocked(xNow);
+#endif
+
+    for (uint8_t i = 0; i < ZCB_INTERVIEW_MAX_NODES; i++)
+    {
+        if ((asInterviews[i].eStep >= E_IV_PROFILE) && (asInterviews[i].eStep <= E_IV_BIND)) {
+            u8Running++;
+        }
+    }
+
+    /* Free slots go to the nodes waiting longest */
+    while (u8Running < u8Concurrency)
+    {
+        tsInterview *psOldest = NULL;
+
+        for (uint8_t i = 0; i < ZCB_INTERVIEW_MAX_NODES; i++)
+        {
+            psIv = &asInterviews[i];
+            if ((psIv->eStep == E_IV_WAITING) && ((int32_t)(xNow - psIv->xDue) >= 0)
+                && ((psOldest == NULL) || ((int32_t)(psIv->xJoined - psOldest->xJoined) < 0))) {
+                psOldest = psIv;
+            }
+        }
+        if (psOldest == NULL) {
+            break;
+        }
+        psOldest->eStep    = E_IV_PROFILE;
+        psOldest->xStarted = xNow;
+        u8Running++;
+        sStats.u32Started++;
+    }
+
+    for (uint8_t i = 0; i < ZCB_INTERVIEW_MAX_NODES; i++)
+    {
+        psIv = &asInterviews[i];
+
+        if (psIv->eStep == E_IV_FREE) {
+            continue;
+        }
+
+        if (psIv->bWaiting && ((int32_t)(xNow - psIv->xDeadline) >= 0)) {
+            sStats.u32Timeouts++;
+            if (((psIv->eStep == E_IV_PROFILE) || (psIv->eStep == E_IV_MODEL_ID))
+                && (u8FlowTimeouts < IV_REQUESTS_PER_POLL)) {
+                au16FlowTimeout[u8FlowTimeouts++] = psIv->u16ShortAddress;
+            }
+            vIvFailLocked(psIv, xNow);
+        }
+
+        if ((psIv->eStep == E_IV_DONE) || ((psIv->eStep > E_IV_SIMPLE_DESC) && psIv->bAddDue)) {
+            /* One add per poll, the bridge takes one message at a time. It
+             * stays due until the bridge has taken it. */
+            if (psIv->bAddDue && !bAdd) {
+                bAdd = true;
+                u8AddSlot = i;
+                memset(&sZcb, 0, sizeof(sZcb));
+                sZcb.saddr = psIv->u16ShortAddress;
+                sZcb.uSupportedClusters.u64 = psIv->u64Clusters;
+                u8IasEndpoint = psIv->u8IasEndpoint;
+                u8AddNodeType = psIv->u8NodeType;
+                u64AddIeeeAddress = psIv->u64IeeeAddress;
+            }
+            /* One profile kept per poll as well, each one is a flash write */
+            if ((psIv->eStep == E_IV_DONE) && psIv->bStoreDue && !bStore) {
+                psIv->bStoreDue = false;
+                bStore          = true;
+                sStoreKey       = psIv->sKey;
+                u16StoreAddress = psIv->u16ShortAddress;
+                u32StoreMs      = psIv->u32ProfileMs;
+            }
+            if ((psIv->eStep == E_IV_DONE) && !psIv->bAddDue && !psIv->bStoreDue) {
+                psIv->eStep = E_IV_FREE;
+                continue;
+            }
+        }
+
+        if ((u8Requests < IV_REQUESTS_PER_POLL)
+            && bIvTakeRequestLocked(psIv, i, xNow, &asRequests[u8Requests])) {
+            u8Requests++;
+        }
+    }
+
+    if (u8Running > sStats.u8PeakRunning) {
+        sStats.u8PeakRunning = u8Running;
+    }
+#if ZB_BRIDGE_TEST_COMMANDS
+    bStormDone = bIvStormDoneLocked(u8Running);
+#endif
+    xSemaphoreGive(xIvMutex);
+
+    /* Sent without the mutex, the responses take it on the callback task */
+    for (uint8_t i = 0; i < u8Requests; i++)
+    {
+        teZcbStatus eStatus = eIvSend(&asRequests[i]);
+
+        xSemaphoreTake(xIvMutex, portMAX_DELAY);
+        vIvSentLocked(&asRequests[i], eStatus, xTaskGetTickCount());
+        xSemaphoreGive(xIvMutex);
+    }
+
+    for (uint8_t i = 0; i < u8FlowTimeouts; i++)
+    {
+        vZCB_NodeFlowTimeout(au16FlowTimeout[i]);
+    }
+
+    if (bAdd) {
+        teZcbStatus eStatus = eIvAddNode(&sZcb, u8IasEndpoint, u8AddNodeType, u64AddIeeeAddress);
+
+        xSemaphoreTake(xIvMutex, portMAX_DELAY);
+        vIvAddedLocked(u8AddSlot, sZcb.saddr, eStatus, xTaskGetTickCount());
+        xSemaphoreGive(xIvMutex);
+    }
+
+    if (bStore) {
+        vZCB_ProfileStore(&sStoreKey, u16StoreAddress, u32StoreMs);
+    }
+
+#if ZB_BRIDGE_TEST_COMMANDS
+    if (bStormDone) {
+        vIvStormReport(xNow);
+    }
+#endif
+}
+
+void vZCB_InterviewDump(void)
+{
+    TickType_t xNow = xTaskGetTickCount();
+
+    if (xIvMutex == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(xIvMutex, portMAX_DELAY);
+    PRINTF("\n Interviews: %d at once (peak %d, %d waiting at most), queued %d, started %d, done %d, dropped %d, full %d\n",
+           u8Concurrency, sStats.u8PeakRunning, sStats.u8PeakWaiting, (int)sStats.u32Queued,
+           (int)sStats.u32Started, (int)sStats.u32Completed, (int)sStats.u32Dropped, (int)sStats.u32QueueFull);
+    PRINTF(" Requests %d, timeouts %d, adds put off %d; time to bridged last %d ms, max %d ms; to active last %d ms\n",
+           (int)sStats.u32Requests, (int)sStats.u32Timeouts, (int)sStats.u32AddDeferred,
+           (int)sStats.u32BridgedLastMs, (int)sStats.u32BridgedMaxMs, (int)sStats.u32DoneLastMs);
+    PRINTF(" Node   Step       EP  Try Since\n");
+    for (uint8_t i = 0; i < ZCB_INTERVIEW_MAX_NODES; i++)
+    {
+        const tsInterview *psIv = &asInterviews[i];
+
+        if (psIv->eStep == E_IV_FREE) {
+            continue;
+        }
+        PRINTF(" 0x%04x %-10s %3d %3d %d ms\n", psIv->u16ShortAddress, pcIvStep(psIv->eStep),
+               psIv->u8Endpoint, psIv->u8Attempts, (int)u32IvElapsedMs(psIv->xJoined, xNow));
+    }
+    xSemaphoreGive(xIvMutex);
+}
+
+void vZCB_InterviewGetStats(tsZCB_InterviewStats *psStats)
+{
+    if (psStats != NULL) {
+        *psStats = sStats;
+    }
+}
+
+// ------------------------------------------------------------------
+// END OF FILE
+// ------------------------------------------------------------------
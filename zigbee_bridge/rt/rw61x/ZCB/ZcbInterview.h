@@ -0,0 +1,124 @@
+/*
+ * Copyright 2021-2023 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef ZCBINTERVIEW_H
+#define ZCBINTERVIEW_H
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+/****************************************************************************/
+/***        Include files                                                 ***/
+/****************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "zcb.h"
+#include "ZcbProfileCache.h"
+
+/****************************************************************************/
+/***        Macro Definitions                                             ***/
+/****************************************************************************/
+
+/* Nodes waiting for or going through an interview */
+#define ZCB_INTERVIEW_MAX_NODES                 24
+/* Interviews running at the same time, the others wait their turn.
+ * Changed at run time with vZCB_InterviewSetConcurrency() */
+#define ZCB_INTERVIEW_CONCURRENCY               4
+/* First request after a device announce. The coordinator saves the end
+ * device timeout to PDM then and does not take host requests well */
+#define ZCB_INTERVIEW_ANNOUNCE_DELAY_MS         100
+/* Wait for each response, and attempts of each request */
+#define ZCB_INTERVIEW_RESPONSE_TIMEOUT_MS       1000
+#define ZCB_INTERVIEW_ATTEMPTS                  2
+/* A bind is answered by the node through the coordinator */
+#define ZCB_INTERVIEW_BIND_TIMEOUT_MS           (6 * 1000)
+/* A request held for a sleepy node waits for its next poll */
+#define ZCB_INTERVIEW_SLEEPY_TIMEOUT_MS         (30 * 1000)
+#if ZB_BRIDGE_TEST_COMMANDS
+/* Nodes of the join storm measure, and the time each request of theirs
+ * takes to be answered */
+#define ZCB_INTERVIEW_STORM_JOINS               20
+#define ZCB_INTERVIEW_STORM_RESPONSE_MS         150
+#endif
+
+
+/****************************************************************************/
+/***        Type Definitions                                              ***/
+/****************************************************************************/
+
+typedef struct
+{
+    uint32_t u32Queued;           /**< Interviews asked for */
+    uint32_t u32Started;          /**< Interviews given a slot */
+    uint32_t u32Completed;        /**< Nodes taken to the active state */
+    uint32_t u32Dropped;          /**< Nodes gone before the end */
+    uint32_t u32QueueFull;        /**< Interviews refused, no room */
+    uint32_t u32Requests;         /**< Requests sent, retries included */
+    uint32_t u32Timeouts;         /**< Requests not answered in time */
+    uint32_t u32AddDeferred;      /**< Bridge adds put off to the next poll, the bridge busy */
+    uint8_t  u8PeakRunning;       /**< Most interviews running at once */
+    uint8_t  u8PeakWaiting;       /**< Most interviews waiting for a slot */
+    uint32_t u32BridgedLastMs;    /**< Join to Matter endpoint, last node */
+    uint32_t u32BridgedMaxMs;
+    uint32_t u32DoneLastMs;       /**< Join to active state, last node */
+} tsZCB_InterviewStats;
+
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+
+void vZCB_InterviewInit(void);
+
+/** Queue the interview of a node in the device table. The first request goes
+ *  out after u32DelayMs, once an interview slot is free; a node already in
+ *  the queue only gets its short address updated. */
+teZcbStatus eZCB_InterviewStart(uint16_t u16ShortAddress, uint64_t u64IeeeAddress, uint32_t u32DelayMs);
+
+/** Responses carrying an interview on, called once the device table has
+ *  been updated from them */
+void vZCB_InterviewActiveEndpoints(uint16_t u16ShortAddress);
+void vZCB_InterviewSimpleDescriptor(uint16_t u16ShortAddress, uint8_t u8Endpoint);
+void vZCB_InterviewModelId(uint16_t u16ShortAddress);
+
+/** The Basic cluster read which opens an interview, with the model found
+ *  in it; an empty model identifier gives the node the full interview */
+void vZCB_InterviewProfileRead(uint16_t u16ShortAddress, const tsZCB_ProfileKey *psKey);
+
+/** Interviews running at the same time, 1 to ZCB_INTERVIEW_MAX_NODES */
+void vZCB_InterviewSetConcurrency(uint8_t u8Concurrency);
+
+#if ZB_BRIDGE_TEST_COMMANDS
+/** Interview u8Joins synthetic nodes joining at once, on an empty network.
+ *  They are put in the device table and go through the same interviews as
+ *  real nodes, but nothing is sent: each request is answered after
+ *  ZCB_INTERVIEW_STORM_RESPONSE_MS and the bridge add is only timed. The
+ *  time to bridged is printed when the last one is done, and the device
+ *  table is cleared. */
+void vZCB_InterviewStorm(uint8_t u8Joins);
+#endif
+
+/** Called from the ZCB service task */
+void vZCB_InterviewPoll(void);
+
+/** Print the interviews in progress and the time to bridged */
+void vZCB_InterviewDump(void);
+
+void vZCB_InterviewGetStats(tsZCB_InterviewStats *psStats);
+
+#if defined __cplusplus
+}
+#endif
+
+#endif  /* ZCBINTERVIEW_H */
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
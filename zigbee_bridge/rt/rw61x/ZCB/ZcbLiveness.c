@@ -0,0 +1,524 @@
+/*
+ * Copyright 2021-2023 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+#include "fsl_debug_console.h"
+
+#include <string.h>
+#include <stdbool.h>
+
+#include "ZigbeeConstant.h"
+#include "ZigbeeDevices.h"
+#include "zcb.h"
+#include "ZcbLiveness.h"
+
+/*
+ * Liveness of the nodes.
+ *
+ * Each device had a 65 second FreeRTOS timer: every report reset it
+ * through the timer service queue, and five expiries in a row marked the
+ * device offline without Matter being told. A report now only writes the
+ * last seen time into the device table. One hierarchical timing wheel,
+ * swept every second from the service task, holds each tracked device
+ * once, in the slot of the time its timeout would run out if it were not
+ * heard again. When the slot comes up the device is offline if it really
+ * was silent that long, otherwise it goes back in at its new deadline, so
+ * a device costs the sweep one look per timeout at most however often it
+ * reports. Reachable changes are handed to the bridge on the next sweep.
+ */
+
+#define LIVENESS_NONE           0xFF
+#define LIVENESS_SLOTS          (1 << ZCB_LIVENESS_SLOT_BITS)
+#define LIVENESS_SLOT_MASK      (LIVENESS_SLOTS - 1)
+/* Seconds ahead the wheel reaches */
+#define LIVENESS_RANGE          (1UL << (ZCB_LIVENESS_LEVELS * ZCB_LIVENESS_SLOT_BITS))
+#define LIVENESS_PENDING_BYTES  ((MAX_ZD_DEVICE_NUMBERS + 7) / 8)
+
+/* The wheel links are device table indexes, LIVENESS_NONE is not one */
+#if MAX_ZD_DEVICE_NUMBERS > LIVENESS_NONE
+#error "Device table too large for the liveness wheel"
+#endif
+
+/* Heads of the slot lists, and per device its neighbours and its slot:
+ * the level in the top bits, LIVENESS_NONE when not in the wheel */
+static uint8_t au8Head[ZCB_LIVENESS_LEVELS][LIVENESS_SLOTS];
+static uint8_t au8Next[MAX_ZD_DEVICE_NUMBERS];
+static uint8_t au8Prev[MAX_ZD_DEVICE_NUMBERS];
+static uint8_t au8Slot[MAX_ZD_DEVICE_NUMBERS];
+/* Devices whose Reachable changed since the last sweep */
+static uint8_t au8Pending[LIVENESS_PENDING_BYTES];
+/* Next second the wheel sweeps */
+static uint32_t u32WheelNext;
+static uint32_t u32Now;
+static TickType_t xClockTick;
+#if ZB_BRIDGE_TEST_COMMANDS
+/* The wheel is driven by vZCB_LivenessMeasure(), the poll leaves it alone */
+static volatile bool bMeasuring;
+#endif
+static uint16_t u16SecondVisited;
+static tpfZCB_LivenessReachable pfReachableHook;
+static tsZCB_LivenessStats sStats;
+static SemaphoreHandle_t xLivenessMutex = NULL;
+
+
+static uint32_t u32LivenessTimeout(const tsZbDeviceInfo *psDevice)
+{
+    return psDevice->bSleepy ? ZCB_LIVENESS_SLEEPY_TIMEOUT_S : ZCB_LIVENESS_MAINS_TIMEOUT_S;
+}
+
+static void vWheelUnlink(uint8_t i)
+{
+    uint8_t u8Slot = au8Slot[i];
+
+    if (u8Slot == LIVENESS_NONE) {
+        return;
+    }
+    if (au8Prev[i] == LIVENESS_NONE) {
+        au8Head[u8Slot >> ZCB_LIVENESS_SLOT_BITS][u8Slot & LIVENESS_SLOT_MASK] = au8Next[i];
+    } else {
+        au8Next[au8Prev[i]] = au8Next[i];
+    }
+    if (au8Next[i] != LIVENESS_NONE) {
+        au8Prev[au8Next[i]] = au8Prev[i];
+    }
+    au8Slot[i] = LIVENESS_NONE;
+    sStats.u16Tracked--;
+}
+
+/* Into the slot of its deadline: the lowest level whose span from the next
+ * second covers it. A deadline already gone is swept next. */
+static void vWheelLink(uint8_t i, uint32_t u32Deadline)
+{
+    uint32_t u32Ahead;
+    uint8_t u8Level = 0;
+    uint8_t u8Slot;
+
+    if ((int32_t)(u32Deadline - u32WheelNext) < 0) {
+        u32Deadline = u32WheelNext;
+    }
+    u32Ahead = u32Deadline - u32WheelNext;
+    if (u32Ahead >= LIVENESS_RANGE) {
+        u32Deadline = u32WheelNext + LIVENESS_RANGE - 1;
+        u32Ahead = LIVENESS_RANGE - 1;
+    }
+    while (u32Ahead >= (1UL << ((u8Level + 1) * ZCB_LIVENESS_SLOT_BITS))) {
+        u8Level++;
+    }
+    u8Slot = (u32Deadline >> (u8Level * ZCB_LIVENESS_SLOT_BITS)) & LIVENESS_SLOT_MASK;
+
+    au8Prev[i] = LIVENESS_NONE;
+    au8Next[i] = au8Head[u8Level][u8Slot];
+    if (au8Next[i] != LIVENESS_NONE) {
+        au8Prev[au8Next[i]] = i;
+    }
+    au8Head[u8Level][u8Slot] = i;
+    au8Slot[i] = (uint8_t)((u8Level << ZCB_LIVENESS_SLOT_BITS) | u8Slot);
+    sStats.u16Tracked++;
+}
+
+static void vLivenessPending(uint8_t i, bool bSet)
+{
+    if (bSet) {
+        au8Pending[i / 8] |= (uint8_t)(1 << (i % 8));
+    } else {
+        au8Pending[i / 8] &= (uint8_t)~(1 << (i % 8));
+    }
+}
+
+/* Take the whole list of a slot and look at each entry once: a lower level
+ * moves it down towards its deadline, level 0 expires it when the deadline
+ * is the second swept. Entries going back in may land in the same slot. */
+static void vWheelSweep(uint8_t u8Level, uint8_t u8Slot)
+{
+    uint8_t i = au8Head[u8Level][u8Slot];
+    uint8_t u8Next;
+    tsZbDeviceInfo *psDevice;
+    uint32_t u32Deadline;
+
+    au8Head[u8Level][u8Slot] = LIVENESS_NONE;
+    for (; i != LIVENESS_NONE; i = u8Next)
+    {
+        u8Next = au8Next[i];
+        au8Slot[i] = LIVENESS_NONE;
+        sStats.u16Tracked--;
+        u16SecondVisited++;
+
+        /* The entry went, or was taken again by a device not heard yet */
+        psDevice = tZDM_FindDeviceByIndex(i);
+        if ((psDevice->u16NodeId == 0) || (psDevice->u32LastSeen == 0)) {
+            continue;
+        }
+        u32Deadline = psDevice->u32LastSeen + u32LivenessTimeout(psDevice);
+        if ((u8Level == 0) && ((int32_t)(u32Deadline - u32WheelNext) <= 0)) {
+            if (psDevice->eDeviceState != E_ZB_DEVICE_STATE_OFF_LINE) {
+                psDevice->eDeviceState = E_ZB_DEVICE_STATE_OFF_LINE;
+                vLivenessPending(i, true);
+                sStats.u32Expired++;
+            }
+            continue;
+        }
+        vWheelLink(i, u32Deadline);
+    }
+}
+
+/* Sweep every second up to u32To, cascading the upper levels as their
+ * slots come up */
+static void vWheelAdvance(uint32_t u32To)
+{
+    while ((int32_t)(u32To - u32WheelNext) >= 0)
+    {
+        if (sStats.u16Tracked == 0) {
+            u32WheelNext = u32To + 1;
+            break;
+        }
+        u16SecondVisited = 0;
+        for (uint8_t u8Level = ZCB_LIVENESS_LEVELS - 1; u8Level > 0; u8Level--)
+        {
+            if ((u32WheelNext & ((1UL << (u8Level * ZCB_LIVENESS_SLOT_BITS)) - 1)) == 0) {
+                vWheelSweep(u8Level, (u32WheelNext >> (u8Level * ZCB_LIVENESS_SLOT_BITS)) & LIVENESS_SLOT_MASK);
+            }
+        }
+        vWheelSweep(0, u32WheelNext & LIVENESS_SLOT_MASK);
+        sStats.u32Seconds++;
+        sStats.u32Visited += u16SecondVisited;
+        if (u16SecondVisited > sStats.u16MaxVisited) {
+            sStats.u16MaxVisited = u16SecondVisited;
+        }
+        u32WheelNext++;
+    }
+}
+
+/* Empty wheel, sweeping from the current second */
+static void vWheelReset(void)
+{
+    memset(au8Head, LIVENESS_NONE, sizeof(au8Head));
+    memset(au8Slot, LIVENESS_NONE, sizeof(au8Slot));
+    memset(au8Pending, 0, sizeof(au8Pending));
+    sStats.u16Tracked = 0;
+    u32WheelNext = u32Now + 1;
+}
+
+/* Called with the mutex held */
+static void vLivenessSeenLocked(uint8_t u8Device, tsZbDeviceInfo *psDevice)
+{
+    psDevice->u32LastSeen = u32Now;
+    if (au8Slot[u8Device] == LIVENESS_NONE) {
+        vWheelLink(u8Device, u32Now + u32LivenessTimeout(psDevice));
+    }
+    if (psDevice->eDeviceState == E_ZB_DEVICE_STATE_OFF_LINE) {
+        psDevice->eDeviceState = E_ZB_DEVICE_STATE_ACTIVE;
+        vLivenessPending(u8Device, true);
+        sStats.u32Revived++;
+    }
+}
+
+void vZCB_LivenessInit(void)
+{
+    memset(&sStats, 0, sizeof(sStats));
+    /* 0 is the last seen time of a device never heard */
+    u32Now = 1;
+    xClockTick = xTaskGetTickCount();
+#if ZB_BRIDGE_TEST_COMMANDS
+    bMeasuring = false;
+#endif
+    vWheelReset();
+
+    if (xLivenessMutex == NULL) {
+        xLivenessMutex = xSemaphoreCreateMutex();
+    }
+}
+
+void vZCB_LivenessSetReachableHook(tpfZCB_LivenessReachable pfReachable)
+{
+    pfReachableHook = pfReachable;
+}
+
+void vZCB_LivenessSeen(uint8_t u8Device)
+{
+    tsZbDeviceInfo *psDevice = tZDM_FindDeviceByIndex(u8Device);
+
+    if ((xLivenessMutex == NULL) || (psDevice == NULL) || (psDevice->u16NodeId == 0)) {
+        return;
+    }
+
+    xSemaphoreTake(xLivenessMutex, portMAX_DELAY);
+    vLivenessSeenLocked(u8Device, psDevice);
+    xSemaphoreGive(xLivenessMutex);
+}
+
+void vZCB_LivenessForget(uint8_t u8Device)
+{
+    if ((xLivenessMutex == NULL) || (u8Device >= MAX_ZD_DEVICE_NUMBERS)) {
+        return;
+    }
+
+    xSemaphoreTake(xLivenessMutex, portMAX_DELAY);
+    vWheelUnlink(u8Device);
+    vLivenessPending(u8Device, false);
+    xSemaphoreGive(xLivenessMutex);
+}
+
+uint32_t u32ZCB_LivenessNow(void)
+{
+    return u32Now;
+}
+
+void vZCB_LivenessPoll(void)
+{
+    uint8_t au8Changed[LIVENESS_PENDING_BYTES];
+    TickType_t xNow = xTaskGetTickCount();
+    uint32_t u32Seconds;
+    tsZbDeviceInfo *psDevice;
+    uint16_t u16DynamicEp;
+
+    if (xLivenessMutex == NULL) {
+        return;
+    }
+#if ZB_BRIDGE_TEST_COMMANDS
+    if (bMeasuring) {
+        return;
+    }
+#endif
+
+    xSemaphoreTake(xLivenessMutex, portMAX_DELAY);
+    u32Seconds = (uint32_t)(xNow - xClockTick) / pdMS_TO_TICKS(1000);
+    if (u32Seconds != 0) {
+        xClockTick += u32Seconds * pdMS_TO_TICKS(1000);
+        u32Now += u32Seconds;
+        vWheelAdvance(u32Now);
+    }
+    memcpy(au8Changed, au8Pending, sizeof(au8Changed));
+    memset(au8Pending, 0, sizeof(au8Pending));
+    xSemaphoreGive(xLivenessMutex);
+
+    /* The hook takes the Matter stack lock, the mutex is not held */
+    for (uint8_t i = 0; i < MAX_ZD_DEVICE_NUMBERS; i++)
+    {
+        if ((au8Changed[i / 8] & (1 << (i % 8))) == 0) {
+            continue;
+        }
+        psDevice = tZDM_FindDeviceByIndex(i);
+        u16DynamicEp = (psDevice->u16NodeId == 0) ? 0 : u16ZCB_NodeDynamicEp(psDevice->u16NodeId);
+        PRINTF("\n ### Node 0x%04x %s\n", psDevice->u16NodeId,
+               (psDevice->eDeviceState == E_ZB_DEVICE_STATE_OFF_LINE) ? "offline" : "back online");
+        if ((u16DynamicEp != 0) && (pfReachableHook != NULL)) {
+            pfReachableHook(u16DynamicEp, psDevice->eDeviceState != E_ZB_DEVICE_STATE_OFF_LINE);
+            sStats.u32Pushed++;
+        }
+    }
+}
+
+uint32_t u32ZCB_LivenessRam(void)
+{
+    return sizeof(au8Head) + sizeof(au8Next) + sizeof(au8Prev) + sizeof(au8Slot) + sizeof(au8Pending);
+}
+
+#if ZB_BRIDGE_TEST_COMMANDS
+/* The measure fills the device table with its own devices and clears it
+ * after, so it is only built into test builds. */
+
+/* Synthetic device i of the measure: even ones mains powered reporting
+ * every minute, odd ones sleepy checking in every half hour. One in ten
+ * of each falls silent after the first hour. */
+#define LIVENESS_MEASURE_MAINS_S        60
+#define LIVENESS_MEASURE_SLEEPY_S       1800
+#define LIVENESS_MEASURE_SILENT_S       3600
+
+static bool bMeasureSilent(uint16_t i, uint32_t u32Second)
+{
+    return ((i % 10) == 0 || (i % 10) == 5) && (u32Second > LIVENESS_MEASURE_SILENT_S);
+}
+
+typedef enum
+{
+    E_MEASURE_REPORTS,      /* the reports alone */
+    E_MEASURE_WHEEL,        /* and the wheel swept every second */
+    E_MEASURE_SCAN,         /* and the device table scanned every second */
+    E_MEASURE_RUNS
+} teMeasureRun;
+
+/* One simulated run, its ticks; the devices gone offline in pu16Expired */
+static TickType_t xMeasureRun(teMeasureRun eRun, uint16_t u16Devices, uint16_t *pu16Expired)
+{
+    uint32_t u32Seconds = ZCB_LIVENESS_MEASURE_HOURS * 3600UL;
+    TickType_t xStart;
+    tsZbDeviceInfo *psDevice;
+
+    for (uint16_t i = 0; i < u16Devices; i++)
+    {
+        psDevice = tZDM_FindDeviceByIndex((uint8_t)i);
+        psDevice->u32LastSeen  = 0;
+        psDevice->eDeviceState = E_ZB_DEVICE_STATE_ACTIVE;
+    }
+    u32Now = 1;
+    vWheelReset();
+    for (uint16_t i = 0; i < u16Devices; i++)
+    {
+        vLivenessSeenLocked((uint8_t)i, tZDM_FindDeviceByIndex((uint8_t)i));
+    }
+
+    xStart = xTaskGetTickCount();
+    for (uint32_t t = 2; t <= u32Seconds; t++)
+    {
+        u32Now = t;
+
+        /* The devices reporting this second, found without a scan */
+        for (uint16_t i = 2 * (t % LIVENESS_MEASURE_MAINS_S); i < u16Devices; i += 2 * LIVENESS_MEASURE_MAINS_S)
+        {
+            if (!bMeasureSilent(i, t)) {
+                vLivenessSeenLocked((uint8_t)i, tZDM_FindDeviceByIndex((uint8_t)i));
+            }
+        }
+        if ((2 * (t % LIVENESS_MEASURE_SLEEPY_S) + 1 < u16Devices)
+            && !bMeasureSilent(2 * (t % LIVENESS_MEASURE_SLEEPY_S) + 1, t)) {
+            uint8_t i = (uint8_t)(2 * (t % LIVENESS_MEASURE_SLEEPY_S) + 1);
+
+            vLivenessSeenLocked(i, tZDM_FindDeviceByIndex(i));
+        }
+
+        if (eRun == E_MEASURE_WHEEL) {
+            vWheelAdvance(t);
+        } else if (eRun == E_MEASURE_SCAN) {
+            for (uint16_t i = 0; i < u16Devices; i++)
+            {
+                psDevice = tZDM_FindDeviceByIndex((uint8_t)i);
+                if ((psDevice->eDeviceState != E_ZB_DEVICE_STATE_OFF_LINE)
+                    && ((int32_t)(psDevice->u32LastSeen + u32LivenessTimeout(psDevice) - t) <= 0)) {
+                    psDevice->eDeviceState = E_ZB_DEVICE_STATE_OFF_LINE;
+                }
+            }
+        }
+    }
+    xStart = xTaskGetTickCount() - xStart;
+
+    *pu16Expired = 0;
+    for (uint16_t i = 0; i < u16Devices; i++)
+    {
+        if (tZDM_FindDeviceByIndex((uint8_t)i)->eDeviceState == E_ZB_DEVICE_STATE_OFF_LINE) {
+            (*pu16Expired)++;
+        }
+    }
+    return xStart;
+}
+
+void vZCB_LivenessMeasure(void)
+{
+    static const char *const apcRuns[E_MEASURE_RUNS] = { "Reports alone", "Wheel sweep", "Table scan" };
+    uint32_t u32Seconds = ZCB_LIVENESS_MEASURE_HOURS * 3600UL;
+    uint16_t u16Devices = 0;
+    uint16_t u16Silent = 0;
+    uint16_t au16Expired[E_MEASURE_RUNS];
+    TickType_t axTicks[E_MEASURE_RUNS];
+    tsZCB_LivenessStats sSaved;
+    uint32_t u32SavedNow;
+    tsZbDeviceInfo *psDevice;
+
+    if (xLivenessMutex == NULL) {
+        return;
+    }
+    for (uint8_t i = 0; i < MAX_ZD_DEVICE_NUMBERS; i++)
+    {
+        if (tZDM_FindDeviceByIndex(i)->u16NodeId != 0) {
+            PRINTF("\n ### Liveness measure: the bridge has devices, it only runs on an empty network\n");
+            return;
+        }
+    }
+
+    xSemaphoreTake(xLivenessMutex, portMAX_DELAY);
+    bMeasuring = true;
+    sSaved = sStats;
+    u32SavedNow = u32Now;
+
+    /* Empty already; its entries are handed out from the start again */
+    vZDM_ClearAllDeviceTables();
+    for (uint16_t i = 0; i < MAX_ZD_DEVICE_NUMBERS; i++)
+    {
+        psDevice = tZDM_AddNewDeviceToDeviceTable(i + 1, 0x00158D0000000000ULL | (i + 1));
+        if ((psDevice == NULL) || (psDevice != tZDM_FindDeviceByIndex((uint8_t)i))) {
+            break;
+        }
+        psDevice->bSleepy = (i % 2) != 0;
+        u16Devices++;
+        if (bMeasureSilent(i, u32Seconds)) {
+            u16Silent++;
+        }
+    }
+
+    for (uint8_t r = 0; r < E_MEASURE_RUNS; r++)
+    {
+        sStats.u32Seconds    = 0;
+        sStats.u32Visited    = 0;
+        sStats.u16MaxVisited = 0;
+        axTicks[r] = xMeasureRun((teMeasureRun)r, u16Devices, &au16Expired[r]);
+        if (r == E_MEASURE_WHEEL) {
+            PRINTF("\n ### Wheel: %d seconds swept, %d entries looked at, %d in the busiest second\n",
+                   (int)sStats.u32Seconds, (int)sStats.u32Visited, sStats.u16MaxVisited);
+        }
+    }
+
+    PRINTF("\n ### %d devices over %d hours, %d silent after the first hour\n",
+           u16Devices, ZCB_LIVENESS_MEASURE_HOURS, u16Silent);
+    for (uint8_t r = 0; r < E_MEASURE_RUNS; r++)
+    {
+        PRINTF(" ### %-14s %6d ms, %5d ns a second, %d offline\n", apcRuns[r],
+               (int)(axTicks[r] * portTICK_PERIOD_MS),
+               (int)((uint64_t)axTicks[r] * portTICK_PERIOD_MS * 1000000u / u32Seconds), au16Expired[r]);
+    }
+
+    vZDM_ClearAllDeviceTables();
+    sStats = sSaved;
+    u32Now = u32SavedNow;
+    vWheelReset();
+    bMeasuring = false;
+    xSemaphoreGive(xLivenessMutex);
+}
+#endif
+
+void vZCB_LivenessDump(void)
+{
+    uint8_t au8Count[ZCB_LIVENESS_LEVELS];
+
+    if (xLivenessMutex == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(xLivenessMutex, portMAX_DELAY);
+    memset(au8Count, 0, sizeof(au8Count));
+    for (uint8_t i = 0; i < MAX_ZD_DEVICE_NUMBERS; i++)
+    {
+        if (au8Slot[i] != LIVENESS_NONE) {
+            au8Count[au8Slot[i] >> ZCB_LIVENESS_SLOT_BITS]++;
+        }
+    }
+    PRINTF("\n ### Liveness at %d s: offline after %d s mains powered, %d s sleepy\n",
+           (int)u32Now, ZCB_LIVENESS_MAINS_TIMEOUT_S, ZCB_LIVENESS_SLEEPY_TIMEOUT_S);
+    PRINTF(" ### Wheel: %d tracked, %d / %d / %d on the 1 s / 64 s / 4096 s levels, %d bytes\n",
+           sStats.u16Tracked, au8Count[0], au8Count[1], au8Count[2], (int)u32ZCB_LivenessRam());
+    PRINTF(" ### %d expired, %d revived, %d pushed to the bridge\n",
+           (int)sStats.u32Expired, (int)sStats.u32Revived, (int)sStats.u32Pushed);
+    PRINTF(" ### %d seconds swept, %d entries looked at, %d in the busiest second\n",
+           (int)sStats.u32Seconds, (int)sStats.u32Visited, sStats.u16MaxVisited);
+    xSemaphoreGive(xLivenessMutex);
+}
+
+void vZCB_LivenessGetStats(tsZCB_LivenessStats *psStats)
+{
+    if (xLivenessMutex == NULL) {
+        memset(psStats, 0, sizeof(*psStats));
+        return;
+    }
+    xSemaphoreTake(xLivenessMutex, portMAX_DELAY);
+    *psStats = sStats;
+    xSemaphoreGive(xLivenessMutex);
+}
+
+// ------------------------------------------------------------------
+// END OF FILE
+// ------------------------------------------------------------------
@@ -0,0 +1,111 @@
+/*
+ * Copyright 2021-2023 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef ZCBLIVENESS_H
+#define ZCBLIVENESS_H
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+/****************************************************************************/
+/***        Include files                                                 ***/
+/****************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "ZigbeeConstant.h"
+
+/****************************************************************************/
+/***        Macro Definitions                                             ***/
+/****************************************************************************/
+
+/* Silence after which a node is offline, per class. A mains powered node
+ * reports at least every minute or so; a sleepy end device may only check
+ * in every hour. */
+#define ZCB_LIVENESS_MAINS_TIMEOUT_S            (5 * 65)
+#define ZCB_LIVENESS_SLEEPY_TIMEOUT_S           (3 * 60 * 60)
+
+/* Wheel levels, each of 64 slots: 1 s, 64 s and 4096 s a slot. Deadlines
+ * up to 72 hours ahead, farther ones are checked again then. */
+#define ZCB_LIVENESS_LEVELS                     3
+#define ZCB_LIVENESS_SLOT_BITS                  6
+
+/* Time simulated by vZCB_LivenessMeasure() */
+#define ZCB_LIVENESS_MEASURE_HOURS              48
+
+
+/****************************************************************************/
+/***        Type Definitions                                              ***/
+/****************************************************************************/
+
+/** A node bridged to a Matter dynamic endpoint went offline or came back */
+typedef void (*tpfZCB_LivenessReachable)(uint16_t u16DynamicEp, bool bReachable);
+
+typedef struct
+{
+    uint32_t u32Expired;          /**< Nodes found silent for their timeout */
+    uint32_t u32Revived;          /**< Offline nodes heard again */
+    uint32_t u32Pushed;           /**< Reachable changes handed to the bridge */
+    uint32_t u32Seconds;          /**< Wheel slots swept */
+    uint32_t u32Visited;          /**< Entries the sweeps looked at */
+    uint16_t u16MaxVisited;       /**< ... most in one second */
+    uint16_t u16Tracked;          /**< Nodes in the wheel */
+} tsZCB_LivenessStats;
+
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+
+void vZCB_LivenessInit(void);
+
+/** Told of every Reachable change of a bridged node, from the ZCB service
+ *  task; NULL for none */
+void vZCB_LivenessSetReachableHook(tpfZCB_LivenessReachable pfReachable);
+
+/** The device at u8Device of the device table was heard, from any task.
+ *  Only its last seen time is written, unless it was offline or not
+ *  tracked yet. */
+void vZCB_LivenessSeen(uint8_t u8Device);
+
+/** The device at u8Device leaves the device table */
+void vZCB_LivenessForget(uint8_t u8Device);
+
+/** Liveness clock, seconds since vZCB_LivenessInit() */
+uint32_t u32ZCB_LivenessNow(void);
+
+/** Called from the ZCB service task: sweeps the seconds gone by and hands
+ *  the Reachable changes to the hook */
+void vZCB_LivenessPoll(void);
+
+/** Static RAM of the wheel */
+uint32_t u32ZCB_LivenessRam(void);
+
+#if ZB_BRIDGE_TEST_COMMANDS
+/** Track MAX_ZD_DEVICE_NUMBERS synthetic nodes over simulated time, half
+ *  of them sleepy, some falling silent, and print what the sweep costs per
+ *  second against a scan of the device table. Only runs with no device in
+ *  the device table, which is left empty again. */
+void vZCB_LivenessMeasure(void);
+#endif
+
+/** Print the timeouts, the wheel and the counters */
+void vZCB_LivenessDump(void);
+
+void vZCB_LivenessGetStats(tsZCB_LivenessStats *psStats);
+
+#if defined __cplusplus
+}
+#endif
+
+#endif  /* ZCBLIVENESS_H */
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
@@ -0,0 +1,378 @@
+/*
+ * Copyright 2021-2023 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+#include "fsl_debug_console.h"
+
+#include <string.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "ZigbeeConstant.h"
+#include "SerialLink.h"
+#include "ZigbeeDevices.h"
+#include "ZcbNodeFlow.h"
+#include "ZcbMailbox.h"
+
+/*
+ * Store and forward for sleepy end devices.
+ *
+ * A sleepy node only listens for a short time after it has sent something,
+ * so configuration traffic (bind, configure reporting, read attribute) sent
+ * to it at any other time is lost. Such commands are held here as raw
+ * SerialLink messages and released one per service tick once the node is
+ * heard again. A command on the same endpoint, cluster and attribute as one
+ * already held, with the same message type, replaces its payload: only the
+ * newest configuration or write is worth sending.
+ *
+ * A held message is released with eSL_SendMessage and nothing waits for its
+ * answer, so only fire-and-forget commands are held. An async request which
+ * is held returns E_ZCB_DEFERRED to its caller and its callback never runs.
+ */
+
+/* Attribute ID of a key whose command has none */
+#define MAILBOX_NO_ATTRIBUTE    0xFFFF
+
+/* What a held command acts on */
+typedef struct
+{
+    uint16_t    u16MsgType;
+    uint16_t    u16ClusterId;
+    uint16_t    u16AttributeId;
+    uint8_t     u8Endpoint;
+} tsZCB_MailboxKey;
+
+typedef struct
+{
+    bool        bInUse;
+    uint16_t    u16NodeId;
+    uint16_t    u16MsgType;
+    uint16_t    u16Length;
+    uint32_t    u32Seq;
+    TickType_t  xExpiry;
+    uint8_t     au8Payload[ZCB_MAILBOX_MAX_PAYLOAD];
+} tsZCB_MailboxEntry;
+
+typedef struct
+{
+    uint16_t    u16NodeId;
+    TickType_t  xAwakeUntil;
+} tsZCB_MailboxWake;
+
+static tsZCB_MailboxEntry asMailbox[ZCB_MAILBOX_SIZE];
+static tsZCB_MailboxWake asWake[MAX_ZD_DEVICE_NUMBERS];
+static tsZCB_MailboxStats sStats;
+static SemaphoreHandle_t xMailboxMutex = NULL;
+static uint32_t u32NextSeq;
+
+
+static bool bMailboxNodeAwake(uint16_t u16ShortAddress, TickType_t xNow)
+{
+    uint8_t u8Index = uZDM_FindDevTableIndexByNodeId(u16ShortAddress);
+
+    if (u8Index >= MAX_ZD_DEVICE_NUMBERS) {
+        return false;
+    }
+    return (asWake[u8Index].u16NodeId == u16ShortAddress)
+           && ((int32_t)(xNow - asWake[u8Index].xAwakeUntil) < 0);
+}
+
+/* Read, write and configure reporting requests share the header of
+ * tsZDReadAttrReq, a read is keyed on its first attribute. Bind and unbind
+ * requests start with the IEEE address, endpoint and cluster of the node;
+ * see cmd.c for the layouts. */
+static bool bMailboxKey(uint16_t u16MsgType, uint16_t u16Length, const uint8_t *pu8Payload,
+                        tsZCB_MailboxKey *psKey)
+{
+    uint8_t u8Endpoint;
+    uint8_t u8Cluster;
+    uint8_t u8Attribute;
+
+    switch (u16MsgType)
+    {
+        case E_SL_MSG_READ_ATTRIBUTE_REQUEST:
+        case E_SL_MSG_WRITE_ATTRIBUTE_REQUEST:
+            u8Endpoint  = offsetof(tsZDReadAttrReq, u8DestinationEndPointId);
+            u8Cluster   = offsetof(tsZDReadAttrReq, u16ClusterId);
+            u8Attribute = offsetof(tsZDReadAttrReq, au16AttributeList);
+            break;
+
+        case E_SL_MSG_CONFIG_REPORTING_REQUEST:
+            /* Direction and data type come ahead of the attribute ID */
+            u8Endpoint  = offsetof(tsZDReadAttrReq, u8DestinationEndPointId);
+            u8Cluster   = offsetof(tsZDReadAttrReq, u16ClusterId);
+            u8Attribute = offsetof(tsZDReadAttrReq, au16AttributeList) + 2;
+            break;
+
+        case E_SL_MSG_BIND:
+        case E_SL_MSG_UNBIND:
+            u8Endpoint  = sizeof(uint64_t);
+            u8Cluster   = sizeof(uint64_t) + 1;
+            u8Attribute = 0;
+            break;
+
+        default:
+            return false;
+    }
+
+    if (u16Length < (((u8Attribute != 0) ? u8Attribute : u8Cluster) + sizeof(uint16_t))) {
+        return false;
+    }
+    psKey->u16MsgType = u16MsgType;
+    psKey->u8Endpoint = pu8Payload[u8Endpoint];
+    memcpy(&psKey->u16ClusterId, &pu8Payload[u8Cluster], sizeof(uint16_t));
+    psKey->u16AttributeId = MAILBOX_NO_ATTRIBUTE;
+    if (u8Attribute != 0) {
+        memcpy(&psKey->u16AttributeId, &pu8Payload[u8Attribute], sizeof(uint16_t));
+    }
+    return true;
+}
+
+/* Same message type on the same endpoint, cluster and attribute; a message
+ * without a key only merges with an identical one */
+static bool bMailboxSameCommand(const tsZCB_MailboxEntry *psEntry, uint16_t u16MsgType,
+                                uint16_t u16Length, const uint8_t *pu8Payload)
+{
+    tsZCB_MailboxKey sHeld;
+    tsZCB_MailboxKey sNew;
+
+    if (psEntry->u16MsgType != u16MsgType) {
+        return false;
+    }
+    if (bMailboxKey(u16MsgType, u16Length, pu8Payload, &sNew)
+        && bMailboxKey(psEntry->u16MsgType, psEntry->u16Length, psEntry->au8Payload, &sHeld)) {
+        return (sNew.u8Endpoint == sHeld.u8Endpoint)
+               && (sNew.u16ClusterId == sHeld.u16ClusterId)
+               && (sNew.u16AttributeId == sHeld.u16AttributeId);
+    }
+    return (psEntry->u16Length == u16Length) && (memcmp(psEntry->au8Payload, pu8Payload, u16Length) == 0);
+}
+
+static bool bMailboxInsert(const tsZCB_MailboxEntry *psEntry)
+{
+    for (uint8_t i = 0; i < ZCB_MAILBOX_SIZE; i++)
+    {
+        if (!asMailbox[i].bInUse) {
+            asMailbox[i] = *psEntry;
+            asMailbox[i].bInUse = true;
+            return true;
+        }
+    }
+    return false;
+}
+
+void vZCB_MailboxInit(void)
+{
+    memset(asMailbox, 0, sizeof(asMailbox));
+    memset(asWake, 0, sizeof(asWake));
+    memset(&sStats, 0, sizeof(sStats));
+    u32NextSeq = 0;
+
+    if (xMailboxMutex == NULL) {
+        xMailboxMutex = xSemaphoreCreateMutex();
+    }
+}
+
+bool bZCB_MailboxShouldHold(uint16_t u16ShortAddress)
+{
+    tsZbDeviceInfo *sDevice;
+    bool bHold;
+
+    if (xMailboxMutex == NULL) {
+        return false;
+    }
+
+    sDevice = tZDM_FindDeviceByNodeId(u16ShortAddress);
+    if ((sDevice == NULL) || !sDevice->bSleepy) {
+        return false;
+    }
+
+    xSemaphoreTake(xMailboxMutex, portMAX_DELAY);
+    bHold = !bMailboxNodeAwake(u16ShortAddress, xTaskGetTickCount());
+    xSemaphoreGive(xMailboxMutex);
+
+    return bHold;
+}
+
+teZcbStatus eZCB_MailboxPost(uint16_t u16ShortAddress,
+                             uint16_t u16MsgType,
+                             uint16_t u16Length,
+                             const void *pvMessage)
+{
+    tsZCB_MailboxEntry sEntry;
+    uint8_t u8NodeCount = 0;
+    TickType_t xNow;
+
+    if ((xMailboxMutex == NULL) || (u16Length > ZCB_MAILBOX_MAX_PAYLOAD)) {
+        return E_ZCB_ERROR;
+    }
+
+    xSemaphoreTake(xMailboxMutex, portMAX_DELAY);
+    xNow = xTaskGetTickCount();
+
+    for (uint8_t i = 0; i < ZCB_MAILBOX_SIZE; i++)
+    {
+        if (!asMailbox[i].bInUse || (asMailbox[i].u16NodeId != u16ShortAddress)) {
+            continue;
+        }
+        if (bMailboxSameCommand(&asMailbox[i], u16MsgType, u16Length, (const uint8_t *)pvMessage)) {
+            /* Same command already held: the newest payload is kept, in the
+             * place of the first in the release order */
+            memcpy(asMailbox[i].au8Payload, pvMessage, u16Length);
+            asMailbox[i].u16Length = u16Length;
+            asMailbox[i].xExpiry   = xNow + pdMS_TO_TICKS(ZCB_MAILBOX_TTL_MS);
+            sStats.u32Merged++;
+            xSemaphoreGive(xMailboxMutex);
+            return E_ZCB_DEFERRED;
+        }
+        u8NodeCount++;
+    }
+
+    if (u8NodeCount >= ZCB_MAILBOX_MAX_PER_NODE) {
+        sStats.u32Dropped++;
+        xSemaphoreGive(xMailboxMutex);
+        PRINTF("\n ### Mailbox of node 0x%x is full, command 0x%04x dropped\n", u16ShortAddress, u16MsgType);
+        return E_ZCB_ERROR_NO_MEM;
+    }
+
+    memset(&sEntry, 0, sizeof(sEntry));
+    sEntry.u16NodeId  = u16ShortAddress;
+    sEntry.u16MsgType = u16MsgType;
+    sEntry.u16Length  = u16Length;
+    sEntry.u32Seq     = u32NextSeq++;
+    sEntry.xExpiry    = xNow + pdMS_TO_TICKS(ZCB_MAILBOX_TTL_MS);
+    memcpy(sEntry.au8Payload, pvMessage, u16Length);
+
+    if (!bMailboxInsert(&sEntry)) {
+        sStats.u32Dropped++;
+        xSemaphoreGive(xMailboxMutex);
+        PRINTF("\n ### Mailbox is full, command 0x%04x to 0x%x dropped\n", u16MsgType, u16ShortAddress);
+        return E_ZCB_ERROR_NO_MEM;
+    }
+
+    sStats.u32Held++;
+    xSemaphoreGive(xMailboxMutex);
+    return E_ZCB_DEFERRED;
+}
+
+void vZCB_MailboxNodeHeard(uint16_t u16ShortAddress)
+{
+    uint8_t u8Index;
+
+    if (xMailboxMutex == NULL) {
+        return;
+    }
+
+    u8Index = uZDM_FindDevTableIndexByNodeId(u16ShortAddress);
+    if (u8Index >= MAX_ZD_DEVICE_NUMBERS) {
+        return;
+    }
+
+    xSemaphoreTake(xMailboxMutex, portMAX_DELAY);
+    asWake[u8Index].u16NodeId   = u16ShortAddress;
+    asWake[u8Index].xAwakeUntil = xTaskGetTickCount() + pdMS_TO_TICKS(ZCB_MAILBOX_AWAKE_WINDOW_MS);
+    xSemaphoreGive(xMailboxMutex);
+}
+
+void vZCB_MailboxForget(uint16_t u16ShortAddress)
+{
+    if (xMailboxMutex == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(xMailboxMutex, portMAX_DELAY);
+    for (uint8_t i = 0; i < ZCB_MAILBOX_SIZE; i++)
+    {
+        if (asMailbox[i].bInUse && (asMailbox[i].u16NodeId == u16ShortAddress)) {
+            asMailbox[i].bInUse = false;
+        }
+    }
+    xSemaphoreGive(xMailboxMutex);
+}
+
+void vZCB_MailboxPoll(void)
+{
+    tsZCB_MailboxEntry sRelease;
+    tsZCB_MailboxEntry *psOldest = NULL;
+    uint8_t u8Expired = 0;
+    TickType_t xNow;
+
+    if (xMailboxMutex == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(xMailboxMutex, portMAX_DELAY);
+    xNow = xTaskGetTickCount();
+
+    for (uint8_t i = 0; i < ZCB_MAILBOX_SIZE; i++)
+    {
+        if (!asMailbox[i].bInUse) {
+            continue;
+        }
+        if ((int32_t)(xNow - asMailbox[i].xExpiry) >= 0) {
+            asMailbox[i].bInUse = false;
+            u8Expired++;
+            continue;
+        }
+        /* Oldest command for an awake node goes first */
+        if (bMailboxNodeAwake(asMailbox[i].u16NodeId, xNow)
+            && ((psOldest == NULL) || ((int32_t)(asMailbox[i].u32Seq - psOldest->u32Seq) < 0))) {
+            psOldest = &asMailbox[i];
+        }
+    }
+    sStats.u32Expired += u8Expired;
+
+    if (psOldest != NULL) {
+        sRelease = *psOldest;
+        psOldest->bInUse = false;
+    }
+    xSemaphoreGive(xMailboxMutex);
+
+    if (u8Expired) {
+        PRINTF("\n ### %d held command(s) expired before the node woke up\n", u8Expired);
+    }
+
+    if (psOldest == NULL) {
+        return;
+    }
+
+    /* Send outside the lock, eSL_SendMessage blocks for the status */
+    if (eZCB_NodeFlowAcquire(sRelease.u16NodeId) != E_ZCB_OK) {
+        xSemaphoreTake(xMailboxMutex, portMAX_DELAY);
+        if (!bMailboxInsert(&sRelease)) {
+            sStats.u32Dropped++;
+        }
+        xSemaphoreGive(xMailboxMutex);
+        return;
+    }
+
+    if (eSL_SendMessage(sRelease.u16MsgType, sRelease.u16Length, sRelease.au8Payload, NULL) != E_SL_OK) {
+        vZCB_NodeFlowRelease(sRelease.u16NodeId);
+        PRINTF("\n ### Sending held command 0x%04x to 0x%x failed\n", sRelease.u16MsgType, sRelease.u16NodeId);
+        return;
+    }
+    sStats.u32Released++;
+}
+
+void vZCB_MailboxGetStats(tsZCB_MailboxStats *psStats)
+{
+    if (psStats != NULL) {
+        *psStats = sStats;
+    }
+}
+
+uint32_t u32ZCB_MailboxNodeRam(void)
+{
+    return sizeof(asWake);
+}
+
+// ------------------------------------------------------------------
+// END OF FILE
+// ------------------------------------------------------------------
@@ -0,0 +1,95 @@
+/*
+ * Copyright 2021-2023 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef ZCBMAILBOX_H
+#define ZCBMAILBOX_H
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+/****************************************************************************/
+/***        Include files                                                 ***/
+/****************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "zcb.h"
+
+/****************************************************************************/
+/***        Macro Definitions                                             ***/
+/****************************************************************************/
+
+/* Commands held for all sleepy nodes together */
+#define ZCB_MAILBOX_SIZE                        16
+/* Commands held for one sleepy node */
+#define ZCB_MAILBOX_MAX_PER_NODE                6
+/* Largest SerialLink payload which can be held */
+#define ZCB_MAILBOX_MAX_PAYLOAD                 48
+/* A held command is dropped if the node is not heard within this time */
+#define ZCB_MAILBOX_TTL_MS                      (15 * 60 * 1000)
+/* A sleepy node is taken as awake for this time after it is heard */
+#define ZCB_MAILBOX_AWAKE_WINDOW_MS             3000
+
+
+/****************************************************************************/
+/***        Type Definitions                                              ***/
+/****************************************************************************/
+
+typedef struct
+{
+    uint32_t u32Held;             /**< Commands held for a sleepy node */
+    uint32_t u32Merged;           /**< Commands which replaced one already held */
+    uint32_t u32Released;         /**< Held commands sent on wake up */
+    uint32_t u32Expired;          /**< Held commands dropped on TTL */
+    uint32_t u32Dropped;          /**< Commands not held, mailbox full */
+} tsZCB_MailboxStats;
+
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+
+void vZCB_MailboxInit(void);
+
+/** True when the node is a sleepy end device which is not awake now */
+bool bZCB_MailboxShouldHold(uint16_t u16ShortAddress);
+
+/** Hold a SerialLink message until the node is next heard. A held message
+ *  of the same type on the same endpoint, cluster and attribute takes the
+ *  new payload. Only fire-and-forget commands may be held: nothing is told
+ *  of the answer once the message is released.
+ *  Returns E_ZCB_DEFERRED when held, E_ZCB_ERROR_NO_MEM when full. */
+teZcbStatus eZCB_MailboxPost(uint16_t u16ShortAddress,
+                             uint16_t u16MsgType,
+                             uint16_t u16Length,
+                             const void *pvMessage);
+
+/** Any frame received from the node, held commands are released */
+void vZCB_MailboxNodeHeard(uint16_t u16ShortAddress);
+
+/** Drop everything held for a node which has left */
+void vZCB_MailboxForget(uint16_t u16ShortAddress);
+
+/** Release and expire held commands, called from the ZCB service task */
+void vZCB_MailboxPoll(void);
+
+void vZCB_MailboxGetStats(tsZCB_MailboxStats *psStats);
+
+/** Static RAM of the per node state, the held commands left out */
+uint32_t u32ZCB_MailboxNodeRam(void);
+
+#if defined __cplusplus
+}
+#endif
+
+#endif  /* ZCBMAILBOX_H */
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
@@ -17,16 +17,41 @@ typedef enum {
     BRIDGE_ADD_DEV,
     BRIDGE_REMOVE_DEV,
     BRIDGE_FACTORY_RESET,
-    BRIDGE_WRITE_ATTRIBUTE,
 	BRIDGE_RESTORE_JOINED_NODE,
+    BRIDGE_WRITE_ATTRIBUTES,
+    BRIDGE_WRITE_ATTRIBUTE_WAVE,
 } msgType;
 
+/* Attributes of one report frame delivered to the bridge together */
+#define ZCB_ATTRIBUTE_BATCH_MAX     8
+
+/* Matter cluster and attribute, value already in Matter units, and the
+ * bridge setter which writes it (teZCB_MatterWrite of its map row) */
 typedef struct {
-    uint16_t u16ClusterID;
-    uint16_t u16AttributeID;
+    uint32_t u32ClusterID;
+    uint32_t u32AttributeID;
     uint64_t u64Data;
+    uint8_t  u8Write;
 } ZcbAttribute_t;
 
+typedef struct {
+    uint8_t u8Count;
+    ZcbAttribute_t asAttributes[ZCB_ATTRIBUTE_BATCH_MAX];
+} ZcbAttributeBatch_t;
+
+/* Attributes of many nodes delivered to the bridge together after a resync */
+#define ZCB_ATTRIBUTE_WAVE_MAX      128
+
+typedef struct {
+    uint16_t u16DynamicEp;
+    ZcbAttribute_t sAttribute;
+} ZcbWaveAttribute_t;
+
+typedef struct _ZcbAttributeWave {
+    uint16_t u16Count;
+    ZcbWaveAttribute_t asEntries[ZCB_ATTRIBUTE_WAVE_MAX];
+} ZcbAttributeWave_t;
+
 typedef struct {
     bool AnnounceStart;
     bool HandleMask;
@@ -34,10 +59,31 @@ typedef struct {
     int msg_type;
     newdb_zcb_t zcb;
     void *msg_data;
+    ZcbAttributeBatch_t attr_batch;
 } ZcbMsg_t;
 
 extern ZcbMsg_t ZcbMsg;
 
+/* Hand a message to the bridge, replacing the one not yet taken */
+void eZCB_SendMsg(int MsgType, newdb_zcb_t *Zcb, void* data);
+
+/* Hand a message to the bridge if it has taken the last one, E_ZCB_DEFERRED otherwise.
+ * For the service task, which does not wait for the bridge. */
+teZcbStatus eZCB_PostMsg(int MsgType, newdb_zcb_t *Zcb, void* data);
+
+/* Hand the attributes of one report to the bridge, merged with a pending batch of the node.
+ * The node is named by its short address and dynamic endpoint, saddr and DynamicEP. */
+void eZCB_SendAttributeBatch(newdb_zcb_t *Zcb, const ZcbAttributeBatch_t *psBatch);
+
+/* Hand a wave to the bridge, E_ZCB_DEFERRED while the bridge is busy with another message.
+ * The wave is passed by reference and must be left alone while still pending. */
+teZcbStatus eZCB_SendAttributeWave(ZcbAttributeWave_t *psWave);
+bool bZCB_AttributeWavePending(const ZcbAttributeWave_t *psWave);
+
+/* Bridged attributes of a read attribute response, still in network byte order,
+ * which changed since last forwarded */
+uint8_t u8ZCB_ReadResponseDeltas(uint16_t u16Length, const void *pvMessage, ZcbAttributeBatch_t *psBatch);
+
 #if defined __cplusplus
 }
 #endif
@@ -0,0 +1,262 @@
+/*
+ * Copyright 2021-2023 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+#include "fsl_debug_console.h"
+
+#include <string.h>
+#include <stdbool.h>
+
+#include "ZigbeeConstant.h"
+#include "ZigbeeDevices.h"
+#include "ZcbNodeFlow.h"
+
+/*
+ * Per node congestion control for unicast commands.
+ *
+ * Each node has a small window of in-flight slots. A slot is taken before a
+ * command is handed to the coordinator and given back when the node answers
+ * (attribute report, read response, bind response) or when the hold time
+ * runs out, so nodes which never answer are only paced, not penalised.
+ * Missed answers back the node off exponentially with jitter. A command the
+ * coordinator did not take never reached the node: its slot is given back
+ * without counting against the node, a serial link fault is not the node's. A node marked offline by the device timer is parked: only one
+ * probe command per probe interval is let through until it is heard again.
+ */
+
+typedef struct
+{
+    uint16_t    u16NodeId;
+    uint8_t     u8InFlight;
+    uint8_t     u8FailCount;
+    TickType_t  axSlotExpiry[ZCB_NODE_FLOW_WINDOW];   /* oldest first */
+    TickType_t  xBackoffUntil;
+    TickType_t  xNextProbe;
+} tsZCB_NodeFlow;
+
+static tsZCB_NodeFlow asNodeFlow[MAX_ZD_DEVICE_NUMBERS];
+static tsZCB_NodeFlowStats sStats;
+static SemaphoreHandle_t xNodeFlowMutex = NULL;
+static uint32_t u32JitterSeed;
+
+
+static tsZCB_NodeFlow *psNodeFlowFind(uint16_t u16ShortAddress, uint8_t *pu8Index)
+{
+    uint8_t u8Index = uZDM_FindDevTableIndexByNodeId(u16ShortAddress);
+
+    if (u8Index >= MAX_ZD_DEVICE_NUMBERS) {
+        return NULL;
+    }
+
+    /* The device table slot has been reused by another node */
+    if (asNodeFlow[u8Index].u16NodeId != u16ShortAddress) {
+        memset(&asNodeFlow[u8Index], 0, sizeof(tsZCB_NodeFlow));
+        asNodeFlow[u8Index].u16NodeId     = u16ShortAddress;
+        asNodeFlow[u8Index].xBackoffUntil = xTaskGetTickCount();
+        asNodeFlow[u8Index].xNextProbe    = xTaskGetTickCount();
+    }
+
+    if (pu8Index != NULL) {
+        *pu8Index = u8Index;
+    }
+    return &asNodeFlow[u8Index];
+}
+
+static void vNodeFlowReleaseSlot(tsZCB_NodeFlow *psFlow)
+{
+    if (psFlow->u8InFlight == 0) {
+        return;
+    }
+    psFlow->u8InFlight--;
+    memmove(&psFlow->axSlotExpiry[0], &psFlow->axSlotExpiry[1],
+            psFlow->u8InFlight * sizeof(TickType_t));
+}
+
+static void vNodeFlowExpireSlots(tsZCB_NodeFlow *psFlow, TickType_t xNow)
+{
+    while ((psFlow->u8InFlight > 0) && ((int32_t)(xNow - psFlow->axSlotExpiry[0]) >= 0)) {
+        vNodeFlowReleaseSlot(psFlow);
+    }
+}
+
+static void vNodeFlowBackoff(tsZCB_NodeFlow *psFlow, TickType_t xNow)
+{
+    uint32_t u32DelayMs;
+
+    if (psFlow->u8FailCount < 0xFF) {
+        psFlow->u8FailCount++;
+    }
+
+    u32DelayMs = ZCB_NODE_FLOW_BACKOFF_BASE_MS;
+    for (uint8_t i = 1; (i < psFlow->u8FailCount) && (u32DelayMs < ZCB_NODE_FLOW_BACKOFF_MAX_MS); i++) {
+        u32DelayMs <<= 1;
+    }
+    if (u32DelayMs > ZCB_NODE_FLOW_BACKOFF_MAX_MS) {
+        u32DelayMs = ZCB_NODE_FLOW_BACKOFF_MAX_MS;
+    }
+
+    /* Up to half the delay again, so nodes failing together do not retry together */
+    u32JitterSeed = u32JitterSeed * 1664525 + 1013904223;
+    u32DelayMs += (u32JitterSeed >> 16) % (u32DelayMs / 2 + 1);
+
+    psFlow->xBackoffUntil = xNow + pdMS_TO_TICKS(u32DelayMs);
+    sStats.u32Failures++;
+}
+
+void vZCB_NodeFlowInit(void)
+{
+    memset(asNodeFlow, 0, sizeof(asNodeFlow));
+    memset(&sStats, 0, sizeof(sStats));
+    u32JitterSeed = (uint32_t)xTaskGetTickCount() ^ 0x5A5A5A5A;
+
+    if (xNodeFlowMutex == NULL) {
+        xNodeFlowMutex = xSemaphoreCreateMutex();
+    }
+}
+
+teZcbStatus eZCB_NodeFlowAcquire(uint16_t u16ShortAddress)
+{
+    tsZCB_NodeFlow *psFlow;
+    tsZbDeviceInfo *sDevice;
+    TickType_t xNow;
+    uint8_t u8Index;
+
+    if (xNodeFlowMutex == NULL) {
+        return E_ZCB_OK;
+    }
+
+    xSemaphoreTake(xNodeFlowMutex, portMAX_DELAY);
+
+    /* Nodes not in the device table are not controlled */
+    psFlow = psNodeFlowFind(u16ShortAddress, &u8Index);
+    if (psFlow == NULL) {
+        xSemaphoreGive(xNodeFlowMutex);
+        return E_ZCB_OK;
+    }
+
+    xNow = xTaskGetTickCount();
+    vNodeFlowExpireSlots(psFlow, xNow);
+
+    sDevice = tZDM_FindDeviceByIndex(u8Index);
+    if ((sDevice != NULL) && (sDevice->eDeviceState == E_ZB_DEVICE_STATE_OFF_LINE)) {
+        if ((int32_t)(xNow - psFlow->xNextProbe) < 0) {
+            sStats.u32RejectedOffline++;
+            xSemaphoreGive(xNodeFlowMutex);
+            PRINTF("\n ### Node 0x%x is offline, command not sent\n", u16ShortAddress);
+            return E_ZCB_REQUEST_NOT_ACTIONED;
+        }
+        psFlow->xNextProbe = xNow + pdMS_TO_TICKS(ZCB_NODE_FLOW_PROBE_INTERVAL_MS);
+        sStats.u32Probes++;
+    } else if ((int32_t)(xNow - psFlow->xBackoffUntil) < 0) {
+        sStats.u32RejectedBackoff++;
+        xSemaphoreGive(xNodeFlowMutex);
+        PRINTF("\n ### Node 0x%x is backing off, command not sent\n", u16ShortAddress);
+        return E_ZCB_REQUEST_NOT_ACTIONED;
+    }
+
+    if (psFlow->u8InFlight >= ZCB_NODE_FLOW_WINDOW) {
+        sStats.u32RejectedWindow++;
+        xSemaphoreGive(xNodeFlowMutex);
+        PRINTF("\n ### Node 0x%x has %d commands in flight, command not sent\n",
+               u16ShortAddress, ZCB_NODE_FLOW_WINDOW);
+        return E_ZCB_REQUEST_NOT_ACTIONED;
+    }
+
+    psFlow->axSlotExpiry[psFlow->u8InFlight++] = xNow + pdMS_TO_TICKS(ZCB_NODE_FLOW_SLOT_HOLD_MS);
+    sStats.u32Admitted++;
+
+    xSemaphoreGive(xNodeFlowMutex);
+    return E_ZCB_OK;
+}
+
+void vZCB_NodeFlowComplete(uint16_t u16ShortAddress, bool bSuccess)
+{
+    tsZCB_NodeFlow *psFlow;
+    TickType_t xNow;
+
+    if (xNodeFlowMutex == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(xNodeFlowMutex, portMAX_DELAY);
+    psFlow = psNodeFlowFind(u16ShortAddress, NULL);
+    if (psFlow != NULL) {
+        xNow = xTaskGetTickCount();
+        vNodeFlowReleaseSlot(psFlow);
+        if (bSuccess) {
+            psFlow->u8FailCount   = 0;
+            psFlow->xBackoffUntil = xNow;
+            psFlow->xNextProbe    = xNow;
+        } else {
+            vNodeFlowBackoff(psFlow, xNow);
+        }
+    }
+    xSemaphoreGive(xNodeFlowMutex);
+}
+
+void vZCB_NodeFlowRelease(uint16_t u16ShortAddress)
+{
+    tsZCB_NodeFlow *psFlow;
+
+    if (xNodeFlowMutex == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(xNodeFlowMutex, portMAX_DELAY);
+    psFlow = psNodeFlowFind(u16ShortAddress, NULL);
+    if (psFlow != NULL) {
+        vNodeFlowReleaseSlot(psFlow);
+    }
+    xSemaphoreGive(xNodeFlowMutex);
+}
+
+void vZCB_NodeFlowTimeout(uint16_t u16ShortAddress)
+{
+    tsZCB_NodeFlow *psFlow;
+
+    if (xNodeFlowMutex == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(xNodeFlowMutex, portMAX_DELAY);
+    psFlow = psNodeFlowFind(u16ShortAddress, NULL);
+    if (psFlow != NULL) {
+        vNodeFlowBackoff(psFlow, xTaskGetTickCount());
+    }
+    xSemaphoreGive(xNodeFlowMutex);
+}
+
+void vZCB_NodeFlowResetAll(void)
+{
+    if (xNodeFlowMutex == NULL) {
+        return;
+    }
+
+    /* Commands in flight were lost with the coordinator, start clean */
+    xSemaphoreTake(xNodeFlowMutex, portMAX_DELAY);
+    memset(asNodeFlow, 0, sizeof(asNodeFlow));
+    xSemaphoreGive(xNodeFlowMutex);
+}
+
+void vZCB_NodeFlowGetStats(tsZCB_NodeFlowStats *psStats)
+{
+    if (psStats != NULL) {
+        *psStats = sStats;
+    }
+}
+
+uint32_t u32ZCB_NodeFlowRam(void)
+{
+    return sizeof(asNodeFlow);
+}
+
+// ------------------------------------------------------------------
+// END OF FILE
+// ------------------------------------------------------------------
@@ -0,0 +1,91 @@
+/*
+ * Copyright 2021-2023 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef ZCBNODEFLOW_H
+#define ZCBNODEFLOW_H
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+/****************************************************************************/
+/***        Include files                                                 ***/
+/****************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "zcb.h"
+
+/****************************************************************************/
+/***        Macro Definitions                                             ***/
+/****************************************************************************/
+
+/* Commands allowed outstanding towards one node */
+#define ZCB_NODE_FLOW_WINDOW                    3
+/* A slot is given back when the node answers, or after this time */
+#define ZCB_NODE_FLOW_SLOT_HOLD_MS              500
+/* Backoff after the first failure, doubled on each further failure */
+#define ZCB_NODE_FLOW_BACKOFF_BASE_MS           250
+#define ZCB_NODE_FLOW_BACKOFF_MAX_MS            8000
+/* Interval between probe commands let through to an offline node */
+#define ZCB_NODE_FLOW_PROBE_INTERVAL_MS         30000
+
+
+/****************************************************************************/
+/***        Type Definitions                                              ***/
+/****************************************************************************/
+
+typedef struct
+{
+    uint32_t u32Admitted;         /**< Commands let through */
+    uint32_t u32RejectedWindow;   /**< Rejected, window full */
+    uint32_t u32RejectedBackoff;  /**< Rejected, node backing off */
+    uint32_t u32RejectedOffline;  /**< Rejected, node offline */
+    uint32_t u32Probes;           /**< Commands let through to an offline node */
+    uint32_t u32Failures;         /**< Failures reported */
+} tsZCB_NodeFlowStats;
+
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+
+void vZCB_NodeFlowInit(void);
+
+/** Take an in-flight slot before sending a unicast command to the node.
+ *  Returns E_ZCB_REQUEST_NOT_ACTIONED if the command must not be sent. */
+teZcbStatus eZCB_NodeFlowAcquire(uint16_t u16ShortAddress);
+
+/** Give back a slot. bSuccess is true when the node answered, false when
+ *  the answer timed out or the node reported a failure. */
+void vZCB_NodeFlowComplete(uint16_t u16ShortAddress, bool bSuccess);
+
+/** Give back a slot of a command the coordinator did not take, the node
+ *  is not charged with it */
+void vZCB_NodeFlowRelease(uint16_t u16ShortAddress);
+
+/** Report a failure detected after the slot was given back */
+void vZCB_NodeFlowTimeout(uint16_t u16ShortAddress);
+
+/** Forget all in-flight slots and backoffs, the coordinator restarted */
+void vZCB_NodeFlowResetAll(void);
+
+void vZCB_NodeFlowGetStats(tsZCB_NodeFlowStats *psStats);
+
+/** Static RAM of the per node state, one entry per device table entry */
+uint32_t u32ZCB_NodeFlowRam(void);
+
+#if defined __cplusplus
+}
+#endif
+
+#endif  /* ZCBNODEFLOW_H */
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
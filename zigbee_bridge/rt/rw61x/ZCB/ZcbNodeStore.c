@@ -0,0 +1,1121 @@
+/*
+ * Copyright 2021-2023 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+#include "fsl_debug_console.h"
+
+#include <stddef.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "ZigbeeConstant.h"
+#include "zcb.h"
+#include "ZcbNodeStore.h"
+
+#include "ram_storage.h"
+
+/*
+ * Journal of the joined node table.
+ *
+ * The joined nodes were saved as one blob, read back and written whole for
+ * each join, leave or endpoint change: a sector erase per change. They are
+ * now kept as a log of fixed size records, one per change of an entry of
+ * the table, appended to the sector being written. Each record has the
+ * entry it is for, a sequence number and a CRC; a sector starts with a
+ * header record carrying the sequence number it was opened with, which
+ * orders the sectors.
+ *
+ * Changes are marked from any task and written by the ZCB service task
+ * ZCB_NODE_STORE_COMMIT_MS after the first of them, all the changes then in
+ * one program of the sector: an interview storing a node and its endpoint
+ * costs one write. The entry is read from the table when it is written, the
+ * table is what the journal keeps.
+ *
+ * At start the sectors are replayed in order, the last record of an entry
+ * wins. A record cut short by a power loss fails its CRC: the replay of
+ * its sector stops there and the sector is not written again, the entry
+ * keeps its value of before. A sector with no valid header, one whose
+ * opening or erase was cut, is erased before it is used.
+ *
+ * Compaction keeps ZCB_NODE_STORE_SPARE_SECTORS sectors erased. It takes
+ * the sector with the most records overwritten since, copies the last
+ * record of each entry it still holds to the sector being written, spoils
+ * its header and erases it. A removal is only copied while an older record
+ * of the entry is left in another sector. Nothing is read from the table
+ * for it, a copy is the record as written.
+ *
+ * The flash is given as read, program and erase of a sector. By default
+ * each sector is a ram_storage record, the bridge has no flash of its own
+ * for the journal; a region of the QSPI flash is given to it with
+ * vZCB_NodeStoreSetFlash().
+ */
+
+#define STORE_RECORD_MAGIC      0x4E52      /* "NR" */
+#define STORE_HEADER_MAGIC      0x4E53      /* "NS" */
+#define STORE_HEADER_VERSION    1
+
+#define STORE_OP_PUT            1
+#define STORE_OP_REMOVE         2
+
+#define STORE_SLOT_BYTES        ((ZB_BRIDGE_MAX_NODES + 7) / 8)
+#define STORE_NONE              0xFF
+
+/* The blob of before, taken over when the journal is empty */
+#define STORE_LEGACY_FILE       "ZBNodes"
+
+typedef enum
+{
+    E_STORE_SECTOR_BLANK,       /* erased */
+    E_STORE_SECTOR_USED,        /* has a valid header */
+    E_STORE_SECTOR_DIRTY,       /* neither, erased before it is used */
+} teStoreSector;
+
+/* A header has u8Op STORE_HEADER_VERSION and no node */
+typedef struct
+{
+    uint16_t    u16Magic;
+    uint8_t     u8Op;
+    uint8_t     u8Slot;
+    uint32_t    u32Seq;
+    uint64_t    u64Mac;
+    uint16_t    u16ShortAddr;
+    uint16_t    u16Ep;
+    uint8_t     u8Type;
+    uint8_t     au8Spare[7];
+    uint32_t    u32Crc;
+} tsStoreRecord;
+
+typedef char acStoreRecordSize[(sizeof(tsStoreRecord) == ZCB_NODE_STORE_RECORD_SIZE) ? 1 : -1];
+
+typedef struct
+{
+    const tsZCB_NodeStoreFlash *psFlash;
+    NodeDB      *pasNodes;
+    uint8_t     u8Slots;
+    uint32_t    u32Seq;                                         /* last sequence number written */
+    uint8_t     u8Head;                                         /* sector written to, STORE_NONE for none */
+    uint8_t     u8HeadNext;                                     /* its next record, past the end once closed */
+    uint8_t     au8State[ZCB_NODE_STORE_SECTORS];               /* teStoreSector */
+    uint32_t    au32SectorSeq[ZCB_NODE_STORE_SECTORS];
+    uint8_t     au8Written[ZCB_NODE_STORE_SECTORS];             /* records taken up in the sector */
+    uint8_t     au8Live[ZCB_NODE_STORE_SECTORS];                /* ... which are the last of their entry */
+    uint8_t     aau8Holds[ZCB_NODE_STORE_SECTORS][STORE_SLOT_BYTES];    /* entries with a record in it */
+    uint8_t     au8Latest[ZB_BRIDGE_MAX_NODES];                 /* sector of the last record of the entry */
+    uint8_t     au8Dirty[STORE_SLOT_BYTES];
+    uint16_t    u16Dirty;
+    TickType_t  xDirtySince;
+    tsStoreRecord asBuffer[ZCB_NODE_STORE_SECTOR_RECORDS + 1];  /* a sector, or a batch to write */
+    tsZCB_NodeStoreStats sStats;
+} tsNodeStore;
+
+static tsNodeStore sStore;
+static SemaphoreHandle_t xStoreMutex = NULL;
+
+/* Default flash, a ram_storage record per sector and the last one used kept */
+static uint8_t au8FileSector[ZCB_NODE_STORE_SECTOR_SIZE];
+static uint8_t u8FileCached = STORE_NONE;
+
+static bool bStoreFileRead(uint8_t u8Sector, uint16_t u16Offset, void *pvData, uint16_t u16Length);
+static bool bStoreFileProgram(uint8_t u8Sector, uint16_t u16Offset, const void *pvData, uint16_t u16Length);
+static bool bStoreFileErase(uint8_t u8Sector);
+
+static const tsZCB_NodeStoreFlash sFileFlash =
+{
+    bStoreFileRead, bStoreFileProgram, bStoreFileErase
+};
+
+static const tsZCB_NodeStoreFlash *psStoreFlash = &sFileFlash;
+
+/* Flash of the measure, in RAM: a program only clears bits. Past the
+ * operation the power is cut at, that one is done half and the others
+ * fail. */
+typedef struct
+{
+    uint8_t     *pu8Flash;
+    uint32_t    u32Ops;
+    uint32_t    u32CutAt;       /* 0 for no cut */
+    uint32_t    u32Bytes;       /* programmed */
+    bool        bCut;
+} tsStoreSim;
+
+static tsStoreSim sSim;
+
+static bool bStoreSimRead(uint8_t u8Sector, uint16_t u16Offset, void *pvData, uint16_t u16Length);
+static bool bStoreSimProgram(uint8_t u8Sector, uint16_t u16Offset, const void *pvData, uint16_t u16Length);
+static bool bStoreSimErase(uint8_t u8Sector);
+
+static const tsZCB_NodeStoreFlash sSimFlash =
+{
+    bStoreSimRead, bStoreSimProgram, bStoreSimErase
+};
+
+
+static bool bStoreBit(const uint8_t *pu8Bits, uint8_t i)
+{
+    return (pu8Bits[i / 8] & (1 << (i % 8))) != 0;
+}
+
+static void vStoreBitSet(uint8_t *pu8Bits, uint8_t i)
+{
+    pu8Bits[i / 8] |= (uint8_t)(1 << (i % 8));
+}
+
+static void vStoreBitClear(uint8_t *pu8Bits, uint8_t i)
+{
+    pu8Bits[i / 8] &= (uint8_t)~(1 << (i % 8));
+}
+
+static bool bStoreNodeEmpty(const NodeDB *psNode)
+{
+    return (psNode->type == 0) && (psNode->ep == 0) && (psNode->shortaddr == 0) && (psNode->mac == 0);
+}
+
+static bool bStoreNodeSame(const NodeDB *psNode, const NodeDB *psOther)
+{
+    return (psNode->type == psOther->type) && (psNode->ep == psOther->ep)
+           && (psNode->shortaddr == psOther->shortaddr) && (psNode->mac == psOther->mac);
+}
+
+/* CRC-32 of a record up to its CRC */
+static uint32_t u32StoreCrc(const tsStoreRecord *psRecord)
+{
+    const uint8_t *pu8Data = (const uint8_t *)psRecord;
+    uint32_t u32Crc = 0xFFFFFFFF;
+
+    for (uint8_t i = 0; i < offsetof(tsStoreRecord, u32Crc); i++)
+    {
+        u32Crc ^= pu8Data[i];
+        for (uint8_t b = 0; b < 8; b++)
+        {
+            u32Crc = (u32Crc >> 1) ^ (0xEDB88320 & (0 - (u32Crc & 1)));
+        }
+    }
+    return ~u32Crc;
+}
+
+static bool bStoreBlank(const tsStoreRecord *psRecord)
+{
+    const uint8_t *pu8Data = (const uint8_t *)psRecord;
+
+    for (uint8_t i = 0; i < sizeof(*psRecord); i++)
+    {
+        if (pu8Data[i] != 0xFF) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool bStoreRecordValid(const tsStoreRecord *psRecord)
+{
+    return (psRecord->u16Magic == STORE_RECORD_MAGIC)
+           && ((psRecord->u8Op == STORE_OP_PUT) || (psRecord->u8Op == STORE_OP_REMOVE))
+           && (psRecord->u32Crc == u32StoreCrc(psRecord));
+}
+
+static bool bStoreHeaderValid(const tsStoreRecord *psRecord)
+{
+    return (psRecord->u16Magic == STORE_HEADER_MAGIC) && (psRecord->u8Op == STORE_HEADER_VERSION)
+           && (psRecord->u32Crc == u32StoreCrc(psRecord));
+}
+
+/* The flash operations, counted */
+static bool bStoreRead(tsNodeStore *psStore, uint8_t u8Sector, uint16_t u16Offset, void *pvData, uint16_t u16Length)
+{
+    psStore->sStats.u32Reads++;
+    if (!psStore->psFlash->pfRead(u8Sector, u16Offset, pvData, u16Length)) {
+        psStore->sStats.u32Failed++;
+        return false;
+    }
+    return true;
+}
+
+static bool bStoreProgram(tsNodeStore *psStore, uint8_t u8Sector, uint16_t u16Offset, const void *pvData,
+                          uint16_t u16Length)
+{
+    psStore->sStats.u32Programs++;
+    if (!psStore->psFlash->pfProgram(u8Sector, u16Offset, pvData, u16Length)) {
+        psStore->sStats.u32Failed++;
+        return false;
+    }
+    return true;
+}
+
+static bool bStoreErase(tsNodeStore *psStore, uint8_t u8Sector)
+{
+    psStore->sStats.u32Erases++;
+    if (!psStore->psFlash->pfErase(u8Sector)) {
+        psStore->sStats.u32Failed++;
+        return false;
+    }
+    return true;
+}
+
+static uint8_t u8StoreFree(const tsNodeStore *psStore)
+{
+    uint8_t u8Free = 0;
+
+    for (uint8_t s = 0; s < ZCB_NODE_STORE_SECTORS; s++)
+    {
+        if (psStore->au8State[s] != E_STORE_SECTOR_USED) {
+            u8Free++;
+        }
+    }
+    return u8Free;
+}
+
+static uint8_t u8StoreRoom(const tsNodeStore *psStore)
+{
+    if ((psStore->u8Head == STORE_NONE) || (psStore->u8HeadNext > ZCB_NODE_STORE_SECTOR_RECORDS)) {
+        return 0;
+    }
+    return (uint8_t)(ZCB_NODE_STORE_SECTOR_RECORDS + 1 - psStore->u8HeadNext);
+}
+
+/* The last record of the entry is now in u8Sector, STORE_NONE for none */
+static void vStoreLatest(tsNodeStore *psStore, uint8_t u8Slot, uint8_t u8Sector)
+{
+    if (psStore->au8Latest[u8Slot] != STORE_NONE) {
+        psStore->au8Live[psStore->au8Latest[u8Slot]]--;
+    }
+    psStore->au8Latest[u8Slot] = u8Sector;
+    if (u8Sector != STORE_NONE) {
+        psStore->au8Live[u8Sector]++;
+    }
+}
+
+/* True when a sector in use other than u8Sector has a record of the entry */
+static bool bStoreHeldElsewhere(const tsNodeStore *psStore, uint8_t u8Slot, uint8_t u8Sector)
+{
+    for (uint8_t s = 0; s < ZCB_NODE_STORE_SECTORS; s++)
+    {
+        if ((s != u8Sector) && (psStore->au8State[s] == E_STORE_SECTOR_USED)
+            && bStoreBit(psStore->aau8Holds[s], u8Slot)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Records of a sector are taken up to the first blank or damaged one, a
+ * damaged record being a write cut short; returns the first not taken */
+static uint8_t u8StoreScan(const tsStoreRecord *pasSector, uint32_t u32Seq, bool *pbTorn)
+{
+    uint8_t r;
+
+    *pbTorn = false;
+    for (r = 1; r <= ZCB_NODE_STORE_SECTOR_RECORDS; r++)
+    {
+        if (bStoreBlank(&pasSector[r])) {
+            break;
+        }
+        if (!bStoreRecordValid(&pasSector[r]) || ((int32_t)(pasSector[r].u32Seq - u32Seq) <= 0)) {
+            *pbTorn = true;
+            break;
+        }
+        u32Seq = pasSector[r].u32Seq;
+    }
+    return r;
+}
+
+static bool bStoreOpen(tsNodeStore *psStore)
+{
+    tsStoreRecord sHeader;
+    uint8_t u8Sector = STORE_NONE;
+
+    for (uint8_t s = 0; s < ZCB_NODE_STORE_SECTORS; s++)
+    {
+        if (psStore->au8State[s] == E_STORE_SECTOR_BLANK) {
+            u8Sector = s;
+            break;
+        }
+        if ((psStore->au8State[s] == E_STORE_SECTOR_DIRTY) && (u8Sector == STORE_NONE)) {
+            u8Sector = s;
+        }
+    }
+    if (u8Sector == STORE_NONE) {
+        return false;
+    }
+    if (psStore->au8State[u8Sector] == E_STORE_SECTOR_DIRTY) {
+        if (!bStoreErase(psStore, u8Sector)) {
+            return false;
+        }
+        psStore->au8State[u8Sector] = E_STORE_SECTOR_BLANK;
+    }
+
+    memset(&sHeader, 0, sizeof(sHeader));
+    sHeader.u16Magic = STORE_HEADER_MAGIC;
+    sHeader.u8Op     = STORE_HEADER_VERSION;
+    sHeader.u32Seq   = ++psStore->u32Seq;
+    sHeader.u32Crc   = u32StoreCrc(&sHeader);
+
+    psStore->u8Head = STORE_NONE;
+    if (!bStoreProgram(psStore, u8Sector, 0, &sHeader, sizeof(sHeader))) {
+        psStore->au8State[u8Sector] = E_STORE_SECTOR_DIRTY;
+        return false;
+    }
+    psStore->au8State[u8Sector]      = E_STORE_SECTOR_USED;
+    psStore->au32SectorSeq[u8Sector] = sHeader.u32Seq;
+    psStore->au8Written[u8Sector]    = 0;
+    psStore->au8Live[u8Sector]       = 0;
+    memset(psStore->aau8Holds[u8Sector], 0, STORE_SLOT_BYTES);
+    psStore->u8Head     = u8Sector;
+    psStore->u8HeadNext = 1;
+    return true;
+}
+
+/* Write u8Count records, room being left for them in the sector written to */
+static bool bStoreAppend(tsNodeStore *psStore, tsStoreRecord *pasRecords, uint8_t u8Count)
+{
+    uint8_t u8Head = psStore->u8Head;
+    bool bWritten;
+
+    for (uint8_t i = 0; i < u8Count; i++)
+    {
+        pasRecords[i].u32Seq = ++psStore->u32Seq;
+        pasRecords[i].u32Crc = u32StoreCrc(&pasRecords[i]);
+    }
+    bWritten = bStoreProgram(psStore, u8Head, (uint16_t)(psStore->u8HeadNext * ZCB_NODE_STORE_RECORD_SIZE),
+                             pasRecords, (uint16_t)(u8Count * ZCB_NODE_STORE_RECORD_SIZE));
+
+    /* Records of a failed write may still be read back, the sector keeps
+     * them but takes no more */
+    for (uint8_t i = 0; i < u8Count; i++)
+    {
+        vStoreBitSet(psStore->aau8Holds[u8Head], pasRecords[i].u8Slot);
+        if (bWritten) {
+            vStoreLatest(psStore, pasRecords[i].u8Slot, u8Head);
+        }
+    }
+    if (!bWritten) {
+        psStore->u8HeadNext = ZCB_NODE_STORE_SECTOR_RECORDS + 1;
+        psStore->au8Written[u8Head] = ZCB_NODE_STORE_SECTOR_RECORDS;
+        return false;
+    }
+    psStore->u8HeadNext = (uint8_t)(psStore->u8HeadNext + u8Count);
+    psStore->au8Written[u8Head] = (uint8_t)(psStore->u8HeadNext - 1);
+    return true;
+}
+
+/* The sector in use with the most records overwritten since, the oldest of
+ * those alike; STORE_NONE when compacting would gain nothing */
+static uint8_t u8StoreVictim(const tsNodeStore *psStore)
+{
+    uint8_t u8Victim = STORE_NONE;
+    uint8_t u8Most = 0;
+    uint8_t u8Dead;
+
+    for (uint8_t s = 0; s < ZCB_NODE_STORE_SECTORS; s++)
+    {
+        if ((psStore->au8State[s] != E_STORE_SECTOR_USED) || (s == psStore->u8Head)) {
+            continue;
+        }
+        u8Dead = (uint8_t)(psStore->au8Written[s] - psStore->au8Live[s]);
+        if ((u8Dead > u8Most)
+            || ((u8Dead == u8Most) && (u8Victim != STORE_NONE)
+                && ((int32_t)(psStore->au32SectorSeq[s] - psStore->au32SectorSeq[u8Victim]) < 0))) {
+            u8Most = u8Dead;
+            u8Victim = s;
+        }
+    }
+    return (u8Most > 0) ? u8Victim : STORE_NONE;
+}
+
+static bool bStoreReclaim(tsNodeStore *psStore);
+
+/* Room in the sector written to. Only the compaction takes the last free
+ * sector, it is what gives one back. */
+static bool bStoreMakeRoom(tsNodeStore *psStore, bool bCompacting)
+{
+    if (u8StoreRoom(psStore) > 0) {
+        return true;
+    }
+    if (!bCompacting) {
+        for (uint8_t n = 0; (n < ZCB_NODE_STORE_SECTORS) && (u8StoreFree(psStore) < 2); n++)
+        {
+            if (!bStoreReclaim(psStore)) {
+                break;
+            }
+        }
+        if (u8StoreFree(psStore) < 2) {
+            return false;
+        }
+    }
+    return bStoreOpen(psStore);
+}
+
+static bool bStoreReclaim(tsNodeStore *psStore)
+{
+    tsStoreRecord *pasSector = psStore->asBuffer;
+    tsStoreRecord sSpoilt;
+    uint8_t u8Victim = u8StoreVictim(psStore);
+    uint8_t u8Count = 0;
+    uint8_t u8End;
+    uint8_t u8Room;
+    uint8_t r, n;
+    bool bTorn;
+
+    if (u8Victim == STORE_NONE) {
+        return false;
+    }
+    if (!bStoreRead(psStore, u8Victim, 0, pasSector, ZCB_NODE_STORE_SECTOR_SIZE)) {
+        return false;
+    }
+
+    /* The records still last of their entry are packed to the front of the
+     * buffer, over those already gone through */
+    u8End = u8StoreScan(pasSector, pasSector[0].u32Seq, &bTorn);
+    for (r = 1; r < u8End; r++)
+    {
+        uint8_t u8Slot = pasSector[r].u8Slot;
+
+        if ((u8Slot >= psStore->u8Slots) || (psStore->au8Latest[u8Slot] != u8Victim)) {
+            continue;
+        }
+        for (n = (uint8_t)(r + 1); (n < u8End) && (pasSector[n].u8Slot != u8Slot); n++)
+        {
+        }
+        if (n < u8End) {
+            continue;
+        }
+        if ((pasSector[r].u8Op == STORE_OP_REMOVE) && !bStoreHeldElsewhere(psStore, u8Slot, u8Victim)) {
+            vStoreLatest(psStore, u8Slot, STORE_NONE);
+            continue;
+        }
+        pasSector[u8Count++] = pasSector[r];
+    }
+
+    for (r = 0; r < u8Count; r += u8Room)
+    {
+        if (!bStoreMakeRoom(psStore, true)) {
+            return false;
+        }
+        u8Room = u8StoreRoom(psStore);
+        if (u8Room > u8Count - r) {
+            u8Room = (uint8_t)(u8Count - r);
+        }
+        if (!bStoreAppend(psStore, &pasSector[r], u8Room)) {
+            return false;
+        }
+        psStore->sStats.u32Copied += u8Room;
+    }
+
+    /* The header is spoilt first, a sector whose erase is cut short is not
+     * read back */
+    memset(&sSpoilt, 0, sizeof(sSpoilt));
+    if (!bStoreProgram(psStore, u8Victim, 0, &sSpoilt, sizeof(sSpoilt))) {
+        return false;
+    }
+    psStore->au8State[u8Victim] = E_STORE_SECTOR_DIRTY;
+    psStore->au8Written[u8Victim] = 0;
+    memset(psStore->aau8Holds[u8Victim], 0, STORE_SLOT_BYTES);
+    if (bStoreErase(psStore, u8Victim)) {
+        psStore->au8State[u8Victim] = E_STORE_SECTOR_BLANK;
+    }
+    psStore->sStats.u32Reclaimed++;
+    return true;
+}
+
+/* Entry u8Slot as it is now, its change no longer pending */
+static void vStoreTake(tsNodeStore *psStore, uint8_t u8Slot, NodeDB *psNode)
+{
+    vTaskSuspendAll();
+    vStoreBitClear(psStore->au8Dirty, u8Slot);
+    psStore->u16Dirty--;
+    *psNode = psStore->pasNodes[u8Slot];
+    (void)xTaskResumeAll();
+}
+
+static void vStoreMarkSlot(tsNodeStore *psStore, uint8_t u8Slot)
+{
+    vTaskSuspendAll();
+    if (!bStoreBit(psStore->au8Dirty, u8Slot)) {
+        if (psStore->u16Dirty == 0) {
+            psStore->xDirtySince = xTaskGetTickCount();
+        }
+        vStoreBitSet(psStore->au8Dirty, u8Slot);
+        psStore->u16Dirty++;
+    }
+    (void)xTaskResumeAll();
+}
+
+static bool bStoreCommit(tsNodeStore *psStore)
+{
+    tsStoreRecord *psRecord;
+    NodeDB sNode;
+    uint8_t u8Slot = 0;
+    uint8_t u8Room;
+    uint8_t n;
+
+    if (psStore->u16Dirty == 0) {
+        return true;
+    }
+    while ((psStore->u16Dirty > 0) && (u8Slot < psStore->u8Slots))
+    {
+        if (!bStoreMakeRoom(psStore, false)) {
+            return false;
+        }
+        u8Room = u8StoreRoom(psStore);
+        for (n = 0; (n < u8Room) && (u8Slot < psStore->u8Slots); u8Slot++)
+        {
+            if (!bStoreBit(psStore->au8Dirty, u8Slot)) {
+                continue;
+            }
+            vStoreTake(psStore, u8Slot, &sNode);
+            /* An entry with no record left needs no removal */
+            if (bStoreNodeEmpty(&sNode) && (psStore->au8Latest[u8Slot] == STORE_NONE)) {
+                continue;
+            }
+            psRecord = &psStore->asBuffer[n++];
+            memset(psRecord, 0, sizeof(*psRecord));
+            psRecord->u16Magic     = STORE_RECORD_MAGIC;
+            psRecord->u8Op         = bStoreNodeEmpty(&sNode) ? STORE_OP_REMOVE : STORE_OP_PUT;
+            psRecord->u8Slot       = u8Slot;
+            psRecord->u64Mac       = sNode.mac;
+            psRecord->u16ShortAddr = sNode.shortaddr;
+            psRecord->u16Ep        = sNode.ep;
+            psRecord->u8Type       = sNode.type;
+        }
+        if (n == 0) {
+            continue;
+        }
+        if (!bStoreAppend(psStore, psStore->asBuffer, n)) {
+            /* Written again with the next batch */
+            for (uint8_t i = 0; i < n; i++)
+            {
+                vStoreMarkSlot(psStore, psStore->asBuffer[i].u8Slot);
+            }
+            return false;
+        }
+        psStore->sStats.u32Records += n;
+    }
+    psStore->sStats.u32Commits++;
+    return true;
+}
+
+/* The table made again from the sectors, oldest first */
+static uint8_t u8StoreRecover(tsNodeStore *psStore)
+{
+    tsStoreRecord *pasSector = psStore->asBuffer;
+    uint8_t au8Order[ZCB_NODE_STORE_SECTORS];
+    uint8_t u8Used = 0;
+    uint8_t u8Nodes = 0;
+    uint8_t u8End;
+    uint8_t s, i;
+    bool bTorn;
+
+    memset(psStore->pasNodes, 0, sizeof(NodeDB) * psStore->u8Slots);
+    memset(psStore->aau8Holds, 0, sizeof(psStore->aau8Holds));
+    memset(psStore->au8Latest, STORE_NONE, sizeof(psStore->au8Latest));
+    memset(psStore->au8Live, 0, sizeof(psStore->au8Live));
+    memset(psStore->au8Written, 0, sizeof(psStore->au8Written));
+    memset(psStore->au8Dirty, 0, sizeof(psStore->au8Dirty));
+    psStore->u16Dirty   = 0;
+    psStore->u32Seq     = 0;
+    psStore->u8Head     = STORE_NONE;
+    psStore->u8HeadNext = 0;
+
+    for (s = 0; s < ZCB_NODE_STORE_SECTORS; s++)
+    {
+        psStore->au8State[s] = E_STORE_SECTOR_DIRTY;
+        if (!bStoreRead(psStore, s, 0, pasSector, ZCB_NODE_STORE_SECTOR_SIZE)) {
+            continue;
+        }
+        if (bStoreHeaderValid(&pasSector[0])) {
+            psStore->au8State[s] = E_STORE_SECTOR_USED;
+            psStore->au32SectorSeq[s] = pasSector[0].u32Seq;
+            for (i = u8Used; (i > 0) && ((int32_t)(psStore->au32SectorSeq[au8Order[i - 1]] - pasSector[0].u32Seq) > 0); i--)
+            {
+                au8Order[i] = au8Order[i - 1];
+            }
+            au8Order[i] = s;
+            u8Used++;
+            continue;
+        }
+        for (i = 0; (i <= ZCB_NODE_STORE_SECTOR_RECORDS) && bStoreBlank(&pasSector[i]); i++)
+        {
+        }
+        if (i > ZCB_NODE_STORE_SECTOR_RECORDS) {
+            psStore->au8State[s] = E_STORE_SECTOR_BLANK;
+        }
+    }
+
+    for (i = 0; i < u8Used; i++)
+    {
+        s = au8Order[i];
+        if (!bStoreRead(psStore, s, 0, pasSector, ZCB_NODE_STORE_SECTOR_SIZE)) {
+            psStore->au8Written[s] = ZCB_NODE_STORE_SECTOR_RECORDS;
+            continue;
+        }
+        u8End = u8StoreScan(pasSector, pasSector[0].u32Seq, &bTorn);
+        for (uint8_t r = 1; r < u8End; r++)
+        {
+            const tsStoreRecord *psRecord = &pasSector[r];
+            NodeDB *psNode;
+
+            if (psRecord->u8Slot >= psStore->u8Slots) {
+                continue;
+            }
+            psNode = &psStore->pasNodes[psRecord->u8Slot];
+            if (psRecord->u8Op == STORE_OP_PUT) {
+                psNode->type      = psRecord->u8Type;
+                psNode->ep        = psRecord->u16Ep;
+                psNode->shortaddr = psRecord->u16ShortAddr;
+                psNode->mac       = psRecord->u64Mac;
+            } else {
+                memset(psNode, 0, sizeof(*psNode));
+            }
+            vStoreBitSet(psStore->aau8Holds[s], psRecord->u8Slot);
+            vStoreLatest(psStore, psRecord->u8Slot, s);
+        }
+        psStore->u32Seq = (u8End > 1) ? pasSector[u8End - 1].u32Seq : pasSector[0].u32Seq;
+        psStore->au8Written[s] = bTorn ? ZCB_NODE_STORE_SECTOR_RECORDS : (uint8_t)(u8End - 1);
+        if (bTorn) {
+            psStore->sStats.u32Torn++;
+        }
+        psStore->u8Head = s;
+        psStore->u8HeadNext = bTorn ? (ZCB_NODE_STORE_SECTOR_RECORDS + 1) : u8End;
+    }
+
+    for (i = 0; i < psStore->u8Slots; i++)
+    {
+        if (!bStoreNodeEmpty(&psStore->pasNodes[i])) {
+            u8Nodes++;
+        }
+    }
+    return u8Nodes;
+}
+
+static uint8_t u8StoreAttach(tsNodeStore *psStore, const tsZCB_NodeStoreFlash *psFlash, NodeDB *pasNodes,
+                             uint8_t u8Slots)
+{
+    memset(psStore, 0, sizeof(*psStore));
+    psStore->psFlash  = psFlash;
+    psStore->pasNodes = pasNodes;
+    psStore->u8Slots  = (u8Slots > ZB_BRIDGE_MAX_NODES) ? ZB_BRIDGE_MAX_NODES : u8Slots;
+    return u8StoreRecover(psStore);
+}
+
+/* The blob of before in the entries of the same rank, then emptied: it is
+ * taken once */
+static uint8_t u8StoreMigrate(tsNodeStore *psStore)
+{
+    JoinedNodesSaved *psSaved = pvPortMalloc(sizeof(JoinedNodesSaved));
+    uint8_t u8Nodes = 0;
+
+    if (psSaved == NULL) {
+        return 0;
+    }
+    if (ramStorageReadFromFlash(STORE_LEGACY_FILE, (uint8_t *)psSaved, sizeof(JoinedNodesSaved))
+        && (psSaved->totalNodes > 0)) {
+        for (uint8_t i = 0; (i < psSaved->totalNodes) && (i < psStore->u8Slots); i++)
+        {
+            if (psSaved->joinedNodes[i].type != 0) {
+                psStore->pasNodes[i] = psSaved->joinedNodes[i];
+                vStoreMarkSlot(psStore, i);
+                u8Nodes++;
+            }
+        }
+        if (bStoreCommit(psStore)) {
+            psSaved->totalNodes = 0;
+            (void)ramStorageSavetoFlash(STORE_LEGACY_FILE, (uint8_t *)psSaved, sizeof(JoinedNodesSaved));
+        }
+    }
+    vPortFree(psSaved);
+    return u8Nodes;
+}
+
+void vZCB_NodeStoreSetFlash(const tsZCB_NodeStoreFlash *psFlash)
+{
+    psStoreFlash = (psFlash != NULL) ? psFlash : &sFileFlash;
+}
+
+uint8_t u8ZCB_NodeStoreInit(NodeDB *pasNodes, uint8_t u8Slots)
+{
+    uint8_t u8Nodes;
+
+    if (xStoreMutex == NULL) {
+        xStoreMutex = xSemaphoreCreateMutex();
+    }
+    if (xStoreMutex == NULL) {
+        PRINTF("\n ### Node store mutex create fail\n");
+        return 0;
+    }
+
+    xSemaphoreTake(xStoreMutex, portMAX_DELAY);
+    u8Nodes = u8StoreAttach(&sStore, psStoreFlash, pasNodes, u8Slots);
+    if ((sStore.u8Head == STORE_NONE) && (psStoreFlash == &sFileFlash)) {
+        sStore.sStats.u16Migrated = u8StoreMigrate(&sStore);
+        u8Nodes = (uint8_t)(u8Nodes + sStore.sStats.u16Migrated);
+    }
+    xSemaphoreGive(xStoreMutex);
+
+    PRINTF("\n ### Node store: %d node(s), %d taken over, %d damaged record(s)\n", u8Nodes,
+           sStore.sStats.u16Migrated, (int)sStore.sStats.u32Torn);
+    return u8Nodes;
+}
+
+void vZCB_NodeStoreMark(uint8_t u8Slot)
+{
+    if ((sStore.pasNodes == NULL) || (u8Slot >= sStore.u8Slots)) {
+        return;
+    }
+    vStoreMarkSlot(&sStore, u8Slot);
+}
+
+void vZCB_NodeStorePoll(void)
+{
+    if ((xStoreMutex == NULL) || (sStore.pasNodes == NULL)) {
+        return;
+    }
+
+    xSemaphoreTake(xStoreMutex, portMAX_DELAY);
+    if ((sStore.u16Dirty > 0)
+        && ((xTaskGetTickCount() - sStore.xDirtySince) >= pdMS_TO_TICKS(ZCB_NODE_STORE_COMMIT_MS))) {
+        (void)bStoreCommit(&sStore);
+    }
+    /* One sector a sweep */
+    if (u8StoreFree(&sStore) < ZCB_NODE_STORE_SPARE_SECTORS) {
+        (void)bStoreReclaim(&sStore);
+    }
+    xSemaphoreGive(xStoreMutex);
+}
+
+void vZCB_NodeStoreFlush(void)
+{
+    if ((xStoreMutex == NULL) || (sStore.pasNodes == NULL)) {
+        return;
+    }
+
+    xSemaphoreTake(xStoreMutex, portMAX_DELAY);
+    (void)bStoreCommit(&sStore);
+    xSemaphoreGive(xStoreMutex);
+}
+
+uint32_t u32ZCB_NodeStoreRam(void)
+{
+    return sizeof(sStore) + sizeof(au8FileSector);
+}
+
+void vZCB_NodeStoreDump(void)
+{
+    static const char *const apcStates[] = { "blank", "used", "dirty" };
+
+    if ((xStoreMutex == NULL) || (sStore.pasNodes == NULL)) {
+        return;
+    }
+
+    xSemaphoreTake(xStoreMutex, portMAX_DELAY);
+    PRINTF("\n ### Node store, %d sectors of %d records, %d bytes of RAM\n", ZCB_NODE_STORE_SECTORS,
+           ZCB_NODE_STORE_SECTOR_RECORDS, (int)u32ZCB_NodeStoreRam());
+    for (uint8_t s = 0; s < ZCB_NODE_STORE_SECTORS; s++)
+    {
+        PRINTF(" ### [%d] %-5s", s, apcStates[sStore.au8State[s]]);
+        if (sStore.au8State[s] == E_STORE_SECTOR_USED) {
+            PRINTF(" seq %d, %d records, %d last of their node%s", (int)sStore.au32SectorSeq[s],
+                   sStore.au8Written[s], sStore.au8Live[s], (s == sStore.u8Head) ? ", written to" : "");
+        }
+        PRINTF("\n");
+    }
+    PRINTF(" ### seq %d, %d change(s) pending\n", (int)sStore.u32Seq, sStore.u16Dirty);
+    PRINTF(" ### %d commits, %d records, %d copied, %d sectors compacted\n", (int)sStore.sStats.u32Commits,
+           (int)sStore.sStats.u32Records, (int)sStore.sStats.u32Copied, (int)sStore.sStats.u32Reclaimed);
+    PRINTF(" ### %d programs, %d erases, %d reads, %d failed, %d damaged, %d taken over\n",
+           (int)sStore.sStats.u32Programs, (int)sStore.sStats.u32Erases, (int)sStore.sStats.u32Reads,
+           (int)sStore.sStats.u32Failed, (int)sStore.sStats.u32Torn, sStore.sStats.u16Migrated);
+    xSemaphoreGive(xStoreMutex);
+}
+
+static bool bStoreSimCut(void)
+{
+    if (sSim.bCut) {
+        return true;
+    }
+    sSim.u32Ops++;
+    if ((sSim.u32CutAt != 0) && (sSim.u32Ops >= sSim.u32CutAt)) {
+        sSim.bCut = true;
+    }
+    return false;
+}
+
+static bool bStoreSimRead(uint8_t u8Sector, uint16_t u16Offset, void *pvData, uint16_t u16Length)
+{
+    if (sSim.bCut) {
+        return false;
+    }
+    memcpy(pvData, &sSim.pu8Flash[u8Sector * ZCB_NODE_STORE_SECTOR_SIZE + u16Offset], u16Length);
+    return true;
+}
+
+static bool bStoreSimProgram(uint8_t u8Sector, uint16_t u16Offset, const void *pvData, uint16_t u16Length)
+{
+    const uint8_t *pu8Data = (const uint8_t *)pvData;
+    uint8_t *pu8Flash = &sSim.pu8Flash[u8Sector * ZCB_NODE_STORE_SECTOR_SIZE + u16Offset];
+
+    if (bStoreSimCut()) {
+        return false;
+    }
+    if (sSim.bCut) {
+        u16Length /= 2;
+    }
+    for (uint16_t i = 0; i < u16Length; i++)
+    {
+        pu8Flash[i] &= pu8Data[i];
+    }
+    sSim.u32Bytes += u16Length;
+    return !sSim.bCut;
+}
+
+static bool bStoreSimErase(uint8_t u8Sector)
+{
+    if (bStoreSimCut()) {
+        return false;
+    }
+    memset(&sSim.pu8Flash[u8Sector * ZCB_NODE_STORE_SECTOR_SIZE], 0xFF,
+           sSim.bCut ? (ZCB_NODE_STORE_SECTOR_SIZE / 2) : ZCB_NODE_STORE_SECTOR_SIZE);
+    return !sSim.bCut;
+}
+
+static uint32_t u32StoreRandom(uint32_t *pu32Seed)
+{
+    *pu32Seed = *pu32Seed * 1103515245 + 12345;
+    return *pu32Seed >> 8;
+}
+
+/* One change of the measure run: a join, a new short address, endpoint or
+ * type, or a leave */
+static uint8_t u8StoreMeasureChange(NodeDB *pasNodes, uint32_t *pu32Seed)
+{
+    uint8_t u8Slot = (uint8_t)(u32StoreRandom(pu32Seed) % ZB_BRIDGE_MAX_NODES);
+    NodeDB *psNode = &pasNodes[u8Slot];
+    uint32_t u32Random = u32StoreRandom(pu32Seed);
+
+    if (bStoreNodeEmpty(psNode)) {
+        psNode->mac       = 0x00158D0000000000ULL | u32Random;
+        psNode->shortaddr = (uint16_t)(u32Random | 1);
+        psNode->type      = 1;
+        psNode->ep        = 0;
+        return u8Slot;
+    }
+    switch (u32Random % 4)
+    {
+    case 0:
+        memset(psNode, 0, sizeof(*psNode));
+        break;
+    case 1:
+        psNode->shortaddr = (uint16_t)((u32Random >> 4) | 1);
+        break;
+    case 2:
+        psNode->ep = (uint16_t)(2 + u8Slot);
+        break;
+    default:
+        psNode->type = (uint8_t)(1 + (u32Random >> 4) % 8);
+        break;
+    }
+    return u8Slot;
+}
+
+/* The measure run on a journal in the RAM flash, to its end or to the
+ * power cut. The table as of the last batch written whole goes to
+ * pasWritten, as of the batch being written to pasWriting. */
+static void vStoreMeasureRun(tsNodeStore *psStore, NodeDB *pasNodes, NodeDB *pasWritten, NodeDB *pasWriting,
+                             uint8_t u8Batch)
+{
+    uint32_t u32Seed = 0x5A1E;
+
+    memset(sSim.pu8Flash, 0xFF, ZCB_NODE_STORE_SECTORS * ZCB_NODE_STORE_SECTOR_SIZE);
+    sSim.u32Ops = 0;
+    sSim.u32Bytes = 0;
+    sSim.bCut = false;
+    (void)u8StoreAttach(psStore, &sSimFlash, pasNodes, ZB_BRIDGE_MAX_NODES);
+    memset(pasWritten, 0, sizeof(NodeDB) * ZB_BRIDGE_MAX_NODES);
+    memset(pasWriting, 0, sizeof(NodeDB) * ZB_BRIDGE_MAX_NODES);
+
+    for (uint32_t c = 1; (c <= ZCB_NODE_STORE_MEASURE_CHANGES) && !sSim.bCut; c++)
+    {
+        vStoreMarkSlot(psStore, u8StoreMeasureChange(pasNodes, &u32Seed));
+        if (((c % u8Batch) != 0) && (c != ZCB_NODE_STORE_MEASURE_CHANGES)) {
+            continue;
+        }
+        memcpy(pasWriting, pasNodes, sizeof(NodeDB) * ZB_BRIDGE_MAX_NODES);
+        if (!bStoreCommit(psStore)) {
+            break;
+        }
+        memcpy(pasWritten, pasNodes, sizeof(NodeDB) * ZB_BRIDGE_MAX_NODES);
+        if (u8StoreFree(psStore) < ZCB_NODE_STORE_SPARE_SECTORS) {
+            (void)bStoreReclaim(psStore);
+        }
+    }
+}
+
+void vZCB_NodeStoreMeasure(void)
+{
+    uint32_t u32TableBytes = sizeof(NodeDB) * ZB_BRIDGE_MAX_NODES;
+    static const uint8_t au8Batches[2] = { 1, ZCB_NODE_STORE_MEASURE_BATCH };
+    tsNodeStore *psStore;
+    NodeDB *pasNodes, *pasWritten, *pasWriting, *pasRecovered;
+    uint8_t *pu8Block;
+    uint32_t u32Ops;
+    uint32_t u32Clean = 0;
+    uint32_t u32Torn = 0;
+    uint32_t u32Lost = 0;
+    uint32_t u32Stuck = 0;
+
+    pu8Block = pvPortMalloc(sizeof(tsNodeStore) + 4 * u32TableBytes
+                            + ZCB_NODE_STORE_SECTORS * ZCB_NODE_STORE_SECTOR_SIZE);
+    if (pu8Block == NULL) {
+        PRINTF("\n ### Node store measure: no memory\n");
+        return;
+    }
+    psStore      = (tsNodeStore *)pu8Block;
+    pasNodes     = (NodeDB *)(pu8Block + sizeof(tsNodeStore));
+    pasWritten   = pasNodes + ZB_BRIDGE_MAX_NODES;
+    pasWriting   = pasWritten + ZB_BRIDGE_MAX_NODES;
+    pasRecovered = pasWriting + ZB_BRIDGE_MAX_NODES;
+    sSim.pu8Flash = (uint8_t *)(pasRecovered + ZB_BRIDGE_MAX_NODES);
+    sSim.u32CutAt = 0;
+
+    PRINTF("\n ### Node store, %d changes over %d nodes; a blob rewrite per change is %d erases of %d bytes\n",
+           ZCB_NODE_STORE_MEASURE_CHANGES, ZB_BRIDGE_MAX_NODES, ZCB_NODE_STORE_MEASURE_CHANGES,
+           (int)sizeof(JoinedNodesSaved));
+    for (uint8_t b = 0; b < 2; b++)
+    {
+        vStoreMeasureRun(psStore, pasNodes, pasWritten, pasWriting, au8Batches[b]);
+        PRINTF(" ### Batches of %d: %d records, %d copied, %d programs of %d bytes, %d erases\n", au8Batches[b],
+               (int)psStore->sStats.u32Records, (int)psStore->sStats.u32Copied, (int)psStore->sStats.u32Programs,
+               (int)sSim.u32Bytes, (int)psStore->sStats.u32Erases);
+    }
+    u32Ops = sSim.u32Ops;
+
+    /* The same run cut at points spread over it, each recovery checked: an
+     * entry is as the last batch written or as the one being written, and
+     * the journal recovered takes the table whole again */
+    for (uint32_t k = 1; k <= ZCB_NODE_STORE_MEASURE_CUTS; k++)
+    {
+        bool bClean = true;
+        bool bWritable;
+
+        sSim.u32CutAt = 1 + (k * u32Ops) / (ZCB_NODE_STORE_MEASURE_CUTS + 1);
+        vStoreMeasureRun(psStore, pasNodes, pasWritten, pasWriting, ZCB_NODE_STORE_MEASURE_BATCH);
+        sSim.u32CutAt = 0;
+        sSim.bCut = false;
+
+        (void)u8StoreAttach(psStore, &sSimFlash, pasRecovered, ZB_BRIDGE_MAX_NODES);
+        u32Torn += psStore->sStats.u32Torn;
+        for (uint8_t i = 0; i < ZB_BRIDGE_MAX_NODES; i++)
+        {
+            if (!bStoreNodeSame(&pasRecovered[i], &pasWritten[i])
+                && !bStoreNodeSame(&pasRecovered[i], &pasWriting[i])) {
+                bClean = false;
+                u32Lost++;
+            }
+        }
+
+        memcpy(pasNodes, pasRecovered, u32TableBytes);
+        for (uint8_t i = 0; i < ZB_BRIDGE_MAX_NODES; i++)
+        {
+            vStoreMarkSlot(psStore, i);
+        }
+        bWritable = bStoreCommit(psStore);
+        if (bWritable) {
+            (void)u8StoreAttach(psStore, &sSimFlash, pasRecovered, ZB_BRIDGE_MAX_NODES);
+            for (uint8_t i = 0; i < ZB_BRIDGE_MAX_NODES; i++)
+            {
+                bWritable = bWritable && bStoreNodeSame(&pasRecovered[i], &pasNodes[i]);
+            }
+        }
+        if (!bWritable) {
+            bClean = false;
+            u32Stuck++;
+        }
+        if (bClean) {
+            u32Clean++;
+        }
+    }
+    PRINTF(" ### %d power cuts over %d flash operations: %d recovered clean, %d damaged records found\n",
+           ZCB_NODE_STORE_MEASURE_CUTS, (int)u32Ops, (int)u32Clean, (int)u32Torn);
+    if ((u32Lost != 0) || (u32Stuck != 0)) {
+        PRINTF(" ### %d entries lost, %d journals not written again\n", (int)u32Lost, (int)u32Stuck);
+    }
+
+    sSim.pu8Flash = NULL;
+    vPortFree(pu8Block);
+}
+
+void vZCB_NodeStoreGetStats(tsZCB_NodeStoreStats *psStats)
+{
+    if ((xStoreMutex == NULL) || (psStats == NULL)) {
+        return;
+    }
+
+    xSemaphoreTake(xStoreMutex, portMAX_DELAY);
+    *psStats = sStore.sStats;
+    psStats->u8FreeSectors = u8StoreFree(&sStore);
+    xSemaphoreGive(xStoreMutex);
+}
+
+static const char *pcStoreFileName(uint8_t u8Sector)
+{
+    static char acName[] = "ZBLog00";
+
+    acName[5] = (char)('0' + u8Sector / 10);
+    acName[6] = (char)('0' + u8Sector % 10);
+    return acName;
+}
+
+/* A sector never written reads erased */
+static void vStoreFileLoad(uint8_t u8Sector)
+{
+    if (u8FileCached == u8Sector) {
+        return;
+    }
+    if (!ramStorageReadFromFlash(pcStoreFileName(u8Sector), au8FileSector, sizeof(au8FileSector))) {
+        memset(au8FileSector, 0xFF, sizeof(au8FileSector));
+    }
+    u8FileCached = u8Sector;
+}
+
+static bool bStoreFileRead(uint8_t u8Sector, uint16_t u16Offset, void *pvData, uint16_t u16Length)
+{
+    vStoreFileLoad(u8Sector);
+    memcpy(pvData, &au8FileSector[u16Offset], u16Length);
+    return true;
+}
+
+static bool bStoreFileProgram(uint8_t u8Sector, uint16_t u16Offset, const void *pvData, uint16_t u16Length)
+{
+    const uint8_t *pu8Data = (const uint8_t *)pvData;
+
+    vStoreFileLoad(u8Sector);
+    for (uint16_t i = 0; i < u16Length; i++)
+    {
+        au8FileSector[u16Offset + i] &= pu8Data[i];
+    }
+    if (!ramStorageSavetoFlash(pcStoreFileName(u8Sector), au8FileSector, sizeof(au8FileSector))) {
+        u8FileCached = STORE_NONE;
+        return false;
+    }
+    return true;
+}
+
+static bool bStoreFileErase(uint8_t u8Sector)
+{
+    memset(au8FileSector, 0xFF, sizeof(au8FileSector));
+    u8FileCached = u8Sector;
+    if (!ramStorageSavetoFlash(pcStoreFileName(u8Sector), au8FileSector, sizeof(au8FileSector))) {
+        u8FileCached = STORE_NONE;
+        return false;
+    }
+    return true;
+}
+
+// ------------------------------------------------------------------
+// END OF FILE
+// ------------------------------------------------------------------
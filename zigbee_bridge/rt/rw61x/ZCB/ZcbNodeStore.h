@@ -0,0 +1,127 @@
+/*
+ * Copyright 2021-2023 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef ZCBNODESTORE_H
+#define ZCBNODESTORE_H
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+/****************************************************************************/
+/***        Include files                                                 ***/
+/****************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "zcb.h"
+
+/****************************************************************************/
+/***        Macro Definitions                                             ***/
+/****************************************************************************/
+
+/* Journal geometry: sectors of records of a fixed size, the first record of
+ * a sector is its header */
+#define ZCB_NODE_STORE_RECORD_SIZE              32
+#define ZCB_NODE_STORE_SECTOR_SIZE              1024
+#define ZCB_NODE_STORE_SECTOR_RECORDS           (ZCB_NODE_STORE_SECTOR_SIZE / ZCB_NODE_STORE_RECORD_SIZE - 1)
+/* Room for a record of every joined node and three sectors over, two of
+ * which are kept erased by the compaction */
+#define ZCB_NODE_STORE_SECTORS                  \
+    ((ZB_BRIDGE_MAX_NODES + ZCB_NODE_STORE_SECTOR_RECORDS - 1) / ZCB_NODE_STORE_SECTOR_RECORDS + 3)
+#define ZCB_NODE_STORE_SPARE_SECTORS            2
+
+/* Changes are written this long after the first of them, together */
+#define ZCB_NODE_STORE_COMMIT_MS                250
+
+/* Node changes made by vZCB_NodeStoreMeasure(), written in batches of this
+ * many, and the power cuts spread over them */
+#define ZCB_NODE_STORE_MEASURE_CHANGES          2000
+#define ZCB_NODE_STORE_MEASURE_BATCH            8
+#define ZCB_NODE_STORE_MEASURE_CUTS             100
+
+
+/****************************************************************************/
+/***        Type Definitions                                              ***/
+/****************************************************************************/
+
+/** Flash under the journal, ZCB_NODE_STORE_SECTORS sectors of
+ *  ZCB_NODE_STORE_SECTOR_SIZE bytes. Programming only clears bits, an erase
+ *  sets a whole sector back to 0xFF. Each returns false when it failed. */
+typedef struct
+{
+    bool (*pfRead)(uint8_t u8Sector, uint16_t u16Offset, void *pvData, uint16_t u16Length);
+    bool (*pfProgram)(uint8_t u8Sector, uint16_t u16Offset, const void *pvData, uint16_t u16Length);
+    bool (*pfErase)(uint8_t u8Sector);
+} tsZCB_NodeStoreFlash;
+
+typedef struct
+{
+    uint32_t u32Commits;          /**< Batches of changes written */
+    uint32_t u32Records;          /**< Node records written for changes */
+    uint32_t u32Copied;           /**< ... and moved by the compaction */
+    uint32_t u32Programs;         /**< Flash program operations */
+    uint32_t u32Erases;           /**< Sector erases */
+    uint32_t u32Reads;            /**< Flash read operations */
+    uint32_t u32Reclaimed;        /**< Sectors compacted */
+    uint32_t u32Torn;             /**< Damaged records found at recovery */
+    uint32_t u32Failed;           /**< Flash operations which failed */
+    uint16_t u16Migrated;         /**< Nodes taken from the saved blob of before */
+    uint8_t  u8FreeSectors;
+} tsZCB_NodeStoreStats;
+
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+
+/** Flash the journal is kept in, before vZCB_NodeStoreInit(); NULL keeps
+ *  the default of one ram_storage record per sector */
+void vZCB_NodeStoreSetFlash(const tsZCB_NodeStoreFlash *psFlash);
+
+/** Recover the journal into the u8Slots entries of pasNodes, which the
+ *  store writes from from now on. The saved blob of before is taken over
+ *  when the journal is empty. Returns the nodes found. */
+uint8_t u8ZCB_NodeStoreInit(NodeDB *pasNodes, uint8_t u8Slots);
+
+/** Entry u8Slot of the table changed, from any task: it is written
+ *  ZCB_NODE_STORE_COMMIT_MS later with the other changes then. An entry
+ *  all zero is written as removed. */
+void vZCB_NodeStoreMark(uint8_t u8Slot);
+
+/** Called from the ZCB service task: writes the changes which are due and
+ *  compacts a sector when fewer than ZCB_NODE_STORE_SPARE_SECTORS are free */
+void vZCB_NodeStorePoll(void);
+
+/** Write the changes now */
+void vZCB_NodeStoreFlush(void);
+
+/** Static RAM of the store */
+uint32_t u32ZCB_NodeStoreRam(void);
+
+/** Print the sectors and the counters */
+void vZCB_NodeStoreDump(void);
+
+/** Run ZCB_NODE_STORE_MEASURE_CHANGES node changes through a journal in a
+ *  RAM flash and print its erases against a rewrite of the whole blob per
+ *  change, then cut the power at ZCB_NODE_STORE_MEASURE_CUTS points of the
+ *  same run and check each recovery. The store of the bridge is left
+ *  alone. */
+void vZCB_NodeStoreMeasure(void);
+
+void vZCB_NodeStoreGetStats(tsZCB_NodeStoreStats *psStats);
+
+#if defined __cplusplus
+}
+#endif
+
+#endif  /* ZCBNODESTORE_H */
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
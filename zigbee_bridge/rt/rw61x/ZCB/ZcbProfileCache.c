@@ -0,0 +1,412 @@
+/*
+ * Copyright 2021-2023 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+#include "fsl_debug_console.h"
+
+#include <string.h>
+#include <stdbool.h>
+
+#include "ZigbeeConstant.h"
+#include "ZigbeeDevices.h"
+#include "ZcbProfileCache.h"
+
+#include "ram_storage.h"
+
+/*
+ * Profiles of the device models met by the bridge.
+ *
+ * A joining node is asked for its active endpoints, the simple descriptor of
+ * each of them and its model identifier before its clusters are bound; a
+ * house of identical bulbs pays for that once per bulb, and again after
+ * every factory reset. What the interview learns is the same for every node
+ * of a model, so it is kept here once the first node of the model has been
+ * through it: the endpoints with their device type and clusters, and the
+ * attributes the bridge follows with their type.
+ *
+ * A profile is found by the manufacturer name, model identifier and
+ * application version of the node, all three read from its Basic cluster in
+ * one request. A node of a known model has its tables filled from the
+ * profile and goes straight to its binds; any other node, or one whose read
+ * is not answered, gets the full interview and its model is kept after it.
+ * The profiles are written to flash, they survive a restart of the bridge.
+ */
+
+#define ZCB_PROFILE_MAGIC       0x5A505231  /* "ZPR1" */
+
+typedef struct
+{
+    uint8_t     u8EndpointId;
+    uint16_t    u16DeviceType;
+    uint8_t     u8ClusterCount;
+    uint16_t    au16Clusters[MAX_ZD_CLUSTER_NUMBERS_PER_EP];
+} tsProfileEndpoint;
+
+typedef struct
+{
+    uint8_t     u8Endpoint;
+    uint8_t     u8DataType;
+    uint16_t    u16ClusterId;
+    uint16_t    u16AttributeId;
+} tsProfileAttribute;
+
+typedef struct
+{
+    tsZCB_ProfileKey    sKey;
+    bool                bValid;
+    uint8_t             u8EndpointCount;
+    uint8_t             u8AttributeCount;
+    uint32_t            u32InterviewMs;     /* of the node the profile was taken from */
+    uint32_t            u32Hits;
+    uint32_t            u32LastUsed;        /* u32UseCount when last stored or hit */
+    tsProfileEndpoint   asEndpoints[MAX_ZD_ENDPOINT_NUMBERS_PER_DEV];
+    tsProfileAttribute  asAttributes[ZCB_PROFILE_MAX_ATTRIBUTES];
+} tsProfile;
+
+typedef struct
+{
+    uint32_t    u32Magic;
+    uint32_t    u32UseCount;
+    tsProfile   asProfiles[ZCB_PROFILE_MAX];
+} tsProfileTable;
+
+static tsProfileTable sTable;
+static tsZCB_ProfileStats sStats;
+static SemaphoreHandle_t xProfileMutex = NULL;
+
+
+static void vProfileCopyName(char *pcName, const uint8_t *pu8Value, uint16_t u16Size)
+{
+    if (u16Size > ZCB_PROFILE_NAME_LENGTH) {
+        u16Size = ZCB_PROFILE_NAME_LENGTH;
+    }
+    memcpy(pcName, pu8Value, u16Size);
+    pcName[u16Size] = '\0';
+}
+
+/* Called with the mutex held */
+static tsProfile *psProfileFind(const tsZCB_ProfileKey *psKey)
+{
+    for (uint8_t i = 0; i < ZCB_PROFILE_MAX; i++)
+    {
+        tsProfile *psProfile = &sTable.asProfiles[i];
+
+        if (psProfile->bValid
+            && (psProfile->sKey.u8AppVersion == psKey->u8AppVersion)
+            && (strcmp(psProfile->sKey.acModel, psKey->acModel) == 0)
+            && (strcmp(psProfile->sKey.acManufacturer, psKey->acManufacturer) == 0)) {
+            return psProfile;
+        }
+    }
+    return NULL;
+}
+
+/* Called with the mutex held; a free entry, or the least recently used one */
+static tsProfile *psProfileAlloc(void)
+{
+    tsProfile *psOldest = &sTable.asProfiles[0];
+
+    for (uint8_t i = 0; i < ZCB_PROFILE_MAX; i++)
+    {
+        tsProfile *psProfile = &sTable.asProfiles[i];
+
+        if (!psProfile->bValid) {
+            return psProfile;
+        }
+        if ((int32_t)(psProfile->u32LastUsed - psOldest->u32LastUsed) < 0) {
+            psOldest = psProfile;
+        }
+    }
+    sStats.u32Replaced++;
+    PRINTF("\n ### Profile of %s %s v%d replaced\n", psOldest->sKey.acManufacturer,
+           psOldest->sKey.acModel, psOldest->sKey.u8AppVersion);
+    return psOldest;
+}
+
+/* Called with the mutex held */
+static void vProfileSave(void)
+{
+    sTable.u32Magic = ZCB_PROFILE_MAGIC;
+    if (!ramStorageSavetoFlash(ZCB_PROFILE_FILE, (uint8_t *)&sTable, sizeof(sTable))) {
+        sStats.u32SaveFailures++;
+        PRINTF("\n ### Profile table not saved\n");
+    }
+}
+
+/* Called with the mutex held; the attribute is given the model identifier
+ * read already, as the interview would have left it */
+static void vProfileModelValue(tsZbDeviceAttribute *psAttribute, const tsZCB_ProfileKey *psKey)
+{
+    if ((psAttribute->u8DataType != E_ZCL_CSTRING) && (psAttribute->u8DataType != E_ZCL_OSTRING)) {
+        return;
+    }
+    bZDM_SetAttributeString(psAttribute, (const uint8_t *)psKey->acModel, (uint8_t)strlen(psKey->acModel));
+}
+
+void vZCB_ProfileInit(void)
+{
+    memset(&sStats, 0, sizeof(sStats));
+
+    if (xProfileMutex == NULL) {
+        xProfileMutex = xSemaphoreCreateMutex();
+    }
+
+    memset(&sTable, 0, sizeof(sTable));
+    if (!ramStorageReadFromFlash(ZCB_PROFILE_FILE, (uint8_t *)&sTable, sizeof(sTable))
+        || (sTable.u32Magic != ZCB_PROFILE_MAGIC)) {
+        memset(&sTable, 0, sizeof(sTable));
+        return;
+    }
+
+    for (uint8_t i = 0; i < ZCB_PROFILE_MAX; i++)
+    {
+        tsProfile *psProfile = &sTable.asProfiles[i];
+        bool bBad = (psProfile->u8EndpointCount > MAX_ZD_ENDPOINT_NUMBERS_PER_DEV)
+                    || (psProfile->u8AttributeCount > ZCB_PROFILE_MAX_ATTRIBUTES);
+
+        for (uint8_t j = 0; !bBad && (j < psProfile->u8EndpointCount); j++)
+        {
+            bBad = (psProfile->asEndpoints[j].u8ClusterCount > MAX_ZD_CLUSTER_NUMBERS_PER_EP);
+        }
+        if (bBad) {
+            memset(psProfile, 0, sizeof(tsProfile));
+        }
+        psProfile->sKey.acManufacturer[ZCB_PROFILE_NAME_LENGTH] = '\0';
+        psProfile->sKey.acModel[ZCB_PROFILE_NAME_LENGTH] = '\0';
+    }
+}
+
+bool bZCB_ProfileKeyField(tsZCB_ProfileKey *psKey, uint16_t u16AttributeId,
+                          const uint8_t *pu8Value, uint16_t u16Size)
+{
+    switch (u16AttributeId)
+    {
+        case E_ZB_ATTRIBUTEID_BASIC_MAN_NAME:
+            vProfileCopyName(psKey->acManufacturer, pu8Value, u16Size);
+            return true;
+
+        case E_ZB_ATTRIBUTEID_BASIC_MODEL_ID:
+            vProfileCopyName(psKey->acModel, pu8Value, u16Size);
+            return true;
+
+        case E_ZB_ATTRIBUTEID_BASIC_APP_VERSION:
+            psKey->u8AppVersion = (u16Size > 0) ? pu8Value[0] : 0;
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+bool bZCB_ProfileApply(const tsZCB_ProfileKey *psKey, tsZbDeviceInfo *psDevice, uint32_t *pu32InterviewMs)
+{
+    uint8_t au8Endpoints[MAX_ZD_ENDPOINT_NUMBERS_PER_DEV];
+    tsProfile *psProfile;
+
+    if ((xProfileMutex == NULL) || (psDevice == NULL)) {
+        return false;
+    }
+
+    xSemaphoreTake(xProfileMutex, portMAX_DELAY);
+    sStats.u32Lookups++;
+    psProfile = psProfileFind(psKey);
+    if (psProfile == NULL) {
+        sStats.u32Misses++;
+        xSemaphoreGive(xProfileMutex);
+        return false;
+    }
+    psProfile->u32Hits++;
+    psProfile->u32LastUsed = ++sTable.u32UseCount;
+    sStats.u32Hits++;
+    *pu32InterviewMs = psProfile->u32InterviewMs;
+
+    for (uint8_t i = 0; i < psProfile->u8EndpointCount; i++)
+    {
+        au8Endpoints[i] = psProfile->asEndpoints[i].u8EndpointId;
+    }
+    bZDM_SetDeviceEndpoints(psDevice, psProfile->u8EndpointCount, au8Endpoints);
+    for (uint8_t i = 0; i < psDevice->u8EndpointCount; i++)
+    {
+        const tsProfileEndpoint *psFrom = &psProfile->asEndpoints[i];
+
+        tZDM_SetEndpointClusters(psDevice, psFrom->u8EndpointId, psFrom->u16DeviceType,
+                                 psFrom->u8ClusterCount, psFrom->au16Clusters);
+    }
+
+    /* Attributes left by an earlier join of the node are kept, not doubled */
+    for (uint8_t i = 0; i < psProfile->u8AttributeCount; i++)
+    {
+        const tsProfileAttribute *psFrom = &psProfile->asAttributes[i];
+        tsZbDeviceAttribute *psAttribute = tZDM_FindAttributeEntryByElement(psDevice->u16NodeId,
+                                                                            psFrom->u8Endpoint,
+                                                                            psFrom->u16ClusterId,
+                                                                            psFrom->u16AttributeId);
+        if (psAttribute != NULL) {
+            vZDM_ArenaLock();
+            tsZbDeviceCluster *psCluster = tZDM_FindClusterEntryInDeviceTable(psDevice->u16NodeId,
+                                                                              psFrom->u8Endpoint,
+                                                                              psFrom->u16ClusterId);
+            if (psCluster != NULL) {
+                psCluster->u8AttributeCount++;
+            }
+            vZDM_ArenaUnlock();
+        } else {
+            psAttribute = tZDM_AddNewAttributeToAttributeTable(psDevice->u16NodeId,
+                                                               psFrom->u8Endpoint,
+                                                               psFrom->u16ClusterId,
+                                                               psFrom->u16AttributeId,
+                                                               psFrom->u8DataType);
+        }
+        if ((psAttribute != NULL) && (psFrom->u16ClusterId == E_ZB_CLUSTERID_BASIC)
+            && (psFrom->u16AttributeId == E_ZB_ATTRIBUTEID_BASIC_MODEL_ID)) {
+            vProfileModelValue(psAttribute, psKey);
+        }
+    }
+    xSemaphoreGive(xProfileMutex);
+
+    return true;
+}
+
+void vZCB_ProfileHitDone(uint32_t u32InterviewMs, uint32_t u32HitMs)
+{
+    if (xProfileMutex == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(xProfileMutex, portMAX_DELAY);
+    if (u32InterviewMs > u32HitMs) {
+        sStats.u32SavedMs += u32InterviewMs - u32HitMs;
+    }
+    xSemaphoreGive(xProfileMutex);
+}
+
+void vZCB_ProfileStore(const tsZCB_ProfileKey *psKey, uint16_t u16ShortAddress, uint32_t u32InterviewMs)
+{
+    tsZbDeviceInfo *psDevice = tZDM_FindDeviceByNodeId(u16ShortAddress);
+    tsProfile *psProfile;
+
+    if ((xProfileMutex == NULL) || (psDevice == NULL) || (psKey->acModel[0] == '\0')) {
+        return;
+    }
+
+    xSemaphoreTake(xProfileMutex, portMAX_DELAY);
+    psProfile = psProfileFind(psKey);
+    if (psProfile == NULL) {
+        psProfile = psProfileAlloc();
+    }
+    memset(psProfile, 0, sizeof(tsProfile));
+    psProfile->sKey = *psKey;
+
+    psProfile->u8EndpointCount = psDevice->u8EndpointCount;
+    if (psProfile->u8EndpointCount > MAX_ZD_ENDPOINT_NUMBERS_PER_DEV) {
+        psProfile->u8EndpointCount = MAX_ZD_ENDPOINT_NUMBERS_PER_DEV;
+    }
+    vZDM_ArenaLock();
+    for (uint8_t i = 0; i < psProfile->u8EndpointCount; i++)
+    {
+        const tsZbDeviceEndPoint *psEndpoint = tZDM_FindEndpointByIndex(psDevice, i);
+        tsProfileEndpoint *psTo = &psProfile->asEndpoints[i];
+
+        psTo->u8EndpointId   = psEndpoint->u8EndpointId;
+        psTo->u16DeviceType  = psEndpoint->u16DeviceType;
+        psTo->u8ClusterCount = psEndpoint->u8ClusterCount;
+        if (psTo->u8ClusterCount > MAX_ZD_CLUSTER_NUMBERS_PER_EP) {
+            psTo->u8ClusterCount = MAX_ZD_CLUSTER_NUMBERS_PER_EP;
+        }
+        for (uint8_t j = 0; j < psTo->u8ClusterCount; j++)
+        {
+            psTo->au16Clusters[j] = tZDM_FindClusterByIndex(psEndpoint, j)->u16ClusterId;
+        }
+    }
+    vZDM_ArenaUnlock();
+
+    for (const tsZbDeviceAttribute *psAttribute = tZDM_NextDeviceAttribute(u16ShortAddress, NULL);
+         psAttribute != NULL;
+         psAttribute = tZDM_NextDeviceAttribute(u16ShortAddress, psAttribute))
+    {
+        if (psProfile->u8AttributeCount == ZCB_PROFILE_MAX_ATTRIBUTES) {
+            /* Not kept at all, a partial profile would leave attributes out */
+            memset(psProfile, 0, sizeof(tsProfile));
+            sStats.u32TooLarge++;
+            xSemaphoreGive(xProfileMutex);
+            PRINTF("\n ### Profile of %s: more than %d attributes, not kept\n", psKey->acModel,
+                   ZCB_PROFILE_MAX_ATTRIBUTES);
+            return;
+        }
+        psProfile->asAttributes[psProfile->u8AttributeCount].u8Endpoint     = psAttribute->u8Endpoint;
+        psProfile->asAttributes[psProfile->u8AttributeCount].u8DataType     = psAttribute->u8DataType;
+        psProfile->asAttributes[psProfile->u8AttributeCount].u16ClusterId   = psAttribute->u16ClusterId;
+        psProfile->asAttributes[psProfile->u8AttributeCount].u16AttributeId = psAttribute->u16AttributeId;
+        psProfile->u8AttributeCount++;
+    }
+
+    psProfile->bValid         = true;
+    psProfile->u32InterviewMs = u32InterviewMs;
+    psProfile->u32LastUsed    = ++sTable.u32UseCount;
+    sStats.u32Stored++;
+    vProfileSave();
+    xSemaphoreGive(xProfileMutex);
+}
+
+void vZCB_ProfileClear(void)
+{
+    if (xProfileMutex == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(xProfileMutex, portMAX_DELAY);
+    memset(&sTable, 0, sizeof(sTable));
+    vProfileSave();
+    xSemaphoreGive(xProfileMutex);
+}
+
+void vZCB_ProfileDump(void)
+{
+    uint32_t u32Rate;
+
+    if (xProfileMutex == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(xProfileMutex, portMAX_DELAY);
+    for (uint8_t i = 0; i < ZCB_PROFILE_MAX; i++)
+    {
+        const tsProfile *psProfile = &sTable.asProfiles[i];
+
+        if (!psProfile->bValid) {
+            continue;
+        }
+        PRINTF("\n ### %s / %s v%d: endpoints=%d attributes=%d interview=%d ms hits=%d",
+               psProfile->sKey.acManufacturer, psProfile->sKey.acModel, psProfile->sKey.u8AppVersion,
+               psProfile->u8EndpointCount, psProfile->u8AttributeCount,
+               (int)psProfile->u32InterviewMs, (int)psProfile->u32Hits);
+    }
+    u32Rate = (sStats.u32Lookups == 0) ? 0 : (sStats.u32Hits * 100) / sStats.u32Lookups;
+    PRINTF("\n ### lookups=%d hits=%d misses=%d hitrate=%d%% saved=%d ms stored=%d replaced=%d toolarge=%d savefail=%d\n",
+           (int)sStats.u32Lookups, (int)sStats.u32Hits, (int)sStats.u32Misses, (int)u32Rate,
+           (int)sStats.u32SavedMs, (int)sStats.u32Stored, (int)sStats.u32Replaced,
+           (int)sStats.u32TooLarge, (int)sStats.u32SaveFailures);
+    xSemaphoreGive(xProfileMutex);
+}
+
+void vZCB_ProfileGetStats(tsZCB_ProfileStats *psStats)
+{
+    if ((psStats == NULL) || (xProfileMutex == NULL)) {
+        return;
+    }
+
+    xSemaphoreTake(xProfileMutex, portMAX_DELAY);
+    *psStats = sStats;
+    xSemaphoreGive(xProfileMutex);
+}
+
+// ------------------------------------------------------------------
+// END OF FILE
+// ------------------------------------------------------------------
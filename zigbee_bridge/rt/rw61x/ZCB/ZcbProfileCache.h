@@ -0,0 +1,107 @@
+/*
+ * Copyright 2021-2023 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef ZCBPROFILECACHE_H
+#define ZCBPROFILECACHE_H
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+/****************************************************************************/
+/***        Include files                                                 ***/
+/****************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "zcb.h"
+#include "ZigbeeDevices.h"
+
+/****************************************************************************/
+/***        Macro Definitions                                             ***/
+/****************************************************************************/
+
+/* Device models kept, the least recently used one is replaced */
+#define ZCB_PROFILE_MAX                         12
+/* Manufacturer name and model identifier, longer ones are cut */
+#define ZCB_PROFILE_NAME_LENGTH                 32
+/* Attributes kept per model, over all its endpoints */
+#define ZCB_PROFILE_MAX_ATTRIBUTES              16
+/* The verification read goes to this endpoint, where most models have Basic */
+#define ZCB_PROFILE_READ_ENDPOINT               1
+/* Flash record of the profiles */
+#define ZCB_PROFILE_FILE                        "ZBProfiles"
+
+
+/****************************************************************************/
+/***        Type Definitions                                              ***/
+/****************************************************************************/
+
+/** What the verification read of the Basic cluster tells of the node */
+typedef struct
+{
+    char    acManufacturer[ZCB_PROFILE_NAME_LENGTH + 1];
+    char    acModel[ZCB_PROFILE_NAME_LENGTH + 1];
+    uint8_t u8AppVersion;
+} tsZCB_ProfileKey;
+
+typedef struct
+{
+    uint32_t u32Lookups;          /**< Verification reads answered with a model */
+    uint32_t u32Hits;             /**< Nodes provisioned from a profile */
+    uint32_t u32Misses;           /**< Nodes given the full interview */
+    uint32_t u32Stored;           /**< Profiles written after a full interview */
+    uint32_t u32Replaced;         /**< Profiles dropped to make room */
+    uint32_t u32TooLarge;         /**< Models with more attributes than kept */
+    uint32_t u32SaveFailures;     /**< Profiles not written to flash */
+    uint32_t u32SavedMs;          /**< Interview time saved by the hits */
+} tsZCB_ProfileStats;
+
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+
+/** Load the profiles from flash */
+void vZCB_ProfileInit(void);
+
+/** Take one record of a Basic cluster read into the key; false when the
+ *  attribute is not part of it */
+bool bZCB_ProfileKeyField(tsZCB_ProfileKey *psKey, uint16_t u16AttributeId,
+                          const uint8_t *pu8Value, uint16_t u16Size);
+
+/** Look the model up. On a hit the endpoints and clusters of the node are
+ *  filled in the device table, its attributes added to the attribute table,
+ *  and the full interview time of the model returned in pu32InterviewMs. */
+bool bZCB_ProfileApply(const tsZCB_ProfileKey *psKey, tsZbDeviceInfo *psDevice, uint32_t *pu32InterviewMs);
+
+/** A node provisioned from a profile is done, after u32HitMs instead of
+ *  the u32InterviewMs of its full interview */
+void vZCB_ProfileHitDone(uint32_t u32InterviewMs, uint32_t u32HitMs);
+
+/** Keep the model of a node which went through the full interview, from the
+ *  device and attribute tables, and write the profiles to flash */
+void vZCB_ProfileStore(const tsZCB_ProfileKey *psKey, uint16_t u16ShortAddress, uint32_t u32InterviewMs);
+
+/** Drop every profile, the next node of each model is interviewed in full */
+void vZCB_ProfileClear(void);
+
+/** Print the profiles and the hit rate */
+void vZCB_ProfileDump(void);
+
+void vZCB_ProfileGetStats(tsZCB_ProfileStats *psStats);
+
+#if defined __cplusplus
+}
+#endif
+
+#endif  /* ZCBPROFILECACHE_H */
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
@@ -0,0 +1,387 @@
+/*
+ * Copyright 2021-2023 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "fsl_debug_console.h"
+
+#include <string.h>
+#include <stdbool.h>
+
+#include "ZigbeeDevices.h"
+#include "ZigbeeConstant.h"
+#include "zcb.h"
+#include "ZcbNodeFlow.h"
+#include "ZcbMailbox.h"
+#include "ZcbAttributeMap.h"
+#include "ZcbLiveness.h"
+#include "ZcbSnapshot.h"
+#include "ZcbNodeStore.h"
+#include "ZcbTopology.h"
+#include "ZcbDiscovery.h"
+#include "ZcbRegistry.h"
+
+/*
+ * Node registry at capacity.
+ *
+ * The tables kept per node, devices, attributes, endpoint records, joined
+ * nodes and the state of the other modules, were each sized on their own,
+ * for five nodes or a few dozen; they now all follow ZB_BRIDGE_MAX_NODES.
+ * This module reports what they take at that size against the RAM budget
+ * of the bridge, and fills them to it with synthetic nodes to time the
+ * operations the ZCB task does per message. A lookup which still scanned a
+ * table would show here as a cost four times higher at full capacity than
+ * at a quarter of it.
+ *
+ * The fill takes over the live tables and empties them after, so the
+ * scale test is only built with ZB_BRIDGE_TEST_COMMANDS.
+ */
+
+/* Per node tables of vZCB_RegistryBudget() */
+#define REGISTRY_TABLES         12
+
+#if ZB_BRIDGE_TEST_COMMANDS
+/* Attributes of each synthetic node, a colour light as the interview
+ * leaves it; MAX_ZD_ATTRIBUTES_PER_DEV of them at most */
+typedef struct
+{
+    uint16_t    u16ClusterId;
+    uint16_t    u16AttributeId;
+    uint8_t     u8DataType;
+} tsRegistryAttribute;
+
+static const tsRegistryAttribute asRegistryAttributes[] =
+{
+    { E_ZB_CLUSTERID_BASIC,         E_ZB_ATTRIBUTEID_BASIC_MAN_NAME,              E_ZCL_CSTRING },
+    { E_ZB_CLUSTERID_BASIC,         E_ZB_ATTRIBUTEID_BASIC_MODEL_ID,              E_ZCL_CSTRING },
+    { E_ZB_CLUSTERID_BASIC,         E_ZB_ATTRIBUTEID_BASIC_DATE_CODE,             E_ZCL_CSTRING },
+    { E_ZB_CLUSTERID_BASIC,         E_ZB_ATTRIBUTEID_BASIC_POWER_SOURCE,          E_ZB_ATTRIBUTE_UINT64_TYPE },
+    { E_ZB_CLUSTERID_ONOFF,         E_ZB_ATTRIBUTEID_ONOFF_ONOFF,                 E_ZB_ATTRIBUTE_UINT64_TYPE },
+    { E_ZB_CLUSTERID_LEVEL_CONTROL, E_ZB_ATTRIBUTEID_LEVEL_CURRENTLEVEL,          E_ZB_ATTRIBUTE_UINT64_TYPE },
+    { E_ZB_CLUSTERID_COLOR_CONTROL, E_ZB_ATTRIBUTEID_COLOUR_CURRENTX,             E_ZB_ATTRIBUTE_UINT64_TYPE },
+    { E_ZB_CLUSTERID_COLOR_CONTROL, E_ZB_ATTRIBUTEID_COLOUR_CURRENTY,             E_ZB_ATTRIBUTE_UINT64_TYPE },
+    { E_ZB_CLUSTERID_COLOR_CONTROL, E_ZB_ATTRIBUTEID_COLOUR_COLOURTEMPERATURE,    E_ZB_ATTRIBUTE_UINT64_TYPE },
+    { E_ZB_CLUSTERID_COLOR_CONTROL, E_ZB_ATTRIBUTEID_COLOUR_COLOURMODE,           E_ZB_ATTRIBUTE_UINT64_TYPE },
+};
+#define REGISTRY_ATTRIBUTES     ((sizeof(asRegistryAttributes) / sizeof(asRegistryAttributes[0])) \
+                                 < MAX_ZD_ATTRIBUTES_PER_DEV ? \
+                                 (sizeof(asRegistryAttributes) / sizeof(asRegistryAttributes[0])) : \
+                                 MAX_ZD_ATTRIBUTES_PER_DEV)
+
+static const uint16_t au16RegistryClusters[] =
+{
+    E_ZB_CLUSTERID_BASIC, E_ZB_CLUSTERID_ONOFF, E_ZB_CLUSTERID_LEVEL_CONTROL, E_ZB_CLUSTERID_COLOR_CONTROL
+};
+
+/* Basic cluster strings, the same for every node as for bulbs of one model */
+static const char *const apcRegistryStrings[] = { "NXP", "ZLL-ExtendedColor", "20231012" };
+
+#define REGISTRY_ENDPOINT       1
+/* Matter endpoints of the synthetic nodes start here */
+#define REGISTRY_FIRST_EP       2
+/* Short address no synthetic node has, a node moves there and back */
+#define REGISTRY_SPARE_NODE_ID  0xFFF1
+
+typedef enum
+{
+    E_REGISTRY_OP_JOIN,
+    E_REGISTRY_OP_SHORT,
+    E_REGISTRY_OP_IEEE,
+    E_REGISTRY_OP_REPORT,
+    E_REGISTRY_OP_JOINED_SHORT,
+    E_REGISTRY_OP_JOINED_EP,
+    E_REGISTRY_OP_JOINED_IEEE,
+    E_REGISTRY_OP_MOVE,
+    E_REGISTRY_OP_CHURN,
+    E_REGISTRY_OPS
+} teRegistryOp;
+
+static const char *const apcRegistryOps[E_REGISTRY_OPS] =
+{
+    "Join, device and joined node",
+    "Device by short address",
+    "Device by IEEE address",
+    "Attribute report",
+    "Joined node by short address",
+    "Joined node by Matter endpoint",
+    "Joined node by IEEE address",
+    "Short address change",
+    "Leave and join again",
+};
+
+
+static uint16_t u16RegistryNodeId(uint16_t i)
+{
+    /* 7919 is prime to 0xFFF0, the addresses are distinct and spread */
+    return 1 + (uint16_t)(((uint32_t)i * 7919u) % 0xFFF0u);
+}
+
+static uint64_t u64RegistryIeeeAddress(uint16_t i)
+{
+    return 0x00158D0000000000ULL | ((uint64_t)((uint32_t)i * 2654435761u) << 8) | (i & 0xFF);
+}
+
+static uint32_t u32RegistryNs(TickType_t xStart, uint32_t u32Ops)
+{
+    uint64_t u64Ns = (uint64_t)((xTaskGetTickCount() - xStart) * portTICK_PERIOD_MS) * 1000000u;
+
+    return (uint32_t)(u64Ns / u32Ops);
+}
+
+/* Synthetic node i in the device and attribute tables, as its interview
+ * would leave it */
+static bool bRegistryAddDevice(uint16_t i)
+{
+    uint16_t u16NodeId = u16RegistryNodeId(i);
+    uint8_t u8Endpoint = REGISTRY_ENDPOINT;
+    tsZbDeviceInfo *psDevice;
+    tsZbDeviceAttribute *psAttribute;
+
+    psDevice = tZDM_AddNewDeviceToDeviceTable(u16NodeId, u64RegistryIeeeAddress(i));
+    if ((psDevice == NULL)
+        || !bZDM_SetDeviceEndpoints(psDevice, 1, &u8Endpoint)
+        || (tZDM_SetEndpointClusters(psDevice, u8Endpoint, E_ZB_DEVICEID_LIGHT_COLOR_EXT,
+                                     sizeof(au16RegistryClusters) / sizeof(au16RegistryClusters[0]),
+                                     au16RegistryClusters) == NULL)) {
+        return false;
+    }
+    for (uint8_t j = 0; j < REGISTRY_ATTRIBUTES; j++)
+    {
+        psAttribute = tZDM_AddNewAttributeToAttributeTable(u16NodeId, u8Endpoint,
+                                                           asRegistryAttributes[j].u16ClusterId,
+                                                           asRegistryAttributes[j].u16AttributeId,
+                                                           asRegistryAttributes[j].u8DataType);
+        if (psAttribute == NULL) {
+            return false;
+        }
+        if (j < sizeof(apcRegistryStrings) / sizeof(apcRegistryStrings[0])) {
+            bZDM_SetAttributeString(psAttribute, (const uint8_t *)apcRegistryStrings[j],
+                                    (uint8_t)strlen(apcRegistryStrings[j]));
+        }
+    }
+    return true;
+}
+
+/* Nodes u16From to u16To - 1 joined; the time per node */
+static bool bRegistryFill(uint16_t u16From, uint16_t u16To, uint32_t *pu32Ns)
+{
+    TickType_t xStart = xTaskGetTickCount();
+
+    for (uint16_t i = u16From; i < u16To; i++)
+    {
+        if (!bRegistryAddDevice(i)
+            || (u8ZCB_JoinedNodeClaim(u16RegistryNodeId(i), u64RegistryIeeeAddress(i)) >= DEV_NUM)
+            || (u8ZCB_JoinedNodeSetEp(u16RegistryNodeId(i), REGISTRY_FIRST_EP + i) >= DEV_NUM)) {
+            PRINTF("\n ### Registry scale test: node %d of %d refused\n", i + 1, u16To);
+            return false;
+        }
+    }
+    *pu32Ns = u32RegistryNs(xStart, u16To - u16From);
+    return true;
+}
+
+/* Time each operation over the u16Nodes nodes in the registry */
+static void vRegistryMeasure(uint16_t u16Nodes, uint32_t *pu32Ns)
+{
+    uint32_t u32Attributes = (uint32_t)u16Nodes * REGISTRY_ATTRIBUTES;
+    volatile uint32_t u32Found = 0;
+    TickType_t xStart;
+
+    xStart = xTaskGetTickCount();
+    for (uint32_t n = 0; n < ZCB_REGISTRY_SCALE_LOOKUPS; n++)
+    {
+        if (tZDM_FindDeviceByNodeId(u16RegistryNodeId(n % u16Nodes)) != NULL) {
+            u32Found++;
+        }
+    }
+    pu32Ns[E_REGISTRY_OP_SHORT] = u32RegistryNs(xStart, ZCB_REGISTRY_SCALE_LOOKUPS);
+
+    xStart = xTaskGetTickCount();
+    for (uint32_t n = 0; n < ZCB_REGISTRY_SCALE_LOOKUPS; n++)
+    {
+        if (tZDM_FindDeviceByIeeeAddress(u64RegistryIeeeAddress(n % u16Nodes)) != NULL) {
+            u32Found++;
+        }
+    }
+    pu32Ns[E_REGISTRY_OP_IEEE] = u32RegistryNs(xStart, ZCB_REGISTRY_SCALE_LOOKUPS);
+
+    /* Every node in turn reports one of its attributes, found and updated */
+    xStart = xTaskGetTickCount();
+    for (uint32_t n = 0; n < ZCB_REGISTRY_SCALE_LOOKUPS; n++)
+    {
+        uint32_t k = n % u32Attributes;
+        const tsRegistryAttribute *psReport = &asRegistryAttributes[k % REGISTRY_ATTRIBUTES];
+        tsZbDeviceAttribute *psAttribute;
+
+        if (psReport->u8DataType != E_ZB_ATTRIBUTE_UINT64_TYPE) {
+            psReport = &asRegistryAttributes[REGISTRY_ATTRIBUTES - 1];
+        }
+        psAttribute = tZDM_FindAttributeEntryByElement(u16RegistryNodeId(k / REGISTRY_ATTRIBUTES),
+                                                       REGISTRY_ENDPOINT, psReport->u16ClusterId,
+                                                       psReport->u16AttributeId);
+        if (psAttribute != NULL) {
+            psAttribute->uData.u64Data = n;
+            u32Found++;
+        }
+    }
+    pu32Ns[E_REGISTRY_OP_REPORT] = u32RegistryNs(xStart, ZCB_REGISTRY_SCALE_LOOKUPS);
+
+    xStart = xTaskGetTickCount();
+    for (uint32_t n = 0; n < ZCB_REGISTRY_SCALE_LOOKUPS; n++)
+    {
+        if (u16ZCB_NodeDynamicEp(u16RegistryNodeId(n % u16Nodes)) != 0) {
+            u32Found++;
+        }
+    }
+    pu32Ns[E_REGISTRY_OP_JOINED_SHORT] = u32RegistryNs(xStart, ZCB_REGISTRY_SCALE_LOOKUPS);
+
+    xStart = xTaskGetTickCount();
+    for (uint32_t n = 0; n < ZCB_REGISTRY_SCALE_LOOKUPS; n++)
+    {
+        if (FindMatchedNodeByEP(REGISTRY_FIRST_EP + n % u16Nodes) != 0xff) {
+            u32Found++;
+        }
+    }
+    pu32Ns[E_REGISTRY_OP_JOINED_EP] = u32RegistryNs(xStart, ZCB_REGISTRY_SCALE_LOOKUPS);
+
+    /* A node joined already gets its own entry back */
+    xStart = xTaskGetTickCount();
+    for (uint32_t n = 0; n < ZCB_REGISTRY_SCALE_LOOKUPS; n++)
+    {
+        uint16_t i = n % u16Nodes;
+
+        if (u8ZCB_JoinedNodeClaim(u16RegistryNodeId(i), u64RegistryIeeeAddress(i)) < DEV_NUM) {
+            u32Found++;
+        }
+    }
+    pu32Ns[E_REGISTRY_OP_JOINED_IEEE] = u32RegistryNs(xStart, ZCB_REGISTRY_SCALE_LOOKUPS);
+
+    /* The device and its attributes move to a new short address, then back */
+    xStart = xTaskGetTickCount();
+    for (uint32_t n = 0; n < ZCB_REGISTRY_SCALE_CHURN; n++)
+    {
+        uint16_t i = n % u16Nodes;
+
+        if (bZDM_UpdateDeviceNodeId(u64RegistryIeeeAddress(i), REGISTRY_SPARE_NODE_ID, NULL)
+            && bZDM_UpdateDeviceNodeId(u64RegistryIeeeAddress(i), u16RegistryNodeId(i), NULL)) {
+            u32Found++;
+        }
+    }
+    pu32Ns[E_REGISTRY_OP_MOVE] = u32RegistryNs(xStart, 2 * ZCB_REGISTRY_SCALE_CHURN);
+
+    /* The device leaves, its entries go back to the free lists, and joins
+     * again with its endpoints, clusters and attributes */
+    xStart = xTaskGetTickCount();
+    for (uint32_t n = 0; n < ZCB_REGISTRY_SCALE_CHURN; n++)
+    {
+        uint16_t i = n % u16Nodes;
+
+        if (bZDM_EraseDeviceFromDeviceTable(u64RegistryIeeeAddress(i)) && bRegistryAddDevice(i)) {
+            u32Found++;
+        }
+    }
+    pu32Ns[E_REGISTRY_OP_CHURN] = u32RegistryNs(xStart, ZCB_REGISTRY_SCALE_CHURN);
+
+    if (u32Found != 6 * ZCB_REGISTRY_SCALE_LOOKUPS + 2 * ZCB_REGISTRY_SCALE_CHURN) {
+        PRINTF("\n ### Registry scale test: %d operations of %d found their node\n", (int)u32Found,
+               6 * ZCB_REGISTRY_SCALE_LOOKUPS + 2 * ZCB_REGISTRY_SCALE_CHURN);
+    }
+}
+#endif
+
+void vZCB_RegistryBudget(void)
+{
+    tsZbRegistryRam sRam;
+    uint32_t au32Bytes[REGISTRY_TABLES];
+    uint32_t u32Total = 0;
+    static const char *const apcTables[REGISTRY_TABLES] =
+    {
+        "Device table", "Attribute table", "Endpoint records", "Joined nodes",
+        "Liveness wheel", "Command flows", "Sleepy mailboxes", "Attribute map",
+        "Device snapshot", "Node store", "Topology graph", "Discovery sweep"
+    };
+
+    vZDM_GetRegistryRam(&sRam);
+    au32Bytes[0] = sRam.u32Devices;
+    au32Bytes[1] = sRam.u32Attributes;
+    au32Bytes[2] = sRam.u32Records;
+    au32Bytes[3] = u32ZCB_JoinedNodesRam();
+    au32Bytes[4] = u32ZCB_LivenessRam();
+    au32Bytes[5] = u32ZCB_NodeFlowRam();
+    au32Bytes[6] = u32ZCB_MailboxNodeRam();
+    au32Bytes[7] = u32ZCB_AttributeMapRam();
+    au32Bytes[8] = u32ZCB_SnapshotRam();
+    au32Bytes[9] = u32ZCB_NodeStoreRam();
+    au32Bytes[10] = u32ZCB_TopologyRam();
+    au32Bytes[11] = u32ZCB_DiscoveryRam();
+
+    PRINTF("\n ### Registry RAM for %d nodes\n", ZB_BRIDGE_MAX_NODES);
+    for (uint8_t i = 0; i < REGISTRY_TABLES; i++)
+    {
+        PRINTF(" ### %-20s %6d bytes, %4d per node\n", apcTables[i], (int)au32Bytes[i],
+               (int)(au32Bytes[i] / ZB_BRIDGE_MAX_NODES));
+        u32Total += au32Bytes[i];
+    }
+    PRINTF(" ### %-20s %6d bytes, %4d per node\n", "Total", (int)u32Total,
+           (int)(u32Total / ZB_BRIDGE_MAX_NODES));
+    if (u32Total > ZB_BRIDGE_RAM_BUDGET) {
+        PRINTF(" ### Over the budget of %d bytes by %d\n", ZB_BRIDGE_RAM_BUDGET,
+               (int)(u32Total - ZB_BRIDGE_RAM_BUDGET));
+    } else {
+        PRINTF(" ### Budget %d bytes, %d left\n", ZB_BRIDGE_RAM_BUDGET, (int)(ZB_BRIDGE_RAM_BUDGET - u32Total));
+    }
+}
+
+#if ZB_BRIDGE_TEST_COMMANDS
+void vZCB_RegistryScaleTest(void)
+{
+    uint16_t u16Quarter = (MAX_ZD_DEVICE_NUMBERS + 3) / 4;
+    uint32_t au32Quarter[E_REGISTRY_OPS];
+    uint32_t au32Full[E_REGISTRY_OPS];
+    bool bFilled;
+
+    /* An entry in use has a short address */
+    for (uint8_t i = 0; i < MAX_ZD_DEVICE_NUMBERS; i++)
+    {
+        if (tZDM_FindDeviceByIndex(i)->u16NodeId != 0) {
+            PRINTF("\n ### Registry scale test: the bridge has nodes, it only runs on an empty network\n");
+            return;
+        }
+    }
+    if (u8ZCB_JoinedNodeCount() != 0) {
+        PRINTF("\n ### Registry scale test: the bridge has joined nodes, it only runs on an empty network\n");
+        return;
+    }
+
+    bFilled = bRegistryFill(0, u16Quarter, &au32Quarter[E_REGISTRY_OP_JOIN]);
+    if (bFilled) {
+        vRegistryMeasure(u16Quarter, au32Quarter);
+        bFilled = bRegistryFill(u16Quarter, MAX_ZD_DEVICE_NUMBERS, &au32Full[E_REGISTRY_OP_JOIN]);
+    }
+    if (bFilled) {
+        vRegistryMeasure(MAX_ZD_DEVICE_NUMBERS, au32Full);
+
+        PRINTF("\n ### Registry at %d and %d nodes, %d attributes each, ns per operation\n",
+               u16Quarter, MAX_ZD_DEVICE_NUMBERS, (int)REGISTRY_ATTRIBUTES);
+        for (uint8_t i = 0; i < E_REGISTRY_OPS; i++)
+        {
+            PRINTF(" ### %-32s %8d %8d\n", apcRegistryOps[i], (int)au32Quarter[i], (int)au32Full[i]);
+        }
+        vZDM_DeviceIndexDump();
+        vZDM_DeviceFootprint();
+        vZCB_RegistryBudget();
+    }
+
+    vZDM_ClearAllDeviceTables();
+    vZCB_JoinedNodesClear();
+}
+#endif
+
+// ------------------------------------------------------------------
+// END OF FILE
+// ------------------------------------------------------------------
@@ -0,0 +1,58 @@
+/*
+ * Copyright 2021-2023 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef ZCBREGISTRY_H
+#define ZCBREGISTRY_H
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+/****************************************************************************/
+/***        Include files                                                 ***/
+/****************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "ZigbeeConstant.h"
+
+/****************************************************************************/
+/***        Macro Definitions                                             ***/
+/****************************************************************************/
+
+/* Operations timed per measure of vZCB_RegistryScaleTest() */
+#define ZCB_REGISTRY_SCALE_LOOKUPS              100000
+/* Leave and join cycles timed, each one a whole interview's worth of adds */
+#define ZCB_REGISTRY_SCALE_CHURN                2000
+
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+
+/** Print the static RAM each per node table takes at ZB_BRIDGE_MAX_NODES
+ *  nodes, their total and what it leaves of ZB_BRIDGE_RAM_BUDGET */
+void vZCB_RegistryBudget(void);
+
+#if ZB_BRIDGE_TEST_COMMANDS
+/** Fill the registry to ZB_BRIDGE_MAX_NODES synthetic nodes, a quarter
+ *  first then all of them, and print the cost of each lookup, report,
+ *  address change and leave and join at both sizes. Only runs with no
+ *  node in the registry, which is left empty again. */
+void vZCB_RegistryScaleTest(void);
+#endif
+
+#if defined __cplusplus
+}
+#endif
+
+#endif  /* ZCBREGISTRY_H */
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
@@ -0,0 +1,580 @@
+/*
+ * Copyright 2021-2023 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+#include "fsl_debug_console.h"
+
+#include <string.h>
+#include <stdbool.h>
+
+#include "ZigbeeConstant.h"
+#include "SerialLink.h"
+#include "ZigbeeDevices.h"
+#include "cmd.h"
+#include "zcb.h"
+#include "ZcbMessage.h"
+#include "ZcbNodeFlow.h"
+#include "ZcbMailbox.h"
+#include "ZcbAttributeMap.h"
+#include "ZcbResync.h"
+
+/*
+ * Bulk resynchronisation after a coordinator restart.
+ *
+ * Reports sent while the coordinator was down are lost, so every known node
+ * is read back: one read attribute request per node, endpoint and cluster,
+ * covering the bridged attributes of the attribute table. Nodes under a
+ * Matter subscription are read first, then the other bridged nodes, then
+ * the rest for their liveness only. A few requests are kept outstanding at
+ * a time and each node still goes through its flow control window, so the
+ * mesh is never flooded; a request the node window refuses locally is not
+ * counted as an attempt. Nodes whose reads do not fit the read table are
+ * left to a further pass of the same run, taken in device table order, so
+ * the priorities hold within each pass. Values which differ from the ones
+ * last forwarded are gathered and handed to the bridge as one wave once
+ * every node has answered or been given up; a newer report for the same
+ * attribute takes its value out of the wave. Sleepy nodes are not read,
+ * they report on their next wake up anyway.
+ *
+ * Which endpoints are subscribed is asked of the bridge when a run starts.
+ * It answers from the Matter thread with a snapshot, taken in during the
+ * start delay, so the service task never waits on the Matter lock; an
+ * answer not in by then leaves the snapshot of the previous run.
+ */
+
+/* Run, read index and short address of a request, given back on completion */
+#define RESYNC_USER(run, index, addr)   ((void *)(uintptr_t)(((uint32_t)(run) << 24) \
+                                                             | ((uint32_t)(index) << 16) | (addr)))
+
+typedef char acResyncReadsFitUser[(ZCB_RESYNC_MAX_READS <= 0xFF) ? 1 : -1];
+
+typedef enum
+{
+    E_RESYNC_IDLE,
+    E_RESYNC_WAIT_START,
+    E_RESYNC_READING,
+    E_RESYNC_FLUSH,
+} teResyncState;
+
+typedef enum
+{
+    E_RESYNC_READ_TODO,
+    E_RESYNC_READ_IN_FLIGHT,
+    E_RESYNC_READ_DONE,
+    E_RESYNC_READ_FAILED,
+} teResyncReadState;
+
+typedef struct
+{
+    uint16_t    u16ShortAddress;
+    uint16_t    u16ClusterId;
+    uint8_t     u8Endpoint;
+    uint8_t     u8Priority;
+    uint8_t     eState;
+    uint8_t     u8Attempts;
+    uint8_t     u8NumAttr;
+    uint16_t    au16AttrList[ZCB_RESYNC_MAX_ATTR_PER_READ];
+} tsZCB_ResyncRead;
+
+static tsZCB_ResyncRead asReads[ZCB_RESYNC_MAX_READS];
+static uint16_t u16ReadCount;
+static uint16_t u16BuildNext;     /* device index the next pass starts at */
+static ZcbAttributeWave_t sWave;
+
+static SemaphoreHandle_t xResyncMutex = NULL;
+static tsZCB_ResyncStats sStats;
+static tpfZCB_ResyncSubscribed pfSubscribedHook;
+static uint16_t au16Subscribed[ZCB_RESYNC_MAX_SUBSCRIBED];
+static uint16_t u16SubscribedCount;
+static bool bSubscribedAll;
+static teResyncState eState;
+static uint8_t u8Run;
+static TickType_t xStarted;
+static bool bSubscribedDone;
+
+
+static uint32_t u32ResyncElapsedMs(TickType_t xNow)
+{
+    return (uint32_t)((xNow - xStarted) * portTICK_PERIOD_MS);
+}
+
+static tsZCB_ResyncRead *psResyncFindRead(uint16_t u16ShortAddress, uint8_t u8Endpoint, uint16_t u16ClusterId)
+{
+    for (uint16_t i = 0; i < u16ReadCount; i++)
+    {
+        if ((asReads[i].u16ShortAddress == u16ShortAddress)
+            && (asReads[i].u8Endpoint == u8Endpoint)
+            && (asReads[i].u16ClusterId == u16ClusterId)) {
+            return &asReads[i];
+        }
+    }
+    return NULL;
+}
+
+/* Called with the mutex held, decided once per node from the snapshot */
+static uint8_t u8ResyncNodePriority(uint16_t u16ShortAddress)
+{
+    uint16_t u16DynamicEp;
+
+    u16DynamicEp = u16ZCB_NodeDynamicEp(u16ShortAddress);
+    if (u16DynamicEp == 0) {
+        return ZCB_RESYNC_PRIO_OTHER;
+    }
+    if (bSubscribedAll) {
+        return ZCB_RESYNC_PRIO_SUBSCRIBED;
+    }
+    for (uint16_t i = 0; i < u16SubscribedCount; i++)
+    {
+        if (au16Subscribed[i] == u16DynamicEp) {
+            return ZCB_RESYNC_PRIO_SUBSCRIBED;
+        }
+    }
+    return ZCB_RESYNC_PRIO_BRIDGED;
+}
+
+/* Called with the mutex held, when a run starts */
+static void vResyncBegin(void)
+{
+    u16BuildNext   = 0;
+    sWave.u16Count = 0;
+    sStats.u16Nodes = 0;
+    sStats.u16SubscribedNodes = 0;
+    sStats.u16Deltas = 0;
+    sStats.u16Passes = 0;
+    bSubscribedDone = false;
+}
+
+/* Called with the mutex held. Fills the read table with the nodes from
+ * u16BuildNext on; a node whose reads no longer fit is left whole to the
+ * next pass. The tables are walked under the arena lock, a node leaving
+ * on the callback task is erased under it. */
+static void vResyncBuild(void)
+{
+    tsZbDeviceAttribute *psAttribute;
+    tsZbDeviceInfo *psDevice;
+    tsZCB_ResyncRead *psRead;
+    tsZCB_ResyncRead sRead;
+    uint16_t u16NodeReads;
+    uint8_t u8Priority = ZCB_RESYNC_PRIO_OTHER;
+    uint16_t i, j;
+
+    u16ReadCount = 0;
+    sStats.u16Passes++;
+    u8Run++;
+
+    vZDM_ArenaLock();
+    for (; u16BuildNext < MAX_ZD_DEVICE_NUMBERS; u16BuildNext++)
+    {
+        psDevice = tZDM_FindDeviceByIndex((uint8_t)u16BuildNext);
+        if ((psDevice == NULL) || (psDevice->u16NodeId == 0)
+            || ((psDevice->eDeviceState != E_ZB_DEVICE_STATE_ACTIVE)
+                && (psDevice->eDeviceState != E_ZB_DEVICE_STATE_OFF_LINE))
+            || bZCB_MailboxShouldHold(psDevice->u16NodeId)) {
+            continue;
+        }
+
+        u16NodeReads = u16ReadCount;
+        for (psAttribute = tZDM_NextDeviceAttribute(psDevice->u16NodeId, NULL);
+             psAttribute != NULL;
+             psAttribute = tZDM_NextDeviceAttribute(psDevice->u16NodeId, psAttribute))
+        {
+            if (psZCB_AttributeMapFind(psAttribute->u16ClusterId, psAttribute->u16AttributeId) == NULL) {
+                continue;
+            }
+
+            psRead = psResyncFindRead(psAttribute->u16NodeId, psAttribute->u8Endpoint, psAttribute->u16ClusterId);
+            if (psRead == NULL) {
+                if (u16ReadCount >= ZCB_RESYNC_MAX_READS) {
+                    break;
+                }
+                if (u16ReadCount == u16NodeReads) {
+                    u8Priority = u8ResyncNodePriority(psDevice->u16NodeId);
+                }
+                psRead = &asReads[u16ReadCount++];
+                memset(psRead, 0, sizeof(tsZCB_ResyncRead));
+                psRead->u16ShortAddress = psAttribute->u16NodeId;
+                psRead->u16ClusterId    = psAttribute->u16ClusterId;
+                psRead->u8Endpoint      = psAttribute->u8Endpoint;
+                psRead->u8Priority      = u8Priority;
+                psRead->eState          = E_RESYNC_READ_TODO;
+            }
+            if (psRead->u8NumAttr < ZCB_RESYNC_MAX_ATTR_PER_READ) {
+                psRead->au16AttrList[psRead->u8NumAttr++] = psAttribute->u16AttributeId;
+            }
+        }
+
+        if ((psAttribute != NULL) && (u16NodeReads > 0)) {
+            /* The table is full, the node starts the next pass */
+            u16ReadCount = u16NodeReads;
+            break;
+        }
+        /* A node alone over the table size keeps the reads which fit */
+        if (u16ReadCount > u16NodeReads) {
+            sStats.u16Nodes++;
+            if (u8Priority == ZCB_RESYNC_PRIO_SUBSCRIBED) {
+                sStats.u16SubscribedNodes++;
+            }
+        }
+    }
+    vZDM_ArenaUnlock();
+
+    /* Highest priority first, table order kept within a priority */
+    for (i = 1; i < u16ReadCount; i++)
+    {
+        sRead = asReads[i];
+        for (j = i; (j > 0) && (asReads[j - 1].u8Priority < sRead.u8Priority); j--)
+        {
+            asReads[j] = asReads[j - 1];
+        }
+        asReads[j] = sRead;
+    }
+}
+
+/* Called with the mutex held, on the callback task */
+static void vResyncWaveAdd(uint16_t u16ShortAddress, const ZcbAttributeBatch_t *psBatch)
+{
+    uint16_t u16DynamicEp = u16ZCB_NodeDynamicEp(u16ShortAddress);
+    uint16_t j;
+
+    if (u16DynamicEp == 0) {
+        return;
+    }
+
+    for (uint8_t i = 0; i < psBatch->u8Count; i++)
+    {
+        for (j = 0; j < sWave.u16Count; j++)
+        {
+            if ((sWave.asEntries[j].u16DynamicEp == u16DynamicEp)
+                && (sWave.asEntries[j].sAttribute.u32ClusterID == psBatch->asAttributes[i].u32ClusterID)
+                && (sWave.asEntries[j].sAttribute.u32AttributeID == psBatch->asAttributes[i].u32AttributeID)) {
+                break;
+            }
+        }
+        if (j == ZCB_ATTRIBUTE_WAVE_MAX) {
+            /* Not forwarded after all, let the next report through */
+            vZCB_AttributeMapForget(uZDM_FindDevTableIndexByNodeId(u16ShortAddress));
+            sStats.u32WaveOverflows++;
+            continue;
+        }
+        sWave.asEntries[j].u16DynamicEp = u16DynamicEp;
+        sWave.asEntries[j].sAttribute   = psBatch->asAttributes[i];
+        if (j == sWave.u16Count) {
+            sWave.u16Count++;
+        }
+    }
+}
+
+static void vResyncReadDone(void *pvUser, teSL_Status eStatus, uint16_t u16Length, void *pvMessage)
+{
+    uint32_t u32User        = (uint32_t)(uintptr_t)pvUser;
+    uint16_t u16ShortAddress = (uint16_t)u32User;
+    uint8_t u8Index         = (uint8_t)(u32User >> 16);
+    uint8_t u8ReadRun       = (uint8_t)(u32User >> 24);
+    ZcbAttributeBatch_t sBatch;
+    tsZCB_ResyncRead *psRead;
+
+    /* The read attribute response listener runs after this callback and
+     * completes the flow control slot on success; an error status is the
+     * coordinator's, only a missed answer counts against the node */
+    if (eStatus == E_SL_NOMESSAGE) {
+        vZCB_NodeFlowTimeout(u16ShortAddress);
+    } else if (eStatus != E_SL_OK) {
+        vZCB_NodeFlowRelease(u16ShortAddress);
+    }
+
+    xSemaphoreTake(xResyncMutex, portMAX_DELAY);
+    if ((eState != E_RESYNC_READING) || (u8ReadRun != u8Run) || (u8Index >= u16ReadCount)
+        || (asReads[u8Index].eState != E_RESYNC_READ_IN_FLIGHT)) {
+        xSemaphoreGive(xResyncMutex);
+        return;
+    }
+    psRead = &asReads[u8Index];
+
+    if (eStatus == E_SL_OK) {
+        /* Decoded here, once handed over a value counts as forwarded */
+        if (u8ZCB_ReadResponseDeltas(u16Length, pvMessage, &sBatch) > 0) {
+            vResyncWaveAdd(u16ShortAddress, &sBatch);
+        }
+        psRead->eState = E_RESYNC_READ_DONE;
+        sStats.u32Reads++;
+    } else if (psRead->u8Attempts < ZCB_RESYNC_MAX_ATTEMPTS) {
+        psRead->eState = E_RESYNC_READ_TODO;
+    } else {
+        psRead->eState = E_RESYNC_READ_FAILED;
+        sStats.u32ReadFailures++;
+    }
+    xSemaphoreGive(xResyncMutex);
+
+    if (eStatus == E_SL_OK) {
+        vZCB_NodeAlive(u16ShortAddress);
+    }
+}
+
+void vZCB_ResyncInit(void)
+{
+    if (xResyncMutex == NULL) {
+        xResyncMutex = xSemaphoreCreateMutex();
+    }
+    u16ReadCount   = 0;
+    u16BuildNext   = MAX_ZD_DEVICE_NUMBERS;
+    sWave.u16Count = 0;
+    eState         = E_RESYNC_IDLE;
+    u16SubscribedCount = 0;
+    bSubscribedAll     = false;
+    memset(&sStats, 0, sizeof(sStats));
+}
+
+void vZCB_ResyncSetSubscribedHook(tpfZCB_ResyncSubscribed pfSubscribed)
+{
+    pfSubscribedHook = pfSubscribed;
+}
+
+void vZCB_ResyncSetSubscribed(const uint16_t *pu16DynamicEps, uint16_t u16Count, bool bAll)
+{
+    if (xResyncMutex == NULL) {
+        return;
+    }
+    if (u16Count > ZCB_RESYNC_MAX_SUBSCRIBED) {
+        u16Count = ZCB_RESYNC_MAX_SUBSCRIBED;
+    }
+
+    xSemaphoreTake(xResyncMutex, portMAX_DELAY);
+    memcpy(au16Subscribed, pu16DynamicEps, u16Count * sizeof(uint16_t));
+    u16SubscribedCount = u16Count;
+    bSubscribedAll     = bAll;
+    xSemaphoreGive(xResyncMutex);
+}
+
+void vZCB_ResyncStart(void)
+{
+    if (xResyncMutex == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(xResyncMutex, portMAX_DELAY);
+    /* A run in progress is abandoned, its late answers are ignored */
+    eState   = E_RESYNC_WAIT_START;
+    xStarted = xTaskGetTickCount();
+    xSemaphoreGive(xResyncMutex);
+
+    /* Answered from the Matter thread, within the start delay */
+    if (pfSubscribedHook != NULL) {
+        pfSubscribedHook();
+    }
+}
+
+void vZCB_ResyncSuperseded(uint16_t u16ShortAddress, uint32_t u32ClusterID, uint32_t u32AttributeID)
+{
+    uint16_t u16DynamicEp;
+
+    if ((xResyncMutex == NULL) || (eState != E_RESYNC_READING)) {
+        return;
+    }
+
+    u16DynamicEp = u16ZCB_NodeDynamicEp(u16ShortAddress);
+    xSemaphoreTake(xResyncMutex, portMAX_DELAY);
+    for (uint16_t i = 0; i < sWave.u16Count; i++)
+    {
+        if ((sWave.asEntries[i].u16DynamicEp == u16DynamicEp)
+            && (sWave.asEntries[i].sAttribute.u32ClusterID == u32ClusterID)
+            && (sWave.asEntries[i].sAttribute.u32AttributeID == u32AttributeID)) {
+            sWave.asEntries[i] = sWave.asEntries[--sWave.u16Count];
+            sStats.u32Superseded++;
+            break;
+        }
+    }
+    xSemaphoreGive(xResyncMutex);
+}
+
+void vZCB_ResyncPoll(void)
+{
+    tsZCB_ResyncRead asSend[ZCB_RESYNC_IN_FLIGHT];
+    uint8_t au8Index[ZCB_RESYNC_IN_FLIGHT];
+    uint8_t u8Send = 0;
+    uint8_t u8InFlight = 0;
+    uint8_t u8SendRun;
+    uint16_t u16Left = 0;
+    uint16_t u16SubscribedLeft = 0;
+    teZcbStatus eStatus;
+    TickType_t xNow;
+    uint16_t i;
+
+    if (xResyncMutex == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(xResyncMutex, portMAX_DELAY);
+    xNow = xTaskGetTickCount();
+
+    switch (eState)
+    {
+        case E_RESYNC_WAIT_START:
+            /* The wave of the previous run must have been taken first */
+            if ((u32ResyncElapsedMs(xNow) >= ZCB_RESYNC_START_DELAY_MS)
+                && !bZCB_AttributeWavePending(&sWave)) {
+                vResyncBegin();
+                vResyncBuild();
+                eState = E_RESYNC_READING;
+                PRINTF("\n ### Resync of %d node(s), %d subscribed, %d read(s)%s\n",
+                       sStats.u16Nodes, sStats.u16SubscribedNodes, u16ReadCount,
+                       (u16BuildNext < MAX_ZD_DEVICE_NUMBERS) ? ", more to follow" : "");
+            }
+            break;
+
+        case E_RESYNC_READING:
+            if (u32ResyncElapsedMs(xNow) >= ZCB_RESYNC_MAX_DURATION_MS) {
+                for (i = 0; i < u16ReadCount; i++)
+                {
+                    if ((asReads[i].eState == E_RESYNC_READ_TODO)
+                        || (asReads[i].eState == E_RESYNC_READ_IN_FLIGHT)) {
+                        asReads[i].eState = E_RESYNC_READ_FAILED;
+                        sStats.u32ReadFailures++;
+                    }
+                }
+            }
+
+            for (i = 0; i < u16ReadCount; i++)
+            {
+                if (asReads[i].eState == E_RESYNC_READ_IN_FLIGHT) {
+                    u8InFlight++;
+                }
+            }
+
+            for (i = 0; i < u16ReadCount; i++)
+            {
+                if ((asReads[i].eState == E_RESYNC_READ_TODO)
+                    && ((u8InFlight + u8Send) < ZCB_RESYNC_IN_FLIGHT)) {
+                    asReads[i].eState = E_RESYNC_READ_IN_FLIGHT;
+                    if (asReads[i].u8Attempts++ > 0) {
+                        sStats.u32ReadRetries++;
+                    }
+                    au8Index[u8Send] = (uint8_t)i;
+                    asSend[u8Send++] = asReads[i];
+                }
+                if ((asReads[i].eState == E_RESYNC_READ_TODO)
+                    || (asReads[i].eState == E_RESYNC_READ_IN_FLIGHT)) {
+                    u16Left++;
+                    if (asReads[i].u8Priority == ZCB_RESYNC_PRIO_SUBSCRIBED) {
+                        u16SubscribedLeft++;
+                    }
+                }
+            }
+
+            if ((u16SubscribedLeft == 0) && !bSubscribedDone
+                && (u16BuildNext >= MAX_ZD_DEVICE_NUMBERS)) {
+                bSubscribedDone = true;
+                sStats.u32LastSubscribedMs = u32ResyncElapsedMs(xNow);
+            }
+            if (u16Left == 0) {
+                if ((u16BuildNext < MAX_ZD_DEVICE_NUMBERS)
+                    && (u32ResyncElapsedMs(xNow) < ZCB_RESYNC_MAX_DURATION_MS)) {
+                    /* Nodes left over by the last pass, read on the next tick */
+                    vResyncBuild();
+                    PRINTF("\n ### Resync pass %d, %d node(s) so far, %d read(s)\n",
+                           sStats.u16Passes, sStats.u16Nodes, u16ReadCount);
+                } else {
+                    eState = E_RESYNC_FLUSH;
+                }
+            }
+            break;
+
+        case E_RESYNC_FLUSH:
+            /* Retried every tick until the bridge is free */
+            if ((sWave.u16Count == 0) || (eZCB_SendAttributeWave(&sWave) == E_ZCB_OK)) {
+                sStats.u16Deltas = sWave.u16Count;
+                sStats.u32LastDurationMs = u32ResyncElapsedMs(xNow);
+                sStats.u32Runs++;
+                eState = E_RESYNC_IDLE;
+                PRINTF("\n ### Resync done in %dms, %d value(s) changed, %d read(s) failed\n",
+                       sStats.u32LastDurationMs, sStats.u16Deltas, sStats.u32ReadFailures);
+            }
+            break;
+
+        default:
+            break;
+    }
+    u8SendRun = u8Run;
+    xSemaphoreGive(xResyncMutex);
+
+    /* Sent without the mutex, a completion may run before the call returns */
+    for (i = 0; i < u8Send; i++)
+    {
+        eStatus = eReadAttributeRequestAsync(asSend[i].u16ShortAddress,
+                                             ZB_ENDPOINT_ATTR,
+                                             asSend[i].u8Endpoint,
+                                             asSend[i].u16ClusterId,
+                                             asSend[i].u8NumAttr,
+                                             asSend[i].au16AttrList,
+                                             vResyncReadDone,
+                                             RESYNC_USER(u8SendRun, au8Index[i], asSend[i].u16ShortAddress));
+        if (eStatus == E_ZCB_OK) {
+            continue;
+        }
+
+        /* Tried again on a later tick */
+        xSemaphoreTake(xResyncMutex, portMAX_DELAY);
+        if ((u8SendRun == u8Run) && (asReads[au8Index[i]].eState == E_RESYNC_READ_IN_FLIGHT)) {
+            if (eStatus == E_ZCB_REQUEST_NOT_ACTIONED) {
+                /* Node window busy or backing off: nothing went out, so no attempt */
+                if (--asReads[au8Index[i]].u8Attempts > 0) {
+                    sStats.u32ReadRetries--;
+                }
+                asReads[au8Index[i]].eState = E_RESYNC_READ_TODO;
+                sStats.u32Refused++;
+            } else if (asReads[au8Index[i]].u8Attempts < ZCB_RESYNC_MAX_ATTEMPTS) {
+                asReads[au8Index[i]].eState = E_RESYNC_READ_TODO;
+            } else {
+                asReads[au8Index[i]].eState = E_RESYNC_READ_FAILED;
+                sStats.u32ReadFailures++;
+            }
+        }
+        xSemaphoreGive(xResyncMutex);
+    }
+}
+
+void vZCB_ResyncDump(void)
+{
+    static const char *apcState[] = { "todo", "in flight", "done", "failed" };
+    static const char *apcResync[] = { "idle", "starting", "reading", "flushing" };
+
+    if (xResyncMutex == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(xResyncMutex, portMAX_DELAY);
+    PRINTF("\n ### Resync %s, %d node(s), %d subscribed, %d read(s), %d value(s) in the wave",
+           apcResync[eState], sStats.u16Nodes, sStats.u16SubscribedNodes, u16ReadCount, sWave.u16Count);
+    for (uint16_t i = 0; i < u16ReadCount; i++)
+    {
+        PRINTF("\n ### 0x%04x ep %d cluster 0x%04x prio %d %s attempts=%d",
+               asReads[i].u16ShortAddress, asReads[i].u8Endpoint, asReads[i].u16ClusterId,
+               asReads[i].u8Priority, apcState[asReads[i].eState], asReads[i].u8Attempts);
+    }
+    PRINTF("\n ### runs=%d passes=%d reads=%d retries=%d refused=%d failures=%d superseded=%d overflows=%d last=%dms subscribed=%dms\n",
+           sStats.u32Runs, sStats.u16Passes, sStats.u32Reads, sStats.u32ReadRetries, sStats.u32Refused,
+           sStats.u32ReadFailures, sStats.u32Superseded, sStats.u32WaveOverflows, sStats.u32LastDurationMs,
+           sStats.u32LastSubscribedMs);
+    xSemaphoreGive(xResyncMutex);
+}
+
+void vZCB_ResyncGetStats(tsZCB_ResyncStats *psStats)
+{
+    if ((psStats == NULL) || (xResyncMutex == NULL)) {
+        return;
+    }
+
+    xSemaphoreTake(xResyncMutex, portMAX_DELAY);
+    *psStats = sStats;
+    xSemaphoreGive(xResyncMutex);
+}
+
+// ------------------------------------------------------------------
+// END OF FILE
+// ------------------------------------------------------------------
@@ -0,0 +1,114 @@
+/*
+ * Copyright 2021-2023 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef ZCBRESYNC_H
+#define ZCBRESYNC_H
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+/****************************************************************************/
+/***        Include files                                                 ***/
+/****************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "zcb.h"
+
+/****************************************************************************/
+/***        Macro Definitions                                             ***/
+/****************************************************************************/
+
+/* Time given to the coordinator to settle after its restart message */
+#define ZCB_RESYNC_START_DELAY_MS               2000
+/* Read attribute requests outstanding at a time, over all nodes */
+#define ZCB_RESYNC_IN_FLIGHT                    4
+/* Read attribute requests, one per node, endpoint and cluster, in one pass.
+ * Deliberately not sized from ZB_BRIDGE_MAX_NODES: the index of a read is a
+ * byte of its request handle, and the nodes which do not fit are read by
+ * further passes of the same resync */
+#define ZCB_RESYNC_MAX_READS                    128
+/* Bridged attributes read in one request */
+#define ZCB_RESYNC_MAX_ATTR_PER_READ            4
+/* Requests sent for one read before it is given up */
+#define ZCB_RESYNC_MAX_ATTEMPTS                 2
+/* Reads still not answered by then are given up and the wave sent */
+#define ZCB_RESYNC_MAX_DURATION_MS              (60 * 1000)
+
+/* Dynamic endpoints of the subscription snapshot */
+#define ZCB_RESYNC_MAX_SUBSCRIBED               ZB_BRIDGE_MAX_NODES
+
+/* Read priority, highest first */
+#define ZCB_RESYNC_PRIO_OTHER                   0   /* not bridged to Matter */
+#define ZCB_RESYNC_PRIO_BRIDGED                 1   /* has a dynamic endpoint */
+#define ZCB_RESYNC_PRIO_SUBSCRIBED              2   /* a Matter subscription covers it */
+
+
+/****************************************************************************/
+/***        Type Definitions                                              ***/
+/****************************************************************************/
+
+/** Asks the bridge for the dynamic endpoints under a Matter subscription,
+ *  given back from its own thread with vZCB_ResyncSetSubscribed() */
+typedef void (*tpfZCB_ResyncSubscribed)(void);
+
+typedef struct
+{
+    uint32_t u32Runs;             /**< Resyncs completed */
+    uint32_t u32Reads;            /**< Read attribute requests answered */
+    uint32_t u32ReadRetries;      /**< Requests sent again */
+    uint32_t u32Refused;          /**< Requests held back by the node window, no attempt */
+    uint32_t u32ReadFailures;     /**< Reads given up */
+    uint32_t u32Superseded;       /**< Values dropped, a newer report went first */
+    uint32_t u32WaveOverflows;    /**< Values dropped, the wave was full */
+    uint16_t u16Nodes;            /**< Nodes read in the last resync */
+    uint16_t u16SubscribedNodes;  /**< ... of which with a Matter subscription */
+    uint16_t u16Deltas;           /**< Values changed in the last wave */
+    uint16_t u16Passes;           /**< Fillings of the read table in the last resync */
+    uint32_t u32LastDurationMs;   /**< Restart to wave handed to the bridge */
+    uint32_t u32LastSubscribedMs; /**< Restart to subscribed nodes all read */
+} tsZCB_ResyncStats;
+
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+
+void vZCB_ResyncInit(void);
+
+/** Called when a run starts, NULL to order by endpoint only */
+void vZCB_ResyncSetSubscribedHook(tpfZCB_ResyncSubscribed pfSubscribed);
+
+/** Snapshot of the subscribed dynamic endpoints, bAll when a subscription
+ *  covers every endpoint. Takes no lock of the Matter stack. */
+void vZCB_ResyncSetSubscribed(const uint16_t *pu16DynamicEps, uint16_t u16Count, bool bAll);
+
+/** Re-read every known node, after a coordinator restart or on request */
+void vZCB_ResyncStart(void);
+
+/** Drop a value a newer report has already sent to the bridge */
+void vZCB_ResyncSuperseded(uint16_t u16ShortAddress, uint32_t u32ClusterID, uint32_t u32AttributeID);
+
+/** Called from the ZCB service task */
+void vZCB_ResyncPoll(void);
+
+/** Print the progress of the current or last resync */
+void vZCB_ResyncDump(void);
+
+void vZCB_ResyncGetStats(tsZCB_ResyncStats *psStats);
+
+#if defined __cplusplus
+}
+#endif
+
+#endif  /* ZCBRESYNC_H */
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
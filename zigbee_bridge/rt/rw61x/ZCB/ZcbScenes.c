@@ -0,0 +1,582 @@
+/*
+ * Copyright 2021-2023 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+#include "fsl_debug_console.h"
+
+#include <string.h>
+#include <stdbool.h>
+
+#include "ZigbeeConstant.h"
+#include "ZigbeeDevices.h"
+#include "ZcbAddrCache.h"
+#include "ZcbSnapshot.h"
+#include "ZcbScenes.h"
+
+#include "ram_storage.h"
+
+/*
+ * Zigbee scenes behind the Matter Scenes Management cluster.
+ *
+ * The scene content lives on the Zigbee nodes themselves: a store makes the
+ * node join the Zigbee group of the scene and save its own On/Off, level and
+ * colour state. The bridge only keeps which nodes stored which scene, by IEEE
+ * address so that a new short address does not lose them, and writes that
+ * table to flash on every change. A recall sent to a Matter group is then one
+ * group-cast Recall Scene frame, however many bridged endpoints are in the
+ * group, instead of a command set per node; a recall sent to one endpoint
+ * stays a unicast to its node.
+ *
+ * The Matter Groups cluster of a bridged endpoint maps onto the Zigbee group
+ * of the same ID on its node. Leaving a Zigbee group removes the node's scenes
+ * of that group, so the table drops them as well.
+ */
+
+#define ZCB_SCENES_MAGIC        0x5A534331  /* "ZSC1" */
+
+typedef struct
+{
+    uint16_t    u16GroupId;
+    uint8_t     u8SceneId;
+    uint8_t     u8MemberCount;          /* 0 when the entry is free */
+    uint64_t    au64Members[ZCB_SCENES_MAX_MEMBERS];
+} tsZCB_Scene;
+
+typedef struct
+{
+    uint32_t    u32Magic;
+    tsZCB_Scene asScenes[ZCB_SCENES_MAX];
+} tsZCB_ScenesTable;
+
+static tsZCB_ScenesTable sTable;
+static tsZCB_ScenesStats sStats;
+static SemaphoreHandle_t xScenesMutex = NULL;
+
+/* Last group recall sent, the fan-out of one Matter group command is merged */
+static uint16_t u16LastRecallGroup;
+static uint8_t u8LastRecallScene;
+static TickType_t xLastRecallStamp;
+static bool bLastRecallValid;
+
+
+static tsZCB_Scene *psScenesFind(uint16_t u16GroupId, uint8_t u8SceneId)
+{
+    for (uint8_t i = 0; i < ZCB_SCENES_MAX; i++)
+    {
+        if ((sTable.asScenes[i].u8MemberCount != 0)
+            && (sTable.asScenes[i].u16GroupId == u16GroupId)
+            && (sTable.asScenes[i].u8SceneId == u8SceneId)) {
+            return &sTable.asScenes[i];
+        }
+    }
+    return NULL;
+}
+
+static tsZCB_Scene *psScenesAlloc(uint16_t u16GroupId, uint8_t u8SceneId)
+{
+    for (uint8_t i = 0; i < ZCB_SCENES_MAX; i++)
+    {
+        if (sTable.asScenes[i].u8MemberCount == 0) {
+            memset(&sTable.asScenes[i], 0, sizeof(sTable.asScenes[i]));
+            sTable.asScenes[i].u16GroupId = u16GroupId;
+            sTable.asScenes[i].u8SceneId  = u8SceneId;
+            return &sTable.asScenes[i];
+        }
+    }
+    return NULL;
+}
+
+static bool bScenesHasFree(void)
+{
+    for (uint8_t i = 0; i < ZCB_SCENES_MAX; i++)
+    {
+        if (sTable.asScenes[i].u8MemberCount == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static int8_t i8ScenesMemberIndex(const tsZCB_Scene *psScene, uint64_t u64IeeeAddress)
+{
+    for (uint8_t i = 0; i < psScene->u8MemberCount; i++)
+    {
+        if (psScene->au64Members[i] == u64IeeeAddress) {
+            return (int8_t)i;
+        }
+    }
+    return -1;
+}
+
+/* True when the node stored any scene of the group, so it is in the group */
+static bool bScenesInGroup(uint16_t u16GroupId, uint64_t u64IeeeAddress)
+{
+    for (uint8_t i = 0; i < ZCB_SCENES_MAX; i++)
+    {
+        if ((sTable.asScenes[i].u8MemberCount != 0)
+            && (sTable.asScenes[i].u16GroupId == u16GroupId)
+            && (i8ScenesMemberIndex(&sTable.asScenes[i], u64IeeeAddress) >= 0)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Returns true when the node was a member */
+static bool bScenesDropMember(tsZCB_Scene *psScene, uint64_t u64IeeeAddress)
+{
+    int8_t i8Index = i8ScenesMemberIndex(psScene, u64IeeeAddress);
+
+    if (i8Index < 0) {
+        return false;
+    }
+    psScene->u8MemberCount--;
+    psScene->au64Members[i8Index] = psScene->au64Members[psScene->u8MemberCount];
+    psScene->au64Members[psScene->u8MemberCount] = 0;
+    return true;
+}
+
+/* Called with the mutex held */
+static void vScenesSave(void)
+{
+    sTable.u32Magic = ZCB_SCENES_MAGIC;
+    if (!ramStorageSavetoFlash(ZCB_SCENES_FILE, (uint8_t *)&sTable, sizeof(sTable))) {
+        sStats.u32SaveFailures++;
+        PRINTF("\n ### Scene table not saved\n");
+    }
+}
+
+/* Called from the Matter and shell tasks, the node comes from the snapshot */
+static bool bScenesNodeIeee(uint16_t u16ShortAddress, uint64_t *pu64IeeeAddress)
+{
+    tsZCB_SnapshotNode sNode;
+
+    if (bZCB_SnapshotNodeByShort(u16ShortAddress, &sNode) && (sNode.u64IeeeAddress != 0)) {
+        *pu64IeeeAddress = sNode.u64IeeeAddress;
+        return true;
+    }
+    return bZCB_AddrCacheGetIeee(u16ShortAddress, pu64IeeeAddress);
+}
+
+/* A node whose clusters were not read by this bridge is let through, it answers for itself */
+static bool bScenesCapable(uint16_t u16ShortAddress)
+{
+    tsZbDeviceEndPoint *psEndpoint;
+    bool bCapable;
+
+    vZDM_ArenaLock();
+    psEndpoint = tZDM_FindEndpointEntryInDeviceTable(u16ShortAddress, ZB_ENDPOINT_SCENE);
+    bCapable   = (psEndpoint == NULL) || (psEndpoint->u8ClusterCount == 0);
+    for (uint8_t i = 0; !bCapable && (i < psEndpoint->u8ClusterCount); i++)
+    {
+        bCapable = (tZDM_FindClusterByIndex(psEndpoint, i)->u16ClusterId == E_ZB_CLUSTERID_SCENES);
+    }
+    vZDM_ArenaUnlock();
+    return bCapable;
+}
+
+void vZCB_ScenesInit(void)
+{
+    memset(&sStats, 0, sizeof(sStats));
+    bLastRecallValid = false;
+
+    if (xScenesMutex == NULL) {
+        xScenesMutex = xSemaphoreCreateMutex();
+    }
+
+    memset(&sTable, 0, sizeof(sTable));
+    if (!ramStorageReadFromFlash(ZCB_SCENES_FILE, (uint8_t *)&sTable, sizeof(sTable))
+        || (sTable.u32Magic != ZCB_SCENES_MAGIC)) {
+        memset(&sTable, 0, sizeof(sTable));
+        return;
+    }
+
+    for (uint8_t i = 0; i < ZCB_SCENES_MAX; i++)
+    {
+        if (sTable.asScenes[i].u8MemberCount > ZCB_SCENES_MAX_MEMBERS) {
+            memset(&sTable.asScenes[i], 0, sizeof(sTable.asScenes[i]));
+        }
+    }
+}
+
+teZcbStatus eZCB_SceneStore(uint16_t u16ShortAddress, uint16_t u16GroupId, uint8_t u8SceneId)
+{
+    tsZCB_Scene *psScene;
+    uint64_t u64IeeeAddress;
+    bool bJoinGroup;
+    teZcbStatus eStatus;
+
+    if (xScenesMutex == NULL) {
+        return E_ZCB_ERROR;
+    }
+    if (!bScenesNodeIeee(u16ShortAddress, &u64IeeeAddress)) {
+        return E_ZCB_UNKNOWN_NODE;
+    }
+
+    xSemaphoreTake(xScenesMutex, portMAX_DELAY);
+    if (!bScenesCapable(u16ShortAddress)) {
+        sStats.u32NotCapable++;
+        xSemaphoreGive(xScenesMutex);
+        return E_ZCB_UNKNOWN_CLUSTER;
+    }
+    psScene = psScenesFind(u16GroupId, u8SceneId);
+    if (((psScene == NULL) && !bScenesHasFree())
+        || ((psScene != NULL) && (i8ScenesMemberIndex(psScene, u64IeeeAddress) < 0)
+            && (psScene->u8MemberCount == ZCB_SCENES_MAX_MEMBERS))) {
+        sStats.u32TableFull++;
+        xSemaphoreGive(xScenesMutex);
+        return E_ZCB_INSUFFICIENT_SPACE;
+    }
+    /* Group 0 is the "no group" of the Scenes cluster, it needs no membership */
+    bJoinGroup = (u16GroupId != 0) && !bScenesInGroup(u16GroupId, u64IeeeAddress);
+    xSemaphoreGive(xScenesMutex);
+
+    if (bJoinGroup) {
+        eStatus = eGroupAdd(E_ZB_ADDRESS_MODE_SHORT, u16ShortAddress, u16GroupId);
+        if (eStatus != E_ZCB_OK) {
+            return eStatus;
+        }
+    }
+
+    eStatus = eSceneStore(E_ZB_ADDRESS_MODE_SHORT, u16ShortAddress, u16GroupId, u8SceneId);
+    if (eStatus != E_ZCB_OK) {
+        return eStatus;
+    }
+
+    xSemaphoreTake(xScenesMutex, portMAX_DELAY);
+    if (bJoinGroup) {
+        sStats.u32GroupAdds++;
+    }
+    sStats.u32Stored++;
+    psScene = psScenesFind(u16GroupId, u8SceneId);
+    if (psScene == NULL) {
+        psScene = psScenesAlloc(u16GroupId, u8SceneId);
+    }
+    if (psScene == NULL) {
+        sStats.u32TableFull++;
+    } else if (i8ScenesMemberIndex(psScene, u64IeeeAddress) < 0) {
+        if (psScene->u8MemberCount < ZCB_SCENES_MAX_MEMBERS) {
+            psScene->au64Members[psScene->u8MemberCount++] = u64IeeeAddress;
+            vScenesSave();
+        } else {
+            sStats.u32TableFull++;
+        }
+    }
+    xSemaphoreGive(xScenesMutex);
+
+    return E_ZCB_OK;
+}
+
+teZcbStatus eZCB_SceneRecall(uint16_t u16GroupId, uint8_t u8SceneId)
+{
+    TickType_t xNow = xTaskGetTickCount();
+    teZcbStatus eStatus;
+
+    if (xScenesMutex == NULL) {
+        return E_ZCB_ERROR;
+    }
+    if (u16GroupId == 0) {
+        return E_ZCB_INVALID_FIELD;
+    }
+
+    xSemaphoreTake(xScenesMutex, portMAX_DELAY);
+    if (psScenesFind(u16GroupId, u8SceneId) == NULL) {
+        xSemaphoreGive(xScenesMutex);
+        return E_ZCB_NOT_FOUND;
+    }
+    if (bLastRecallValid
+        && (u16LastRecallGroup == u16GroupId)
+        && (u8LastRecallScene == u8SceneId)
+        && ((xNow - xLastRecallStamp) < pdMS_TO_TICKS(ZCB_SCENES_RECALL_MERGE_MS))) {
+        sStats.u32MergedRecalls++;
+        xSemaphoreGive(xScenesMutex);
+        return E_ZCB_OK;
+    }
+    u16LastRecallGroup = u16GroupId;
+    u8LastRecallScene  = u8SceneId;
+    xLastRecallStamp   = xNow;
+    bLastRecallValid   = true;
+    sStats.u32GroupRecalls++;
+    xSemaphoreGive(xScenesMutex);
+
+    eStatus = eSceneRecall(E_ZB_ADDRESS_MODE_GROUP, u16GroupId, u16GroupId, u8SceneId);
+    if (eStatus != E_ZCB_OK) {
+        /* Let the next endpoint of the fan-out try again */
+        xSemaphoreTake(xScenesMutex, portMAX_DELAY);
+        bLastRecallValid = false;
+        xSemaphoreGive(xScenesMutex);
+    }
+    return eStatus;
+}
+
+teZcbStatus eZCB_SceneRecallNode(uint16_t u16ShortAddress, uint16_t u16GroupId, uint8_t u8SceneId)
+{
+    teZcbStatus eStatus;
+
+    if (xScenesMutex == NULL) {
+        return E_ZCB_ERROR;
+    }
+
+    eStatus = eSceneRecall(E_ZB_ADDRESS_MODE_SHORT, u16ShortAddress, u16GroupId, u8SceneId);
+    if (eStatus == E_ZCB_OK) {
+        xSemaphoreTake(xScenesMutex, portMAX_DELAY);
+        sStats.u32NodeRecalls++;
+        xSemaphoreGive(xScenesMutex);
+    }
+    return eStatus;
+}
+
+teZcbStatus eZCB_SceneRemove(uint16_t u16ShortAddress, uint16_t u16GroupId, uint8_t u8SceneId)
+{
+    tsZCB_Scene *psScene;
+    uint64_t u64IeeeAddress;
+    teZcbStatus eStatus;
+
+    if (xScenesMutex == NULL) {
+        return E_ZCB_ERROR;
+    }
+
+    eStatus = eSceneRemove(E_ZB_ADDRESS_MODE_SHORT, u16ShortAddress, u16GroupId, u8SceneId);
+    if (eStatus != E_ZCB_OK) {
+        return eStatus;
+    }
+
+    xSemaphoreTake(xScenesMutex, portMAX_DELAY);
+    sStats.u32Removed++;
+    psScene = psScenesFind(u16GroupId, u8SceneId);
+    if ((psScene != NULL)
+        && bScenesNodeIeee(u16ShortAddress, &u64IeeeAddress)
+        && bScenesDropMember(psScene, u64IeeeAddress)) {
+        vScenesSave();
+    }
+    xSemaphoreGive(xScenesMutex);
+
+    return E_ZCB_OK;
+}
+
+teZcbStatus eZCB_SceneRemoveAll(uint16_t u16ShortAddress, uint16_t u16GroupId)
+{
+    uint64_t u64IeeeAddress;
+    bool bChanged = false;
+    teZcbStatus eStatus;
+
+    if (xScenesMutex == NULL) {
+        return E_ZCB_ERROR;
+    }
+
+    eStatus = eSceneRemoveAll(E_ZB_ADDRESS_MODE_SHORT, u16ShortAddress, u16GroupId);
+    if (eStatus != E_ZCB_OK) {
+        return eStatus;
+    }
+
+    xSemaphoreTake(xScenesMutex, portMAX_DELAY);
+    sStats.u32Removed++;
+    if (bScenesNodeIeee(u16ShortAddress, &u64IeeeAddress)) {
+        for (uint8_t i = 0; i < ZCB_SCENES_MAX; i++)
+        {
+            if ((sTable.asScenes[i].u8MemberCount != 0)
+                && (sTable.asScenes[i].u16GroupId == u16GroupId)) {
+                bChanged |= bScenesDropMember(&sTable.asScenes[i], u64IeeeAddress);
+            }
+        }
+    }
+    if (bChanged) {
+        vScenesSave();
+    }
+    xSemaphoreGive(xScenesMutex);
+
+    return E_ZCB_OK;
+}
+
+uint8_t u8ZCB_SceneMembership(uint16_t u16ShortAddress,
+                              uint16_t u16GroupId,
+                              uint8_t *pu8SceneIds,
+                              uint8_t u8MaxScenes)
+{
+    uint64_t u64IeeeAddress;
+    uint8_t u8Count = 0;
+
+    if ((xScenesMutex == NULL) || !bScenesNodeIeee(u16ShortAddress, &u64IeeeAddress)) {
+        return 0;
+    }
+
+    xSemaphoreTake(xScenesMutex, portMAX_DELAY);
+    for (uint8_t i = 0; (i < ZCB_SCENES_MAX) && (u8Count < u8MaxScenes); i++)
+    {
+        if ((sTable.asScenes[i].u8MemberCount != 0)
+            && (sTable.asScenes[i].u16GroupId == u16GroupId)
+            && (i8ScenesMemberIndex(&sTable.asScenes[i], u64IeeeAddress) >= 0)) {
+            pu8SceneIds[u8Count++] = sTable.asScenes[i].u8SceneId;
+        }
+    }
+    xSemaphoreGive(xScenesMutex);
+
+    return u8Count;
+}
+
+uint8_t u8ZCB_ScenesNodeCount(uint16_t u16ShortAddress)
+{
+    uint64_t u64IeeeAddress;
+    uint8_t u8Count = 0;
+
+    if ((xScenesMutex == NULL) || !bScenesNodeIeee(u16ShortAddress, &u64IeeeAddress)) {
+        return 0;
+    }
+
+    xSemaphoreTake(xScenesMutex, portMAX_DELAY);
+    for (uint8_t i = 0; i < ZCB_SCENES_MAX; i++)
+    {
+        if ((sTable.asScenes[i].u8MemberCount != 0)
+            && (i8ScenesMemberIndex(&sTable.asScenes[i], u64IeeeAddress) >= 0)) {
+            u8Count++;
+        }
+    }
+    xSemaphoreGive(xScenesMutex);
+
+    return u8Count;
+}
+
+uint8_t u8ZCB_ScenesFree(void)
+{
+    uint8_t u8Count = 0;
+
+    if (xScenesMutex == NULL) {
+        return 0;
+    }
+
+    xSemaphoreTake(xScenesMutex, portMAX_DELAY);
+    for (uint8_t i = 0; i < ZCB_SCENES_MAX; i++)
+    {
+        if (sTable.asScenes[i].u8MemberCount == 0) {
+            u8Count++;
+        }
+    }
+    xSemaphoreGive(xScenesMutex);
+
+    return u8Count;
+}
+
+teZcbStatus eZCB_GroupAdd(uint16_t u16ShortAddress, uint16_t u16GroupId)
+{
+    teZcbStatus eStatus;
+
+    if (xScenesMutex == NULL) {
+        return E_ZCB_ERROR;
+    }
+
+    eStatus = eGroupAdd(E_ZB_ADDRESS_MODE_SHORT, u16ShortAddress, u16GroupId);
+    if (eStatus == E_ZCB_OK) {
+        xSemaphoreTake(xScenesMutex, portMAX_DELAY);
+        sStats.u32GroupCommands++;
+        xSemaphoreGive(xScenesMutex);
+    }
+    return eStatus;
+}
+
+teZcbStatus eZCB_GroupRemove(uint16_t u16ShortAddress, uint16_t u16GroupId)
+{
+    uint64_t u64IeeeAddress;
+    bool bChanged = false;
+    teZcbStatus eStatus;
+
+    if (xScenesMutex == NULL) {
+        return E_ZCB_ERROR;
+    }
+    if (u16GroupId == 0) {
+        return E_ZCB_INVALID_FIELD;
+    }
+
+    eStatus = eGroupRemove(E_ZB_ADDRESS_MODE_SHORT, u16ShortAddress, u16GroupId);
+    if (eStatus != E_ZCB_OK) {
+        return eStatus;
+    }
+
+    xSemaphoreTake(xScenesMutex, portMAX_DELAY);
+    sStats.u32GroupCommands++;
+    if (bScenesNodeIeee(u16ShortAddress, &u64IeeeAddress)) {
+        for (uint8_t i = 0; i < ZCB_SCENES_MAX; i++)
+        {
+            if ((sTable.asScenes[i].u8MemberCount != 0)
+                && (sTable.asScenes[i].u16GroupId == u16GroupId)) {
+                bChanged |= bScenesDropMember(&sTable.asScenes[i], u64IeeeAddress);
+            }
+        }
+    }
+    if (bChanged) {
+        vScenesSave();
+    }
+    xSemaphoreGive(xScenesMutex);
+
+    return E_ZCB_OK;
+}
+
+void vZCB_ScenesForget(uint64_t u64IeeeAddress)
+{
+    bool bChanged = false;
+
+    if (xScenesMutex == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(xScenesMutex, portMAX_DELAY);
+    for (uint8_t i = 0; i < ZCB_SCENES_MAX; i++)
+    {
+        if (sTable.asScenes[i].u8MemberCount != 0) {
+            bChanged |= bScenesDropMember(&sTable.asScenes[i], u64IeeeAddress);
+        }
+    }
+    if (bChanged) {
+        vScenesSave();
+    }
+    xSemaphoreGive(xScenesMutex);
+}
+
+void vZCB_ScenesDump(void)
+{
+    if (xScenesMutex == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(xScenesMutex, portMAX_DELAY);
+    for (uint8_t i = 0; i < ZCB_SCENES_MAX; i++)
+    {
+        const tsZCB_Scene *psScene = &sTable.asScenes[i];
+
+        if (psScene->u8MemberCount == 0) {
+            continue;
+        }
+        PRINTF("\n ### group=0x%04x scene=%d members=%d:", psScene->u16GroupId, psScene->u8SceneId,
+               psScene->u8MemberCount);
+        for (uint8_t j = 0; j < psScene->u8MemberCount; j++)
+        {
+            PRINTF(" 0x%016llx", psScene->au64Members[j]);
+        }
+    }
+    PRINTF("\n ### stored=%d groupadds=%d groupcmds=%d grouprecalls=%d merged=%d noderecalls=%d removed=%d full=%d notcapable=%d savefail=%d\n",
+           sStats.u32Stored, sStats.u32GroupAdds, sStats.u32GroupCommands, sStats.u32GroupRecalls,
+           sStats.u32MergedRecalls, sStats.u32NodeRecalls, sStats.u32Removed, sStats.u32TableFull,
+           sStats.u32NotCapable, sStats.u32SaveFailures);
+    xSemaphoreGive(xScenesMutex);
+}
+
+void vZCB_ScenesGetStats(tsZCB_ScenesStats *psStats)
+{
+    if ((psStats == NULL) || (xScenesMutex == NULL)) {
+        return;
+    }
+
+    xSemaphoreTake(xScenesMutex, portMAX_DELAY);
+    *psStats = sStats;
+    xSemaphoreGive(xScenesMutex);
+}
+
+// ------------------------------------------------------------------
+// END OF FILE
+// ------------------------------------------------------------------
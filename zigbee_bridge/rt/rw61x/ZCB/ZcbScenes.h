@@ -0,0 +1,116 @@
+/*
+ * Copyright 2021-2023 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef ZCBSCENES_H
+#define ZCBSCENES_H
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+/****************************************************************************/
+/***        Include files                                                 ***/
+/****************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "zcb.h"
+
+/****************************************************************************/
+/***        Macro Definitions                                             ***/
+/****************************************************************************/
+
+/* Scenes kept by the bridge, over all groups */
+#define ZCB_SCENES_MAX                          16
+/* Nodes storing one scene */
+#define ZCB_SCENES_MAX_MEMBERS                  8
+/* A Matter group command reaches the bridge once per endpoint in the group;
+ * recalls of the same scene within this time go out as one Zigbee frame */
+#define ZCB_SCENES_RECALL_MERGE_MS              300
+/* Flash record of the scene table */
+#define ZCB_SCENES_FILE                         "ZBScenes"
+
+
+/****************************************************************************/
+/***        Type Definitions                                              ***/
+/****************************************************************************/
+
+typedef struct
+{
+    uint32_t u32Stored;           /**< Store Scene sent to a node */
+    uint32_t u32GroupAdds;        /**< Add Group sent ahead of a store */
+    uint32_t u32GroupCommands;    /**< Add/Remove Group sent for the Matter Groups cluster */
+    uint32_t u32GroupRecalls;     /**< Recall Scene sent to a group */
+    uint32_t u32MergedRecalls;    /**< Group recalls folded into the last frame */
+    uint32_t u32NodeRecalls;      /**< Recall Scene sent to a single node */
+    uint32_t u32Removed;          /**< Remove Scene / Remove All Scenes sent */
+    uint32_t u32TableFull;        /**< Stores refused, no room in the table */
+    uint32_t u32NotCapable;       /**< Stores refused, the node has no Scenes cluster */
+    uint32_t u32SaveFailures;     /**< Table not written to flash */
+} tsZCB_ScenesStats;
+
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+
+/** Load the scene table from flash */
+void vZCB_ScenesInit(void);
+
+/** Have the node store its current state as a scene. The node is added to
+ *  the Zigbee group first when it is not yet known to be a member. */
+teZcbStatus eZCB_SceneStore(uint16_t u16ShortAddress, uint16_t u16GroupId, uint8_t u8SceneId);
+
+/** Recall a scene on every node of its group with one group-cast frame.
+ *  E_ZCB_NOT_FOUND when no node stored the scene through the bridge. */
+teZcbStatus eZCB_SceneRecall(uint16_t u16GroupId, uint8_t u8SceneId);
+
+/** Recall a scene on one node only */
+teZcbStatus eZCB_SceneRecallNode(uint16_t u16ShortAddress, uint16_t u16GroupId, uint8_t u8SceneId);
+
+/** Remove a scene from one node */
+teZcbStatus eZCB_SceneRemove(uint16_t u16ShortAddress, uint16_t u16GroupId, uint8_t u8SceneId);
+
+/** Remove all scenes of a group from one node */
+teZcbStatus eZCB_SceneRemoveAll(uint16_t u16ShortAddress, uint16_t u16GroupId);
+
+/** Scenes of a group stored by the node, returns how many were written */
+uint8_t u8ZCB_SceneMembership(uint16_t u16ShortAddress,
+                              uint16_t u16GroupId,
+                              uint8_t *pu8SceneIds,
+                              uint8_t u8MaxScenes);
+
+/** Scenes stored by the node, over all groups */
+uint8_t u8ZCB_ScenesNodeCount(uint16_t u16ShortAddress);
+
+/** Free entries of the scene table */
+uint8_t u8ZCB_ScenesFree(void);
+
+/** Add the node to a Zigbee group */
+teZcbStatus eZCB_GroupAdd(uint16_t u16ShortAddress, uint16_t u16GroupId);
+
+/** Remove the node from a Zigbee group, along with its scenes of the group */
+teZcbStatus eZCB_GroupRemove(uint16_t u16ShortAddress, uint16_t u16GroupId);
+
+/** Drop a node which has left the network from every scene */
+void vZCB_ScenesForget(uint64_t u64IeeeAddress);
+
+/** Print the scene table, one line per scene */
+void vZCB_ScenesDump(void);
+
+void vZCB_ScenesGetStats(tsZCB_ScenesStats *psStats);
+
+#if defined __cplusplus
+}
+#endif
+
+#endif  /* ZCBSCENES_H */
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
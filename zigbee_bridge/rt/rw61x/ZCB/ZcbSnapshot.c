@@ -0,0 +1,604 @@
+/*
+ * Copyright 2021-2023 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+#include "fsl_debug_console.h"
+
+#include <string.h>
+#include <stdbool.h>
+
+#include "ZigbeeConstant.h"
+#include "ZigbeeDevices.h"
+#include "zcb.h"
+#include "ZcbIndex.h"
+#include "ZcbSnapshot.h"
+
+/*
+ * Read-mostly snapshot of the device table.
+ *
+ * The device table is written by the serial callback task and the ZCB
+ * service task, with no lock, while the shell and the Matter tasks look
+ * nodes up in it. Those readers now go to a copy of it instead, published
+ * after each batch of changes, which they read without a lock and without
+ * ever waiting on a writer.
+ *
+ * The copy is kept twice, with a sequence number over both (a latched
+ * seqlock). An odd sequence means copy 0 is being written, readers use
+ * copy 1; an even one the other way round. A publish makes the sequence
+ * odd, writes copy 0, makes it even and writes copy 1, so the copy a
+ * reader starts on is only written once the sequence has moved past the
+ * value it started with. A reader finding the sequence changed at the end
+ * reads again; it never spins on a writer which a higher priority task
+ * has preempted. Each copy has its own address indexes, updated with it.
+ *
+ * Publishers serialise on a mutex. A device the callback task is changing
+ * while the service task publishes is taken as it is then, the callback
+ * task publishes it again at the end of its batch.
+ *
+ * The stress test of test builds publishes a table of its own into a
+ * snapshot of its own; the device table and the snapshot the bridge reads
+ * are left alone.
+ */
+
+#define SNAPSHOT_COPIES         2
+#define SNAPSHOT_CHANGED_BYTES  ((MAX_ZD_DEVICE_NUMBERS + 7) / 8)
+
+/* Orders the sequence against the copies, for the compiler and the core */
+#define SNAPSHOT_FENCE()        __atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+/* Synthetic device of the stress test: its address, and its state in the
+ * batch which wrote u32LastSeen */
+#define SNAPSHOT_STRESS_IEEE(id)        (0x00158D0000000000ULL | (id))
+#define SNAPSHOT_STRESS_STATE(batch)    (((batch) & 1) ? E_ZB_DEVICE_STATE_OFF_LINE : E_ZB_DEVICE_STATE_ACTIVE)
+#define SNAPSHOT_STRESS_STACK_SIZE      256
+
+/** The entry of a table at u8Device as the snapshot has it, zeroed through
+ *  so that entries compare whole */
+typedef void (*tpfSnapshotSource)(uint8_t u8Device, tsZCB_SnapshotNode *psNode);
+
+typedef struct
+{
+    tsZCB_SnapshotNode      asCopy[SNAPSHOT_COPIES][MAX_ZD_DEVICE_NUMBERS];
+    uint16_t                au16NodeIdSlots[SNAPSHOT_COPIES][MAX_ZD_DEVICE_INDEX_SLOTS];
+    uint16_t                au16IeeeAddrSlots[SNAPSHOT_COPIES][MAX_ZD_DEVICE_INDEX_SLOTS];
+    tsZCB_Index             asNodeIdIndex[SNAPSHOT_COPIES];
+    tsZCB_Index             asIeeeAddrIndex[SNAPSHOT_COPIES];
+    volatile uint32_t       u32Sequence;
+    /* Devices which differ from the snapshot, found by the publish */
+    uint8_t                 au8Changed[SNAPSHOT_CHANGED_BYTES];
+    tpfSnapshotSource       pfSource;
+    tsZCB_SnapshotStats     sStats;
+} tsSnapshot;
+
+static void vSnapshotBuild(uint8_t u8Device, tsZCB_SnapshotNode *psNode);
+
+static tsSnapshot sSnapshot = { .pfSource = vSnapshotBuild };
+static SemaphoreHandle_t xSnapshotMutex = NULL;
+
+#if ZB_BRIDGE_TEST_COMMANDS
+typedef struct
+{
+    volatile bool bDone;
+    uint32_t u32Views;            /* whole snapshots read */
+    uint32_t u32Lookups;
+    uint32_t u32Torn;             /* views or lookups mixing two batches */
+    uint32_t u32Versions;         /* snapshots seen */
+} tsSnapshotReader;
+
+static tsSnapshotReader asReaders[ZCB_SNAPSHOT_STRESS_READERS];
+static volatile bool bStressStop;
+static uint16_t u16StressDevices;
+/* The synthetic devices and the snapshot published from them */
+static tsZCB_SnapshotNode asStressTable[MAX_ZD_DEVICE_NUMBERS];
+static tsSnapshot sStressSnapshot;
+#endif
+
+
+/* The entry of the device table at u8Device */
+static void vSnapshotBuild(uint8_t u8Device, tsZCB_SnapshotNode *psNode)
+{
+    const tsZbDeviceInfo *psDevice = tZDM_FindDeviceByIndex(u8Device);
+
+    memset(psNode, 0, sizeof(*psNode));
+    /* A node id of 0 marks a free entry of the device table */
+    if ((psDevice == NULL) || (psDevice->u16NodeId == 0)) {
+        return;
+    }
+    psNode->u64IeeeAddress  = psDevice->u64IeeeAddress;
+    psNode->u32LastSeen     = psDevice->u32LastSeen;
+    psNode->u16NodeId       = psDevice->u16NodeId;
+    psNode->u16DynamicEp    = u16ZCB_NodeDynamicEp(psDevice->u16NodeId);
+    psNode->u8DeviceState   = (uint8_t)psDevice->eDeviceState;
+    psNode->u8EndpointCount = psDevice->u8EndpointCount;
+    psNode->bSleepy         = psDevice->bSleepy;
+}
+
+static bool bSnapshotChanged(const tsSnapshot *psSnap, uint8_t i)
+{
+    return (psSnap->au8Changed[i / 8] & (1 << (i % 8))) != 0;
+}
+
+static void vSnapshotIndexRebuild(tsSnapshot *psSnap, uint8_t u8Copy)
+{
+    vZCB_IndexClear(&psSnap->asNodeIdIndex[u8Copy]);
+    vZCB_IndexClear(&psSnap->asIeeeAddrIndex[u8Copy]);
+    for (uint8_t i = 0; i < MAX_ZD_DEVICE_NUMBERS; i++)
+    {
+        if (psSnap->asCopy[u8Copy][i].u16NodeId != 0) {
+            vZCB_IndexInsert(&psSnap->asNodeIdIndex[u8Copy], i);
+            vZCB_IndexInsert(&psSnap->asIeeeAddrIndex[u8Copy], i);
+        }
+    }
+}
+
+/* Empty copies, their indexes keyed on them */
+static void vSnapshotSetup(tsSnapshot *psSnap)
+{
+    memset(psSnap->asCopy, 0, sizeof(psSnap->asCopy));
+    for (uint8_t c = 0; c < SNAPSHOT_COPIES; c++)
+    {
+        psSnap->asNodeIdIndex[c].pu16Slots   = psSnap->au16NodeIdSlots[c];
+        psSnap->asNodeIdIndex[c].u16Mask     = MAX_ZD_DEVICE_INDEX_SLOTS - 1;
+        psSnap->asNodeIdIndex[c].u16Deleted  = 0;
+        psSnap->asNodeIdIndex[c].pu8Keys     = (const uint8_t *)&psSnap->asCopy[c][0].u16NodeId;
+        psSnap->asNodeIdIndex[c].u16Stride   = sizeof(tsZCB_SnapshotNode);
+        psSnap->asNodeIdIndex[c].u8KeySize   = sizeof(uint16_t);
+
+        psSnap->asIeeeAddrIndex[c].pu16Slots  = psSnap->au16IeeeAddrSlots[c];
+        psSnap->asIeeeAddrIndex[c].u16Mask    = MAX_ZD_DEVICE_INDEX_SLOTS - 1;
+        psSnap->asIeeeAddrIndex[c].u16Deleted = 0;
+        psSnap->asIeeeAddrIndex[c].pu8Keys    = (const uint8_t *)&psSnap->asCopy[c][0].u64IeeeAddress;
+        psSnap->asIeeeAddrIndex[c].u16Stride  = sizeof(tsZCB_SnapshotNode);
+        psSnap->asIeeeAddrIndex[c].u8KeySize  = sizeof(uint64_t);
+
+        vSnapshotIndexRebuild(psSnap, c);
+    }
+}
+
+/* Entry i of one copy, no reader being on it */
+static void vSnapshotPut(tsSnapshot *psSnap, uint8_t u8Copy, uint8_t i, const tsZCB_SnapshotNode *psFrom)
+{
+    tsZCB_SnapshotNode *psNode = &psSnap->asCopy[u8Copy][i];
+    bool bRekeyed = (psNode->u16NodeId != psFrom->u16NodeId) || (psNode->u64IeeeAddress != psFrom->u64IeeeAddress);
+
+    /* The indexes read their keys from the entry, out before it changes */
+    if (bRekeyed && (psNode->u16NodeId != 0)) {
+        vZCB_IndexRemove(&psSnap->asNodeIdIndex[u8Copy], i);
+        vZCB_IndexRemove(&psSnap->asIeeeAddrIndex[u8Copy], i);
+    }
+    *psNode = *psFrom;
+    if (bRekeyed && (psNode->u16NodeId != 0)) {
+        vZCB_IndexInsert(&psSnap->asNodeIdIndex[u8Copy], i);
+        vZCB_IndexInsert(&psSnap->asIeeeAddrIndex[u8Copy], i);
+    }
+}
+
+/* Deleted marks lengthen the probes, they go once a quarter of the slots has one */
+static void vSnapshotIndexTidy(tsSnapshot *psSnap, uint8_t u8Copy)
+{
+    if (bZCB_IndexNeedsRebuild(&psSnap->asNodeIdIndex[u8Copy])
+        || bZCB_IndexNeedsRebuild(&psSnap->asIeeeAddrIndex[u8Copy])) {
+        vSnapshotIndexRebuild(psSnap, u8Copy);
+    }
+}
+
+static void vSnapshotPublishLocked(tsSnapshot *psSnap)
+{
+    tsZCB_SnapshotNode sNode;
+    uint16_t u16Changed = 0;
+
+    memset(psSnap->au8Changed, 0, sizeof(psSnap->au8Changed));
+    for (uint8_t i = 0; i < MAX_ZD_DEVICE_NUMBERS; i++)
+    {
+        psSnap->pfSource(i, &sNode);
+        if (memcmp(&sNode, &psSnap->asCopy[0][i], sizeof(sNode)) != 0) {
+            psSnap->au8Changed[i / 8] |= (uint8_t)(1 << (i % 8));
+            u16Changed++;
+        }
+    }
+    if (u16Changed == 0) {
+        psSnap->sStats.u32Unchanged++;
+        return;
+    }
+
+    /* Readers to copy 1, copy 0 built again from the table */
+    psSnap->u32Sequence++;
+    SNAPSHOT_FENCE();
+    for (uint8_t i = 0; i < MAX_ZD_DEVICE_NUMBERS; i++)
+    {
+        if (bSnapshotChanged(psSnap, i)) {
+            psSnap->pfSource(i, &sNode);
+            vSnapshotPut(psSnap, 0, i, &sNode);
+        }
+    }
+    vSnapshotIndexTidy(psSnap, 0);
+    SNAPSHOT_FENCE();
+    /* Readers to copy 0, copy 1 made the same */
+    psSnap->u32Sequence++;
+    SNAPSHOT_FENCE();
+    for (uint8_t i = 0; i < MAX_ZD_DEVICE_NUMBERS; i++)
+    {
+        if (bSnapshotChanged(psSnap, i)) {
+            vSnapshotPut(psSnap, 1, i, &psSnap->asCopy[0][i]);
+        }
+    }
+    vSnapshotIndexTidy(psSnap, 1);
+    SNAPSHOT_FENCE();
+
+    psSnap->sStats.u32Version++;
+    psSnap->sStats.u32NodesCopied += u16Changed;
+}
+
+/* A read of the copy the sequence points at, started and then checked */
+static uint32_t u32SnapshotReadBegin(const tsSnapshot *psSnap)
+{
+    uint32_t u32Start = psSnap->u32Sequence;
+
+    SNAPSHOT_FENCE();
+    return u32Start;
+}
+
+static bool bSnapshotReadAgain(tsSnapshot *psSnap, uint32_t u32Start)
+{
+    SNAPSHOT_FENCE();
+    if (psSnap->u32Sequence != u32Start) {
+        psSnap->sStats.u32Retries++;
+        return true;
+    }
+    psSnap->sStats.u32Reads++;
+    return false;
+}
+
+static bool bSnapshotNodeAt(tsSnapshot *psSnap, uint8_t u8Device, tsZCB_SnapshotNode *psNode)
+{
+    uint32_t u32Start;
+
+    do
+    {
+        u32Start = u32SnapshotReadBegin(psSnap);
+        *psNode = psSnap->asCopy[u32Start & 1][u8Device];
+    } while (bSnapshotReadAgain(psSnap, u32Start));
+    return psNode->u16NodeId != 0;
+}
+
+static bool bSnapshotNodeByShort(tsSnapshot *psSnap, uint16_t u16NodeId, tsZCB_SnapshotNode *psNode)
+{
+    uint32_t u32Start;
+    uint16_t i;
+    bool bFound;
+
+    if (u16NodeId == 0) {
+        return false;
+    }
+    do
+    {
+        u32Start = u32SnapshotReadBegin(psSnap);
+        i = u16ZCB_IndexFind(&psSnap->asNodeIdIndex[u32Start & 1], u16NodeId);
+        bFound = (i < MAX_ZD_DEVICE_NUMBERS);
+        if (bFound) {
+            *psNode = psSnap->asCopy[u32Start & 1][i];
+        }
+    } while (bSnapshotReadAgain(psSnap, u32Start));
+    return bFound;
+}
+
+void vZCB_SnapshotInit(void)
+{
+    if (xSnapshotMutex == NULL) {
+        xSnapshotMutex = xSemaphoreCreateMutex();
+    }
+    if (xSnapshotMutex == NULL) {
+        PRINTF("\n ### Snapshot mutex create fail\n");
+        return;
+    }
+    vSnapshotSetup(&sSnapshot);
+}
+
+void vZCB_SnapshotPublish(void)
+{
+    if (xSnapshotMutex == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(xSnapshotMutex, portMAX_DELAY);
+    vSnapshotPublishLocked(&sSnapshot);
+    xSemaphoreGive(xSnapshotMutex);
+}
+
+uint32_t u32ZCB_SnapshotVersion(void)
+{
+    return sSnapshot.u32Sequence / 2;
+}
+
+bool bZCB_SnapshotNodeByShort(uint16_t u16NodeId, tsZCB_SnapshotNode *psNode)
+{
+    return bSnapshotNodeByShort(&sSnapshot, u16NodeId, psNode);
+}
+
+bool bZCB_SnapshotNodeByIeee(uint64_t u64IeeeAddress, tsZCB_SnapshotNode *psNode)
+{
+    uint32_t u32Start;
+    uint16_t i;
+    bool bFound;
+
+    if (u64IeeeAddress == 0) {
+        return false;
+    }
+    do
+    {
+        u32Start = u32SnapshotReadBegin(&sSnapshot);
+        i = u16ZCB_IndexFind(&sSnapshot.asIeeeAddrIndex[u32Start & 1], u64IeeeAddress);
+        bFound = (i < MAX_ZD_DEVICE_NUMBERS);
+        if (bFound) {
+            *psNode = sSnapshot.asCopy[u32Start & 1][i];
+        }
+    } while (bSnapshotReadAgain(&sSnapshot, u32Start));
+    return bFound;
+}
+
+uint32_t u32ZCB_SnapshotRam(void)
+{
+    return sizeof(sSnapshot.asCopy) + sizeof(sSnapshot.au16NodeIdSlots) + sizeof(sSnapshot.au16IeeeAddrSlots)
+           + sizeof(sSnapshot.au8Changed);
+}
+
+void vZCB_SnapshotDump(void)
+{
+    tsZCB_SnapshotNode sNode;
+    uint16_t u16Count = 0;
+
+    PRINTF("\n ### Snapshot %d, %d bytes\n", (int)u32ZCB_SnapshotVersion(), (int)u32ZCB_SnapshotRam());
+    for (uint8_t i = 0; i < MAX_ZD_DEVICE_NUMBERS; i++)
+    {
+        if (!bSnapshotNodeAt(&sSnapshot, i, &sNode)) {
+            continue;
+        }
+        PRINTF(" ### [%d] 0x%04x %08x%08x state 0x%02x ep %d, %d endpoint(s)%s, seen at %d s\n", i,
+               sNode.u16NodeId, (unsigned int)(sNode.u64IeeeAddress >> 32), (unsigned int)sNode.u64IeeeAddress,
+               sNode.u8DeviceState, sNode.u16DynamicEp, sNode.u8EndpointCount, sNode.bSleepy ? ", sleepy" : "",
+               (int)sNode.u32LastSeen);
+        u16Count++;
+    }
+    PRINTF(" ### %d device(s); %d published, %d unchanged, %d entries copied\n", u16Count,
+           (int)sSnapshot.sStats.u32Version, (int)sSnapshot.sStats.u32Unchanged,
+           (int)sSnapshot.sStats.u32NodesCopied);
+    PRINTF(" ### %d reads, %d read again\n", (int)sSnapshot.sStats.u32Reads, (int)sSnapshot.sStats.u32Retries);
+}
+
+#if ZB_BRIDGE_TEST_COMMANDS
+/* The entry of the stress table at u8Device */
+static void vSnapshotStressBuild(uint8_t u8Device, tsZCB_SnapshotNode *psNode)
+{
+    *psNode = asStressTable[u8Device];
+}
+
+/* The whole snapshot as a stress reader sees it: true when every device in
+ * it comes from the same batch */
+static bool bSnapshotStressView(uint32_t *pu32Version)
+{
+    const tsZCB_SnapshotNode *psCopy;
+    uint32_t u32Start;
+    uint32_t u32Batch;
+    bool bOneBatch;
+
+    do
+    {
+        u32Start = u32SnapshotReadBegin(&sStressSnapshot);
+        psCopy = sStressSnapshot.asCopy[u32Start & 1];
+        u32Batch = psCopy[0].u32LastSeen;
+        bOneBatch = true;
+        for (uint16_t i = 0; i < u16StressDevices; i++)
+        {
+            if ((psCopy[i].u32LastSeen != u32Batch)
+                || (psCopy[i].u8DeviceState != SNAPSHOT_STRESS_STATE(u32Batch))
+                || (psCopy[i].u64IeeeAddress != SNAPSHOT_STRESS_IEEE(psCopy[i].u16NodeId))) {
+                bOneBatch = false;
+            }
+        }
+    } while (bSnapshotReadAgain(&sStressSnapshot, u32Start));
+    *pu32Version = u32Start / 2;
+    return bOneBatch;
+}
+
+/* The first reader is above the writer: it reads a few times a tick and
+ * preempts the writer wherever it is. The other shares the writer's time
+ * slices. */
+static void vSnapshotReaderTask(void *pvParameters)
+{
+    tsSnapshotReader *psReader = (tsSnapshotReader *)pvParameters;
+    tsZCB_SnapshotNode sNode;
+    uint32_t u32Version;
+    uint32_t u32Last = 0;
+    uint16_t u16NodeId = 1;
+
+    while (!bStressStop)
+    {
+        if (!bSnapshotStressView(&u32Version)) {
+            psReader->u32Torn++;
+        }
+        psReader->u32Views++;
+        if (u32Version != u32Last) {
+            psReader->u32Versions++;
+            u32Last = u32Version;
+        }
+
+        if (!bSnapshotNodeByShort(&sStressSnapshot, u16NodeId, &sNode)
+            || (sNode.u64IeeeAddress != SNAPSHOT_STRESS_IEEE(u16NodeId))
+            || (sNode.u8DeviceState != SNAPSHOT_STRESS_STATE(sNode.u32LastSeen))) {
+            psReader->u32Torn++;
+        }
+        psReader->u32Lookups++;
+        u16NodeId = (uint16_t)(u16NodeId % u16StressDevices + 1);
+
+        if ((psReader == &asReaders[0]) && ((psReader->u32Views % 8) == 0)) {
+            vTaskDelay(1);
+        }
+    }
+    psReader->bDone = true;
+    vTaskDelete(NULL);
+}
+
+/* Ticks taken by the reader cost measures: snapshot lookups, the same
+ * lookups of the stress table under a mutex, and whole snapshot views */
+static void vSnapshotStressCost(SemaphoreHandle_t xMutex, TickType_t axTicks[3])
+{
+    tsZCB_SnapshotNode sNode;
+    uint32_t u32Version;
+    uint32_t u32Found = 0;
+    TickType_t xStart;
+    uint16_t i;
+
+    xStart = xTaskGetTickCount();
+    for (uint32_t n = 0; n < ZCB_SNAPSHOT_STRESS_LOOKUPS; n++)
+    {
+        if (bSnapshotNodeByShort(&sStressSnapshot, (uint16_t)(n % u16StressDevices + 1), &sNode)) {
+            u32Found++;
+        }
+    }
+    axTicks[0] = xTaskGetTickCount() - xStart;
+
+    xStart = xTaskGetTickCount();
+    for (uint32_t n = 0; n < ZCB_SNAPSHOT_STRESS_LOOKUPS; n++)
+    {
+        xSemaphoreTake(xMutex, portMAX_DELAY);
+        i = u16ZCB_IndexFind(&sStressSnapshot.asNodeIdIndex[0], (uint16_t)(n % u16StressDevices + 1));
+        if (i < MAX_ZD_DEVICE_NUMBERS) {
+            sNode.u64IeeeAddress = asStressTable[i].u64IeeeAddress;
+            sNode.u32LastSeen    = asStressTable[i].u32LastSeen;
+            sNode.u8DeviceState  = asStressTable[i].u8DeviceState;
+            u32Found++;
+        }
+        xSemaphoreGive(xMutex);
+    }
+    axTicks[1] = xTaskGetTickCount() - xStart;
+
+    xStart = xTaskGetTickCount();
+    for (uint32_t n = 0; n < ZCB_SNAPSHOT_STRESS_LOOKUPS / 10; n++)
+    {
+        bSnapshotStressView(&u32Version);
+    }
+    axTicks[2] = xTaskGetTickCount() - xStart;
+
+    if (u32Found != 2 * ZCB_SNAPSHOT_STRESS_LOOKUPS) {
+        PRINTF("\n ### Snapshot stress: %d lookups of %d found their node\n", (int)u32Found,
+               2 * ZCB_SNAPSHOT_STRESS_LOOKUPS);
+    }
+}
+
+void vZCB_SnapshotStress(void)
+{
+    static const char *const apcCosts[3] = { "Snapshot lookup", "Locked lookup", "Snapshot view" };
+    static const uint32_t au32Ops[3] =
+    {
+        ZCB_SNAPSHOT_STRESS_LOOKUPS, ZCB_SNAPSHOT_STRESS_LOOKUPS, ZCB_SNAPSHOT_STRESS_LOOKUPS / 10
+    };
+    UBaseType_t uxPriority = uxTaskPriorityGet(NULL);
+    SemaphoreHandle_t xStressMutex;
+    TickType_t axCost[3];
+    TickType_t xWriter;
+    uint32_t u32Retries;
+    uint8_t u8Started = 0;
+    bool bDone;
+
+    xStressMutex = xSemaphoreCreateMutex();
+    if (xStressMutex == NULL) {
+        return;
+    }
+
+    memset(&sStressSnapshot, 0, sizeof(sStressSnapshot));
+    sStressSnapshot.pfSource = vSnapshotStressBuild;
+    vSnapshotSetup(&sStressSnapshot);
+
+    memset(asStressTable, 0, sizeof(asStressTable));
+    for (u16StressDevices = 0; u16StressDevices < MAX_ZD_DEVICE_NUMBERS; u16StressDevices++)
+    {
+        asStressTable[u16StressDevices].u16NodeId      = u16StressDevices + 1;
+        asStressTable[u16StressDevices].u64IeeeAddress = SNAPSHOT_STRESS_IEEE(u16StressDevices + 1);
+        asStressTable[u16StressDevices].u8DeviceState  = SNAPSHOT_STRESS_STATE(0);
+    }
+    vSnapshotPublishLocked(&sStressSnapshot);
+
+    bStressStop = false;
+    memset(asReaders, 0, sizeof(asReaders));
+    for (uint8_t r = 0; r < ZCB_SNAPSHOT_STRESS_READERS; r++)
+    {
+        if (pdPASS != xTaskCreate(vSnapshotReaderTask,
+                                  "snapshotReader",
+                                  SNAPSHOT_STRESS_STACK_SIZE,
+                                  &asReaders[r],
+                                  (r == 0) ? uxPriority + 1 : uxPriority,
+                                  NULL))
+        {
+            PRINTF("\n ### Snapshot stress: reader %d not started\n", r);
+            asReaders[r].bDone = true;
+        } else {
+            u8Started++;
+        }
+    }
+    sStressSnapshot.sStats.u32Retries = 0;
+
+    /* Each batch rewrites every device; a view is torn if two batches show */
+    xWriter = xTaskGetTickCount();
+    for (uint32_t b = 1; b <= ZCB_SNAPSHOT_STRESS_ROUNDS; b++)
+    {
+        xSemaphoreTake(xStressMutex, portMAX_DELAY);
+        for (uint16_t i = 0; i < u16StressDevices; i++)
+        {
+            asStressTable[i].u32LastSeen   = b;
+            asStressTable[i].u8DeviceState = SNAPSHOT_STRESS_STATE(b);
+        }
+        vSnapshotPublishLocked(&sStressSnapshot);
+        xSemaphoreGive(xStressMutex);
+    }
+    xWriter = xTaskGetTickCount() - xWriter;
+    u32Retries = sStressSnapshot.sStats.u32Retries;
+
+    bStressStop = true;
+    do
+    {
+        vTaskDelay(1);
+        bDone = true;
+        for (uint8_t r = 0; r < ZCB_SNAPSHOT_STRESS_READERS; r++)
+        {
+            bDone = bDone && asReaders[r].bDone;
+        }
+    } while (!bDone);
+
+    PRINTF("\n ### %d devices, %d batches in %d ms, %d reader(s)\n", u16StressDevices,
+           ZCB_SNAPSHOT_STRESS_ROUNDS, (int)(xWriter * portTICK_PERIOD_MS), u8Started);
+    for (uint8_t r = 0; r < ZCB_SNAPSHOT_STRESS_READERS; r++)
+    {
+        PRINTF(" ### Reader %d: %d views, %d lookups, %d snapshots seen, %d torn\n", r,
+               (int)asReaders[r].u32Views, (int)asReaders[r].u32Lookups, (int)asReaders[r].u32Versions,
+               (int)asReaders[r].u32Torn);
+    }
+    PRINTF(" ### %d reads done again as a publish went by\n", (int)u32Retries);
+
+    /* What one reader pays, the writer idle */
+    vSnapshotStressCost(xStressMutex, axCost);
+    for (uint8_t c = 0; c < 3; c++)
+    {
+        PRINTF(" ### %-16s %5d ns\n", apcCosts[c],
+               (int)((uint64_t)axCost[c] * portTICK_PERIOD_MS * 1000000u / au32Ops[c]));
+    }
+
+    vSemaphoreDelete(xStressMutex);
+    u16StressDevices = 0;
+}
+#endif
+
+void vZCB_SnapshotGetStats(tsZCB_SnapshotStats *psStats)
+{
+    *psStats = sSnapshot.sStats;
+}
+
+// ------------------------------------------------------------------
+// END OF FILE
+// ------------------------------------------------------------------
@@ -0,0 +1,110 @@
+/*
+ * Copyright 2021-2023 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef ZCBSNAPSHOT_H
+#define ZCBSNAPSHOT_H
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+/****************************************************************************/
+/***        Include files                                                 ***/
+/****************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "ZigbeeConstant.h"
+
+/****************************************************************************/
+/***        Macro Definitions                                             ***/
+/****************************************************************************/
+
+/* Reader tasks of vZCB_SnapshotStress(), one above the caller's priority
+ * and one at it */
+#define ZCB_SNAPSHOT_STRESS_READERS             2
+/* Batches the stress writer publishes */
+#define ZCB_SNAPSHOT_STRESS_ROUNDS              2000
+/* Lookups timed per measure of the reader cost */
+#define ZCB_SNAPSHOT_STRESS_LOOKUPS             100000
+
+
+/****************************************************************************/
+/***        Type Definitions                                              ***/
+/****************************************************************************/
+
+/** A device as the snapshot has it, at the index it has in the device
+ *  table; u16NodeId 0 for a free entry */
+typedef struct
+{
+    uint64_t u64IeeeAddress;
+    uint32_t u32LastSeen;         /**< Liveness clock seconds, see ZcbLiveness.h */
+    uint16_t u16NodeId;
+    uint16_t u16DynamicEp;        /**< Matter endpoint of the node, 0 for none */
+    uint8_t  u8DeviceState;       /**< teZbDeviceState */
+    uint8_t  u8EndpointCount;
+    bool     bSleepy;
+} tsZCB_SnapshotNode;
+
+typedef struct
+{
+    uint32_t u32Version;          /**< Snapshots published */
+    uint32_t u32Unchanged;        /**< Publishes with nothing new to show */
+    uint32_t u32NodesCopied;      /**< Device entries written to the snapshot */
+    uint32_t u32Reads;            /**< Reads, counted by the readers without a lock */
+    uint32_t u32Retries;          /**< ... read again as a publish went by */
+} tsZCB_SnapshotStats;
+
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+
+void vZCB_SnapshotInit(void);
+
+/** Bring the snapshot up to date with the device table, after a batch of
+ *  changes: from the serial callback task once its queue is empty, and
+ *  from the ZCB service task every sweep. Nothing is published when no
+ *  device changed. */
+void vZCB_SnapshotPublish(void);
+
+/** Number of the snapshot the readers see now */
+uint32_t u32ZCB_SnapshotVersion(void);
+
+/** The device of the node, from any task without a lock; false when the
+ *  snapshot has no such node */
+bool bZCB_SnapshotNodeByShort(uint16_t u16NodeId, tsZCB_SnapshotNode *psNode);
+
+bool bZCB_SnapshotNodeByIeee(uint64_t u64IeeeAddress, tsZCB_SnapshotNode *psNode);
+
+/** Static RAM of the snapshot */
+uint32_t u32ZCB_SnapshotRam(void);
+
+/** Print the devices of the current snapshot */
+void vZCB_SnapshotDump(void);
+
+#if ZB_BRIDGE_TEST_COMMANDS
+/** Rewrite MAX_ZD_DEVICE_NUMBERS synthetic devices batch after batch while
+ *  ZCB_SNAPSHOT_STRESS_READERS tasks read a snapshot of them and check each
+ *  view is one batch, then print what a reader pays against a lookup under
+ *  a mutex. The devices and their snapshot are the test's own, the bridge
+ *  keeps running on its device table. */
+void vZCB_SnapshotStress(void);
+#endif
+
+void vZCB_SnapshotGetStats(tsZCB_SnapshotStats *psStats);
+
+#if defined __cplusplus
+}
+#endif
+
+#endif  /* ZCBSNAPSHOT_H */
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
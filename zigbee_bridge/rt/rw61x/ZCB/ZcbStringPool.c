@@ -0,0 +1,341 @@
+/*
+ * Copyright 2021-2023 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+#include "fsl_debug_console.h"
+
+#include <string.h>
+#include <stdbool.h>
+
+#include "ZcbStringPool.h"
+
+/*
+ * Shared pool of the string attributes.
+ *
+ * The string attributes of the attribute table, manufacturer name, model
+ * identifier, date code and the like, each had a heap buffer of their own;
+ * fifty bulbs of one model made fifty copies of each, and fifty heap blocks
+ * with their headers. They are now interned here: a string is stored once
+ * with a count of its references and handed out as a small handle, so two
+ * attributes hold the same value exactly when they hold the same handle.
+ *
+ * The strings sit back to back in one fixed array, nothing comes from the
+ * heap. When the last reference of a string goes, those behind it move down
+ * and the free space stays in one piece at the end; a handle stays valid
+ * across the move, a pointer to the bytes does not.
+ */
+
+typedef struct
+{
+    uint16_t    u16Offset;          /* in au8Pool */
+    uint16_t    u16Refs;            /* 0 when the entry is free */
+    uint32_t    u32Hash;
+    uint8_t     u8Length;           /* without the nul */
+} tsPoolString;
+
+#if ZB_BRIDGE_TEST_COMMANDS
+/* Basic cluster strings of the devices of vZCB_StringPoolMeasure() */
+static const char *const apcMeasureStrings[] =
+{
+    "NXP", "ZLL-ExtendedColor", "20231012", "3.0.1-rw612"
+};
+#define STRING_POOL_MEASURE_STRINGS     (sizeof(apcMeasureStrings) / sizeof(apcMeasureStrings[0]))
+#endif
+
+static uint8_t au8Pool[ZCB_STRING_POOL_SIZE];
+static uint16_t u16PoolUsed;
+static tsPoolString asStrings[ZCB_STRING_POOL_MAX];
+static tsZCB_StringPoolStats sStats;
+static SemaphoreHandle_t xStringPoolMutex = NULL;
+
+
+/* FNV-1a */
+static uint32_t u32PoolHash(const uint8_t *pu8Data, uint8_t u8Length)
+{
+    uint32_t u32Hash = 2166136261u;
+
+    for (uint8_t i = 0; i < u8Length; i++)
+    {
+        u32Hash = (u32Hash ^ pu8Data[i]) * 16777619u;
+    }
+    return u32Hash;
+}
+
+/* Called with the mutex held; NULL for a handle of no string in use */
+static tsPoolString *psPoolString(uint16_t u16Handle)
+{
+    if ((u16Handle == ZCB_STRING_NONE) || (u16Handle > ZCB_STRING_POOL_MAX)
+        || (asStrings[u16Handle - 1].u16Refs == 0)) {
+        return NULL;
+    }
+    return &asStrings[u16Handle - 1];
+}
+
+void vZCB_StringPoolInit(void)
+{
+    memset(&sStats, 0, sizeof(sStats));
+    memset(asStrings, 0, sizeof(asStrings));
+    u16PoolUsed = 0;
+
+    if (xStringPoolMutex == NULL) {
+        xStringPoolMutex = xSemaphoreCreateMutex();
+    }
+}
+
+uint16_t u16ZCB_StringIntern(const uint8_t *pu8Data, uint8_t u8Length)
+{
+    uint32_t u32Hash = u32PoolHash(pu8Data, u8Length);
+    uint8_t u8Free = ZCB_STRING_POOL_MAX;
+    tsPoolString *psString;
+
+    if (xStringPoolMutex == NULL) {
+        return ZCB_STRING_NONE;
+    }
+
+    xSemaphoreTake(xStringPoolMutex, portMAX_DELAY);
+    sStats.u32Interned++;
+    for (uint8_t i = 0; i < ZCB_STRING_POOL_MAX; i++)
+    {
+        psString = &asStrings[i];
+        if (psString->u16Refs == 0) {
+            if (u8Free == ZCB_STRING_POOL_MAX) {
+                u8Free = i;
+            }
+            continue;
+        }
+        if ((psString->u32Hash == u32Hash) && (psString->u8Length == u8Length)
+            && (memcmp(&au8Pool[psString->u16Offset], pu8Data, u8Length) == 0)) {
+            psString->u16Refs++;
+            sStats.u32Shared++;
+            sStats.u32SavedBytes += u8Length + 1;
+            xSemaphoreGive(xStringPoolMutex);
+            return i + 1;
+        }
+    }
+
+    if ((u8Free == ZCB_STRING_POOL_MAX) || (u16PoolUsed + u8Length + 1 > ZCB_STRING_POOL_SIZE)) {
+        sStats.u32Full++;
+        xSemaphoreGive(xStringPoolMutex);
+        return ZCB_STRING_NONE;
+    }
+    psString = &asStrings[u8Free];
+    psString->u16Offset = u16PoolUsed;
+    psString->u16Refs   = 1;
+    psString->u32Hash   = u32Hash;
+    psString->u8Length  = u8Length;
+    memcpy(&au8Pool[u16PoolUsed], pu8Data, u8Length);
+    au8Pool[u16PoolUsed + u8Length] = '\0';
+    u16PoolUsed += u8Length + 1;
+
+    sStats.u16Strings++;
+    sStats.u16Bytes = u16PoolUsed;
+    if (u16PoolUsed > sStats.u16PeakBytes) {
+        sStats.u16PeakBytes = u16PoolUsed;
+    }
+    xSemaphoreGive(xStringPoolMutex);
+    return u8Free + 1;
+}
+
+void vZCB_StringRelease(uint16_t u16Handle)
+{
+    tsPoolString *psString;
+    uint16_t u16Offset;
+    uint16_t u16Size;
+
+    if ((u16Handle == ZCB_STRING_NONE) || (xStringPoolMutex == NULL)) {
+        return;
+    }
+
+    xSemaphoreTake(xStringPoolMutex, portMAX_DELAY);
+    psString = psPoolString(u16Handle);
+    if (psString == NULL) {
+        xSemaphoreGive(xStringPoolMutex);
+        return;
+    }
+    u16Size = psString->u8Length + 1;
+    if (--psString->u16Refs > 0) {
+        sStats.u32SavedBytes -= u16Size;
+        xSemaphoreGive(xStringPoolMutex);
+        return;
+    }
+
+    /* The last reference: the strings behind close up */
+    u16Offset = psString->u16Offset;
+    memmove(&au8Pool[u16Offset], &au8Pool[u16Offset + u16Size], u16PoolUsed - u16Offset - u16Size);
+    u16PoolUsed -= u16Size;
+    for (uint8_t i = 0; i < ZCB_STRING_POOL_MAX; i++)
+    {
+        if ((asStrings[i].u16Refs > 0) && (asStrings[i].u16Offset > u16Offset)) {
+            asStrings[i].u16Offset -= u16Size;
+        }
+    }
+    sStats.u16Strings--;
+    sStats.u16Bytes = u16PoolUsed;
+    xSemaphoreGive(xStringPoolMutex);
+}
+
+const char *pcZCB_StringGet(uint16_t u16Handle)
+{
+    const char *pcString = "";
+    tsPoolString *psString;
+
+    if (xStringPoolMutex == NULL) {
+        return pcString;
+    }
+
+    xSemaphoreTake(xStringPoolMutex, portMAX_DELAY);
+    psString = psPoolString(u16Handle);
+    if (psString != NULL) {
+        pcString = (const char *)&au8Pool[psString->u16Offset];
+    }
+    xSemaphoreGive(xStringPoolMutex);
+    return pcString;
+}
+
+uint8_t u8ZCB_StringCopy(uint16_t u16Handle, char *pcBuffer, uint8_t u8Size)
+{
+    uint8_t u8Length = 0;
+    tsPoolString *psString;
+
+    if ((pcBuffer == NULL) || (u8Size == 0)) {
+        return 0;
+    }
+    pcBuffer[0] = '\0';
+    if (xStringPoolMutex == NULL) {
+        return 0;
+    }
+
+    xSemaphoreTake(xStringPoolMutex, portMAX_DELAY);
+    psString = psPoolString(u16Handle);
+    if (psString != NULL) {
+        u8Length = (psString->u8Length < u8Size) ? psString->u8Length : (u8Size - 1);
+        memcpy(pcBuffer, &au8Pool[psString->u16Offset], u8Length);
+        pcBuffer[u8Length] = '\0';
+    }
+    xSemaphoreGive(xStringPoolMutex);
+    return u8Length;
+}
+
+#if ZB_BRIDGE_TEST_COMMANDS
+/* The measure interns into the live pool: while it runs the strings of the
+ * attribute table may find no room, so it is only built into test builds. */
+
+void vZCB_StringPoolMeasure(uint8_t u8Devices)
+{
+    uint16_t u16Count = u8Devices * STRING_POOL_MEASURE_STRINGS;
+    uint8_t **ppu8Buffers;
+    uint16_t *pu16Handles;
+    uint16_t u16Allocations = 0;
+    uint16_t u16Refused = 0;
+    uint16_t u16PoolBefore;
+    uint16_t u16PoolAfter;
+    uint32_t u32HeapBytes;
+    uint32_t u32InternHeapBytes;
+    size_t xFree;
+
+    if ((u8Devices == 0) || (xStringPoolMutex == NULL)) {
+        return;
+    }
+
+    ppu8Buffers = pvPortMalloc(sizeof(uint8_t *) * u16Count);
+    pu16Handles = pvPortMalloc(sizeof(uint16_t) * u16Count);
+    if ((ppu8Buffers == NULL) || (pu16Handles == NULL)) {
+        PRINTF("\n ### String pool measure: no memory for %d devices\n", u8Devices);
+        vPortFree(ppu8Buffers);
+        vPortFree(pu16Handles);
+        return;
+    }
+
+    /* A heap buffer per string attribute, as the attribute table kept them */
+    xFree = xPortGetFreeHeapSize();
+    for (uint16_t i = 0; i < u16Count; i++)
+    {
+        const char *pcString = apcMeasureStrings[i % STRING_POOL_MEASURE_STRINGS];
+        size_t xLength = strlen(pcString);
+
+        ppu8Buffers[i] = pvPortMalloc(xLength + 1);
+        if (ppu8Buffers[i] != NULL) {
+            memcpy(ppu8Buffers[i], pcString, xLength + 1);
+            u16Allocations++;
+        }
+    }
+    u32HeapBytes = (uint32_t)(xFree - xPortGetFreeHeapSize());
+
+    /* The same strings interned */
+    xSemaphoreTake(xStringPoolMutex, portMAX_DELAY);
+    u16PoolBefore = u16PoolUsed;
+    xSemaphoreGive(xStringPoolMutex);
+    xFree = xPortGetFreeHeapSize();
+    for (uint16_t i = 0; i < u16Count; i++)
+    {
+        const char *pcString = apcMeasureStrings[i % STRING_POOL_MEASURE_STRINGS];
+
+        pu16Handles[i] = u16ZCB_StringIntern((const uint8_t *)pcString, (uint8_t)strlen(pcString));
+        if (pu16Handles[i] == ZCB_STRING_NONE) {
+            u16Refused++;
+        }
+    }
+    u32InternHeapBytes = (uint32_t)(xFree - xPortGetFreeHeapSize());
+    xSemaphoreTake(xStringPoolMutex, portMAX_DELAY);
+    u16PoolAfter = u16PoolUsed;
+    xSemaphoreGive(xStringPoolMutex);
+
+    PRINTF("\n ### %d devices, %d strings each\n", u8Devices, (int)STRING_POOL_MEASURE_STRINGS);
+    PRINTF(" ### Heap buffers: %d allocations, %d heap bytes\n", u16Allocations, (int)u32HeapBytes);
+    PRINTF(" ### Interned:     0 allocations, %d heap bytes, %d pool bytes, %d refused\n",
+           (int)u32InternHeapBytes, u16PoolAfter - u16PoolBefore, u16Refused);
+    PRINTF(" ### Saved:        %d bytes\n", (int)u32HeapBytes - (u16PoolAfter - u16PoolBefore));
+
+    for (uint16_t i = 0; i < u16Count; i++)
+    {
+        vZCB_StringRelease(pu16Handles[i]);
+        vPortFree(ppu8Buffers[i]);
+    }
+    vPortFree(ppu8Buffers);
+    vPortFree(pu16Handles);
+}
+#endif
+
+void vZCB_StringPoolDump(void)
+{
+    if (xStringPoolMutex == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(xStringPoolMutex, portMAX_DELAY);
+    for (uint8_t i = 0; i < ZCB_STRING_POOL_MAX; i++)
+    {
+        const tsPoolString *psString = &asStrings[i];
+
+        if (psString->u16Refs == 0) {
+            continue;
+        }
+        PRINTF("\n ### [%d] refs=%d \"%s\"", i + 1, psString->u16Refs, (const char *)&au8Pool[psString->u16Offset]);
+    }
+    PRINTF("\n ### strings=%d bytes=%d/%d peak=%d interned=%d shared=%d full=%d saved=%d\n",
+           sStats.u16Strings, sStats.u16Bytes, ZCB_STRING_POOL_SIZE, sStats.u16PeakBytes,
+           (int)sStats.u32Interned, (int)sStats.u32Shared, (int)sStats.u32Full, (int)sStats.u32SavedBytes);
+    xSemaphoreGive(xStringPoolMutex);
+}
+
+void vZCB_StringPoolGetStats(tsZCB_StringPoolStats *psStats)
+{
+    if ((psStats == NULL) || (xStringPoolMutex == NULL)) {
+        return;
+    }
+
+    xSemaphoreTake(xStringPoolMutex, portMAX_DELAY);
+    *psStats = sStats;
+    xSemaphoreGive(xStringPoolMutex);
+}
+
+// ------------------------------------------------------------------
+// END OF FILE
+// ------------------------------------------------------------------
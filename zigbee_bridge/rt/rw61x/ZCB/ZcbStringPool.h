@@ -0,0 +1,94 @@
+/*
+ * Copyright 2021-2023 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef ZCBSTRINGPOOL_H
+#define ZCBSTRINGPOOL_H
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+/****************************************************************************/
+/***        Include files                                                 ***/
+/****************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "ZigbeeConstant.h"
+
+/****************************************************************************/
+/***        Macro Definitions                                             ***/
+/****************************************************************************/
+
+/* Bytes of the pool, the terminating nul of each string included */
+#define ZCB_STRING_POOL_SIZE                    1024
+/* Different strings kept at the same time */
+#define ZCB_STRING_POOL_MAX                     64
+/* Handle of no string, what a zeroed attribute holds */
+#define ZCB_STRING_NONE                         0
+
+
+/****************************************************************************/
+/***        Type Definitions                                              ***/
+/****************************************************************************/
+
+typedef struct
+{
+    uint32_t u32Interned;         /**< Strings asked for */
+    uint32_t u32Shared;           /**< Of them, found in the pool already */
+    uint32_t u32Full;             /**< Refused, no room */
+    uint16_t u16Strings;          /**< Different strings in the pool */
+    uint16_t u16Bytes;            /**< Pool bytes they take */
+    uint16_t u16PeakBytes;
+    uint32_t u32SavedBytes;       /**< Bytes a copy per reference would take more */
+} tsZCB_StringPoolStats;
+
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+
+void vZCB_StringPoolInit(void);
+
+/** A handle on the string, with a reference taken. Equal strings get the
+ *  same handle; ZCB_STRING_NONE when the pool has no room. */
+uint16_t u16ZCB_StringIntern(const uint8_t *pu8Data, uint8_t u8Length);
+
+/** Drop a reference, the string goes with the last one */
+void vZCB_StringRelease(uint16_t u16Handle);
+
+/** The nul terminated string, "" for ZCB_STRING_NONE. The strings move
+ *  when one is dropped: the pointer is only good until the next release,
+ *  copy it out with u8ZCB_StringCopy() otherwise. */
+const char *pcZCB_StringGet(uint16_t u16Handle);
+
+/** Copy the string to pcBuffer, cut to fit and nul terminated; its length */
+uint8_t u8ZCB_StringCopy(uint16_t u16Handle, char *pcBuffer, uint8_t u8Size);
+
+#if ZB_BRIDGE_TEST_COMMANDS
+/** Store the Basic cluster strings of u8Devices identical devices, first in
+ *  a heap buffer each as the attribute table did, then interned, and print
+ *  the heap allocations and bytes each way took. The strings are interned
+ *  into the live pool and may take the room of the attribute table's. */
+void vZCB_StringPoolMeasure(uint8_t u8Devices);
+#endif
+
+/** Print the strings with their references */
+void vZCB_StringPoolDump(void);
+
+void vZCB_StringPoolGetStats(tsZCB_StringPoolStats *psStats);
+
+#if defined __cplusplus
+}
+#endif
+
+#endif  /* ZCBSTRINGPOOL_H */
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
@@ -0,0 +1,599 @@
+/*
+ * Copyright 2021-2023 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+#include "fsl_debug_console.h"
+
+#include <string.h>
+#include <stdbool.h>
+
+#include "ZigbeeConstant.h"
+#include "SerialLink.h"
+#include "ZigbeeDevices.h"
+#include "cmd.h"
+#include "ZcbNodeFlow.h"
+#include "ZcbTopology.h"
+#include "ZcbDiscovery.h"
+
+/*
+ * Mesh topology collector.
+ *
+ * The coordinator and then every router found are asked for their neighbour
+ * table (Mgmt_Lqi_req), nearest routers first, one request at a time and
+ * spaced out so that user commands are never queued behind the walk. The
+ * tables are merged into a graph of nodes and links with their LQI. Once the
+ * walk is complete every node gets its hop count and the router it is
+ * reached through, preferring the strongest link among equally short paths,
+ * and routers carrying many nodes or carrying nodes over a weak uplink are
+ * marked as bottlenecks.
+ */
+
+#define TOPO_NONE                   0xFF
+
+/* Node indexes are bytes, 0xFF is none */
+#if ZCB_TOPO_MAX_NODES > 0xFF
+#error "ZCB_TOPO_MAX_NODES is 255 at most"
+#endif
+
+extern tsZbNetworkInfo zbNetworkInfo;
+
+typedef struct
+{
+    uint16_t    u16NwkAddr;
+    uint8_t     u8DeviceType;
+    uint8_t     u8Depth;
+    uint8_t     u8Hops;
+    uint8_t     u8Via;            /* node index, TOPO_NONE for the coordinator */
+    uint8_t     u8ViaLqi;
+    uint8_t     u8Descendants;
+    bool        bQueried;
+    bool        bBottleneck;
+} tsZCB_TopoNode;
+
+typedef struct
+{
+    uint8_t     u8From;
+    uint8_t     u8To;
+    uint8_t     u8Lqi;
+    uint8_t     u8Relationship;
+} tsZCB_TopoLink;
+
+static tsZCB_TopoNode asNodes[ZCB_TOPO_MAX_NODES];
+static tsZCB_TopoLink asLinks[ZCB_TOPO_MAX_LINKS];
+static uint8_t u8NodeCount;
+static uint16_t u16LinkCount;
+
+static SemaphoreHandle_t xTopoMutex = NULL;
+static tsZCB_TopologyStats sStats;
+static bool bWalking;
+static bool bWalkRequested;
+static uint8_t u8Pending = TOPO_NONE;     /* node whose table is being read */
+static uint8_t u8PendingStart;
+static uint8_t u8PendingSeq;              /* sequence number of its request */
+static bool bPendingSeq;                  /* ... known, the request was sent */
+static TickType_t xPendingDeadline;
+static TickType_t xNextRequest;
+static TickType_t xNextWalk;
+static bool bNextWalkSet;
+
+static void ZCB_HandleMgmtLqiResponse(void *pvUser, uint16_t u16Length, void *pvMessage);
+
+
+static uint8_t u8TopoFindNode(uint16_t u16NwkAddr)
+{
+    for (uint8_t i = 0; i < u8NodeCount; i++)
+    {
+        if (asNodes[i].u16NwkAddr == u16NwkAddr) {
+            return i;
+        }
+    }
+    return TOPO_NONE;
+}
+
+static uint8_t u8TopoAddNode(uint16_t u16NwkAddr, uint8_t u8DeviceType, uint8_t u8Depth)
+{
+    uint8_t u8Index = u8TopoFindNode(u16NwkAddr);
+
+    if (u8Index != TOPO_NONE) {
+        return u8Index;
+    }
+    if (u8NodeCount >= ZCB_TOPO_MAX_NODES) {
+        sStats.u32Overflows++;
+        return TOPO_NONE;
+    }
+
+    u8Index = u8NodeCount++;
+    memset(&asNodes[u8Index], 0, sizeof(tsZCB_TopoNode));
+    asNodes[u8Index].u16NwkAddr   = u16NwkAddr;
+    asNodes[u8Index].u8DeviceType = u8DeviceType;
+    asNodes[u8Index].u8Depth      = u8Depth;
+    asNodes[u8Index].u8Hops       = ZCB_TOPO_HOPS_UNKNOWN;
+    asNodes[u8Index].u8Via        = TOPO_NONE;
+    return u8Index;
+}
+
+static void vTopoAddLink(uint8_t u8From, uint8_t u8To, uint8_t u8Lqi, uint8_t u8Relationship)
+{
+    for (uint16_t i = 0; i < u16LinkCount; i++)
+    {
+        if ((asLinks[i].u8From == u8From) && (asLinks[i].u8To == u8To)) {
+            asLinks[i].u8Lqi = u8Lqi;
+            asLinks[i].u8Relationship = u8Relationship;
+            return;
+        }
+    }
+    if (u16LinkCount >= ZCB_TOPO_MAX_LINKS) {
+        sStats.u32Overflows++;
+        return;
+    }
+    asLinks[u16LinkCount].u8From         = u8From;
+    asLinks[u16LinkCount].u8To           = u8To;
+    asLinks[u16LinkCount].u8Lqi          = u8Lqi;
+    asLinks[u16LinkCount].u8Relationship = u8Relationship;
+    u16LinkCount++;
+}
+
+static void vTopoReset(void)
+{
+    u8NodeCount = 0;
+    u16LinkCount = 0;
+    u8Pending   = TOPO_NONE;
+    u8TopoAddNode(0x0000, 0, 0);
+    asNodes[0].u8Hops = 0;
+}
+
+/* Unqueried router or coordinator closest to the coordinator */
+static uint8_t u8TopoNextToQuery(void)
+{
+    uint8_t u8Best = TOPO_NONE;
+
+    for (uint8_t i = 0; i < u8NodeCount; i++)
+    {
+        if (asNodes[i].bQueried || (asNodes[i].u8DeviceType > 1)
+            || (asNodes[i].u8Hops > ZCB_TOPO_MAX_HOPS)) {
+            continue;
+        }
+        if ((u8Best == TOPO_NONE) || (asNodes[i].u8Hops < asNodes[u8Best].u8Hops)) {
+            u8Best = i;
+        }
+    }
+    return u8Best;
+}
+
+static void vTopoAnalyseLocked(void)
+{
+    bool bChanged = true;
+    uint8_t u8MaxHops = 0;
+    uint8_t u8Bottlenecks = 0;
+
+    for (uint8_t i = 0; i < u8NodeCount; i++)
+    {
+        asNodes[i].u8Hops        = (asNodes[i].u16NwkAddr == 0x0000) ? 0 : ZCB_TOPO_HOPS_UNKNOWN;
+        asNodes[i].u8Via         = TOPO_NONE;
+        asNodes[i].u8ViaLqi      = 0;
+        asNodes[i].u8Descendants = 0;
+        asNodes[i].bBottleneck   = false;
+    }
+
+    /* Shortest path over links, only routers and the coordinator relay */
+    while (bChanged)
+    {
+        bChanged = false;
+        for (uint16_t l = 0; l < u16LinkCount; l++)
+        {
+            for (uint8_t u8Dir = 0; u8Dir < 2; u8Dir++)
+            {
+                uint8_t u8A = u8Dir ? asLinks[l].u8To : asLinks[l].u8From;
+                uint8_t u8B = u8Dir ? asLinks[l].u8From : asLinks[l].u8To;
+                uint8_t u8Hops;
+
+                if ((asNodes[u8A].u8Hops == ZCB_TOPO_HOPS_UNKNOWN) || (asNodes[u8A].u8DeviceType > 1)) {
+                    continue;
+                }
+                u8Hops = asNodes[u8A].u8Hops + 1;
+                if ((u8Hops < asNodes[u8B].u8Hops)
+                    || ((u8Hops == asNodes[u8B].u8Hops) && (asLinks[l].u8Lqi > asNodes[u8B].u8ViaLqi))) {
+                    asNodes[u8B].u8Hops   = u8Hops;
+                    asNodes[u8B].u8Via    = u8A;
+                    asNodes[u8B].u8ViaLqi = asLinks[l].u8Lqi;
+                    bChanged = true;
+                }
+            }
+        }
+    }
+
+    /* Every node counts once for each router on its path */
+    for (uint8_t i = 0; i < u8NodeCount; i++)
+    {
+        uint8_t u8Via = asNodes[i].u8Via;
+
+        if (asNodes[i].u8Hops != ZCB_TOPO_HOPS_UNKNOWN && asNodes[i].u8Hops > u8MaxHops) {
+            u8MaxHops = asNodes[i].u8Hops;
+        }
+        for (uint8_t u8Guard = 0; (u8Via != TOPO_NONE) && (u8Guard < ZCB_TOPO_MAX_NODES); u8Guard++)
+        {
+            if (asNodes[u8Via].u8Descendants < 0xFF) {
+                asNodes[u8Via].u8Descendants++;
+            }
+            u8Via = asNodes[u8Via].u8Via;
+        }
+    }
+
+    for (uint8_t i = 0; i < u8NodeCount; i++)
+    {
+        if ((asNodes[i].u8DeviceType != 1) || (asNodes[i].u8Descendants == 0)) {
+            continue;
+        }
+        if ((asNodes[i].u8Descendants >= ZCB_TOPO_BOTTLENECK_DESCENDANTS)
+            || (asNodes[i].u8ViaLqi < ZCB_TOPO_WEAK_LQI)) {
+            asNodes[i].bBottleneck = true;
+            u8Bottlenecks++;
+        }
+    }
+
+    sStats.u8Nodes       = u8NodeCount;
+    sStats.u16Links      = u16LinkCount;
+    sStats.u8Bottlenecks = u8Bottlenecks;
+    sStats.u8MaxHops     = u8MaxHops;
+}
+
+void vZCB_TopologyInit(void)
+{
+    memset(&sStats, 0, sizeof(sStats));
+    bWalking       = false;
+    bWalkRequested = false;
+    bNextWalkSet   = false;
+    vTopoReset();
+
+    if (xTopoMutex == NULL) {
+        xTopoMutex = xSemaphoreCreateMutex();
+        eSL_AddListener(E_SL_MSG_MANAGEMENT_LQI_RESPONSE, ZCB_HandleMgmtLqiResponse, NULL);
+    }
+}
+
+void vZCB_TopologyStartWalk(void)
+{
+    bWalkRequested = true;
+}
+
+void vZCB_TopologyAddNeighbours(uint16_t u16FromAddr,
+                                const tsZCB_TopoNeighbour *psNeighbours,
+                                uint8_t u8Count)
+{
+    uint8_t u8From;
+    uint8_t u8To;
+
+    if (xTopoMutex == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(xTopoMutex, portMAX_DELAY);
+    u8From = u8TopoAddNode(u16FromAddr, (u16FromAddr == 0x0000) ? 0 : 1, 0);
+    if (u8From != TOPO_NONE) {
+        for (uint8_t i = 0; i < u8Count; i++)
+        {
+            u8To = u8TopoAddNode(psNeighbours[i].u16NwkAddr, psNeighbours[i].u8DeviceType, psNeighbours[i].u8Depth);
+            if ((u8To == TOPO_NONE) || (u8To == u8From)) {
+                continue;
+            }
+            vTopoAddLink(u8From, u8To, psNeighbours[i].u8Lqi, psNeighbours[i].u8Relationship);
+
+            /* Tentative distance, so the walk goes outwards ring by ring */
+            if ((asNodes[u8From].u8Hops != ZCB_TOPO_HOPS_UNKNOWN)
+                && (asNodes[u8From].u8Hops + 1 < asNodes[u8To].u8Hops)) {
+                asNodes[u8To].u8Hops = asNodes[u8From].u8Hops + 1;
+            }
+        }
+    }
+    xSemaphoreGive(xTopoMutex);
+}
+
+void vZCB_TopologyAnalyse(void)
+{
+    if (xTopoMutex == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(xTopoMutex, portMAX_DELAY);
+    vTopoAnalyseLocked();
+    xSemaphoreGive(xTopoMutex);
+}
+
+uint8_t u8ZCB_TopologyHopCount(uint16_t u16ShortAddress)
+{
+    uint8_t u8Index;
+    uint8_t u8Hops = ZCB_TOPO_HOPS_UNKNOWN;
+
+    if (xTopoMutex == NULL) {
+        return u8Hops;
+    }
+
+    xSemaphoreTake(xTopoMutex, portMAX_DELAY);
+    u8Index = u8TopoFindNode(u16ShortAddress);
+    if (u8Index != TOPO_NONE) {
+        u8Hops = asNodes[u8Index].u8Hops;
+    }
+    xSemaphoreGive(xTopoMutex);
+    return u8Hops;
+}
+
+bool bZCB_TopologyIsBottleneck(uint16_t u16ShortAddress)
+{
+    uint8_t u8Index;
+    bool bBottleneck = false;
+
+    if (xTopoMutex == NULL) {
+        return false;
+    }
+
+    xSemaphoreTake(xTopoMutex, portMAX_DELAY);
+    u8Index = u8TopoFindNode(u16ShortAddress);
+    if (u8Index != TOPO_NONE) {
+        bBottleneck = asNodes[u8Index].bBottleneck;
+    }
+    xSemaphoreGive(xTopoMutex);
+    return bBottleneck;
+}
+
+void vZCB_TopologyPoll(void)
+{
+    TickType_t xNow;
+    uint16_t u16Target;
+    uint8_t u8Start;
+    uint8_t u8Next;
+    uint8_t u8Seq;
+
+    if ((xTopoMutex == NULL) || (zbNetworkInfo.eNetworkState != E_ZB_NETWORK_STATE_NWK_FORMED)) {
+        return;
+    }
+
+    xNow = xTaskGetTickCount();
+    if (!bNextWalkSet) {
+        xNextWalk = xNow + pdMS_TO_TICKS(ZCB_TOPO_FIRST_WALK_MS);
+        bNextWalkSet = true;
+    }
+
+    if (!bWalking) {
+        if (!bWalkRequested && ((int32_t)(xNow - xNextWalk) < 0)) {
+            return;
+        }
+        xSemaphoreTake(xTopoMutex, portMAX_DELAY);
+        vTopoReset();
+        xSemaphoreGive(xTopoMutex);
+        bWalkRequested = false;
+        bWalking       = true;
+        xNextRequest   = xNow;
+    }
+
+    if ((int32_t)(xNow - xNextRequest) < 0) {
+        return;
+    }
+
+    xSemaphoreTake(xTopoMutex, portMAX_DELAY);
+    if ((u8Pending != TOPO_NONE) && ((int32_t)(xNow - xPendingDeadline) >= 0)) {
+        /* Router did not answer, go on without it */
+        asNodes[u8Pending].bQueried = true;
+        u8Pending = TOPO_NONE;
+        sStats.u32Timeouts++;
+    }
+    if (u8Pending != TOPO_NONE) {
+        /* Waiting for the response; a further page is asked for below */
+        if (u8PendingStart == 0) {
+            xSemaphoreGive(xTopoMutex);
+            return;
+        }
+        u8Next = u8Pending;
+    } else {
+        u8Next = u8TopoNextToQuery();
+    }
+
+    if (u8Next == TOPO_NONE) {
+        vTopoAnalyseLocked();
+        xSemaphoreGive(xTopoMutex);
+        bWalking  = false;
+        xNextWalk = xNow + pdMS_TO_TICKS(ZCB_TOPO_WALK_INTERVAL_MS);
+        sStats.u32Walks++;
+        PRINTF("\n ### Topology: %d nodes, %d links, %d bottleneck(s), up to %d hops\n",
+               sStats.u8Nodes, sStats.u16Links, sStats.u8Bottlenecks, sStats.u8MaxHops);
+        return;
+    }
+
+    u16Target = asNodes[u8Next].u16NwkAddr;
+    u8Start   = (u8Pending == u8Next) ? u8PendingStart : 0;
+    xSemaphoreGive(xTopoMutex);
+
+    xNextRequest = xNow + pdMS_TO_TICKS(ZCB_TOPO_REQUEST_INTERVAL_MS);
+
+    /* Routers backing off or offline are skipped in this walk */
+    if ((u16Target != 0x0000) && (eZCB_NodeFlowAcquire(u16Target) != E_ZCB_OK)) {
+        xSemaphoreTake(xTopoMutex, portMAX_DELAY);
+        asNodes[u8Next].bQueried = true;
+        u8Pending = TOPO_NONE;
+        xSemaphoreGive(xTopoMutex);
+        return;
+    }
+
+    xSemaphoreTake(xTopoMutex, portMAX_DELAY);
+    u8Pending        = u8Next;
+    u8PendingStart   = 0;
+    bPendingSeq      = false;
+    xPendingDeadline = xNow + pdMS_TO_TICKS(ZCB_TOPO_RESPONSE_TIMEOUT_MS);
+    xSemaphoreGive(xTopoMutex);
+
+    sStats.u32Requests++;
+    if (eMgmtLqiRequest(u16Target, u8Start, &u8Seq) != E_ZCB_OK) {
+        if (u16Target != 0x0000) {
+            vZCB_NodeFlowRelease(u16Target);
+        }
+        xSemaphoreTake(xTopoMutex, portMAX_DELAY);
+        asNodes[u8Next].bQueried = true;
+        u8Pending = TOPO_NONE;
+        xSemaphoreGive(xTopoMutex);
+        return;
+    }
+
+    /* The response is taken by its sequence number, unless the request timed
+     * out meanwhile */
+    xSemaphoreTake(xTopoMutex, portMAX_DELAY);
+    if (u8Pending == u8Next) {
+        u8PendingSeq = u8Seq;
+        bPendingSeq  = true;
+    }
+    xSemaphoreGive(xTopoMutex);
+}
+
+void vZCB_TopologyDump(void)
+{
+    uint16_t u16Printed = 0;
+
+    if (xTopoMutex == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(xTopoMutex, portMAX_DELAY);
+    PRINTF("\n Topology: %d nodes, %d links, %d bottleneck(s), up to %d hops%s\n",
+           sStats.u8Nodes, sStats.u16Links, sStats.u8Bottlenecks, sStats.u8MaxHops,
+           bWalking ? " (walk running)" : "");
+    PRINTF(" Node   T Hop Via    LQI Desc\n");
+    for (uint8_t i = 0; i < u8NodeCount; i++)
+    {
+        PRINTF(" 0x%04x %c ", asNodes[i].u16NwkAddr, "CRE?"[asNodes[i].u8DeviceType & 0x03]);
+        if (asNodes[i].u8Hops == ZCB_TOPO_HOPS_UNKNOWN) {
+            PRINTF("  -\n");
+            continue;
+        }
+        if (asNodes[i].u8Via == TOPO_NONE) {
+            PRINTF("%3d -        - %4d\n", asNodes[i].u8Hops, asNodes[i].u8Descendants);
+            continue;
+        }
+        PRINTF("%3d 0x%04x %3d %4d%s\n", asNodes[i].u8Hops, asNodes[asNodes[i].u8Via].u16NwkAddr,
+               asNodes[i].u8ViaLqi, asNodes[i].u8Descendants, asNodes[i].bBottleneck ? " B" : "");
+    }
+
+    PRINTF(" Links (from>to:lqi):");
+    for (uint16_t l = 0; l < u16LinkCount; l++)
+    {
+        if ((u16Printed++ % 6) == 0) {
+            PRINTF("\n ");
+        }
+        PRINTF(" %04x>%04x:%d", asNodes[asLinks[l].u8From].u16NwkAddr,
+               asNodes[asLinks[l].u8To].u16NwkAddr, asLinks[l].u8Lqi);
+    }
+    PRINTF("\n");
+    xSemaphoreGive(xTopoMutex);
+}
+
+void vZCB_TopologyGetStats(tsZCB_TopologyStats *psStats)
+{
+    if (psStats != NULL) {
+        *psStats = sStats;
+    }
+}
+
+uint32_t u32ZCB_TopologyRam(void)
+{
+    return sizeof(asNodes) + sizeof(asLinks);
+}
+
+static void ZCB_HandleMgmtLqiResponse(void *pvUser, uint16_t u16Length, void *pvMessage)
+{
+    struct _tsMgmtLqiEntry {
+        uint16_t    u16NwkAddr;
+        uint64_t    u64ExtPanId;
+        uint64_t    u64IeeeAddr;
+        uint8_t     u8Depth;
+        uint8_t     u8LinkQuality;
+        uint8_t     u8Bitmap;
+    } PACKED;
+    struct _tsMgmtLqiResponse {
+        uint8_t     u8SequenceNumber;
+        uint8_t     u8Status;
+        uint8_t     u8NeighbourTableEntries;
+        uint8_t     u8NeighbourTableListCount;
+        uint8_t     u8StartIndex;
+        struct _tsMgmtLqiEntry asEntries[];
+    } PACKED *psMessage = (struct _tsMgmtLqiResponse *)pvMessage;
+    tsZCB_TopoNeighbour asNeighbours[4];
+    uint16_t u16From;
+    uint8_t u8Node;
+    uint8_t u8Count;
+    uint8_t u8Next;
+
+    if ((xTopoMutex == NULL) || (u16Length < sizeof(struct _tsMgmtLqiResponse))) {
+        return;
+    }
+
+    /* The response does not name its source: it is the node of the request
+     * in flight when it has the sequence number of that request. A late
+     * response to a request which timed out is dropped. */
+    xSemaphoreTake(xTopoMutex, portMAX_DELAY);
+    if ((u8Pending == TOPO_NONE) || !bPendingSeq || (psMessage->u8SequenceNumber != u8PendingSeq)) {
+        sStats.u32Stale++;
+        xSemaphoreGive(xTopoMutex);
+        return;
+    }
+    u8Node  = u8Pending;
+    u16From = asNodes[u8Node].u16NwkAddr;
+    xSemaphoreGive(xTopoMutex);
+
+    if (u16From != 0x0000) {
+        vZCB_NodeFlowComplete(u16From, psMessage->u8Status == 0);
+    }
+
+    u8Count = psMessage->u8NeighbourTableListCount;
+    if ((psMessage->u8Status != 0)
+        || (u16Length < sizeof(struct _tsMgmtLqiResponse) + u8Count * sizeof(struct _tsMgmtLqiEntry))) {
+        u8Count = 0;
+    }
+
+    for (uint8_t i = 0; i < u8Count; )
+    {
+        uint8_t n;
+
+        for (n = 0; (n < 4) && (i < u8Count); n++, i++)
+        {
+            asNeighbours[n].u16NwkAddr     = pri_ntohs(psMessage->asEntries[i].u16NwkAddr);
+            asNeighbours[n].u8DeviceType   = psMessage->asEntries[i].u8Bitmap & 0x03;
+            asNeighbours[n].u8Relationship = (psMessage->asEntries[i].u8Bitmap >> 4) & 0x03;
+            asNeighbours[n].u8Depth        = psMessage->asEntries[i].u8Depth;
+            asNeighbours[n].u8Lqi          = psMessage->asEntries[i].u8LinkQuality;
+
+            /* Bits 2-3 are RxOnWhenIdle, off for a sleepy end device */
+            vZCB_DiscoveryNeighbour(asNeighbours[n].u16NwkAddr,
+                                    pri_ntohd(psMessage->asEntries[i].u64IeeeAddr),
+                                    ((psMessage->asEntries[i].u8Bitmap >> 2) & 0x03) == 0);
+        }
+        vZCB_TopologyAddNeighbours(u16From, asNeighbours, n);
+    }
+
+    /* The poll may have timed the request out or sent the next one since */
+    xSemaphoreTake(xTopoMutex, portMAX_DELAY);
+    if ((u8Pending != u8Node) || !bPendingSeq || (psMessage->u8SequenceNumber != u8PendingSeq)
+        || (asNodes[u8Node].u16NwkAddr != u16From)) {
+        sStats.u32Stale++;
+        xSemaphoreGive(xTopoMutex);
+        return;
+    }
+    bPendingSeq = false;
+    u8Next = psMessage->u8StartIndex + u8Count;
+    if ((u8Count > 0) && (u8Next < psMessage->u8NeighbourTableEntries)) {
+        /* More of the table to read, the next page is asked for by the poll */
+        u8PendingStart   = u8Next;
+        xPendingDeadline = xTaskGetTickCount() + pdMS_TO_TICKS(ZCB_TOPO_RESPONSE_TIMEOUT_MS);
+    } else {
+        asNodes[u8Pending].bQueried = true;
+        u8Pending = TOPO_NONE;
+    }
+    xSemaphoreGive(xTopoMutex);
+}
+
+// ------------------------------------------------------------------
+// END OF FILE
+// ------------------------------------------------------------------
@@ -0,0 +1,129 @@
+/*
+ * Copyright 2021-2023 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef ZCBTOPOLOGY_H
+#define ZCBTOPOLOGY_H
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+/****************************************************************************/
+/***        Include files                                                 ***/
+/****************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "zcb.h"
+
+/****************************************************************************/
+/***        Macro Definitions                                             ***/
+/****************************************************************************/
+
+/* Nodes and links kept in the graph: every node of the bridge and the
+ * coordinator, and two links each, a parent and one neighbour on average */
+#define ZCB_TOPO_MAX_NODES                      (ZB_BRIDGE_MAX_NODES + 1)
+#define ZCB_TOPO_MAX_LINKS                      (2 * ZCB_TOPO_MAX_NODES)
+
+/* Time between two walks of the network */
+#define ZCB_TOPO_WALK_INTERVAL_MS               (30 * 60 * 1000)
+/* First walk after the network is up */
+#define ZCB_TOPO_FIRST_WALK_MS                  (60 * 1000)
+/* Gap between two Mgmt_Lqi_req, so interactive traffic always goes first */
+#define ZCB_TOPO_REQUEST_INTERVAL_MS            2000
+/* A router not answering within this time is skipped */
+#define ZCB_TOPO_RESPONSE_TIMEOUT_MS            5000
+/* Routers further away than this are not queried */
+#define ZCB_TOPO_MAX_HOPS                       8
+
+/* A router is a bottleneck when this many nodes are reached through it ... */
+#define ZCB_TOPO_BOTTLENECK_DESCENDANTS         4
+/* ... or when it carries other nodes over an uplink weaker than this */
+#define ZCB_TOPO_WEAK_LQI                       64
+
+#define ZCB_TOPO_HOPS_UNKNOWN                   0xFF
+
+/* Neighbour table relationship */
+#define ZCB_TOPO_REL_PARENT                     0
+#define ZCB_TOPO_REL_CHILD                      1
+#define ZCB_TOPO_REL_SIBLING                    2
+#define ZCB_TOPO_REL_NONE                       3
+
+
+/****************************************************************************/
+/***        Type Definitions                                              ***/
+/****************************************************************************/
+
+/** One neighbour table entry as seen by the node queried */
+typedef struct
+{
+    uint16_t u16NwkAddr;
+    uint8_t  u8DeviceType;        /**< 0 coordinator, 1 router, 2 end device */
+    uint8_t  u8Relationship;      /**< ZCB_TOPO_REL_x */
+    uint8_t  u8Depth;
+    uint8_t  u8Lqi;
+} tsZCB_TopoNeighbour;
+
+typedef struct
+{
+    uint32_t u32Walks;            /**< Walks completed */
+    uint32_t u32Requests;         /**< Mgmt_Lqi_req sent */
+    uint32_t u32Timeouts;         /**< Routers which did not answer */
+    uint32_t u32Stale;            /**< Responses to no request in flight, dropped */
+    uint32_t u32Overflows;        /**< Nodes or links not kept, graph full */
+    uint8_t  u8Nodes;             /**< Nodes in the last graph */
+    uint16_t u16Links;            /**< Links in the last graph */
+    uint8_t  u8Bottlenecks;       /**< Bottleneck routers in the last graph */
+    uint8_t  u8MaxHops;           /**< Deepest node in the last graph */
+} tsZCB_TopologyStats;
+
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+
+void vZCB_TopologyInit(void);
+
+/** Start a new walk now instead of waiting for the next interval */
+void vZCB_TopologyStartWalk(void);
+
+/** Add the neighbour table of a node to the graph. Called with every
+ *  Mgmt_Lqi_rsp page; can also be fed a recorded or synthetic network. */
+void vZCB_TopologyAddNeighbours(uint16_t u16FromAddr,
+                                const tsZCB_TopoNeighbour *psNeighbours,
+                                uint8_t u8Count);
+
+/** Recompute hop counts and bottlenecks from the links collected */
+void vZCB_TopologyAnalyse(void);
+
+/** Hops from the coordinator, ZCB_TOPO_HOPS_UNKNOWN when not in the graph */
+uint8_t u8ZCB_TopologyHopCount(uint16_t u16ShortAddress);
+
+/** True when the node is a router marked as bottleneck */
+bool bZCB_TopologyIsBottleneck(uint16_t u16ShortAddress);
+
+/** Send the next request of a running walk, called from the ZCB service task */
+void vZCB_TopologyPoll(void);
+
+/** Print the graph, one line per node and one per link */
+void vZCB_TopologyDump(void);
+
+void vZCB_TopologyGetStats(tsZCB_TopologyStats *psStats);
+
+/** Static RAM of the graph */
+uint32_t u32ZCB_TopologyRam(void);
+
+#if defined __cplusplus
+}
+#endif
+
+#endif  /* ZCBTOPOLOGY_H */
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
@@ -0,0 +1,167 @@
+/*
+ * Copyright 2021-2023 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+#include "fsl_debug_console.h"
+
+#include <string.h>
+#include <stdbool.h>
+
+#include "SerialLink.h"
+#include "ZcbWatchdog.h"
+
+/*
+ * Coordinator liveness.
+ *
+ * Every valid frame from the coordinator counts as a heartbeat. When the
+ * link has been quiet for a while, or status responses are being missed,
+ * the coordinator is probed with a version request. After a few failed
+ * probes it is reset through its reset line and the watchdog waits for the
+ * restart message rather than a fixed delay, then resynchronises the
+ * bridge. The wait is a state checked on each poll, the service task does
+ * not block on it. A restart the coordinator did on its own is
+ * resynchronised the same way.
+ */
+
+static SemaphoreHandle_t xRestartSem = NULL;
+static volatile bool bRestartFactoryNew;
+static volatile uint8_t u8RestartStatus;
+
+static tsZCB_WatchdogStats sStats;
+static TickType_t xNextProbe;
+static TickType_t xFirstFailure;
+static uint8_t u8ProbeFailures;
+/* Reset pulsed, restart message awaited until xRestartDeadline */
+static bool bRestartAwaited;
+static TickType_t xRestartDeadline;
+
+
+static void vWatchdogResync(void)
+{
+    bRestartAwaited = false;
+    vZCB_CoordinatorResync(bRestartFactoryNew, u8RestartStatus);
+
+    if (xFirstFailure != 0) {
+        sStats.u32LastRecoveryMs = (uint32_t)(xTaskGetTickCount() - xFirstFailure) * portTICK_PERIOD_MS;
+        PRINTF("\n ### Coordinator recovered in %d ms\n", sStats.u32LastRecoveryMs);
+        xFirstFailure = 0;
+    }
+}
+
+static void vWatchdogReset(void)
+{
+    sStats.u32Resets++;
+    PRINTF("\n ### Coordinator not responding, resetting it\n");
+
+    /* Drop a restart indication left from before */
+    xSemaphoreTake(xRestartSem, 0);
+
+    vZCB_PulseCoordinatorReset();
+
+    /* The restart message is looked for on the next polls */
+    bRestartAwaited  = true;
+    xRestartDeadline = xTaskGetTickCount() + pdMS_TO_TICKS(ZCB_WATCHDOG_RESTART_TIMEOUT_MS);
+}
+
+void vZCB_WatchdogInit(void)
+{
+    memset(&sStats, 0, sizeof(sStats));
+    xNextProbe      = 0;
+    xFirstFailure   = 0;
+    u8ProbeFailures = 0;
+    bRestartAwaited = false;
+
+    if (xRestartSem == NULL) {
+        xRestartSem = xSemaphoreCreateBinary();
+    }
+}
+
+void vZCB_WatchdogRestartIndication(bool bFactoryNew, uint8_t u8Status)
+{
+    if (xRestartSem == NULL) {
+        return;
+    }
+
+    bRestartFactoryNew = bFactoryNew;
+    u8RestartStatus    = u8Status;
+    sStats.u32Restarts++;
+    xSemaphoreGive(xRestartSem);
+}
+
+void vZCB_WatchdogPoll(void)
+{
+    TickType_t xNow;
+    TickType_t xIdle;
+
+    if (xRestartSem == NULL) {
+        return;
+    }
+
+    /* The coordinator restarted, after a reset or without being asked to */
+    if (xSemaphoreTake(xRestartSem, 0) == pdTRUE) {
+        vWatchdogResync();
+        return;
+    }
+
+    xNow = xTaskGetTickCount();
+    if (bRestartAwaited) {
+        if ((int32_t)(xNow - xRestartDeadline) < 0) {
+            return;
+        }
+        bRestartAwaited = false;
+        sStats.u32ResetFailures++;
+        PRINTF("\n ### Coordinator did not restart after reset\n");
+        xNextProbe = xNow + pdMS_TO_TICKS(ZCB_WATCHDOG_RESET_RETRY_MS);
+        return;
+    }
+
+    if ((int32_t)(xNow - xNextProbe) < 0) {
+        return;
+    }
+
+    xIdle = xNow - (TickType_t)u32SL_GetLastRxTick();
+    if ((xIdle < pdMS_TO_TICKS(ZCB_WATCHDOG_IDLE_MS))
+        && (u8SL_GetStatusTimeoutStreak() < ZCB_WATCHDOG_STATUS_TIMEOUT_STREAK)
+        && (u8ProbeFailures == 0)) {
+        return;
+    }
+
+    sStats.u32Probes++;
+    if (eZCB_GetCoordinatorVersion() == E_ZCB_OK) {
+        u8ProbeFailures = 0;
+        xFirstFailure   = 0;
+        return;
+    }
+
+    sStats.u32ProbeFailures++;
+    if (u8ProbeFailures++ == 0) {
+        xFirstFailure = xNow;
+    }
+    PRINTF("\n ### Coordinator probe failed (%d)\n", u8ProbeFailures);
+
+    if (u8ProbeFailures < ZCB_WATCHDOG_MAX_PROBE_FAILURES) {
+        xNextProbe = xNow + pdMS_TO_TICKS(ZCB_WATCHDOG_PROBE_RETRY_MS);
+        return;
+    }
+
+    u8ProbeFailures = 0;
+    vWatchdogReset();
+}
+
+void vZCB_WatchdogGetStats(tsZCB_WatchdogStats *psStats)
+{
+    if (psStats != NULL) {
+        *psStats = sStats;
+    }
+}
+
+// ------------------------------------------------------------------
+// END OF FILE
+// ------------------------------------------------------------------
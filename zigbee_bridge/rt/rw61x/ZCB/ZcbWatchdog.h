@@ -0,0 +1,79 @@
+/*
+ * Copyright 2021-2023 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef ZCBWATCHDOG_H
+#define ZCBWATCHDOG_H
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+/****************************************************************************/
+/***        Include files                                                 ***/
+/****************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "zcb.h"
+
+/****************************************************************************/
+/***        Macro Definitions                                             ***/
+/****************************************************************************/
+
+/* Probe the coordinator after this long without any frame from it */
+#define ZCB_WATCHDOG_IDLE_MS                    30000
+/* ... or as soon as this many status responses in a row were missed */
+#define ZCB_WATCHDOG_STATUS_TIMEOUT_STREAK      2
+/* Delay between probes once one has failed */
+#define ZCB_WATCHDOG_PROBE_RETRY_MS             1000
+/* Failed probes in a row before the coordinator is reset */
+#define ZCB_WATCHDOG_MAX_PROBE_FAILURES         3
+/* Time allowed for the restart message after the reset pulse */
+#define ZCB_WATCHDOG_RESTART_TIMEOUT_MS         5000
+/* Delay before trying again when the coordinator did not restart */
+#define ZCB_WATCHDOG_RESET_RETRY_MS             10000
+
+
+/****************************************************************************/
+/***        Type Definitions                                              ***/
+/****************************************************************************/
+
+typedef struct
+{
+    uint32_t u32Probes;           /**< Liveness probes sent */
+    uint32_t u32ProbeFailures;    /**< Probes not answered */
+    uint32_t u32Resets;           /**< Coordinator resets done by the watchdog */
+    uint32_t u32ResetFailures;    /**< Resets not followed by a restart message */
+    uint32_t u32Restarts;         /**< Restart messages seen, solicited or not */
+    uint32_t u32LastRecoveryMs;   /**< First failed probe to resync done */
+} tsZCB_WatchdogStats;
+
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+
+void vZCB_WatchdogInit(void);
+
+/** E_SL_MSG_RESTART_PROVISIONED / E_SL_MSG_RESTART_FACTORY_NEW received */
+void vZCB_WatchdogRestartIndication(bool bFactoryNew, uint8_t u8Status);
+
+/** Check coordinator liveness, called from the ZCB service task */
+void vZCB_WatchdogPoll(void);
+
+void vZCB_WatchdogGetStats(tsZCB_WatchdogStats *psStats);
+
+#if defined __cplusplus
+}
+#endif
+
+#endif  /* ZCBWATCHDOG_H */
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
@@ -22,6 +22,28 @@ extern "C" {
 
 #define ZB_DEFAULT_ENDPOINT_ZLL             3
 
+/* Zigbee nodes the bridge keeps. The device and attribute tables, the
+ * joined nodes, the liveness wheel, the topology graph, the discovery sweep
+ * and the per node state of the ZCB modules are all sized from it; the
+ * address cache and the resync read table are deliberately smaller, see
+ * ZcbAddrCache.h and ZcbResync.h. 200 is the deployment profile; a build
+ * changes it with zigbee_bridge_max_nodes in the GN arguments. 254 at most,
+ * a device table index is a byte and 0xFF stands for none. */
+#ifndef ZB_BRIDGE_MAX_NODES
+#define ZB_BRIDGE_MAX_NODES                 200
+#endif
+/* Static RAM the node registry may take at that capacity, see
+ * vZCB_RegistryBudget() */
+#ifndef ZB_BRIDGE_RAM_BUDGET
+#define ZB_BRIDGE_RAM_BUDGET                (128 * 1024)
+#endif
+/* Shell commands which fill tables of their own with synthetic nodes to
+ * time them; test builds only, zigbee_bridge_test_commands in the GN
+ * arguments */
+#ifndef ZB_BRIDGE_TEST_COMMANDS
+#define ZB_BRIDGE_TEST_COMMANDS             0
+#endif
+
 /****************************************************************************/
 /***        Type Definitions                                              ***/
 /****************************************************************************/
@@ -151,6 +173,9 @@ typedef enum
     E_ZB_CLUSTERID_MEASUREMENTSENSING_HUM   = 0x0405,
     E_ZB_CLUSTERID_OCCUPANCYSENSING         = 0x0406,
 
+    /* Security and Safety */
+    E_ZB_CLUSTERID_IAS_ZONE                 = 0x0500,
+
     /* Metering */
     E_ZB_CLUSTERID_SIMPLE_METERING          = 0x0702,
 
@@ -295,6 +320,16 @@ typedef enum
      E_ZB_ATTRIBUTEID_MS_OCC_OCCUPANCY = 0x0000,
 } eZigbee_AttributeIDOccupancyCluster;
 
+/** Enumerated type of attributes in the IAS Zone Cluster */
+typedef enum
+{
+     E_ZB_ATTRIBUTEID_IAS_ZONE_STATE          = 0x0000,
+     E_ZB_ATTRIBUTEID_IAS_ZONE_TYPE           = 0x0001,
+     E_ZB_ATTRIBUTEID_IAS_ZONE_STATUS         = 0x0002,
+     E_ZB_ATTRIBUTEID_IAS_CIE_ADDRESS         = 0x0010,
+     E_ZB_ATTRIBUTEID_IAS_ZONE_ID             = 0x0011,
+} eZigbee_AttributeIDIASZoneCluster;
+
 /* Unit Of Measure enumerations (D.3.2.2.4.1) */
 typedef enum
 {
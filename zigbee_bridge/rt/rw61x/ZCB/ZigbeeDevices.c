@@ -18,6 +18,7 @@
 #include "fsl_debug_console.h"
 
 #include <stdio.h>
+#include <stddef.h>
 #include <string.h>
 #include <stdbool.h>
 
@@ -27,10 +28,12 @@
 #include "serial.h"
 #include "zcb.h"
 #include "cmd.h"
+#include "ZcbNodeFlow.h"
+#include "ZcbStringPool.h"
+#include "ZcbIndex.h"
 
 #define ZB_DEVICE_TABLE_NULL_NODE_ID            0
 #define ZB_DEVICE_TABLE_NULL_IEEE_ADDR          0
-#define ZB_DEVICE_ENDPOINT_COUNT_DEFAULT        1
 
 
 tsZbNetworkInfo zbNetworkInfo;
@@ -76,17 +79,324 @@ static bool bZD_ValidityCheckOfEndpointId(uint8_t u8Endpoint)
 
 
 
+/*
+ * Lookup indexes of the device table.
+ *
+ * Every report, announce, leave and device timer looks its node up by short
+ * or IEEE address; both used to scan the whole table. Each address now has
+ * a hash index into the table, see ZcbIndex.c, kept up to date on insert,
+ * erase and short address change, and rebuilt once too many deleted marks
+ * have piled up. The free entries of the table are chained, a join takes
+ * no scan either.
+ *
+ * Attributes are found the same way, through one more index keyed by node,
+ * endpoint, cluster and attribute together. The attributes of a device are
+ * also chained from its device table entry, and the unused entries of the
+ * attribute table from a free list: adding an attribute takes no scan, and
+ * the attributes of a node are erased or moved to a new short address by
+ * walking its own chain.
+ */
+
+#define ZB_DEVICE_INDEX_NONE                    ZCB_INDEX_NONE
+#define ZB_DEVICE_FREE_NONE                     0xFF
+
+/* Device table indexes are bytes, 0xFF is none */
+#if MAX_ZD_DEVICE_NUMBERS > 254
+#error "ZB_BRIDGE_MAX_NODES is 254 at most"
+#endif
+
+/* Attribute key: node, endpoint, cluster and attribute, the packed start of
+ * each attribute entry */
+#define ZB_ATTRIBUTE_KEY_SIZE                   offsetof(tsZbDeviceAttribute, u8DataType)
+/* Attributes per device of the benchmark */
+#define ZB_DEVICE_INDEX_BENCH_ATTRIBUTES        4
+
+/* Lookups timed per address kind by the benchmark, and its largest table */
+#define ZB_DEVICE_INDEX_BENCH_LOOKUPS           100000
+#define ZB_DEVICE_INDEX_BENCH_MAX               1000
+
+static uint16_t au16NodeIdSlots[MAX_ZD_DEVICE_INDEX_SLOTS];
+static uint16_t au16IeeeAddrSlots[MAX_ZD_DEVICE_INDEX_SLOTS];
+
+static tsZCB_Index sNodeIdIndex =
+{
+    au16NodeIdSlots, MAX_ZD_DEVICE_INDEX_SLOTS - 1, 0,
+    (const uint8_t *)&deviceTable[0].u16NodeId, sizeof(tsZbDeviceInfo), sizeof(uint16_t)
+};
+
+static tsZCB_Index sIeeeAddrIndex =
+{
+    au16IeeeAddrSlots, MAX_ZD_DEVICE_INDEX_SLOTS - 1, 0,
+    (const uint8_t *)&deviceTable[0].u64IeeeAddress, sizeof(tsZbDeviceInfo), sizeof(uint64_t)
+};
+
+static uint16_t au16AttributeSlots[MAX_ZD_ATTRIBUTE_INDEX_SLOTS];
+
+static tsZCB_Index sAttributeIndex =
+{
+    au16AttributeSlots, MAX_ZD_ATTRIBUTE_INDEX_SLOTS - 1, 0,
+    (const uint8_t *)&attributeTable[0], sizeof(tsZbDeviceAttribute), ZB_ATTRIBUTE_KEY_SIZE
+};
+
+/* Chains of attribute entries, ZB_DEVICE_INDEX_NONE ends one: the
+ * attributes of each device, and the free entries */
+static uint16_t au16AttributeNext[MAX_ZD_ATTRIBUTE_NUMBERS_TOTAL];
+static uint16_t au16DeviceAttributes[MAX_ZD_DEVICE_NUMBERS];
+static uint16_t u16AttributeFree;
+
+/* Chain of the free device table entries, ZB_DEVICE_FREE_NONE ends it */
+static uint8_t au8DeviceNextFree[MAX_ZD_DEVICE_NUMBERS];
+static uint8_t u8DeviceFree;
+
+
+
+static uint64_t u64ZD_AttributeKey(uint16_t u16NodeId, uint8_t u8Endpoint,
+                                   uint16_t u16ClusterId, uint16_t u16AttributeId)
+{
+    tsZbDeviceAttribute sKey;
+    uint64_t u64Key = 0;
+
+    sKey.u16NodeId      = u16NodeId;
+    sKey.u8Endpoint     = u8Endpoint;
+    sKey.u16ClusterId   = u16ClusterId;
+    sKey.u16AttributeId = u16AttributeId;
+    memcpy(&u64Key, &sKey, ZB_ATTRIBUTE_KEY_SIZE);
+    return u64Key;
+}
+
+
+
+static void vZD_DeviceIndexRebuild(void)
+{
+    vZCB_IndexClear(&sNodeIdIndex);
+    vZCB_IndexClear(&sIeeeAddrIndex);
+
+    for (uint16_t i = 0; i < MAX_ZD_DEVICE_NUMBERS; i++)
+    {
+        if (deviceTable[i].u16NodeId != ZB_DEVICE_TABLE_NULL_NODE_ID) {
+            vZCB_IndexInsert(&sNodeIdIndex, i);
+            vZCB_IndexInsert(&sIeeeAddrIndex, i);
+        }
+    }
+}
+
+
+
+static void vZD_AttributeIndexRebuild(void)
+{
+    vZCB_IndexClear(&sAttributeIndex);
+
+    for (uint16_t i = 0; i < MAX_ZD_ATTRIBUTE_NUMBERS_TOTAL; i++)
+    {
+        if (attributeTable[i].u16NodeId != ZB_DEVICE_TABLE_NULL_NODE_ID) {
+            vZCB_IndexInsert(&sAttributeIndex, i);
+        }
+    }
+}
+
+
+
+/* Empty attribute table: every entry on the free list, no device chain */
+static void vZD_AttributeChainsReset(void)
+{
+    for (uint16_t i = 0; i < MAX_ZD_ATTRIBUTE_NUMBERS_TOTAL; i++)
+    {
+        au16AttributeNext[i] = i + 1;
+    }
+    au16AttributeNext[MAX_ZD_ATTRIBUTE_NUMBERS_TOTAL - 1] = ZB_DEVICE_INDEX_NONE;
+    u16AttributeFree = 0;
+
+    for (uint16_t i = 0; i < MAX_ZD_DEVICE_NUMBERS; i++)
+    {
+        au16DeviceAttributes[i] = ZB_DEVICE_INDEX_NONE;
+    }
+}
+
+
+
+/* Empty device table: every entry free, the lowest taken first */
+static void vZD_DeviceFreeReset(void)
+{
+    for (uint8_t i = 0; i < MAX_ZD_DEVICE_NUMBERS; i++)
+    {
+        au8DeviceNextFree[i] = i + 1;
+    }
+    au8DeviceNextFree[MAX_ZD_DEVICE_NUMBERS - 1] = ZB_DEVICE_FREE_NONE;
+    u8DeviceFree = 0;
+}
+
+
+
+/* Deleted marks lengthen the probes, they go once a quarter of the slots has one */
+static void vZD_AttributeIndexTidy(void)
+{
+    if (bZCB_IndexNeedsRebuild(&sAttributeIndex)) {
+        vZD_AttributeIndexRebuild();
+    }
+}
+
+
+
+static void vZD_DeviceIndexTidy(void)
+{
+    if (bZCB_IndexNeedsRebuild(&sNodeIdIndex) || bZCB_IndexNeedsRebuild(&sIeeeAddrIndex)) {
+        vZD_DeviceIndexRebuild();
+    }
+}
+
+
+
+/*
+ * Endpoint and cluster records of the devices.
+ *
+ * Each device used to carry room for MAX_ZD_ENDPOINT_NUMBERS_PER_DEV
+ * endpoints of MAX_ZD_CLUSTER_NUMBERS_PER_EP clusters, 245 bytes, when most
+ * have one or two endpoints and a handful of clusters. They now live in one
+ * arena, a record per device sized to what the node has: an offset per
+ * endpoint, for O(1) access by position, then each endpoint followed by its
+ * clusters. The records are kept back to back; one which grows or goes
+ * moves those behind it, so the free space is always in one piece at the end.
+ *
+ * A record moves under the pointers of any task, the serial callback task
+ * writing endpoints while the service task walks another node's clusters.
+ * Every change of the arena and every use of a pointer into it is made
+ * under the arena lock, vZDM_ArenaLock(). It is taken again by its holder
+ * without blocking, so the functions below which take it may be called
+ * with it held.
+ */
+
+#define ZB_DEVICE_RECORD_NONE                   0xFFFF
+
+/* The endpoint offsets of a record are bytes */
+#if (MAX_ZD_ENDPOINT_NUMBERS_PER_DEV * (5 + 3 * MAX_ZD_CLUSTER_NUMBERS_PER_EP)) > 255
+#error "Device records too large for their endpoint offsets"
+#endif
+
+/* What the fixed size arrays took per device */
+#define ZB_DEVICE_FIXED_SIZE    (sizeof(tsZbDeviceInfo) + MAX_ZD_ENDPOINT_NUMBERS_PER_DEV \
+                                 * (sizeof(tsZbDeviceEndPoint) + MAX_ZD_CLUSTER_NUMBERS_PER_EP * sizeof(tsZbDeviceCluster)))
+
+static uint8_t  au8DeviceArena[MAX_ZD_DEVICE_ARENA_SIZE];
+static uint16_t u16ArenaUsed;
+static uint16_t u16ArenaPeak;
+static uint32_t u32ArenaFull;
+static uint32_t u32ArenaMoved;
+/* Offset and size of the record of each device */
+static uint16_t au16Record[MAX_ZD_DEVICE_NUMBERS];
+static uint16_t au16RecordSize[MAX_ZD_DEVICE_NUMBERS];
+
+static SemaphoreHandle_t xArenaMutex = NULL;
+static TaskHandle_t xArenaOwner = NULL;
+static uint8_t u8ArenaDepth;
+
+/* The registry tables alone must leave room in the budget for the per node
+ * state of the other modules */
+typedef char acRegistryFitsBudget[(sizeof(deviceTable) + sizeof(attributeTable) + sizeof(au16NodeIdSlots)
+                                   + sizeof(au16IeeeAddrSlots) + sizeof(au16AttributeSlots)
+                                   + sizeof(au16AttributeNext) + sizeof(au8DeviceArena)
+                                   < ZB_BRIDGE_RAM_BUDGET) ? 1 : -1];
+
+
+
+void vZDM_ArenaLock(void)
+{
+    if (xArenaMutex == NULL) {
+        return;
+    }
+    /* Only this task sets the owner to itself, it is read without the lock */
+    if (xArenaOwner == xTaskGetCurrentTaskHandle()) {
+        u8ArenaDepth++;
+        return;
+    }
+    xSemaphoreTake(xArenaMutex, portMAX_DELAY);
+    xArenaOwner  = xTaskGetCurrentTaskHandle();
+    u8ArenaDepth = 1;
+}
+
+
+
+void vZDM_ArenaUnlock(void)
+{
+    if ((xArenaMutex == NULL) || (xArenaOwner != xTaskGetCurrentTaskHandle())) {
+        return;
+    }
+    if (--u8ArenaDepth == 0) {
+        xArenaOwner = NULL;
+        xSemaphoreGive(xArenaMutex);
+    }
+}
+
+
+
+/* Open a gap of i16Delta bytes u16At bytes into the record of the device, or
+ * close one when i16Delta is negative; the records behind it move. Called
+ * with the arena lock held. */
+static bool bZD_RecordResize(uint8_t u8Device, uint16_t u16At, int16_t i16Delta)
+{
+    uint16_t u16Start = au16Record[u8Device];
+    uint16_t u16Pos   = u16Start + u16At;
+
+    if (i16Delta > 0) {
+        if (u16ArenaUsed + i16Delta > MAX_ZD_DEVICE_ARENA_SIZE) {
+            u32ArenaFull++;
+            return false;
+        }
+        memmove(&au8DeviceArena[u16Pos + i16Delta], &au8DeviceArena[u16Pos], u16ArenaUsed - u16Pos);
+        memset(&au8DeviceArena[u16Pos], 0, i16Delta);
+        u32ArenaMoved += u16ArenaUsed - u16Pos;
+    } else {
+        memmove(&au8DeviceArena[u16Pos], &au8DeviceArena[u16Pos - i16Delta], u16ArenaUsed - u16Pos + i16Delta);
+        u32ArenaMoved += u16ArenaUsed - u16Pos + i16Delta;
+    }
+    u16ArenaUsed += i16Delta;
+    au16RecordSize[u8Device] += i16Delta;
+    if (u16ArenaUsed > u16ArenaPeak) {
+        u16ArenaPeak = u16ArenaUsed;
+    }
+
+    for (uint8_t i = 0; i < MAX_ZD_DEVICE_NUMBERS; i++)
+    {
+        if ((au16Record[i] != ZB_DEVICE_RECORD_NONE) && (au16Record[i] > u16Start)) {
+            au16Record[i] += i16Delta;
+        }
+    }
+    return true;
+}
+
+
+
+static void vZD_RecordFree(uint8_t u8Device)
+{
+    if (au16Record[u8Device] != ZB_DEVICE_RECORD_NONE) {
+        bZD_RecordResize(u8Device, 0, -(int16_t)au16RecordSize[u8Device]);
+        au16Record[u8Device] = ZB_DEVICE_RECORD_NONE;
+    }
+    deviceTable[u8Device].u8EndpointCount = 0;
+}
+
+
+
+static void vZD_ArenaReset(void)
+{
+    u16ArenaUsed = 0;
+    for (uint8_t i = 0; i < MAX_ZD_DEVICE_NUMBERS; i++)
+    {
+        au16Record[i]     = ZB_DEVICE_RECORD_NONE;
+        au16RecordSize[i] = 0;
+    }
+}
+
+
+
 uint8_t uZDM_FindDevTableIndexByNodeId(uint16_t u16NodeId)
 {
 	if (!bZD_ValidityCheckOfNodeId(u16NodeId)) {		
 		return 0xFF;
 	}
-    
-	for(uint8_t i = 0; i < MAX_ZD_DEVICE_NUMBERS; i++)
-	{
-		if(deviceTable[i].u16NodeId == u16NodeId) {
-			return i;
-		}
+
+	uint16_t u16Index = u16ZCB_IndexFind(&sNodeIdIndex, u16NodeId);
+	if (u16Index != ZB_DEVICE_INDEX_NONE) {
+		return (uint8_t)u16Index;
 	}
     
 //	LOG(ZDM, WARN, "No this device exits in current device table!\r\n");
@@ -97,7 +407,7 @@ uint8_t uZDM_FindDevTableIndexByNodeId(uint16_t u16NodeId)
 
 tsZbDeviceInfo* tZDM_FindDeviceByIndex(uint8_t u8Index)
 {
-	if (u8Index > MAX_ZD_DEVICE_NUMBERS) {
+	if (u8Index >= MAX_ZD_DEVICE_NUMBERS) {
 		return NULL;
 	}	
 	return &(deviceTable[u8Index]);
@@ -110,11 +420,9 @@ tsZbDeviceInfo* tZDM_FindDeviceByNodeId(uint16_t u16NodeId)
 		return NULL;
 	}
 	
-	for(uint8_t i = 0; i < MAX_ZD_DEVICE_NUMBERS; i++)
-	{
-		if(deviceTable[i].u16NodeId == u16NodeId) {
-			return &(deviceTable[i]);
-		}
+	uint16_t u16Index = u16ZCB_IndexFind(&sNodeIdIndex, u16NodeId);
+	if (u16Index != ZB_DEVICE_INDEX_NONE) {
+		return &(deviceTable[u16Index]);
 	}
 //	LOG(ZDM, WARN, "No this device exits in current device table!\r\n");
 	return NULL;
@@ -128,11 +436,9 @@ tsZbDeviceInfo* tZDM_FindDeviceByIeeeAddress(uint64_t u64IeeeAddr)
 		return NULL;
 	}
 
-	for(uint8_t i = 0; i < MAX_ZD_DEVICE_NUMBERS; i++)
-	{
-		if(deviceTable[i].u64IeeeAddress == u64IeeeAddr) {
-			return &(deviceTable[i]);
-		}
+	uint16_t u16Index = u16ZCB_IndexFind(&sIeeeAddrIndex, u64IeeeAddr);
+	if (u16Index != ZB_DEVICE_INDEX_NONE) {
+		return &(deviceTable[u16Index]);
 	}
 //	LOG(ZDM, WARN, "No this device exits in current device table!\r\n");
 	return NULL;	
@@ -150,19 +456,21 @@ tsZbDeviceInfo* tZDM_AddNewDeviceToDeviceTable(uint16_t u16NodeId, uint64_t u64I
 		return NULL;
 	}    
 
-	for (uint8_t i = 0; i < MAX_ZD_DEVICE_NUMBERS; i++)
-	{	
-	    if (deviceTable[i].u16NodeId == ZB_DEVICE_TABLE_NULL_NODE_ID) {
-			memset(&(deviceTable[i]), 0, sizeof(tsZbDeviceInfo));
-			deviceTable[i].u16NodeId = u16NodeId;
-			deviceTable[i].u64IeeeAddress = u64IeeeAddr;
-			deviceTable[i].eDeviceState = E_ZB_DEVICE_STATE_NEW_JOINED;
-            zbNetworkInfo.u16DeviceCount ++;
-			return &(deviceTable[i]);
-		}		
-	}
+	uint8_t i = u8DeviceFree;
+	if (i == ZB_DEVICE_FREE_NONE) {
 //	LOG(ZDM, WARN, "The device table is full already!\r\n");
-	return NULL;
+		return NULL;
+	}
+	u8DeviceFree = au8DeviceNextFree[i];
+
+	memset(&(deviceTable[i]), 0, sizeof(tsZbDeviceInfo));
+	deviceTable[i].u16NodeId = u16NodeId;
+	deviceTable[i].u64IeeeAddress = u64IeeeAddr;
+	deviceTable[i].eDeviceState = E_ZB_DEVICE_STATE_NEW_JOINED;
+	vZCB_IndexInsert(&sNodeIdIndex, i);
+	vZCB_IndexInsert(&sIeeeAddrIndex, i);
+    zbNetworkInfo.u16DeviceCount ++;
+	return &(deviceTable[i]);
 }
 
 
@@ -181,20 +489,35 @@ tsZbDeviceAttribute* tZDM_AddNewAttributeToAttributeTable(uint16_t u16NodeId,
 		return NULL;
 	}
 
-    for (uint16_t i = 0; i < MAX_ZD_ATTRIBUTE_NUMBERS_TOTAL; i++) {
-        if (attributeTable[i].u16NodeId == ZB_DEVICE_TABLE_NULL_NODE_ID) {
-            attributeTable[i].u16NodeId      = u16NodeId;
-            attributeTable[i].u8Endpoint     = u8Endpoint;
-            attributeTable[i].u16ClusterId   = u16ClusterId;
-            attributeTable[i].u16AttributeId = u16AttributeId;
-            attributeTable[i].u8DataType     = u8DataType;
-            tsZbDeviceCluster* devCluster = tZDM_FindClusterEntryInDeviceTable(u16NodeId, u8Endpoint, u16ClusterId);
-            devCluster->u8AttributeCount ++;
-            return &(attributeTable[i]);
-        }
+    uint8_t u8Device = uZDM_FindDevTableIndexByNodeId(u16NodeId);
+    if (u8Device == 0xFF) {
+        return NULL;
     }
+
+    uint16_t i = u16AttributeFree;
+    if (i == ZB_DEVICE_INDEX_NONE) {
 //    LOG(ZDM, WARN, "The attribute table is full already!\r\n");
-    return NULL;
+        return NULL;
+    }
+    u16AttributeFree = au16AttributeNext[i];
+
+    memset(&(attributeTable[i]), 0, sizeof(tsZbDeviceAttribute));
+    attributeTable[i].u16NodeId      = u16NodeId;
+    attributeTable[i].u8Endpoint     = u8Endpoint;
+    attributeTable[i].u16ClusterId   = u16ClusterId;
+    attributeTable[i].u16AttributeId = u16AttributeId;
+    attributeTable[i].u8DataType     = u8DataType;
+    au16AttributeNext[i] = au16DeviceAttributes[u8Device];
+    au16DeviceAttributes[u8Device] = i;
+    vZCB_IndexInsert(&sAttributeIndex, i);
+
+    vZDM_ArenaLock();
+    tsZbDeviceCluster* devCluster = tZDM_FindClusterEntryInDeviceTable(u16NodeId, u8Endpoint, u16ClusterId);
+    if (devCluster != NULL) {
+        devCluster->u8AttributeCount ++;
+    }
+    vZDM_ArenaUnlock();
+    return &(attributeTable[i]);
 }
 
 
@@ -206,10 +529,14 @@ tsZbDeviceEndPoint* tZDM_FindEndpointEntryInDeviceTable(uint16_t u16NodeId, uint
 	}
 
     tsZbDeviceInfo* sDevice = tZDM_FindDeviceByNodeId(u16NodeId);
-    for (uint8_t i = 0; i < MAX_ZD_CLUSTER_NUMBERS_PER_EP; i++)
+    if (sDevice == NULL) {
+        return NULL;
+    }
+    for (uint8_t i = 0; i < sDevice->u8EndpointCount; i++)
     {
-        if (sDevice->sZDEndpoint[i].u8EndpointId == u8Endpoint)
-            return &(sDevice->sZDEndpoint[i]);
+        tsZbDeviceEndPoint *sEndpoint = tZDM_FindEndpointByIndex(sDevice, i);
+        if (sEndpoint->u8EndpointId == u8Endpoint)
+            return sEndpoint;
     }
     return NULL;
 }
@@ -221,18 +548,163 @@ tsZbDeviceCluster* tZDM_FindClusterEntryInDeviceTable(uint16_t u16NodeId,
                                                       uint16_t u16ClusterId)
 {
     tsZbDeviceEndPoint *sEndpoint = tZDM_FindEndpointEntryInDeviceTable(u16NodeId, u8Endpoint);
-    for (uint8_t i = 0; i < MAX_ZD_CLUSTER_NUMBERS_PER_EP; i++) {
-        if (sEndpoint->sZDCluster[i].u16ClusterId == u16ClusterId)
-            return &(sEndpoint->sZDCluster[i]);
+    if (sEndpoint == NULL) {
+        return NULL;
+    }
+    for (uint8_t i = 0; i < sEndpoint->u8ClusterCount; i++) {
+        tsZbDeviceCluster *sCluster = tZDM_FindClusterByIndex(sEndpoint, i);
+        if (sCluster->u16ClusterId == u16ClusterId)
+            return sCluster;
     }
     return NULL;
 }
 
 
 
+tsZbDeviceEndPoint* tZDM_FindEndpointByIndex(const tsZbDeviceInfo *psDevice, uint8_t u8Index)
+{
+    if ((psDevice == NULL) || (u8Index >= psDevice->u8EndpointCount)) {
+        return NULL;
+    }
+
+    uint8_t *pu8Record = &au8DeviceArena[au16Record[psDevice - deviceTable]];
+    return (tsZbDeviceEndPoint *)(pu8Record + pu8Record[u8Index]);
+}
+
+
+
+tsZbDeviceCluster* tZDM_FindClusterByIndex(const tsZbDeviceEndPoint *psEndpoint, uint8_t u8Index)
+{
+    if ((psEndpoint == NULL) || (u8Index >= psEndpoint->u8ClusterCount)) {
+        return NULL;
+    }
+    return (tsZbDeviceCluster *)(psEndpoint + 1) + u8Index;
+}
+
+
+
+static bool bZD_SetDeviceEndpointsLocked(tsZbDeviceInfo *psDevice, uint8_t u8Count, const uint8_t *pu8Endpoints)
+{
+    if (psDevice == NULL) {
+        return false;
+    }
+
+    uint8_t u8Device = (uint8_t)(psDevice - deviceTable);
+    if (u8Count > MAX_ZD_ENDPOINT_NUMBERS_PER_DEV) {
+        u8Count = MAX_ZD_ENDPOINT_NUMBERS_PER_DEV;
+    }
+
+    /* A new record at the end of the arena, after the old one has gone */
+    vZD_RecordFree(u8Device);
+    if (u8Count == 0) {
+        return true;
+    }
+    au16Record[u8Device] = u16ArenaUsed;
+    if (!bZD_RecordResize(u8Device, 0, u8Count * (1 + sizeof(tsZbDeviceEndPoint)))) {
+        au16Record[u8Device] = ZB_DEVICE_RECORD_NONE;
+        PRINTF("\n ### Device 0x%04x: no room for %d endpoints\n", psDevice->u16NodeId, u8Count);
+        return false;
+    }
+
+    uint8_t *pu8Record = &au8DeviceArena[au16Record[u8Device]];
+    for (uint8_t i = 0; i < u8Count; i++)
+    {
+        pu8Record[i] = u8Count + i * sizeof(tsZbDeviceEndPoint);
+        ((tsZbDeviceEndPoint *)(pu8Record + pu8Record[i]))->u8EndpointId = pu8Endpoints[i];
+    }
+    psDevice->u8EndpointCount = u8Count;
+    return true;
+}
+
+
+
+bool bZDM_SetDeviceEndpoints(tsZbDeviceInfo *psDevice, uint8_t u8Count, const uint8_t *pu8Endpoints)
+{
+    bool bDone;
+
+    vZDM_ArenaLock();
+    bDone = bZD_SetDeviceEndpointsLocked(psDevice, u8Count, pu8Endpoints);
+    vZDM_ArenaUnlock();
+    return bDone;
+}
+
+
+
+static tsZbDeviceEndPoint* tZD_SetEndpointClustersLocked(tsZbDeviceInfo *psDevice, uint8_t u8Endpoint,
+                                                         uint16_t u16DeviceType, uint8_t u8Count,
+                                                         const uint16_t *pu16Clusters)
+{
+    tsZbDeviceEndPoint *psEndpoint = NULL;
+    uint8_t u8Index;
+
+    if (psDevice == NULL) {
+        return NULL;
+    }
+    for (u8Index = 0; u8Index < psDevice->u8EndpointCount; u8Index++)
+    {
+        psEndpoint = tZDM_FindEndpointByIndex(psDevice, u8Index);
+        if (psEndpoint->u8EndpointId == u8Endpoint) {
+            break;
+        }
+    }
+    if (u8Index == psDevice->u8EndpointCount) {
+        return NULL;
+    }
+    if (u8Count > MAX_ZD_CLUSTER_NUMBERS_PER_EP) {
+        u8Count = MAX_ZD_CLUSTER_NUMBERS_PER_EP;
+    }
+
+    /* The clusters grow or shrink at their end, the endpoints behind move */
+    uint8_t u8Device = (uint8_t)(psDevice - deviceTable);
+    uint8_t *pu8Record = &au8DeviceArena[au16Record[u8Device]];
+    uint16_t u16End = pu8Record[u8Index] + sizeof(tsZbDeviceEndPoint)
+                      + psEndpoint->u8ClusterCount * sizeof(tsZbDeviceCluster);
+    int16_t i16Delta = ((int16_t)u8Count - psEndpoint->u8ClusterCount) * (int16_t)sizeof(tsZbDeviceCluster);
+
+    if ((i16Delta > 0) && !bZD_RecordResize(u8Device, u16End, i16Delta)) {
+        PRINTF("\n ### Device 0x%04x: no room for %d clusters on endpoint %d\n",
+               psDevice->u16NodeId, u8Count, u8Endpoint);
+        u8Count  = 0;
+        i16Delta = -(int16_t)(psEndpoint->u8ClusterCount * sizeof(tsZbDeviceCluster));
+    }
+    if (i16Delta < 0) {
+        bZD_RecordResize(u8Device, u16End + i16Delta, i16Delta);
+    }
+    for (uint8_t i = u8Index + 1; i < psDevice->u8EndpointCount; i++)
+    {
+        pu8Record[i] += i16Delta;
+    }
+
+    psEndpoint->u16DeviceType  = u16DeviceType;
+    psEndpoint->u8ClusterCount = u8Count;
+    for (uint8_t i = 0; i < u8Count; i++)
+    {
+        tsZbDeviceCluster *psCluster = tZDM_FindClusterByIndex(psEndpoint, i);
+
+        psCluster->u16ClusterId     = pu16Clusters[i];
+        psCluster->u8AttributeCount = 0;
+    }
+    return psEndpoint;
+}
+
+
+
+tsZbDeviceEndPoint* tZDM_SetEndpointClusters(tsZbDeviceInfo *psDevice, uint8_t u8Endpoint, uint16_t u16DeviceType,
+                                             uint8_t u8Count, const uint16_t *pu16Clusters)
+{
+    tsZbDeviceEndPoint *psEndpoint;
+
+    vZDM_ArenaLock();
+    psEndpoint = tZD_SetEndpointClustersLocked(psDevice, u8Endpoint, u16DeviceType, u8Count, pu16Clusters);
+    vZDM_ArenaUnlock();
+    return psEndpoint;
+}
+
+
+
 tsZbDeviceAttribute* tZDM_FindAttributeEntryByIndex(uint16_t u16Index)
 {
-	if (u16Index > MAX_ZD_ATTRIBUTE_NUMBERS_TOTAL) {
+	if (u16Index >= MAX_ZD_ATTRIBUTE_NUMBERS_TOTAL) {
 		return NULL;
 	}	
 	return &(attributeTable[u16Index]);    
@@ -253,16 +725,10 @@ tsZbDeviceAttribute* tZDM_FindAttributeEntryByElement(uint16_t u16NodeId,
 		return NULL;
 	}
 
-    for (uint16_t i = 0; i < MAX_ZD_ATTRIBUTE_NUMBERS_TOTAL; i++) {
-        if (attributeTable[i].u16NodeId == u16NodeId) {
-            if (attributeTable[i].u8Endpoint == u8Endpoint) {                
-                if (attributeTable[i].u16ClusterId == u16ClusterId) {
-                    if (attributeTable[i].u16AttributeId == u16AttributeId) {
-                        return &(attributeTable[i]);
-                    }
-                }
-            }
-        }        
+    uint16_t i = u16ZCB_IndexFind(&sAttributeIndex,
+                                 u64ZD_AttributeKey(u16NodeId, u8Endpoint, u16ClusterId, u16AttributeId));
+    if (i != ZB_DEVICE_INDEX_NONE) {
+        return &(attributeTable[i]);
     }
     return NULL;    
 }
@@ -282,36 +748,97 @@ uint8_t uZDM_FindAttributeListByElement(uint16_t u16NodeId,
 		return 0xFF;
 	}
 
+    uint8_t u8Device = uZDM_FindDevTableIndexByNodeId(u16NodeId);
+    if (u8Device == 0xFF) {
+        return 0xFF;
+    }
+
     uint8_t attrCnt = 0;
-    for (uint16_t i = 0; i < MAX_ZD_ATTRIBUTE_NUMBERS_TOTAL; i++) {
-        if (attributeTable[i].u16NodeId == u16NodeId) {
-            if (attributeTable[i].u8Endpoint == u8Endpoint) {                
-                if (attributeTable[i].u16ClusterId == u16ClusterId) {
-                    auAttrList[attrCnt ++] = attributeTable[i].u16AttributeId; 
-                }
-            }
-        }        
+    for (uint16_t i = au16DeviceAttributes[u8Device]; i != ZB_DEVICE_INDEX_NONE; i = au16AttributeNext[i]) {
+        if ((attributeTable[i].u8Endpoint == u8Endpoint) && (attributeTable[i].u16ClusterId == u16ClusterId)) {
+            auAttrList[attrCnt ++] = attributeTable[i].u16AttributeId; 
+        }
     }
+    vZDM_ArenaLock();
     tsZbDeviceCluster * devClus = tZDM_FindClusterEntryInDeviceTable(u16NodeId,
                                                                      u8Endpoint,
                                                                      u16ClusterId);
-    devClus->u8AttributeCount = attrCnt;
+    if (devClus != NULL) {
+        devClus->u8AttributeCount = attrCnt;
+    }
+    vZDM_ArenaUnlock();
     return attrCnt;
 }
 
 
 
-void bZDM_EraseAttributeInfoByNodeId(uint16_t u16NodeId)
+tsZbDeviceAttribute* tZDM_NextDeviceAttribute(uint16_t u16NodeId, const tsZbDeviceAttribute *psAttribute)
 {
-    for (uint16_t i = 0; i < MAX_ZD_ATTRIBUTE_NUMBERS_TOTAL; i++) {
-        if (attributeTable[i].u16NodeId == u16NodeId) {
-            if ((attributeTable[i].u8DataType == E_ZCL_CSTRING)
-                || (attributeTable[i].u8DataType == E_ZCL_OSTRING)) {
-                vPortFree(attributeTable[i].uData.sData.pData);
-            }
-            memset(&(attributeTable[i]), 0, sizeof(attributeTable));
+    uint16_t i;
+
+    if (psAttribute == NULL) {
+        uint8_t u8Device = uZDM_FindDevTableIndexByNodeId(u16NodeId);
+        if (u8Device == 0xFF) {
+            return NULL;
         }
+        i = au16DeviceAttributes[u8Device];
+    } else {
+        i = au16AttributeNext[psAttribute - attributeTable];
     }
+    return (i == ZB_DEVICE_INDEX_NONE) ? NULL : &(attributeTable[i]);
+}
+
+
+
+bool bZDM_SetAttributeString(tsZbDeviceAttribute *psAttribute, const uint8_t *pu8Data, uint8_t u8Length)
+{
+    if (psAttribute == NULL) {
+        return false;
+    }
+
+    /* Interned before the old value goes, an unchanged one stays in place */
+    uint16_t u16String = u16ZCB_StringIntern(pu8Data, u8Length);
+    vZDM_ReleaseAttributeString(psAttribute);
+    psAttribute->uData.sData.u16String = u16String;
+    psAttribute->uData.sData.u8Length  = (u16String == ZCB_STRING_NONE) ? 0 : u8Length;
+    return (u16String != ZCB_STRING_NONE);
+}
+
+
+
+void vZDM_ReleaseAttributeString(tsZbDeviceAttribute *psAttribute)
+{
+    if ((psAttribute == NULL)
+        || ((psAttribute->u8DataType != E_ZCL_CSTRING) && (psAttribute->u8DataType != E_ZCL_OSTRING))) {
+        return;
+    }
+    vZCB_StringRelease(psAttribute->uData.sData.u16String);
+    psAttribute->uData.sData.u16String = ZCB_STRING_NONE;
+    psAttribute->uData.sData.u8Length  = 0;
+}
+
+
+
+void bZDM_EraseAttributeInfoByNodeId(uint16_t u16NodeId)
+{
+    uint8_t u8Device = uZDM_FindDevTableIndexByNodeId(u16NodeId);
+    uint16_t i, u16Next;
+
+    if (u8Device == 0xFF) {
+        return;
+    }
+
+    /* The whole chain of the node goes back to the free list */
+    for (i = au16DeviceAttributes[u8Device]; i != ZB_DEVICE_INDEX_NONE; i = u16Next) {
+        u16Next = au16AttributeNext[i];
+        vZCB_IndexRemove(&sAttributeIndex, i);
+        vZDM_ReleaseAttributeString(&attributeTable[i]);
+        memset(&(attributeTable[i]), 0, sizeof(tsZbDeviceAttribute));
+        au16AttributeNext[i] = u16AttributeFree;
+        u16AttributeFree = i;
+    }
+    au16DeviceAttributes[u8Device] = ZB_DEVICE_INDEX_NONE;
+    vZD_AttributeIndexTidy();
 }
 
 
@@ -323,13 +850,19 @@ bool bZDM_EraseDeviceFromDeviceTable(uint64_t u64IeeeAddr)
 		return NULL;
 	}  
 
-	for (uint8_t i = 0; i < MAX_ZD_DEVICE_NUMBERS; i++)
-	{
-		if (deviceTable[i].u64IeeeAddress == u64IeeeAddr) {
-		    bZDM_EraseAttributeInfoByNodeId(deviceTable[i].u16NodeId);
-			memset(&(deviceTable[i]), 0, sizeof(tsZbDeviceInfo));
-			return true;
-		}
+	uint16_t i = u16ZCB_IndexFind(&sIeeeAddrIndex, u64IeeeAddr);
+	if (i != ZB_DEVICE_INDEX_NONE) {
+		bZDM_EraseAttributeInfoByNodeId(deviceTable[i].u16NodeId);
+		vZDM_ArenaLock();
+		vZD_RecordFree(i);
+		vZDM_ArenaUnlock();
+		vZCB_IndexRemove(&sNodeIdIndex, i);
+		vZCB_IndexRemove(&sIeeeAddrIndex, i);
+		memset(&(deviceTable[i]), 0, sizeof(tsZbDeviceInfo));
+		au8DeviceNextFree[i] = u8DeviceFree;
+		u8DeviceFree = (uint8_t)i;
+		vZD_DeviceIndexTidy();
+		return true;
 	}
 //	LOG(ZDM, WARN, "No device can be erased!\r\n");
 	return false;
@@ -337,360 +870,469 @@ bool bZDM_EraseDeviceFromDeviceTable(uint64_t u64IeeeAddr)
 
 
 
+bool bZDM_UpdateDeviceNodeId(uint64_t u64IeeeAddr, uint16_t u16NodeId, uint16_t *pu16OldNodeId)
+{
+	if (!bZD_ValidityCheckOfIeeeAddr(u64IeeeAddr) || !bZD_ValidityCheckOfNodeId(u16NodeId)) {
+		return false;
+	}
+
+	uint16_t i = u16ZCB_IndexFind(&sIeeeAddrIndex, u64IeeeAddr);
+	if (i == ZB_DEVICE_INDEX_NONE) {
+		return false;
+	}
+
+	uint16_t u16OldNodeId = deviceTable[i].u16NodeId;
+	if (u16OldNodeId == u16NodeId) {
+		return false;
+	}
+	/* The attributes of the node follow it to its new short address */
+	for (uint16_t j = au16DeviceAttributes[i]; j != ZB_DEVICE_INDEX_NONE; j = au16AttributeNext[j]) {
+		vZCB_IndexRemove(&sAttributeIndex, j);
+		attributeTable[j].u16NodeId = u16NodeId;
+		vZCB_IndexInsert(&sAttributeIndex, j);
+	}
+	vZD_AttributeIndexTidy();
+	vZCB_IndexRemove(&sNodeIdIndex, i);
+	deviceTable[i].u16NodeId = u16NodeId;
+	vZCB_IndexInsert(&sNodeIdIndex, i);
+	vZD_DeviceIndexTidy();
+	if (pu16OldNodeId != NULL) {
+		*pu16OldNodeId = u16OldNodeId;
+	}
+	return true;
+}
+
+
+
 void vZDM_ClearAllDeviceTables()
 {
+    for (uint16_t i = 0; i < MAX_ZD_ATTRIBUTE_NUMBERS_TOTAL; i++) {
+        vZDM_ReleaseAttributeString(&attributeTable[i]);
+    }
 	memset(deviceTable, 0, sizeof(tsZbDeviceInfo) * MAX_ZD_DEVICE_NUMBERS);
     memset(attributeTable, 0, sizeof(tsZbDeviceAttribute) * MAX_ZD_ATTRIBUTE_NUMBERS_TOTAL);
     memset(&zbNetworkInfo, 0, sizeof(tsZbNetworkInfo));
+    vZD_DeviceIndexRebuild();
+    vZD_AttributeIndexRebuild();
+    vZD_AttributeChainsReset();
+    vZD_DeviceFreeReset();
+    vZDM_ArenaLock();
+    vZD_ArenaReset();
+    vZDM_ArenaUnlock();
 }
 
 
 
 void vZbDeviceTable_Init()
 {
+    if (xArenaMutex == NULL) {
+        xArenaMutex = xSemaphoreCreateMutex();
+    }
     vZDM_ClearAllDeviceTables();
 }
 
 
 
-void vZDM_NewDeviceQualifyProcess(tsZbDeviceInfo* device)
+void vZDM_DeviceIndexDump(void)
 {
-    uint8_t i,j,k;
-    bool loop = true;
-    uint16_t au16AttrList[1] = {E_ZB_ATTRIBUTEID_BASIC_MODEL_ID};
-    static uint8_t epArrayIndex = 0;
-    uint16_t clusterId;
-    while (loop) {
-        switch (device->eDeviceState)
+    vZCB_IndexPrint("Short address", &sNodeIdIndex);
+    vZCB_IndexPrint("IEEE address", &sIeeeAddrIndex);
+    vZCB_IndexPrint("Attribute", &sAttributeIndex);
+}
+
+
+
+static uint32_t u32ZD_BenchNs(TickType_t xStart)
+{
+    uint64_t u64Ns = (uint64_t)((xTaskGetTickCount() - xStart) * portTICK_PERIOD_MS) * 1000000u;
+
+    return (uint32_t)(u64Ns / ZB_DEVICE_INDEX_BENCH_LOOKUPS);
+}
+
+
+
+void vZDM_DeviceIndexBenchmark(uint16_t u16Devices)
+{
+    typedef struct
+    {
+        uint16_t u16NodeId;
+        uint64_t u64IeeeAddress;
+    } PACKED tsBenchDevice;
+
+    typedef struct
+    {
+        uint16_t u16NodeId;
+        uint8_t  u8Endpoint;
+        uint16_t u16ClusterId;
+        uint16_t u16AttributeId;
+    } PACKED tsBenchAttribute;
+
+    static const uint16_t au16Clusters[ZB_DEVICE_INDEX_BENCH_ATTRIBUTES] =
+    {
+        E_ZB_CLUSTERID_ONOFF, E_ZB_CLUSTERID_LEVEL_CONTROL,
+        E_ZB_CLUSTERID_COLOR_CONTROL, E_ZB_CLUSTERID_COLOR_CONTROL
+    };
+    static const uint16_t au16Attributes[ZB_DEVICE_INDEX_BENCH_ATTRIBUTES] =
+    {
+        E_ZB_ATTRIBUTEID_ONOFF_ONOFF, E_ZB_ATTRIBUTEID_LEVEL_CURRENTLEVEL,
+        E_ZB_ATTRIBUTEID_COLOUR_CURRENTX, E_ZB_ATTRIBUTEID_COLOUR_CURRENTY
+    };
+
+    tsBenchDevice *psDevices;
+    tsBenchAttribute *psAttributes;
+    uint16_t *pu16Slots;
+    uint16_t *pu16AttributeSlots;
+    tsZCB_Index sNodeId;
+    tsZCB_Index sIeeeAddr;
+    tsZCB_Index sAttribute;
+    uint16_t u16Slots = 1;
+    uint16_t u16AttributeSlots = 1;
+    uint16_t u16Attributes = u16Devices * ZB_DEVICE_INDEX_BENCH_ATTRIBUTES;
+    uint32_t u32Seed = 0x2545F491;
+    uint32_t au32Ns[6];
+    volatile uint32_t u32Found = 0;
+    TickType_t xStart;
+
+    if ((u16Devices == 0) || (u16Devices > ZB_DEVICE_INDEX_BENCH_MAX)) {
+        PRINTF("\n ### Device index benchmark: 1 to %d devices\n", ZB_DEVICE_INDEX_BENCH_MAX);
+        return;
+    }
+    while (u16Slots < 2 * u16Devices) {
+        u16Slots <<= 1;
+    }
+    while (u16AttributeSlots < 2 * u16Attributes) {
+        u16AttributeSlots <<= 1;
+    }
+
+    psDevices          = pvPortMalloc(sizeof(tsBenchDevice) * u16Devices);
+    pu16Slots          = pvPortMalloc(sizeof(uint16_t) * u16Slots * 2);
+    psAttributes       = pvPortMalloc(sizeof(tsBenchAttribute) * u16Attributes);
+    pu16AttributeSlots = pvPortMalloc(sizeof(uint16_t) * u16AttributeSlots);
+    if ((psDevices == NULL) || (pu16Slots == NULL) || (psAttributes == NULL) || (pu16AttributeSlots == NULL)) {
+        PRINTF("\n ### Device index benchmark: no memory for %d devices\n", u16Devices);
+        vPortFree(psDevices);
+        vPortFree(pu16Slots);
+        vPortFree(psAttributes);
+        vPortFree(pu16AttributeSlots);
+        return;
+    }
+
+    /* Random short addresses, IEEE addresses of one manufacturer */
+    for (uint16_t i = 0; i < u16Devices; i++)
+    {
+        u32Seed = u32Seed * 1664525u + 1013904223u;
+        psDevices[i].u16NodeId      = 1 + (uint16_t)((u32Seed >> 8) % (E_ZB_BROADCAST_ADDRESS_LOWPOWERROUTERS - 1));
+        psDevices[i].u64IeeeAddress = 0x00158D0000000000ULL | ((uint64_t)u32Seed << 8) | (i & 0xFF);
+    }
+
+    memset(pu16Slots, 0, sizeof(uint16_t) * u16Slots * 2);
+    sNodeId.pu16Slots   = pu16Slots;
+    sNodeId.u16Mask     = u16Slots - 1;
+    sNodeId.u16Deleted  = 0;
+    sNodeId.pu8Keys     = (const uint8_t *)&psDevices[0].u16NodeId;
+    sNodeId.u16Stride   = sizeof(tsBenchDevice);
+    sNodeId.u8KeySize   = sizeof(uint16_t);
+    sIeeeAddr           = sNodeId;
+    sIeeeAddr.pu16Slots = pu16Slots + u16Slots;
+    sIeeeAddr.pu8Keys   = (const uint8_t *)&psDevices[0].u64IeeeAddress;
+    sIeeeAddr.u8KeySize = sizeof(uint64_t);
+    for (uint16_t i = 0; i < u16Devices; i++)
+    {
+        vZCB_IndexInsert(&sNodeId, i);
+        vZCB_IndexInsert(&sIeeeAddr, i);
+    }
+
+    /* The scans as the lookups did them before the indexes */
+    xStart = xTaskGetTickCount();
+    for (uint32_t n = 0; n < ZB_DEVICE_INDEX_BENCH_LOOKUPS; n++)
+    {
+        uint16_t u16Key = psDevices[n % u16Devices].u16NodeId;
+
+        for (uint16_t i = 0; i < u16Devices; i++)
         {
-            case E_ZB_DEVICE_STATE_NEW_JOINED:
-            {
-                /*
-                  After sending device announce notification to the host, the coordinator will 
-                  process PDM saving of EndDevice timeout value. If the host send the uart data
-                  to the coordinator at this time, it would cause the coordinator stack dump and
-                  watchdog reset.
-                  It may be a bug of JN5189 zigbee stack, add some delay here to avoid seen issue.
-                */
-                vTaskDelay (pdMS_TO_TICKS(100));
-                for (i = 0; i < 2; i++)
-                {
-                    if (eActiveEndpointRequest(device->u16NodeId) != E_ZCB_OK)
-                    {
-                        PRINTF("\n ### Sending active endpoint request fail");
-                        if (i == 1) {
-                            device->u8EndpointCount = ZB_DEVICE_ENDPOINT_COUNT_DEFAULT;
-                            device->eDeviceState = E_ZB_DEVICE_STATE_GET_CLUSTER;
-                        } else {
-                            vTaskDelay (pdMS_TO_TICKS(50));
-                        }
-                    }
-                    else
-                    {
-                        //wait 1s for the active endpoint response
-                        if (eSL_MessageWait(E_SL_MSG_ACTIVE_ENDPOINT_RESPONSE, 1000, NULL, NULL) != E_SL_OK)
-                        {
-                            PRINTF("\n ### No active endpoint response is received");
-                            if (i == 1) {
-                                device->u8EndpointCount = ZB_DEVICE_ENDPOINT_COUNT_DEFAULT;
-                                device->eDeviceState = E_ZB_DEVICE_STATE_GET_CLUSTER;
-                            } else {
-                                vTaskDelay (pdMS_TO_TICKS(50));
-                            }
-                        } else {
-                            loop = false;
-                            break;
-                        }
-                    }
-                }
-            }
-                break;
-                
-            case E_ZB_DEVICE_STATE_GET_CLUSTER:
-                epArrayIndex ++;
-                for (i = 0; i < 2; i++)
-                {                   
-				if ((device->sZDEndpoint[epArrayIndex - 1].u8EndpointId==0xF2)||(device->sZDEndpoint[epArrayIndex - 1].u8EndpointId==0))
-						continue;
-			#if 0
-                    if (eSimpleDescriptorRequest(device->u16NodeId, device->sZDEndpoint[epArrayIndex - 1].u8EndpointId) != E_ZCB_OK)
-			#else  // force to EP=1
-				    if (eSimpleDescriptorRequest(device->u16NodeId, 1) != E_ZCB_OK)
-			#endif
-                    {
-        //                LOG(ZDM, ERR, "Sending simple descriptor request fail\n");                        
-                    }
-                    else
-                    {
-                        //wait 1s for the simple descriptor response
-                        if (eSL_MessageWait(E_SL_MSG_SIMPLE_DESCRIPTOR_RESPONSE, 1000, NULL, NULL) != E_SL_OK) {
-         //                   LOG(ZDM, ERR, "No simple descriptor response is received\n");
-                        } else {
-                            break;
-                        }
-                    }
-                    vTaskDelay (pdMS_TO_TICKS(50));
-                }
-                loop = false;
+            if (psDevices[i].u16NodeId == u16Key) {
+                u32Found++;
                 break;
-                
-            case E_ZB_DEVICE_STATE_READ_ATTRIBUTE:
-            {
-                for (i = 0; i < device->u8EndpointCount; i++)
-                {
-                    for (j = 0; j < device->sZDEndpoint[i].u8ClusterCount; j++)
-                    {
-                        clusterId = device->sZDEndpoint[i].sZDCluster[j].u16ClusterId;
-                        switch (clusterId)
-                        {
-                            case E_ZB_CLUSTERID_BASIC:
-                            {                
-                                tZDM_AddNewAttributeToAttributeTable(device->u16NodeId,
-                                                                     device->sZDEndpoint[i].u8EndpointId,
-                                                                     clusterId,
-                                                                     E_ZB_ATTRIBUTEID_BASIC_MODEL_ID,
-                                                                     E_ZB_ATTRIBUTE_STRING_TYPE);                
-
-                                for (k = 0; k < 2; k++)
-                                {
-                                    if (eReadAttributeRequest(E_ZD_ADDRESS_MODE_SHORT, 
-                                                              device->u16NodeId, 
-                                                              ZB_ENDPOINT_SRC_DEFAULT, 
-                                                              device->sZDEndpoint[i].u8EndpointId, 
-                                                              E_ZB_CLUSTERID_BASIC,  
-                                                              ZB_MANU_CODE_DEFAULT, 
-                                                              1, 
-                                                              au16AttrList) != E_ZCB_OK)
-                                    {
-                              //          LOG(ZDM, ERR, "Sending basic model id read request fail\r\n");
-                                        if (k == 1) {
-                                            /*eMgmtLeaveRequst(device->u16NodeId, device->u64IeeeAddress, 0, 1);
-                                            if (bZDM_EraseDeviceFromDeviceTable(device->u64IeeeAddress)) {
-                                                ZCB_DEBUG( "Erase Device Successfullly\r\n");
-                                            }*/
-                                        } else {
-                                            vTaskDelay (pdMS_TO_TICKS(50));
-                                        }
-                                    }
-                                    else
-                                    {
-                                        //wait 1s for the basic mode id response
-                                        if (eSL_MessageWait(E_SL_MSG_READ_ATTRIBUTE_RESPONSE, 1000, NULL, NULL) != E_SL_OK)
-                                        {
-                                 //           LOG(ZDM, ERR, "No basic model id response is received\r\n");
-                                            if (k == 1) {
-                                                /*eMgmtLeaveRequst(device->u16NodeId, device->u64IeeeAddress, 0, 1);
-                                                if (bZDM_EraseDeviceFromDeviceTable(device->u64IeeeAddress)) {
-                                                    ZCB_DEBUG( "Erase Device Successfullly\r\n");
-                                                }*/
-                                            } else {
-                                                vTaskDelay (pdMS_TO_TICKS(50));
-                                            }
-                                        } else {
-                                            loop = false;
-                                            break;
-                                        }                       
-                                    }
-                                }
-                            }
-                                break;
-                                
-                            default:
-                                break;
-                        }
-                    }
-                }
             }
-                loop = false;
+        }
+    }
+    au32Ns[0] = u32ZD_BenchNs(xStart);
+
+    xStart = xTaskGetTickCount();
+    for (uint32_t n = 0; n < ZB_DEVICE_INDEX_BENCH_LOOKUPS; n++)
+    {
+        if (u16ZCB_IndexFind(&sNodeId, psDevices[n % u16Devices].u16NodeId) != ZB_DEVICE_INDEX_NONE) {
+            u32Found++;
+        }
+    }
+    au32Ns[1] = u32ZD_BenchNs(xStart);
+
+    xStart = xTaskGetTickCount();
+    for (uint32_t n = 0; n < ZB_DEVICE_INDEX_BENCH_LOOKUPS; n++)
+    {
+        uint64_t u64Key = psDevices[n % u16Devices].u64IeeeAddress;
+
+        for (uint16_t i = 0; i < u16Devices; i++)
+        {
+            if (psDevices[i].u64IeeeAddress == u64Key) {
+                u32Found++;
                 break;
-                
-            case E_ZB_DEVICE_STATE_BIND_CLUSTER:
-            {
-                for (i = 0; i < device->u8EndpointCount; i++)
-                {
-                    for (j = 0; j < device->sZDEndpoint[i].u8ClusterCount; j++)
-                    {
-                        uint16_t clusterId = device->sZDEndpoint[i].sZDCluster[j].u16ClusterId;
-                        switch (clusterId)
-                        {
-                            case E_ZB_CLUSTERID_BASIC:                            
-                                break;
-                                
-                            case E_ZB_CLUSTERID_ONOFF:
-                            {
-                                tZDM_AddNewAttributeToAttributeTable(device->u16NodeId,
-                                                                     device->sZDEndpoint[i].u8EndpointId,
-                                                                     clusterId,
-                                                                     E_ZB_ATTRIBUTEID_ONOFF_ONOFF,
-                                                                     E_ZB_ATTRIBUTE_UINT64_TYPE);
-                                eSendBindUnbindCommand(device->u64IeeeAddress,
-                                                       device->sZDEndpoint[i].u8EndpointId,
-                                                       E_ZB_CLUSTERID_ONOFF,
-                                                       SEND_BIND_REQUEST_COMMAND);
-                                vTaskDelay (pdMS_TO_TICKS(50));
-                            }
-                                break;
-                                
-                            case E_ZB_CLUSTERID_LEVEL_CONTROL:
-                            {
-                                tZDM_AddNewAttributeToAttributeTable(device->u16NodeId,
-                                                                     device->sZDEndpoint[i].u8EndpointId,
-                                                                     clusterId,
-                                                                     E_ZB_ATTRIBUTEID_LEVEL_CURRENTLEVEL,
-                                                                     E_ZB_ATTRIBUTE_UINT64_TYPE); 
-                                eSendBindUnbindCommand(device->u64IeeeAddress, 
-                                                       device->sZDEndpoint[i].u8EndpointId, 
-                                                       E_ZB_CLUSTERID_LEVEL_CONTROL,
-                                                       SEND_BIND_REQUEST_COMMAND);
-                                vTaskDelay (pdMS_TO_TICKS(50));
-                            }
-                                break; 
-                                
-                            case E_ZB_CLUSTERID_COLOR_CONTROL:
-                            {
-                                switch (device->sZDEndpoint[i].u16DeviceType)
-                                {
-                                    case E_ZB_DEVICEID_LIGHT_COLOR_TEMP:
-                                    {
-                                        tZDM_AddNewAttributeToAttributeTable(device->u16NodeId,
-                                                                             device->sZDEndpoint[i].u8EndpointId,
-                                                                             clusterId,
-                                                                             E_ZB_ATTRIBUTEID_COLOUR_COLOURTEMPERATURE,
-                                                                             E_ZB_ATTRIBUTE_UINT64_TYPE);
-                                        eSendBindUnbindCommand(device->u64IeeeAddress,
-                                                               device->sZDEndpoint[i].u8EndpointId,
-                                                               E_ZB_CLUSTERID_COLOR_CONTROL,
-                                                               SEND_BIND_REQUEST_COMMAND);
-                                        vTaskDelay (pdMS_TO_TICKS(50));
-                                    }
-
-                                        break;
-                                        
-                                    case E_ZB_DEVICEID_LIGHT_COLOR_EXT:
-                                    {
-                                        tZDM_AddNewAttributeToAttributeTable(device->u16NodeId,
-                                                                             device->sZDEndpoint[i].u8EndpointId,
-                                                                             clusterId,
-                                                                             E_ZB_ATTRIBUTEID_COLOUR_COLOURTEMPERATURE,
-                                                                             E_ZB_ATTRIBUTE_UINT64_TYPE);
-                                        tZDM_AddNewAttributeToAttributeTable(device->u16NodeId,
-                                                                             device->sZDEndpoint[i].u8EndpointId,
-                                                                             clusterId,
-                                                                             E_ZB_ATTRIBUTEID_COLOUR_CURRENTX,
-                                                                             E_ZB_ATTRIBUTE_UINT64_TYPE);
-                                        tZDM_AddNewAttributeToAttributeTable(device->u16NodeId,
-                                                                             device->sZDEndpoint[i].u8EndpointId,
-                                                                             clusterId,
-                                                                             E_ZB_ATTRIBUTEID_COLOUR_CURRENTY,
-                                                                             E_ZB_ATTRIBUTE_UINT64_TYPE);                                        
-                                        eSendBindUnbindCommand(device->u64IeeeAddress,
-                                                               device->sZDEndpoint[i].u8EndpointId,
-                                                               E_ZB_CLUSTERID_COLOR_CONTROL,
-                                                               SEND_BIND_REQUEST_COMMAND);
-                                        vTaskDelay (pdMS_TO_TICKS(50));
-                                    }
-                                        break;
-                                        
-                                    default:
-                                        break;
-                                    
-                                }
-                            }
-                                break;
-
-                            case E_ZB_CLUSTERID_MEASUREMENTSENSING_TEMP:
-                            {
-                                tZDM_AddNewAttributeToAttributeTable(device->u16NodeId,
-                                                                     device->sZDEndpoint[i].u8EndpointId,
-                                                                     clusterId,
-                                                                     E_ZB_ATTRIBUTEID_MS_TEMP_MEASURED,
-                                                                     E_ZB_ATTRIBUTE_UINT64_TYPE);
-                                eSendBindUnbindCommand(device->u64IeeeAddress,
-                                                       device->sZDEndpoint[i].u8EndpointId,
-                                                       E_ZB_CLUSTERID_MEASUREMENTSENSING_TEMP,
-                                                       SEND_BIND_REQUEST_COMMAND);
-                            }
-                                break;
-                                
-                            case E_ZB_CLUSTERID_MEASUREMENTSENSING_HUM:
-                            {
-                                tZDM_AddNewAttributeToAttributeTable(device->u16NodeId,
-                                                                     device->sZDEndpoint[i].u8EndpointId,
-                                                                     clusterId,
-                                                                     E_ZB_ATTRIBUTEID_MS_HUM_MEASURED,
-                                                                     E_ZB_ATTRIBUTE_UINT64_TYPE);
-                                eSendBindUnbindCommand(device->u64IeeeAddress,
-                                                       device->sZDEndpoint[i].u8EndpointId,
-                                                       E_ZB_CLUSTERID_MEASUREMENTSENSING_HUM,
-                                                       SEND_BIND_REQUEST_COMMAND);                                
-                            }
-                                break;
-                                
-                            case E_ZB_CLUSTERID_MEASUREMENTSENSING_ILLUM:
-                            {
-                                tZDM_AddNewAttributeToAttributeTable(device->u16NodeId,
-                                                                     device->sZDEndpoint[i].u8EndpointId,
-                                                                     clusterId,
-                                                                     E_ZB_ATTRIBUTEID_MS_ILLUM_MEASURED,
-                                                                     E_ZB_ATTRIBUTE_UINT64_TYPE);
-                                eSendBindUnbindCommand(device->u64IeeeAddress,
-                                                       device->sZDEndpoint[i].u8EndpointId,
-                                                       E_ZB_CLUSTERID_MEASUREMENTSENSING_ILLUM,
-                                                       SEND_BIND_REQUEST_COMMAND);
-                                vTaskDelay (pdMS_TO_TICKS(50));
-                            }
-                                break;
-
-                            case E_ZB_CLUSTERID_OCCUPANCYSENSING:
-                            {
-                                tZDM_AddNewAttributeToAttributeTable(device->u16NodeId,
-                                                                     device->sZDEndpoint[i].u8EndpointId,
-                                                                     clusterId,
-                                                                     E_ZB_ATTRIBUTEID_MS_OCC_OCCUPANCY,
-                                                                     E_ZB_ATTRIBUTE_UINT64_TYPE);   
-								teZcbStatus status=eSendBindUnbindCommand(device->u64IeeeAddress,
-											   		   device->sZDEndpoint[i].u8EndpointId,
-					   								   E_ZB_CLUSTERID_OCCUPANCYSENSING,
-													   SEND_BIND_REQUEST_COMMAND);
-								if (status)
-									PRINTF("\n Bind Occupancy Sensor Err : 0x%x\n",status);
-								vTaskDelay (pdMS_TO_TICKS(50));
-                            }
-                                break;
-                                
-                            default:
-                                break;
-                        }
-                    }
-
-                }
-                
-                device->eDeviceState = E_ZB_DEVICE_STATE_ACTIVE;
-                loop = false;
             }
-                break;
-            case E_ZB_DEVICE_STATE_CFG_ATTRIBUTE:
-                loop = false;
-                break;
+        }
+    }
+    au32Ns[2] = u32ZD_BenchNs(xStart);
 
-            case E_ZB_DEVICE_STATE_ACTIVE:
-                epArrayIndex = 0;
-                loop = false;
-                break;
-                
-            default:
-                loop = false;
+    xStart = xTaskGetTickCount();
+    for (uint32_t n = 0; n < ZB_DEVICE_INDEX_BENCH_LOOKUPS; n++)
+    {
+        if (u16ZCB_IndexFind(&sIeeeAddr, psDevices[n % u16Devices].u64IeeeAddress) != ZB_DEVICE_INDEX_NONE) {
+            u32Found++;
+        }
+    }
+    au32Ns[3] = u32ZD_BenchNs(xStart);
+
+    /* A light of each device on endpoint 1, its attributes laid out as in
+     * the attribute table */
+    for (uint16_t i = 0; i < u16Attributes; i++)
+    {
+        psAttributes[i].u16NodeId      = psDevices[i / ZB_DEVICE_INDEX_BENCH_ATTRIBUTES].u16NodeId;
+        psAttributes[i].u8Endpoint     = 1;
+        psAttributes[i].u16ClusterId   = au16Clusters[i % ZB_DEVICE_INDEX_BENCH_ATTRIBUTES];
+        psAttributes[i].u16AttributeId = au16Attributes[i % ZB_DEVICE_INDEX_BENCH_ATTRIBUTES];
+    }
+    memset(pu16AttributeSlots, 0, sizeof(uint16_t) * u16AttributeSlots);
+    sAttribute.pu16Slots  = pu16AttributeSlots;
+    sAttribute.u16Mask    = u16AttributeSlots - 1;
+    sAttribute.u16Deleted = 0;
+    sAttribute.pu8Keys    = (const uint8_t *)&psAttributes[0];
+    sAttribute.u16Stride  = sizeof(tsBenchAttribute);
+    sAttribute.u8KeySize  = ZB_ATTRIBUTE_KEY_SIZE;
+    for (uint16_t i = 0; i < u16Attributes; i++)
+    {
+        vZCB_IndexInsert(&sAttribute, i);
+    }
+
+    /* Dense report traffic: every device in turn reports one of its
+     * attributes, found by the report handler before it is updated */
+    xStart = xTaskGetTickCount();
+    for (uint32_t n = 0; n < ZB_DEVICE_INDEX_BENCH_LOOKUPS; n++)
+    {
+        const tsBenchAttribute *psReport = &psAttributes[n % u16Attributes];
+
+        for (uint16_t i = 0; i < u16Attributes; i++)
+        {
+            if ((psAttributes[i].u16NodeId == psReport->u16NodeId)
+                && (psAttributes[i].u8Endpoint == psReport->u8Endpoint)
+                && (psAttributes[i].u16ClusterId == psReport->u16ClusterId)
+                && (psAttributes[i].u16AttributeId == psReport->u16AttributeId)) {
+                u32Found++;
                 break;
+            }
         }
-        
     }
+    au32Ns[4] = u32ZD_BenchNs(xStart);
 
-    if (device->eDeviceState == E_ZB_DEVICE_STATE_ACTIVE) {
-        epArrayIndex = 0;
-      //  vZDM_cJSON_DeviceCreate(device);
-     //   if (eSetPermitJoining(0) != E_ZCB_OK) 
-           ;//   LOG(ZDM, ERR, "Setting permit joining fail\r\n");
+    xStart = xTaskGetTickCount();
+    for (uint32_t n = 0; n < ZB_DEVICE_INDEX_BENCH_LOOKUPS; n++)
+    {
+        const tsBenchAttribute *psReport = &psAttributes[n % u16Attributes];
+
+        if (u16ZCB_IndexFind(&sAttribute, u64ZD_AttributeKey(psReport->u16NodeId, psReport->u8Endpoint,
+                                                            psReport->u16ClusterId,
+                                                            psReport->u16AttributeId)) != ZB_DEVICE_INDEX_NONE) {
+            u32Found++;
+        }
     }
+    au32Ns[5] = u32ZD_BenchNs(xStart);
+
+    PRINTF("\n ### %d devices, %d slots, %d lookups each (%d found)\n", u16Devices, u16Slots,
+           ZB_DEVICE_INDEX_BENCH_LOOKUPS, (int)u32Found);
+    PRINTF(" ### Short address: scan %d ns, index %d ns per lookup\n", (int)au32Ns[0], (int)au32Ns[1]);
+    PRINTF(" ### IEEE address:  scan %d ns, index %d ns per lookup\n", (int)au32Ns[2], (int)au32Ns[3]);
+    PRINTF(" ### Attribute:     scan %d ns, index %d ns per report (%d attributes, %d slots)\n",
+           (int)au32Ns[4], (int)au32Ns[5], u16Attributes, u16AttributeSlots);
+    vZCB_IndexPrint("Short address", &sNodeId);
+    vZCB_IndexPrint("IEEE address", &sIeeeAddr);
+    vZCB_IndexPrint("Attribute", &sAttribute);
+
+    vPortFree(psDevices);
+    vPortFree(pu16Slots);
+    vPortFree(psAttributes);
+    vPortFree(pu16AttributeSlots);
+}
+
+
+
+void vZDM_DeviceFootprint(void)
+{
+    uint16_t u16Devices = 0;
+    uint16_t u16Endpoints = 0;
+    uint16_t u16Clusters = 0;
+    uint32_t u32Fixed;
+    uint32_t u32Compact;
+
+    for (uint8_t i = 0; i < MAX_ZD_DEVICE_NUMBERS; i++)
+    {
+        if (deviceTable[i].u16NodeId == ZB_DEVICE_TABLE_NULL_NODE_ID) {
+            continue;
+        }
+        u16Devices++;
+        u16Endpoints += deviceTable[i].u8EndpointCount;
+        vZDM_ArenaLock();
+        for (uint8_t j = 0; j < deviceTable[i].u8EndpointCount; j++)
+        {
+            u16Clusters += tZDM_FindEndpointByIndex(&deviceTable[i], j)->u8ClusterCount;
+        }
+        vZDM_ArenaUnlock();
+    }
+
+    PRINTF("\n ### %d device(s), %d endpoints, %d clusters\n", u16Devices, u16Endpoints, u16Clusters);
+    PRINTF(" ### Arena: %d of %d bytes used, peak %d, %d refused, %d bytes moved\n",
+           u16ArenaUsed, MAX_ZD_DEVICE_ARENA_SIZE, u16ArenaPeak, (int)u32ArenaFull, (int)u32ArenaMoved);
+
+    /* The same devices, in the fixed arrays and in the records */
+    u32Fixed   = (uint32_t)u16Devices * ZB_DEVICE_FIXED_SIZE;
+    u32Compact = (uint32_t)u16Devices * (sizeof(tsZbDeviceInfo) + 2 * sizeof(uint16_t)) + u16ArenaUsed;
+    PRINTF(" ### In use:   fixed arrays %d bytes, records %d bytes\n", (int)u32Fixed, (int)u32Compact);
+
+    /* Static RAM for MAX_ZD_DEVICE_NUMBERS devices */
+    u32Fixed   = MAX_ZD_DEVICE_NUMBERS * ZB_DEVICE_FIXED_SIZE;
+    u32Compact = sizeof(deviceTable) + sizeof(au8DeviceArena) + sizeof(au16Record) + sizeof(au16RecordSize);
+    PRINTF(" ### Reserved: fixed arrays %d bytes, records %d bytes for %d devices\n",
+           (int)u32Fixed, (int)u32Compact, MAX_ZD_DEVICE_NUMBERS);
+    if (u16Devices != 0) {
+        PRINTF(" ### %d bytes per device on average, the arena has room for %d more such devices\n",
+               (int)(u16ArenaUsed / u16Devices),
+               (u16ArenaUsed == 0) ? 0 : (int)((MAX_ZD_DEVICE_ARENA_SIZE - u16ArenaUsed) * u16Devices / u16ArenaUsed));
+    }
+}
+
+
+
+void vZDM_GetRegistryRam(tsZbRegistryRam *psRam)
+{
+    psRam->u32Devices    = sizeof(deviceTable) + sizeof(au16NodeIdSlots) + sizeof(au16IeeeAddrSlots)
+                           + sizeof(au8DeviceNextFree) + sizeof(au16DeviceAttributes);
+    psRam->u32Attributes = sizeof(attributeTable) + sizeof(au16AttributeSlots) + sizeof(au16AttributeNext);
+    psRam->u32Records    = sizeof(au8DeviceArena) + sizeof(au16Record) + sizeof(au16RecordSize);
+}
+
+
+
+static bool bZD_AddBindingAttributesLocked(tsZbDeviceInfo* device, uint8_t u8EpIndex, uint8_t u8ClusterIndex)
+{
+    tsZbDeviceEndPoint *psEndpoint;
+    tsZbDeviceCluster *psCluster;
+    uint16_t clusterId;
+
+    psEndpoint = tZDM_FindEndpointByIndex(device, u8EpIndex);
+    psCluster  = tZDM_FindClusterByIndex(psEndpoint, u8ClusterIndex);
+    if (psCluster == NULL) {
+        return false;
+    }
+    clusterId  = psCluster->u16ClusterId;
+
+    switch (clusterId)
+    {
+        case E_ZB_CLUSTERID_ONOFF:
+            tZDM_AddNewAttributeToAttributeTable(device->u16NodeId,
+                                                 psEndpoint->u8EndpointId,
+                                                 clusterId,
+                                                 E_ZB_ATTRIBUTEID_ONOFF_ONOFF,
+                                                 E_ZB_ATTRIBUTE_UINT64_TYPE);
+            return true;
+
+        case E_ZB_CLUSTERID_LEVEL_CONTROL:
+            tZDM_AddNewAttributeToAttributeTable(device->u16NodeId,
+                                                 psEndpoint->u8EndpointId,
+                                                 clusterId,
+                                                 E_ZB_ATTRIBUTEID_LEVEL_CURRENTLEVEL,
+                                                 E_ZB_ATTRIBUTE_UINT64_TYPE);
+            return true;
+
+        case E_ZB_CLUSTERID_COLOR_CONTROL:
+            switch (psEndpoint->u16DeviceType)
+            {
+                case E_ZB_DEVICEID_LIGHT_COLOR_TEMP:
+                    tZDM_AddNewAttributeToAttributeTable(device->u16NodeId,
+                                                         psEndpoint->u8EndpointId,
+                                                         clusterId,
+                                                         E_ZB_ATTRIBUTEID_COLOUR_COLOURTEMPERATURE,
+                                                         E_ZB_ATTRIBUTE_UINT64_TYPE);
+                    return true;
+
+                case E_ZB_DEVICEID_LIGHT_COLOR_EXT:
+                    tZDM_AddNewAttributeToAttributeTable(device->u16NodeId,
+                                                         psEndpoint->u8EndpointId,
+                                                         clusterId,
+                                                         E_ZB_ATTRIBUTEID_COLOUR_COLOURTEMPERATURE,
+                                                         E_ZB_ATTRIBUTE_UINT64_TYPE);
+                    tZDM_AddNewAttributeToAttributeTable(device->u16NodeId,
+                                                         psEndpoint->u8EndpointId,
+                                                         clusterId,
+                                                         E_ZB_ATTRIBUTEID_COLOUR_CURRENTX,
+                                                         E_ZB_ATTRIBUTE_UINT64_TYPE);
+                    tZDM_AddNewAttributeToAttributeTable(device->u16NodeId,
+                                                         psEndpoint->u8EndpointId,
+                                                         clusterId,
+                                                         E_ZB_ATTRIBUTEID_COLOUR_CURRENTY,
+                                                         E_ZB_ATTRIBUTE_UINT64_TYPE);
+                    return true;
+
+                default:
+                    break;
+            }
+            break;
+
+        case E_ZB_CLUSTERID_MEASUREMENTSENSING_TEMP:
+            tZDM_AddNewAttributeToAttributeTable(device->u16NodeId,
+                                                 psEndpoint->u8EndpointId,
+                                                 clusterId,
+                                                 E_ZB_ATTRIBUTEID_MS_TEMP_MEASURED,
+                                                 E_ZB_ATTRIBUTE_UINT64_TYPE);
+            return true;
+
+        case E_ZB_CLUSTERID_MEASUREMENTSENSING_HUM:
+            tZDM_AddNewAttributeToAttributeTable(device->u16NodeId,
+                                                 psEndpoint->u8EndpointId,
+                                                 clusterId,
+                                                 E_ZB_ATTRIBUTEID_MS_HUM_MEASURED,
+                                                 E_ZB_ATTRIBUTE_UINT64_TYPE);
+            return true;
+
+        case E_ZB_CLUSTERID_MEASUREMENTSENSING_ILLUM:
+            tZDM_AddNewAttributeToAttributeTable(device->u16NodeId,
+                                                 psEndpoint->u8EndpointId,
+                                                 clusterId,
+                                                 E_ZB_ATTRIBUTEID_MS_ILLUM_MEASURED,
+                                                 E_ZB_ATTRIBUTE_UINT64_TYPE);
+            return true;
+
+        case E_ZB_CLUSTERID_OCCUPANCYSENSING:
+            tZDM_AddNewAttributeToAttributeTable(device->u16NodeId,
+                                                 psEndpoint->u8EndpointId,
+                                                 clusterId,
+                                                 E_ZB_ATTRIBUTEID_MS_OCC_OCCUPANCY,
+                                                 E_ZB_ATTRIBUTE_UINT64_TYPE);
+            return true;
+
+        default:
+            break;
+    }
+
+    return false;
+}
+
+
+
+bool bZDM_AddBindingAttributes(tsZbDeviceInfo* device, uint8_t u8EpIndex, uint8_t u8ClusterIndex)
+{
+    bool bBind;
+
+    vZDM_ArenaLock();
+    bBind = bZD_AddBindingAttributesLocked(device, u8EpIndex, u8ClusterIndex);
+    vZDM_ArenaUnlock();
+    return bBind;
 }
 
 // ------------------------------------------------------------------
@@ -17,6 +17,7 @@ extern "C" {
 /****************************************************************************/
 
 #include "ZigbeeConstant.h"
+#include "ZcbIndex.h"
 
 /****************************************************************************/
 /***        Macro Definitions                                             ***/
@@ -25,10 +26,26 @@ extern "C" {
 #define PACKED __attribute__((__packed__))
 
 #define MAX_NB_READ_ATTRIBUTES                  10
-#define MAX_ZD_DEVICE_NUMBERS                   50
+/* The tables below are all sized from the capacity of the bridge,
+ * ZB_BRIDGE_MAX_NODES in ZigbeeConstant.h */
+#define MAX_ZD_DEVICE_NUMBERS                   ZB_BRIDGE_MAX_NODES
+/* Slots of the device lookup indexes */
+#define MAX_ZD_DEVICE_INDEX_SLOTS               ZCB_INDEX_SLOTS(MAX_ZD_DEVICE_NUMBERS)
 #define MAX_ZD_ENDPOINT_NUMBERS_PER_DEV          5
 #define MAX_ZD_CLUSTER_NUMBERS_PER_EP           15
-#define MAX_ZD_ATTRIBUTE_NUMBERS_TOTAL         512       
+/* Attributes kept per device on average, a light has 6 to 12 */
+#define MAX_ZD_ATTRIBUTES_PER_DEV               10
+#define MAX_ZD_ATTRIBUTE_NUMBERS_TOTAL          (MAX_ZD_DEVICE_NUMBERS * MAX_ZD_ATTRIBUTES_PER_DEV)
+/* Slots of the attribute lookup index */
+#define MAX_ZD_ATTRIBUTE_INDEX_SLOTS            ZCB_INDEX_SLOTS(MAX_ZD_ATTRIBUTE_NUMBERS_TOTAL)
+/* Endpoint and cluster record bytes per device on average. A bulb takes
+ * 40 or so, the largest device the limits above allow 250 */
+#define MAX_ZD_ARENA_BYTES_PER_DEV              64
+/* Bytes shared by the endpoint and cluster records of all devices */
+#define MAX_ZD_DEVICE_ARENA_SIZE                (MAX_ZD_DEVICE_NUMBERS * MAX_ZD_ARENA_BYTES_PER_DEV)
+
+/* MAC capability flags of the device announce */
+#define ZB_MAC_CAPABILITY_RX_ON_WHEN_IDLE       0x08
 
 
 /****************************************************************************/
@@ -205,7 +222,7 @@ typedef union
 	struct
 	{
 		uint8_t u8Length;
-		uint8_t *pData;
+		uint16_t u16String;     //handle in the string pool, see ZcbStringPool.h
 	} sData;	
 } PACKED tuZbDeviceAttributeData;
 
@@ -231,12 +248,13 @@ typedef struct
 
 
 
+/* Followed in the device arena by its u8ClusterCount clusters,
+ * see tZDM_FindClusterByIndex() */
 typedef struct
 {
 	uint8_t u8EndpointId;
     uint16_t u16DeviceType;
 	uint8_t u8ClusterCount;
-	tsZbDeviceCluster sZDCluster[MAX_ZD_CLUSTER_NUMBERS_PER_EP];
 } PACKED tsZbDeviceEndPoint;
 
 
@@ -246,9 +264,10 @@ typedef struct
 	uint16_t u16NodeId;
 	uint64_t u64IeeeAddress;
 	teZbDeviceState eDeviceState; 
-	uint32_t timeSinceLastMessage;  //seconds
-	uint8_t u8EndpointCount;
-	tsZbDeviceEndPoint sZDEndpoint[MAX_ZD_ENDPOINT_NUMBERS_PER_DEV];
+	uint32_t u32LastSeen;           //liveness clock seconds, 0 when never heard, see ZcbLiveness.h
+	uint8_t u8AckMissStreak;        //no-ack commands not confirmed by a report
+	bool bSleepy;                   //receiver off when idle, from the device announce
+	uint8_t u8EndpointCount;        //endpoints in the device arena, see tZDM_FindEndpointByIndex()
 } PACKED tsZbDeviceInfo;
 
 
@@ -264,6 +283,16 @@ typedef struct
 
 
 
+/* Static RAM of the device registry, sized for MAX_ZD_DEVICE_NUMBERS */
+typedef struct
+{
+	uint32_t u32Devices;            //device table, its address indexes and free chain
+	uint32_t u32Attributes;         //attribute table, its index and chains
+	uint32_t u32Records;            //endpoint and cluster arena, record offsets
+} tsZbRegistryRam;
+
+
+
 uint8_t uZDM_FindDevTableIndexByNodeId(uint16_t u16NodeId);
 
 tsZbDeviceInfo* tZDM_FindDeviceByIndex(uint8_t u8Index);
@@ -274,12 +303,38 @@ tsZbDeviceInfo* tZDM_FindDeviceByIeeeAddress(uint64_t u64IeeeAddr);
 
 tsZbDeviceInfo* tZDM_AddNewDeviceToDeviceTable(uint16_t u16NodeId, uint64_t u64IeeeAddr);
 
+/** Lock of the endpoint and cluster records: a record moves when another
+ *  device's grows or goes, from any task. A pointer from the functions
+ *  below is only good while the lock is held, and the lock is never held
+ *  across a wait. Its holder may take it again. */
+void vZDM_ArenaLock(void);
+
+void vZDM_ArenaUnlock(void);
+
+/** Endpoint and cluster of a node, with the arena lock held */
 tsZbDeviceEndPoint* tZDM_FindEndpointEntryInDeviceTable(uint16_t u16NodeId, uint8_t u8Endpoint);
 
 tsZbDeviceCluster* tZDM_FindClusterEntryInDeviceTable(uint16_t u16NodeId,
                                                       uint8_t u8Endpoint,
                                                       uint16_t u16ClusterId);
 
+/** Endpoints and clusters by position, NULL past the last one, with the
+ *  arena lock held */
+tsZbDeviceEndPoint* tZDM_FindEndpointByIndex(const tsZbDeviceInfo *psDevice, uint8_t u8Index);
+
+tsZbDeviceCluster* tZDM_FindClusterByIndex(const tsZbDeviceEndPoint *psEndpoint, uint8_t u8Index);
+
+/** Replace the endpoints of the device, each without clusters; false when
+ *  the arena has no room for them, the device is left with none */
+bool bZDM_SetDeviceEndpoints(tsZbDeviceInfo *psDevice, uint8_t u8Count, const uint8_t *pu8Endpoints);
+
+/** Replace the clusters of an endpoint of the device, their attribute counts
+ *  start at 0. NULL when the device has no such endpoint; the endpoint is
+ *  left without clusters when the arena has no room for them. The endpoint
+ *  returned is only good while the caller holds the arena lock. */
+tsZbDeviceEndPoint* tZDM_SetEndpointClusters(tsZbDeviceInfo *psDevice, uint8_t u8Endpoint, uint16_t u16DeviceType,
+                                             uint8_t u8Count, const uint16_t *pu16Clusters);
+
 tsZbDeviceAttribute* tZDM_AddNewAttributeToAttributeTable(uint16_t u16NodeId,
                                                           uint8_t u8Endpoint,
                                                           uint16_t u16ClusterId,
@@ -298,16 +353,46 @@ uint8_t uZDM_FindAttributeListByElement(uint16_t u16NodeId,
                                         uint16_t u16ClusterId,
                                         uint16_t auAttrList[]);
 
+/** The attributes of a node one after the other, walking its own chain: the
+ *  first for psAttribute NULL, then the one after psAttribute, NULL after
+ *  the last. Newest first. */
+tsZbDeviceAttribute* tZDM_NextDeviceAttribute(uint16_t u16NodeId, const tsZbDeviceAttribute *psAttribute);
+
 void bZDM_EraseAttributeInfoByNodeId(uint16_t u16NodeId);
 
+/** Give a string attribute its value, interned in the string pool in place
+ *  of the one it had; false when the pool has no room, the value is cleared */
+bool bZDM_SetAttributeString(tsZbDeviceAttribute *psAttribute, const uint8_t *pu8Data, uint8_t u8Length);
+
+/** Drop the string value of the attribute, if it has one */
+void vZDM_ReleaseAttributeString(tsZbDeviceAttribute *psAttribute);
+
 bool bZDM_EraseDeviceFromDeviceTable(uint64_t u64IeeeAddr);
 
+bool bZDM_UpdateDeviceNodeId(uint64_t u64IeeeAddr, uint16_t u16NodeId, uint16_t *pu16OldNodeId);
+
 void vZDM_ClearAllDeviceTables();
 
 void vZbDeviceTable_Init();
 
+/** Print the load and probe lengths of the device and attribute lookup indexes */
+void vZDM_DeviceIndexDump(void);
+
+/** Time lookups by short and IEEE address, and attribute lookups as dense
+ *  report traffic makes them, over a synthetic table of u16Devices entries;
+ *  hashed against the linear scans they replace */
+void vZDM_DeviceIndexBenchmark(uint16_t u16Devices);
+
+/** Print the RAM taken by the device records, against what the fixed
+ *  size endpoint and cluster arrays took for as many devices */
+void vZDM_DeviceFootprint(void);
+
+void vZDM_GetRegistryRam(tsZbRegistryRam *psRam);
+
 
-void vZDM_NewDeviceQualifyProcess(tsZbDeviceInfo* device);
+/** Add the attributes the bridge keeps for a cluster of the device to the
+ *  attribute table, true when the cluster is to be bound to the bridge */
+bool bZDM_AddBindingAttributes(tsZbDeviceInfo* device, uint8_t u8EpIndex, uint8_t u8ClusterIndex);
 
 void vZDM_cJSON_DeviceCreate(tsZbDeviceInfo *device);
 
@@ -24,9 +24,15 @@
 #include "serial.h"
 #include "cmd.h"
 #include "ZigbeeDevices.h"
+#include "ZcbNodeFlow.h"
+#include "ZcbMailbox.h"
 
 #define ZB_DEVICE_OTA_IMAGE_FILE_IDENTIFY      0x1EF1EE0B     
 
+/* ZDO responses may come from a node several hops away */
+#define ZB_ZDO_RESPONSE_TIMEOUT_MS             5000
+#define ZB_ZCL_RESPONSE_TIMEOUT_MS             3000
+
 // ------------------------------------------------------------------
 // External prototype
 // ------------------------------------------------------------------
@@ -325,6 +331,111 @@ teZcbStatus eIeeeAddressRequest(uint16_t u16DstShortAddr,
 
 
 
+static bool bIeeeAddressResponseMatch(uint32_t u32MatchKey, uint16_t u16Length, const void *pvMessage)
+{
+    const struct _IeeeAddressResponse {
+        uint8_t     u8SequenceNo;
+        uint8_t     u8Status;
+        uint64_t    u64IeeeAddress;
+        uint16_t    u16ShortAddress;
+    } PACKED *psResponse = (const struct _IeeeAddressResponse *)pvMessage;
+
+    if (u16Length < sizeof(struct _IeeeAddressResponse)) {
+        return false;
+    }
+    return (pri_ntohs(psResponse->u16ShortAddress) == (uint16_t)u32MatchKey);
+}
+
+teZcbStatus eIeeeAddressRequestAsync(uint16_t u16DstShortAddr,
+                                     uint16_t u16InterestShortAddr,
+                                     uint8_t u8RstType,
+                                     uint8_t u8Index,
+                                     tprSL_RequestCallback prCallback,
+                                     void *pvUser)
+{
+    struct _IeeeAddressRequestMessage {
+        uint16_t    u16TargetShortAddress;
+        uint16_t    u16InterestShortAddress;
+        uint8_t     u8RequestType;
+        uint8_t     u8StartIndex;
+    } PACKED sIeeeAddressRequestMessage;
+    tsSL_Request sRequest;
+
+    sIeeeAddressRequestMessage.u16TargetShortAddress   = pri_ntohs(u16DstShortAddr);
+    sIeeeAddressRequestMessage.u16InterestShortAddress = pri_ntohs(u16InterestShortAddr);
+    sIeeeAddressRequestMessage.u8RequestType           = u8RstType;
+    sIeeeAddressRequestMessage.u8StartIndex            = u8Index;
+
+    sRequest.u16Type         = E_SL_MSG_IEEE_ADDRESS_REQUEST;
+    sRequest.u16Length       = sizeof(struct _IeeeAddressRequestMessage);
+    sRequest.pvMessage       = &sIeeeAddressRequestMessage;
+    sRequest.u16ResponseType = E_SL_MSG_IEEE_ADDRESS_RESPONSE;
+    sRequest.prMatch         = bIeeeAddressResponseMatch;
+    sRequest.u32MatchKey     = u16InterestShortAddr;
+    sRequest.bMatchSequenceNo = true;
+    sRequest.u32Timeout      = ZB_ZDO_RESPONSE_TIMEOUT_MS;
+    sRequest.prCallback      = prCallback;
+    sRequest.pvUser          = pvUser;
+
+    if (eSL_SendRequest(&sRequest, NULL) != E_SL_OK) {
+        return E_ZCB_COMMS_FAILED;
+    }
+
+    return E_ZCB_OK;
+}
+
+
+
+teZcbStatus eMgmtNetworkUpdateRequest(uint16_t u16DstShortAddr,
+                                      uint32_t u32ChannelMask,
+                                      uint8_t u8ScanDuration,
+                                      uint8_t u8ScanCount,
+                                      uint16_t u16NwkManagerAddr)
+{
+    struct _MgmtNetworkUpdateRequestMessage {
+        uint16_t    u16TargetShortAddress;
+        uint32_t    u32ChannelMask;
+        uint8_t     u8ScanDuration;
+        uint8_t     u8ScanCount;
+        uint16_t    u16NwkManagerAddress;
+    } PACKED sMgmtNetworkUpdateRequestMessage;
+
+    sMgmtNetworkUpdateRequestMessage.u16TargetShortAddress = pri_ntohs(u16DstShortAddr);
+    sMgmtNetworkUpdateRequestMessage.u32ChannelMask        = pri_ntohl(u32ChannelMask);
+    sMgmtNetworkUpdateRequestMessage.u8ScanDuration        = u8ScanDuration;
+    sMgmtNetworkUpdateRequestMessage.u8ScanCount           = u8ScanCount;
+    sMgmtNetworkUpdateRequestMessage.u16NwkManagerAddress  = pri_ntohs(u16NwkManagerAddr);
+
+    if (eSL_SendMessage(E_SL_MSG_MANAGEMENT_NETWORK_UPDATE_REQUEST, sizeof(struct _MgmtNetworkUpdateRequestMessage),
+            &sMgmtNetworkUpdateRequestMessage, NULL) != E_SL_OK) {
+        return E_ZCB_COMMS_FAILED;
+    }
+
+    return E_ZCB_OK;
+}
+
+
+
+teZcbStatus eMgmtLqiRequest(uint16_t u16DstShortAddr, uint8_t u8StartIndex, uint8_t *pu8SequenceNo)
+{
+    struct _MgmtLqiRequestMessage {
+        uint16_t    u16TargetShortAddress;
+        uint8_t     u8StartIndex;
+    } PACKED sMgmtLqiRequestMessage;
+
+    sMgmtLqiRequestMessage.u16TargetShortAddress = pri_ntohs(u16DstShortAddr);
+    sMgmtLqiRequestMessage.u8StartIndex          = u8StartIndex;
+
+    if (eSL_SendMessage(E_SL_MSG_MANAGEMENT_LQI_REQUEST, sizeof(struct _MgmtLqiRequestMessage),
+            &sMgmtLqiRequestMessage, pu8SequenceNo) != E_SL_OK) {
+        return E_ZCB_COMMS_FAILED;
+    }
+
+    return E_ZCB_OK;
+}
+
+
+
 teZcbStatus eReadAttributeRequest(uint8_t u8AddrMode, 
                                   uint16_t u16Addr, 
                                   uint8_t u8SrcEp, 
@@ -336,6 +447,8 @@ teZcbStatus eReadAttributeRequest(uint8_t u8AddrMode,
 {
     uint8_t u8SequenceNo;
     teSL_Status eStatus;
+    bool bUnicast;
+    uint16_t u16Length;
 
     if (u8NumOfAttr > MAX_NB_READ_ATTRIBUTES) {
         u8NumOfAttr = MAX_NB_READ_ATTRIBUTES;
@@ -362,10 +475,24 @@ teZcbStatus eReadAttributeRequest(uint8_t u8AddrMode,
    // LOG(ZBCMD, INFO, "Send Read Attribute Request to 0x%04x, endpoints: 0x%02x -> 0x%02x\r\n",
      //   u16Addr, u8SrcEp, u8DstEp);
 
-    eStatus = eSL_SendMessage(E_SL_MSG_READ_ATTRIBUTE_REQUEST,
-        sizeof(tsZDReadAttrReq) + sizeof(uint16_t)*(u8NumOfAttr - MAX_NB_READ_ATTRIBUTES), &sReadAttrReq, &u8SequenceNo);
+    u16Length = sizeof(tsZDReadAttrReq) + sizeof(uint16_t)*(u8NumOfAttr - MAX_NB_READ_ATTRIBUTES);
+    bUnicast = (u8AddrMode == E_ZD_ADDRESS_MODE_SHORT) || (u8AddrMode == E_ZD_ADDRESS_MODE_SHORT_NO_ACK);
+
+    /* Held until a sleepy node is heard again */
+    if (bUnicast && bZCB_MailboxShouldHold(u16Addr)) {
+        return eZCB_MailboxPost(u16Addr, E_SL_MSG_READ_ATTRIBUTE_REQUEST, u16Length, &sReadAttrReq);
+    }
+
+    if (bUnicast && (eZCB_NodeFlowAcquire(u16Addr) != E_ZCB_OK)) {
+        return E_ZCB_REQUEST_NOT_ACTIONED;
+    }
+
+    eStatus = eSL_SendMessage(E_SL_MSG_READ_ATTRIBUTE_REQUEST, u16Length, &sReadAttrReq, &u8SequenceNo);
     if (eStatus != E_SL_OK)
     {
+        if (bUnicast) {
+            vZCB_NodeFlowRelease(u16Addr);
+        }
     //    LOG(ZBCMD, ERR, "Send Read Attribute Request to 0x%04x : Fail (0x%x)\r\n",
         //    u16Addr, eStatus);
         return E_ZCB_COMMS_FAILED;
@@ -374,6 +501,161 @@ teZcbStatus eReadAttributeRequest(uint8_t u8AddrMode,
     return E_ZCB_OK;
 }
 
+teZcbStatus eWriteAttributeRequest(uint8_t u8AddrMode,
+                                   uint16_t u16Addr,
+                                   uint8_t u8SrcEp,
+                                   uint8_t u8DstEp,
+                                   uint16_t u16ClusterId,
+                                   uint16_t u16AttributeId,
+                                   uint8_t u8AttributeType,
+                                   uint64_t u64Value,
+                                   uint8_t u8Size)
+{
+    struct _WriteAttributeRequest
+    {
+        uint8_t     u8TargetAddrMode;
+        uint16_t    u16TargetAddress;
+        uint8_t     u8SrcEndpoint;
+        uint8_t     u8DstEndpoint;
+        uint16_t    u16ClusterID;
+        uint8_t     bDirection;
+        uint8_t     bManuSpecific;
+        uint16_t    u16ManuCode;
+        uint8_t     u8AttrCount;
+        uint16_t    u16AttributeId;
+        uint8_t     u8DataType;
+        uint8_t     au8Value[8];
+    } PACKED sWriteAttributeRequest;
+
+    uint16_t u16Length;
+    uint8_t u8SequenceNo;
+    bool bUnicast;
+
+    if ((u8Size == 0) || (u8Size > sizeof(sWriteAttributeRequest.au8Value))) {
+        return E_ZCB_INVALID_VALUE;
+    }
+
+    sWriteAttributeRequest.u8TargetAddrMode = u8AddrMode;
+    sWriteAttributeRequest.u16TargetAddress = pri_ntohs(u16Addr);
+    sWriteAttributeRequest.u8SrcEndpoint    = u8SrcEp;
+    sWriteAttributeRequest.u8DstEndpoint    = u8DstEp;
+    sWriteAttributeRequest.u16ClusterID     = pri_ntohs(u16ClusterId);
+    sWriteAttributeRequest.bDirection       = SEND_DIR_FROM_CLIENT_TO_SERVER;
+    sWriteAttributeRequest.bManuSpecific    = MANUFACTURER_SPECIFIC_FALSE;
+    sWriteAttributeRequest.u16ManuCode      = 0;
+    sWriteAttributeRequest.u8AttrCount      = 1;
+    sWriteAttributeRequest.u16AttributeId   = pri_ntohs(u16AttributeId);
+    sWriteAttributeRequest.u8DataType       = u8AttributeType;
+
+    /* Value in network byte order, most significant byte first */
+    for (uint8_t i = 0; i < u8Size; i++) {
+        sWriteAttributeRequest.au8Value[i] = (uint8_t)(u64Value >> (8 * (u8Size - 1 - i)));
+    }
+    u16Length = sizeof(struct _WriteAttributeRequest) - sizeof(sWriteAttributeRequest.au8Value) + u8Size;
+    bUnicast = (u8AddrMode == E_ZD_ADDRESS_MODE_SHORT) || (u8AddrMode == E_ZD_ADDRESS_MODE_SHORT_NO_ACK);
+
+    /* Held until a sleepy node is heard again */
+    if (bUnicast && bZCB_MailboxShouldHold(u16Addr)) {
+        return eZCB_MailboxPost(u16Addr, E_SL_MSG_WRITE_ATTRIBUTE_REQUEST, u16Length, &sWriteAttributeRequest);
+    }
+
+    /* The slot is completed by the write attribute response listener */
+    if (bUnicast && (eZCB_NodeFlowAcquire(u16Addr) != E_ZCB_OK)) {
+        return E_ZCB_REQUEST_NOT_ACTIONED;
+    }
+
+    if (eSL_SendMessage(E_SL_MSG_WRITE_ATTRIBUTE_REQUEST, u16Length,
+                        &sWriteAttributeRequest, &u8SequenceNo) != E_SL_OK) {
+        if (bUnicast) {
+            vZCB_NodeFlowRelease(u16Addr);
+        }
+        return E_ZCB_COMMS_FAILED;
+    }
+
+    return E_ZCB_OK;
+}
+
+/* Read attribute response header: sequence number, short address, endpoint, cluster */
+static bool bReadAttributeResponseMatch(uint32_t u32MatchKey, uint16_t u16Length, const void *pvMessage)
+{
+    const struct _ReadAttributeResponse {
+        uint8_t     u8SequenceNo;
+        uint16_t    u16ShortAddress;
+        uint8_t     u8Endpoint;
+        uint16_t    u16ClusterId;
+    } PACKED *psResponse = (const struct _ReadAttributeResponse *)pvMessage;
+
+    if (u16Length < sizeof(struct _ReadAttributeResponse)) {
+        return false;
+    }
+    return (pri_ntohs(psResponse->u16ShortAddress) == (uint16_t)(u32MatchKey >> 16))
+        && (pri_ntohs(psResponse->u16ClusterId) == (uint16_t)u32MatchKey);
+}
+
+teZcbStatus eReadAttributeRequestAsync(uint16_t u16Addr,
+                                       uint8_t u8SrcEp,
+                                       uint8_t u8DstEp,
+                                       uint16_t u16ClusterId,
+                                       uint8_t u8NumOfAttr,
+                                       uint16_t* au16AttrList,
+                                       tprSL_RequestCallback prCallback,
+                                       void *pvUser)
+{
+    tsSL_Request sRequest;
+    uint16_t u16Length;
+
+    if (u8NumOfAttr > MAX_NB_READ_ATTRIBUTES) {
+        u8NumOfAttr = MAX_NB_READ_ATTRIBUTES;
+    }
+
+    tsZDReadAttrReq sReadAttrReq =
+    {
+        .u8AddressMode              = E_ZD_ADDRESS_MODE_SHORT,
+        .u16ShortAddress            = pri_ntohs(u16Addr),
+        .u8SourceEndPointId         = u8SrcEp,
+        .u8DestinationEndPointId    = u8DstEp,
+        .u16ClusterId               = pri_ntohs(u16ClusterId),
+        .bDirectionIsServerToClient = SEND_DIR_FROM_CLIENT_TO_SERVER,
+        .bIsManufacturerSpecific    = MANUFACTURER_SPECIFIC_FALSE,
+        .u16ManufacturerCode        = 0,
+        .u8NumberOfAttributes       = u8NumOfAttr,
+    };
+
+    for (uint8_t i = 0; i < u8NumOfAttr; i++)
+    {
+        sReadAttrReq.au16AttributeList[i] = pri_ntohs(au16AttrList[i]);
+    }
+
+    /* Not held for sleepy nodes, the caller is waiting for the answer */
+    if (bZCB_MailboxShouldHold(u16Addr)) {
+        return E_ZCB_REQUEST_NOT_ACTIONED;
+    }
+
+    if (eZCB_NodeFlowAcquire(u16Addr) != E_ZCB_OK) {
+        return E_ZCB_REQUEST_NOT_ACTIONED;
+    }
+
+    u16Length = sizeof(tsZDReadAttrReq) + sizeof(uint16_t)*(u8NumOfAttr - MAX_NB_READ_ATTRIBUTES);
+
+    sRequest.u16Type         = E_SL_MSG_READ_ATTRIBUTE_REQUEST;
+    sRequest.u16Length       = u16Length;
+    sRequest.pvMessage       = &sReadAttrReq;
+    sRequest.u16ResponseType = E_SL_MSG_READ_ATTRIBUTE_RESPONSE;
+    sRequest.prMatch         = bReadAttributeResponseMatch;
+    sRequest.u32MatchKey     = ((uint32_t)u16Addr << 16) | u16ClusterId;
+    sRequest.bMatchSequenceNo = true;
+    sRequest.u32Timeout      = ZB_ZCL_RESPONSE_TIMEOUT_MS;
+    sRequest.prCallback      = prCallback;
+    sRequest.pvUser          = pvUser;
+
+    if (eSL_SendRequest(&sRequest, NULL) != E_SL_OK) {
+        vZCB_NodeFlowRelease(u16Addr);
+        return E_ZCB_COMMS_FAILED;
+    }
+
+    return E_ZCB_OK;
+}
+
 
 
 teZcbStatus eSendBindUnbindCommand(uint64_t u64TargetIeeeAddr,
@@ -399,6 +681,8 @@ teZcbStatus eSendBindUnbindCommand(uint64_t u64TargetIeeeAddr,
 
     uint16_t u16Length = sizeof(struct _BindUnbindReq);
     uint8_t u8SequenceNo;
+    uint16_t u16TargetAddr = 0xFFFF;
+    tsZbDeviceInfo *sDevice = tZDM_FindDeviceByIeeeAddress(u64TargetIeeeAddr);
     
     memset( (char *)&sBindUnbindReq, 0, u16Length );
 
@@ -411,6 +695,18 @@ teZcbStatus eSendBindUnbindCommand(uint64_t u64TargetIeeeAddr,
     
   //  LOG(ZBCMD, INFO, "Send (Un-)Binding request to 0x%016llX (%d)\r\n", u64TargetIeeeAddr, u16Length);
 
+    /* The request goes to the target node: held while it sleeps, else it takes an in-flight slot */
+    if (sDevice != NULL) {
+        u16TargetAddr = sDevice->u16NodeId;
+        if (bZCB_MailboxShouldHold(u16TargetAddr)) {
+            return eZCB_MailboxPost(u16TargetAddr, bBind ? E_SL_MSG_BIND : E_SL_MSG_UNBIND,
+                                    u16Length, &sBindUnbindReq);
+        }
+        if (eZCB_NodeFlowAcquire(u16TargetAddr) != E_ZCB_OK) {
+            return E_ZCB_REQUEST_NOT_ACTIONED;
+        }
+    }
+
     if (bBind) 
     {    
         if (eSL_SendMessage( E_SL_MSG_BIND,
@@ -419,6 +715,7 @@ teZcbStatus eSendBindUnbindCommand(uint64_t u64TargetIeeeAddr,
                              &u8SequenceNo) != E_SL_OK) 
         {
      //       LOG(ZBCMD, ERR, "Sending bind command fail\r\n");
+            vZCB_NodeFlowRelease(u16TargetAddr);
             return E_ZCB_COMMS_FAILED;
         }
         else
@@ -427,6 +724,7 @@ teZcbStatus eSendBindUnbindCommand(uint64_t u64TargetIeeeAddr,
             if (eSL_MessageWait(E_SL_MSG_BIND_RESPONSE, 1000, NULL, NULL) != E_SL_OK)
             {
        //         LOG(ZBCMD, ERR, "No bind response is received\r\n");
+                vZCB_NodeFlowComplete(u16TargetAddr, false);
                 return E_ZCB_COMMS_FAILED;
             }
         }
@@ -439,6 +737,7 @@ teZcbStatus eSendBindUnbindCommand(uint64_t u64TargetIeeeAddr,
                              &u8SequenceNo) != E_SL_OK) 
         {
      //       LOG(ZBCMD, ERR, "Sending unbind command fail\n");
+            vZCB_NodeFlowRelease(u16TargetAddr);
             return E_ZCB_COMMS_FAILED;
         } 
         else
@@ -447,11 +746,70 @@ teZcbStatus eSendBindUnbindCommand(uint64_t u64TargetIeeeAddr,
             if (eSL_MessageWait(E_SL_MSG_UNBIND_RESPONSE, 1000, NULL, NULL) != E_SL_OK)
             {
     //            LOG(ZBCMD, ERR, "No unbind response is received\r\n");
+                vZCB_NodeFlowComplete(u16TargetAddr, false);
                 return E_ZCB_COMMS_FAILED;
             }
         }
 
     }
+    vZCB_NodeFlowComplete(u16TargetAddr, true);
+    return E_ZCB_OK;
+}
+
+teZcbStatus eSendBindRequestAsync(uint64_t u64TargetIeeeAddr,
+                                  uint8_t u8TargetEp,
+                                  uint16_t u16ClusterId,
+                                  tprSL_RequestCallback prCallback,
+                                  void *pvUser)
+{
+    struct _BindReq {
+        uint64_t u64SrcAddress;
+        uint8_t u8SrcEndpoint;
+        uint16_t u16ClusterId;
+        uint8_t u8DstAddrMode;
+        uint64_t u64DstAddress;
+        uint8_t u8DstEndPoint;
+    } PACKED sBindReq;
+    tsSL_Request sRequest;
+    tsZbDeviceInfo *sDevice = tZDM_FindDeviceByIeeeAddress(u64TargetIeeeAddr);
+
+    sBindReq.u64SrcAddress = pri_ntohd(u64TargetIeeeAddr);
+    sBindReq.u8SrcEndpoint = u8TargetEp;
+    sBindReq.u16ClusterId  = pri_ntohs(u16ClusterId);
+    sBindReq.u8DstAddrMode = E_ZD_ADDRESS_MODE_IEEE;
+    sBindReq.u64DstAddress = pri_ntohd(zbNetworkInfo.u64IeeeAddress);
+    sBindReq.u8DstEndPoint = ZB_ENDPOINT_ATTR;
+
+    /* Held while the node sleeps, nothing will answer before it wakes;
+     * else it takes an in-flight slot, completed by the callback */
+    if (sDevice != NULL) {
+        if (bZCB_MailboxShouldHold(sDevice->u16NodeId)) {
+            return eZCB_MailboxPost(sDevice->u16NodeId, E_SL_MSG_BIND, sizeof(struct _BindReq), &sBindReq);
+        }
+        if (eZCB_NodeFlowAcquire(sDevice->u16NodeId) != E_ZCB_OK) {
+            return E_ZCB_REQUEST_NOT_ACTIONED;
+        }
+    }
+
+    /* The bind response does not name the node, only the sequence number of the bind */
+    sRequest.u16Type         = E_SL_MSG_BIND;
+    sRequest.u16Length       = sizeof(struct _BindReq);
+    sRequest.pvMessage       = &sBindReq;
+    sRequest.u16ResponseType = E_SL_MSG_BIND_RESPONSE;
+    sRequest.prMatch         = NULL;
+    sRequest.u32MatchKey     = 0;
+    sRequest.bMatchSequenceNo = true;
+    sRequest.u32Timeout      = ZB_ZDO_RESPONSE_TIMEOUT_MS;
+    sRequest.prCallback      = prCallback;
+    sRequest.pvUser          = pvUser;
+
+    if (eSL_SendRequest(&sRequest, NULL) != E_SL_OK) {
+        if (sDevice != NULL) {
+            vZCB_NodeFlowRelease(sDevice->u16NodeId);
+        }
+        return E_ZCB_COMMS_FAILED;
+    }
+
     return E_ZCB_OK;
 }
 
@@ -512,6 +870,12 @@ teZcbStatus eConfigureReportingCommand(uint8_t u8AddrMode,
     sAttributeReportingConfigurationRequest.u16Timeout       = 0;
     sAttributeReportingConfigurationRequest.u8AttrChange     = u8Change;
 
+    /* Held until a sleepy node is heard again */
+    if (bZCB_MailboxShouldHold(u16Addr)) {
+        return eZCB_MailboxPost(u16Addr, E_SL_MSG_CONFIG_REPORTING_REQUEST,
+                                u16Length, &sAttributeReportingConfigurationRequest);
+    }
+
     if (eSL_SendMessage( E_SL_MSG_CONFIG_REPORTING_REQUEST,
                          u16Length, 
                          &sAttributeReportingConfigurationRequest, 
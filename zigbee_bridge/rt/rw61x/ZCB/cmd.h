@@ -14,6 +14,7 @@ extern "C" {
 #endif
 
 #include "zcb.h"
+#include "SerialLink.h"
 
 
 /****************************************************************************/
@@ -68,6 +69,25 @@ teZcbStatus eIeeeAddressRequest(uint16_t u16DstShortAddr,
                                 uint8_t u8RstType,
                                 uint8_t u8Index);
 
+/* Same request without blocking, prCallback gets the IEEE_addr_rsp of u16InterestShortAddr */
+teZcbStatus eIeeeAddressRequestAsync(uint16_t u16DstShortAddr,
+                                     uint16_t u16InterestShortAddr,
+                                     uint8_t u8RstType,
+                                     uint8_t u8Index,
+                                     tprSL_RequestCallback prCallback,
+                                     void *pvUser);
+
+teZcbStatus eMgmtNetworkUpdateRequest(uint16_t u16DstShortAddr,
+                                      uint32_t u32ChannelMask,
+                                      uint8_t u8ScanDuration,
+                                      uint8_t u8ScanCount,
+                                      uint16_t u16NwkManagerAddr);
+
+/** Ask a node for its neighbour table from u8StartIndex on. The sequence
+ *  number of the request, which its response carries, goes to pu8SequenceNo
+ *  when given. */
+teZcbStatus eMgmtLqiRequest(uint16_t u16DstShortAddr, uint8_t u8StartIndex, uint8_t *pu8SequenceNo);
+
 teZcbStatus eReadAttributeRequest(uint8_t u8AddrMode, 
                                   uint16_t u16Addr, 
                                   uint8_t u8SrcEp, 
@@ -77,11 +97,43 @@ teZcbStatus eReadAttributeRequest(uint8_t u8AddrMode,
                                   uint8_t u8NumOfAttr,
                                   uint16_t* au16AttrList);
 
+/** Read attributes of a node without waiting for the response. The callback
+ *  runs on the SerialLink callback task with the response or on timeout; the
+ *  response is also handled as usual. Sleepy nodes are not read. */
+teZcbStatus eReadAttributeRequestAsync(uint16_t u16Addr,
+                                       uint8_t u8SrcEp,
+                                       uint8_t u8DstEp,
+                                       uint16_t u16ClusterId,
+                                       uint8_t u8NumOfAttr,
+                                       uint16_t* au16AttrList,
+                                       tprSL_RequestCallback prCallback,
+                                       void *pvUser);
+
+/** Write a single attribute of up to 8 bytes, value in host byte order */
+teZcbStatus eWriteAttributeRequest(uint8_t u8AddrMode,
+                                   uint16_t u16Addr,
+                                   uint8_t u8SrcEp,
+                                   uint8_t u8DstEp,
+                                   uint16_t u16ClusterId,
+                                   uint16_t u16AttributeId,
+                                   uint8_t u8AttributeType,
+                                   uint64_t u64Value,
+                                   uint8_t u8Size);
+
 teZcbStatus eSendBindUnbindCommand(uint64_t u64TargetIeeeAddr,
                                    uint8_t u8TargetEp,
                                    uint16_t u16ClusterID,
                                    bool bBind);
 
+/** Bind a cluster of a node to the bridge without waiting for the response.
+ *  E_ZCB_DEFERRED when held for a sleepy node, prCallback is not called then.
+ *  The request takes an in-flight slot of the node, prCallback completes it. */
+teZcbStatus eSendBindRequestAsync(uint64_t u64TargetIeeeAddr,
+                                  uint8_t u8TargetEp,
+                                  uint16_t u16ClusterId,
+                                  tprSL_RequestCallback prCallback,
+                                  void *pvUser);
+
 teZcbStatus eConfigureReportingCommand(uint8_t u8AddrMode, 
                                        uint16_t u16Addr, 
                                        uint8_t u8SrcEp, 
@@ -130,6 +130,8 @@ typedef struct newdb_zcb {
         uint8_t hasIlluminanceSensing:1;
         uint8_t hasTemperatureSensing:1;
         uint8_t hasOccupancySensing:1;
+        uint8_t hasIasZone:1;
+        uint8_t hasIasOccupancy:1;
       } sClusterBitmap;
     } uSupportedClusters;
     char info[LEN_CMD+2];
@@ -23,6 +23,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stddef.h>
 #include <stdbool.h>
 
 #include "ZigbeeConstant.h"
@@ -31,26 +32,51 @@
 #include "cmd.h"
 #include "zcb.h"
 
-#include "ram_storage.h" 
-
 #include "zigbee_cmd.h"
 
 #include "ZcbMessage.h"
+#include "ZcbAckPolicy.h"
+#include "ZcbNodeFlow.h"
+#include "ZcbMailbox.h"
+#include "ZcbWatchdog.h"
+#include "ZcbChannelPlanner.h"
+#include "ZcbTopology.h"
+#include "ZcbAttributeMap.h"
+#include "ZcbAddrCache.h"
+#include "ZcbResync.h"
+#include "ZcbScenes.h"
+#include "ZcbIasZone.h"
+#include "ZcbDiscovery.h"
+#include "ZcbProfileCache.h"
+#include "ZcbInterview.h"
+#include "ZcbStringPool.h"
+#include "ZcbIndex.h"
+#include "ZcbLiveness.h"
+#include "ZcbSnapshot.h"
+#include "ZcbNodeStore.h"
 
 #include "CHIPProjectAppConfig.h"
 
-#define ZB_DEVICE_MESSAGE_TIMER_OUT_COUNT    5
+#define ZB_JOINED_NODE_FREE_NONE             0xFF
 
-/* to calculate the time of device receiving last message */
-typedef struct
-{
-    TimerHandle_t xTimers;
-    uint16_t count;
-} tsZbDeviceMsgTimer;
+#define ZCB_SERVICE_TASK_PRIORITY            (tskIDLE_PRIORITY + 2)
+#define ZCB_SERVICE_TASK_STACK_SIZE          512
+#define ZCB_SERVICE_TASK_PERIOD_MS           100
+
+/* Longest wait for the bridge to take the previous message */
+#define ZCB_BRIDGE_MSG_WAIT_MS               500
+
+/* Coordinator reset line */
+#define ZCB_RESET_GPIO_PORT                  1
+#define ZCB_RESET_GPIO_PIN                   (55-32)
+#define ZCB_RESET_PULSE_MS                   10
 
 newdb_zcb_t sZcb;
 
-static JoinedNodesSaved savedNodes;
+/* The network as it was formed, formed again the same way when the
+ * coordinator comes back factory new */
+static uint32_t u32FormChannelMask = ZCB_CHANNEL_ALL_MASK;
+static uint64_t u64FormExtPanId;
 
 // ---------------------------------------------------------------
 // External Function Prototypes
@@ -70,12 +96,14 @@ static void ZCB_HandleNodeClusterAttributeList  (void *pvUser, uint16_t u16Lengt
 static void ZCB_HandleNodeCommandIDList         (void *pvUser, uint16_t u16Length, void *pvMessage);
 static void ZCB_HandleNetworkJoined             (void *pvUser, uint16_t u16Length, void *pvMessage);
 static void ZCB_HandleDeviceAnnounce            (void *pvUser, uint16_t u16Length, void *pvMessage);
+static void ZCB_HandleDataIndication            (void *pvUser, uint16_t u16Length, void *pvMessage);
 static void ZCB_HandleDeviceLeave               (void *pvUser, uint16_t u16Length, void *pvMessage);
 static void ZCB_HandleMatchDescriptorResponse   (void *pvUser, uint16_t u16Length, void *pvMessage);
 static void ZCB_HandleAttributeReport           (void *pvUser, uint16_t u16Length, void *pvMessage);
 static void ZCB_HandleSimpleDescriptorResponse  (void *pvUser, uint16_t u16Length, void *pvMessage);
 static void ZCB_HandleDefaultResponse           (void *pvUser, uint16_t u16Length, void *pvMessage);
 static void ZCB_HandleReadAttrResp              (void *pvUser, uint16_t u16Length, void *pvMessage);
+static void ZCB_HandleWriteAttrResp             (void *pvUser, uint16_t u16Length, void *pvMessage);
 static void ZCB_HandleActiveEndPointResp        (void *pvUser, uint16_t u16Length, void *pvMessage);
 static void ZCB_HandleLog                       (void *pvUser, uint16_t u16Length, void *pvMessage);
 static void ZCB_HandleIASZoneStatusChangeNotify (void *pvUser, uint16_t u16Length, void *pvMessage); 
@@ -87,15 +115,44 @@ static void ZCB_HandleGetPermitResponse         (void *pvUser, uint16_t u16Lengt
 static void ZCB_HandleRestartProvisioned        (void *pvUser, uint16_t u16Length, void *pvMessage);
 static void ZCB_HandleRestartFactoryNew         (void *pvUser, uint16_t u16Length, void *pvMessage);
 
-static void eDeviceTimer_Init();
-static void vDevTimerCallback(TimerHandle_t xTimers);
-tsZbDeviceMsgTimer deviceTimer[MAX_ZD_DEVICE_NUMBERS];
+static void zcbServiceTask(void *pvParameters);
+static void vZCB_JoinedNodesReindex(void);
 
 NodeDB JoinedNodes[DEV_NUM];
 uint8_t idx=0;
 
-const char * myDB_filename = "ZBNodes";
-uint16_t SIZE= DEV_NUM*sizeof(NodeDB);
+/* Lookups of the joined node table, see ZcbIndex.c: by IEEE address for an
+ * entry with one, by short address and Matter endpoint for an entry in use */
+static uint16_t au16JoinedIeeeSlots[ZCB_INDEX_SLOTS(DEV_NUM)];
+static uint16_t au16JoinedShortSlots[ZCB_INDEX_SLOTS(DEV_NUM)];
+static uint16_t au16JoinedEpSlots[ZCB_INDEX_SLOTS(DEV_NUM)];
+
+static tsZCB_Index sJoinedIeeeIndex =
+{
+    au16JoinedIeeeSlots, ZCB_INDEX_SLOTS(DEV_NUM) - 1, 0,
+    (const uint8_t *)&JoinedNodes[0].mac, sizeof(NodeDB), sizeof(uint64_t)
+};
+
+static tsZCB_Index sJoinedShortIndex =
+{
+    au16JoinedShortSlots, ZCB_INDEX_SLOTS(DEV_NUM) - 1, 0,
+    (const uint8_t *)&JoinedNodes[0].shortaddr, sizeof(NodeDB), sizeof(uint16_t)
+};
+
+static tsZCB_Index sJoinedEpIndex =
+{
+    au16JoinedEpSlots, ZCB_INDEX_SLOTS(DEV_NUM) - 1, 0,
+    (const uint8_t *)&JoinedNodes[0].ep, sizeof(NodeDB), sizeof(uint16_t)
+};
+
+/* Chain of the free joined node entries, ZB_JOINED_NODE_FREE_NONE ends it */
+static uint8_t au8JoinedNextFree[DEV_NUM];
+static uint8_t u8JoinedFree;
+
+/* Highest endpoint in the table, kept as entries come in so that a new
+ * bridged endpoint never has to look for it; looked for again only when
+ * the entry holding it is cleared */
+static uint16_t u16JoinedMaxEp;
 
 // ---------------------------------------------------------------
 // Exported Functions
@@ -103,15 +160,13 @@ uint16_t SIZE= DEV_NUM*sizeof(NodeDB);
 
 void eZCB_Init(void) 
 {
-	uint8_t i;
-
     gpio_pin_config_t led_config = {kGPIO_DigitalOutput,0,};
 
-	GPIO_PortInit(GPIO, 1);
-	GPIO_PinInit(GPIO, 1, 55-32, &led_config);
+	GPIO_PortInit(GPIO, ZCB_RESET_GPIO_PORT);
+	GPIO_PinInit(GPIO, ZCB_RESET_GPIO_PORT, ZCB_RESET_GPIO_PIN, &led_config);
 	
     /* Hold reset pin until all init process done */
-    GPIO_PinWrite(GPIO, 1, 55-32, 0);
+    GPIO_PinWrite(GPIO, ZCB_RESET_GPIO_PORT, ZCB_RESET_GPIO_PIN, 0);
 
     if (E_SL_OK != eSL_Init())
     {
@@ -128,12 +183,14 @@ void eZCB_Init(void)
     eSL_AddListener(E_SL_MSG_NODE_COMMAND_ID_LIST,       ZCB_HandleNodeCommandIDList,        NULL);
     eSL_AddListener(E_SL_MSG_NETWORK_JOINED_FORMED,      ZCB_HandleNetworkJoined,            NULL);
     eSL_AddListener(E_SL_MSG_DEVICE_ANNOUNCE,            ZCB_HandleDeviceAnnounce,           NULL);
+    eSL_AddListener(E_SL_MSG_DATA_INDICATION,            ZCB_HandleDataIndication,           NULL);
     eSL_AddListener(E_SL_MSG_LEAVE_INDICATION,           ZCB_HandleDeviceLeave,              NULL);
     eSL_AddListener(E_SL_MSG_MATCH_DESCRIPTOR_RESPONSE,  ZCB_HandleMatchDescriptorResponse,  NULL);
     eSL_AddListener(E_SL_MSG_ATTRIBUTE_REPORT,           ZCB_HandleAttributeReport,          NULL);
     eSL_AddListener(E_SL_MSG_SIMPLE_DESCRIPTOR_RESPONSE, ZCB_HandleSimpleDescriptorResponse, NULL);
     eSL_AddListener(E_SL_MSG_DEFAULT_RESPONSE,           ZCB_HandleDefaultResponse,          NULL);
     eSL_AddListener(E_SL_MSG_READ_ATTRIBUTE_RESPONSE,    ZCB_HandleReadAttrResp,             NULL);
+    eSL_AddListener(E_SL_MSG_WRITE_ATTRIBUTE_RESPONSE,   ZCB_HandleWriteAttrResp,            NULL);
     eSL_AddListener(E_SL_MSG_ACTIVE_ENDPOINT_RESPONSE,   ZCB_HandleActiveEndPointResp,       NULL);
     eSL_AddListener(E_SL_MSG_LOG,                        ZCB_HandleLog,                      NULL);
     eSL_AddListener(E_SL_MSG_IAS_ZONE_STATUS_CHANGE_NOTIFY, ZCB_HandleIASZoneStatusChangeNotify, NULL);
@@ -146,30 +203,302 @@ void eZCB_Init(void)
     eSL_AddListener(E_SL_MSG_RESTART_FACTORY_NEW,        ZCB_HandleRestartFactoryNew,        NULL);
 	
     /* Release reset pin to start Zigbee */
-    GPIO_PinWrite(GPIO, 1, 55-32, 1);
+    GPIO_PinWrite(GPIO, ZCB_RESET_GPIO_PORT, ZCB_RESET_GPIO_PIN, 1);
 	
-	for (i=0;i<DEV_NUM;i++)
-		JoinedNodes[i].type=JoinedNodes[i].ep=JoinedNodes[i].shortaddr=JoinedNodes[i].mac=0;
+	vZCB_JoinedNodesClear();
+
+    /* The joined nodes saved, kept in the table from now on */
+    (void)u8ZCB_NodeStoreInit(JoinedNodes, DEV_NUM);
+    vZCB_JoinedNodesReindex();
 	
     /* only register Zigbee Cmd after */
    // ZigBeeCmdRegister();
 
-    /* Create the device timers */
-    eDeviceTimer_Init();
+    vZCB_NodeFlowInit();
+    vZCB_AckPolicyInit();
+    vZCB_MailboxInit();
+    vZCB_WatchdogInit();
+    vZCB_ChannelPlannerInit();
+    vZCB_TopologyInit();
+    vZCB_AttributeMapInit();
+    vZCB_AddrCacheInit();
+    vZCB_ResyncInit();
+    vZCB_ScenesInit();
+    vZCB_IasZoneInit();
+    vZCB_DiscoveryInit();
+    vZCB_ProfileInit();
+    vZCB_InterviewInit();
+    vZCB_StringPoolInit();
+    vZCB_LivenessInit();
+    vZCB_SnapshotInit();
+
+    /* The nodes are looked up in the snapshot from the other tasks, brought
+     * up to date at the end of each batch of messages */
+    vSL_SetIdleCallback(vZCB_SnapshotPublish);
+
+    /* Start the low priority task for deadline and retry handling */
+    if (pdPASS != xTaskCreate(zcbServiceTask,
+                              "zcbServiceTask",
+                              ZCB_SERVICE_TASK_STACK_SIZE,
+                              NULL,
+                              ZCB_SERVICE_TASK_PRIORITY,
+                              NULL))
+    {
+        PRINTF("\n Create zcbServiceTask failed\n");
+    }
+}
+
+static void zcbServiceTask(void *pvParameters)
+{
+    while (1) {
+        vTaskDelay(pdMS_TO_TICKS(ZCB_SERVICE_TASK_PERIOD_MS));
+        vSL_RequestPoll();
+        vZCB_AckPolicyPoll();
+        vZCB_MailboxPoll();
+        vZCB_WatchdogPoll();
+        vZCB_ChannelPlannerPoll();
+        vZCB_TopologyPoll();
+        vZCB_ResyncPoll();
+        vZCB_IasZonePoll();
+        vZCB_InterviewPoll();
+        vZCB_DiscoveryPoll();
+        vZCB_LivenessPoll();
+        vZCB_NodeStorePoll();
+        vZCB_SnapshotPublish();
+    }
+}
+
+void vZCB_PulseCoordinatorReset(void)
+{
+    GPIO_PinWrite(GPIO, ZCB_RESET_GPIO_PORT, ZCB_RESET_GPIO_PIN, 0);
+    vTaskDelay(pdMS_TO_TICKS(ZCB_RESET_PULSE_MS));
+    GPIO_PinWrite(GPIO, ZCB_RESET_GPIO_PORT, ZCB_RESET_GPIO_PIN, 1);
+}
+
+teZcbStatus eZCB_FormNetwork(uint32_t u32ChannelMask, uint64_t u64ExtPanId)
+{
+    teZcbStatus eStatus;
+
+    u32FormChannelMask = u32ChannelMask;
+    u64FormExtPanId    = u64ExtPanId;
+
+    eStatus = eSetChannelMask(u32ChannelMask);
+    if (eStatus == E_ZCB_OK) {
+        eStatus = eSetExPANID(u64ExtPanId);
+    }
+    if (eStatus == E_ZCB_OK) {
+        eStatus = eStartNetwork();
+    }
+    return eStatus;
+}
+
+/* The coordinator lost its network: brought up again as a coordinator and
+ * the network formed with the same extended PAN ID, on the channel it was
+ * last on, so the nodes can rejoin it */
+static void vZCB_NetworkReform(void)
+{
+    uint32_t u32ChannelMask = u32FormChannelMask;
+    teZcbStatus eStatus;
+
+    if (zbNetworkInfo.u8Channel != 0) {
+        u32ChannelMask = 1UL << zbNetworkInfo.u8Channel;
+    }
+    zbNetworkInfo.eNetworkState = E_ZB_NETWORK_STATE_NWK_UNFORMED;
+    PRINTF("\n ### Coordinator lost its network, forming it again, channel mask 0x%08x\n", (unsigned int)u32ChannelMask);
+
+    eStatus = eSetDeviceType(E_MODE_COORDINATOR);
+    if (eStatus == E_ZCB_OK) {
+        eStatus = eSetChannelMask(u32ChannelMask);
+    }
+    if (eStatus == E_ZCB_OK) {
+        eStatus = eSetExPANID(u64FormExtPanId);
+    }
+    if (eStatus == E_ZCB_OK) {
+        eStatus = eStartNetwork();
+    }
+    if (eStatus != E_ZCB_OK) {
+        PRINTF("\n ### Forming the network again failed (%d), form it with zb-nwk-form\n", eStatus);
+    }
 }
 
-static void eDeviceTimer_Init()
+void vZCB_CoordinatorResync(bool bFactoryNew, uint8_t u8Status)
 {
+    tsZbDeviceInfo *sDevice;
+    uint8_t u8Count = 0;
+
+    PRINTF("\n ### Coordinator restarted, FactoryNew = %d, status = %d\n", bFactoryNew, u8Status);
+
+    if (eZCB_GetCoordinatorVersion() != E_ZCB_OK) {
+        PRINTF("\n ### Coordinator version check failed after restart\n");
+    }
+
+    /* Commands in flight before the restart will never be answered */
+    vZCB_NodeFlowResetAll();
+
+    if (bFactoryNew) {
+        vZCB_NetworkReform();
+        return;
+    }
+
+    /* The network survived, give every known node a fresh liveness period */
     for (uint8_t i = 0; i < MAX_ZD_DEVICE_NUMBERS; i++) {
-        deviceTimer[i].xTimers = xTimerCreate( "Timer",
-                                               pdMS_TO_TICKS(65000), //65s
-                                               pdTRUE,&i,vDevTimerCallback);
-        if (deviceTimer[i].xTimers == NULL) {
-            PRINTF("\n deviceTimer[%d] create fail",i);
+        sDevice = tZDM_FindDeviceByIndex(i);
+        if ((sDevice == NULL)
+            || ((sDevice->eDeviceState != E_ZB_DEVICE_STATE_ACTIVE)
+                && (sDevice->eDeviceState != E_ZB_DEVICE_STATE_OFF_LINE))) {
+            continue;
+        }
+        vZCB_LivenessSeen(i);
+        u8Count++;
+    }
+    PRINTF("\n ### %d node(s) kept, reading them back\n", u8Count);
+
+    /* Reports sent while the coordinator was down are lost */
+    vZCB_ResyncStart();
+}
+
+void vZCB_NodeAlive(uint16_t u16ShortAddress)
+{
+    uint8_t index = uZDM_FindDevTableIndexByNodeId(u16ShortAddress);
+
+    if (index != 0xFF) {
+        vZCB_LivenessSeen(index);
+    }
+}
+
+/* A joined node entry is taken out of the lookups before it changes and put
+ * back after, each lookup keeps the entries its key is set in */
+static void vZCB_JoinedNodeUnindex(uint8_t i)
+{
+    if (JoinedNodes[i].mac != 0) {
+        vZCB_IndexRemove(&sJoinedIeeeIndex, i);
+    }
+    if (JoinedNodes[i].type != 0) {
+        vZCB_IndexRemove(&sJoinedShortIndex, i);
+        if (JoinedNodes[i].ep != 0) {
+            vZCB_IndexRemove(&sJoinedEpIndex, i);
         }
     }
 }
 
+static void vZCB_JoinedNodeInsert(uint8_t i)
+{
+    if (JoinedNodes[i].ep > u16JoinedMaxEp) {
+        u16JoinedMaxEp = JoinedNodes[i].ep;
+    }
+    if (JoinedNodes[i].mac != 0) {
+        vZCB_IndexInsert(&sJoinedIeeeIndex, i);
+    }
+    if (JoinedNodes[i].type != 0) {
+        vZCB_IndexInsert(&sJoinedShortIndex, i);
+        if (JoinedNodes[i].ep != 0) {
+            vZCB_IndexInsert(&sJoinedEpIndex, i);
+        }
+    }
+}
+
+/* The lookups and the free chain made again from the table, after it was
+ * loaded as a whole */
+static void vZCB_JoinedNodesReindex(void)
+{
+    vZCB_IndexClear(&sJoinedIeeeIndex);
+    vZCB_IndexClear(&sJoinedShortIndex);
+    vZCB_IndexClear(&sJoinedEpIndex);
+    u8JoinedFree = ZB_JOINED_NODE_FREE_NONE;
+
+    for (uint8_t i = DEV_NUM; i-- > 0; ) {
+        vZCB_JoinedNodeInsert(i);
+        if ((JoinedNodes[i].type == 0) && (JoinedNodes[i].ep == 0)) {
+            au8JoinedNextFree[i] = u8JoinedFree;
+            u8JoinedFree = i;
+        }
+    }
+}
+
+static void vZCB_JoinedNodeIndex(uint8_t i)
+{
+    vZCB_JoinedNodeInsert(i);
+    if (bZCB_IndexNeedsRebuild(&sJoinedIeeeIndex) || bZCB_IndexNeedsRebuild(&sJoinedShortIndex)
+        || bZCB_IndexNeedsRebuild(&sJoinedEpIndex)) {
+        vZCB_JoinedNodesReindex();
+    }
+}
+
+/* Entry of the node in the joined node table, DEV_NUM when it has none */
+static uint8_t u8ZCB_JoinedNodeByShort(uint16_t u16ShortAddress)
+{
+    uint16_t i = u16ZCB_IndexFind(&sJoinedShortIndex, u16ShortAddress);
+
+    return (i == ZCB_INDEX_NONE) ? DEV_NUM : (uint8_t)i;
+}
+
+static uint8_t u8ZCB_JoinedNodeByIeee(uint64_t u64IeeeAddress)
+{
+    uint16_t i = u16ZCB_IndexFind(&sJoinedIeeeIndex, u64IeeeAddress);
+
+    return (i == ZCB_INDEX_NONE) ? DEV_NUM : (uint8_t)i;
+}
+
+/* The entry holding the highest endpoint was cleared, the next highest
+ * takes its place so that the endpoints above it are given again */
+static void vZCB_JoinedMaxEpRecompute(void)
+{
+    u16JoinedMaxEp = 0;
+    for (uint8_t i = 0; i < DEV_NUM; i++) {
+        if (JoinedNodes[i].ep > u16JoinedMaxEp) {
+            u16JoinedMaxEp = JoinedNodes[i].ep;
+        }
+    }
+}
+
+void vZCB_JoinedNodesClear(void)
+{
+    memset(JoinedNodes, 0, sizeof(JoinedNodes));
+    u16JoinedMaxEp = 0;
+    vZCB_JoinedNodesReindex();
+}
+
+uint8_t u8ZCB_JoinedNodeCount(void)
+{
+    uint8_t u8Count = 0;
+
+    for (uint8_t i = 0; i < DEV_NUM; i++) {
+        if (JoinedNodes[i].type != 0) {
+            u8Count++;
+        }
+    }
+    return u8Count;
+}
+
+uint32_t u32ZCB_JoinedNodesRam(void)
+{
+    return sizeof(JoinedNodes) + sizeof(au16JoinedIeeeSlots) + sizeof(au16JoinedShortSlots)
+           + sizeof(au16JoinedEpSlots) + sizeof(au8JoinedNextFree);
+}
+
+uint16_t u16ZCB_JoinedNodeMaxEp(void)
+{
+    return u16JoinedMaxEp;
+}
+
+uint16_t u16ZCB_NodeDynamicEp(uint16_t u16ShortAddress)
+{
+    uint8_t i = u8ZCB_JoinedNodeByShort(u16ShortAddress);
+
+    return (i < DEV_NUM) ? JoinedNodes[i].ep : 0;
+}
+
+void vZCB_NodeSetBridgeType(uint16_t u16ShortAddress, uint8_t u8Type)
+{
+    uint8_t i = u8ZCB_JoinedNodeByShort(u16ShortAddress);
+
+    if (i < DEV_NUM) {
+        vZCB_JoinedNodeUnindex(i);
+        JoinedNodes[i].type = u8Type;
+        vZCB_JoinedNodeIndex(i);
+    }
+}
+
 teZcbStatus eZCB_GetCoordinatorVersion(void) 
 {    
  //   LOG(ZCB, INFO, "eZCB_GetCoordinatorVersion\r\n"); 
@@ -227,7 +556,7 @@ teZcbStatus eOnOff(uint8_t u8AddrMode,
     return E_ZCB_OK;
 }
 
-teZcbStatus eOn_Off( uint16_t u16ShortAddress, uint8_t u8Mode ) 
+static teZcbStatus eOn_OffSend(uint8_t u8AddrMode, uint16_t u16ShortAddress, uint8_t u8Mode)
 {
     uint8_t             u8SequenceNo;
     teSL_Status         eStatus;
@@ -240,22 +569,23 @@ teZcbStatus eOn_Off( uint16_t u16ShortAddress, uint8_t u8Mode )
         uint8_t     u8Mode;
     } __attribute__((__packed__)) sOnOffMessage;
 
-    if (u8Mode > 2) {
-        /* Illegal value */
-        return E_ZCB_ERROR;
-    }
-
-    sOnOffMessage.u8TargetAddressMode   = E_ZB_ADDRESS_MODE_SHORT/* E_ZB_ADDRESS_MODE_SHORT_NO_ACK*/;
+    sOnOffMessage.u8TargetAddressMode   = u8AddrMode;
     sOnOffMessage.u16TargetAddress      = pri_ntohs(u16ShortAddress);
     sOnOffMessage.u8SourceEndpoint      = 1;
     sOnOffMessage.u8DestinationEndpoint = 1;
 
     sOnOffMessage.u8Mode = u8Mode;
+
+    if (eZCB_NodeFlowAcquire(u16ShortAddress) != E_ZCB_OK) {
+        return E_ZCB_REQUEST_NOT_ACTIONED;
+    }
+
     eStatus = eSL_SendMessage(E_SL_MSG_ONOFF, sizeof(sOnOffMessage),
         &sOnOffMessage, &u8SequenceNo);
 
     if (eStatus != E_SL_OK)
     {
+      vZCB_NodeFlowRelease(u16ShortAddress);
       PRINTF( "\n ### Sending of Command '%s' failed (0x%02x)\n",(u8Mode? "On" : "Off"),eStatus);
       return E_ZCB_COMMS_FAILED;
     }
@@ -263,6 +593,39 @@ teZcbStatus eOn_Off( uint16_t u16ShortAddress, uint8_t u8Mode )
     return E_ZCB_OK;
 }
 
+static teZcbStatus eOn_OffResend(uint8_t u8AddrMode, uint16_t u16ShortAddress, const uint16_t au16Args[3])
+{
+    return eOn_OffSend(u8AddrMode, u16ShortAddress, (uint8_t)au16Args[0]);
+}
+
+teZcbStatus eOn_Off( uint16_t u16ShortAddress, uint8_t u8Mode ) 
+{
+    uint8_t             u8AddrMode = E_ZB_ADDRESS_MODE_SHORT;
+    teZcbStatus         eStatus;
+    uint16_t            au16Args[3] = {u8Mode, 0, 0};
+
+    if (u8Mode > 2) {
+        /* Illegal value */
+        return E_ZCB_ERROR;
+    }
+
+    /* Toggle is not idempotent, only Off/On may go without APS ack */
+    if (u8Mode != E_CLD_ONOFF_CMD_TOGGLE) {
+        u8AddrMode = u8ZCB_AckPolicySelectAddrMode(u16ShortAddress, ZB_ENDPOINT_DST_DEFAULT,
+                                                   E_ZB_CLUSTERID_ONOFF, E_ZB_ATTRIBUTEID_ONOFF_ONOFF, u8Mode);
+    }
+
+    eStatus = eOn_OffSend(u8AddrMode, u16ShortAddress, u8Mode);
+
+    if ((eStatus == E_ZCB_OK) && (u8AddrMode == E_ZB_ADDRESS_MODE_SHORT_NO_ACK)) {
+        vZCB_AckPolicyTrack(u16ShortAddress, ZB_ENDPOINT_DST_DEFAULT,
+                            E_ZB_CLUSTERID_ONOFF, E_ZB_ATTRIBUTEID_ONOFF_ONOFF,
+                            u8Mode, 0, eOn_OffResend, au16Args);
+    }
+
+    return eStatus;
+}
+
 teZcbStatus eLevelControlMove(uint8_t u8AddrMode, 
                               uint16_t u16Addr, 
                               uint8_t u8SrcEp, 
@@ -307,10 +670,10 @@ teZcbStatus eLevelControlMove(uint8_t u8AddrMode,
 }
 
 
-teZcbStatus eLevelControlMoveToLevel(uint16_t u16Addr, 
-                                     //uint8_t u8OnOff,
-                                     uint8_t u8Level,
-                                     uint16_t u16Time)
+static teZcbStatus eLevelControlMoveToLevelSend(uint8_t u8AddrMode,
+                                                uint16_t u16Addr,
+                                                uint8_t u8Level,
+                                                uint16_t u16Time)
 {
     uint8_t             u8SequenceNo;
     teSL_Status         eStatus;
@@ -327,7 +690,7 @@ teZcbStatus eLevelControlMoveToLevel(uint16_t u16Addr,
 
  //   LOG(ZCB, INFO, "LevelControl (Move to Level=%d)\r\n", u8Level);
 
-    sLevelControlMoveToLevelMessage.u8TargetAddressMode   = 2;
+    sLevelControlMoveToLevelMessage.u8TargetAddressMode   = u8AddrMode;
     sLevelControlMoveToLevelMessage.u16TargetAddress      = pri_ntohs(u16Addr);
     sLevelControlMoveToLevelMessage.u8SourceEndpoint      = 1;
     sLevelControlMoveToLevelMessage.u8DestinationEndpoint = 1;
@@ -335,11 +698,16 @@ teZcbStatus eLevelControlMoveToLevel(uint16_t u16Addr,
     sLevelControlMoveToLevelMessage.u8MoveToLevel         = u8Level;
     sLevelControlMoveToLevelMessage.u16TransitionTime     = pri_ntohs(u16Time);
     
+    if (eZCB_NodeFlowAcquire(u16Addr) != E_ZCB_OK) {
+        return E_ZCB_REQUEST_NOT_ACTIONED;
+    }
+
     eStatus = eSL_SendMessage(E_SL_MSG_MOVE_TO_LEVEL_ONOFF, sizeof(sLevelControlMoveToLevelMessage),
         &sLevelControlMoveToLevelMessage, &u8SequenceNo);
 
     if (eStatus != E_SL_OK)
     {
+        vZCB_NodeFlowRelease(u16Addr);
 //        LOG(ZCB, ERR, "Sending of Command '%s' failed (0x%02x)\r\n",
   //          "LevelControlMoveToLevel",
     //        eStatus);
@@ -350,6 +718,35 @@ teZcbStatus eLevelControlMoveToLevel(uint16_t u16Addr,
 
 }
 
+static teZcbStatus eLevelControlMoveToLevelResend(uint8_t u8AddrMode, uint16_t u16Addr, const uint16_t au16Args[3])
+{
+    return eLevelControlMoveToLevelSend(u8AddrMode, u16Addr, (uint8_t)au16Args[0], au16Args[1]);
+}
+
+teZcbStatus eLevelControlMoveToLevel(uint16_t u16Addr, 
+                                     //uint8_t u8OnOff,
+                                     uint8_t u8Level,
+                                     uint16_t u16Time)
+{
+    teZcbStatus         eStatus;
+    uint16_t            au16Args[3] = {u8Level, u16Time, 0};
+    uint8_t             u8AddrMode;
+
+    u8AddrMode = u8ZCB_AckPolicySelectAddrMode(u16Addr, ZB_ENDPOINT_DST_DEFAULT,
+                                               E_ZB_CLUSTERID_LEVEL_CONTROL, E_ZB_ATTRIBUTEID_LEVEL_CURRENTLEVEL,
+                                               u8Level);
+
+    eStatus = eLevelControlMoveToLevelSend(u8AddrMode, u16Addr, u8Level, u16Time);
+
+    if ((eStatus == E_ZCB_OK) && (u8AddrMode == E_ZB_ADDRESS_MODE_SHORT_NO_ACK)) {
+        vZCB_AckPolicyTrack(u16Addr, ZB_ENDPOINT_DST_DEFAULT,
+                            E_ZB_CLUSTERID_LEVEL_CONTROL, E_ZB_ATTRIBUTEID_LEVEL_CURRENTLEVEL,
+                            u8Level, u16Time, eLevelControlMoveToLevelResend, au16Args);
+    }
+
+    return eStatus;
+}
+
 
 
 teZcbStatus eLevelControlMoveStep(uint8_t u8AddrMode, 
@@ -430,11 +827,16 @@ teZcbStatus eColorControlMoveToColor(uint16_t u16Addr,
     sColorControlMoveToColorMessage.u16MoveToColorY       = pri_ntohs(u16ColorY);
     sColorControlMoveToColorMessage.u16TransitionTime     = pri_ntohs(u16Time);
     
+    if (eZCB_NodeFlowAcquire(u16Addr) != E_ZCB_OK) {
+        return E_ZCB_REQUEST_NOT_ACTIONED;
+    }
+
     eStatus = eSL_SendMessage(E_SL_MSG_MOVE_TO_COLOUR, sizeof(sColorControlMoveToColorMessage),
         &sColorControlMoveToColorMessage, &u8SequenceNo);
 
     if (eStatus != E_SL_OK)
     {
+        vZCB_NodeFlowRelease(u16Addr);
   //      LOG(ZCB, ERR, "Sending of Command '%s' failed (0x%02x)\r\n",
     //        "ColorControlMoveToColor",
     //        eStatus);
@@ -444,9 +846,10 @@ teZcbStatus eColorControlMoveToColor(uint16_t u16Addr,
 }
 
 
-teZcbStatus eColorControlMoveToTemp(uint16_t u16Addr, 
-                                    uint16_t u16ColorTemp,
-                                    uint16_t u16Time)
+static teZcbStatus eColorControlMoveToTempSend(uint8_t u8AddrMode,
+                                               uint16_t u16Addr, 
+                                               uint16_t u16ColorTemp,
+                                               uint16_t u16Time)
 {
 		uint8_t 			u8SequenceNo;
 		teSL_Status 		eStatus;
@@ -462,18 +865,23 @@ teZcbStatus eColorControlMoveToTemp(uint16_t u16Addr,
 	
 	 //   LOG(ZCB, INFO, "ColorControl (Move to ColorTemp=%d)\r\n", u8ColorTemp);
 	
-		sColorControlMoveToTempMessage.u8TargetAddressMode	 = 2;
+		sColorControlMoveToTempMessage.u8TargetAddressMode	 = u8AddrMode;
 		sColorControlMoveToTempMessage.u16TargetAddress 	 = pri_ntohs(u16Addr);
 		sColorControlMoveToTempMessage.u8SourceEndpoint 	 = 1;
 		sColorControlMoveToTempMessage.u8DestinationEndpoint = 1;
 		sColorControlMoveToTempMessage.u16MoveToColorTemp	 = pri_ntohs(u16ColorTemp); //must revert 2 bytes !!!
 		sColorControlMoveToTempMessage.u16TransitionTime	 = pri_ntohs(u16Time);
 		
+		if (eZCB_NodeFlowAcquire(u16Addr) != E_ZCB_OK) {
+			return E_ZCB_REQUEST_NOT_ACTIONED;
+		}
+
 		eStatus = eSL_SendMessage(E_SL_MSG_MOVE_TO_COLOUR_TEMPERATURE, sizeof(sColorControlMoveToTempMessage),
 			&sColorControlMoveToTempMessage, &u8SequenceNo);
 	
 		if (eStatus != E_SL_OK)
 		{
+			vZCB_NodeFlowRelease(u16Addr);
 	  //	  LOG(ZCB, ERR, "Sending of Command '%s' failed (0x%02x)\r\n",
 	  //		  "ColorControlMoveToTemp",
 	  //		  eStatus);
@@ -483,6 +891,34 @@ teZcbStatus eColorControlMoveToTemp(uint16_t u16Addr,
 		return E_ZCB_OK;
 }
 
+static teZcbStatus eColorControlMoveToTempResend(uint8_t u8AddrMode, uint16_t u16Addr, const uint16_t au16Args[3])
+{
+    return eColorControlMoveToTempSend(u8AddrMode, u16Addr, au16Args[0], au16Args[1]);
+}
+
+teZcbStatus eColorControlMoveToTemp(uint16_t u16Addr, 
+                                    uint16_t u16ColorTemp,
+                                    uint16_t u16Time)
+{
+    teZcbStatus         eStatus;
+    uint16_t            au16Args[3] = {u16ColorTemp, u16Time, 0};
+    uint8_t             u8AddrMode;
+
+    u8AddrMode = u8ZCB_AckPolicySelectAddrMode(u16Addr, ZB_ENDPOINT_DST_DEFAULT,
+                                               E_ZB_CLUSTERID_COLOR_CONTROL, E_ZB_ATTRIBUTEID_COLOUR_COLOURTEMPERATURE,
+                                               u16ColorTemp);
+
+    eStatus = eColorControlMoveToTempSend(u8AddrMode, u16Addr, u16ColorTemp, u16Time);
+
+    if ((eStatus == E_ZCB_OK) && (u8AddrMode == E_ZB_ADDRESS_MODE_SHORT_NO_ACK)) {
+        vZCB_AckPolicyTrack(u16Addr, ZB_ENDPOINT_DST_DEFAULT,
+                            E_ZB_CLUSTERID_COLOR_CONTROL, E_ZB_ATTRIBUTEID_COLOUR_COLOURTEMPERATURE,
+                            u16ColorTemp, u16Time, eColorControlMoveToTempResend, au16Args);
+    }
+
+    return eStatus;
+}
+
 teZcbStatus eColorControlMoveToHue(uint16_t u16Addr, 
                                    uint8_t u8Hue,
                                    uint8_t u8Dir,
@@ -511,11 +947,16 @@ teZcbStatus eColorControlMoveToHue(uint16_t u16Addr,
     sColorControlMoveToHueMessage.u8Direction           = u8Dir;
     sColorControlMoveToHueMessage.u16TransitionTime     = pri_ntohs(u16Time);
     
+    if (eZCB_NodeFlowAcquire(u16Addr) != E_ZCB_OK) {
+        return E_ZCB_REQUEST_NOT_ACTIONED;
+    }
+
     eStatus = eSL_SendMessage(E_SL_MSG_MOVE_TO_HUE, sizeof(sColorControlMoveToHueMessage),
         &sColorControlMoveToHueMessage, &u8SequenceNo);
 
     if (eStatus != E_SL_OK)
     {
+        vZCB_NodeFlowRelease(u16Addr);
   //      LOG(ZCB, ERR, "Sending of Command '%s' failed (0x%02x)\r\n",
    //         "ColorControlMoveToHue",
    //         eStatus);
@@ -549,11 +990,16 @@ teZcbStatus eColorControlMoveToSaturation(uint16_t u16Addr,
 	   sColorControlMoveToSatMessage.u8MoveToSat		   = u8Sat;
 	   sColorControlMoveToSatMessage.u16TransitionTime	   = pri_ntohs(u16Time);
 	   
+	   if (eZCB_NodeFlowAcquire(u16Addr) != E_ZCB_OK) {
+		   return E_ZCB_REQUEST_NOT_ACTIONED;
+	   }
+
 	   eStatus = eSL_SendMessage(E_SL_MSG_MOVE_TO_SATURATION, sizeof(sColorControlMoveToSatMessage),
 		   &sColorControlMoveToSatMessage, &u8SequenceNo);
 	
 	   if (eStatus != E_SL_OK)
 	   {
+		   vZCB_NodeFlowRelease(u16Addr);
 	 // 	 LOG(ZCB, ERR, "Sending of Command '%s' failed (0x%02x)\r\n",
 	  //		 "ColorControlMoveToHue",
 	  //		 eStatus);
@@ -562,70 +1008,217 @@ teZcbStatus eColorControlMoveToSaturation(uint16_t u16Addr,
 	   return E_ZCB_OK;
 }
 
-teZcbStatus eIASZoneEnrollResponse(uint8_t u8AddrMode, 
-                                   uint16_t u16Addr, 
-                                   uint8_t u8SrcEp, 
-                                   uint8_t u8DstEp, 
-                                   uint8_t u8EnrollRspCode,
-                                   uint8_t u8ZoneId)
+teZcbStatus eGroupAdd(uint8_t u8AddrMode,
+                      uint16_t u16Addr,
+                      uint16_t u16GroupId)
 {
     uint8_t             u8SequenceNo;
     teSL_Status         eStatus;
+    bool                bUnicast = (u8AddrMode == E_ZB_ADDRESS_MODE_SHORT);
 
     struct {
         uint8_t     u8TargetAddressMode;
         uint16_t    u16TargetAddress;
         uint8_t     u8SourceEndpoint;
         uint8_t     u8DestinationEndpoint;
-        uint8_t     u8EnrollRspCode;
-        uint16_t    u8IASZoneId;
-    } PACKED sIASZoneEnrollRspMessage;
+        uint16_t    u16GroupId;
+    } PACKED sAddGroupMessage;
 
- //   LOG(ZCB, INFO, "IAS Zone Enroll Response (RspCode = %d, ZoneId=%d)\r\n", u8EnrollRspCode, u8ZoneId);
+    sAddGroupMessage.u8TargetAddressMode   = u8AddrMode;
+    sAddGroupMessage.u16TargetAddress      = pri_ntohs(u16Addr);
+    sAddGroupMessage.u8SourceEndpoint      = ZB_ENDPOINT_SRC_DEFAULT;
+    sAddGroupMessage.u8DestinationEndpoint = ZB_ENDPOINT_GROUP;
+    sAddGroupMessage.u16GroupId            = pri_ntohs(u16GroupId);
 
-    sIASZoneEnrollRspMessage.u8TargetAddressMode   = u8AddrMode;
-    sIASZoneEnrollRspMessage.u16TargetAddress      = pri_ntohs(u16Addr);
-    sIASZoneEnrollRspMessage.u8SourceEndpoint      = u8SrcEp;
-    sIASZoneEnrollRspMessage.u8DestinationEndpoint = u8DstEp;
-    sIASZoneEnrollRspMessage.u8EnrollRspCode       = u8EnrollRspCode;
-    sIASZoneEnrollRspMessage.u8IASZoneId           = u8ZoneId;
-    
-    eStatus = eSL_SendMessage(E_SL_MSG_SEND_IAS_ZONE_ENROLL_RSP, sizeof(sIASZoneEnrollRspMessage),
-        &sIASZoneEnrollRspMessage, &u8SequenceNo);
+    if (bUnicast && (eZCB_NodeFlowAcquire(u16Addr) != E_ZCB_OK)) {
+        return E_ZCB_REQUEST_NOT_ACTIONED;
+    }
+
+    eStatus = eSL_SendMessage(E_SL_MSG_ADD_GROUP_REQUEST, sizeof(sAddGroupMessage),
+        &sAddGroupMessage, &u8SequenceNo);
 
     if (eStatus != E_SL_OK)
     {
-  //      LOG(ZCB, ERR, "Sending of Command '%s' failed (0x%02x)\r\n",
-   //         "IASZoneEnrollResponse",
-    //        eStatus);
+        if (bUnicast) {
+            vZCB_NodeFlowRelease(u16Addr);
+        }
+        PRINTF("\n ### Sending of Add Group 0x%04x failed (0x%02x)\n", u16GroupId, eStatus);
         return E_ZCB_COMMS_FAILED;
     }
-
-    return E_ZCB_OK;    
+    return E_ZCB_OK;
 }
 
-// ------------------------------------------------------------------
-// Handlers
-// ------------------------------------------------------------------
+teZcbStatus eGroupRemove(uint8_t u8AddrMode,
+                         uint16_t u16Addr,
+                         uint16_t u16GroupId)
+{
+    uint8_t             u8SequenceNo;
+    teSL_Status         eStatus;
+    bool                bUnicast = (u8AddrMode == E_ZB_ADDRESS_MODE_SHORT);
 
-static void ZCB_HandleVersionResponse(void *pvUser, uint16_t u16Length, void *pvMessage) 
-{   
-  //  LOG(ZCB, INFO, "ZCB_HandleVersionResponse\r\n" );
+    struct {
+        uint8_t     u8TargetAddressMode;
+        uint16_t    u16TargetAddress;
+        uint8_t     u8SourceEndpoint;
+        uint8_t     u8DestinationEndpoint;
+        uint16_t    u16GroupId;
+    } PACKED sRemoveGroupMessage;
 
-    struct _tsVersion {
-        uint32_t    u32Version;
-    } PACKED *psVersion = (struct _tsVersion *)pvMessage;
-    
-    psVersion->u32Version = psVersion->u32Version;
+    sRemoveGroupMessage.u8TargetAddressMode   = u8AddrMode;
+    sRemoveGroupMessage.u16TargetAddress      = pri_ntohs(u16Addr);
+    sRemoveGroupMessage.u8SourceEndpoint      = ZB_ENDPOINT_SRC_DEFAULT;
+    sRemoveGroupMessage.u8DestinationEndpoint = ZB_ENDPOINT_GROUP;
+    sRemoveGroupMessage.u16GroupId            = pri_ntohs(u16GroupId);
 
- //   LOG(ZCB, INFO, "Coordinator Version 0x%08X\r\n", psVersion->u32Version);
+    if (bUnicast && (eZCB_NodeFlowAcquire(u16Addr) != E_ZCB_OK)) {
+        return E_ZCB_REQUEST_NOT_ACTIONED;
+    }
+
+    eStatus = eSL_SendMessage(E_SL_MSG_REMOVE_GROUP_REQUEST, sizeof(sRemoveGroupMessage),
+        &sRemoveGroupMessage, &u8SequenceNo);
+
+    if (eStatus != E_SL_OK)
+    {
+        if (bUnicast) {
+            vZCB_NodeFlowRelease(u16Addr);
+        }
+        PRINTF("\n ### Sending of Remove Group 0x%04x failed (0x%02x)\n", u16GroupId, eStatus);
+        return E_ZCB_COMMS_FAILED;
+    }
+    return E_ZCB_OK;
 }
 
-static void ZCB_HandleNodeClusterList(void *pvUser, uint16_t u16Length, void *pvMessage) 
+/* Store, Recall and Remove Scene share one layout, Remove All Scenes has no scene ID */
+static teZcbStatus eSceneSend(uint16_t u16MsgType,
+                              uint8_t u8AddrMode,
+                              uint16_t u16Addr,
+                              uint16_t u16GroupId,
+                              uint8_t u8SceneId,
+                              bool bWithScene)
 {
-  //  LOG(ZCB, INFO, "ZCB_HandleNodeClusterList\r\n" );
+    uint8_t             u8SequenceNo;
+    teSL_Status         eStatus;
+    bool                bUnicast = (u8AddrMode == E_ZB_ADDRESS_MODE_SHORT);
 
-    struct _tsClusterList {
+    struct {
+        uint8_t     u8TargetAddressMode;
+        uint16_t    u16TargetAddress;
+        uint8_t     u8SourceEndpoint;
+        uint8_t     u8DestinationEndpoint;
+        uint16_t    u16GroupId;
+        uint8_t     u8SceneId;
+    } PACKED sSceneMessage;
+
+    sSceneMessage.u8TargetAddressMode   = u8AddrMode;
+    sSceneMessage.u16TargetAddress      = pri_ntohs(u16Addr);
+    sSceneMessage.u8SourceEndpoint      = ZB_ENDPOINT_SRC_DEFAULT;
+    sSceneMessage.u8DestinationEndpoint = ZB_ENDPOINT_SCENE;
+    sSceneMessage.u16GroupId            = pri_ntohs(u16GroupId);
+    sSceneMessage.u8SceneId             = u8SceneId;
+
+    if (bUnicast && (eZCB_NodeFlowAcquire(u16Addr) != E_ZCB_OK)) {
+        return E_ZCB_REQUEST_NOT_ACTIONED;
+    }
+
+    eStatus = eSL_SendMessage(u16MsgType,
+        bWithScene ? sizeof(sSceneMessage) : (uint16_t)(sizeof(sSceneMessage) - sizeof(uint8_t)),
+        &sSceneMessage, &u8SequenceNo);
+
+    if (eStatus != E_SL_OK)
+    {
+        if (bUnicast) {
+            vZCB_NodeFlowRelease(u16Addr);
+        }
+        PRINTF("\n ### Sending of Scene command 0x%04x failed (0x%02x)\n", u16MsgType, eStatus);
+        return E_ZCB_COMMS_FAILED;
+    }
+    return E_ZCB_OK;
+}
+
+teZcbStatus eSceneStore(uint8_t u8AddrMode, uint16_t u16Addr, uint16_t u16GroupId, uint8_t u8SceneId)
+{
+    return eSceneSend(E_SL_MSG_STORE_SCENE, u8AddrMode, u16Addr, u16GroupId, u8SceneId, true);
+}
+
+teZcbStatus eSceneRecall(uint8_t u8AddrMode, uint16_t u16Addr, uint16_t u16GroupId, uint8_t u8SceneId)
+{
+    return eSceneSend(E_SL_MSG_RECALL_SCENE, u8AddrMode, u16Addr, u16GroupId, u8SceneId, true);
+}
+
+teZcbStatus eSceneRemove(uint8_t u8AddrMode, uint16_t u16Addr, uint16_t u16GroupId, uint8_t u8SceneId)
+{
+    return eSceneSend(E_SL_MSG_REMOVE_SCENE, u8AddrMode, u16Addr, u16GroupId, u8SceneId, true);
+}
+
+teZcbStatus eSceneRemoveAll(uint8_t u8AddrMode, uint16_t u16Addr, uint16_t u16GroupId)
+{
+    return eSceneSend(E_SL_MSG_REMOVE_ALL_SCENES, u8AddrMode, u16Addr, u16GroupId, 0, false);
+}
+
+teZcbStatus eIASZoneEnrollResponse(uint8_t u8AddrMode, 
+                                   uint16_t u16Addr, 
+                                   uint8_t u8SrcEp, 
+                                   uint8_t u8DstEp, 
+                                   uint8_t u8EnrollRspCode,
+                                   uint8_t u8ZoneId)
+{
+    uint8_t             u8SequenceNo;
+    teSL_Status         eStatus;
+
+    struct {
+        uint8_t     u8TargetAddressMode;
+        uint16_t    u16TargetAddress;
+        uint8_t     u8SourceEndpoint;
+        uint8_t     u8DestinationEndpoint;
+        uint8_t     u8EnrollRspCode;
+        uint16_t    u8IASZoneId;
+    } PACKED sIASZoneEnrollRspMessage;
+
+ //   LOG(ZCB, INFO, "IAS Zone Enroll Response (RspCode = %d, ZoneId=%d)\r\n", u8EnrollRspCode, u8ZoneId);
+
+    sIASZoneEnrollRspMessage.u8TargetAddressMode   = u8AddrMode;
+    sIASZoneEnrollRspMessage.u16TargetAddress      = pri_ntohs(u16Addr);
+    sIASZoneEnrollRspMessage.u8SourceEndpoint      = u8SrcEp;
+    sIASZoneEnrollRspMessage.u8DestinationEndpoint = u8DstEp;
+    sIASZoneEnrollRspMessage.u8EnrollRspCode       = u8EnrollRspCode;
+    sIASZoneEnrollRspMessage.u8IASZoneId           = u8ZoneId;
+    
+    eStatus = eSL_SendMessage(E_SL_MSG_SEND_IAS_ZONE_ENROLL_RSP, sizeof(sIASZoneEnrollRspMessage),
+        &sIASZoneEnrollRspMessage, &u8SequenceNo);
+
+    if (eStatus != E_SL_OK)
+    {
+  //      LOG(ZCB, ERR, "Sending of Command '%s' failed (0x%02x)\r\n",
+   //         "IASZoneEnrollResponse",
+    //        eStatus);
+        return E_ZCB_COMMS_FAILED;
+    }
+
+    return E_ZCB_OK;    
+}
+
+// ------------------------------------------------------------------
+// Handlers
+// ------------------------------------------------------------------
+
+static void ZCB_HandleVersionResponse(void *pvUser, uint16_t u16Length, void *pvMessage) 
+{   
+  //  LOG(ZCB, INFO, "ZCB_HandleVersionResponse\r\n" );
+
+    struct _tsVersion {
+        uint32_t    u32Version;
+    } PACKED *psVersion = (struct _tsVersion *)pvMessage;
+    
+    psVersion->u32Version = psVersion->u32Version;
+
+ //   LOG(ZCB, INFO, "Coordinator Version 0x%08X\r\n", psVersion->u32Version);
+}
+
+static void ZCB_HandleNodeClusterList(void *pvUser, uint16_t u16Length, void *pvMessage) 
+{
+  //  LOG(ZCB, INFO, "ZCB_HandleNodeClusterList\r\n" );
+
+    struct _tsClusterList {
         uint8_t     u8Endpoint;
         uint16_t    u16ProfileID;
         uint16_t    au16ClusterList[255];
@@ -711,34 +1304,37 @@ static void ZCB_HandleNetworkJoined(void *pvUser, uint16_t u16Length, void *pvMe
     }
 }
 
+/* The joined node table as the bridge has it: loaded from the journal once
+ * at start, the flash is not read again */
 bool EnumJoinedNodes(void)
 {
-	uint8_t j;
-	int ret=0;
+	uint8_t j,Nodes;
 
-	ret = ramStorageReadFromFlash(myDB_filename,(uint8_t *)&savedNodes,sizeof(savedNodes));
-	if (ret)
+	Nodes = u8ZCB_JoinedNodeCount();
+	PRINTF("\n ### Joined Nodes=%d",Nodes);
+	for (j=0;j<DEV_NUM;j++)
 	{
-		PRINTF("\n ### ramStorageReadFromFlash=%d,Joined Nodes=%d",ret,savedNodes.totalNodes);
-		for (j=0;j<savedNodes.totalNodes;j++)
-		{
-			JoinedNodes[j].ep = savedNodes.joinedNodes[j].ep;
-			JoinedNodes[j].mac = savedNodes.joinedNodes[j].mac;
-			JoinedNodes[j].type = savedNodes.joinedNodes[j].type;
-			JoinedNodes[j].shortaddr = savedNodes.joinedNodes[j].shortaddr;
-			PRINTF("\n ### Idx=%d,Type=%d,short=0x%x,mac=0x%llx,ep=%d",j,savedNodes.joinedNodes[j].type,savedNodes.joinedNodes[j].shortaddr,savedNodes.joinedNodes[j].mac,savedNodes.joinedNodes[j].ep);
-		}
-		return 1;
+		if (JoinedNodes[j].type)
+			PRINTF("\n ### Idx=%d,Type=%d,short=0x%x,mac=0x%llx,ep=%d",j,JoinedNodes[j].type,JoinedNodes[j].shortaddr,JoinedNodes[j].mac,JoinedNodes[j].ep);
 	}
-	else
-		return 0;
+	return (Nodes != 0);
 }
 
 void eZCB_SendMsg(int MsgType, newdb_zcb_t *Zcb, void* data)
 {
+    TickType_t xStart = xTaskGetTickCount();
+
 	if (xSemaphoreTake(ZcbMsg.bridge_mutex, portMAX_DELAY) != pdTRUE)
 		PRINTF("\n *** Failed to take semaphore *** ");
 
+    /* Interviews overlap: give the bridge the time to take the message before */
+    while ((ZcbMsg.msg_type != BRIDGE_UNKNOW)
+           && ((xTaskGetTickCount() - xStart) < pdMS_TO_TICKS(ZCB_BRIDGE_MSG_WAIT_MS))) {
+        xSemaphoreGive(ZcbMsg.bridge_mutex);
+        vTaskDelay(pdMS_TO_TICKS(10));
+        xSemaphoreTake(ZcbMsg.bridge_mutex, portMAX_DELAY);
+    }
+
  //   ZcbMsg.HandleMask = false;
 
     if( Zcb != NULL ) {
@@ -753,167 +1349,258 @@ void eZCB_SendMsg(int MsgType, newdb_zcb_t *Zcb, void* data)
 	return ;
 }
 
+teZcbStatus eZCB_PostMsg(int MsgType, newdb_zcb_t *Zcb, void* data)
+{
+    teZcbStatus eStatus = E_ZCB_DEFERRED;
+
+    if ((Zcb == NULL) || (ZcbMsg.bridge_mutex == NULL)) {
+        return E_ZCB_ERROR;
+    }
+
+	if (xSemaphoreTake(ZcbMsg.bridge_mutex, portMAX_DELAY) != pdTRUE)
+		PRINTF("\n *** Failed to take semaphore *** ");
+
+    /* Neither waited for nor overwritten, the caller tries again */
+    if (ZcbMsg.msg_type == BRIDGE_UNKNOW) {
+        ZcbMsg.zcb = *Zcb;
+        ZcbMsg.msg_type = MsgType;
+        ZcbMsg.msg_data = data;
+        eStatus = E_ZCB_OK;
+    }
+
+	xSemaphoreGive(ZcbMsg.bridge_mutex);
+    return eStatus;
+}
+
+void eZCB_SendAttributeBatch(newdb_zcb_t *Zcb, const ZcbAttributeBatch_t *psBatch)
+{
+    ZcbAttributeBatch_t *psPending = &ZcbMsg.attr_batch;
+    TickType_t xStart = xTaskGetTickCount();
+    uint8_t i, j;
+
+    if ((Zcb == NULL) || (psBatch == NULL) || (psBatch->u8Count == 0)) {
+        return;
+    }
+
+	if (xSemaphoreTake(ZcbMsg.bridge_mutex, portMAX_DELAY) != pdTRUE)
+		PRINTF("\n *** Failed to take semaphore *** ");
+
+    /* Merged into a batch for the same node not yet taken by the bridge,
+     * any other message is given the time to be taken first */
+    while ((ZcbMsg.msg_type != BRIDGE_UNKNOW)
+           && ((ZcbMsg.msg_type != BRIDGE_WRITE_ATTRIBUTES)
+               || (ZcbMsg.zcb.saddr != Zcb->saddr) || (ZcbMsg.zcb.DynamicEP != Zcb->DynamicEP))
+           && ((xTaskGetTickCount() - xStart) < pdMS_TO_TICKS(ZCB_BRIDGE_MSG_WAIT_MS))) {
+        xSemaphoreGive(ZcbMsg.bridge_mutex);
+        vTaskDelay(pdMS_TO_TICKS(10));
+        xSemaphoreTake(ZcbMsg.bridge_mutex, portMAX_DELAY);
+    }
+    if ((ZcbMsg.msg_type != BRIDGE_WRITE_ATTRIBUTES)
+        || (ZcbMsg.zcb.saddr != Zcb->saddr)
+        || (ZcbMsg.zcb.DynamicEP != Zcb->DynamicEP)) {
+        ZcbMsg.zcb = *Zcb;
+        ZcbMsg.msg_type = BRIDGE_WRITE_ATTRIBUTES;
+        psPending->u8Count = 0;
+    }
+
+    for (i = 0; i < psBatch->u8Count; i++) {
+        for (j = 0; j < psPending->u8Count; j++) {
+            if ((psPending->asAttributes[j].u32ClusterID == psBatch->asAttributes[i].u32ClusterID)
+                && (psPending->asAttributes[j].u32AttributeID == psBatch->asAttributes[i].u32AttributeID)) {
+                break;
+            }
+        }
+        if (j < ZCB_ATTRIBUTE_BATCH_MAX) {
+            psPending->asAttributes[j] = psBatch->asAttributes[i];
+            if (j == psPending->u8Count) {
+                psPending->u8Count++;
+            }
+        }
+    }
+
+	xSemaphoreGive(ZcbMsg.bridge_mutex);
+}
+
+teZcbStatus eZCB_SendAttributeWave(ZcbAttributeWave_t *psWave)
+{
+    teZcbStatus eStatus = E_ZCB_DEFERRED;
+
+    if ((psWave == NULL) || (ZcbMsg.bridge_mutex == NULL)) {
+        return E_ZCB_ERROR;
+    }
+
+	if (xSemaphoreTake(ZcbMsg.bridge_mutex, portMAX_DELAY) != pdTRUE)
+		PRINTF("\n *** Failed to take semaphore *** ");
+
+    /* The single message slot is not overwritten, the caller tries again */
+    if (ZcbMsg.msg_type == BRIDGE_UNKNOW) {
+        ZcbMsg.msg_type = BRIDGE_WRITE_ATTRIBUTE_WAVE;
+        ZcbMsg.msg_data = psWave;
+        eStatus = E_ZCB_OK;
+    }
+
+	xSemaphoreGive(ZcbMsg.bridge_mutex);
+    return eStatus;
+}
+
+bool bZCB_AttributeWavePending(const ZcbAttributeWave_t *psWave)
+{
+    bool bPending;
+
+    if (ZcbMsg.bridge_mutex == NULL) {
+        return false;
+    }
+
+	if (xSemaphoreTake(ZcbMsg.bridge_mutex, portMAX_DELAY) != pdTRUE)
+		PRINTF("\n *** Failed to take semaphore *** ");
+    bPending = (ZcbMsg.msg_type == BRIDGE_WRITE_ATTRIBUTE_WAVE) && (ZcbMsg.msg_data == psWave);
+	xSemaphoreGive(ZcbMsg.bridge_mutex);
+
+    return bPending;
+}
+
+/* Every node of the table written to the journal again */
 void SaveJoinedNodes(void)
 {
-	uint8_t i,j,NewNodeCnt=0;
-	uint8_t DupNodeCnt=0;
-	int ret=0;
-    uint8_t NewNode[DEV_NUM]={0,0,0,0,0};
-	uint8_t DupNode[DEV_NUM]={0,0,0,0,0};
-	bool EmptyFlash=0;
-	
-	ret = ramStorageReadFromFlash(myDB_filename,(uint8_t *)&savedNodes,sizeof(savedNodes));
-	if (ret)
-	{
-		PRINTF("\n ### ramStorageReadFromFlash=%d,Joined Nodes=%d",ret,savedNodes.totalNodes);
-		for (j=0;j<savedNodes.totalNodes;j++)
-			PRINTF("\n ### Idx=%d,Type=%d,short=0x%x,mac=0x%llx,ep=%d",j,savedNodes.joinedNodes[j].type,savedNodes.joinedNodes[j].shortaddr,savedNodes.joinedNodes[j].mac,savedNodes.joinedNodes[j].ep);
-	}
-	
-	if (savedNodes.totalNodes)
-	{
-	  for (i=0;i<DEV_NUM;i++)
-	  {
-	   if (JoinedNodes[i].type)
-	   {
-	     for (j=0;j<savedNodes.totalNodes;j++)
-	  	 if ((savedNodes.joinedNodes[j].shortaddr==JoinedNodes[i].shortaddr)&&(savedNodes.joinedNodes[j].mac==JoinedNodes[i].mac)&&(savedNodes.joinedNodes[j].ep==JoinedNodes[i].ep)&&(savedNodes.joinedNodes[j].type==JoinedNodes[i].type))
-	  	 {
-	  		DupNode[DupNodeCnt++]=i;
-			PRINTF("\n ### Found Dup Node = %d(%d)\n",DupNodeCnt,i);
-	  	 }
-		 else
-		 {	
-		    NewNode[NewNodeCnt++]=i;
-			PRINTF("\n ### Found New Node = %d(%d)\n",NewNodeCnt,i);
-		 }
-	   }
-	  }
-	}
-	else
-	{
-		EmptyFlash=1;
-	  for (i=0;i<DEV_NUM;i++)
-		if (JoinedNodes[i].type)
-		{
-	  	   savedNodes.joinedNodes[savedNodes.totalNodes].type = JoinedNodes[i].type;	
-		   savedNodes.joinedNodes[savedNodes.totalNodes].shortaddr = JoinedNodes[i].shortaddr;
-		   savedNodes.joinedNodes[savedNodes.totalNodes].mac = JoinedNodes[i].mac;
-		   savedNodes.joinedNodes[savedNodes.totalNodes].ep = JoinedNodes[i].ep;
-		   savedNodes.totalNodes++;		
-		}
-	}
+	uint8_t i;
 
-   if (!EmptyFlash)
-   {
-    for (i=0;i<DEV_NUM;i++)
-	 for (j=0;j<NewNodeCnt;j++)
-	  if ((JoinedNodes[i].type)&&(NewNode[j]==i))
-	  {
-	  	   savedNodes.joinedNodes[savedNodes.totalNodes].type = JoinedNodes[i].type;	
-		   savedNodes.joinedNodes[savedNodes.totalNodes].shortaddr = JoinedNodes[i].shortaddr;
-		   savedNodes.joinedNodes[savedNodes.totalNodes].mac = JoinedNodes[i].mac;
-		   savedNodes.joinedNodes[savedNodes.totalNodes].ep = JoinedNodes[i].ep;
-		   savedNodes.totalNodes++;
-	  } 
-   	}  
-	  
-	if (savedNodes.totalNodes)
+	for (i=0;i<DEV_NUM;i++)
 	{
-	  ret = ramStorageSavetoFlash(myDB_filename,(uint8_t *)&savedNodes,sizeof(savedNodes));
-	  if (ret)
-		  PRINTF("\n ### ramStorageSavetoFlash=%d,Joined Nodes=%d\n",ret,savedNodes.totalNodes);
-	  
+		if (JoinedNodes[i].type)
+			vZCB_NodeStoreMark(i);
 	}
+	vZCB_NodeStoreFlush();
 }
 
 void RestoreJoinedNodes(void)
 {
 	uint8_t i;
-	int ret=0;
 
-	ret = ramStorageReadFromFlash(myDB_filename,(uint8_t *)&savedNodes,sizeof(savedNodes));
-	if (ret)
+	(void)EnumJoinedNodes();
+	for (i=0;i<DEV_NUM;i++)
 	{
-		PRINTF("\n ### ramStorageReadFromFlash=%d,Joined Nodes=%d",ret,savedNodes.totalNodes);
-		for (i=0;i<savedNodes.totalNodes;i++)
+		/* A node given no endpoint yet has nothing to restore */
+		if ((JoinedNodes[i].type)&&(JoinedNodes[i].ep))
 		{
-			if (savedNodes.joinedNodes[i].type)
-			{
-			  JoinedNodes[i].ep = savedNodes.joinedNodes[i].ep;
-			  JoinedNodes[i].mac = savedNodes.joinedNodes[i].mac; 
-			  JoinedNodes[i].type = savedNodes.joinedNodes[i].type;
-			  JoinedNodes[i].shortaddr = savedNodes.joinedNodes[i].shortaddr;
-			  sZcb.type=JoinedNodes[i].type;
-			  sZcb.DynamicEP=JoinedNodes[i].ep;
-			  eZCB_SendMsg(BRIDGE_RESTORE_JOINED_NODE,&sZcb,NULL); 
-			  PRINTF("\n ### Idx=%d,Type=%d,short=0x%x,mac=0x%llx,ep=%d",i,savedNodes.joinedNodes[i].type,savedNodes.joinedNodes[i].shortaddr,savedNodes.joinedNodes[i].mac,savedNodes.joinedNodes[i].ep);
-			  vTaskDelay(500);			  
-			}
+		  sZcb.type=JoinedNodes[i].type;
+		  sZcb.DynamicEP=JoinedNodes[i].ep;
+		  eZCB_SendMsg(BRIDGE_RESTORE_JOINED_NODE,&sZcb,NULL); 
+		  PRINTF("\n ### Idx=%d,Type=%d,short=0x%x,mac=0x%llx,ep=%d",i,JoinedNodes[i].type,JoinedNodes[i].shortaddr,JoinedNodes[i].mac,JoinedNodes[i].ep);
+		  vTaskDelay(500);			  
 		}
-	}	
-	
+	}
 }
 
+/* The node is written to the journal with the other changes of the moment,
+ * from its entry in the table */
 void StoreJoinedNode(NodeDB NewNode)
 {
-	uint8_t j;
-	int ret=0;
+	uint8_t i;
 
 	PRINTF("\n ### Node Type=%d,Short=0x%x,MAC=0x%llx,EP=%d\n",NewNode.type,NewNode.shortaddr,NewNode.mac,NewNode.ep);
 
-	ret=ramStorageReadFromFlash(myDB_filename,(uint8_t *)&savedNodes,sizeof(savedNodes));
-	if (ret)
-	{
-		PRINTF("\n ### ramStorageReadFromFlash=%d,Joined Nodes=%d",ret,savedNodes.totalNodes);
-		for (j=0;j<savedNodes.totalNodes;j++)
-		{
-			PRINTF("\n ### Idx=%d,Type=%d,short=0x%x,mac=0x%llx,ep=%d",j,savedNodes.joinedNodes[j].type,savedNodes.joinedNodes[j].shortaddr,savedNodes.joinedNodes[j].mac,savedNodes.joinedNodes[j].ep);
-		
-			if (savedNodes.joinedNodes[j].mac==NewNode.mac)
-			{
-				savedNodes.joinedNodes[j].type=NewNode.type;
-				savedNodes.joinedNodes[j].shortaddr=NewNode.shortaddr;
-				savedNodes.joinedNodes[j].ep=NewNode.ep;
-				ret = ramStorageSavetoFlash(myDB_filename,(uint8_t *)&savedNodes,sizeof(savedNodes));
-				return;
-			}	
-		}
-	}
+	i=u8ZCB_JoinedNodeByIeee(NewNode.mac);
+	if (i<DEV_NUM)
+		vZCB_NodeStoreMark(i);
+}
 
-  if (NewNode.type)
-  {
-	 savedNodes.joinedNodes[savedNodes.totalNodes].type = NewNode.type;	  
-	 savedNodes.joinedNodes[savedNodes.totalNodes].shortaddr = NewNode.shortaddr;
-	 savedNodes.joinedNodes[savedNodes.totalNodes].mac = NewNode.mac;
-	 savedNodes.joinedNodes[savedNodes.totalNodes].ep = NewNode.ep;
-	 savedNodes.totalNodes++;	
-  }
+uint8_t u8ZCB_JoinedNodeSetEp(uint16_t u16ShortAddress, uint16_t EP)
+{
+  uint8_t i;
 
-  if (savedNodes.totalNodes)
+  /* Several interviews may be running, the endpoint goes to its own node */
+  i=u8ZCB_JoinedNodeByShort(u16ShortAddress);
+  if ((i<DEV_NUM)&&(JoinedNodes[i].ep==0)&&(EP!=0))
   {
-	ret = ramStorageSavetoFlash(myDB_filename,(uint8_t *)&savedNodes,sizeof(savedNodes));
-	if (ret)
-		PRINTF("\n ### ramStorageSavetoFlash=%d,Joined Nodes=%d\n",ret,savedNodes.totalNodes);
+	vZCB_JoinedNodeUnindex(i);
+	JoinedNodes[i].ep=EP;
+	vZCB_JoinedNodeIndex(i);
+	return i;
   }
-	return ;
+  return DEV_NUM;
 }
 
-void UpdateJoinedNodes(uint16_t EP)
+void UpdateJoinedNodes(uint16_t u16ShortAddress, uint16_t EP)
 {
-  if ((JoinedNodes[idx].type)&&(JoinedNodes[idx].ep==0)&&(EP!=0))
-  {
-	JoinedNodes[idx].ep=EP;
-	StoreJoinedNode(JoinedNodes[idx]);
-  }	
+  uint8_t i;
+
+  i=u8ZCB_JoinedNodeSetEp(u16ShortAddress,EP);
+  if (i<DEV_NUM)
+	StoreJoinedNode(JoinedNodes[i]);
   else
   	PRINTF("\n ### New Joined Nodes Update Failure !!!\n");
 }
 
+uint8_t u8ZCB_JoinedNodeClaim(uint16_t u16ShortAddress, uint64_t u64IeeeAddress)
+{
+	uint8_t i;
+
+	i=u8ZCB_JoinedNodeByIeee(u64IeeeAddress);
+	if (i<DEV_NUM)
+		return i;
+
+	/* An entry may have been given a type since it was freed, those are skipped */
+	while ((i=u8JoinedFree)!=ZB_JOINED_NODE_FREE_NONE)
+	{
+		u8JoinedFree=au8JoinedNextFree[i];
+		if ((JoinedNodes[i].type==0)&&(JoinedNodes[i].ep==0))
+		{
+			vZCB_JoinedNodeUnindex(i);
+			JoinedNodes[i].shortaddr=u16ShortAddress;
+			JoinedNodes[i].mac=u64IeeeAddress;
+			JoinedNodes[i].type=1;
+			vZCB_JoinedNodeIndex(i);
+			idx=i;
+			return i;
+		}
+	}
+	return DEV_NUM;
+}
+
+/* A node was seen with a short address, move it there everywhere it is kept */
+static void vZCB_NodeAddressUpdate(uint16_t u16ShortAddress, uint64_t u64IeeeAddress)
+{
+    uint16_t u16OldShortAddress = E_ZB_BROADCAST_ADDRESS_ALL;
+    bool bChanged;
+    bool bStore = false;
+    NodeDB sNode;
+    uint8_t i;
+
+    bChanged = bZCB_AddrCacheLearn(u16ShortAddress, u64IeeeAddress, &u16OldShortAddress);
+
+    /* Device table, attributes and endpoint mapping change together */
+    vTaskSuspendAll();
+    if (bZDM_UpdateDeviceNodeId(u64IeeeAddress, u16ShortAddress, &u16OldShortAddress)) {
+        bChanged = true;
+    }
+    i = u8ZCB_JoinedNodeByIeee(u64IeeeAddress);
+    if ((i < DEV_NUM) && (JoinedNodes[i].shortaddr != u16ShortAddress)) {
+        u16OldShortAddress = JoinedNodes[i].shortaddr;
+        vZCB_JoinedNodeUnindex(i);
+        JoinedNodes[i].shortaddr = u16ShortAddress;
+        vZCB_JoinedNodeIndex(i);
+        sNode = JoinedNodes[i];
+        bStore = (sNode.type != 0);
+        bChanged = true;
+    }
+    (void)xTaskResumeAll();
+
+    if (!bChanged) {
+        return;
+    }
+
+    PRINTF("\n ### Node 0x%llx moved from 0x%x to 0x%x\n", u64IeeeAddress, u16OldShortAddress, u16ShortAddress);
+    if (u16OldShortAddress != E_ZB_BROADCAST_ADDRESS_ALL) {
+        vZCB_MailboxForget(u16OldShortAddress);
+    }
+    if (bStore) {
+        StoreJoinedNode(sNode);
+    }
+}
+
 static void ZCB_HandleDeviceAnnounce(void *pvUser, uint16_t u16Length, void *pvMessage) 
 {
 //    LOG(ZCB, INFO, "ZCB_HandleDeviceAnnounce\r\n" );
-	uint8_t i;
 
     struct _tsDeviceAnnounce {
         uint16_t    u16ShortAddress;
@@ -923,32 +1610,87 @@ static void ZCB_HandleDeviceAnnounce(void *pvUser, uint16_t u16Length, void *pvM
     
     psMessage->u16ShortAddress  = pri_ntohs(psMessage->u16ShortAddress);
     psMessage->u64IEEEAddress   = pri_ntohd(psMessage->u64IEEEAddress);
-    
-	for (i=0;i<DEV_NUM;i++)
-	{
-		if ((JoinedNodes[i].type==0)&&(JoinedNodes[i].ep==0))
-		{
-			JoinedNodes[i].shortaddr=psMessage->u16ShortAddress;
-			JoinedNodes[i].mac=psMessage->u64IEEEAddress;
-			JoinedNodes[i].type=1;
-			idx=i;
-			break;
-		}
-	}	
 
-    tsZbDeviceInfo* sDevice = NULL;
-    if (tZDM_FindDeviceByIeeeAddress(psMessage->u64IEEEAddress) == NULL) {
+    /* A node already joined may come back with a new short address */
+    vZCB_NodeAddressUpdate(psMessage->u16ShortAddress, psMessage->u64IEEEAddress);
+
+	(void)u8ZCB_JoinedNodeClaim(psMessage->u16ShortAddress, psMessage->u64IEEEAddress);
+
+    tsZbDeviceInfo* sDevice = tZDM_FindDeviceByIeeeAddress(psMessage->u64IEEEAddress);
+    if (sDevice == NULL) {
         if ((sDevice = tZDM_AddNewDeviceToDeviceTable(psMessage->u16ShortAddress, psMessage->u64IEEEAddress)) != NULL) 
 		{
-            vZDM_NewDeviceQualifyProcess(sDevice);
+            sDevice->bSleepy = !(psMessage->u8MacCapability & ZB_MAC_CAPABILITY_RX_ON_WHEN_IDLE);
+            vZCB_MailboxNodeHeard(psMessage->u16ShortAddress);
+            (void)eZCB_InterviewStart(psMessage->u16ShortAddress, psMessage->u64IEEEAddress,
+                                      ZCB_INTERVIEW_ANNOUNCE_DELAY_MS);
+        }
+    } else {
+        sDevice->bSleepy = !(psMessage->u8MacCapability & ZB_MAC_CAPABILITY_RX_ON_WHEN_IDLE);
+        vZCB_MailboxNodeHeard(psMessage->u16ShortAddress);
+    }
+}
+
+teZcbStatus eZCB_NodeAdopt(uint16_t u16ShortAddress, uint64_t u64IeeeAddress, bool bSleepy)
+{
+    tsZbDeviceInfo *sDevice;
+
+    vZCB_NodeAddressUpdate(u16ShortAddress, u64IeeeAddress);
+
+    if (u8ZCB_JoinedNodeClaim(u16ShortAddress, u64IeeeAddress) >= DEV_NUM) {
+        return E_ZCB_INSUFFICIENT_SPACE;
+    }
+
+    sDevice = tZDM_FindDeviceByIeeeAddress(u64IeeeAddress);
+    if (sDevice == NULL) {
+        sDevice = tZDM_AddNewDeviceToDeviceTable(u16ShortAddress, u64IeeeAddress);
+        if (sDevice == NULL) {
+            return E_ZCB_INSUFFICIENT_SPACE;
         }
-    }     
+    }
+    sDevice->bSleepy = bSleepy;
+    sDevice->eDeviceState = E_ZB_DEVICE_STATE_NEW_JOINED;
+
+    return eZCB_InterviewStart(u16ShortAddress, u64IeeeAddress, 0);
+}
+
+static void ZCB_HandleDataIndication(void *pvUser, uint16_t u16Length, void *pvMessage) 
+{
+    struct _tsDataIndication {
+        uint8_t     u8Status;
+        uint16_t    u16ProfileID;
+        uint16_t    u16ClusterID;
+        uint8_t     u8SrcEndpoint;
+        uint8_t     u8DstEndpoint;
+        uint8_t     u8SrcAddrMode;
+        union {
+            uint16_t    u16ShortAddress;
+            uint64_t    u64IEEEAddress;
+        } PACKED uSrcAddress;
+    } PACKED *psMessage = (struct _tsDataIndication *)pvMessage;
+
+    uint16_t u16ShortAddress;
+
+    /* Only the sender is of interest, a sleepy node is awake right now */
+    if (psMessage->u8SrcAddrMode == E_ZD_ADDRESS_MODE_SHORT) {
+        u16ShortAddress = pri_ntohs(psMessage->uSrcAddress.u16ShortAddress);
+    } else if (psMessage->u8SrcAddrMode == E_ZD_ADDRESS_MODE_IEEE) {
+        tsZbDeviceInfo *sDevice = tZDM_FindDeviceByIeeeAddress(pri_ntohd(psMessage->uSrcAddress.u64IEEEAddress));
+        if (sDevice == NULL) {
+            return;
+        }
+        u16ShortAddress = sDevice->u16NodeId;
+    } else {
+        return;
+    }
+
+    vZCB_MailboxNodeHeard(u16ShortAddress);
 }
 
 static void ZCB_HandleDeviceLeave(void *pvUser, uint16_t u16Length, void *pvMessage) 
 {
-	uint8_t i,j,Idx;
-	int ret=0;
+	uint8_t i;
+	bool bMaxEp;
 
 //    LOG(ZCB, INFO, "ZCB_HandleDeviceLeave\r\n" );
 
@@ -959,46 +1701,30 @@ static void ZCB_HandleDeviceLeave(void *pvUser, uint16_t u16Length, void *pvMess
 
     psMessage->u64IeeeAddr = pri_ntohd(psMessage->u64IeeeAddr);
 	
-	for (i=0;i<DEV_NUM;i++)
+	i=u8ZCB_JoinedNodeByIeee(psMessage->u64IeeeAddr);
+	if (i<DEV_NUM)
 	{
-		if (JoinedNodes[i].mac==psMessage->u64IeeeAddr)
-		{
-			PRINTF("\n ### %d: Remove Node : 0x%llx",i,psMessage->u64IeeeAddr);
-			ret=ramStorageReadFromFlash(myDB_filename,(uint8_t *)&savedNodes,sizeof(savedNodes));
-			if (ret)
-			{
-			  for (j=0;j<savedNodes.totalNodes;j++)
-				if (savedNodes.joinedNodes[j].mac==JoinedNodes[i].mac)
-				{
-					Idx=j;
-					break;
-				}	
-			  if (Idx)
-			  {
-			    for (j=Idx;j<savedNodes.totalNodes;j++)	
-			    {
-					savedNodes.joinedNodes[j].type=savedNodes.joinedNodes[j+1].type;
-					savedNodes.joinedNodes[j].ep=savedNodes.joinedNodes[j+1].ep;
-					savedNodes.joinedNodes[j].mac=savedNodes.joinedNodes[j+1].mac;
-					savedNodes.joinedNodes[j].shortaddr=savedNodes.joinedNodes[j+1].shortaddr;
-			    }
-				savedNodes.totalNodes-=1;
-				if (savedNodes.totalNodes)
-				{
-				  ret = ramStorageSavetoFlash(myDB_filename,(uint8_t *)&savedNodes,sizeof(savedNodes));
-				  if (ret)
-					  PRINTF("\n ### ramStorageSavetoFlash=%d,Joined Nodes=%d\n",ret,savedNodes.totalNodes);
-				}
-			  } 	
-			}			
-			JoinedNodes[i].type=JoinedNodes[i].ep=JoinedNodes[i].shortaddr=JoinedNodes[i].mac=0;
-		}	
-	}
+		PRINTF("\n ### %d: Remove Node : 0x%llx",i,psMessage->u64IeeeAddr);
+		vZCB_JoinedNodeUnindex(i);
+		bMaxEp=(JoinedNodes[i].ep!=0)&&(JoinedNodes[i].ep==u16JoinedMaxEp);
+		JoinedNodes[i].type=JoinedNodes[i].ep=JoinedNodes[i].shortaddr=JoinedNodes[i].mac=0;
+		if (bMaxEp)
+			vZCB_JoinedMaxEpRecompute();
+		au8JoinedNextFree[i]=u8JoinedFree;
+		u8JoinedFree=i;
+		vZCB_NodeStoreMark(i);
+	}	
 	
     tsZbDeviceInfo *sDevice = tZDM_FindDeviceByIeeeAddress(psMessage->u64IeeeAddr);
     if (sDevice == NULL)
         return;
 	
+    vZCB_LivenessForget(uZDM_FindDevTableIndexByNodeId(sDevice->u16NodeId));
+    vZCB_MailboxForget(sDevice->u16NodeId);
+    vZCB_IasZoneForget(sDevice->u16NodeId);
+    vZCB_AddrCacheForget(psMessage->u64IeeeAddr);
+    vZCB_ScenesForget(psMessage->u64IeeeAddr);
+    vZCB_AttributeMapForget(uZDM_FindDevTableIndexByNodeId(sDevice->u16NodeId));
     sDevice->eDeviceState = E_ZB_DEVICE_STATE_LEFT;
     bZDM_EraseDeviceFromDeviceTable(psMessage->u64IeeeAddr);
 }
@@ -1017,6 +1743,11 @@ static void ZCB_HandleMatchDescriptorResponse(void *pvUser, uint16_t u16Length,
         uint8_t     au8Endpoints[255];
     } PACKED *psMatchDescriptorResponse = (struct _tMatchDescriptorResponse *)pvMessage;
     psMatchDescriptorResponse->u16ShortAddress = pri_ntohs(psMatchDescriptorResponse->u16ShortAddress);
+
+    /* Answers to the discovery broadcasts */
+    if ((psMatchDescriptorResponse->u8Status == 0) && (psMatchDescriptorResponse->u8NumEndpoints > 0)) {
+        vZCB_DiscoveryMatchResponse(psMatchDescriptorResponse->u16ShortAddress);
+    }
     
 //    LOG(ZCB, INFO, "Match descriptor request response from node 0x%04X - %d matching endpoints.\r\n",
 //                psMatchDescriptorResponse->u16ShortAddress,
@@ -1043,149 +1774,119 @@ uint64_t nibblestr2u64( char * nibblestr ) {
 }
 
 
-void handleAttribute( uint16_t u16ShortAddress,
-                      uint16_t u16ClusterID,
-                      uint16_t u16AttributeID,
-                      uint64_t u64Data,
-                      uint8_t  u8Endpoint ) 
+/* Numeric value of an attribute, sent most significant byte first */
+static uint64_t u64ZCB_AttributeValue(uint8_t u8Type, const uint8_t *pu8Value, uint16_t u16Size)
 {
+    uint64_t u64Data = 0;
+
+    switch (u8Type)
+    {
+        case E_ZCL_OSTRING:
+        case E_ZCL_CSTRING:
+        case E_ZCL_LOSTRING:
+        case E_ZCL_LCSTRING:
+            return 0;
 
-    uint64_t u64IEEEAddress = 0;
-    newdb_zcb_t zcb;
-    ZcbAttribute_t *msg_data = NULL;
+        default:
+            break;
+    }
 
-#if 0
-    if ( newDbGetZcbSaddr( u16ShortAddress, &zcb ) ) 
-        u64IEEEAddress = nibblestr2u64( zcb.mac );
+    if (u16Size > sizeof(uint64_t)) {
+        u16Size = sizeof(uint64_t);
+    }
+    for (uint16_t i = 0; i < u16Size; i++) {
+        u64Data = (u64Data << 8) | pu8Value[i];
+    }
+    return u64Data;
+}
 
-    if ( u64IEEEAddress ) 
-#endif		
-	{
-      switch ( u16ClusterID ) 
-	  {
-		case E_ZB_CLUSTERID_ONOFF:
-			switch ( u16AttributeID ) 
-			{
-			case E_ZB_ATTRIBUTEID_ONOFF_ONOFF:
-    		{
-                    msg_data = (ZcbAttribute_t *)malloc(sizeof(ZcbAttribute_t));
-					if (msg_data)
-					{
-                    msg_data->u16ClusterID = u16ClusterID;
-                    msg_data->u16AttributeID = u16AttributeID;
-                    msg_data->u64Data = u64Data;
-                    eZCB_SendMsg(BRIDGE_WRITE_ATTRIBUTE, &sZcb, msg_data);	
-					free(msg_data);
-					msg_data=NULL;					
-					}
-					else
-						PRINTF("\n ### Fail to malloc buf !!!");
-			}
-			break;
-			default: 
-				break;
-			}
-		break;
-		
-		case E_ZB_CLUSTERID_LEVEL_CONTROL:
-			switch ( u16AttributeID ) 
-			{
-			case E_ZB_ATTRIBUTEID_LEVEL_CURRENTLEVEL:
-			{
-                    msg_data = (ZcbAttribute_t *)malloc(sizeof(ZcbAttribute_t));
-					if (msg_data)
-					{
-                    msg_data->u16ClusterID = u16ClusterID;
-                    msg_data->u16AttributeID = u16AttributeID;
-                    msg_data->u64Data = u64Data;
-                    eZCB_SendMsg(BRIDGE_WRITE_ATTRIBUTE, &sZcb, msg_data);		
-					free(msg_data);
-					msg_data=NULL;					
-					}
-					else
-						PRINTF("\n ### Fail to malloc buf !!!");
-			}
-			break;
-			default: 
-				break;
-			}
-		break;
-		
-		case E_ZB_CLUSTERID_MEASUREMENTSENSING_ILLUM:
-            switch ( u16AttributeID ) 
-            {
-	            case E_ZB_ATTRIBUTEID_MS_ILLUM_MEASURED:
-                    msg_data = (ZcbAttribute_t *)malloc(sizeof(ZcbAttribute_t));
-					if (msg_data)
-					{
-                    msg_data->u16ClusterID = u16ClusterID;
-                    msg_data->u16AttributeID = u16AttributeID;
-                    msg_data->u64Data = u64Data;
-                    eZCB_SendMsg(BRIDGE_WRITE_ATTRIBUTE, &sZcb, msg_data);
-					free(msg_data);
-					msg_data=NULL;
-					}
-					else
-						PRINTF("\n ### Fail to malloc buf !!!");
-					break;
-				default:
-					break;
-            }
-		  break;	
-		  	
-		case E_ZB_CLUSTERID_OCCUPANCYSENSING:
-			switch ( u16AttributeID ) 
-			{
-			   case E_ZB_ATTRIBUTEID_MS_OCC_OCCUPANCY:
-                    msg_data = (ZcbAttribute_t *)malloc(sizeof(ZcbAttribute_t));
-					if (msg_data)
-					{
-                    msg_data->u16ClusterID = u16ClusterID;
-                    msg_data->u16AttributeID = u16AttributeID;
-                    msg_data->u64Data = u64Data;
-                    eZCB_SendMsg(BRIDGE_WRITE_ATTRIBUTE, &sZcb, msg_data);	
-					free(msg_data);
-					msg_data=NULL;
-					}
-					else
-						PRINTF("\n ### Fail to malloc buf !!!");
-					break;
-				default:
-					break;			   	
-			}
-			break;
-			
-	    case E_ZB_CLUSTERID_MEASUREMENTSENSING_TEMP:
-            switch ( u16AttributeID ) 
-			{
-            case E_ZB_ATTRIBUTEID_MS_TEMP_MEASURED:
-                {
-                    msg_data = (ZcbAttribute_t *)malloc(sizeof(ZcbAttribute_t));
-					if (msg_data)
-					{
-                    msg_data->u16ClusterID = u16ClusterID;
-                    msg_data->u16AttributeID = u16AttributeID;
-                    msg_data->u64Data = u64Data;
-                    eZCB_SendMsg(BRIDGE_WRITE_ATTRIBUTE, &sZcb, msg_data);
-					free(msg_data);
-					msg_data=NULL;					
-					}
-					else
-						PRINTF("\n ### Fail to malloc buf !!!");
-                }
-                break;
+/* Add an attribute to a batch for the bridge, if the mapping table bridges it */
+static void vZCB_AttributeBatchAdd(ZcbAttributeBatch_t *psBatch,
+                                   uint8_t u8DevIndex,
+                                   uint16_t u16ClusterID,
+                                   uint16_t u16AttributeID,
+                                   uint8_t u8Type,
+                                   uint64_t u64Data)
+{
+    const tsZCB_AttributeMap *psMap;
+    int64_t i64Value;
 
-            default:
-         //       printf( "Received attribute 0x%04x in MEASUREMENTSENSING_TEMP cluster\n", u16AttributeID );
-                break;
-            }
-            break;
+    if (psBatch->u8Count >= ZCB_ATTRIBUTE_BATCH_MAX) {
+        return;
+    }
 
-        default:
-        //    printf( "Received attribute 0x%04x in cluster 0x%04x\n",u16AttributeID, u16ClusterID );
+    psMap = psZCB_AttributeMapFind(u16ClusterID, u16AttributeID);
+    if (!bZCB_AttributeMapConvert(psMap, u8DevIndex, u8Type, u64Data, &i64Value)) {
+        return;
+    }
+    psBatch->asAttributes[psBatch->u8Count].u32ClusterID   = psMap->u32MatterClusterId;
+    psBatch->asAttributes[psBatch->u8Count].u32AttributeID = psMap->u32MatterAttributeId;
+    psBatch->asAttributes[psBatch->u8Count].u64Data        = (uint64_t)i64Value;
+    psBatch->asAttributes[psBatch->u8Count].u8Write        = psMap->u8MatterWrite;
+    psBatch->u8Count++;
+}
+
+uint8_t u8ZCB_ReadResponseDeltas(uint16_t u16Length, const void *pvMessage, ZcbAttributeBatch_t *psBatch)
+{
+    const struct _sReadAttributeResponse {
+        uint8_t     u8SequenceNo;
+        uint16_t    u16ShortAddress;
+        uint8_t     u8EndPoint;
+        uint16_t    u16ClusterId;
+        uint8_t     au8Records[];
+    } PACKED *psMessage = (const struct _sReadAttributeResponse *)pvMessage;
+    const struct _sReadAttributeRecord {
+        uint16_t    u16AttributeId;
+        uint8_t     u8AttributeStatus;
+        uint8_t     u8AttributeType;
+        uint16_t    u16SizeOfAttributesInBytes;
+        uint8_t     auAttributeValue[];
+    } PACKED *psRecord;
+
+    const tsZCB_AttributeMap *psMap;
+    uint16_t u16Offset = 0;
+    uint16_t u16Records;
+    uint16_t u16ClusterId;
+    uint16_t u16Size;
+    uint8_t u8DevIndex;
+    int64_t i64Value;
+
+    psBatch->u8Count = 0;
+    if (u16Length < sizeof(struct _sReadAttributeResponse) + sizeof(struct _sReadAttributeRecord)) {
+        return 0;
+    }
+    u16Records   = u16Length - sizeof(struct _sReadAttributeResponse);
+    u16ClusterId = pri_ntohs(psMessage->u16ClusterId);
+    u8DevIndex   = uZDM_FindDevTableIndexByNodeId(pri_ntohs(psMessage->u16ShortAddress));
+
+    while ((u16Offset + sizeof(struct _sReadAttributeRecord) <= u16Records)
+           && (psBatch->u8Count < ZCB_ATTRIBUTE_BATCH_MAX))
+    {
+        psRecord   = (const struct _sReadAttributeRecord *)&psMessage->au8Records[u16Offset];
+        u16Size    = pri_ntohs(psRecord->u16SizeOfAttributesInBytes);
+        u16Offset += sizeof(struct _sReadAttributeRecord) + u16Size;
+        if (u16Offset > u16Records) {
             break;
         }
+        if (psRecord->u8AttributeStatus != 0) {
+            continue;
+        }
+
+        psMap = psZCB_AttributeMapFind(u16ClusterId, pri_ntohs(psRecord->u16AttributeId));
+        if (!bZCB_AttributeMapDelta(psMap, u8DevIndex, psRecord->u8AttributeType,
+                                    u64ZCB_AttributeValue(psRecord->u8AttributeType,
+                                                          psRecord->auAttributeValue, u16Size),
+                                    &i64Value)) {
+            continue;
+        }
+        psBatch->asAttributes[psBatch->u8Count].u32ClusterID   = psMap->u32MatterClusterId;
+        psBatch->asAttributes[psBatch->u8Count].u32AttributeID = psMap->u32MatterAttributeId;
+        psBatch->asAttributes[psBatch->u8Count].u64Data        = (uint64_t)i64Value;
+        psBatch->asAttributes[psBatch->u8Count].u8Write        = psMap->u8MatterWrite;
+        psBatch->u8Count++;
     }
+
+    return psBatch->u8Count;
 }
 
 static void ZCB_HandleAttributeReport(void *pvUser, uint16_t u16Length, void *pvMessage) 
@@ -1195,133 +1896,97 @@ static void ZCB_HandleAttributeReport(void *pvUser, uint16_t u16Length, void *pv
         uint16_t    u16ShortAddress;
         uint8_t     u8Endpoint;
         uint16_t    u16ClusterID;
+        uint8_t     au8Records[];
+    } PACKED *psMessage = (struct _tsAttributeReport *)pvMessage;
+    struct _tsAttributeRecord {
         uint16_t    u16AttributeID;
         uint8_t     u8AttributeStatus;
         uint8_t     u8Type;
         uint16_t    u16SizeOfAttributesInBytes;
-	union {
-		uint8_t 	u8Data;
-		uint16_t	u16Data;
-		uint32_t	u32Data;
-		uint64_t	u64Data;
-	} uData;
-    } PACKED *psMessage = (struct _tsAttributeReport *)pvMessage;
+        uint8_t     au8Value[];
+    } PACKED *psRecord;
+
+    ZcbAttributeBatch_t sBatch;
+    newdb_zcb_t sNode;
+    uint16_t u16Offset = 0;
+    uint16_t u16Records;
+    uint16_t u16AttributeID;
+    uint16_t u16Size;
+    uint64_t u64Data;
+
+    if (u16Length < sizeof(struct _tsAttributeReport) + sizeof(struct _tsAttributeRecord)) {
+        return;
+    }
+    u16Records = u16Length - sizeof(struct _tsAttributeReport);
 
-    uint64_t u64Data = 0;
-	
     psMessage->u16ShortAddress  = pri_ntohs(psMessage->u16ShortAddress);
     psMessage->u16ClusterID     = pri_ntohs(psMessage->u16ClusterID);
-    psMessage->u16AttributeID   = pri_ntohs(psMessage->u16AttributeID);
     
+    /* Device lookup and liveness once per frame, whatever the number of records */
     tsZbDeviceInfo * sDevice = tZDM_FindDeviceByNodeId(psMessage->u16ShortAddress);
     if (sDevice == NULL) {
-        eIeeeAddressRequest(psMessage->u16ShortAddress, psMessage->u16ShortAddress, 0, 0);
+        eZCB_AddrCacheResolve(psMessage->u16ShortAddress);
         return;
     }
 
     uint8_t index = uZDM_FindDevTableIndexByNodeId(sDevice->u16NodeId);
-    xTimerReset(deviceTimer[index].xTimers, 0);
-    deviceTimer[index].count = 0;
+    vZCB_NodeAlive(psMessage->u16ShortAddress);
 
-    if (sDevice->eDeviceState == E_ZB_DEVICE_STATE_OFF_LINE) {
-        sDevice->eDeviceState = E_ZB_DEVICE_STATE_ACTIVE;
-    }
-    
-    tsZbDeviceAttribute *sAttribute = tZDM_FindAttributeEntryByElement(psMessage->u16ShortAddress,
-                                                                       psMessage->u8Endpoint,
-                                                                       psMessage->u16ClusterID,
-                                                                       psMessage->u16AttributeID);
-    if (sAttribute == NULL)
-        return; 
+    vZCB_NodeFlowComplete(psMessage->u16ShortAddress, true);
+    vZCB_MailboxNodeHeard(psMessage->u16ShortAddress);
 
-    switch(psMessage->u8Type) 
+    /* One or more attribute records follow the header */
+    sBatch.u8Count = 0;
+    while (u16Offset + sizeof(struct _tsAttributeRecord) <= u16Records)
     {
-        case(E_ZCL_GINT8):
-        case(E_ZCL_UINT8):
-        case(E_ZCL_INT8):
-        case(E_ZCL_ENUM8):
-        case(E_ZCL_BMAP8):
-        case(E_ZCL_BOOL):
-        {
-			u64Data = (uint64_t )psMessage->uData.u8Data;
-        }
+        psRecord = (struct _tsAttributeRecord *)&psMessage->au8Records[u16Offset];
+        u16AttributeID = pri_ntohs(psRecord->u16AttributeID);
+        u16Size        = pri_ntohs(psRecord->u16SizeOfAttributesInBytes);
+        u16Offset     += sizeof(struct _tsAttributeRecord) + u16Size;
+        if (u16Offset > u16Records) {
             break;
-            
-        case(E_ZCL_STRUCT):
-        case(E_ZCL_INT16):
-        case(E_ZCL_UINT16):
-        case(E_ZCL_ENUM16):
-        case(E_ZCL_CLUSTER_ID):
-        case(E_ZCL_ATTRIBUTE_ID):
-        {
- 		    u64Data = (uint64_t )pri_ntohs(psMessage->uData.u16Data);
         }
-            break;
-            
-        case(E_ZCL_UINT24):
-        case(E_ZCL_UINT32):
-        case(E_ZCL_TOD):
-        case(E_ZCL_DATE):
-        case(E_ZCL_UTCT):
-        case(E_ZCL_BACNET_OID):
-        {
-			u64Data = (uint64_t )pri_ntohl(psMessage->uData.u32Data);
+        if (psRecord->u8AttributeStatus != 0) {
+            continue;
         }
-            break;
-            
-        case(E_ZCL_UINT40):
-        case(E_ZCL_UINT48):
-        case(E_ZCL_UINT56):
-        case(E_ZCL_UINT64):
-        case(E_ZCL_IEEE_ADDR):
-            break;
-                    
-        case E_ZCL_OSTRING:
-        case E_ZCL_CSTRING:
-            break;
-            
-        case E_ZCL_LOSTRING:
-        case E_ZCL_LCSTRING:
-            break;
-            
-        default:
-            break;
-    }
-
-	handleAttribute( psMessage->u16ShortAddress,psMessage->u16ClusterID,
-				psMessage->u16AttributeID,u64Data,psMessage->u8Endpoint );
 
-#if 0
-    if((psMessage->u8Type == E_ZCL_OSTRING) || (psMessage->u8Type == E_ZCL_CSTRING))        
-         ;//      LOG(ZCB, INFO, "attr value = %s\r\n", sAttribute->uData.sData.pData);
-    else
-          ;//    LOG(ZCB, INFO, "attr value = %d\r\n", sAttribute->uData.u64Data);
+        tsZbDeviceAttribute *sAttribute = tZDM_FindAttributeEntryByElement(psMessage->u16ShortAddress,
+                                                                           psMessage->u8Endpoint,
+                                                                           psMessage->u16ClusterID,
+                                                                           u16AttributeID);
+        if (sAttribute == NULL)
+            continue; 
 
-    if (sDevice->eDeviceState == E_ZB_DEVICE_STATE_ACTIVE)
-        ;//vZDM_cJSON_AttrUpdate(sAttribute);
+        u64Data = u64ZCB_AttributeValue(psRecord->u8Type, psRecord->au8Value, u16Size);
 
-    if ((sDevice->sZDEndpoint[0].u16DeviceType == 2) //Alarm Button
-        && (psMessage->u16ClusterID == E_ZB_CLUSTERID_ONOFF)
-        && (psMessage->u16AttributeID == E_ZB_ATTRIBUTEID_ONOFF_ONOFF)
-        && (sAttribute->uData.u64Data == 1))  //On
-    {
- //       LOG(ZCB, INFO, "Rx On Report from Button, ready to control a light\r\n");
-        uint8_t i;
-        for (i = 0; i < 5; i++) {
-            if (deviceTable[i].sZDEndpoint[0].u16DeviceType == 257) { 
-                eOnOff(E_ZB_ADDRESS_MODE_SHORT,
-                       deviceTable[i].u16NodeId,
-                       1,
-                       1,
-                       E_CLD_ONOFF_CMD_TOGGLE);
-   //             LOG(ZCB, INFO, "Controlled the dimmer light 0x%04X\r\n", deviceTable[i].u16NodeId);
-                break;
-            } else if (deviceTable[i].sZDEndpoint[0].u16DeviceType == 0) {
-                break;
-            }
+        /* The value last heard, which the ack policy compares a command with */
+        if ((sAttribute->u8DataType == psRecord->u8Type)
+            && (psRecord->u8Type != E_ZCL_OSTRING) && (psRecord->u8Type != E_ZCL_CSTRING)
+            && (psRecord->u8Type != E_ZCL_LOSTRING) && (psRecord->u8Type != E_ZCL_LCSTRING)) {
+            sAttribute->uData.u64Data = u64Data;
         }
+
+        vZCB_AckPolicyAttributeUpdate(psMessage->u16ShortAddress, psMessage->u8Endpoint,
+                                      psMessage->u16ClusterID, u16AttributeID, u64Data);
+
+        vZCB_AttributeBatchAdd(&sBatch, index, psMessage->u16ClusterID, u16AttributeID,
+                               psRecord->u8Type, u64Data);
+    }
+
+    /* All records of the frame go to the bridge as one update, to the
+     * endpoint of this node; none before the bridge has given it one */
+    memset(&sNode, 0, sizeof(sNode));
+    sNode.saddr     = psMessage->u16ShortAddress;
+    sNode.DynamicEP = u16ZCB_NodeDynamicEp(psMessage->u16ShortAddress);
+    if (sNode.DynamicEP != 0) {
+        eZCB_SendAttributeBatch(&sNode, &sBatch);
+    }
+
+    /* Newer than anything a resync in progress has read */
+    for (uint8_t i = 0; i < sBatch.u8Count; i++) {
+        vZCB_ResyncSuperseded(psMessage->u16ShortAddress,
+                              sBatch.asAttributes[i].u32ClusterID, sBatch.asAttributes[i].u32AttributeID);
     }
-#endif
 }
 
 static void ZCB_HandleActiveEndPointResp(void *pvUser, uint16_t u16Length, void *pvMessage) 
@@ -1333,30 +1998,15 @@ static void ZCB_HandleActiveEndPointResp(void *pvUser, uint16_t u16Length, void
     if (sDevice == NULL) {
         return; 
     }
+    vZCB_MailboxNodeHeard(u16ShortAddress);
     
     if (sDevice->eDeviceState != E_ZB_DEVICE_STATE_ACTIVE) {
-        sDevice->u8EndpointCount = psMessage->u8EndPointCount;
     //    LOG(ZCB, INFO, "ActiveEpRsp: -EpList: ");
-        for (uint8_t i = 0; i < sDevice->u8EndpointCount; i++) {
-            sDevice->sZDEndpoint[i].u8EndpointId = psMessage->au8EndPointList[i];
-    //        LOG(ZCB, INFO, "%d,", sDevice->sZDEndpoint[i].u8EndpointId);
-        }
-  //      LOG(ZCB, INFO, "\r\n");
-        sDevice->eDeviceState = E_ZB_DEVICE_STATE_GET_CLUSTER;
-        vZDM_NewDeviceQualifyProcess(sDevice);
+        bZDM_SetDeviceEndpoints(sDevice, psMessage->u8EndPointCount, psMessage->au8EndPointList);
+        vZCB_InterviewActiveEndpoints(u16ShortAddress);
     }  
 }
 
-void ClearClusterBitmap(void)
-{
-	sZcb.uSupportedClusters.sClusterBitmap.hasOnOff=0;
-	sZcb.uSupportedClusters.sClusterBitmap.hasDimmable=0;
-	sZcb.uSupportedClusters.sClusterBitmap.hasColor=0;
-	sZcb.uSupportedClusters.sClusterBitmap.hasIlluminanceSensing=0;
-	sZcb.uSupportedClusters.sClusterBitmap.hasTemperatureSensing=0;
-	sZcb.uSupportedClusters.sClusterBitmap.hasOccupancySensing=0;
-	return ;
-}
 static void ZCB_HandleSimpleDescriptorResponse(void *pvUser, uint16_t u16Length, void *pvMessage)
 {
     //ZCB_DEBUG( "ZCB_HandleSimpleDescriptorResponse\r\n" );
@@ -1365,79 +2015,33 @@ static void ZCB_HandleSimpleDescriptorResponse(void *pvUser, uint16_t u16Length,
     uint8_t u8EndPoint           = psMessage->u8Endpoint;
     uint16_t  u16DeviceId        = pri_ntohs(psMessage->u16DeviceID);
     uint8_t u8InClusterCnt       = psMessage->u8ClusterCount;
-
-    tsZbDeviceEndPoint * devEp;
-	uint8_t   u8Cluster;
+    uint16_t au16Clusters[MAX_ZD_CLUSTER_NUMBERS_PER_EP];
 
  //   LOG(ZCB, INFO, "SimpleRsp: addr = 0x%04x, ep = %d, devId = 0x%04x\r\n", u16ShortAddress, u8EndPoint, u16DeviceId);
     
     tsZbDeviceInfo *sDevice = tZDM_FindDeviceByNodeId(u16ShortAddress);
+    if (sDevice == NULL) {
+        return;
+    }
+    vZCB_MailboxNodeHeard(u16ShortAddress);
     if (sDevice->eDeviceState != E_ZB_DEVICE_STATE_ACTIVE) {
-        devEp = tZDM_FindEndpointEntryInDeviceTable(sDevice->u16NodeId, u8EndPoint);
-        devEp->u16DeviceType  = u16DeviceId;
         uint8_t actualClusCnt = 0;
         uint16_t tempClusterId = 0;
-        for (uint8_t i = 0; i < u8InClusterCnt; i++) {
+        for (uint8_t i = 0; (i < u8InClusterCnt) && (actualClusCnt < MAX_ZD_CLUSTER_NUMBERS_PER_EP); i++) {
             tempClusterId = pri_ntohs(psMessage->au16Clusters[i]);
-            if ((tempClusterId != E_ZB_CLUSTERID_GROUPS)
-                && (tempClusterId != E_ZB_CLUSTERID_SCENES)
-                && (tempClusterId != E_ZB_CLUSTERID_IDENTIFY)
+            /* Groups and Scenes are kept, scenes are bridged */
+            if ((tempClusterId != E_ZB_CLUSTERID_IDENTIFY)
                 && (tempClusterId != E_ZB_CLUSTERID_ZLL_COMMISIONING)
                 && (tempClusterId != 0xFFFF)) {
-                devEp->sZDCluster[actualClusCnt++].u16ClusterId = tempClusterId;
+                au16Clusters[actualClusCnt++] = tempClusterId;
             }
         }
-        devEp->u8ClusterCount = actualClusCnt;
-		ClearClusterBitmap();
-		for (u8Cluster = 0;	u8Cluster < actualClusCnt;u8Cluster++)
-		{
-		  if (devEp->sZDCluster[u8Cluster].u16ClusterId==E_ZB_CLUSTERID_ONOFF)
-		  {
-		//	  PRINTF("\n ### Cluster is OnOff ");
-			  sZcb.uSupportedClusters.sClusterBitmap.hasOnOff = 1;
-		  }	
-		  else if (devEp->sZDCluster[u8Cluster].u16ClusterId==E_ZB_CLUSTERID_LEVEL_CONTROL)
-		  {
-		//	  PRINTF("\n ### Cluster is Level Control ");
-			  sZcb.uSupportedClusters.sClusterBitmap.hasDimmable = 1;
-			  JoinedNodes[idx].type=2;
-		  }
-		  else if (devEp->sZDCluster[u8Cluster].u16ClusterId==E_ZB_CLUSTERID_COLOR_CONTROL)
-		  {
-		//	  PRINTF("\n ### Cluster is Color Control ");
-			  sZcb.uSupportedClusters.sClusterBitmap.hasColor = 1;
-			  JoinedNodes[idx].type=3;
-		  }
-		  else if (devEp->sZDCluster[u8Cluster].u16ClusterId==E_ZB_CLUSTERID_MEASUREMENTSENSING_ILLUM)
-		  {
-   		//      PRINTF("\n ### Cluster is Illuminance Measurement ");
-			  sZcb.uSupportedClusters.sClusterBitmap.hasIlluminanceSensing=1;
-		  }
-		  else if (devEp->sZDCluster[u8Cluster].u16ClusterId==E_ZB_CLUSTERID_MEASUREMENTSENSING_TEMP)
-		  {
-   		//      PRINTF("\n ### Cluster is Temperature Measurement ");
-		      sZcb.uSupportedClusters.sClusterBitmap.hasTemperatureSensing=1;
-		  }
-		  else if (devEp->sZDCluster[u8Cluster].u16ClusterId==E_ZB_CLUSTERID_OCCUPANCYSENSING)
-		  {
-		//	  PRINTF("\n ### Cluster is Occupancy Sensing ");
-			  sZcb.uSupportedClusters.sClusterBitmap.hasOccupancySensing=1;
-		  }
-		}
-#if 0 //force to EP 1 in case EP 2 is GP (0xF2)
-        if (u8EndPoint == sDevice->sZDEndpoint[sDevice->u8EndpointCount - 1].u8EndpointId) 
-#else
-		if (u8EndPoint == sDevice->sZDEndpoint[0].u8EndpointId) 
-#endif
-		{
-           sDevice->eDeviceState = E_ZB_DEVICE_STATE_READ_ATTRIBUTE;            
-        } else {
-            sDevice->eDeviceState = E_ZB_DEVICE_STATE_GET_CLUSTER;
+        if (tZDM_SetEndpointClusters(sDevice, u8EndPoint, u16DeviceId, actualClusCnt, au16Clusters) == NULL) {
+            return;
         }
-        vZDM_NewDeviceQualifyProcess(sDevice);
 
-	eZCB_SendMsg(BRIDGE_ADD_DEV,&sZcb,NULL);
-	
+        /* The interview adds the node to the bridge once all its endpoints are known */
+        vZCB_InterviewSimpleDescriptor(u16ShortAddress, u8EndPoint);
     }
 } 
 
@@ -1450,107 +2054,112 @@ static void ZCB_HandleReadAttrResp(void *pvUser, uint16_t u16Length, void *pvMes
         uint16_t    u16ShortAddress;
         uint8_t     u8EndPoint;
         uint16_t    u16ClusterId;
+        uint8_t     au8Records[];
+    } PACKED *psMessage = (struct _sReadAttributeResponse *)pvMessage;
+    struct _sReadAttributeRecord {
         uint16_t    u16AttributeId;
         uint8_t     u8AttributeStatus;
         uint8_t     u8AttributeType;
         uint16_t    u16SizeOfAttributesInBytes;
-        uint8_t     auAttributeValue[50];
-    } PACKED *psMessage = (struct _sReadAttributeResponse *)pvMessage;
+        uint8_t     auAttributeValue[];
+    } PACKED *psRecord;
 
-    psMessage->u16ShortAddress = pri_ntohs(psMessage->u16ShortAddress);
-    psMessage->u16ClusterId    = pri_ntohs(psMessage->u16ClusterId);
-    psMessage->u16AttributeId  = pri_ntohs(psMessage->u16AttributeId);
-    tsZbDeviceAttribute *sAttribute = tZDM_FindAttributeEntryByElement(psMessage->u16ShortAddress,
-                                                                       psMessage->u8EndPoint,
-                                                                       psMessage->u16ClusterId,
-                                                                       psMessage->u16AttributeId);
-    if (sAttribute == NULL) {
+    uint16_t u16Offset = 0;
+    uint16_t u16Records;
+    uint16_t u16AttributeId;
+    uint16_t u16Size;
+    bool bModelId = false;
+    tsZCB_ProfileKey sKey;
+
+    memset(&sKey, 0, sizeof(sKey));
+
+    if (u16Length < sizeof(struct _sReadAttributeResponse) + offsetof(struct _sReadAttributeRecord, u8AttributeType)) {
         return;
     }
-    
-    sAttribute->u8DataType = psMessage->u8AttributeType;
-    switch (sAttribute->u8DataType)
+    u16Records = u16Length - sizeof(struct _sReadAttributeResponse);
+
+    psMessage->u16ShortAddress = pri_ntohs(psMessage->u16ShortAddress);
+    psMessage->u16ClusterId    = pri_ntohs(psMessage->u16ClusterId);
+
+    vZCB_NodeFlowComplete(psMessage->u16ShortAddress, true);
+    vZCB_MailboxNodeHeard(psMessage->u16ShortAddress);
+
+    /* One or more attribute records follow the header */
+    while (u16Offset + offsetof(struct _sReadAttributeRecord, u8AttributeType) <= u16Records)
     {
-        case(E_ZCL_GINT8):
-        case(E_ZCL_UINT8):
-        case(E_ZCL_INT8):
-        case(E_ZCL_ENUM8):
-        case(E_ZCL_BMAP8):
-        case(E_ZCL_BOOL):
-        {
-            uint8_t u8Data;
-            memcpy(&u8Data, psMessage->auAttributeValue, sizeof(uint8_t));
-            sAttribute->uData.u64Data = (uint64_t)u8Data;
+        psRecord = (struct _sReadAttributeRecord *)&psMessage->au8Records[u16Offset];
+        u16AttributeId = pri_ntohs(psRecord->u16AttributeId);
+        if (psRecord->u8AttributeStatus != 0) {
+            /* A failed record is only the attribute id and its status; the
+             * cached type and value are left as they are */
+            u16Offset += offsetof(struct _sReadAttributeRecord, u8AttributeType);
+            continue;
         }
+        if (u16Offset + sizeof(struct _sReadAttributeRecord) > u16Records) {
             break;
-            
-        case(E_ZCL_STRUCT):
-        case(E_ZCL_INT16):
-        case(E_ZCL_UINT16):
-        case(E_ZCL_ENUM16):
-        case(E_ZCL_CLUSTER_ID):
-        case(E_ZCL_ATTRIBUTE_ID):
-        {
-            uint16_t u16Data;
-            memcpy(&u16Data, psMessage->auAttributeValue, sizeof(uint16_t));
-            sAttribute->uData.u64Data = (uint64_t)pri_ntohs(u16Data);
         }
+        u16Size        = pri_ntohs(psRecord->u16SizeOfAttributesInBytes);
+        u16Offset     += sizeof(struct _sReadAttributeRecord) + u16Size;
+        if (u16Offset > u16Records) {
             break;
-            
-        case(E_ZCL_UINT24):
-        case(E_ZCL_UINT32):
-        case(E_ZCL_TOD):
-        case(E_ZCL_DATE):
-        case(E_ZCL_UTCT):
-        case(E_ZCL_BACNET_OID):
-        {
-            uint32_t u32Data;
-            memcpy(&u32Data, psMessage->auAttributeValue, sizeof(uint32_t));
-            sAttribute->uData.u64Data = (uint64_t)pri_ntohl(u32Data);
         }
-            break;
-            
-        case(E_ZCL_UINT40):
-        case(E_ZCL_UINT48):
-        case(E_ZCL_UINT56):
-        case(E_ZCL_UINT64):
-        case(E_ZCL_IEEE_ADDR):
+
+        /* The model of a node, read before its interview */
+        if (psMessage->u16ClusterId == E_ZB_CLUSTERID_BASIC) {
+            bZCB_ProfileKeyField(&sKey, u16AttributeId, psRecord->auAttributeValue, u16Size);
+        }
+
+        tsZbDeviceAttribute *sAttribute = tZDM_FindAttributeEntryByElement(psMessage->u16ShortAddress,
+                                                                           psMessage->u8EndPoint,
+                                                                           psMessage->u16ClusterId,
+                                                                           u16AttributeId);
+        if (sAttribute == NULL) {
+            continue;
+        }
+        
+        if (sAttribute->u8DataType != psRecord->u8AttributeType) {
+            vZDM_ReleaseAttributeString(sAttribute);
+        }
+        sAttribute->u8DataType = psRecord->u8AttributeType;
+        switch (sAttribute->u8DataType)
         {
-            uint64_t u64Data;
-            memcpy(&u64Data, psMessage->auAttributeValue, sizeof(uint64_t));
-            sAttribute->uData.u64Data = pri_ntohd(u64Data);
+            case E_ZCL_OSTRING:
+            case E_ZCL_CSTRING:
+                bZDM_SetAttributeString(sAttribute, psRecord->auAttributeValue,
+                                        (u16Size > UINT8_MAX) ? UINT8_MAX : (uint8_t)u16Size);
+                break;
+                
+            case E_ZCL_LCSTRING:
+            case E_ZCL_LOSTRING:
+                break;
+                
+            default:
+                sAttribute->uData.u64Data = u64ZCB_AttributeValue(psRecord->u8AttributeType,
+                                                                  psRecord->auAttributeValue, u16Size);
+                vZCB_AckPolicyAttributeUpdate(psMessage->u16ShortAddress, psMessage->u8EndPoint,
+                                              psMessage->u16ClusterId, u16AttributeId,
+                                              sAttribute->uData.u64Data);
+                break;
+        }
+        
+        if((sAttribute->u8DataType == E_ZCL_OSTRING) || (sAttribute->u8DataType == E_ZCL_CSTRING))        
+              ;//        LOG(ZCB, INFO, "attr value = %s\r\n", pcZCB_StringGet(sAttribute->uData.sData.u16String));
+        else
+             ;//       LOG(ZCB, INFO, "attr value = %d\r\n", sAttribute->uData.u64Data);
+
+        if ((psMessage->u16ClusterId == E_ZB_CLUSTERID_BASIC) && (u16AttributeId == E_ZB_ATTRIBUTEID_BASIC_MODEL_ID)) {
+            bModelId = true;
         }
-            break;
-                    
-        case E_ZCL_OSTRING:
-        case E_ZCL_CSTRING:
-            sAttribute->uData.sData.u8Length = (uint8_t)pri_ntohs(psMessage->u16SizeOfAttributesInBytes);
-            if (sAttribute->uData.sData.pData == NULL) {
-                sAttribute->uData.sData.pData = pvPortMalloc(sizeof(uint8_t) * (sAttribute->uData.sData.u8Length + 1));
-            }      
-            memcpy(sAttribute->uData.sData.pData, psMessage->auAttributeValue, sizeof(uint8_t) * sAttribute->uData.sData.u8Length);
-            sAttribute->uData.sData.pData[sAttribute->uData.sData.u8Length] = '\0';
-            break;
-            
-        case E_ZCL_LCSTRING:
-        case E_ZCL_LOSTRING:
-            break;
-            
-        default:
-            break;
     }
-    
-    if((sAttribute->u8DataType == E_ZCL_OSTRING) || (sAttribute->u8DataType == E_ZCL_CSTRING))        
-          ;//        LOG(ZCB, INFO, "attr value = %s\r\n", sAttribute->uData.sData.pData);
-    else
-         ;//       LOG(ZCB, INFO, "attr value = %d\r\n", sAttribute->uData.u64Data);
 
     tsZbDeviceInfo *sDevice = tZDM_FindDeviceByNodeId(psMessage->u16ShortAddress);
-    if (sDevice->eDeviceState != E_ZB_DEVICE_STATE_ACTIVE) {
-        if ((psMessage->u16ClusterId == E_ZB_CLUSTERID_BASIC) && (psMessage->u16AttributeId == E_ZB_ATTRIBUTEID_BASIC_MODEL_ID)) {
-            sDevice->eDeviceState = E_ZB_DEVICE_STATE_BIND_CLUSTER;
-            vZDM_NewDeviceQualifyProcess(sDevice);
-        }
+    if ((sDevice != NULL) && (sDevice->eDeviceState != E_ZB_DEVICE_STATE_ACTIVE) && bModelId) {
+        vZCB_InterviewModelId(psMessage->u16ShortAddress);
+    }
+    if ((sDevice != NULL) && (sDevice->eDeviceState != E_ZB_DEVICE_STATE_ACTIVE)
+        && (psMessage->u16ClusterId == E_ZB_CLUSTERID_BASIC)) {
+        /* Also when no record came back, the interview goes on without a model */
+        vZCB_InterviewProfileRead(psMessage->u16ShortAddress, &sKey);
     }
 }
 
@@ -1570,6 +2179,35 @@ static void ZCB_HandleDefaultResponse(void *pvUser, uint16_t u16Length, void *pv
    //     psMessage->u16ClusterID, psMessage->u8CommandID, psMessage->u8Status);
 }
 
+static void ZCB_HandleWriteAttrResp(void *pvUser, uint16_t u16Length, void *pvMessage)
+{
+    struct _sWriteAttributeResponse {
+        uint8_t     u8SequenceNo;
+        uint16_t    u16ShortAddress;
+        uint8_t     u8Endpoint;
+        uint16_t    u16ClusterId;
+        uint16_t    u16AttributeId;     /* first record */
+        uint8_t     u8Status;
+    } PACKED *psMessage = (struct _sWriteAttributeResponse *)pvMessage;
+    uint16_t u16ShortAddress;
+
+    if (u16Length < offsetof(struct _sWriteAttributeResponse, u16AttributeId)) {
+        return;
+    }
+    u16ShortAddress = pri_ntohs(psMessage->u16ShortAddress);
+
+    /* The node answered, whatever the status of each attribute */
+    vZCB_NodeFlowComplete(u16ShortAddress, true);
+    vZCB_MailboxNodeHeard(u16ShortAddress);
+
+    /* The CIE address of an IAS zone, its enroll response follows */
+    if ((u16Length >= sizeof(struct _sWriteAttributeResponse))
+        && (pri_ntohs(psMessage->u16ClusterId) == E_ZB_CLUSTERID_IAS_ZONE)
+        && (pri_ntohs(psMessage->u16AttributeId) == E_ZB_ATTRIBUTEID_IAS_CIE_ADDRESS)) {
+        vZCB_IasZoneCieWritten(u16ShortAddress, psMessage->u8Endpoint, psMessage->u8Status);
+    }
+}
+
 static void ZCB_HandleLog(void *pvUser, uint16_t u16Length, void *pvMessage) 
 {
     struct sLog
@@ -1586,6 +2224,27 @@ static void ZCB_HandleLog(void *pvUser, uint16_t u16Length, void *pvMessage)
 static void ZCB_HandleIASZoneStatusChangeNotify (void *pvUser, uint16_t u16Length, void *pvMessage)
 {
   //  LOG(ZCB, INFO, "ZCB_HandleIASZoneStatusChangeNotify\r\n" );
+
+    /* The zone status itself already went to the bridge from the serial
+     * read task, this is the node bookkeeping only */
+    struct _tsZoneStatusChangeNotify {
+        uint8_t     u8SequenceNo;
+        uint8_t     u8Endpoint;
+        uint16_t    u16ClusterId;
+        uint8_t     u8SrcAddressMode;
+        uint16_t    u16SrcAddress;
+    } PACKED *psMessage = (struct _tsZoneStatusChangeNotify *)pvMessage;
+    uint16_t u16ShortAddress;
+
+    if ((u16Length < sizeof(struct _tsZoneStatusChangeNotify))
+        || (psMessage->u8SrcAddressMode == E_ZD_ADDRESS_MODE_IEEE)
+        || (psMessage->u8SrcAddressMode == E_ZD_ADDRESS_MODE_IEEE_NO_ACK)) {
+        return;
+    }
+
+    u16ShortAddress = pri_ntohs(psMessage->u16SrcAddress);
+    vZCB_NodeAlive(u16ShortAddress);
+    vZCB_MailboxNodeHeard(u16ShortAddress);
 }
 
 static void ZCB_HandleNetworkAddressReponse (void *pvUser, uint16_t u16Length, void *pvMessage)
@@ -1604,12 +2263,11 @@ static void ZCB_HandleNetworkAddressReponse (void *pvUser, uint16_t u16Length, v
 
     psMessage->u64IeeeAddress  = pri_ntohd(psMessage->u64IeeeAddress);
     psMessage->u16ShortAddress = pri_ntohs(psMessage->u16ShortAddress);
-    
-    tsZbDeviceInfo *sDevice = tZDM_FindDeviceByIeeeAddress(psMessage->u64IeeeAddress);
-    if (sDevice == NULL)
+
+    if (psMessage->u8Status != 0)
         return;
-    
-    sDevice->u64IeeeAddress = psMessage->u16ShortAddress;    
+
+    vZCB_NodeAddressUpdate(psMessage->u16ShortAddress, psMessage->u64IeeeAddress);
 }
 
 static void ZCB_HandleIeeeAddressReponse (void *pvUser, uint16_t u16Length, void *pvMessage)
@@ -1628,12 +2286,13 @@ static void ZCB_HandleIeeeAddressReponse (void *pvUser, uint16_t u16Length, void
 
     psMessage->u64IeeeAddress  = pri_ntohd(psMessage->u64IeeeAddress);
     psMessage->u16ShortAddress = pri_ntohs(psMessage->u16ShortAddress);
-    
-    tsZbDeviceInfo *sDevice = tZDM_FindDeviceByIeeeAddress(psMessage->u64IeeeAddress);
-    if (sDevice == NULL)
+
+    if (psMessage->u8Status != 0) {
+        vZCB_AddrCacheUnresolved(psMessage->u16ShortAddress);
         return;
-    
-    sDevice->u16NodeId = psMessage->u16ShortAddress;
+    }
+
+    vZCB_NodeAddressUpdate(psMessage->u16ShortAddress, psMessage->u64IeeeAddress);
 }
 
 static void ZCB_HandleOtaUpgradeEndRequest(void *pvUser, uint16_t u16Length, void *pvMessage)
@@ -1711,6 +2370,8 @@ static void HandleRestart(void *pvUser, uint16_t u16Length, void *pvMessage, int
     } else {
         //control bridge has formed network already
     }
+
+    vZCB_WatchdogRestartIndication(factoryNew ? true : false, psRestart->u8Status);
     return;
 }
 
@@ -1724,17 +2385,6 @@ static void ZCB_HandleRestartFactoryNew(void *pvUser, uint16_t u16Length, void *
     HandleRestart( pvUser, u16Length, pvMessage, 1 );
 }
 
-static void vDevTimerCallback(TimerHandle_t xTimers)
-{
-    uint32_t index = (uint32_t)pvTimerGetTimerID(xTimers);
-    deviceTimer[index].count ++;
- //   LOG(ZCB, INFO, "Device 0x%04X did not received Heartbeat, timeSinceLastMsg = %d min\r\n", deviceTable[index].u16NodeId, deviceTimer[index].count);
-    if (deviceTimer[index].count >= ZB_DEVICE_MESSAGE_TIMER_OUT_COUNT) {
-        xTimerStop(xTimers, 0);
-        deviceTable[index].eDeviceState = E_ZB_DEVICE_STATE_OFF_LINE;
-    }
-}
-
 teZcbStatus ZCB_OtaImageNotify(uint8_t u8AddrMode, 
                                uint16_t u16Addr, 
                                uint8_t u8SrcEp, 
@@ -1781,14 +2431,10 @@ teZcbStatus ZCB_OtaImageNotify(uint8_t u8AddrMode,
 
 uint8_t FindMatchedNodeByEP(uint16_t ep)
 {
-	uint8_t i;
+	uint16_t i;
 
-	for (i=0;i<DEV_NUM;i++)
-	{
-		  if ((JoinedNodes[i].type)&&(JoinedNodes[i].ep==ep))
-			break;
-	}
-	if (i==DEV_NUM)
+	i=u16ZCB_IndexFind(&sJoinedEpIndex,ep);
+	if ((ep==0)||(i==ZCB_INDEX_NONE))
 	{
 		PRINTF("\n ### Fail to find the Node with its EP Matches the required EP\n");
 		return 0xff;
@@ -1857,6 +2503,76 @@ void BridgedMoveToColor(uint16_t ep,uint16_t x,uint16_t y,uint16_t time)
 		eColorControlMoveToColor(JoinedNodes[i].shortaddr,x,y,time); 
 	}	
 }
+
+teZcbStatus BridgedStoreScene(uint16_t ep,uint16_t group,uint8_t scene)
+{
+	uint8_t i;
+	if ((i=FindMatchedNodeByEP(ep))==0xff)
+		return E_ZCB_UNKNOWN_NODE;
+	PRINTF("\n ### Send StoreScene to 0x%x with Group:0x%x,Scene:%d at EP=%d\n",JoinedNodes[i].shortaddr,group,scene,ep);
+	return eZCB_SceneStore(JoinedNodes[i].shortaddr,group,scene);
+}
+
+teZcbStatus BridgedRecallScene(uint16_t ep,uint16_t group,uint8_t scene,bool groupcast)
+{
+	uint8_t i;
+	/* One frame to the Zigbee group serves every endpoint the Matter group command reached */
+	if (groupcast && (group != 0))
+		return eZCB_SceneRecall(group,scene);
+	if ((i=FindMatchedNodeByEP(ep))==0xff)
+		return E_ZCB_UNKNOWN_NODE;
+	PRINTF("\n ### Send RecallScene to 0x%x with Group:0x%x,Scene:%d at EP=%d\n",JoinedNodes[i].shortaddr,group,scene,ep);
+	return eZCB_SceneRecallNode(JoinedNodes[i].shortaddr,group,scene);
+}
+
+teZcbStatus BridgedRemoveScene(uint16_t ep,uint16_t group,uint8_t scene)
+{
+	uint8_t i;
+	if ((i=FindMatchedNodeByEP(ep))==0xff)
+		return E_ZCB_UNKNOWN_NODE;
+	return eZCB_SceneRemove(JoinedNodes[i].shortaddr,group,scene);
+}
+
+teZcbStatus BridgedRemoveAllScenes(uint16_t ep,uint16_t group)
+{
+	uint8_t i;
+	if ((i=FindMatchedNodeByEP(ep))==0xff)
+		return E_ZCB_UNKNOWN_NODE;
+	return eZCB_SceneRemoveAll(JoinedNodes[i].shortaddr,group);
+}
+
+uint8_t BridgedSceneMembership(uint16_t ep,uint16_t group,uint8_t *scenes,uint8_t max)
+{
+	uint8_t i;
+	if ((i=FindMatchedNodeByEP(ep))==0xff)
+		return 0;
+	return u8ZCB_SceneMembership(JoinedNodes[i].shortaddr,group,scenes,max);
+}
+
+uint8_t BridgedSceneCount(uint16_t ep)
+{
+	uint8_t i;
+	if ((i=FindMatchedNodeByEP(ep))==0xff)
+		return 0;
+	return u8ZCB_ScenesNodeCount(JoinedNodes[i].shortaddr);
+}
+
+teZcbStatus BridgedAddGroup(uint16_t ep,uint16_t group)
+{
+	uint8_t i;
+	if ((i=FindMatchedNodeByEP(ep))==0xff)
+		return E_ZCB_UNKNOWN_NODE;
+	PRINTF("\n ### Send AddGroup to 0x%x with Group:0x%x at EP=%d\n",JoinedNodes[i].shortaddr,group,ep);
+	return eZCB_GroupAdd(JoinedNodes[i].shortaddr,group);
+}
+
+teZcbStatus BridgedRemoveGroup(uint16_t ep,uint16_t group)
+{
+	uint8_t i;
+	if ((i=FindMatchedNodeByEP(ep))==0xff)
+		return E_ZCB_UNKNOWN_NODE;
+	return eZCB_GroupRemove(JoinedNodes[i].shortaddr,group);
+}
 // ------------------------------------------------------------------
 // END OF FILE
 // ------------------------------------------------------------------
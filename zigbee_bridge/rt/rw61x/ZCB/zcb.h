@@ -9,6 +9,7 @@
 #define  ZCB_H
 
 #include <stdint.h>
+#include <stdbool.h>
 
 #include <sys/time.h>
 
@@ -70,6 +71,7 @@ typedef enum
     E_ZCB_UNKNOWN_ENDPOINT              = 0x13,
     E_ZCB_UNKNOWN_CLUSTER               = 0x14,
     E_ZCB_REQUEST_NOT_ACTIONED          = 0x15,
+    E_ZCB_DEFERRED                      = 0x16,
     
     /* Zigbee ZCL status codes */
     E_ZCB_NOT_AUTHORISED                = 0x7E, 
@@ -150,6 +152,36 @@ void eZCB_Init(void);
 /** Finished with control bridge - call this to tidy up */
 teZcbStatus eZCB_Finish(void);
 teZcbStatus eZCB_GetCoordinatorVersion(void);
+/** Pulse the coordinator reset line, it restarts with a restart message */
+void vZCB_PulseCoordinatorReset(void);
+/** Bring the bridge back in step after a coordinator restart */
+void vZCB_CoordinatorResync(bool bFactoryNew, uint8_t u8Status);
+/** Form the network; kept to form it again after a factory new restart */
+teZcbStatus eZCB_FormNetwork(uint32_t u32ChannelMask, uint64_t u64ExtPanId);
+/** A node was heard from, restart its liveness period */
+void vZCB_NodeAlive(uint16_t u16ShortAddress);
+/** Matter dynamic endpoint of a node, 0 when it is not bridged */
+uint16_t u16ZCB_NodeDynamicEp(uint16_t u16ShortAddress);
+/** Bridge node type kept for the node in the joined node table */
+void vZCB_NodeSetBridgeType(uint16_t u16ShortAddress, uint8_t u8Type);
+/** Entry of a node in the joined node table, a free one is taken for a node
+ *  not in it yet; DEV_NUM when the table is full */
+uint8_t u8ZCB_JoinedNodeClaim(uint16_t u16ShortAddress, uint64_t u64IeeeAddress);
+/** Give the node its Matter endpoint in the joined node table, nothing is
+ *  saved; its entry, DEV_NUM when it has none or has an endpoint already */
+uint8_t u8ZCB_JoinedNodeSetEp(uint16_t u16ShortAddress, uint16_t EP);
+/** Empty the joined node table, what is saved stays */
+void vZCB_JoinedNodesClear(void);
+/** Nodes in the joined node table */
+uint8_t u8ZCB_JoinedNodeCount(void);
+/** Static RAM of the joined node table and its lookups */
+uint32_t u32ZCB_JoinedNodesRam(void);
+/** Highest Matter endpoint of a joined node, 0 for none: when the node
+ *  holding it leaves, the next highest one takes its place */
+uint16_t u16ZCB_JoinedNodeMaxEp(void);
+/** Interview a node found in the network without an announce. Returns at
+ *  once, E_ZCB_INSUFFICIENT_SPACE when the bridge has no room for it. */
+teZcbStatus eZCB_NodeAdopt(uint16_t u16ShortAddress, uint64_t u64IeeeAddress, bool bSleepy);
 
 /**  ZCL Command Control  **/
 teZcbStatus eOnOff(uint8_t u8AddrMode,
@@ -202,6 +234,18 @@ teZcbStatus eColorControlMoveToSaturation(uint16_t u16Addr,
                                    uint8_t u8Hue,
                                    uint16_t u16Time);
 
+teZcbStatus eGroupAdd(uint8_t u8AddrMode,
+                      uint16_t u16Addr,
+                      uint16_t u16GroupId);
+teZcbStatus eGroupRemove(uint8_t u8AddrMode,
+                         uint16_t u16Addr,
+                         uint16_t u16GroupId);
+
+teZcbStatus eSceneStore(uint8_t u8AddrMode, uint16_t u16Addr, uint16_t u16GroupId, uint8_t u8SceneId);
+teZcbStatus eSceneRecall(uint8_t u8AddrMode, uint16_t u16Addr, uint16_t u16GroupId, uint8_t u8SceneId);
+teZcbStatus eSceneRemove(uint8_t u8AddrMode, uint16_t u16Addr, uint16_t u16GroupId, uint8_t u8SceneId);
+teZcbStatus eSceneRemoveAll(uint8_t u8AddrMode, uint16_t u16Addr, uint16_t u16GroupId);
+
 teZcbStatus eIASZoneEnrollResponse(uint8_t u8AddrMode, 
                                    uint16_t u16Addr, 
                                    uint8_t u8SrcEp, 
@@ -217,7 +261,7 @@ teZcbStatus ZCB_OtaImageNotify(uint8_t u8AddrMode,
 
 teZcbStatus eZCB_Finish(void);
 bool EnumJoinedNodes(void);
-void UpdateJoinedNodes(uint16_t EP);
+void UpdateJoinedNodes(uint16_t u16ShortAddress, uint16_t EP);
 void SaveJoinedNodes(void);
 void RestoreJoinedNodes(void);
 
@@ -227,7 +271,19 @@ void BridgedMoveToHue(uint16_t ep,uint8_t hue,uint8_t dir,uint16_t time);
 void BridgedMoveToSaturation(uint16_t ep,uint8_t sat,uint16_t time);
 void BridgedMoveToColorTemperature(uint16_t ep,uint16_t temp,uint16_t time);
 void BridgedMoveToColor(uint16_t ep,uint16_t x,uint16_t y,uint16_t time);
-#define DEV_NUM 5
+teZcbStatus BridgedStoreScene(uint16_t ep,uint16_t group,uint8_t scene);
+teZcbStatus BridgedRecallScene(uint16_t ep,uint16_t group,uint8_t scene,bool groupcast);
+teZcbStatus BridgedRemoveScene(uint16_t ep,uint16_t group,uint8_t scene);
+teZcbStatus BridgedRemoveAllScenes(uint16_t ep,uint16_t group);
+uint8_t BridgedSceneMembership(uint16_t ep,uint16_t group,uint8_t *scenes,uint8_t max);
+uint8_t BridgedSceneCount(uint16_t ep);
+teZcbStatus BridgedAddGroup(uint16_t ep,uint16_t group);
+teZcbStatus BridgedRemoveGroup(uint16_t ep,uint16_t group);
+/* Joined node table entry of a Matter dynamic endpoint, 0xff when none */
+uint8_t FindMatchedNodeByEP(uint16_t ep);
+
+/* Joined nodes kept and saved, as many as the bridge takes */
+#define DEV_NUM ZB_BRIDGE_MAX_NODES
 
 typedef struct {
 	uint8_t type; //router : OnOff/Dimmable/ColorLight ; enddevice:sensor/switch
@@ -19,6 +19,20 @@
 #include "zigbee_cmd.h"
 #include "cmd.h"
 #include "zcb.h"
+#include "ZcbChannelPlanner.h"
+#include "ZcbTopology.h"
+#include "ZcbAddrCache.h"
+#include "ZcbResync.h"
+#include "ZcbScenes.h"
+#include "ZcbIasZone.h"
+#include "ZcbDiscovery.h"
+#include "ZcbInterview.h"
+#include "ZcbProfileCache.h"
+#include "ZcbStringPool.h"
+#include "ZcbRegistry.h"
+#include "ZcbLiveness.h"
+#include "ZcbSnapshot.h"
+#include "ZcbNodeStore.h"
 
 #include "fsl_debug_console.h"
 
@@ -45,7 +59,16 @@
  ******************************************************************************/
 static int32_t zb_nwk_form(p_shell_context_t context, int32_t argc, char **argv);
 static int32_t zb_nwk_pjoin(p_shell_context_t context, int32_t argc, char **argv);
+static int32_t zb_nwk_chplan(p_shell_context_t context, int32_t argc, char **argv);
+static int32_t zb_nwk_topo(p_shell_context_t context, int32_t argc, char **argv);
+static int32_t zb_nwk_addr(p_shell_context_t context, int32_t argc, char **argv);
+static int32_t zb_nwk_resync(p_shell_context_t context, int32_t argc, char **argv);
+static int32_t zb_nwk_discover(p_shell_context_t context, int32_t argc, char **argv);
+static int32_t zb_nwk_interview(p_shell_context_t context, int32_t argc, char **argv);
+static int32_t zb_nwk_profile(p_shell_context_t context, int32_t argc, char **argv);
 static int32_t zb_zcl_onoff(p_shell_context_t context, int32_t argc, char **argv);
+static int32_t zb_zcl_scene(p_shell_context_t context, int32_t argc, char **argv);
+static int32_t zb_zcl_ias(p_shell_context_t context, int32_t argc, char **argv);
 static int32_t zb_zcl_level(p_shell_context_t context, int32_t argc, char **argv);
 static int32_t zb_zcl_color(p_shell_context_t context, int32_t argc, char **argv);
 static int32_t zb_zcl_ota(p_shell_context_t context, int32_t argc, char **argv);
@@ -54,6 +77,12 @@ static int32_t zb_zdo_unbind(p_shell_context_t context, int32_t argc, char **arg
 static int32_t zb_zdo_leave(p_shell_context_t context, int32_t argc, char **argv);
 static int32_t zb_gen_reset(p_shell_context_t context, int32_t argc, char **argv);
 static int32_t zb_gen_erasepdm(p_shell_context_t context, int32_t argc, char **argv);
+static int32_t zb_gen_devindex(p_shell_context_t context, int32_t argc, char **argv);
+static int32_t zb_gen_strpool(p_shell_context_t context, int32_t argc, char **argv);
+static int32_t zb_gen_registry(p_shell_context_t context, int32_t argc, char **argv);
+static int32_t zb_gen_liveness(p_shell_context_t context, int32_t argc, char **argv);
+static int32_t zb_gen_snapshot(p_shell_context_t context, int32_t argc, char **argv);
+static int32_t zb_gen_store(p_shell_context_t context, int32_t argc, char **argv);
 static int32_t zb_zdo_ieereq(p_shell_context_t context, int32_t argc, char **argv);
 static int32_t zb_zdo_nwkreq(p_shell_context_t context, int32_t argc, char **argv);
 static int32_t zb_zdo_activereq(p_shell_context_t context, int32_t argc, char **argv);
@@ -74,6 +103,77 @@ static const char zb_nwk_formHelp[] = "Usage:\r\n"
 static const char zb_nwk_pjoinHelp[] = "Usage:\r\n"
         "zb-nwk-pjoin <Seconds>\r\n";
 
+static const char zb_nwk_chplanHelp[] = "Usage:\r\n"
+        "zb-nwk-chplan show\r\n"
+        "zb-nwk-chplan scan\r\n"
+        "zb-nwk-chplan wifi <WifiChannel>\r\n"
+        "zb-nwk-chplan move [<Channel>]\r\n";
+
+static const char zb_nwk_topoHelp[] = "Usage:\r\n"
+        "zb-nwk-topo show\r\n"
+        "zb-nwk-topo walk\r\n";
+
+static const char zb_nwk_addrHelp[] = "Usage:\r\n"
+        "zb-nwk-addr show\r\n";
+
+static const char zb_nwk_resyncHelp[] = "Usage:\r\n"
+        "zb-nwk-resync show\r\n"
+        "zb-nwk-resync start\r\n";
+
+static const char zb_nwk_discoverHelp[] = "Usage:\r\n"
+        "zb-nwk-discover show\r\n"
+        "zb-nwk-discover start\r\n";
+
+static const char zb_nwk_interviewHelp[] = "Usage:\r\n"
+        "zb-nwk-interview show\r\n"
+#if ZB_BRIDGE_TEST_COMMANDS
+        "zb-nwk-interview storm\r\n"
+#endif
+        "zb-nwk-interview max <Concurrent>\r\n";
+
+static const char zb_nwk_profileHelp[] = "Usage:\r\n"
+        "zb-nwk-profile show\r\n"
+        "zb-nwk-profile clear\r\n";
+
+static const char zb_gen_devindexHelp[] = "Usage:\r\n"
+        "zb-gen-devindex show\r\n"
+        "zb-gen-devindex bench <Devices>\r\n"
+        "zb-gen-devindex footprint\r\n";
+
+static const char zb_gen_strpoolHelp[] = "Usage:\r\n"
+#if ZB_BRIDGE_TEST_COMMANDS
+        "zb-gen-strpool measure <Devices>\r\n"
+#endif
+        "zb-gen-strpool show\r\n";
+
+static const char zb_gen_registryHelp[] = "Usage:\r\n"
+#if ZB_BRIDGE_TEST_COMMANDS
+        "zb-gen-registry scale\r\n"
+#endif
+        "zb-gen-registry budget\r\n";
+static const char zb_gen_livenessHelp[] = "Usage:\r\n"
+#if ZB_BRIDGE_TEST_COMMANDS
+        "zb-gen-liveness measure\r\n"
+#endif
+        "zb-gen-liveness show\r\n";
+static const char zb_gen_snapshotHelp[] = "Usage:\r\n"
+#if ZB_BRIDGE_TEST_COMMANDS
+        "zb-gen-snapshot stress\r\n"
+#endif
+        "zb-gen-snapshot show\r\n";
+static const char zb_gen_storeHelp[] = "Usage:\r\n"
+        "zb-gen-store show\r\n"
+        "zb-gen-store measure\r\n";
+
+static const char zb_zcl_sceneHelp[] = "Usage:\r\n"
+        "zb-zcl-scene show\r\n"
+        "zb-zcl-scene store  <Address> <GroupId> <SceneId>\r\n"
+        "zb-zcl-scene recall <GroupId> <SceneId>\r\n"
+        "zb-zcl-scene remove <Address> <GroupId> <SceneId>\r\n";
+
+static const char zb_zcl_iasHelp[] = "Usage:\r\n"
+        "zb-zcl-ias show\r\n";
+
 static const char zb_zcl_onoffHelp[] = "Usage:\r\n"
         "zb-zcl-onoff [bound|group|short] <Address> <SrcEp> <DstEp> [off|on|toggle]\r\n";
 
@@ -129,15 +229,30 @@ static const char zb_coord_flashHelp[] = "Usage:\r\n"
 static const shell_command_context_t s_zigbee_cmd[]={
         {"zb-nwk-form",          "\"zb-nwk-form\":          Form the network\r\n",             zb_nwk_form,         SHELL_OPTIONAL_PARAMS},
         {"zb-nwk-pjoin",         "\"zb-nwk-pjoin\":         Permit to join\r\n",               zb_nwk_pjoin,        1},
+        {"zb-nwk-chplan",        "\"zb-nwk-chplan\":        Zigbee channel planner\r\n",     zb_nwk_chplan,       SHELL_OPTIONAL_PARAMS},
+        {"zb-nwk-topo",          "\"zb-nwk-topo\":          Zigbee mesh topology\r\n",       zb_nwk_topo,         1},
+        {"zb-nwk-addr",          "\"zb-nwk-addr\":          Zigbee address cache\r\n",       zb_nwk_addr,         1},
+        {"zb-nwk-resync",        "\"zb-nwk-resync\":        Re-read all Zigbee nodes\r\n",   zb_nwk_resync,       1},
+        {"zb-nwk-discover",      "\"zb-nwk-discover\":      Find nodes already in the network\r\n", zb_nwk_discover, SHELL_OPTIONAL_PARAMS},
+        {"zb-nwk-interview",     "\"zb-nwk-interview\":     Interviews of joining nodes\r\n", zb_nwk_interview, SHELL_OPTIONAL_PARAMS},
+        {"zb-nwk-profile",       "\"zb-nwk-profile\":       Device model profiles\r\n",     zb_nwk_profile,      1},
         {"zb-zcl-onoff",         "\"zb-zcl-onoff\":         Turn on/off the light\r\n",        zb_zcl_onoff,        SHELL_OPTIONAL_PARAMS},
         {"zb-zcl-level",         "\"zb-zcl-level\":         Control level of the light\r\n",   zb_zcl_level,        SHELL_OPTIONAL_PARAMS},
         {"zb-zcl-color",         "\"zb-zcl-color\":         Control the color\r\n",            zb_zcl_color,        SHELL_OPTIONAL_PARAMS},
+        {"zb-zcl-scene",         "\"zb-zcl-scene\":         Zigbee scenes\r\n",                zb_zcl_scene,        SHELL_OPTIONAL_PARAMS},
+        {"zb-zcl-ias",           "\"zb-zcl-ias\":           IAS zones and alarm latency\r\n",  zb_zcl_ias,          1},
      //   {"zb-zcl-ota",           "\"zb-zcl-ota\":           OTA Upgrade zigbee device\r\n",    zb_zcl_ota,          SHELL_OPTIONAL_PARAMS},
         {"zb-zdo-bind",          "\"zb-zdo-bind\":          Bind the device\r\n",              zb_zdo_bind,         SHELL_OPTIONAL_PARAMS},
         {"zb-zdo-unbind",        "\"zb-zdo-unbind\":        Unbind the device\r\n",            zb_zdo_unbind,       SHELL_OPTIONAL_PARAMS},
         {"zb-zdo-leave",         "\"zb-zdo-leave\":         Manage leave\r\n",                 zb_zdo_leave,        SHELL_OPTIONAL_PARAMS},
         {"zb-gen-reset",         "\"zb-gen-reset\":         Reset the ZigBee device\r\n",      zb_gen_reset,        0},
         {"zb-gen-erasepdm",      "\"zb-gen-erasepdm\":      Erase PDM\r\n",                    zb_gen_erasepdm,     0},
+        {"zb-gen-devindex",      "\"zb-gen-devindex\":      Device and attribute tables\r\n", zb_gen_devindex, SHELL_OPTIONAL_PARAMS},
+        {"zb-gen-strpool",       "\"zb-gen-strpool\":       Shared string attributes\r\n",  zb_gen_strpool,      SHELL_OPTIONAL_PARAMS},
+        {"zb-gen-registry",      "\"zb-gen-registry\":      Node registry at capacity\r\n", zb_gen_registry,     SHELL_OPTIONAL_PARAMS},
+        {"zb-gen-liveness",      "\"zb-gen-liveness\":      Node liveness wheel\r\n",       zb_gen_liveness,     SHELL_OPTIONAL_PARAMS},
+        {"zb-gen-snapshot",      "\"zb-gen-snapshot\":      Device table snapshot\r\n",     zb_gen_snapshot,     SHELL_OPTIONAL_PARAMS},
+        {"zb-gen-store",         "\"zb-gen-store\":         Joined node journal\r\n",       zb_gen_store,        SHELL_OPTIONAL_PARAMS},
         {"zb-zdo-ieereq",        "\"zb-zdo-ieereq\":        Request IEEAddr\r\n",              zb_zdo_ieereq,       SHELL_OPTIONAL_PARAMS},
         {"zb-zdo-nwkreq",        "\"zb-zdo-nwkreq\":        Request NWKAddr\r\n",              zb_zdo_nwkreq,       SHELL_OPTIONAL_PARAMS},
         {"zb-zdo-activereq",     "\"zb-zdo-activereq\":     Request active endpoints\r\n",     zb_zdo_activereq,    1},
@@ -167,11 +282,7 @@ static int32_t zb_nwk_form(p_shell_context_t context, int32_t argc, char **argv)
         ChannelMask = atoi(argv[1]);
         if (ChannelMask <= 26) {
             if(addr_valid(argv[2], 16)) {
-                rt = eSetChannelMask(ChannelMask);
-                assert(rt == E_ZCB_OK);
-                rt = eSetExPANID(simple_strtoul(argv[2], NULL, 16));
-                assert(rt == E_ZCB_OK);
-                rt = eStartNetwork();
+                rt = eZCB_FormNetwork(ChannelMask, simple_strtoul(argv[2], NULL, 16));
                 assert(rt == E_ZCB_OK);
             } else {
                 goto err;
@@ -214,6 +325,401 @@ err:
     return -1;
 }
 
+static int32_t zb_nwk_chplan(p_shell_context_t context, int32_t argc, char **argv)
+{
+    teZcbStatus rt = E_ZCB_ERROR;
+    uint32_t Channel = 0;
+
+    switch (argc)
+    {
+    case 2:
+        if (strcmp(argv[1], HELP_STRING) == 0) {
+            context->printf_data_func("%s", zb_nwk_chplanHelp);
+        } else if (strcmp(argv[1], "show") == 0) {
+            vZCB_ChannelPlannerDump();
+        } else if (strcmp(argv[1], "scan") == 0) {
+            rt = eZCB_ChannelPlannerScan();
+            assert(rt == E_ZCB_OK);
+        } else if (strcmp(argv[1], "move") == 0) {
+            rt = eZCB_ChannelPlannerMove(0);
+            assert(rt == E_ZCB_OK);
+        } else {
+            goto err;
+        }
+        break;
+    case 3:
+        Channel = atoi(argv[2]);
+        if ((strcmp(argv[1], "wifi") == 0) && (Channel <= 14)) {
+            vZCB_ChannelPlannerSetWifiChannel(Channel);
+        } else if ((strcmp(argv[1], "move") == 0) && (Channel >= ZCB_CHANNEL_FIRST) && (Channel <= ZCB_CHANNEL_LAST)) {
+            rt = eZCB_ChannelPlannerMove(Channel);
+            assert(rt == E_ZCB_OK);
+        } else {
+            goto err;
+        }
+        break;
+    default :
+        goto err;
+        break;
+    }
+
+    return 0;
+err:
+    context->printf_data_func("Error: Incorrect command or parameters\r\n");
+    return -1;
+}
+
+static int32_t zb_nwk_topo(p_shell_context_t context, int32_t argc, char **argv)
+{
+    if (strcmp(argv[1], HELP_STRING) == 0) {
+        context->printf_data_func("%s", zb_nwk_topoHelp);
+    } else if (strcmp(argv[1], "show") == 0) {
+        vZCB_TopologyDump();
+    } else if (strcmp(argv[1], "walk") == 0) {
+        vZCB_TopologyStartWalk();
+    } else {
+        context->printf_data_func("Error: Incorrect command or parameters\r\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+static int32_t zb_nwk_addr(p_shell_context_t context, int32_t argc, char **argv)
+{
+    if (strcmp(argv[1], HELP_STRING) == 0) {
+        context->printf_data_func("%s", zb_nwk_addrHelp);
+    } else if (strcmp(argv[1], "show") == 0) {
+        vZCB_AddrCacheDump();
+    } else {
+        context->printf_data_func("Error: Incorrect command or parameters\r\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+static int32_t zb_nwk_resync(p_shell_context_t context, int32_t argc, char **argv)
+{
+    if (strcmp(argv[1], HELP_STRING) == 0) {
+        context->printf_data_func("%s", zb_nwk_resyncHelp);
+    } else if (strcmp(argv[1], "show") == 0) {
+        vZCB_ResyncDump();
+    } else if (strcmp(argv[1], "start") == 0) {
+        vZCB_ResyncStart();
+    } else {
+        context->printf_data_func("Error: Incorrect command or parameters\r\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+static int32_t zb_nwk_discover(p_shell_context_t context, int32_t argc, char **argv)
+{
+    if (argc != 2) {
+        goto err;
+    }
+    if (strcmp(argv[1], HELP_STRING) == 0) {
+        context->printf_data_func("%s", zb_nwk_discoverHelp);
+    } else if (strcmp(argv[1], "show") == 0) {
+        vZCB_DiscoveryDump();
+    } else if (strcmp(argv[1], "start") == 0) {
+        vZCB_DiscoveryStart();
+    } else {
+        goto err;
+    }
+
+    return 0;
+err:
+    context->printf_data_func("Error: Incorrect command or parameters\r\n");
+    return -1;
+}
+
+static int32_t zb_nwk_interview(p_shell_context_t context, int32_t argc, char **argv)
+{
+    uint32_t Count = 0;
+
+    switch (argc)
+    {
+    case 2:
+        if (strcmp(argv[1], HELP_STRING) == 0) {
+            context->printf_data_func("%s", zb_nwk_interviewHelp);
+        } else if (strcmp(argv[1], "show") == 0) {
+            vZCB_InterviewDump();
+#if ZB_BRIDGE_TEST_COMMANDS
+        } else if (strcmp(argv[1], "storm") == 0) {
+            vZCB_InterviewStorm(ZCB_INTERVIEW_STORM_JOINS);
+#endif
+        } else {
+            goto err;
+        }
+        break;
+    case 3:
+        Count = atoi(argv[2]);
+        if ((Count == 0) || (Count > ZCB_INTERVIEW_MAX_NODES)) {
+            goto err;
+        }
+        if (strcmp(argv[1], "max") == 0) {
+            vZCB_InterviewSetConcurrency((uint8_t)Count);
+        } else {
+            goto err;
+        }
+        break;
+    default :
+        goto err;
+        break;
+    }
+
+    return 0;
+err:
+    context->printf_data_func("Error: Incorrect command or parameters\r\n");
+    return -1;
+}
+
+static int32_t zb_nwk_profile(p_shell_context_t context, int32_t argc, char **argv)
+{
+    if (strcmp(argv[1], HELP_STRING) == 0) {
+        context->printf_data_func("%s", zb_nwk_profileHelp);
+    } else if (strcmp(argv[1], "show") == 0) {
+        vZCB_ProfileDump();
+    } else if (strcmp(argv[1], "clear") == 0) {
+        vZCB_ProfileClear();
+    } else {
+        context->printf_data_func("Error: Incorrect command or parameters\r\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+static int32_t zb_gen_devindex(p_shell_context_t context, int32_t argc, char **argv)
+{
+    uint32_t Devices = 0;
+
+    switch (argc)
+    {
+    case 2:
+        if (strcmp(argv[1], HELP_STRING) == 0) {
+            context->printf_data_func("%s", zb_gen_devindexHelp);
+        } else if (strcmp(argv[1], "show") == 0) {
+            vZDM_DeviceIndexDump();
+        } else if (strcmp(argv[1], "footprint") == 0) {
+            vZDM_DeviceFootprint();
+        } else {
+            goto err;
+        }
+        break;
+    case 3:
+        Devices = atoi(argv[2]);
+        if ((strcmp(argv[1], "bench") == 0) && (Devices > 0)) {
+            vZDM_DeviceIndexBenchmark((uint16_t)Devices);
+        } else {
+            goto err;
+        }
+        break;
+    default :
+        goto err;
+        break;
+    }
+
+    return 0;
+err:
+    context->printf_data_func("Error: Incorrect command or parameters\r\n");
+    return -1;
+}
+
+static int32_t zb_gen_strpool(p_shell_context_t context, int32_t argc, char **argv)
+{
+#if ZB_BRIDGE_TEST_COMMANDS
+    uint32_t Devices = 0;
+#endif
+
+    switch (argc)
+    {
+    case 2:
+        if (strcmp(argv[1], HELP_STRING) == 0) {
+            context->printf_data_func("%s", zb_gen_strpoolHelp);
+        } else if (strcmp(argv[1], "show") == 0) {
+            vZCB_StringPoolDump();
+        } else {
+            goto err;
+        }
+        break;
+#if ZB_BRIDGE_TEST_COMMANDS
+    case 3:
+        Devices = atoi(argv[2]);
+        if ((strcmp(argv[1], "measure") == 0) && (Devices > 0) && (Devices <= UINT8_MAX)) {
+            vZCB_StringPoolMeasure((uint8_t)Devices);
+        } else {
+            goto err;
+        }
+        break;
+#endif
+    default :
+        goto err;
+        break;
+    }
+
+    return 0;
+err:
+    context->printf_data_func("Error: Incorrect command or parameters\r\n");
+    return -1;
+}
+
+static int32_t zb_gen_registry(p_shell_context_t context, int32_t argc, char **argv)
+{
+    if (argc != 2) {
+        goto err;
+    }
+    if (strcmp(argv[1], HELP_STRING) == 0) {
+        context->printf_data_func("%s", zb_gen_registryHelp);
+    } else if (strcmp(argv[1], "budget") == 0) {
+        vZCB_RegistryBudget();
+#if ZB_BRIDGE_TEST_COMMANDS
+    } else if (strcmp(argv[1], "scale") == 0) {
+        vZCB_RegistryScaleTest();
+#endif
+    } else {
+        goto err;
+    }
+
+    return 0;
+err:
+    context->printf_data_func("Error: Incorrect command or parameters\r\n");
+    return -1;
+}
+
+static int32_t zb_gen_liveness(p_shell_context_t context, int32_t argc, char **argv)
+{
+    if (argc != 2) {
+        goto err;
+    }
+    if (strcmp(argv[1], HELP_STRING) == 0) {
+        context->printf_data_func("%s", zb_gen_livenessHelp);
+    } else if (strcmp(argv[1], "show") == 0) {
+        vZCB_LivenessDump();
+#if ZB_BRIDGE_TEST_COMMANDS
+    } else if (strcmp(argv[1], "measure") == 0) {
+        vZCB_LivenessMeasure();
+#endif
+    } else {
+        goto err;
+    }
+
+    return 0;
+err:
+    context->printf_data_func("Error: Incorrect command or parameters\r\n");
+    return -1;
+}
+
+static int32_t zb_gen_snapshot(p_shell_context_t context, int32_t argc, char **argv)
+{
+    if (argc != 2) {
+        goto err;
+    }
+    if (strcmp(argv[1], HELP_STRING) == 0) {
+        context->printf_data_func("%s", zb_gen_snapshotHelp);
+    } else if (strcmp(argv[1], "show") == 0) {
+        vZCB_SnapshotDump();
+#if ZB_BRIDGE_TEST_COMMANDS
+    } else if (strcmp(argv[1], "stress") == 0) {
+        vZCB_SnapshotStress();
+#endif
+    } else {
+        goto err;
+    }
+
+    return 0;
+err:
+    context->printf_data_func("Error: Incorrect command or parameters\r\n");
+    return -1;
+}
+
+static int32_t zb_gen_store(p_shell_context_t context, int32_t argc, char **argv)
+{
+    if (argc != 2) {
+        goto err;
+    }
+    if (strcmp(argv[1], HELP_STRING) == 0) {
+        context->printf_data_func("%s", zb_gen_storeHelp);
+    } else if (strcmp(argv[1], "show") == 0) {
+        vZCB_NodeStoreDump();
+    } else if (strcmp(argv[1], "measure") == 0) {
+        vZCB_NodeStoreMeasure();
+    } else {
+        goto err;
+    }
+
+    return 0;
+err:
+    context->printf_data_func("Error: Incorrect command or parameters\r\n");
+    return -1;
+}
+
+static int32_t zb_zcl_ias(p_shell_context_t context, int32_t argc, char **argv)
+{
+    if (strcmp(argv[1], HELP_STRING) == 0) {
+        context->printf_data_func("%s", zb_zcl_iasHelp);
+    } else if (strcmp(argv[1], "show") == 0) {
+        vZCB_IasZoneDump();
+    } else {
+        context->printf_data_func("Error: Incorrect command or parameters\r\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+static int32_t zb_zcl_scene(p_shell_context_t context, int32_t argc, char **argv)
+{
+    teZcbStatus rt = E_ZCB_ERROR;
+
+    switch (argc)
+    {
+    case 2:
+        if (strcmp(argv[1], HELP_STRING) == 0) {
+            context->printf_data_func("%s", zb_zcl_sceneHelp);
+        } else if (strcmp(argv[1], "show") == 0) {
+            vZCB_ScenesDump();
+        } else {
+            goto err;
+        }
+        break;
+    case 4:
+        if (strcmp(argv[1], "recall") == 0) {
+            /* Group recall, as for a Matter group command */
+            rt = eZCB_SceneRecall(strtol(argv[2], NULL, 16), atoi(argv[3]));
+        } else {
+            goto err;
+        }
+        break;
+    case 5:
+        if (!addr_valid(argv[2], 4)) {
+            goto err;
+        }
+        if (strcmp(argv[1], "store") == 0) {
+            rt = eZCB_SceneStore(strtol(argv[2], NULL, 16), strtol(argv[3], NULL, 16), atoi(argv[4]));
+        } else if (strcmp(argv[1], "remove") == 0) {
+            rt = eZCB_SceneRemove(strtol(argv[2], NULL, 16), strtol(argv[3], NULL, 16), atoi(argv[4]));
+        } else {
+            goto err;
+        }
+        break;
+    default:
+        goto err;
+        break;
+    }
+
+    if ((argc > 2) && (rt != E_ZCB_OK)) {
+        context->printf_data_func("Error: status 0x%02x\r\n", rt);
+    }
+    return 0;
+err:
+    context->printf_data_func("Error: Incorrect command or parameters\r\n");
+    return -1;
+}
+
 static int32_t zb_zcl_onoff(p_shell_context_t context, int32_t argc, char **argv)
 {
     teZcbStatus rt = E_ZCB_ERROR;